@@ -0,0 +1,939 @@
+/*
+* CPU bounding volume hierarchy
+*
+* Binned SAH builder parallelized over the thread pool, single ray and SIMD packet traversal kernels, a reference renderer for golden images
+* and a ray throughput benchmark, working on the same triangle lists used for rasterization and hardware ray tracing
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <numeric>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define VKS_BVH_SSE
+#include <emmintrin.h>
+#endif
+
+#include "Bvh.h"
+#include "threadpool.hpp"
+
+namespace vks
+{
+	namespace bvh
+	{
+		namespace
+		{
+			// Interior nodes stop being split once they are this deep, which also bounds the traversal stacks
+			const uint32_t maxDepth = 64;
+			const uint32_t maxBinCount = 64;
+			// Subtrees with fewer triangles are not worth a job of their own
+			const uint32_t parallelBuildThreshold = 4096;
+
+			const float* position(const float* positions, size_t positionStride, uint32_t index)
+			{
+				return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + index * positionStride);
+			}
+
+			uint32_t resolveThreadCount(uint32_t threadCount)
+			{
+				return (threadCount > 0) ? threadCount : std::max(std::thread::hardware_concurrency(), 1u);
+			}
+
+			struct Aabb {
+				float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+				float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+				void grow(const float* point)
+				{
+					for (uint32_t i = 0; i < 3; i++) {
+						min[i] = std::min(min[i], point[i]);
+						max[i] = std::max(max[i], point[i]);
+					}
+				}
+
+				void grow(const Aabb& other)
+				{
+					for (uint32_t i = 0; i < 3; i++) {
+						min[i] = std::min(min[i], other.min[i]);
+						max[i] = std::max(max[i], other.max[i]);
+					}
+				}
+
+				// Half the surface area, the factor cancels out in the heuristic
+				float area() const
+				{
+					const float x = max[0] - min[0];
+					const float y = max[1] - min[1];
+					const float z = max[2] - min[2];
+					return (x < 0.0f) ? 0.0f : x * y + y * z + z * x;
+				}
+			};
+
+			float nodeArea(const Node& node)
+			{
+				Aabb bounds;
+				bounds.grow(node.boundsMin);
+				bounds.grow(node.boundsMax);
+				return bounds.area();
+			}
+
+			/*
+				Top down builder working on a range of the shared triangle id list, so subtrees can be built by different threads in place
+				Each subtree writes its nodes into its own list with the root at index 0, the lists are spliced into the final node list afterwards
+			*/
+			struct Builder {
+				const std::vector<Aabb>& triangleBounds;
+				const std::vector<float>& centroids;
+				const BuildSettings& settings;
+				std::vector<uint32_t>& triangleIds;
+
+				struct Task {
+					uint32_t node;
+					uint32_t first;
+					uint32_t count;
+					uint32_t depth;
+				};
+
+				void setBounds(Node& node, uint32_t first, uint32_t count) const
+				{
+					Aabb bounds;
+					for (uint32_t i = first; i < first + count; i++) {
+						bounds.grow(triangleBounds[triangleIds[i]]);
+					}
+					memcpy(node.boundsMin, bounds.min, sizeof(bounds.min));
+					memcpy(node.boundsMax, bounds.max, sizeof(bounds.max));
+				}
+
+				/*
+					Evaluates the surface area heuristic at the bin boundaries on all three axes and partitions the range at the cheapest one
+					Returns the number of triangles in the left half, or 0 if the node should become a leaf
+				*/
+				uint32_t split(const Node& node, uint32_t first, uint32_t count, uint32_t depth) const
+				{
+					if ((count <= 1) || (depth >= maxDepth)) {
+						return 0;
+					}
+					Aabb centroidBounds;
+					for (uint32_t i = first; i < first + count; i++) {
+						centroidBounds.grow(&centroids[triangleIds[i] * 3]);
+					}
+
+					const uint32_t binCount = std::clamp(settings.binCount, 2u, maxBinCount);
+					const float parentArea = std::max(nodeArea(node), FLT_MIN);
+					float bestCost = FLT_MAX;
+					uint32_t bestAxis = 0;
+					uint32_t bestBin = 0;
+					for (uint32_t axis = 0; axis < 3; axis++) {
+						const float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+						if (extent <= 0.0f) {
+							continue;
+						}
+						const float scale = binCount / extent;
+						Aabb binBounds[maxBinCount];
+						uint32_t binCounts[maxBinCount]{};
+						for (uint32_t i = first; i < first + count; i++) {
+							const uint32_t triangle = triangleIds[i];
+							const uint32_t bin = std::min(static_cast<uint32_t>((centroids[triangle * 3 + axis] - centroidBounds.min[axis]) * scale), binCount - 1);
+							binBounds[bin].grow(triangleBounds[triangle]);
+							binCounts[bin]++;
+						}
+						// Sweep from the right to get the area and count right of each bin boundary, then from the left evaluating the cost
+						float rightAreas[maxBinCount];
+						uint32_t rightCounts[maxBinCount];
+						Aabb rightBounds;
+						uint32_t rightCount = 0;
+						for (uint32_t bin = binCount - 1; bin > 0; bin--) {
+							rightBounds.grow(binBounds[bin]);
+							rightCount += binCounts[bin];
+							rightAreas[bin] = rightBounds.area();
+							rightCounts[bin] = rightCount;
+						}
+						Aabb leftBounds;
+						uint32_t leftCount = 0;
+						for (uint32_t bin = 1; bin < binCount; bin++) {
+							leftBounds.grow(binBounds[bin - 1]);
+							leftCount += binCounts[bin - 1];
+							if ((leftCount == 0) || (rightCounts[bin] == 0)) {
+								continue;
+							}
+							const float cost = settings.traversalCost + settings.intersectionCost * (leftBounds.area() * leftCount + rightAreas[bin] * rightCounts[bin]) / parentArea;
+							if (cost < bestCost) {
+								bestCost = cost;
+								bestAxis = axis;
+								bestBin = bin;
+							}
+						}
+					}
+
+					if (bestCost == FLT_MAX) {
+						// All centroids coincide, so binning can't separate the triangles
+						return (count <= settings.maxLeafSize) ? 0 : count / 2;
+					}
+					if ((bestCost >= settings.intersectionCost * count) && (count <= settings.maxLeafSize)) {
+						return 0;
+					}
+					const float scale = binCount / (centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis]);
+					const auto middle = std::partition(triangleIds.begin() + first, triangleIds.begin() + first + count, [&](uint32_t triangle) {
+						return std::min(static_cast<uint32_t>((centroids[triangle * 3 + bestAxis] - centroidBounds.min[bestAxis]) * scale), binCount - 1) < bestBin;
+					});
+					return static_cast<uint32_t>(middle - (triangleIds.begin() + first));
+				}
+
+				// Turns a node into a leaf or an interior node with two new children, returns the tasks for the children
+				bool subdivide(std::vector<Node>& nodes, const Task& task, Task& left, Task& right) const
+				{
+					const uint32_t leftCount = split(nodes[task.node], task.first, task.count, task.depth);
+					if (leftCount == 0) {
+						nodes[task.node].leftFirst = task.first;
+						nodes[task.node].triangleCount = task.count;
+						return false;
+					}
+					const uint32_t leftChild = static_cast<uint32_t>(nodes.size());
+					nodes[task.node].leftFirst = leftChild;
+					nodes[task.node].triangleCount = 0;
+					nodes.resize(nodes.size() + 2);
+					left = { leftChild, task.first, leftCount, task.depth + 1 };
+					right = { leftChild + 1, task.first + leftCount, task.count - leftCount, task.depth + 1 };
+					setBounds(nodes[left.node], left.first, left.count);
+					setBounds(nodes[right.node], right.first, right.count);
+					return true;
+				}
+
+				// Builds the subtree for a range with its root at index 0 of nodes, returns the depth of the deepest leaf
+				uint32_t buildSubtree(std::vector<Node>& nodes, uint32_t first, uint32_t count, uint32_t depth) const
+				{
+					nodes.reserve(count * 2);
+					nodes.resize(1);
+					setBounds(nodes[0], first, count);
+					uint32_t deepest = depth;
+					std::vector<Task> stack{ { 0, first, count, depth } };
+					while (!stack.empty()) {
+						const Task task = stack.back();
+						stack.pop_back();
+						Task left, right;
+						if (subdivide(nodes, task, left, right)) {
+							stack.push_back(right);
+							stack.push_back(left);
+						} else {
+							deepest = std::max(deepest, task.depth);
+						}
+					}
+					return deepest;
+				}
+			};
+
+			void computeStatistics(Bvh& bvh, const BuildSettings& settings)
+			{
+				Statistics& statistics = bvh.statistics;
+				statistics.nodeCount = static_cast<uint32_t>(bvh.nodes.size());
+				statistics.triangleCount = static_cast<uint32_t>(bvh.triangles.size());
+				statistics.leafCount = 0;
+				statistics.sahCost = 0.0f;
+				if (bvh.nodes.empty()) {
+					return;
+				}
+				const float rootArea = std::max(nodeArea(bvh.nodes[0]), FLT_MIN);
+				for (const Node& node : bvh.nodes) {
+					const float area = nodeArea(node) / rootArea;
+					if (node.triangleCount > 0) {
+						statistics.leafCount++;
+						statistics.sahCost += area * node.triangleCount * settings.intersectionCost;
+					} else {
+						statistics.sahCost += area * settings.traversalCost;
+					}
+				}
+			}
+
+			float dot(const float* a, const float* b)
+			{
+				return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+			}
+
+			void cross(const float* a, const float* b, float* result)
+			{
+				result[0] = a[1] * b[2] - a[2] * b[1];
+				result[1] = a[2] * b[0] - a[0] * b[2];
+				result[2] = a[0] * b[1] - a[1] * b[0];
+			}
+
+			void normalize(float* v)
+			{
+				const float length = std::sqrt(dot(v, v));
+				if (length > 0.0f) {
+					v[0] /= length;
+					v[1] /= length;
+					v[2] /= length;
+				}
+			}
+
+			// Slab test, returns the distance to the entry point or FLT_MAX if the box is missed
+			float intersectBounds(const Node& node, const float* origin, const float* inverseDirection, float tMin, float tMax)
+			{
+				for (uint32_t i = 0; i < 3; i++) {
+					const float t0 = (node.boundsMin[i] - origin[i]) * inverseDirection[i];
+					const float t1 = (node.boundsMax[i] - origin[i]) * inverseDirection[i];
+					tMin = std::max(tMin, std::min(t0, t1));
+					tMax = std::min(tMax, std::max(t0, t1));
+				}
+				return (tMin <= tMax) ? tMin : FLT_MAX;
+			}
+
+			// Möller-Trumbore, updates the hit if the triangle is closer than tMax
+			bool intersectTriangle(const Triangle& triangle, const Ray& ray, float tMax, Hit& hit)
+			{
+				float p[3], q[3], s[3];
+				cross(ray.direction, triangle.e2, p);
+				const float determinant = dot(triangle.e1, p);
+				if (std::fabs(determinant) < 1e-12f) {
+					return false;
+				}
+				const float inverseDeterminant = 1.0f / determinant;
+				s[0] = ray.origin[0] - triangle.v0[0];
+				s[1] = ray.origin[1] - triangle.v0[1];
+				s[2] = ray.origin[2] - triangle.v0[2];
+				const float u = dot(s, p) * inverseDeterminant;
+				if ((u < 0.0f) || (u > 1.0f)) {
+					return false;
+				}
+				cross(s, triangle.e1, q);
+				const float v = dot(ray.direction, q) * inverseDeterminant;
+				if ((v < 0.0f) || (u + v > 1.0f)) {
+					return false;
+				}
+				const float t = dot(triangle.e2, q) * inverseDeterminant;
+				if ((t <= ray.tMin) || (t >= tMax)) {
+					return false;
+				}
+				hit.t = t;
+				hit.u = u;
+				hit.v = v;
+				return true;
+			}
+
+			void inverse(const float* direction, float* inverseDirection)
+			{
+				for (uint32_t i = 0; i < 3; i++) {
+					// Zero components turn into infinity, which the slab test handles as long as the origin isn't exactly on a slab
+					inverseDirection[i] = 1.0f / direction[i];
+				}
+			}
+
+			// Closest hit or any hit traversal of a single ray, visiting the nearer child first
+			template<bool anyHit>
+			bool traverse(const Bvh& bvh, const Ray& ray, Hit& hit)
+			{
+				if (bvh.nodes.empty()) {
+					return false;
+				}
+				float inverseDirection[3];
+				inverse(ray.direction, inverseDirection);
+				float tMax = ray.tMax;
+				uint32_t stack[maxDepth + 1];
+				uint32_t stackSize = 0;
+				uint32_t nodeIndex = 0;
+				if (intersectBounds(bvh.nodes[0], ray.origin, inverseDirection, ray.tMin, tMax) == FLT_MAX) {
+					return false;
+				}
+				bool found = false;
+				while (true) {
+					const Node& node = bvh.nodes[nodeIndex];
+					if (node.triangleCount > 0) {
+						for (uint32_t i = node.leftFirst; i < node.leftFirst + node.triangleCount; i++) {
+							if (intersectTriangle(bvh.triangles[i], ray, tMax, hit)) {
+								if (anyHit) {
+									return true;
+								}
+								tMax = hit.t;
+								hit.triangle = bvh.triangleIds[i];
+								found = true;
+							}
+						}
+					} else {
+						uint32_t near = node.leftFirst;
+						uint32_t far = node.leftFirst + 1;
+						float tNear = intersectBounds(bvh.nodes[near], ray.origin, inverseDirection, ray.tMin, tMax);
+						float tFar = intersectBounds(bvh.nodes[far], ray.origin, inverseDirection, ray.tMin, tMax);
+						if (tFar < tNear) {
+							std::swap(near, far);
+							std::swap(tNear, tFar);
+						}
+						if (tNear != FLT_MAX) {
+							if (tFar != FLT_MAX) {
+								stack[stackSize++] = far;
+							}
+							nodeIndex = near;
+							continue;
+						}
+					}
+					// Pop the next node that may still contain a closer hit
+					if (stackSize == 0) {
+						break;
+					}
+					nodeIndex = stack[--stackSize];
+				}
+				return found;
+			}
+
+			/*
+				Four wide float vectors, mapping to SSE registers where available
+				Comparisons return lane masks, which are all bits set for true lanes in the SSE version
+			*/
+#if defined(VKS_BVH_SSE)
+			struct Float4 {
+				__m128 m;
+			};
+
+			Float4 broadcast(float value) { return { _mm_set1_ps(value) }; }
+			Float4 load(const float* values) { return { _mm_loadu_ps(values) }; }
+			void store(const Float4& a, float* values) { _mm_storeu_ps(values, a.m); }
+			Float4 operator+(const Float4& a, const Float4& b) { return { _mm_add_ps(a.m, b.m) }; }
+			Float4 operator-(const Float4& a, const Float4& b) { return { _mm_sub_ps(a.m, b.m) }; }
+			Float4 operator*(const Float4& a, const Float4& b) { return { _mm_mul_ps(a.m, b.m) }; }
+			Float4 operator/(const Float4& a, const Float4& b) { return { _mm_div_ps(a.m, b.m) }; }
+			Float4 min(const Float4& a, const Float4& b) { return { _mm_min_ps(a.m, b.m) }; }
+			Float4 max(const Float4& a, const Float4& b) { return { _mm_max_ps(a.m, b.m) }; }
+			Float4 abs(const Float4& a) { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.m) }; }
+			Float4 operator<(const Float4& a, const Float4& b) { return { _mm_cmplt_ps(a.m, b.m) }; }
+			Float4 operator<=(const Float4& a, const Float4& b) { return { _mm_cmple_ps(a.m, b.m) }; }
+			Float4 operator>(const Float4& a, const Float4& b) { return { _mm_cmpgt_ps(a.m, b.m) }; }
+			Float4 operator>=(const Float4& a, const Float4& b) { return { _mm_cmpge_ps(a.m, b.m) }; }
+			Float4 operator&(const Float4& a, const Float4& b) { return { _mm_and_ps(a.m, b.m) }; }
+			Float4 select(const Float4& mask, const Float4& a, const Float4& b) { return { _mm_or_ps(_mm_and_ps(mask.m, a.m), _mm_andnot_ps(mask.m, b.m)) }; }
+			uint32_t bits(const Float4& mask) { return static_cast<uint32_t>(_mm_movemask_ps(mask.m)); }
+#else
+			// Masks store 1 for true lanes
+			struct Float4 {
+				float f[4];
+			};
+
+			template<typename Function>
+			Float4 apply(const Float4& a, const Float4& b, Function function)
+			{
+				Float4 result;
+				for (uint32_t i = 0; i < 4; i++) {
+					result.f[i] = function(a.f[i], b.f[i]);
+				}
+				return result;
+			}
+
+			Float4 broadcast(float value) { return { { value, value, value, value } }; }
+			Float4 load(const float* values) { return { { values[0], values[1], values[2], values[3] } }; }
+			void store(const Float4& a, float* values) { memcpy(values, a.f, sizeof(a.f)); }
+			Float4 operator+(const Float4& a, const Float4& b) { return apply(a, b, [](float x, float y) { return x + y; }); }
+			Float4 operator-(const Float4& a, const Float4& b) { return apply(a, b, [](float x, float y) { return x - y; }); }
+			Float4 operator*(const Float4& a, const Float4& b) { return apply(a, b, [](float x, float y) { return x * y; }); }
+			Float4 operator/(const Float4& a, const Float4& b) { return apply(a, b, [](float x, float y) { return x / y; }); }
+			Float4 min(const Float4& a, const Float4& b) { return apply(a, b, [](float x, float y) { return (x < y) ? x : y; }); }
+			Float4 max(const Float4& a, const Float4& b) { return apply(a, b, [](float x, float y) { return (x > y) ? x : y; }); }
+			Float4 abs(const Float4& a) { return apply(a, a, [](float x, float) { return std::fabs(x); }); }
+			Float4 operator<(const Float4& a, const Float4& b) { return apply(a, b, [](float x, float y) { return (x < y) ? 1.0f : 0.0f; }); }
+			Float4 operator<=(const Float4& a, const Float4& b) { return apply(a, b, [](float x, float y) { return (x <= y) ? 1.0f : 0.0f; }); }
+			Float4 operator>(const Float4& a, const Float4& b) { return apply(a, b, [](float x, float y) { return (x > y) ? 1.0f : 0.0f; }); }
+			Float4 operator>=(const Float4& a, const Float4& b) { return apply(a, b, [](float x, float y) { return (x >= y) ? 1.0f : 0.0f; }); }
+			Float4 operator&(const Float4& a, const Float4& b) { return apply(a, b, [](float x, float y) { return ((x != 0.0f) && (y != 0.0f)) ? 1.0f : 0.0f; }); }
+			Float4 select(const Float4& mask, const Float4& a, const Float4& b)
+			{
+				Float4 result;
+				for (uint32_t i = 0; i < 4; i++) {
+					result.f[i] = (mask.f[i] != 0.0f) ? a.f[i] : b.f[i];
+				}
+				return result;
+			}
+			uint32_t bits(const Float4& mask)
+			{
+				uint32_t result = 0;
+				for (uint32_t i = 0; i < 4; i++) {
+					result |= (mask.f[i] != 0.0f) ? (1u << i) : 0u;
+				}
+				return result;
+			}
+#endif
+
+			// Rays of a packet in structure of arrays layout
+			struct Packet {
+				Float4 origin[3];
+				Float4 inverseDirection[3];
+				Float4 direction[3];
+				Float4 tMin;
+			};
+
+			// Slab test of all rays of a packet against a node, returns the entry distances with the missing lanes cleared in the mask
+			Float4 intersectBounds(const Node& node, const Packet& packet, const Float4& tMax, Float4& hitMask)
+			{
+				Float4 tEntry = packet.tMin;
+				Float4 tExit = tMax;
+				for (uint32_t i = 0; i < 3; i++) {
+					const Float4 t0 = (broadcast(node.boundsMin[i]) - packet.origin[i]) * packet.inverseDirection[i];
+					const Float4 t1 = (broadcast(node.boundsMax[i]) - packet.origin[i]) * packet.inverseDirection[i];
+					tEntry = max(tEntry, min(t0, t1));
+					tExit = min(tExit, max(t0, t1));
+				}
+				hitMask = tEntry <= tExit;
+				return tEntry;
+			}
+
+			float minimum(const Float4& values, uint32_t laneMask)
+			{
+				float lanes[4];
+				store(values, lanes);
+				float result = FLT_MAX;
+				for (uint32_t i = 0; i < 4; i++) {
+					if (laneMask & (1u << i)) {
+						result = std::min(result, lanes[i]);
+					}
+				}
+				return result;
+			}
+		}
+
+		/**
+		* Build a bounding volume hierarchy for a triangle list using the surface area heuristic evaluated at evenly spaced bins
+		*
+		* @param bvh Receives the nodes and the triangles in leaf order
+		* @param indices Triangle list
+		* @param positions Pointer to the first float of the first vertex position
+		* @param positionStride Distance between two vertex positions in bytes
+		* @param vertexCount Number of vertices
+		* @param settings Binning, leaf size and cost settings
+		*
+		* @note The upper levels are split on the calling thread until there are enough independent subtrees to keep all threads busy,
+		* the subtrees are then built as jobs of a thread pool and spliced into the node list
+		*/
+		void build(Bvh& bvh, const std::vector<uint32_t>& indices, const float* positions, size_t positionStride, size_t vertexCount, const BuildSettings& settings)
+		{
+			const auto buildStart = std::chrono::high_resolution_clock::now();
+			const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+			bvh.nodes.clear();
+			bvh.triangles.clear();
+			bvh.triangleIds.resize(triangleCount);
+			bvh.statistics = {};
+			if (triangleCount == 0) {
+				return;
+			}
+
+			std::vector<Aabb> triangleBounds(triangleCount);
+			std::vector<float> centroids(triangleCount * 3);
+			for (uint32_t i = 0; i < triangleCount; i++) {
+				for (uint32_t j = 0; j < 3; j++) {
+					assert(indices[i * 3 + j] < vertexCount);
+					triangleBounds[i].grow(position(positions, positionStride, indices[i * 3 + j]));
+				}
+				for (uint32_t j = 0; j < 3; j++) {
+					centroids[i * 3 + j] = (triangleBounds[i].min[j] + triangleBounds[i].max[j]) * 0.5f;
+				}
+			}
+			std::iota(bvh.triangleIds.begin(), bvh.triangleIds.end(), 0);
+
+			const Builder builder{ triangleBounds, centroids, settings, bvh.triangleIds };
+			const uint32_t threadCount = resolveThreadCount(settings.threadCount);
+			bvh.nodes.reserve(triangleCount * 2);
+			bvh.nodes.resize(1);
+			builder.setBounds(bvh.nodes[0], 0, triangleCount);
+
+			// Split breadth first until there are a few subtrees per thread, the remaining nodes become the roots of the parallel subtrees
+			std::deque<Builder::Task> queue{ { 0, 0, triangleCount, 0 } };
+			std::vector<Builder::Task> subtrees;
+			const size_t targetSubtreeCount = (threadCount > 1) ? threadCount * 4 : 1;
+			while (!queue.empty()) {
+				const Builder::Task task = queue.front();
+				queue.pop_front();
+				if ((task.count < parallelBuildThreshold) || (queue.size() + subtrees.size() + 1 >= targetSubtreeCount)) {
+					subtrees.push_back(task);
+					continue;
+				}
+				Builder::Task left, right;
+				if (builder.subdivide(bvh.nodes, task, left, right)) {
+					queue.push_back(left);
+					queue.push_back(right);
+				} else {
+					bvh.statistics.maxDepth = std::max(bvh.statistics.maxDepth, task.depth);
+				}
+			}
+
+			std::vector<std::vector<Node>> subtreeNodes(subtrees.size());
+			std::vector<uint32_t> subtreeDepths(subtrees.size());
+			if (subtrees.size() == 1) {
+				subtreeDepths[0] = builder.buildSubtree(subtreeNodes[0], subtrees[0].first, subtrees[0].count, subtrees[0].depth);
+			} else {
+				vks::ThreadPool threadPool;
+				threadPool.setThreadCount(std::min(threadCount, static_cast<uint32_t>(subtrees.size())));
+				// Largest subtrees first, so the small ones fill the gaps at the end
+				std::vector<uint32_t> order(subtrees.size());
+				std::iota(order.begin(), order.end(), 0);
+				std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return subtrees[a].count > subtrees[b].count; });
+				for (size_t i = 0; i < order.size(); i++) {
+					const uint32_t index = order[i];
+					threadPool.threads[i % threadPool.threads.size()]->addJob([&, index] {
+						const Builder::Task& task = subtrees[index];
+						subtreeDepths[index] = builder.buildSubtree(subtreeNodes[index], task.first, task.count, task.depth);
+					});
+				}
+				threadPool.wait();
+			}
+
+			// Subtree roots take the place of their task's node, the other nodes are appended with their child indices rebased
+			for (size_t i = 0; i < subtrees.size(); i++) {
+				const std::vector<Node>& nodes = subtreeNodes[i];
+				const uint32_t base = static_cast<uint32_t>(bvh.nodes.size()) - 1;
+				for (size_t j = 0; j < nodes.size(); j++) {
+					Node node = nodes[j];
+					if (node.triangleCount == 0) {
+						node.leftFirst += base;
+					}
+					if (j == 0) {
+						bvh.nodes[subtrees[i].node] = node;
+					} else {
+						bvh.nodes.push_back(node);
+					}
+				}
+				bvh.statistics.maxDepth = std::max(bvh.statistics.maxDepth, subtreeDepths[i]);
+			}
+
+			bvh.triangles.resize(triangleCount);
+			for (uint32_t i = 0; i < triangleCount; i++) {
+				const uint32_t triangle = bvh.triangleIds[i];
+				const float* v0 = position(positions, positionStride, indices[triangle * 3]);
+				const float* v1 = position(positions, positionStride, indices[triangle * 3 + 1]);
+				const float* v2 = position(positions, positionStride, indices[triangle * 3 + 2]);
+				for (uint32_t j = 0; j < 3; j++) {
+					bvh.triangles[i].v0[j] = v0[j];
+					bvh.triangles[i].e1[j] = v1[j] - v0[j];
+					bvh.triangles[i].e2[j] = v2[j] - v0[j];
+				}
+			}
+
+			computeStatistics(bvh, settings);
+			bvh.statistics.buildTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - buildStart).count();
+		}
+
+		/**
+		* Find the closest intersection of a ray between its tMin and tMax
+		*
+		* @return True if a triangle was hit, the hit is only written in that case
+		*/
+		bool intersect(const Bvh& bvh, const Ray& ray, Hit& hit)
+		{
+			Hit closest;
+			if (!traverse<false>(bvh, ray, closest)) {
+				return false;
+			}
+			hit = closest;
+			return true;
+		}
+
+		/**
+		* Check if any triangle is hit between the ray's tMin and tMax, stops at the first hit found (e.g. for shadow rays)
+		*/
+		bool occluded(const Bvh& bvh, const Ray& ray)
+		{
+			Hit hit;
+			return traverse<true>(bvh, ray, hit);
+		}
+
+		/**
+		* Find the closest intersections of packetSize rays traversing the hierarchy together
+		*
+		* @param rays Array of packetSize rays
+		* @param hits Receives the closest hit of each ray, misses have their triangle set to invalidTriangle
+		*
+		* @note A node is visited if any ray of the packet hits it, so the packet works best for coherent rays like primary rays of neighbouring pixels
+		*/
+		void intersectPacket(const Bvh& bvh, const Ray* rays, Hit* hits)
+		{
+			for (uint32_t i = 0; i < packetSize; i++) {
+				hits[i] = {};
+			}
+			if (bvh.nodes.empty()) {
+				return;
+			}
+
+			Packet packet;
+			float lanes[3][4];
+			for (uint32_t axis = 0; axis < 3; axis++) {
+				for (uint32_t i = 0; i < packetSize; i++) {
+					lanes[axis][i] = rays[i].origin[axis];
+				}
+				packet.origin[axis] = load(lanes[axis]);
+				for (uint32_t i = 0; i < packetSize; i++) {
+					lanes[axis][i] = rays[i].direction[axis];
+				}
+				packet.direction[axis] = load(lanes[axis]);
+				packet.inverseDirection[axis] = broadcast(1.0f) / packet.direction[axis];
+			}
+			const float tMins[4] = { rays[0].tMin, rays[1].tMin, rays[2].tMin, rays[3].tMin };
+			const float tMaxs[4] = { rays[0].tMax, rays[1].tMax, rays[2].tMax, rays[3].tMax };
+			packet.tMin = load(tMins);
+			Float4 tMax = load(tMaxs);
+			Float4 u = broadcast(0.0f);
+			Float4 v = broadcast(0.0f);
+
+			// Nodes are pushed with the lanes that hit them, lanes are dropped again once a closer hit has been found
+			struct StackEntry {
+				uint32_t node;
+				float tEntry;
+			};
+			StackEntry stack[maxDepth + 1];
+			uint32_t stackSize = 0;
+			Float4 hitMask;
+			const Float4 rootEntry = intersectBounds(bvh.nodes[0], packet, tMax, hitMask);
+			if (bits(hitMask) == 0) {
+				return;
+			}
+			stack[stackSize++] = { 0, minimum(rootEntry, bits(hitMask)) };
+
+			const Float4 epsilon = broadcast(1e-12f);
+			const Float4 zero = broadcast(0.0f);
+			const Float4 one = broadcast(1.0f);
+			while (stackSize > 0) {
+				const StackEntry entry = stack[--stackSize];
+				const Node& node = bvh.nodes[entry.node];
+				// Skip nodes entered behind the closest hits of all rays
+				if (bits(broadcast(entry.tEntry) <= tMax) == 0) {
+					continue;
+				}
+				if (node.triangleCount > 0) {
+					for (uint32_t i = node.leftFirst; i < node.leftFirst + node.triangleCount; i++) {
+						// Möller-Trumbore for all lanes at once
+						const Triangle& triangle = bvh.triangles[i];
+						const Float4 e1[3] = { broadcast(triangle.e1[0]), broadcast(triangle.e1[1]), broadcast(triangle.e1[2]) };
+						const Float4 e2[3] = { broadcast(triangle.e2[0]), broadcast(triangle.e2[1]), broadcast(triangle.e2[2]) };
+						const Float4* d = packet.direction;
+						const Float4 p[3] = { d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0] };
+						const Float4 determinant = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+						const Float4 inverseDeterminant = one / determinant;
+						const Float4 s[3] = { packet.origin[0] - broadcast(triangle.v0[0]), packet.origin[1] - broadcast(triangle.v0[1]), packet.origin[2] - broadcast(triangle.v0[2]) };
+						const Float4 hitU = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inverseDeterminant;
+						const Float4 q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+						const Float4 hitV = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inverseDeterminant;
+						const Float4 t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inverseDeterminant;
+						const Float4 mask = (abs(determinant) > epsilon) & (hitU >= zero) & (hitV >= zero) & (hitU + hitV <= one) & (t > packet.tMin) & (t < tMax);
+						const uint32_t laneMask = bits(mask);
+						if (laneMask == 0) {
+							continue;
+						}
+						tMax = select(mask, t, tMax);
+						u = select(mask, hitU, u);
+						v = select(mask, hitV, v);
+						for (uint32_t lane = 0; lane < packetSize; lane++) {
+							if (laneMask & (1u << lane)) {
+								hits[lane].triangle = bvh.triangleIds[i];
+							}
+						}
+					}
+					continue;
+				}
+				Float4 leftMask, rightMask;
+				const Float4 leftEntry = intersectBounds(bvh.nodes[node.leftFirst], packet, tMax, leftMask);
+				const Float4 rightEntry = intersectBounds(bvh.nodes[node.leftFirst + 1], packet, tMax, rightMask);
+				const uint32_t leftLanes = bits(leftMask);
+				const uint32_t rightLanes = bits(rightMask);
+				StackEntry left = { node.leftFirst, minimum(leftEntry, leftLanes) };
+				StackEntry right = { node.leftFirst + 1, minimum(rightEntry, rightLanes) };
+				// Push the farther child first, so the nearer one is visited next
+				if (left.tEntry < right.tEntry) {
+					std::swap(left, right);
+				}
+				if (left.tEntry != FLT_MAX) {
+					stack[stackSize++] = left;
+				}
+				if (right.tEntry != FLT_MAX) {
+					stack[stackSize++] = right;
+				}
+			}
+
+			float tValues[4], uValues[4], vValues[4];
+			store(tMax, tValues);
+			store(u, uValues);
+			store(v, vValues);
+			for (uint32_t i = 0; i < packetSize; i++) {
+				if (hits[i].triangle != invalidTriangle) {
+					hits[i].t = tValues[i];
+					hits[i].u = uValues[i];
+					hits[i].v = vValues[i];
+				}
+			}
+		}
+
+		/**
+		* Place a camera in front of the bounds of the hierarchy, looking down the negative z axis with all of it in view
+		*/
+		Camera fitCamera(const Bvh& bvh, float fovY)
+		{
+			Camera camera{ { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, fovY };
+			if (bvh.nodes.empty()) {
+				return camera;
+			}
+			const Node& root = bvh.nodes[0];
+			float radius = 0.0f;
+			for (uint32_t i = 0; i < 3; i++) {
+				camera.target[i] = (root.boundsMin[i] + root.boundsMax[i]) * 0.5f;
+				radius = std::max(radius, (root.boundsMax[i] - root.boundsMin[i]) * 0.5f);
+			}
+			const float distance = radius / std::tan(fovY * 0.5f * 3.14159265f / 180.0f) + radius;
+			camera.position[0] = camera.target[0];
+			camera.position[1] = camera.target[1];
+			camera.position[2] = camera.target[2] + distance;
+			return camera;
+		}
+
+		namespace
+		{
+			struct CameraBasis {
+				float origin[3];
+				float forward[3];
+				float right[3];
+				float up[3];
+			};
+
+			CameraBasis cameraBasis(const Camera& camera, uint32_t width, uint32_t height)
+			{
+				CameraBasis basis;
+				memcpy(basis.origin, camera.position, sizeof(basis.origin));
+				for (uint32_t i = 0; i < 3; i++) {
+					basis.forward[i] = camera.target[i] - camera.position[i];
+				}
+				normalize(basis.forward);
+				cross(basis.forward, camera.up, basis.right);
+				normalize(basis.right);
+				cross(basis.right, basis.forward, basis.up);
+				// Scale the axes to the extent of the image plane at distance 1
+				const float tanHalfFov = std::tan(camera.fovY * 0.5f * 3.14159265f / 180.0f);
+				const float aspect = static_cast<float>(width) / static_cast<float>(height);
+				for (uint32_t i = 0; i < 3; i++) {
+					basis.right[i] *= tanHalfFov * aspect;
+					basis.up[i] *= tanHalfFov;
+				}
+				return basis;
+			}
+
+			Ray primaryRay(const CameraBasis& basis, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+			{
+				const float ndcX = (2.0f * (x + 0.5f) / width) - 1.0f;
+				const float ndcY = 1.0f - (2.0f * (y + 0.5f) / height);
+				Ray ray;
+				memcpy(ray.origin, basis.origin, sizeof(ray.origin));
+				for (uint32_t i = 0; i < 3; i++) {
+					ray.direction[i] = basis.forward[i] + basis.right[i] * ndcX + basis.up[i] * ndcY;
+				}
+				ray.tMin = 0.0f;
+				ray.tMax = FLT_MAX;
+				return ray;
+			}
+
+			/*
+				Traces the primary rays of an image in 2x2 pixel packets, rows of packets are distributed over the threads of a thread pool
+				Pixels outside of the image (for odd sizes) are traced but not passed to the callback
+			*/
+			template<typename Function>
+			void tracePrimaryRays(const Bvh& bvh, const Camera& camera, uint32_t width, uint32_t height, uint32_t threadCount, Function function)
+			{
+				const CameraBasis basis = cameraBasis(camera, width, height);
+				const uint32_t packetRows = (height + 1) / 2;
+				auto traceRows = [&](uint32_t firstRow, uint32_t rowStep) {
+					for (uint32_t row = firstRow; row < packetRows; row += rowStep) {
+						for (uint32_t column = 0; column < width; column += 2) {
+							const uint32_t xs[4] = { column, column + 1, column, column + 1 };
+							const uint32_t ys[4] = { row * 2, row * 2, row * 2 + 1, row * 2 + 1 };
+							Ray rays[packetSize];
+							Hit hits[packetSize];
+							for (uint32_t i = 0; i < packetSize; i++) {
+								rays[i] = primaryRay(basis, xs[i], ys[i], width, height);
+							}
+							intersectPacket(bvh, rays, hits);
+							for (uint32_t i = 0; i < packetSize; i++) {
+								if ((xs[i] < width) && (ys[i] < height)) {
+									function(xs[i], ys[i], rays[i], hits[i]);
+								}
+							}
+						}
+					}
+				};
+				if (threadCount == 1) {
+					traceRows(0, 1);
+					return;
+				}
+				vks::ThreadPool threadPool;
+				threadPool.setThreadCount(threadCount);
+				for (uint32_t i = 0; i < threadCount; i++) {
+					threadPool.threads[i]->addJob([&traceRows, i, threadCount] { traceRows(i, threadCount); });
+				}
+				threadPool.wait();
+			}
+		}
+
+		/**
+		* Render an image of the triangles as seen from a camera, shaded by the angle between the geometric normal and the view direction
+		*
+		* @param rgba Receives width * height RGBA8 pixels, top row first
+		*
+		* @note The result only depends on the geometry and the camera, not on the number of threads or the traversal order,
+		* which makes it usable as a golden image to compare the output of the GPU ray tracing samples against
+		*/
+		void render(const Bvh& bvh, const Camera& camera, uint32_t width, uint32_t height, std::vector<uint8_t>& rgba, uint32_t threadCount)
+		{
+			rgba.assign(static_cast<size_t>(width) * height * 4, 0);
+			// Hits report the source triangle, the edges are looked up through its position in leaf order
+			std::vector<uint32_t> leafOrder(bvh.triangleIds.size());
+			for (uint32_t i = 0; i < bvh.triangleIds.size(); i++) {
+				leafOrder[bvh.triangleIds[i]] = i;
+			}
+			tracePrimaryRays(bvh, camera, width, height, resolveThreadCount(threadCount), [&](uint32_t x, uint32_t y, const Ray& ray, const Hit& hit) {
+				uint8_t* pixel = &rgba[(static_cast<size_t>(y) * width + x) * 4];
+				pixel[3] = 255;
+				if (hit.triangle == invalidTriangle) {
+					return;
+				}
+				const Triangle& triangle = bvh.triangles[leafOrder[hit.triangle]];
+				float normal[3];
+				cross(triangle.e1, triangle.e2, normal);
+				normalize(normal);
+				float direction[3] = { ray.direction[0], ray.direction[1], ray.direction[2] };
+				normalize(direction);
+				// Two sided, so the result doesn't depend on the winding order
+				const float shade = 0.1f + 0.9f * std::fabs(dot(normal, direction));
+				const uint8_t value = static_cast<uint8_t>(std::min(shade, 1.0f) * 255.0f + 0.5f);
+				pixel[0] = value;
+				pixel[1] = value;
+				pixel[2] = value;
+			});
+		}
+
+		/**
+		* Measure the ray throughput of the packet traversal by repeatedly tracing the primary rays of an image
+		*
+		* @param iterations Number of times the image is traced, the time of all iterations is measured
+		* @param threadCount Number of threads tracing rays, 0 uses all hardware threads
+		*
+		* @note Primary rays are the most coherent rays, so this is an upper bound for the throughput of secondary rays
+		*/
+		BenchmarkResult benchmark(const Bvh& bvh, const Camera& camera, uint32_t width, uint32_t height, uint32_t iterations, uint32_t threadCount)
+		{
+			BenchmarkResult result;
+			result.threadCount = resolveThreadCount(threadCount);
+			std::vector<uint32_t> hitCounts(height, 0);
+			const auto start = std::chrono::high_resolution_clock::now();
+			for (uint32_t i = 0; i < iterations; i++) {
+				// Count hits per row, so the traversal can't be optimized away
+				tracePrimaryRays(bvh, camera, width, height, result.threadCount, [&](uint32_t, uint32_t y, const Ray&, const Hit& hit) {
+					hitCounts[y] += (hit.triangle != invalidTriangle) ? 1 : 0;
+				});
+			}
+			result.time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			result.rayCount = static_cast<uint64_t>(width) * height * iterations;
+			if (result.time > 0.0) {
+				result.mraysPerSecond = result.rayCount / (result.time * 1000.0);
+				result.mraysPerSecondPerThread = result.mraysPerSecond / result.threadCount;
+			}
+			return result;
+		}
+	}
+}
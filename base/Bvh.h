@@ -0,0 +1,123 @@
+/*
+* CPU bounding volume hierarchy
+*
+* Binned SAH builder parallelized over the thread pool, single ray and SIMD packet traversal kernels, a reference renderer for golden images
+* and a ray throughput benchmark, working on the same triangle lists used for rasterization and hardware ray tracing
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cfloat>
+
+/*
+	This header has no Vulkan dependency, so it can also be used by command line tools and on machines without ray tracing hardware
+	Triangle lists are passed as indices into a vertex range of vertexCount vertices
+	Positions are passed as a pointer to the first float of the first position plus the stride between positions in bytes
+*/
+namespace vks
+{
+	namespace bvh
+	{
+		/** @brief Number of bins the centroid range of a node is split into on each axis when evaluating the surface area heuristic */
+		const uint32_t defaultBinCount = 16;
+		/** @brief Nodes with more triangles than this are always split */
+		const uint32_t defaultMaxLeafSize = 4;
+		/** @brief Number of rays traced together by intersectPacket, matches the width of the SIMD registers used (SSE) */
+		const uint32_t packetSize = 4;
+		const uint32_t invalidTriangle = ~0u;
+
+		struct BuildSettings {
+			uint32_t binCount = defaultBinCount;
+			uint32_t maxLeafSize = defaultMaxLeafSize;
+			// Relative costs of visiting a node and intersecting a triangle used by the surface area heuristic
+			float traversalCost = 1.0f;
+			float intersectionCost = 1.0f;
+			// 0 uses all hardware threads
+			uint32_t threadCount = 0;
+		};
+
+		// Nodes are 32 bytes, so two of them share a cache line, the children of an interior node are stored next to each other
+		struct Node {
+			float boundsMin[3];
+			// Interior nodes: Index of the left child (the right child follows it), leaves: Index of the first triangle
+			uint32_t leftFirst;
+			float boundsMax[3];
+			// 0 for interior nodes
+			uint32_t triangleCount;
+		};
+
+		// Triangles are stored in leaf order with precomputed edges for the intersection test
+		struct Triangle {
+			float v0[3];
+			float e1[3];
+			float e2[3];
+		};
+
+		struct Statistics {
+			uint32_t nodeCount = 0;
+			uint32_t leafCount = 0;
+			uint32_t triangleCount = 0;
+			uint32_t maxDepth = 0;
+			// Expected cost of tracing a ray relative to intersecting a single triangle, lower is better
+			float sahCost = 0.0f;
+			// Build time in milliseconds
+			double buildTime = 0.0;
+		};
+
+		struct Bvh {
+			std::vector<Node> nodes;
+			std::vector<Triangle> triangles;
+			// Index of each triangle in triangles into the source triangle list (the first index of a triangle divided by three)
+			std::vector<uint32_t> triangleIds;
+			Statistics statistics;
+		};
+
+		struct Ray {
+			float origin[3];
+			float tMin;
+			float direction[3];
+			float tMax;
+		};
+
+		struct Hit {
+			float t = FLT_MAX;
+			// Barycentric coordinates of the hit relative to the second and third vertex of the triangle
+			float u = 0.0f;
+			float v = 0.0f;
+			// Index into the source triangle list, invalidTriangle if nothing was hit
+			uint32_t triangle = invalidTriangle;
+		};
+
+		struct Camera {
+			float position[3];
+			float target[3];
+			float up[3];
+			// Vertical field of view in degrees
+			float fovY;
+		};
+
+		struct BenchmarkResult {
+			uint64_t rayCount = 0;
+			// Time spent tracing in milliseconds
+			double time = 0.0;
+			uint32_t threadCount = 0;
+			double mraysPerSecond = 0.0;
+			double mraysPerSecondPerThread = 0.0;
+		};
+
+		void build(Bvh& bvh, const std::vector<uint32_t>& indices, const float* positions, size_t positionStride, size_t vertexCount, const BuildSettings& settings = {});
+		bool intersect(const Bvh& bvh, const Ray& ray, Hit& hit);
+		bool occluded(const Bvh& bvh, const Ray& ray);
+		void intersectPacket(const Bvh& bvh, const Ray* rays, Hit* hits);
+		Camera fitCamera(const Bvh& bvh, float fovY = 60.0f);
+		void render(const Bvh& bvh, const Camera& camera, uint32_t width, uint32_t height, std::vector<uint8_t>& rgba, uint32_t threadCount = 0);
+		BenchmarkResult benchmark(const Bvh& bvh, const Camera& camera, uint32_t width, uint32_t height, uint32_t iterations, uint32_t threadCount = 0);
+	}
+}
@@ -27,7 +27,9 @@ int APIENTRY WinMain(_In_ HINSTANCE hInstance, _In_opt_  HINSTANCE hPrevInstance
 	for (int32_t i = 0; i < __argc; i++) { VulkanExample::args.push_back(__argv[i]); };  			\
 	vulkanExample = new VulkanExample();															\
 	vulkanExample->initVulkan();																	\
-	vulkanExample->setupWindow(hInstance, WndProc);													\
+	if (!vulkanExample->m_exampleSettings.m_headless) {												\
+		vulkanExample->setupWindow(hInstance, WndProc);												\
+	}																								\
 	vulkanExample->prepare();																		\
 	vulkanExample->renderLoop();																	\
 	delete(vulkanExample);																			\
@@ -90,7 +92,9 @@ int main(const int argc, const char *argv[])													    \
 	for (size_t i = 0; i < argc; i++) { VulkanExample::args.push_back(argv[i]); };  				\
 	vulkanExample = new VulkanExample();															\
 	vulkanExample->initVulkan();																	\
-	vulkanExample->setupWindow();					 												\
+	if (!vulkanExample->m_exampleSettings.m_headless) {												\
+		vulkanExample->setupWindow();																\
+	}																								\
 	vulkanExample->prepare();																		\
 	vulkanExample->renderLoop();																	\
 	delete(vulkanExample);																			\
@@ -108,7 +112,9 @@ int main(const int argc, const char *argv[])													    \
 	for (size_t i = 0; i < argc; i++) { VulkanExample::args.push_back(argv[i]); };  				\
 	vulkanExample = new VulkanExample();															\
 	vulkanExample->initVulkan();																	\
-	vulkanExample->setupWindow();					 												\
+	if (!vulkanExample->m_exampleSettings.m_headless) {												\
+		vulkanExample->setupWindow();																\
+	}																								\
 	vulkanExample->prepare();																		\
 	vulkanExample->renderLoop();																	\
 	delete(vulkanExample);																			\
@@ -133,7 +139,9 @@ int main(const int argc, const char *argv[])													    \
 	for (size_t i = 0; i < argc; i++) { VulkanExample::args.push_back(argv[i]); };  				\
 	vulkanExample = new VulkanExample();															\
 	vulkanExample->initVulkan();																	\
-	vulkanExample->setupWindow();					 												\
+	if (!vulkanExample->m_exampleSettings.m_headless) {												\
+		vulkanExample->setupWindow();																\
+	}																								\
 	vulkanExample->prepare();																		\
 	vulkanExample->renderLoop();																	\
 	delete(vulkanExample);																			\
@@ -176,7 +184,9 @@ int main(const int argc, const char *argv[])														\
 	for (int i = 0; i < argc; i++) { VulkanExample::args.push_back(argv[i]); };						\
 	vulkanExample = new VulkanExample();															\
 	vulkanExample->initVulkan();																	\
-	vulkanExample->setupWindow();																	\
+	if (!vulkanExample->m_exampleSettings.m_headless) {												\
+		vulkanExample->setupWindow();																\
+	}																								\
 	vulkanExample->prepare();																		\
 	vulkanExample->renderLoop();																	\
 	delete(vulkanExample);																			\
@@ -0,0 +1,1047 @@
+/*
+* Mesh optimization
+*
+* Load time vertex deduplication, triangle reordering for vertex cache efficiency and overdraw and vertex reordering for fetch locality,
+* quadric error metric simplification for level of detail generation, meshlet building for mesh shading, plus CPU side analysis of the results
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+#include "MeshOptimizer.h"
+
+namespace vks
+{
+	namespace meshoptimizer
+	{
+		namespace
+		{
+			const uint32_t invalidIndex = ~0u;
+
+			const float* position(const float* positions, size_t positionStride, uint32_t index)
+			{
+				return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + index * positionStride);
+			}
+
+			// FNV-1a over the raw vertex data
+			uint32_t hashVertex(const uint8_t* data, size_t size)
+			{
+				uint32_t hash = 2166136261u;
+				for (size_t i = 0; i < size; i++) {
+					hash = (hash ^ data[i]) * 16777619u;
+				}
+				return hash;
+			}
+
+			/*
+				FIFO cache simulation using per vertex timestamps, a vertex is in the cache if it has been inserted within the last cacheSize misses
+				Resetting the cache only requires advancing the timestamp past the cache size
+			*/
+			struct FifoCache {
+				std::vector<uint32_t> timestamps;
+				uint32_t timestamp;
+				uint32_t cacheSize;
+
+				FifoCache(size_t vertexCount, uint32_t cacheSize) : timestamps(vertexCount, 0), timestamp(cacheSize + 1), cacheSize(cacheSize) {}
+
+				uint32_t update(uint32_t a, uint32_t b, uint32_t c)
+				{
+					uint32_t misses = 0;
+					for (uint32_t vertex : { a, b, c }) {
+						if (timestamp - timestamps[vertex] > cacheSize) {
+							timestamps[vertex] = timestamp++;
+							misses++;
+						}
+					}
+					return misses;
+				}
+
+				void reset()
+				{
+					timestamp += cacheSize + 1;
+				}
+			};
+
+			/*
+				Vertex scoring from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+			*/
+			const uint32_t forsythCacheSize = 32;
+
+			float forsythVertexScore(int32_t cachePosition, uint32_t liveTriangles)
+			{
+				if (liveTriangles == 0) {
+					return -1.0f;
+				}
+				float score = 0.0f;
+				if (cachePosition >= 0) {
+					// The last triangle's vertices get a fixed score, so it isn't favorable to use them again right away
+					if (cachePosition < 3) {
+						score = 0.75f;
+					} else {
+						score = std::pow(1.0f - static_cast<float>(cachePosition - 3) / static_cast<float>(forsythCacheSize - 3), 1.5f);
+					}
+				}
+				// Favor vertices with few remaining triangles, so they can leave the cache early
+				score += 2.0f / std::sqrt(static_cast<float>(liveTriangles));
+				return score;
+			}
+
+			/*
+				Symmetric 4x4 quadric of the squared distance to a set of planes (Garland, Heckbert 1997), weighted by triangle area
+				Dividing by the accumulated weight turns the error into the area weighted mean of the squared plane distances
+			*/
+			struct Quadric {
+				float a00 = 0.0f, a11 = 0.0f, a22 = 0.0f, a01 = 0.0f, a02 = 0.0f, a12 = 0.0f;
+				float b0 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+				float c = 0.0f;
+				float weight = 0.0f;
+
+				void addPlane(const float n[3], float d, float w)
+				{
+					a00 += w * n[0] * n[0];
+					a11 += w * n[1] * n[1];
+					a22 += w * n[2] * n[2];
+					a01 += w * n[0] * n[1];
+					a02 += w * n[0] * n[2];
+					a12 += w * n[1] * n[2];
+					b0 += w * n[0] * d;
+					b1 += w * n[1] * d;
+					b2 += w * n[2] * d;
+					c += w * d * d;
+					weight += w;
+				}
+
+				void add(const Quadric& other)
+				{
+					a00 += other.a00; a11 += other.a11; a22 += other.a22;
+					a01 += other.a01; a02 += other.a02; a12 += other.a12;
+					b0 += other.b0; b1 += other.b1; b2 += other.b2;
+					c += other.c;
+					weight += other.weight;
+				}
+
+				float error(const float p[3]) const
+				{
+					const float x = p[0], y = p[1], z = p[2];
+					const float e = a00 * x * x + a11 * y * y + a22 * z * z + 2.0f * (a01 * x * y + a02 * x * z + a12 * y * z) + 2.0f * (b0 * x + b1 * y + b2 * z) + c;
+					return weight > 0.0f ? std::fabs(e) / weight : 0.0f;
+				}
+			};
+
+			void triangleNormal(const float* p0, const float* p1, const float* p2, float n[3])
+			{
+				const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+				const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+				n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+				n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+				n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+			}
+
+			// Rasterizes triangles along one axis and direction into a depth buffer, counting every pixel that passes the depth test
+			const int32_t overdrawGridSize = 256;
+
+			void rasterizeOverdraw(std::vector<float>& depthBuffer, const std::vector<float>& triangles, bool reverse, uint32_t& pixelsShaded)
+			{
+				std::fill(depthBuffer.begin(), depthBuffer.end(), 1.0f);
+				for (size_t t = 0; t < triangles.size(); t += 9) {
+					float v[3][3];
+					for (uint32_t i = 0; i < 3; i++) {
+						// Looking along the axis the projected image is mirrored, swapping the coordinates keeps counter clockwise triangles front facing
+						// The reverse direction looks from the other side, so it inverts depth and doesn't need the swap
+						v[i][0] = reverse ? triangles[t + i * 3 + 0] : triangles[t + i * 3 + 1];
+						v[i][1] = reverse ? triangles[t + i * 3 + 1] : triangles[t + i * 3 + 0];
+						v[i][2] = reverse ? 1.0f - triangles[t + i * 3 + 2] : triangles[t + i * 3 + 2];
+					}
+					const float area = (v[1][0] - v[0][0]) * (v[2][1] - v[0][1]) - (v[2][0] - v[0][0]) * (v[1][1] - v[0][1]);
+					// Back faces and degenerate triangles are culled
+					if (area <= 0.0f) {
+						continue;
+					}
+					const int32_t minX = std::max(static_cast<int32_t>(std::min({ v[0][0], v[1][0], v[2][0] })), 0);
+					const int32_t minY = std::max(static_cast<int32_t>(std::min({ v[0][1], v[1][1], v[2][1] })), 0);
+					const int32_t maxX = std::min(static_cast<int32_t>(std::max({ v[0][0], v[1][0], v[2][0] })) + 1, overdrawGridSize - 1);
+					const int32_t maxY = std::min(static_cast<int32_t>(std::max({ v[0][1], v[1][1], v[2][1] })) + 1, overdrawGridSize - 1);
+					for (int32_t y = minY; y <= maxY; y++) {
+						for (int32_t x = minX; x <= maxX; x++) {
+							// Edge functions at the pixel center
+							const float px = static_cast<float>(x) + 0.5f;
+							const float py = static_cast<float>(y) + 0.5f;
+							const float w0 = (v[2][0] - v[1][0]) * (py - v[1][1]) - (v[2][1] - v[1][1]) * (px - v[1][0]);
+							const float w1 = (v[0][0] - v[2][0]) * (py - v[2][1]) - (v[0][1] - v[2][1]) * (px - v[2][0]);
+							const float w2 = (v[1][0] - v[0][0]) * (py - v[0][1]) - (v[1][1] - v[0][1]) * (px - v[0][0]);
+							if ((w0 < 0.0f) || (w1 < 0.0f) || (w2 < 0.0f)) {
+								continue;
+							}
+							const float depth = (w0 * v[0][2] + w1 * v[1][2] + w2 * v[2][2]) / area;
+							float& storedDepth = depthBuffer[y * overdrawGridSize + x];
+							if (depth <= storedDepth) {
+								storedDepth = depth;
+								pixelsShaded++;
+							}
+						}
+					}
+				}
+			}
+		}
+
+		/**
+		* Generate a remap table that maps all bitwise identical vertices to the same new index
+		*
+		* @param remap Receives the new index of each vertex, vertices not referenced by the indices are mapped to ~0
+		* @param indices Triangle list to deduplicate
+		* @param vertices Pointer to the vertex data
+		* @param vertexCount Number of vertices
+		* @param vertexSize Size of a single vertex in bytes
+		*
+		* @return Number of unique vertices
+		*/
+		size_t generateVertexRemap(std::vector<uint32_t>& remap, const std::vector<uint32_t>& indices, const void* vertices, size_t vertexCount, size_t vertexSize)
+		{
+			const uint8_t* data = static_cast<const uint8_t*>(vertices);
+			remap.assign(vertexCount, invalidIndex);
+			// Open addressing hash table with linear probing, sized to a power of two with a load factor below 0.5
+			size_t tableSize = 16;
+			while (tableSize < vertexCount * 2) {
+				tableSize *= 2;
+			}
+			std::vector<uint32_t> table(tableSize, invalidIndex);
+			uint32_t uniqueCount = 0;
+			for (uint32_t index : indices) {
+				assert(index < vertexCount);
+				if (remap[index] != invalidIndex) {
+					continue;
+				}
+				const uint8_t* vertex = data + index * vertexSize;
+				size_t bucket = hashVertex(vertex, vertexSize) & (tableSize - 1);
+				while ((table[bucket] != invalidIndex) && (memcmp(data + table[bucket] * vertexSize, vertex, vertexSize) != 0)) {
+					bucket = (bucket + 1) & (tableSize - 1);
+				}
+				if (table[bucket] == invalidIndex) {
+					table[bucket] = index;
+					remap[index] = uniqueCount++;
+				} else {
+					remap[index] = remap[table[bucket]];
+				}
+			}
+			return uniqueCount;
+		}
+
+		/**
+		* Replace all indices with their entries in a remap table
+		*/
+		void remapIndices(std::vector<uint32_t>& indices, const std::vector<uint32_t>& remap)
+		{
+			for (uint32_t& index : indices) {
+				assert(remap[index] != invalidIndex);
+				index = remap[index];
+			}
+		}
+
+		/**
+		* Move vertices to their new position from a remap table, vertices mapped to ~0 are dropped
+		*
+		* @param destination Receives the remapped vertices, needs to be large enough for the number of unique vertices and must not overlap the source
+		*/
+		void remapVertices(void* destination, const void* vertices, size_t vertexCount, size_t vertexSize, const std::vector<uint32_t>& remap)
+		{
+			for (size_t i = 0; i < vertexCount; i++) {
+				if (remap[i] != invalidIndex) {
+					memcpy(static_cast<uint8_t*>(destination) + remap[i] * vertexSize, static_cast<const uint8_t*>(vertices) + i * vertexSize, vertexSize);
+				}
+			}
+		}
+
+		/**
+		* Reorder triangles for post transform vertex cache efficiency
+		*
+		* @note Uses Tom Forsyth's linear speed algorithm, which doesn't depend on the exact cache size of the GPU
+		*/
+		void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+		{
+			const size_t triangleCount = indices.size() / 3;
+			if (triangleCount == 0) {
+				return;
+			}
+
+			// Per vertex lists of triangles that haven't been emitted yet
+			std::vector<uint32_t> liveTriangles(vertexCount, 0);
+			for (uint32_t index : indices) {
+				liveTriangles[index]++;
+			}
+			std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+			for (size_t i = 0; i < vertexCount; i++) {
+				adjacencyOffsets[i + 1] = adjacencyOffsets[i] + liveTriangles[i];
+			}
+			std::vector<uint32_t> adjacency(indices.size());
+			std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++) {
+				adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+
+			std::vector<int32_t> cachePositions(vertexCount, -1);
+			std::vector<float> vertexScores(vertexCount);
+			for (size_t i = 0; i < vertexCount; i++) {
+				vertexScores[i] = forsythVertexScore(-1, liveTriangles[i]);
+			}
+			std::vector<float> triangleScores(triangleCount);
+			for (size_t t = 0; t < triangleCount; t++) {
+				triangleScores[t] = vertexScores[indices[t * 3 + 0]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+			}
+			std::vector<bool> emitted(triangleCount, false);
+
+			std::vector<uint32_t> cache, newCache;
+			cache.reserve(forsythCacheSize + 3);
+			newCache.reserve(forsythCacheSize + 3);
+			std::vector<uint32_t> result;
+			result.reserve(indices.size());
+
+			uint32_t bestTriangle = 0;
+			size_t nextCandidate = 0;
+			for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+				if (bestTriangle == invalidIndex) {
+					// No triangle touches the cache, continue with the next triangle that hasn't been emitted yet
+					while (emitted[nextCandidate]) {
+						nextCandidate++;
+					}
+					bestTriangle = static_cast<uint32_t>(nextCandidate);
+				}
+				const uint32_t* triangle = &indices[bestTriangle * 3];
+				result.insert(result.end(), triangle, triangle + 3);
+				emitted[bestTriangle] = true;
+
+				// Remove the triangle from the live triangle lists of its vertices
+				for (uint32_t i = 0; i < 3; i++) {
+					const uint32_t vertex = triangle[i];
+					uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+					uint32_t* end = begin + liveTriangles[vertex];
+					*std::find(begin, end, bestTriangle) = *(end - 1);
+					liveTriangles[vertex]--;
+				}
+
+				// The triangle's vertices move to the front of the cache
+				newCache.assign(triangle, triangle + 3);
+				for (uint32_t vertex : cache) {
+					if ((vertex != triangle[0]) && (vertex != triangle[1]) && (vertex != triangle[2])) {
+						newCache.push_back(vertex);
+					}
+				}
+				// Vertices pushed out of the cache lose their cache score
+				for (size_t i = forsythCacheSize; i < newCache.size(); i++) {
+					cachePositions[newCache[i]] = -1;
+					vertexScores[newCache[i]] = forsythVertexScore(-1, liveTriangles[newCache[i]]);
+				}
+				if (newCache.size() > forsythCacheSize) {
+					newCache.resize(forsythCacheSize);
+				}
+				std::swap(cache, newCache);
+
+				// Update the scores of all cached vertices and their triangles, the best scoring one is emitted next
+				for (size_t i = 0; i < cache.size(); i++) {
+					cachePositions[cache[i]] = static_cast<int32_t>(i);
+					vertexScores[cache[i]] = forsythVertexScore(static_cast<int32_t>(i), liveTriangles[cache[i]]);
+				}
+				bestTriangle = invalidIndex;
+				float bestScore = -1.0f;
+				for (uint32_t vertex : cache) {
+					for (uint32_t i = 0; i < liveTriangles[vertex]; i++) {
+						const uint32_t t = adjacency[adjacencyOffsets[vertex] + i];
+						triangleScores[t] = vertexScores[indices[t * 3 + 0]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+						if (triangleScores[t] > bestScore) {
+							bestScore = triangleScores[t];
+							bestTriangle = t;
+						}
+					}
+				}
+			}
+			indices.swap(result);
+		}
+
+		/**
+		* Reorder triangles to reduce overdraw while keeping most of the vertex cache efficiency
+		*
+		* @param indices Triangle list, should already be optimized for the vertex cache
+		* @param threshold Allowed increase in ACMR, larger values allow smaller clusters and a better overdraw order
+		*
+		* @note Implements "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (Sander, Nehab, Barczak 2007):
+		* The triangle list is split into clusters that are sorted so clusters facing away from the mesh center are drawn first
+		*/
+		void optimizeOverdraw(std::vector<uint32_t>& indices, const float* positions, size_t positionStride, size_t vertexCount, float threshold)
+		{
+			const size_t triangleCount = indices.size() / 3;
+			if (triangleCount == 0) {
+				return;
+			}
+
+			// Hard boundaries: A triangle with three cache misses starts a new patch that is disjoint from the previous triangles
+			FifoCache cache(vertexCount, defaultCacheSize);
+			// The first triangle always starts a patch, even if it is degenerate and can't have three misses
+			std::vector<uint32_t> hardBoundaries = { 0 };
+			for (size_t t = 0; t < triangleCount; t++) {
+				if ((cache.update(indices[t * 3 + 0], indices[t * 3 + 1], indices[t * 3 + 2]) == 3) && (t > 0)) {
+					hardBoundaries.push_back(static_cast<uint32_t>(t));
+				}
+			}
+			hardBoundaries.push_back(static_cast<uint32_t>(triangleCount));
+
+			// Soft boundaries: Split patches where the ACMR of the cluster so far is within the threshold of the patch's ACMR
+			std::vector<uint32_t> clusters;
+			for (size_t h = 0; h + 1 < hardBoundaries.size(); h++) {
+				const uint32_t begin = hardBoundaries[h];
+				const uint32_t end = hardBoundaries[h + 1];
+				cache.reset();
+				uint32_t patchMisses = 0;
+				for (uint32_t t = begin; t < end; t++) {
+					patchMisses += cache.update(indices[t * 3 + 0], indices[t * 3 + 1], indices[t * 3 + 2]);
+				}
+				const float patchThreshold = threshold * static_cast<float>(patchMisses) / static_cast<float>(end - begin);
+				clusters.push_back(begin);
+				cache.reset();
+				uint32_t clusterMisses = 0;
+				uint32_t clusterTriangles = 0;
+				for (uint32_t t = begin; t < end; t++) {
+					clusterMisses += cache.update(indices[t * 3 + 0], indices[t * 3 + 1], indices[t * 3 + 2]);
+					clusterTriangles++;
+					if ((t + 1 < end) && (static_cast<float>(clusterMisses) / static_cast<float>(clusterTriangles) <= patchThreshold)) {
+						clusters.push_back(t + 1);
+						cache.reset();
+						clusterMisses = 0;
+						clusterTriangles = 0;
+					}
+				}
+			}
+			const size_t clusterCount = clusters.size();
+			clusters.push_back(static_cast<uint32_t>(triangleCount));
+
+			// Area weighted centroids and normals of the mesh and all clusters
+			float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+			float meshArea = 0.0f;
+			std::vector<float> clusterData(clusterCount * 6, 0.0f);
+			for (size_t c = 0; c < clusterCount; c++) {
+				float* centroid = &clusterData[c * 6];
+				float* normal = &clusterData[c * 6 + 3];
+				float clusterArea = 0.0f;
+				for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++) {
+					const float* p0 = position(positions, positionStride, indices[t * 3 + 0]);
+					const float* p1 = position(positions, positionStride, indices[t * 3 + 1]);
+					const float* p2 = position(positions, positionStride, indices[t * 3 + 2]);
+					const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+					const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+					const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+					const float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+					for (uint32_t i = 0; i < 3; i++) {
+						centroid[i] += (p0[i] + p1[i] + p2[i]) / 3.0f * area;
+						normal[i] += n[i];
+					}
+					clusterArea += area;
+				}
+				for (uint32_t i = 0; i < 3; i++) {
+					meshCentroid[i] += centroid[i];
+					centroid[i] /= std::max(clusterArea, 1e-30f);
+				}
+				meshArea += clusterArea;
+				const float normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+				for (uint32_t i = 0; i < 3; i++) {
+					normal[i] /= std::max(normalLength, 1e-30f);
+				}
+			}
+			for (uint32_t i = 0; i < 3; i++) {
+				meshCentroid[i] /= std::max(meshArea, 1e-30f);
+			}
+
+			// Clusters that face away from the mesh center are likely to occlude the others, so they are drawn first
+			std::vector<float> sortKeys(clusterCount);
+			for (size_t c = 0; c < clusterCount; c++) {
+				const float* centroid = &clusterData[c * 6];
+				const float* normal = &clusterData[c * 6 + 3];
+				sortKeys[c] = (centroid[0] - meshCentroid[0]) * normal[0] + (centroid[1] - meshCentroid[1]) * normal[1] + (centroid[2] - meshCentroid[2]) * normal[2];
+			}
+			std::vector<uint32_t> order(clusterCount);
+			std::iota(order.begin(), order.end(), 0);
+			std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+			std::vector<uint32_t> result;
+			result.reserve(indices.size());
+			for (uint32_t c : order) {
+				result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+			}
+			indices.swap(result);
+		}
+
+		/**
+		* Generate a remap table that orders vertices by their first use in the triangle list
+		*
+		* @param remap Receives the new index of each vertex, vertices not referenced by the indices are mapped to ~0
+		*
+		* @return Number of referenced vertices
+		*/
+		size_t generateVertexFetchRemap(std::vector<uint32_t>& remap, const std::vector<uint32_t>& indices, size_t vertexCount)
+		{
+			remap.assign(vertexCount, invalidIndex);
+			uint32_t nextIndex = 0;
+			for (uint32_t index : indices) {
+				if (remap[index] == invalidIndex) {
+					remap[index] = nextIndex++;
+				}
+			}
+			return nextIndex;
+		}
+
+		/**
+		* Reduce the number of triangles with edge collapses ordered by the quadric error metric
+		*
+		* @param indices Triangle list to simplify, receives the simplified triangle list that references a subset of the original vertices
+		* @param targetIndexCount Number of indices to reduce the triangle list to
+		* @param targetError Maximum geometric error of a collapse as a fraction of the mesh extent, the result has more indices than the target if it is reached first
+		* @param attributes (Optional) Pointer to the first float of the attributes of the first vertex, their differences add to the cost of collapsing an edge
+		* @param attributeStride (Optional) Stride between the attributes of two vertices in bytes
+		* @param attributeCount (Optional) Number of floats per vertex that are taken into account
+		* @param attributeWeight (Optional) Weight of the squared attribute differences
+		*
+		* @return Geometric error of the result in the units of the positions, can be used to select a level of detail by its projected size on screen
+		*
+		* @note Vertices are only collapsed into a neighbor (no new vertices are created), so the result can share the vertex data of the source mesh
+		* Vertices on open borders, non manifold edges and attribute seams (vertices with the same position but different attributes) are locked,
+		* so the silhouette of open meshes and texture seams are kept intact
+		*/
+		float simplify(std::vector<uint32_t>& indices, const float* positions, size_t positionStride, size_t vertexCount, size_t targetIndexCount, float targetError,
+			const float* attributes, size_t attributeStride, uint32_t attributeCount, float attributeWeight)
+		{
+			if (indices.size() <= targetIndexCount) {
+				return 0.0f;
+			}
+
+			// Positions are scaled to the mesh extent, so errors and attribute weights don't depend on the size of the mesh
+			float minPos[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+			float maxPos[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			for (uint32_t index : indices) {
+				const float* p = position(positions, positionStride, index);
+				for (uint32_t i = 0; i < 3; i++) {
+					minPos[i] = std::min(minPos[i], p[i]);
+					maxPos[i] = std::max(maxPos[i], p[i]);
+				}
+			}
+			const float extent = std::max({ maxPos[0] - minPos[0], maxPos[1] - minPos[1], maxPos[2] - minPos[2], 1e-30f });
+			std::vector<float> points(vertexCount * 3);
+			for (size_t v = 0; v < vertexCount; v++) {
+				const float* p = position(positions, positionStride, static_cast<uint32_t>(v));
+				for (uint32_t i = 0; i < 3; i++) {
+					points[v * 3 + i] = (p[i] - minPos[i]) / extent;
+				}
+			}
+
+			// Vertices with bitwise identical positions are welded for the topology, so attribute seams aren't mistaken for borders
+			std::vector<uint32_t> weld;
+			generateVertexRemap(weld, indices, points.data(), vertexCount, sizeof(float) * 3);
+			std::vector<uint32_t> weldedCount(vertexCount, 0);
+			std::vector<bool> weldedLocked(vertexCount, false);
+			for (size_t v = 0; v < vertexCount; v++) {
+				if ((weld[v] != invalidIndex) && (++weldedCount[weld[v]] > 1)) {
+					weldedLocked[weld[v]] = true;
+				}
+			}
+			// An edge is on a border if the opposite half edge doesn't exist, and non manifold if the same half edge exists more than once
+			std::unordered_map<uint64_t, uint32_t> halfEdges;
+			halfEdges.reserve(indices.size());
+			for (size_t i = 0; i < indices.size(); i += 3) {
+				for (uint32_t e = 0; e < 3; e++) {
+					const uint64_t a = weld[indices[i + e]];
+					const uint64_t b = weld[indices[i + (e + 1) % 3]];
+					halfEdges[(a << 32) | b]++;
+				}
+			}
+			for (const auto& [edge, count] : halfEdges) {
+				const uint64_t a = edge >> 32;
+				const uint64_t b = edge & 0xFFFFFFFFull;
+				if ((count > 1) || (halfEdges.find((b << 32) | a) == halfEdges.end())) {
+					weldedLocked[a] = true;
+					weldedLocked[b] = true;
+				}
+			}
+			std::vector<bool> locked(vertexCount, true);
+			for (size_t v = 0; v < vertexCount; v++) {
+				if (weld[v] != invalidIndex) {
+					locked[v] = weldedLocked[weld[v]];
+				}
+			}
+
+			// Every vertex starts with the planes of its adjacent triangles
+			std::vector<Quadric> quadrics(vertexCount);
+			for (size_t i = 0; i < indices.size(); i += 3) {
+				const float* p0 = &points[indices[i + 0] * 3];
+				float n[3];
+				triangleNormal(p0, &points[indices[i + 1] * 3], &points[indices[i + 2] * 3], n);
+				const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				if (length <= 0.0f) {
+					continue;
+				}
+				for (uint32_t c = 0; c < 3; c++) {
+					n[c] /= length;
+				}
+				const float d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+				for (uint32_t c = 0; c < 3; c++) {
+					quadrics[indices[i + c]].addPlane(n, d, length * 0.5f);
+				}
+			}
+
+			auto attributeDistance = [&](uint32_t a, uint32_t b) {
+				const float* attributesA = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(attributes) + a * attributeStride);
+				const float* attributesB = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(attributes) + b * attributeStride);
+				float distance = 0.0f;
+				for (uint32_t i = 0; i < attributeCount; i++) {
+					distance += (attributesA[i] - attributesB[i]) * (attributesA[i] - attributesB[i]);
+				}
+				return distance;
+			};
+
+			// Moving a vertex must not flip any of its remaining triangles
+			std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+			std::vector<uint32_t> adjacency;
+			auto flipsTriangles = [&](uint32_t from, uint32_t to) {
+				const float* target = &points[to * 3];
+				for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; a++) {
+					const uint32_t* triangle = &indices[adjacency[a] * 3];
+					if ((triangle[0] == to) || (triangle[1] == to) || (triangle[2] == to)) {
+						continue;
+					}
+					const float* p[3];
+					const float* q[3];
+					for (uint32_t c = 0; c < 3; c++) {
+						p[c] = &points[triangle[c] * 3];
+						q[c] = triangle[c] == from ? target : p[c];
+					}
+					float before[3], after[3];
+					triangleNormal(p[0], p[1], p[2], before);
+					triangleNormal(q[0], q[1], q[2], after);
+					if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0f) {
+						return true;
+					}
+				}
+				return false;
+			};
+
+			struct Collapse {
+				uint32_t from;
+				uint32_t to;
+				float error;
+				float cost;
+			};
+			std::vector<Collapse> collapses;
+			std::vector<uint32_t> collapseTarget(vertexCount);
+			std::vector<bool> touched(vertexCount);
+			const float maxError = targetError * targetError;
+			float resultError = 0.0f;
+
+			// Each pass collapses a set of independent edges in the order of their cost, then rebuilds the triangle list
+			while (indices.size() > targetIndexCount) {
+				std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+				for (uint32_t index : indices) {
+					adjacencyOffsets[index + 1]++;
+				}
+				for (size_t v = 0; v < vertexCount; v++) {
+					adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+				}
+				adjacency.resize(indices.size());
+				std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+				for (size_t i = 0; i < indices.size(); i++) {
+					adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+				}
+
+				collapses.clear();
+				for (size_t i = 0; i < indices.size(); i += 3) {
+					for (uint32_t e = 0; e < 3; e++) {
+						const uint32_t from = indices[i + e];
+						const uint32_t to = indices[i + (e + 1) % 3];
+						for (const auto& [a, b] : { std::make_pair(from, to), std::make_pair(to, from) }) {
+							if (locked[a]) {
+								continue;
+							}
+							const float error = quadrics[a].error(&points[b * 3]);
+							const float cost = attributes ? error + attributeWeight * attributeDistance(a, b) : error;
+							collapses.push_back({ a, b, error, cost });
+						}
+					}
+				}
+				if (collapses.empty()) {
+					break;
+				}
+				std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+				// A collapse of an interior vertex removes two triangles
+				const size_t trianglesToRemove = (indices.size() - targetIndexCount) / 3;
+				size_t trianglesRemoved = 0;
+				std::iota(collapseTarget.begin(), collapseTarget.end(), 0);
+				std::fill(touched.begin(), touched.end(), false);
+				for (const Collapse& collapse : collapses) {
+					if ((collapse.error > maxError) || (trianglesRemoved >= trianglesToRemove)) {
+						break;
+					}
+					if (touched[collapse.from] || touched[collapse.to] || flipsTriangles(collapse.from, collapse.to)) {
+						continue;
+					}
+					collapseTarget[collapse.from] = collapse.to;
+					quadrics[collapse.to].add(quadrics[collapse.from]);
+					// All vertices of the changed triangles are skipped for the rest of the pass, so the adjacency stays valid
+					for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; a++) {
+						for (uint32_t c = 0; c < 3; c++) {
+							touched[indices[adjacency[a] * 3 + c]] = true;
+						}
+					}
+					resultError = std::max(resultError, collapse.error);
+					trianglesRemoved += 2;
+				}
+				if (trianglesRemoved == 0) {
+					break;
+				}
+
+				size_t writeIndex = 0;
+				for (size_t i = 0; i < indices.size(); i += 3) {
+					const uint32_t a = collapseTarget[indices[i + 0]];
+					const uint32_t b = collapseTarget[indices[i + 1]];
+					const uint32_t c = collapseTarget[indices[i + 2]];
+					if ((a != b) && (a != c) && (b != c)) {
+						indices[writeIndex++] = a;
+						indices[writeIndex++] = b;
+						indices[writeIndex++] = c;
+					}
+				}
+				indices.resize(writeIndex);
+			}
+
+			return std::sqrt(resultError) * extent;
+		}
+
+		/**
+		* Split a triangle list into meshlets with a limited number of vertices and triangles
+		*
+		* @param meshlets Receives the meshlets
+		* @param meshletVertices Receives the vertex indices referenced by the meshlets
+		* @param meshletTriangles Receives the triangles of the meshlets as triplets of indices into each meshlet's vertex range
+		* @param maxVertices (Optional) Maximum number of vertices per meshlet, at most 256
+		* @param maxTriangles (Optional) Maximum number of triangles per meshlet
+		*
+		* @return Number of meshlets
+		*
+		* @note Meshlets are grown greedily from the triangles adjacent to their vertices, preferring triangles that add the fewest new vertices
+		* and are closest to the meshlet's center, so meshlets are compact and their bounds are tight for culling
+		*/
+		size_t buildMeshlets(std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles, const std::vector<uint32_t>& indices,
+			const float* positions, size_t positionStride, size_t vertexCount, uint32_t maxVertices, uint32_t maxTriangles)
+		{
+			assert((maxVertices >= 3) && (maxVertices <= 256) && (maxTriangles >= 1));
+			meshlets.clear();
+			meshletVertices.clear();
+			meshletTriangles.clear();
+			const size_t triangleCount = indices.size() / 3;
+
+			// Per vertex lists of triangles that haven't been added to a meshlet yet
+			std::vector<uint32_t> liveTriangles(vertexCount, 0);
+			for (uint32_t index : indices) {
+				liveTriangles[index]++;
+			}
+			std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+			for (size_t i = 0; i < vertexCount; i++) {
+				adjacencyOffsets[i + 1] = adjacencyOffsets[i] + liveTriangles[i];
+			}
+			std::vector<uint32_t> adjacency(indices.size());
+			std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++) {
+				adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+
+			std::vector<float> centroids(triangleCount * 3);
+			for (size_t t = 0; t < triangleCount; t++) {
+				for (uint32_t c = 0; c < 3; c++) {
+					const float* p = position(positions, positionStride, indices[t * 3 + c]);
+					for (uint32_t i = 0; i < 3; i++) {
+						centroids[t * 3 + i] += p[i] / 3.0f;
+					}
+				}
+			}
+
+			const uint8_t notInMeshlet = 0xff;
+			std::vector<uint8_t> localIndices(vertexCount, notInMeshlet);
+			std::vector<bool> emitted(triangleCount, false);
+			Meshlet meshlet{};
+			float meshletCenter[3] = { 0.0f, 0.0f, 0.0f };
+			size_t nextSeed = 0;
+
+			auto finishMeshlet = [&]() {
+				for (uint32_t v = 0; v < meshlet.vertexCount; v++) {
+					localIndices[meshletVertices[meshlet.vertexOffset + v]] = notInMeshlet;
+				}
+				meshlets.push_back(meshlet);
+				meshlet.vertexOffset = static_cast<uint32_t>(meshletVertices.size());
+				meshlet.triangleOffset = static_cast<uint32_t>(meshletTriangles.size() / 3);
+				meshlet.vertexCount = 0;
+				meshlet.triangleCount = 0;
+			};
+
+			for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+				// Best triangle adjacent to the current meshlet
+				uint32_t bestTriangle = invalidIndex;
+				uint32_t bestExtra = 4;
+				float bestDistance = FLT_MAX;
+				for (uint32_t v = 0; v < meshlet.vertexCount; v++) {
+					const uint32_t vertex = meshletVertices[meshlet.vertexOffset + v];
+					for (uint32_t a = 0; a < liveTriangles[vertex]; a++) {
+						const uint32_t t = adjacency[adjacencyOffsets[vertex] + a];
+						const uint32_t extra = (localIndices[indices[t * 3 + 0]] == notInMeshlet) + (localIndices[indices[t * 3 + 1]] == notInMeshlet) + (localIndices[indices[t * 3 + 2]] == notInMeshlet);
+						const float dx = centroids[t * 3 + 0] - meshletCenter[0];
+						const float dy = centroids[t * 3 + 1] - meshletCenter[1];
+						const float dz = centroids[t * 3 + 2] - meshletCenter[2];
+						const float distance = dx * dx + dy * dy + dz * dz;
+						if ((extra < bestExtra) || ((extra == bestExtra) && (distance < bestDistance))) {
+							bestTriangle = t;
+							bestExtra = extra;
+							bestDistance = distance;
+						}
+					}
+				}
+				// Continue with the next triangle in index order if the meshlet has no neighbors left, which is close by for cache optimized meshes
+				if (bestTriangle == invalidIndex) {
+					while (emitted[nextSeed]) {
+						nextSeed++;
+					}
+					bestTriangle = static_cast<uint32_t>(nextSeed);
+					bestExtra = 0;
+					for (uint32_t c = 0; c < 3; c++) {
+						bestExtra += localIndices[indices[bestTriangle * 3 + c]] == notInMeshlet;
+					}
+				}
+
+				if ((meshlet.vertexCount + bestExtra > maxVertices) || (meshlet.triangleCount + 1 > maxTriangles)) {
+					finishMeshlet();
+				}
+
+				const uint32_t* triangle = &indices[bestTriangle * 3];
+				for (uint32_t c = 0; c < 3; c++) {
+					const uint32_t vertex = triangle[c];
+					if (localIndices[vertex] == notInMeshlet) {
+						localIndices[vertex] = static_cast<uint8_t>(meshlet.vertexCount++);
+						meshletVertices.push_back(vertex);
+					}
+					meshletTriangles.push_back(localIndices[vertex]);
+					// Remove the triangle from the live triangle lists of its vertices
+					uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+					uint32_t* end = begin + liveTriangles[vertex];
+					uint32_t* entry = std::find(begin, end, bestTriangle);
+					if (entry != end) {
+						*entry = *(end - 1);
+						liveTriangles[vertex]--;
+					}
+				}
+				emitted[bestTriangle] = true;
+				// Running average of the triangle centroids
+				meshlet.triangleCount++;
+				for (uint32_t i = 0; i < 3; i++) {
+					meshletCenter[i] += (centroids[bestTriangle * 3 + i] - meshletCenter[i]) / static_cast<float>(meshlet.triangleCount);
+				}
+			}
+			if (meshlet.triangleCount > 0) {
+				finishMeshlet();
+			}
+			return meshlets.size();
+		}
+
+		/**
+		* Compute the bounding sphere and the normal cone of a meshlet for culling
+		*
+		* @param clockwise (Optional) Set if front faces are wound clockwise (e.g. for meshes that have been mirrored), so the cone follows the front faces
+		*
+		* @note The cone's apex is moved back along the axis until it lies behind all triangle planes, so the cone test is conservative for any viewer position
+		*/
+		MeshletBounds computeMeshletBounds(const Meshlet& meshlet, const std::vector<uint32_t>& meshletVertices, const std::vector<uint8_t>& meshletTriangles, const float* positions, size_t positionStride, bool clockwise)
+		{
+			MeshletBounds bounds{};
+			float minPos[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+			float maxPos[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			for (uint32_t v = 0; v < meshlet.vertexCount; v++) {
+				const float* p = position(positions, positionStride, meshletVertices[meshlet.vertexOffset + v]);
+				for (uint32_t i = 0; i < 3; i++) {
+					minPos[i] = std::min(minPos[i], p[i]);
+					maxPos[i] = std::max(maxPos[i], p[i]);
+				}
+			}
+			for (uint32_t i = 0; i < 3; i++) {
+				bounds.center[i] = (minPos[i] + maxPos[i]) * 0.5f;
+			}
+			float radiusSquared = 0.0f;
+			for (uint32_t v = 0; v < meshlet.vertexCount; v++) {
+				const float* p = position(positions, positionStride, meshletVertices[meshlet.vertexOffset + v]);
+				const float d[3] = { p[0] - bounds.center[0], p[1] - bounds.center[1], p[2] - bounds.center[2] };
+				radiusSquared = std::max(radiusSquared, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+			}
+			bounds.radius = std::sqrt(radiusSquared);
+
+			// Unit normals of all non degenerate triangles, the cone's axis is their area weighted average
+			std::vector<float> normals;
+			normals.reserve(meshlet.triangleCount * 3);
+			std::vector<const float*> origins;
+			origins.reserve(meshlet.triangleCount);
+			float axis[3] = { 0.0f, 0.0f, 0.0f };
+			for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+				const uint8_t* triangle = &meshletTriangles[(meshlet.triangleOffset + t) * 3];
+				const float* p0 = position(positions, positionStride, meshletVertices[meshlet.vertexOffset + triangle[0]]);
+				const float* p1 = position(positions, positionStride, meshletVertices[meshlet.vertexOffset + triangle[1]]);
+				const float* p2 = position(positions, positionStride, meshletVertices[meshlet.vertexOffset + triangle[2]]);
+				float n[3];
+				triangleNormal(p0, p1, p2, n);
+				const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				if (length <= 0.0f) {
+					continue;
+				}
+				for (uint32_t i = 0; i < 3; i++) {
+					axis[i] += clockwise ? -n[i] : n[i];
+					normals.push_back((clockwise ? -n[i] : n[i]) / length);
+				}
+				origins.push_back(p0);
+			}
+			const float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+			bounds.coneCutoff = 1.0f;
+			std::copy(bounds.center, bounds.center + 3, bounds.coneApex);
+			if (origins.empty() || (axisLength <= 0.0f)) {
+				return bounds;
+			}
+			for (uint32_t i = 0; i < 3; i++) {
+				bounds.coneAxis[i] = axis[i] / axisLength;
+			}
+			float minDot = 1.0f;
+			for (size_t t = 0; t < origins.size(); t++) {
+				const float* n = &normals[t * 3];
+				minDot = std::min(minDot, n[0] * bounds.coneAxis[0] + n[1] * bounds.coneAxis[1] + n[2] * bounds.coneAxis[2]);
+			}
+			// Cones wider than a hemisphere (and almost as wide) can't be culled
+			if (minDot <= 0.1f) {
+				return bounds;
+			}
+			float maxT = 0.0f;
+			for (size_t t = 0; t < origins.size(); t++) {
+				const float* n = &normals[t * 3];
+				const float* p = origins[t];
+				const float dc = (p[0] - bounds.center[0]) * n[0] + (p[1] - bounds.center[1]) * n[1] + (p[2] - bounds.center[2]) * n[2];
+				const float dn = bounds.coneAxis[0] * n[0] + bounds.coneAxis[1] * n[1] + bounds.coneAxis[2] * n[2];
+				maxT = std::max(maxT, dc / dn);
+			}
+			for (uint32_t i = 0; i < 3; i++) {
+				bounds.coneApex[i] = bounds.center[i] - bounds.coneAxis[i] * maxT;
+			}
+			bounds.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+			return bounds;
+		}
+
+		/**
+		* Simulate a FIFO post transform vertex cache
+		*/
+		VertexCacheStatistics analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+		{
+			VertexCacheStatistics statistics{};
+			FifoCache cache(vertexCount, cacheSize);
+			std::vector<bool> referenced(vertexCount, false);
+			uint32_t referencedCount = 0;
+			for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+				statistics.verticesTransformed += cache.update(indices[i], indices[i + 1], indices[i + 2]);
+				for (size_t j = i; j < i + 3; j++) {
+					if (!referenced[indices[j]]) {
+						referenced[indices[j]] = true;
+						referencedCount++;
+					}
+				}
+			}
+			if (!indices.empty()) {
+				statistics.acmr = static_cast<float>(statistics.verticesTransformed) / static_cast<float>(indices.size() / 3);
+				statistics.atvr = static_cast<float>(statistics.verticesTransformed) / static_cast<float>(referencedCount);
+			}
+			return statistics;
+		}
+
+		/**
+		* Rasterize the mesh from the six axis aligned directions and count how often each covered pixel is shaded
+		*
+		* @param indices Triangle list indices
+		* @param positions Pointer to the position (three floats) of the first vertex
+		* @param positionStride Distance between the positions of two vertices in bytes
+		* @param vertexCount Number of vertices, all indices must be smaller
+		*
+		* @note Uses a 256 x 256 grid per direction with the mesh scaled to its bounding box, triangles are drawn in index order with a less or equal depth test
+		*/
+		OverdrawStatistics analyzeOverdraw(const std::vector<uint32_t>& indices, const float* positions, size_t positionStride, size_t vertexCount)
+		{
+			OverdrawStatistics statistics{};
+			if (indices.empty()) {
+				return statistics;
+			}
+			float minPos[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+			float maxPos[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			for (uint32_t index : indices) {
+				assert(index < vertexCount);
+				const float* p = position(positions, positionStride, index);
+				for (uint32_t i = 0; i < 3; i++) {
+					minPos[i] = std::min(minPos[i], p[i]);
+					maxPos[i] = std::max(maxPos[i], p[i]);
+				}
+			}
+			const float extent = std::max({ maxPos[0] - minPos[0], maxPos[1] - minPos[1], maxPos[2] - minPos[2], 1e-30f });
+			const float scale = static_cast<float>(overdrawGridSize) / extent;
+
+			std::vector<float> depthBuffer(overdrawGridSize * overdrawGridSize);
+			std::vector<float> triangles(indices.size() * 3);
+			for (uint32_t axis = 0; axis < 3; axis++) {
+				// Project onto the two other axes, depth is normalized to [0, 1]
+				const uint32_t u = (axis + 1) % 3;
+				const uint32_t v = (axis + 2) % 3;
+				for (size_t i = 0; i < indices.size(); i++) {
+					const float* p = position(positions, positionStride, indices[i]);
+					triangles[i * 3 + 0] = (p[u] - minPos[u]) * scale;
+					triangles[i * 3 + 1] = (p[v] - minPos[v]) * scale;
+					triangles[i * 3 + 2] = (p[axis] - minPos[axis]) / extent;
+				}
+				for (bool reverse : { false, true }) {
+					rasterizeOverdraw(depthBuffer, triangles, reverse, statistics.pixelsShaded);
+					statistics.pixelsCovered += static_cast<uint32_t>(std::count_if(depthBuffer.begin(), depthBuffer.end(), [](float depth) { return depth < 1.0f; }));
+				}
+			}
+			statistics.overdraw = statistics.pixelsCovered > 0 ? static_cast<float>(statistics.pixelsShaded) / static_cast<float>(statistics.pixelsCovered) : 0.0f;
+			return statistics;
+		}
+
+		/**
+		* Simulate vertex fetches through a 4 KB direct mapped cache with 64 byte lines
+		*/
+		VertexFetchStatistics analyzeVertexFetch(const std::vector<uint32_t>& indices, size_t vertexCount, size_t vertexSize)
+		{
+			const size_t lineSize = 64;
+			const size_t lineCount = 64;
+			VertexFetchStatistics statistics{};
+			std::vector<size_t> lines(lineCount, SIZE_MAX);
+			std::vector<bool> referenced(vertexCount, false);
+			size_t referencedCount = 0;
+			for (uint32_t index : indices) {
+				if (!referenced[index]) {
+					referenced[index] = true;
+					referencedCount++;
+				}
+				const size_t firstLine = index * vertexSize / lineSize;
+				const size_t lastLine = ((index + 1) * vertexSize - 1) / lineSize;
+				for (size_t line = firstLine; line <= lastLine; line++) {
+					if (lines[line % lineCount] != line) {
+						lines[line % lineCount] = line;
+						statistics.bytesFetched += static_cast<uint32_t>(lineSize);
+					}
+				}
+			}
+			if (referencedCount > 0) {
+				statistics.overfetch = static_cast<float>(statistics.bytesFetched) / static_cast<float>(referencedCount * vertexSize);
+			}
+			return statistics;
+		}
+	}
+}
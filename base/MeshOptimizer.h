@@ -0,0 +1,95 @@
+/*
+* Mesh optimization
+*
+* Load time vertex deduplication, triangle reordering for vertex cache efficiency and overdraw and vertex reordering for fetch locality,
+* quadric error metric simplification for level of detail generation, meshlet building for mesh shading, plus CPU side analysis of the results
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+	This header has no Vulkan dependency, so it can also be used by command line tools
+	Triangle lists are passed as indices into a vertex range of vertexCount vertices
+	Positions are passed as a pointer to the first float of the first position plus the stride between positions in bytes
+*/
+namespace vks
+{
+	namespace meshoptimizer
+	{
+		/** @brief Number of entries of the FIFO cache used by the analysis (matches the post transform cache size of a wide range of GPUs) */
+		const uint32_t defaultCacheSize = 16;
+		/** @brief Default for the allowed increase in ACMR when reordering triangles for overdraw */
+		const float defaultOverdrawThreshold = 1.05f;
+		/** @brief Default weight of squared attribute differences relative to the squared geometric error (with positions scaled to the mesh extent) when simplifying */
+		const float defaultAttributeWeight = 0.01f;
+		/** @brief Default meshlet limits, 64 vertices and 124 triangles fit the output limits of mesh shaders on all vendors */
+		const uint32_t defaultMeshletMaxVertices = 64;
+		const uint32_t defaultMeshletMaxTriangles = 124;
+
+		struct VertexCacheStatistics {
+			uint32_t verticesTransformed = 0;
+			// Average cache miss ratio: Transformed vertices per triangle (0.5 is the optimum for large regular meshes, 3 the worst case)
+			float acmr = 0.0f;
+			// Average transform to vertex ratio: Transformed vertices per referenced vertex (1 is the optimum)
+			float atvr = 0.0f;
+		};
+
+		struct OverdrawStatistics {
+			uint32_t pixelsCovered = 0;
+			uint32_t pixelsShaded = 0;
+			// Shaded pixels per covered pixel (1 is the optimum)
+			float overdraw = 0.0f;
+		};
+
+		struct VertexFetchStatistics {
+			uint32_t bytesFetched = 0;
+			// Fetched bytes per byte of referenced vertex data (1 is the optimum)
+			float overfetch = 0.0f;
+		};
+
+		// A meshlet references its vertices through a range of meshletVertices and its triangles through a range of local index triplets in meshletTriangles
+		struct Meshlet {
+			uint32_t vertexOffset;
+			// Offset in triangles, the local indices of a triangle start at triangleOffset * 3
+			uint32_t triangleOffset;
+			uint32_t vertexCount;
+			uint32_t triangleCount;
+		};
+
+		// Bounding sphere and normal cone of a meshlet, the layout matches the std430 layout of the shaders
+		struct MeshletBounds {
+			float center[3];
+			float radius;
+			// All triangles face away from a viewer at position p if dot(normalize(coneApex - p), coneAxis) >= coneCutoff
+			float coneApex[3];
+			// 1 if the triangles' normals are too different for cone culling
+			float coneCutoff;
+			float coneAxis[3];
+			float padding;
+		};
+
+		size_t generateVertexRemap(std::vector<uint32_t>& remap, const std::vector<uint32_t>& indices, const void* vertices, size_t vertexCount, size_t vertexSize);
+		void remapIndices(std::vector<uint32_t>& indices, const std::vector<uint32_t>& remap);
+		void remapVertices(void* destination, const void* vertices, size_t vertexCount, size_t vertexSize, const std::vector<uint32_t>& remap);
+		void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+		void optimizeOverdraw(std::vector<uint32_t>& indices, const float* positions, size_t positionStride, size_t vertexCount, float threshold = defaultOverdrawThreshold);
+		size_t generateVertexFetchRemap(std::vector<uint32_t>& remap, const std::vector<uint32_t>& indices, size_t vertexCount);
+		float simplify(std::vector<uint32_t>& indices, const float* positions, size_t positionStride, size_t vertexCount, size_t targetIndexCount, float targetError,
+			const float* attributes = nullptr, size_t attributeStride = 0, uint32_t attributeCount = 0, float attributeWeight = defaultAttributeWeight);
+		size_t buildMeshlets(std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles, const std::vector<uint32_t>& indices,
+			const float* positions, size_t positionStride, size_t vertexCount, uint32_t maxVertices = defaultMeshletMaxVertices, uint32_t maxTriangles = defaultMeshletMaxTriangles);
+		MeshletBounds computeMeshletBounds(const Meshlet& meshlet, const std::vector<uint32_t>& meshletVertices, const std::vector<uint8_t>& meshletTriangles, const float* positions, size_t positionStride, bool clockwise = false);
+
+		VertexCacheStatistics analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = defaultCacheSize);
+		OverdrawStatistics analyzeOverdraw(const std::vector<uint32_t>& indices, const float* positions, size_t positionStride, size_t vertexCount);
+		VertexFetchStatistics analyzeVertexFetch(const std::vector<uint32_t>& indices, size_t vertexCount, size_t vertexSize);
+	}
+}
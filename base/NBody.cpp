@@ -0,0 +1,240 @@
+/*
+* CPU N-body reference
+*
+* All-pairs and hierarchical (Barnes-Hut over an implicit octree) gravitational accelerations, matching the compute shaders of the N-body sample,
+* for validating GPU results and comparing the accuracy of the hierarchical approximation
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+
+#include "NBody.h"
+#include "threadpool.hpp"
+
+namespace vks
+{
+	namespace nbody
+	{
+		namespace
+		{
+			// Depth first traversal never holds more than seven siblings per level plus the cell being opened
+			const uint32_t stackSize = 7 * maxLevels + 1;
+
+			uint32_t resolveThreadCount(uint32_t threadCount)
+			{
+				return (threadCount > 0) ? threadCount : std::max(std::thread::hardware_concurrency(), 1u);
+			}
+
+			// Level and cell coordinates packed like the traversal stack entries of the compute shader
+			uint32_t packCell(uint32_t level, uint32_t x, uint32_t y, uint32_t z)
+			{
+				return (level << 24) | (x << 16) | (y << 8) | z;
+			}
+
+			uint32_t cellIndex(uint32_t level, uint32_t x, uint32_t y, uint32_t z)
+			{
+				const uint32_t resolution = 1u << level;
+				return levelOffset(level) + x + y * resolution + z * resolution * resolution;
+			}
+
+			void interact(const float* position, const float* otherPosition, float otherMass, const Settings& settings, float* acceleration)
+			{
+				const float d[3] = { otherPosition[0] - position[0], otherPosition[1] - position[1], otherPosition[2] - position[2] };
+				const float scale = settings.gravity * otherMass / std::pow(d[0] * d[0] + d[1] * d[1] + d[2] * d[2] + settings.soften, settings.power);
+				for (uint32_t i = 0; i < 3; i++) {
+					acceleration[i] += d[i] * scale;
+				}
+			}
+
+			void accelerationAllPairs(const std::vector<Particle>& particles, const Settings& settings, const float* position, float* acceleration)
+			{
+				for (const Particle& other : particles) {
+					interact(position, other.position, other.mass, settings, acceleration);
+				}
+			}
+
+			void accelerationHierarchical(const Octree& octree, const float* position, float* acceleration)
+			{
+				const Settings& settings = octree.settings;
+				const float theta2 = settings.theta * settings.theta;
+				uint32_t stack[stackSize];
+				uint32_t stackTop = 0;
+				stack[stackTop++] = packCell(0, 0, 0, 0);
+				while (stackTop > 0) {
+					const uint32_t entry = stack[--stackTop];
+					const uint32_t level = entry >> 24;
+					const uint32_t x = (entry >> 16) & 0xff;
+					const uint32_t y = (entry >> 8) & 0xff;
+					const uint32_t z = entry & 0xff;
+					const Cell& cell = octree.cells[cellIndex(level, x, y, z)];
+					if (cell.weight <= 0.0f) {
+						continue;
+					}
+					const float center[3] = { cell.weightedPosition[0] / cell.weight, cell.weightedPosition[1] / cell.weight, cell.weightedPosition[2] / cell.weight };
+					const float d[3] = { center[0] - position[0], center[1] - position[1], center[2] - position[2] };
+					const float distance2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+					const float size = settings.boundsSize / static_cast<float>(1u << level);
+					if ((level == settings.levels) || (size * size < theta2 * distance2)) {
+						interact(position, center, cell.mass, settings, acceleration);
+						continue;
+					}
+					// Children are pushed in reverse, so they are visited in storage order
+					for (uint32_t child = 8; child-- > 0;) {
+						stack[stackTop++] = packCell(level + 1, x * 2 + (child & 1), y * 2 + ((child >> 1) & 1), z * 2 + (child >> 2));
+					}
+				}
+			}
+
+			template<typename Function>
+			void parallelFor(uint32_t count, uint32_t threadCount, Function function)
+			{
+				threadCount = std::min(resolveThreadCount(threadCount), std::max(count, 1u));
+				if (threadCount == 1) {
+					function(0, count);
+					return;
+				}
+				const uint32_t sliceSize = (count + threadCount - 1) / threadCount;
+				vks::ThreadPool threadPool;
+				threadPool.setThreadCount(threadCount);
+				for (uint32_t i = 0; i < threadCount; i++) {
+					threadPool.threads[i]->addJob([&function, i, sliceSize, count] { function(std::min(i * sliceSize, count), std::min((i + 1) * sliceSize, count)); });
+				}
+				threadPool.wait();
+			}
+		}
+
+		/**
+		* Index of the first cell of an octree level, the levels above it hold (8^level - 1) / 7 cells
+		*/
+		uint32_t levelOffset(uint32_t level)
+		{
+			return ((1u << (3 * level)) - 1) / 7;
+		}
+
+		/**
+		* Bin all particles into the finest level and sum the cells of every level from the level below it
+		*/
+		void buildOctree(Octree& octree, const std::vector<Particle>& particles, const Settings& settings)
+		{
+			assert(settings.levels < maxLevels);
+			octree.settings = settings;
+			octree.cells.assign(levelOffset(settings.levels + 1), Cell{});
+			const uint32_t resolution = 1u << settings.levels;
+			const float cellsPerUnit = static_cast<float>(resolution) / settings.boundsSize;
+			for (const Particle& particle : particles) {
+				uint32_t coordinates[3];
+				for (uint32_t i = 0; i < 3; i++) {
+					const float cell = std::floor((particle.position[i] - settings.boundsMin[i]) * cellsPerUnit);
+					coordinates[i] = static_cast<uint32_t>(std::clamp(cell, 0.0f, static_cast<float>(resolution - 1)));
+				}
+				Cell& cell = octree.cells[cellIndex(settings.levels, coordinates[0], coordinates[1], coordinates[2])];
+				const float weight = std::abs(particle.mass);
+				for (uint32_t i = 0; i < 3; i++) {
+					cell.weightedPosition[i] += particle.position[i] * weight;
+				}
+				cell.weight += weight;
+				cell.mass += particle.mass;
+			}
+			for (uint32_t level = settings.levels; level-- > 0;) {
+				const uint32_t levelResolution = 1u << level;
+				for (uint32_t z = 0; z < levelResolution; z++) {
+					for (uint32_t y = 0; y < levelResolution; y++) {
+						for (uint32_t x = 0; x < levelResolution; x++) {
+							Cell& cell = octree.cells[cellIndex(level, x, y, z)];
+							for (uint32_t child = 0; child < 8; child++) {
+								const Cell& source = octree.cells[cellIndex(level + 1, x * 2 + (child & 1), y * 2 + ((child >> 1) & 1), z * 2 + (child >> 2))];
+								for (uint32_t i = 0; i < 3; i++) {
+									cell.weightedPosition[i] += source.weightedPosition[i];
+								}
+								cell.weight += source.weight;
+								cell.mass += source.mass;
+							}
+						}
+					}
+				}
+			}
+		}
+
+		/**
+		* Calculate the accelerations of a set of particles caused by all particles
+		*
+		* @param targets Indices of the particles to calculate the accelerations for, a subset keeps the all-pairs reference affordable for millions of particles
+		* @param result Receives three floats per target
+		* @param threadCount Number of threads the targets are distributed over, 0 uses all hardware threads
+		*/
+		void accelerations(const std::vector<Particle>& particles, const Settings& settings, Mode mode, const std::vector<uint32_t>& targets, std::vector<float>& result, uint32_t threadCount)
+		{
+			result.assign(targets.size() * 3, 0.0f);
+			Octree octree;
+			if (mode == Mode::Hierarchical) {
+				buildOctree(octree, particles, settings);
+			}
+			parallelFor(static_cast<uint32_t>(targets.size()), threadCount, [&](uint32_t begin, uint32_t end) {
+				for (uint32_t i = begin; i < end; i++) {
+					const float* position = particles[targets[i]].position;
+					if (mode == Mode::AllPairs) {
+						accelerationAllPairs(particles, settings, position, &result[i * 3]);
+					} else {
+						accelerationHierarchical(octree, position, &result[i * 3]);
+					}
+				}
+			});
+		}
+
+		/**
+		* Advance all particles by one time step, the same way the calculate and integrate shaders of the sample do
+		*/
+		void step(std::vector<Particle>& particles, const Settings& settings, Mode mode, float deltaT, uint32_t threadCount)
+		{
+			std::vector<uint32_t> targets(particles.size());
+			std::iota(targets.begin(), targets.end(), 0);
+			std::vector<float> acceleration;
+			accelerations(particles, settings, mode, targets, acceleration, threadCount);
+			for (size_t i = 0; i < particles.size(); i++) {
+				Particle& particle = particles[i];
+				for (uint32_t j = 0; j < 3; j++) {
+					particle.velocity[j] += deltaT * acceleration[i * 3 + j];
+					particle.position[j] += deltaT * particle.velocity[j];
+				}
+				particle.gradient += 0.1f * deltaT;
+				if (particle.gradient > 1.0f) {
+					particle.gradient -= 1.0f;
+				}
+			}
+		}
+
+		/**
+		* Error of a set of accelerations relative to a reference, both with three floats per particle
+		*/
+		Error compare(const std::vector<float>& reference, const std::vector<float>& result)
+		{
+			assert(reference.size() == result.size());
+			Error error;
+			const size_t count = reference.size() / 3;
+			if (count == 0) {
+				return error;
+			}
+			double sum = 0.0;
+			for (size_t i = 0; i < count; i++) {
+				double difference2 = 0.0;
+				double length2 = 0.0;
+				for (uint32_t j = 0; j < 3; j++) {
+					const double d = static_cast<double>(result[i * 3 + j]) - reference[i * 3 + j];
+					difference2 += d * d;
+					length2 += static_cast<double>(reference[i * 3 + j]) * reference[i * 3 + j];
+				}
+				const double relative = std::sqrt(difference2 / std::max(length2, 1e-30));
+				sum += relative * relative;
+				error.maxRelative = std::max(error.maxRelative, relative);
+			}
+			error.rmsRelative = std::sqrt(sum / count);
+			return error;
+		}
+	}
+}
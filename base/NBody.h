@@ -0,0 +1,77 @@
+/*
+* CPU N-body reference
+*
+* All-pairs and hierarchical (Barnes-Hut over an implicit octree) gravitational accelerations, matching the compute shaders of the N-body sample,
+* for validating GPU results and comparing the accuracy of the hierarchical approximation
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+/*
+	The hierarchical mode uses a complete octree over a fixed cube instead of a pointer based tree, level l has 2^l cells per axis
+	and cells of a level are stored in x, y, z order after the cells of all coarser levels. This is the layout the GPU builds
+	with atomics and one reduction pass per level, so both implementations visit the same cells in the same order.
+	Particles outside of the cube are binned into the nearest border cell, their mass and center of mass still count exactly.
+*/
+namespace vks
+{
+	namespace nbody
+	{
+		/** @brief The finest level stores cell coordinates in eight bits */
+		const uint32_t maxLevels = 8;
+
+		// Same layout as the particles in the storage buffer of the sample (std140 vec4 pos, vec4 vel)
+		struct Particle {
+			float position[3];
+			float mass;
+			float velocity[3];
+			float gradient;
+		};
+
+		struct Settings {
+			float gravity = 0.002f;
+			float power = 0.75f;
+			float soften = 0.05f;
+			// Barnes-Hut opening angle, cells smaller than theta times their distance are treated as a single body
+			float theta = 0.5f;
+			// Index of the finest octree level
+			uint32_t levels = 6;
+			// Cube covered by the octree
+			float boundsMin[3] = { -16.0f, -16.0f, -16.0f };
+			float boundsSize = 32.0f;
+		};
+
+		enum class Mode { AllPairs, Hierarchical };
+
+		// Sum of the masses of a cell and the center of its bodies weighted by absolute mass (masses may be negative)
+		struct Cell {
+			float weightedPosition[3];
+			float weight;
+			float mass;
+		};
+
+		struct Octree {
+			Settings settings;
+			std::vector<Cell> cells;
+		};
+
+		struct Error {
+			// Relative to the length of the reference acceleration
+			double rmsRelative = 0.0;
+			double maxRelative = 0.0;
+		};
+
+		uint32_t levelOffset(uint32_t level);
+		void buildOctree(Octree& octree, const std::vector<Particle>& particles, const Settings& settings);
+		void accelerations(const std::vector<Particle>& particles, const Settings& settings, Mode mode, const std::vector<uint32_t>& targets, std::vector<float>& result, uint32_t threadCount = 0);
+		void step(std::vector<Particle>& particles, const Settings& settings, Mode mode, float deltaT, uint32_t threadCount = 0);
+		Error compare(const std::vector<float>& reference, const std::vector<float>& result);
+	}
+}
@@ -0,0 +1,369 @@
+/*
+* CPU particle engine
+*
+* Structure of arrays particle storage partitioned by type, SIMD update kernels run as chunked jobs on a thread pool,
+* a counter based random number generator and direct output into a (persistently mapped) vertex buffer, optional back to front ordering through an index buffer
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define VKS_PARTICLES_SSE
+#include <emmintrin.h>
+#endif
+
+#include "ParticleEngine.h"
+#include "threadpool.hpp"
+
+namespace vks
+{
+	/**
+	* Four rounds of the "Squares" counter based generator (Widynski, 2020)
+	*/
+	uint32_t CounterRng::next(uint64_t counter) const
+	{
+		uint64_t y = counter * key;
+		uint64_t x = y;
+		const uint64_t z = y + key;
+		x = x * x + y;
+		x = (x >> 32) | (x << 32);
+		x = x * x + z;
+		x = (x >> 32) | (x << 32);
+		x = x * x + y;
+		x = (x >> 32) | (x << 32);
+		return static_cast<uint32_t>((x * x + z) >> 32);
+	}
+
+	float CounterRng::uniform(uint64_t counter) const
+	{
+		// The upper 24 bits fit into the mantissa without rounding up to 1
+		return static_cast<float>(next(counter) >> 8) * (1.0f / 16777216.0f);
+	}
+
+	float CounterRng::uniform(uint64_t counter, float min, float max) const
+	{
+		return min + uniform(counter) * (max - min);
+	}
+
+	ParticleEngine::ParticleEngine() = default;
+
+	ParticleEngine::~ParticleEngine() = default;
+
+	/**
+	* (Re)create all particles as primary particles
+	*
+	* @param count Number of particles, stays constant during the simulation
+	* @param threadCount Number of threads the updates are distributed over, 0 uses all hardware threads
+	*/
+	void ParticleEngine::reset(uint32_t count, uint32_t threadCount)
+	{
+		assert(count < (1u << 28));
+		particleCount = count;
+		primaries = count;
+		frameIndex = 0;
+		rng.key = (CounterRng{}.key ^ (seed * 0x9e3779b97f4a7c15ull)) | 1;
+		for (std::vector<float>& stream : streams) {
+			stream.resize(count);
+		}
+		for (uint32_t i = 0; i < count; i++) {
+			spawnPrimary(i, counter(i, 0));
+			// Spread the particles over their lifetime, so they don't all die at the same time
+			streams[Alpha][i] = rng.uniform(counter(i, 12), 0.0f, settings.lifetimeAlpha);
+		}
+		frameIndex = 1;
+		threadCount = (threadCount > 0) ? threadCount : std::max(std::thread::hardware_concurrency(), 1u);
+		threadPool = std::make_unique<ThreadPool>();
+		threadPool->setThreadCount(threadCount);
+		statistics = {};
+		totalUpdateTime = 0.0;
+		totalParticlesUpdated = 0;
+		totalSortTime = 0.0;
+		totalParticlesSorted = 0;
+	}
+
+	uint32_t ParticleEngine::count() const
+	{
+		return particleCount;
+	}
+
+	uint32_t ParticleEngine::primaryCount() const
+	{
+		return primaries;
+	}
+
+	// Every particle draws up to 16 numbers per frame
+	uint64_t ParticleEngine::counter(uint32_t index, uint32_t draw) const
+	{
+		return (static_cast<uint64_t>(frameIndex) << 32) | (static_cast<uint64_t>(index) << 4) | draw;
+	}
+
+	void ParticleEngine::spawnPrimary(uint32_t index, uint64_t counterBase)
+	{
+		const TypeSettings& type = settings.types[Primary];
+		// Random point in a sphere around the emitter, denser towards the center
+		const float theta = rng.uniform(counterBase + 0, 0.0f, 2.0f * 3.14159265f);
+		const float phi = rng.uniform(counterBase + 1, -0.5f * 3.14159265f, 0.5f * 3.14159265f);
+		const float radius = rng.uniform(counterBase + 2, 0.0f, settings.emitterRadius);
+		streams[PositionX][index] = settings.emitterPosition[0] + radius * std::cos(theta) * std::cos(phi);
+		streams[PositionY][index] = settings.emitterPosition[1] + radius * std::sin(phi);
+		streams[PositionZ][index] = settings.emitterPosition[2] + radius * std::sin(theta) * std::cos(phi);
+		for (uint32_t i = 0; i < 3; i++) {
+			streams[VelocityX + i][index] = rng.uniform(counterBase + 3 + i, type.velocityMin[i], type.velocityMax[i]);
+		}
+		streams[Alpha][index] = rng.uniform(counterBase + 6, type.alphaMin, type.alphaMax);
+		streams[Size][index] = rng.uniform(counterBase + 7, type.sizeMin, type.sizeMax);
+		streams[Color][index] = rng.uniform(counterBase + 8, type.colorMin, type.colorMax);
+		streams[Rotation][index] = rng.uniform(counterBase + 9, 0.0f, 2.0f * 3.14159265f);
+		streams[RotationSpeed][index] = rng.uniform(counterBase + 10, type.rotationSpeedMin, type.rotationSpeedMax);
+	}
+
+	// Turns the primary particle at index into a secondary particle, it keeps its (scaled) position and rotation
+	void ParticleEngine::spawnSecondary(uint32_t index, uint64_t counterBase)
+	{
+		const TypeSettings& type = settings.types[Secondary];
+		for (uint32_t i = 0; i < 3; i++) {
+			float& position = streams[PositionX + i][index];
+			position = settings.emitterPosition[i] + (position - settings.emitterPosition[i]) * settings.transitionPositionScale[i];
+			streams[VelocityX + i][index] = rng.uniform(counterBase + 3 + i, type.velocityMin[i], type.velocityMax[i]);
+		}
+		streams[Alpha][index] = rng.uniform(counterBase + 6, type.alphaMin, type.alphaMax);
+		streams[Size][index] = rng.uniform(counterBase + 7, type.sizeMin, type.sizeMax);
+		streams[Color][index] = rng.uniform(counterBase + 8, type.colorMin, type.colorMax);
+		streams[RotationSpeed][index] = rng.uniform(counterBase + 10, type.rotationSpeedMin, type.rotationSpeedMax);
+	}
+
+	void ParticleEngine::swapParticles(uint32_t a, uint32_t b)
+	{
+		for (std::vector<float>& stream : streams) {
+			std::swap(stream[a], stream[b]);
+		}
+	}
+
+	/*
+		Advance all particles of a chunk, which only contains particles of a single type, so the rates are the same for all lanes
+		Particles reaching the end of their life are rare, so they are collected from a lane mask and handled one by one
+	*/
+	void ParticleEngine::updateChunk(Chunk& chunk, float deltaTime)
+	{
+		const TypeSettings& type = settings.types[chunk.type];
+		const float velocityStep = type.velocityScale * deltaTime;
+		const float alphaStep = type.alphaRate * deltaTime;
+		const float sizeStep = type.sizeRate * deltaTime;
+		const float colorStep = type.colorRate * deltaTime;
+		const float rotationStep = type.rotationRate * deltaTime;
+		float* positions[3] = { streams[PositionX].data(), streams[PositionY].data(), streams[PositionZ].data() };
+		const float* velocities[3] = { streams[VelocityX].data(), streams[VelocityY].data(), streams[VelocityZ].data() };
+		float* alpha = streams[Alpha].data();
+		float* size = streams[Size].data();
+		float* color = streams[Color].data();
+		float* rotation = streams[Rotation].data();
+		const float* rotationSpeed = streams[RotationSpeed].data();
+
+		std::vector<uint32_t>& expired = chunk.transitions;
+		expired.clear();
+		uint32_t i = chunk.begin;
+#if defined(VKS_PARTICLES_SSE)
+		const __m128 velocityStep4 = _mm_set1_ps(velocityStep);
+		const __m128 alphaStep4 = _mm_set1_ps(alphaStep);
+		const __m128 sizeStep4 = _mm_set1_ps(sizeStep);
+		const __m128 colorStep4 = _mm_set1_ps(colorStep);
+		const __m128 rotationStep4 = _mm_set1_ps(rotationStep);
+		const __m128 lifetime4 = _mm_set1_ps(settings.lifetimeAlpha);
+		for (; i + 4 <= chunk.end; i += 4) {
+			for (uint32_t axis = 0; axis < 3; axis++) {
+				const __m128 position = _mm_add_ps(_mm_loadu_ps(positions[axis] + i), _mm_mul_ps(_mm_loadu_ps(velocities[axis] + i), velocityStep4));
+				_mm_storeu_ps(positions[axis] + i, position);
+			}
+			const __m128 newAlpha = _mm_add_ps(_mm_loadu_ps(alpha + i), alphaStep4);
+			_mm_storeu_ps(alpha + i, newAlpha);
+			_mm_storeu_ps(size + i, _mm_add_ps(_mm_loadu_ps(size + i), sizeStep4));
+			_mm_storeu_ps(color + i, _mm_add_ps(_mm_loadu_ps(color + i), colorStep4));
+			_mm_storeu_ps(rotation + i, _mm_add_ps(_mm_loadu_ps(rotation + i), _mm_mul_ps(_mm_loadu_ps(rotationSpeed + i), rotationStep4)));
+			const int expiredMask = _mm_movemask_ps(_mm_cmpgt_ps(newAlpha, lifetime4));
+			if (expiredMask != 0) {
+				for (uint32_t lane = 0; lane < 4; lane++) {
+					if (expiredMask & (1 << lane)) {
+						expired.push_back(i + lane);
+					}
+				}
+			}
+		}
+#endif
+		// Remainder (and all particles without SSE)
+		for (; i < chunk.end; i++) {
+			for (uint32_t axis = 0; axis < 3; axis++) {
+				positions[axis][i] += velocities[axis][i] * velocityStep;
+			}
+			alpha[i] += alphaStep;
+			size[i] += sizeStep;
+			color[i] += colorStep;
+			rotation[i] += rotationSpeed[i] * rotationStep;
+			if (alpha[i] > settings.lifetimeAlpha) {
+				expired.push_back(i);
+			}
+		}
+
+		if (chunk.type == Primary) {
+			// Primary particles that don't turn into secondary particles are respawned in place
+			const auto respawned = std::remove_if(expired.begin(), expired.end(), [&](uint32_t index) {
+				if (rng.uniform(counter(index, 15)) < settings.transitionChance) {
+					return false;
+				}
+				spawnPrimary(index, counter(index, 0));
+				return true;
+			});
+			expired.erase(respawned, expired.end());
+		}
+	}
+
+	void ParticleEngine::writeVertices(uint32_t begin, uint32_t end, Vertex* vertices) const
+	{
+		for (uint32_t i = begin; i < end; i++) {
+			Vertex& vertex = vertices[i];
+			vertex.position[0] = streams[PositionX][i];
+			vertex.position[1] = streams[PositionY][i];
+			vertex.position[2] = streams[PositionZ][i];
+			vertex.position[3] = 1.0f;
+			const float color = streams[Color][i];
+			vertex.color[0] = color;
+			vertex.color[1] = color;
+			vertex.color[2] = color;
+			vertex.color[3] = color;
+			vertex.alpha = streams[Alpha][i];
+			vertex.size = streams[Size][i];
+			vertex.rotation = streams[Rotation][i];
+			vertex.type = (i < primaries) ? Primary : Secondary;
+		}
+	}
+
+	void ParticleEngine::dispatch(uint32_t jobCount, const std::function<void(uint32_t)>& job)
+	{
+		if ((jobCount == 1) || (threadPool->threads.size() == 1)) {
+			for (uint32_t i = 0; i < jobCount; i++) {
+				job(i);
+			}
+			return;
+		}
+		for (uint32_t i = 0; i < jobCount; i++) {
+			threadPool->threads[i % threadPool->threads.size()]->addJob([&job, i] { job(i); });
+		}
+		threadPool->wait();
+	}
+
+	/**
+	* Advance the simulation and write all particles to a vertex buffer
+	*
+	* @param deltaTime Time step in seconds
+	* @param vertices Receives count() particles in the layout of ParticleEngine::Vertex, usually the mapped memory of a host visible vertex buffer
+	*
+	* @note The vertex buffer is only written to, which is the access pattern write combined (uncached) memory is fast for
+	*/
+	void ParticleEngine::update(float deltaTime, void* vertices)
+	{
+		assert(threadPool);
+		const auto updateStart = std::chrono::high_resolution_clock::now();
+
+		// Chunks never cross the boundary between the two types, so every job runs a single kernel
+		const uint32_t ranges[2][2] = { { 0, primaries }, { primaries, particleCount } };
+		size_t chunkCount = 0;
+		for (uint32_t type = 0; type < 2; type++) {
+			for (uint32_t begin = ranges[type][0]; begin < ranges[type][1]; begin += chunkSize) {
+				if (chunkCount == chunks.size()) {
+					chunks.emplace_back();
+				}
+				Chunk& chunk = chunks[chunkCount++];
+				chunk.begin = begin;
+				chunk.end = std::min(begin + chunkSize, ranges[type][1]);
+				chunk.type = static_cast<Type>(type);
+			}
+		}
+		dispatch(static_cast<uint32_t>(chunkCount), [&](uint32_t index) { updateChunk(chunks[index], deltaTime); });
+
+		/*
+			Move particles that change their type across the boundary between the two ranges
+			Primary particles are swapped with the last primary particle, going backwards, so unprocessed particles are never moved
+			Secondary particles are swapped with the first secondary particle, going forwards, for the same reason
+		*/
+		for (size_t c = chunkCount; c-- > 0;) {
+			const Chunk& chunk = chunks[c];
+			if (chunk.type != Primary) {
+				continue;
+			}
+			for (size_t t = chunk.transitions.size(); t-- > 0;) {
+				const uint32_t index = chunk.transitions[t];
+				primaries--;
+				swapParticles(index, primaries);
+				spawnSecondary(primaries, counter(index, 0));
+			}
+		}
+		for (size_t c = 0; c < chunkCount; c++) {
+			const Chunk& chunk = chunks[c];
+			if (chunk.type != Secondary) {
+				continue;
+			}
+			for (uint32_t index : chunk.transitions) {
+				swapParticles(index, primaries);
+				spawnPrimary(primaries, counter(index, 0));
+				primaries++;
+			}
+		}
+
+		Vertex* output = static_cast<Vertex*>(vertices);
+		const uint32_t writeJobCount = (particleCount + chunkSize - 1) / chunkSize;
+		dispatch(writeJobCount, [&](uint32_t index) { writeVertices(index * chunkSize, std::min((index + 1) * chunkSize, particleCount), output); });
+
+		frameIndex++;
+		statistics.updateTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - updateStart).count();
+		statistics.updateCount++;
+		totalUpdateTime += statistics.updateTime;
+		totalParticlesUpdated += particleCount;
+		statistics.particlesPerMs = (totalUpdateTime > 0.0) ? totalParticlesUpdated / totalUpdateTime : 0.0;
+	}
+
+	/**
+	* Order the particles written by the last update from back to front for alpha blending
+	*
+	* @param depthPlane Plane (xyz normal, w distance) particles are sorted by their signed distance to, in ascending order
+	* For a right handed view matrix this is the third row (view space z), so the particles farthest away from the camera come first
+	* @param indices Receives count() vertex indices in drawing order, usually the mapped memory of a host visible index buffer
+	*
+	* @note Distances are turned into integer keys and ordered with a parallel radix sort, which is linear in the number of particles
+	*/
+	void ParticleEngine::sortByDepth(const float depthPlane[4], uint32_t* indices)
+	{
+		assert(threadPool);
+		const auto sortStart = std::chrono::high_resolution_clock::now();
+
+		sortKeys.resize(particleCount);
+		sortValues.resize(particleCount);
+		const uint32_t jobCount = (particleCount + chunkSize - 1) / chunkSize;
+		dispatch(jobCount, [&](uint32_t index) {
+			const uint32_t end = std::min((index + 1) * chunkSize, particleCount);
+			for (uint32_t i = index * chunkSize; i < end; i++) {
+				const float distance = streams[PositionX][i] * depthPlane[0] + streams[PositionY][i] * depthPlane[1] + streams[PositionZ][i] * depthPlane[2] + depthPlane[3];
+				sortKeys[i] = radixsort::floatKey(distance);
+				sortValues[i] = i;
+			}
+		});
+		radixsort::sort(sortKeys, sortValues, sortScratch, threadPool.get());
+		dispatch(jobCount, [&](uint32_t index) {
+			const uint32_t begin = index * chunkSize;
+			const uint32_t end = std::min(begin + chunkSize, particleCount);
+			std::memcpy(indices + begin, sortValues.data() + begin, (end - begin) * sizeof(uint32_t));
+		});
+
+		statistics.sortTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - sortStart).count();
+		statistics.sortCount++;
+		totalSortTime += statistics.sortTime;
+		totalParticlesSorted += particleCount;
+		statistics.sortMsPerMillion = (totalParticlesSorted > 0) ? totalSortTime * 1000000.0 / totalParticlesSorted : 0.0;
+	}
+}
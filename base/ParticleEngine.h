@@ -0,0 +1,158 @@
+/*
+* CPU particle engine
+*
+* Structure of arrays particle storage partitioned by type, SIMD update kernels run as chunked jobs on a thread pool,
+* a counter based random number generator and direct output into a (persistently mapped) vertex buffer, optional back to front ordering through an index buffer
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+#include "RadixSort.h"
+
+namespace vks
+{
+	class ThreadPool;
+
+	/**
+	* @brief Counter based random number generator (Widynski's "Squares" generator)
+	* @note Each number is a pure function of the key and a counter, so particles can draw random numbers on any thread in any order
+	* and the simulation stays reproducible independent of the number of threads
+	*/
+	struct CounterRng {
+		uint64_t key{ 0x548c9decbce65297ull };
+
+		uint32_t next(uint64_t counter) const;
+		/** @brief Uniformly distributed in [0, 1) */
+		float uniform(uint64_t counter) const;
+		/** @brief Uniformly distributed in [min, max) */
+		float uniform(uint64_t counter, float min, float max) const;
+	};
+
+	/**
+	* @brief Simulates particles of two types, emitted primary particles that either respawn or turn into secondary particles at the end of their life
+	* @note Particles are stored as separate arrays per attribute, primary particles in front of secondary particles,
+	* so each type is updated by its own branch free kernel that processes four particles per SSE instruction.
+	* The update is split into chunks that run as jobs on a thread pool, particles that change their type are moved between the two ranges afterwards.
+	* The vertices for rendering are written straight into the vertex buffer passed to update, without an intermediate copy.
+	*/
+	class ParticleEngine
+	{
+	public:
+		// Layout of a particle in the vertex buffer written by update
+		struct Vertex {
+			float position[4];
+			float color[4];
+			float alpha;
+			float size;
+			float rotation;
+			uint32_t type;
+		};
+
+		enum Type : uint32_t { Primary = 0, Secondary = 1 };
+
+		struct TypeSettings {
+			// Rates of change per second, positions change by the particle's velocity times the velocity scale
+			float velocityScale = 1.0f;
+			float alphaRate = 1.0f;
+			float sizeRate = 0.0f;
+			float colorRate = 0.0f;
+			float rotationRate = 1.0f;
+			// Ranges particles of this type are spawned with
+			float velocityMin[3] = { 0.0f, 0.0f, 0.0f };
+			float velocityMax[3] = { 0.0f, 0.0f, 0.0f };
+			float alphaMin = 0.0f;
+			float alphaMax = 0.0f;
+			float sizeMin = 1.0f;
+			float sizeMax = 1.0f;
+			float colorMin = 1.0f;
+			float colorMax = 1.0f;
+			float rotationSpeedMin = 0.0f;
+			float rotationSpeedMax = 0.0f;
+		};
+
+		struct Settings {
+			TypeSettings types[2];
+			// Primary particles are spawned within a sphere around the emitter
+			float emitterPosition[3] = { 0.0f, 0.0f, 0.0f };
+			float emitterRadius = 1.0f;
+			// Particles reaching this alpha value have reached the end of their life
+			float lifetimeAlpha = 2.0f;
+			// Chance of a primary particle to turn into a secondary particle at the end of its life instead of respawning
+			float transitionChance = 0.05f;
+			// Offset of secondary particles from the emitter relative to the primary particle they were spawned from
+			float transitionPositionScale[3] = { 1.0f, 1.0f, 1.0f };
+		} settings;
+
+		struct Statistics {
+			// Duration of the last update in milliseconds
+			double updateTime = 0.0;
+			// Particles updated per millisecond over all updates since the last reset
+			double particlesPerMs = 0.0;
+			uint64_t updateCount = 0;
+			// Duration of the last depth sort in milliseconds
+			double sortTime = 0.0;
+			// Average cost of sorting one million particles over all sorts since the last reset
+			double sortMsPerMillion = 0.0;
+			uint64_t sortCount = 0;
+		} statistics;
+
+		/** @brief Number of particles updated by a single job */
+		uint32_t chunkSize = 16384;
+		/** @brief Seed of the random number generator, applied on reset */
+		uint64_t seed = 0;
+
+		ParticleEngine();
+		~ParticleEngine();
+
+		void reset(uint32_t count, uint32_t threadCount = 0);
+		void update(float deltaTime, void* vertices);
+		void sortByDepth(const float depthPlane[4], uint32_t* indices);
+		uint32_t count() const;
+		uint32_t primaryCount() const;
+
+	private:
+		// One array per attribute
+		enum Stream : uint32_t { PositionX, PositionY, PositionZ, VelocityX, VelocityY, VelocityZ, Alpha, Size, Color, Rotation, RotationSpeed, StreamCount };
+		struct Chunk {
+			uint32_t begin;
+			uint32_t end;
+			Type type;
+			// Particles of this chunk that reached the end of their life and change their type, sorted by index
+			std::vector<uint32_t> transitions;
+		};
+
+		std::vector<float> streams[StreamCount];
+		uint32_t particleCount = 0;
+		// Primary particles are stored in [0, primaries), secondary particles in [primaries, particleCount)
+		uint32_t primaries = 0;
+		uint32_t frameIndex = 0;
+		double totalUpdateTime = 0.0;
+		uint64_t totalParticlesUpdated = 0;
+		double totalSortTime = 0.0;
+		uint64_t totalParticlesSorted = 0;
+		std::vector<uint32_t> sortKeys;
+		std::vector<uint32_t> sortValues;
+		radixsort::Scratch sortScratch;
+		CounterRng rng;
+		std::unique_ptr<ThreadPool> threadPool;
+		std::vector<Chunk> chunks;
+
+		uint64_t counter(uint32_t index, uint32_t draw) const;
+		void spawnPrimary(uint32_t index, uint64_t counterBase);
+		void spawnSecondary(uint32_t index, uint64_t counterBase);
+		void swapParticles(uint32_t a, uint32_t b);
+		void updateChunk(Chunk& chunk, float deltaTime);
+		void writeVertices(uint32_t begin, uint32_t end, Vertex* vertices) const;
+		void dispatch(uint32_t jobCount, const std::function<void(uint32_t)>& job);
+	};
+}
@@ -0,0 +1,129 @@
+/*
+* CPU radix sort
+*
+* Stable least significant digit radix sort of 32 bit keys with attached values, histograms and scatter passes are distributed over a thread pool
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <functional>
+
+#include "RadixSort.h"
+#include "threadpool.hpp"
+
+namespace vks
+{
+	namespace radixsort
+	{
+		/**
+		* Map a float to an unsigned integer with the same ordering
+		*
+		* @note Positive values get their sign bit set, negative values have all bits flipped so larger magnitudes become smaller keys
+		*/
+		uint32_t floatKey(float value)
+		{
+			uint32_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			const uint32_t mask = (bits & 0x80000000u) ? 0xffffffffu : 0x80000000u;
+			return bits ^ mask;
+		}
+
+		/**
+		* Sort keys in ascending order and reorder values along with them, elements with equal keys keep their relative order
+		*
+		* @param keys Keys to sort, receives the sorted keys
+		* @param values One value per key, receives the values in the order of the sorted keys
+		* @param scratch Temporary storage, keep it around to avoid allocations when sorting repeatedly
+		* @param threadPool (Optional) Thread pool the passes are distributed over, each thread sorts a contiguous slice of the input
+		*
+		* @note Each pass counts the digits of all slices in parallel, turns the counts into per slice output offsets (digit major, so the sort stays stable)
+		* and scatters the slices in parallel. Passes where all keys share the same digit are skipped, which is common for the upper bits of depth keys.
+		*/
+		void sort(std::vector<uint32_t>& keys, std::vector<uint32_t>& values, Scratch& scratch, ThreadPool* threadPool)
+		{
+			assert(keys.size() == values.size());
+			const uint32_t count = static_cast<uint32_t>(keys.size());
+			if (count < 2) {
+				return;
+			}
+			const uint32_t jobCount = (threadPool && (count >= parallelThreshold)) ? std::max(static_cast<uint32_t>(threadPool->threads.size()), 1u) : 1;
+			const uint32_t sliceSize = (count + jobCount - 1) / jobCount;
+			scratch.keys.resize(count);
+			scratch.values.resize(count);
+			scratch.histograms.resize(jobCount * digitCount);
+
+			uint32_t* srcKeys = keys.data();
+			uint32_t* srcValues = values.data();
+			uint32_t* dstKeys = scratch.keys.data();
+			uint32_t* dstValues = scratch.values.data();
+			uint32_t* histograms = scratch.histograms.data();
+
+			auto run = [&](const std::function<void(uint32_t)>& job) {
+				if (jobCount == 1) {
+					job(0);
+					return;
+				}
+				for (uint32_t i = 0; i < jobCount; i++) {
+					threadPool->threads[i]->addJob([&job, i] { job(i); });
+				}
+				threadPool->wait();
+			};
+
+			for (uint32_t shift = 0; shift < 32; shift += digitBits) {
+				run([&](uint32_t job) {
+					uint32_t* histogram = histograms + job * digitCount;
+					std::fill(histogram, histogram + digitCount, 0);
+					const uint32_t end = std::min((job + 1) * sliceSize, count);
+					for (uint32_t i = job * sliceSize; i < end; i++) {
+						histogram[(srcKeys[i] >> shift) & (digitCount - 1)]++;
+					}
+				});
+
+				// Exclusive prefix sum over all digits, for each digit over all slices in order
+				uint32_t offset = 0;
+				bool skipPass = false;
+				for (uint32_t digit = 0; digit < digitCount; digit++) {
+					uint32_t digitTotal = 0;
+					for (uint32_t job = 0; job < jobCount; job++) {
+						uint32_t& entry = histograms[job * digitCount + digit];
+						const uint32_t jobDigitCount = entry;
+						entry = offset + digitTotal;
+						digitTotal += jobDigitCount;
+					}
+					if (digitTotal == count) {
+						skipPass = true;
+						break;
+					}
+					offset += digitTotal;
+				}
+				if (skipPass) {
+					continue;
+				}
+
+				run([&](uint32_t job) {
+					uint32_t* offsets = histograms + job * digitCount;
+					const uint32_t end = std::min((job + 1) * sliceSize, count);
+					for (uint32_t i = job * sliceSize; i < end; i++) {
+						const uint32_t key = srcKeys[i];
+						const uint32_t target = offsets[(key >> shift) & (digitCount - 1)]++;
+						dstKeys[target] = key;
+						dstValues[target] = srcValues[i];
+					}
+				});
+				std::swap(srcKeys, dstKeys);
+				std::swap(srcValues, dstValues);
+			}
+
+			// An odd number of executed passes leaves the result in the scratch arrays
+			if (srcKeys != keys.data()) {
+				keys.swap(scratch.keys);
+				values.swap(scratch.values);
+			}
+		}
+	}
+}
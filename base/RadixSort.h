@@ -0,0 +1,39 @@
+/*
+* CPU radix sort
+*
+* Stable least significant digit radix sort of 32 bit keys with attached values, histograms and scatter passes are distributed over a thread pool
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace vks
+{
+	class ThreadPool;
+
+	namespace radixsort
+	{
+		/** @brief Keys are sorted in four passes of eight bits each */
+		const uint32_t digitBits = 8;
+		const uint32_t digitCount = 1 << digitBits;
+		/** @brief Smaller arrays are sorted on the calling thread only */
+		const uint32_t parallelThreshold = 65536;
+
+		// Storage reused between sorts, so sorting every frame does not allocate
+		struct Scratch {
+			std::vector<uint32_t> keys;
+			std::vector<uint32_t> values;
+			// One histogram (and later one set of scatter offsets) per job
+			std::vector<uint32_t> histograms;
+		};
+
+		uint32_t floatKey(float value);
+		void sort(std::vector<uint32_t>& keys, std::vector<uint32_t>& values, Scratch& scratch, ThreadPool* threadPool = nullptr);
+	}
+}
@@ -0,0 +1,247 @@
+/*
+* Signed distance fields
+*
+* Samples the signed distance to a closed triangle mesh on a regular grid, using the CPU bounding volume hierarchy
+* for closest triangle queries, e.g. for colliding simulations against arbitrary meshes on the GPU
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+#include "SignedDistanceField.h"
+#include "threadpool.hpp"
+
+namespace vks
+{
+	namespace sdf
+	{
+		namespace
+		{
+			// Matches the depth limit of the BVH builder, two entries per level
+			const uint32_t stackSize = 128;
+
+			uint32_t resolveThreadCount(uint32_t threadCount)
+			{
+				return (threadCount > 0) ? threadCount : std::max(std::thread::hardware_concurrency(), 1u);
+			}
+
+			float dot(const float a[3], const float b[3])
+			{
+				return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+			}
+
+			void cross(const float a[3], const float b[3], float result[3])
+			{
+				result[0] = a[1] * b[2] - a[2] * b[1];
+				result[1] = a[2] * b[0] - a[0] * b[2];
+				result[2] = a[0] * b[1] - a[1] * b[0];
+			}
+
+			float boxDistanceSquared(const vks::bvh::Node& node, const float point[3])
+			{
+				float result = 0.0f;
+				for (uint32_t i = 0; i < 3; i++) {
+					const float d = std::max(std::max(node.boundsMin[i] - point[i], point[i] - node.boundsMax[i]), 0.0f);
+					result += d * d;
+				}
+				return result;
+			}
+
+			// Closest point on a triangle given as a vertex and two edges (Ericson, Real-Time Collision Detection 5.1.5)
+			void closestPoint(const vks::bvh::Triangle& triangle, const float point[3], float result[3])
+			{
+				const float* a = triangle.v0;
+				const float* ab = triangle.e1;
+				const float* ac = triangle.e2;
+				const float ap[3] = { point[0] - a[0], point[1] - a[1], point[2] - a[2] };
+				auto set = [&](float s, float t) {
+					for (uint32_t i = 0; i < 3; i++) {
+						result[i] = a[i] + ab[i] * s + ac[i] * t;
+					}
+				};
+
+				const float d1 = dot(ab, ap);
+				const float d2 = dot(ac, ap);
+				if (d1 <= 0.0f && d2 <= 0.0f) {
+					return set(0.0f, 0.0f);
+				}
+				// Relative to the second vertex
+				const float bp[3] = { ap[0] - ab[0], ap[1] - ab[1], ap[2] - ab[2] };
+				const float d3 = dot(ab, bp);
+				const float d4 = dot(ac, bp);
+				if (d3 >= 0.0f && d4 <= d3) {
+					return set(1.0f, 0.0f);
+				}
+				const float vc = d1 * d4 - d3 * d2;
+				if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+					return set(d1 / (d1 - d3), 0.0f);
+				}
+				// Relative to the third vertex
+				const float cp[3] = { ap[0] - ac[0], ap[1] - ac[1], ap[2] - ac[2] };
+				const float d5 = dot(ab, cp);
+				const float d6 = dot(ac, cp);
+				if (d6 >= 0.0f && d5 <= d6) {
+					return set(0.0f, 1.0f);
+				}
+				const float vb = d5 * d2 - d1 * d6;
+				if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+					return set(0.0f, d2 / (d2 - d6));
+				}
+				const float va = d3 * d6 - d5 * d4;
+				if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+					const float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+					return set(1.0f - w, w);
+				}
+				const float denominator = 1.0f / (va + vb + vc);
+				set(vb * denominator, vc * denominator);
+			}
+		}
+
+		/**
+		* Signed distance from a point to the closest triangle of the hierarchy
+		* @note Nodes are visited closest first and skipped once their bounds are further away than the closest triangle found so far
+		*/
+		float distance(const vks::bvh::Bvh& bvh, const float point[3])
+		{
+			assert(!bvh.nodes.empty());
+			float closestDistanceSquared = FLT_MAX;
+			// How directly the closest triangle faces the point, decides between triangles sharing the closest point
+			float closestAlignment = -1.0f;
+			float closestSign = 1.0f;
+
+			uint32_t stack[stackSize];
+			uint32_t stackPointer = 0;
+			stack[stackPointer++] = 0;
+			while (stackPointer > 0) {
+				const vks::bvh::Node& node = bvh.nodes[stack[--stackPointer]];
+				if (boxDistanceSquared(node, point) > closestDistanceSquared) {
+					continue;
+				}
+				if (node.triangleCount == 0) {
+					// Push the further child first, so the closer one is visited next
+					const uint32_t left = node.leftFirst;
+					const uint32_t right = node.leftFirst + 1;
+					const bool leftCloser = boxDistanceSquared(bvh.nodes[left], point) <= boxDistanceSquared(bvh.nodes[right], point);
+					stack[stackPointer++] = leftCloser ? right : left;
+					stack[stackPointer++] = leftCloser ? left : right;
+					continue;
+				}
+				for (uint32_t i = node.leftFirst; i < node.leftFirst + node.triangleCount; i++) {
+					const vks::bvh::Triangle& triangle = bvh.triangles[i];
+					float closest[3];
+					closestPoint(triangle, point, closest);
+					const float offset[3] = { point[0] - closest[0], point[1] - closest[1], point[2] - closest[2] };
+					const float distanceSquared = dot(offset, offset);
+					if (distanceSquared > closestDistanceSquared * 1.0001f + FLT_MIN) {
+						continue;
+					}
+					float normal[3];
+					cross(triangle.e1, triangle.e2, normal);
+					const float normalLength = std::sqrt(dot(normal, normal));
+					const float offsetLength = std::sqrt(distanceSquared);
+					const float alignment = ((normalLength > 0.0f) && (offsetLength > 0.0f)) ? std::fabs(dot(offset, normal)) / (normalLength * offsetLength) : 0.0f;
+					// Equally close triangles only replace the current one if they face the point more directly
+					const bool equallyClose = distanceSquared >= closestDistanceSquared * 0.9999f;
+					if (equallyClose && alignment <= closestAlignment) {
+						continue;
+					}
+					closestDistanceSquared = std::min(closestDistanceSquared, distanceSquared);
+					closestAlignment = alignment;
+					closestSign = (dot(offset, normal) < 0.0f) ? -1.0f : 1.0f;
+				}
+			}
+			return closestSign * std::sqrt(closestDistanceSquared);
+		}
+
+		/**
+		* Sample the signed distance to the triangles of a hierarchy on a regular grid
+		* @param grid Receives the samples, the grid is a cube around the bounds of the hierarchy
+		* @param bvh Hierarchy over a closed mesh, see vks::bvh::build
+		* @param resolution Number of samples along each axis
+		* @param padding Border around the bounds of the mesh relative to their largest extent, so distances outside of the mesh can be interpolated
+		* @param threadCount Number of threads sampling slices of the grid, 0 uses all hardware threads
+		*/
+		void build(Grid& grid, const vks::bvh::Bvh& bvh, uint32_t resolution, float padding, uint32_t threadCount)
+		{
+			assert(resolution > 1);
+			const auto tStart = std::chrono::high_resolution_clock::now();
+
+			const vks::bvh::Node& root = bvh.nodes[0];
+			float extent = 0.0f;
+			for (uint32_t i = 0; i < 3; i++) {
+				extent = std::max(extent, root.boundsMax[i] - root.boundsMin[i]);
+			}
+			extent *= 1.0f + 2.0f * padding;
+			grid.resolution = resolution;
+			grid.spacing = extent / static_cast<float>(resolution - 1);
+			for (uint32_t i = 0; i < 3; i++) {
+				grid.origin[i] = (root.boundsMin[i] + root.boundsMax[i]) * 0.5f - extent * 0.5f;
+			}
+			grid.distances.resize(static_cast<size_t>(resolution) * resolution * resolution);
+
+			auto sampleSlices = [&grid, &bvh, resolution](uint32_t begin, uint32_t end) {
+				for (uint32_t z = begin; z < end; z++) {
+					for (uint32_t y = 0; y < resolution; y++) {
+						for (uint32_t x = 0; x < resolution; x++) {
+							const float point[3] = { grid.origin[0] + x * grid.spacing, grid.origin[1] + y * grid.spacing, grid.origin[2] + z * grid.spacing };
+							grid.distances[(static_cast<size_t>(z) * resolution + y) * resolution + x] = distance(bvh, point);
+						}
+					}
+				}
+			};
+
+			threadCount = std::min(resolveThreadCount(threadCount), resolution);
+			if (threadCount == 1) {
+				sampleSlices(0, resolution);
+			} else {
+				const uint32_t sliceCount = (resolution + threadCount - 1) / threadCount;
+				vks::ThreadPool threadPool;
+				threadPool.setThreadCount(threadCount);
+				for (uint32_t i = 0; i < threadCount; i++) {
+					threadPool.threads[i]->addJob([&sampleSlices, i, sliceCount, resolution] { sampleSlices(std::min(i * sliceCount, resolution), std::min((i + 1) * sliceCount, resolution)); });
+				}
+				threadPool.wait();
+			}
+
+			grid.buildTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+		}
+
+		/**
+		* Trilinearly interpolated distance at a point, points outside of the grid add their distance to the grid's border
+		* @note Same lookup as the cloth compute shaders, for checking uploaded fields on the host
+		*/
+		float sample(const Grid& grid, const float point[3])
+		{
+			const float maxCoordinate = static_cast<float>(grid.resolution - 1);
+			float coordinates[3];
+			float outside = 0.0f;
+			uint32_t cell[3];
+			float weights[3];
+			for (uint32_t i = 0; i < 3; i++) {
+				const float coordinate = (point[i] - grid.origin[i]) / grid.spacing;
+				coordinates[i] = std::clamp(coordinate, 0.0f, maxCoordinate);
+				outside += (coordinate - coordinates[i]) * (coordinate - coordinates[i]);
+				cell[i] = std::min(static_cast<uint32_t>(coordinates[i]), grid.resolution - 2);
+				weights[i] = coordinates[i] - static_cast<float>(cell[i]);
+			}
+			auto at = [&grid, &cell](uint32_t x, uint32_t y, uint32_t z) {
+				return grid.distances[(static_cast<size_t>(cell[2] + z) * grid.resolution + cell[1] + y) * grid.resolution + cell[0] + x];
+			};
+			float result = 0.0f;
+			for (uint32_t corner = 0; corner < 8; corner++) {
+				const uint32_t x = corner & 1;
+				const uint32_t y = (corner >> 1) & 1;
+				const uint32_t z = corner >> 2;
+				const float weight = (x ? weights[0] : 1.0f - weights[0]) * (y ? weights[1] : 1.0f - weights[1]) * (z ? weights[2] : 1.0f - weights[2]);
+				result += weight * at(x, y, z);
+			}
+			return result + std::sqrt(outside) * grid.spacing;
+		}
+	}
+}
@@ -0,0 +1,42 @@
+/*
+* Signed distance fields
+*
+* Samples the signed distance to a closed triangle mesh on a regular grid, using the CPU bounding volume hierarchy
+* for closest triangle queries, e.g. for colliding simulations against arbitrary meshes on the GPU
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "Bvh.h"
+
+/*
+	Distances are negative inside of the mesh. The sign is taken from the normal of the closest triangle, which needs a closed mesh
+	with consistent winding, where several triangles are equally close (at edges and corners) the one facing the point most directly decides
+*/
+namespace vks
+{
+	namespace sdf
+	{
+		// Samples are stored x first, then y, then z
+		struct Grid {
+			// Position of the first sample, the sample at (x, y, z) is at origin + (x, y, z) * spacing
+			float origin[3] = { 0.0f, 0.0f, 0.0f };
+			float spacing = 1.0f;
+			uint32_t resolution = 0;
+			std::vector<float> distances;
+			// Build time in milliseconds
+			double buildTime = 0.0;
+		};
+
+		void build(Grid& grid, const vks::bvh::Bvh& bvh, uint32_t resolution, float padding, uint32_t threadCount = 0);
+		float distance(const vks::bvh::Bvh& bvh, const float point[3]);
+		float sample(const Grid& grid, const float point[3]);
+	}
+}
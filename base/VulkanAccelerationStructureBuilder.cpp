@@ -0,0 +1,390 @@
+/*
+* Vulkan acceleration structure builder
+*
+* Batched building, compaction and refitting of ray tracing acceleration structures with a shared scratch buffer
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <algorithm>
+#include <iostream>
+
+#include "VulkanAccelerationStructureBuilder.h"
+#include "VulkanDevice.h"
+
+namespace vks
+{
+	namespace
+	{
+		// Makes the results of acceleration structure builds and copies visible to the following builds, copies and (ray query or ray tracing) shader reads
+		// Also orders the reuse of the scratch buffer between batches, as scratch accesses are acceleration structure accesses
+		void accelerationStructureBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags dstStageMask)
+		{
+			VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+			memoryBarrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+			memoryBarrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, dstStageMask, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+		}
+	}
+
+	/**
+	* Set up the builder for a device with the acceleration structure and buffer device address features enabled
+	*
+	* @param device Pointer to the device the acceleration structures are created on
+	*/
+	void AccelerationStructureBuilder::create(vks::VulkanDevice* device)
+	{
+		this->device = device;
+		const VkDevice logicalDevice = device->m_device;
+		vkCreateAccelerationStructureKHR = reinterpret_cast<PFN_vkCreateAccelerationStructureKHR>(vkGetDeviceProcAddr(logicalDevice, "vkCreateAccelerationStructureKHR"));
+		vkDestroyAccelerationStructureKHR = reinterpret_cast<PFN_vkDestroyAccelerationStructureKHR>(vkGetDeviceProcAddr(logicalDevice, "vkDestroyAccelerationStructureKHR"));
+		vkGetAccelerationStructureBuildSizesKHR = reinterpret_cast<PFN_vkGetAccelerationStructureBuildSizesKHR>(vkGetDeviceProcAddr(logicalDevice, "vkGetAccelerationStructureBuildSizesKHR"));
+		vkGetAccelerationStructureDeviceAddressKHR = reinterpret_cast<PFN_vkGetAccelerationStructureDeviceAddressKHR>(vkGetDeviceProcAddr(logicalDevice, "vkGetAccelerationStructureDeviceAddressKHR"));
+		vkCmdBuildAccelerationStructuresKHR = reinterpret_cast<PFN_vkCmdBuildAccelerationStructuresKHR>(vkGetDeviceProcAddr(logicalDevice, "vkCmdBuildAccelerationStructuresKHR"));
+		vkCmdWriteAccelerationStructuresPropertiesKHR = reinterpret_cast<PFN_vkCmdWriteAccelerationStructuresPropertiesKHR>(vkGetDeviceProcAddr(logicalDevice, "vkCmdWriteAccelerationStructuresPropertiesKHR"));
+		vkCmdCopyAccelerationStructureKHR = reinterpret_cast<PFN_vkCmdCopyAccelerationStructureKHR>(vkGetDeviceProcAddr(logicalDevice, "vkCmdCopyAccelerationStructureKHR"));
+		vkGetBufferDeviceAddressKHR = reinterpret_cast<PFN_vkGetBufferDeviceAddressKHR>(vkGetDeviceProcAddr(logicalDevice, "vkGetBufferDeviceAddressKHR"));
+
+		VkPhysicalDeviceAccelerationStructurePropertiesKHR accelerationStructureProperties{};
+		accelerationStructureProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR;
+		VkPhysicalDeviceProperties2 deviceProperties2{};
+		deviceProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		deviceProperties2.pNext = &accelerationStructureProperties;
+		vkGetPhysicalDeviceProperties2(device->m_physicalDevice, &deviceProperties2);
+		scratchAlignment = std::max<VkDeviceSize>(accelerationStructureProperties.minAccelerationStructureScratchOffsetAlignment, 1);
+	}
+
+	/**
+	* Destroy all acceleration structures and the scratch buffer
+	*/
+	void AccelerationStructureBuilder::destroy()
+	{
+		if (!device) {
+			return;
+		}
+		for (Entry& entry : entries) {
+			destroyAccelerationStructure(entry.accelerationStructure);
+		}
+		entries.clear();
+		if (scratchBuffer != VK_NULL_HANDLE) {
+			vkDestroyBuffer(device->m_device, scratchBuffer, nullptr);
+			vkFreeMemory(device->m_device, scratchMemory, nullptr);
+			scratchBuffer = VK_NULL_HANDLE;
+			scratchMemory = VK_NULL_HANDLE;
+			scratchBufferSize = 0;
+		}
+	}
+
+	/**
+	* Add a bottom level acceleration structure that is created and built with the next call to build
+	*
+	* @param geometries Triangle or AABB geometries, the data they point to needs to stay valid until the build (and for refits)
+	* @param buildRanges One build range per geometry
+	* @param flags (Optional) Build flags, add VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR for acceleration structures that are refit
+	* @param compact (Optional) Compact the acceleration structure after it has been built
+	*
+	* @return Index of the acceleration structure
+	*/
+	uint32_t AccelerationStructureBuilder::addBottomLevel(const std::vector<VkAccelerationStructureGeometryKHR>& geometries, const std::vector<VkAccelerationStructureBuildRangeInfoKHR>& buildRanges, VkBuildAccelerationStructureFlagsKHR flags, bool compact)
+	{
+		return add(VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, geometries, buildRanges, flags, compact);
+	}
+
+	/**
+	* Add a top level acceleration structure that is created and built with the next call to build
+	*
+	* @param instanceData Device address of the VkAccelerationStructureInstanceKHR instances, which need to reference bottom level acceleration structures that already have been built
+	* @param instanceCount Number of instances
+	* @param flags (Optional) Build flags, add VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR for acceleration structures that are refit with updated instances
+	*
+	* @return Index of the acceleration structure
+	*/
+	uint32_t AccelerationStructureBuilder::addTopLevel(VkDeviceAddress instanceData, uint32_t instanceCount, VkBuildAccelerationStructureFlagsKHR flags)
+	{
+		VkAccelerationStructureGeometryKHR geometry{};
+		geometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+		geometry.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+		geometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
+		geometry.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
+		geometry.geometry.instances.arrayOfPointers = VK_FALSE;
+		geometry.geometry.instances.data.deviceAddress = instanceData;
+		VkAccelerationStructureBuildRangeInfoKHR buildRange{};
+		buildRange.primitiveCount = instanceCount;
+		return add(VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR, { geometry }, { buildRange }, flags, false);
+	}
+
+	uint32_t AccelerationStructureBuilder::add(VkAccelerationStructureTypeKHR type, const std::vector<VkAccelerationStructureGeometryKHR>& geometries, const std::vector<VkAccelerationStructureBuildRangeInfoKHR>& buildRanges, VkBuildAccelerationStructureFlagsKHR flags, bool compact)
+	{
+		assert(device);
+		assert(!geometries.empty() && (geometries.size() == buildRanges.size()));
+		Entry entry{};
+		entry.type = type;
+		entry.flags = compact ? (flags | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR) : flags;
+		entry.geometries = geometries;
+		entry.buildRanges = buildRanges;
+		entry.compact = compact;
+
+		std::vector<uint32_t> maxPrimitiveCounts(buildRanges.size());
+		for (size_t i = 0; i < buildRanges.size(); i++) {
+			maxPrimitiveCounts[i] = buildRanges[i].primitiveCount;
+		}
+		VkAccelerationStructureBuildGeometryInfoKHR buildInfo = buildGeometryInfo(entry, VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR);
+		VkAccelerationStructureBuildSizesInfoKHR buildSizes{};
+		buildSizes.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
+		vkGetAccelerationStructureBuildSizesKHR(device->m_device, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildInfo, maxPrimitiveCounts.data(), &buildSizes);
+		entry.accelerationStructure.size = buildSizes.accelerationStructureSize;
+		entry.buildScratchSize = buildSizes.buildScratchSize;
+		entry.updateScratchSize = (flags & VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR) ? buildSizes.updateScratchSize : 0;
+
+		entries.push_back(entry);
+		return static_cast<uint32_t>(entries.size() - 1);
+	}
+
+	/**
+	* Build all acceleration structures added since the last build, compact them and wait for completion
+	* Bottom level acceleration structures are built before top level ones, the builds of each level are batched into as few
+	* vkCmdBuildAccelerationStructuresKHR calls as the scratch budget allows. The sizes before and after compaction are stored in statistics.
+	*
+	* @param queue Queue the builds are submitted to
+	*
+	* @note The scratch buffer may be reallocated, so no refits recorded earlier may still be executing
+	*/
+	void AccelerationStructureBuilder::build(VkQueue queue)
+	{
+		std::vector<uint32_t> levels[2];
+		for (uint32_t i = 0; i < static_cast<uint32_t>(entries.size()); i++) {
+			if (!entries[i].built) {
+				levels[entries[i].type == VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR ? 1 : 0].push_back(i);
+			}
+		}
+		statistics = {};
+		statistics.buildCount = static_cast<uint32_t>(levels[0].size() + levels[1].size());
+		if (statistics.buildCount == 0) {
+			return;
+		}
+
+		// The scratch buffer fits the largest build of a batch and is kept large enough for refitting, so refits never have to reallocate it
+		VkDeviceSize totalScratchSize = 0;
+		VkDeviceSize largestScratchSize = 0;
+		for (const Entry& entry : entries) {
+			const VkDeviceSize scratchSize = vks::tools::alignedVkSize(entry.built ? entry.updateScratchSize : std::max(entry.buildScratchSize, entry.updateScratchSize), scratchAlignment);
+			totalScratchSize += scratchSize;
+			largestScratchSize = std::max(largestScratchSize, scratchSize);
+		}
+		reserveScratch(std::max(std::min(totalScratchSize, maxScratchSize), largestScratchSize));
+		statistics.scratchSize = scratchBufferSize;
+
+		VkCommandBuffer commandBuffer = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		std::vector<uint32_t> compactIndices;
+		for (const std::vector<uint32_t>& level : levels) {
+			if (level.empty()) {
+				continue;
+			}
+			for (uint32_t index : level) {
+				Entry& entry = entries[index];
+				createAccelerationStructure(entry.accelerationStructure, entry.type, entry.accelerationStructure.size);
+				statistics.sizeBeforeCompaction += entry.accelerationStructure.size;
+				if (entry.compact) {
+					compactIndices.push_back(index);
+				}
+			}
+			recordBuilds(commandBuffer, level, VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR);
+			// Top level builds and compaction queries read the bottom level structures
+			accelerationStructureBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR);
+		}
+
+		// Query the compacted sizes
+		VkQueryPool queryPool = VK_NULL_HANDLE;
+		if (!compactIndices.empty()) {
+			VkQueryPoolCreateInfo queryPoolCI{};
+			queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			queryPoolCI.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR;
+			queryPoolCI.queryCount = static_cast<uint32_t>(compactIndices.size());
+			VK_CHECK_RESULT(vkCreateQueryPool(device->m_device, &queryPoolCI, nullptr, &queryPool));
+			std::vector<VkAccelerationStructureKHR> handles;
+			for (uint32_t index : compactIndices) {
+				handles.push_back(entries[index].accelerationStructure.handle);
+			}
+			vkCmdResetQueryPool(commandBuffer, queryPool, 0, queryPoolCI.queryCount);
+			vkCmdWriteAccelerationStructuresPropertiesKHR(commandBuffer, static_cast<uint32_t>(handles.size()), handles.data(), VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, queryPool, 0);
+		}
+		device->flushCommandBuffer(commandBuffer, queue);
+
+		// Copy to compacted storage
+		if (!compactIndices.empty()) {
+			std::vector<VkDeviceSize> compactedSizes(compactIndices.size());
+			VK_CHECK_RESULT(vkGetQueryPoolResults(device->m_device, queryPool, 0, static_cast<uint32_t>(compactIndices.size()), compactedSizes.size() * sizeof(VkDeviceSize), compactedSizes.data(), sizeof(VkDeviceSize), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+			vkDestroyQueryPool(device->m_device, queryPool, nullptr);
+
+			std::vector<AccelerationStructure> uncompacted(compactIndices.size());
+			commandBuffer = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+			for (size_t i = 0; i < compactIndices.size(); i++) {
+				Entry& entry = entries[compactIndices[i]];
+				uncompacted[i] = entry.accelerationStructure;
+				createAccelerationStructure(entry.accelerationStructure, entry.type, compactedSizes[i]);
+				VkCopyAccelerationStructureInfoKHR copyInfo{};
+				copyInfo.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR;
+				copyInfo.src = uncompacted[i].handle;
+				copyInfo.dst = entry.accelerationStructure.handle;
+				copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR;
+				vkCmdCopyAccelerationStructureKHR(commandBuffer, &copyInfo);
+			}
+			device->flushCommandBuffer(commandBuffer, queue);
+			for (AccelerationStructure& accelerationStructure : uncompacted) {
+				destroyAccelerationStructure(accelerationStructure);
+			}
+		}
+
+		for (const std::vector<uint32_t>& level : levels) {
+			for (uint32_t index : level) {
+				entries[index].built = true;
+				statistics.sizeAfterCompaction += entries[index].accelerationStructure.size;
+			}
+		}
+		std::cout << "Built " << statistics.buildCount << " acceleration structures in " << statistics.batchCount << " batches, "
+			<< statistics.sizeBeforeCompaction / 1024 << " KB before and " << statistics.sizeAfterCompaction / 1024 << " KB after compaction, "
+			<< statistics.scratchSize / 1024 << " KB scratch" << std::endl;
+	}
+
+	/**
+	* Record the refit of acceleration structures with their current geometry data, batched like builds
+	* The acceleration structures need to have been built with VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR, and the geometry and primitive counts must not change
+	*
+	* @param commandBuffer Command buffer to record to, outside of a render pass. Writes to the geometry data need to be made visible to VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR before,
+	* and earlier reads of the acceleration structures (e.g. by trace rays) need to have finished
+	* @param indices Indices of the acceleration structures to refit, bottom level structures need to be refit before the top level structures that reference them
+	*/
+	void AccelerationStructureBuilder::refit(VkCommandBuffer commandBuffer, const std::vector<uint32_t>& indices)
+	{
+		std::vector<uint32_t> levels[2];
+		for (uint32_t index : indices) {
+			assert(entries[index].built && (entries[index].flags & VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR));
+			levels[entries[index].type == VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR ? 1 : 0].push_back(index);
+		}
+		for (const std::vector<uint32_t>& level : levels) {
+			if (level.empty()) {
+				continue;
+			}
+			recordBuilds(commandBuffer, level, VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR);
+			accelerationStructureBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+		}
+	}
+
+	/**
+	* Get an acceleration structure, its handle and device address are valid after the build call that built it
+	*/
+	const AccelerationStructureBuilder::AccelerationStructure& AccelerationStructureBuilder::get(uint32_t index) const
+	{
+		assert(index < entries.size());
+		return entries[index].accelerationStructure;
+	}
+
+	void AccelerationStructureBuilder::createAccelerationStructure(AccelerationStructure& accelerationStructure, VkAccelerationStructureTypeKHR type, VkDeviceSize size)
+	{
+		accelerationStructure.size = size;
+		VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, size, &accelerationStructure.buffer, &accelerationStructure.memory));
+		VkAccelerationStructureCreateInfoKHR accelerationStructureCI{};
+		accelerationStructureCI.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
+		accelerationStructureCI.buffer = accelerationStructure.buffer;
+		accelerationStructureCI.size = size;
+		accelerationStructureCI.type = type;
+		VK_CHECK_RESULT(vkCreateAccelerationStructureKHR(device->m_device, &accelerationStructureCI, nullptr, &accelerationStructure.handle));
+		VkAccelerationStructureDeviceAddressInfoKHR deviceAddressInfo{};
+		deviceAddressInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
+		deviceAddressInfo.accelerationStructure = accelerationStructure.handle;
+		accelerationStructure.deviceAddress = vkGetAccelerationStructureDeviceAddressKHR(device->m_device, &deviceAddressInfo);
+	}
+
+	void AccelerationStructureBuilder::destroyAccelerationStructure(AccelerationStructure& accelerationStructure)
+	{
+		if (accelerationStructure.handle != VK_NULL_HANDLE) {
+			vkDestroyAccelerationStructureKHR(device->m_device, accelerationStructure.handle, nullptr);
+		}
+		if (accelerationStructure.buffer != VK_NULL_HANDLE) {
+			vkDestroyBuffer(device->m_device, accelerationStructure.buffer, nullptr);
+			vkFreeMemory(device->m_device, accelerationStructure.memory, nullptr);
+		}
+		accelerationStructure = {};
+	}
+
+	/*
+		Grow the shared scratch buffer to at least the given size, only called from build, which waits for all of its work to finish
+	*/
+	void AccelerationStructureBuilder::reserveScratch(VkDeviceSize size)
+	{
+		if (size <= scratchBufferSize) {
+			return;
+		}
+		if (scratchBuffer != VK_NULL_HANDLE) {
+			vkDestroyBuffer(device->m_device, scratchBuffer, nullptr);
+			vkFreeMemory(device->m_device, scratchMemory, nullptr);
+		}
+		VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, size, &scratchBuffer, &scratchMemory));
+		VkBufferDeviceAddressInfoKHR bufferDeviceAddressInfo{};
+		bufferDeviceAddressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+		bufferDeviceAddressInfo.buffer = scratchBuffer;
+		scratchAddress = vkGetBufferDeviceAddressKHR(device->m_device, &bufferDeviceAddressInfo);
+		scratchBufferSize = size;
+	}
+
+	/*
+		Record builds or updates of acceleration structures of the same level, splitting them into batches whose scratch ranges fit into the scratch buffer
+		Batches are separated by barriers, so the next batch can reuse the scratch memory
+	*/
+	void AccelerationStructureBuilder::recordBuilds(VkCommandBuffer commandBuffer, const std::vector<uint32_t>& indices, VkBuildAccelerationStructureModeKHR mode)
+	{
+		std::vector<VkAccelerationStructureBuildGeometryInfoKHR> buildInfos;
+		std::vector<const VkAccelerationStructureBuildRangeInfoKHR*> buildRanges;
+		VkDeviceSize scratchOffset = 0;
+		bool firstBatch = true;
+		auto flush = [&]() {
+			if (buildInfos.empty()) {
+				return;
+			}
+			if (!firstBatch) {
+				accelerationStructureBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR);
+			}
+			firstBatch = false;
+			vkCmdBuildAccelerationStructuresKHR(commandBuffer, static_cast<uint32_t>(buildInfos.size()), buildInfos.data(), buildRanges.data());
+			if (mode == VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR) {
+				statistics.batchCount++;
+			}
+			buildInfos.clear();
+			buildRanges.clear();
+			scratchOffset = 0;
+		};
+		for (uint32_t index : indices) {
+			const Entry& entry = entries[index];
+			const VkDeviceSize scratchSize = vks::tools::alignedVkSize(mode == VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR ? entry.updateScratchSize : entry.buildScratchSize, scratchAlignment);
+			assert(scratchSize <= scratchBufferSize);
+			if (scratchOffset + scratchSize > scratchBufferSize) {
+				flush();
+			}
+			VkAccelerationStructureBuildGeometryInfoKHR buildInfo = buildGeometryInfo(entry, mode);
+			buildInfo.scratchData.deviceAddress = scratchAddress + scratchOffset;
+			buildInfos.push_back(buildInfo);
+			buildRanges.push_back(entry.buildRanges.data());
+			scratchOffset += scratchSize;
+		}
+		flush();
+	}
+
+	VkAccelerationStructureBuildGeometryInfoKHR AccelerationStructureBuilder::buildGeometryInfo(const Entry& entry, VkBuildAccelerationStructureModeKHR mode) const
+	{
+		VkAccelerationStructureBuildGeometryInfoKHR buildInfo{};
+		buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+		buildInfo.type = entry.type;
+		buildInfo.flags = entry.flags;
+		buildInfo.mode = mode;
+		buildInfo.geometryCount = static_cast<uint32_t>(entry.geometries.size());
+		buildInfo.pGeometries = entry.geometries.data();
+		buildInfo.dstAccelerationStructure = entry.accelerationStructure.handle;
+		if (mode == VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR) {
+			// Updates are done in place
+			buildInfo.srcAccelerationStructure = entry.accelerationStructure.handle;
+		}
+		return buildInfo;
+	}
+}
@@ -0,0 +1,100 @@
+/*
+* Vulkan acceleration structure builder
+*
+* Batched building, compaction and refitting of ray tracing acceleration structures with a shared scratch buffer
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "vulkan/vulkan.h"
+#include "VulkanTools.h"
+
+namespace vks
+{
+	struct VulkanDevice;
+
+	/**
+	* @brief Builds bottom and top level acceleration structures in batches
+	* @note Acceleration structures are added with their geometry and built with the next call to build, which records all pending builds of the same level
+	* into a single vkCmdBuildAccelerationStructuresKHR call. All builds share one scratch buffer that is kept and reused by later builds and refits.
+	* Acceleration structures added with compact set are compacted after they have been built, which changes their device address,
+	* so top level instances need to reference the bottom level structures after the build that compacted them.
+	* Acceleration structures built with VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR can be refit with updated geometry (e.g. skinned vertices) by recording refit,
+	* the geometry descriptions passed on creation are kept and need to stay valid (same buffers and counts) for refitting.
+	*/
+	class AccelerationStructureBuilder
+	{
+	public:
+		struct AccelerationStructure {
+			VkAccelerationStructureKHR handle{ VK_NULL_HANDLE };
+			VkDeviceAddress deviceAddress{ 0 };
+			VkBuffer buffer{ VK_NULL_HANDLE };
+			VkDeviceMemory memory{ VK_NULL_HANDLE };
+			VkDeviceSize size{ 0 };
+		};
+
+		/** @brief Sizes of the acceleration structures built by the last build call */
+		struct Statistics {
+			uint32_t buildCount{ 0 };
+			// Number of vkCmdBuildAccelerationStructuresKHR calls the builds were split into to stay within the scratch budget
+			uint32_t batchCount{ 0 };
+			VkDeviceSize sizeBeforeCompaction{ 0 };
+			VkDeviceSize sizeAfterCompaction{ 0 };
+			VkDeviceSize scratchSize{ 0 };
+		} statistics;
+
+		/** @brief Upper limit for the scratch buffer, builds that need more in total are split into several batches */
+		VkDeviceSize maxScratchSize{ 256ull * 1024 * 1024 };
+
+		void create(vks::VulkanDevice* device);
+		void destroy();
+		uint32_t addBottomLevel(const std::vector<VkAccelerationStructureGeometryKHR>& geometries, const std::vector<VkAccelerationStructureBuildRangeInfoKHR>& buildRanges, VkBuildAccelerationStructureFlagsKHR flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR, bool compact = true);
+		uint32_t addTopLevel(VkDeviceAddress instanceData, uint32_t instanceCount, VkBuildAccelerationStructureFlagsKHR flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
+		void build(VkQueue queue);
+		void refit(VkCommandBuffer commandBuffer, const std::vector<uint32_t>& indices);
+		const AccelerationStructure& get(uint32_t index) const;
+
+	private:
+		struct Entry {
+			AccelerationStructure accelerationStructure;
+			VkAccelerationStructureTypeKHR type;
+			VkBuildAccelerationStructureFlagsKHR flags;
+			std::vector<VkAccelerationStructureGeometryKHR> geometries;
+			std::vector<VkAccelerationStructureBuildRangeInfoKHR> buildRanges;
+			VkDeviceSize buildScratchSize{ 0 };
+			VkDeviceSize updateScratchSize{ 0 };
+			bool compact{ false };
+			bool built{ false };
+		};
+
+		vks::VulkanDevice* device{ nullptr };
+		std::vector<Entry> entries;
+		VkBuffer scratchBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory scratchMemory{ VK_NULL_HANDLE };
+		VkDeviceSize scratchBufferSize{ 0 };
+		VkDeviceAddress scratchAddress{ 0 };
+		VkDeviceSize scratchAlignment{ 256 };
+
+		PFN_vkCreateAccelerationStructureKHR vkCreateAccelerationStructureKHR{ nullptr };
+		PFN_vkDestroyAccelerationStructureKHR vkDestroyAccelerationStructureKHR{ nullptr };
+		PFN_vkGetAccelerationStructureBuildSizesKHR vkGetAccelerationStructureBuildSizesKHR{ nullptr };
+		PFN_vkGetAccelerationStructureDeviceAddressKHR vkGetAccelerationStructureDeviceAddressKHR{ nullptr };
+		PFN_vkCmdBuildAccelerationStructuresKHR vkCmdBuildAccelerationStructuresKHR{ nullptr };
+		PFN_vkCmdWriteAccelerationStructuresPropertiesKHR vkCmdWriteAccelerationStructuresPropertiesKHR{ nullptr };
+		PFN_vkCmdCopyAccelerationStructureKHR vkCmdCopyAccelerationStructureKHR{ nullptr };
+		PFN_vkGetBufferDeviceAddressKHR vkGetBufferDeviceAddressKHR{ nullptr };
+
+		uint32_t add(VkAccelerationStructureTypeKHR type, const std::vector<VkAccelerationStructureGeometryKHR>& geometries, const std::vector<VkAccelerationStructureBuildRangeInfoKHR>& buildRanges, VkBuildAccelerationStructureFlagsKHR flags, bool compact);
+		void createAccelerationStructure(AccelerationStructure& accelerationStructure, VkAccelerationStructureTypeKHR type, VkDeviceSize size);
+		void destroyAccelerationStructure(AccelerationStructure& accelerationStructure);
+		void reserveScratch(VkDeviceSize size);
+		void recordBuilds(VkCommandBuffer commandBuffer, const std::vector<uint32_t>& indices, VkBuildAccelerationStructureModeKHR mode);
+		VkAccelerationStructureBuildGeometryInfoKHR buildGeometryInfo(const Entry& entry, VkBuildAccelerationStructureModeKHR mode) const;
+	};
+}
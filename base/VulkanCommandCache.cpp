@@ -0,0 +1,152 @@
+/*
+* Vulkan secondary command buffer cache
+*
+* Secondary command buffers that are only re-recorded when the state they were recorded from changes
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "VulkanCommandCache.h"
+#include "VulkanDevice.h"
+
+namespace vks
+{
+	/**
+	* Create the command pools and allocate the secondary command buffers of all slots
+	*
+	* @param device Pointer to the device the command buffers are allocated from
+	* @param queueFamilyIndex Queue family of the primary command buffers the slots are executed in
+	* @param threadCount Number of threads recording slots concurrently, each thread gets its own command pool per frame
+	* @param slotsPerThread Number of secondary command buffers per thread
+	* @param (Optional) frameCount Number of frames that may be in flight at the same time, every frame has its own set of slots (Defaults to 1)
+	*/
+	void CommandCache::create(vks::VulkanDevice* device, uint32_t queueFamilyIndex, uint32_t threadCount, uint32_t slotsPerThread, uint32_t frameCount)
+	{
+		assert(!isCreated());
+		assert(threadCount > 0 && frameCount > 0);
+		this->device = device;
+		this->threadCount = threadCount;
+		this->slotsPerThread = slotsPerThread;
+		this->frameCount = frameCount;
+		frameIndex = 0;
+
+		threadFrames.resize(threadCount * frameCount);
+		for (auto& threadFrame : threadFrames) {
+			// Slots are re-recorded individually, so their command buffers need to be resettable
+			threadFrame.commandPool = device->createCommandPool(queueFamilyIndex, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+			threadFrame.slots.resize(slotsPerThread);
+			if (slotsPerThread == 0) {
+				continue;
+			}
+			std::vector<VkCommandBuffer> commandBuffers(slotsPerThread);
+			VkCommandBufferAllocateInfo cmdBufAllocateInfo = vks::initializers::commandBufferAllocateInfo(threadFrame.commandPool, VK_COMMAND_BUFFER_LEVEL_SECONDARY, slotsPerThread);
+			VK_CHECK_RESULT(vkAllocateCommandBuffers(*device, &cmdBufAllocateInfo, commandBuffers.data()));
+			for (uint32_t i = 0; i < slotsPerThread; i++) {
+				threadFrame.slots[i].commandBuffer = commandBuffers[i];
+			}
+		}
+	}
+
+	/**
+	* Destroy all command pools (and with them all command buffers), the GPU must no longer execute any of the slots
+	*/
+	void CommandCache::destroy()
+	{
+		if (!isCreated()) {
+			return;
+		}
+		for (auto& threadFrame : threadFrames) {
+			vkDestroyCommandPool(*device, threadFrame.commandPool, nullptr);
+		}
+		threadFrames.clear();
+		device = nullptr;
+	}
+
+	/**
+	* Select the slots of a frame and reset the statistics
+	*
+	* @param frameIndex Index of the frame, the commands of the last frame that used the same index must have finished executing
+	*/
+	void CommandCache::beginFrame(uint32_t frameIndex)
+	{
+		assert(isCreated());
+		assert(frameIndex < frameCount);
+		this->frameIndex = frameIndex;
+		for (uint32_t t = 0; t < threadCount; t++) {
+			getThreadFrame(t).recordedCount = 0;
+		}
+	}
+
+	/**
+	* Begin recording a slot if its state has changed since it was last recorded
+	*
+	* @param threadIndex Thread the slot belongs to, must only be called from that thread
+	* @param slot Index of the slot within the thread
+	* @param stateHash Hash of everything the recorded commands depend on (see hash())
+	* @param inheritanceInfo Inheritance info of the secondary command buffer
+	* @param (Optional) usageFlags Usage flags for beginning the command buffer (Defaults to VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT)
+	*
+	* @return The begun command buffer that needs to be recorded and ended by the caller, or VK_NULL_HANDLE if the slot's recording is still valid
+	*/
+	VkCommandBuffer CommandCache::record(uint32_t threadIndex, uint32_t slot, uint64_t stateHash, const VkCommandBufferInheritanceInfo& inheritanceInfo, VkCommandBufferUsageFlags usageFlags)
+	{
+		ThreadFrame& threadFrame = getThreadFrame(threadIndex);
+		assert(slot < threadFrame.slots.size());
+		Slot& cacheSlot = threadFrame.slots[slot];
+		if (cacheSlot.recorded && cacheSlot.stateHash == stateHash) {
+			return VK_NULL_HANDLE;
+		}
+		assert(inheritanceInfo.framebuffer == VK_NULL_HANDLE);
+		VkCommandBufferBeginInfo commandBufferBeginInfo = vks::initializers::commandBufferBeginInfo();
+		commandBufferBeginInfo.flags = usageFlags;
+		commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
+		VK_CHECK_RESULT(vkBeginCommandBuffer(cacheSlot.commandBuffer, &commandBufferBeginInfo));
+		cacheSlot.stateHash = stateHash;
+		cacheSlot.recorded = true;
+		threadFrame.recordedCount++;
+		return cacheSlot.commandBuffer;
+	}
+
+	/**
+	* Mark all slots of all frames for re-recording, e.g. after pipelines or the render area changed
+	*/
+	void CommandCache::invalidate()
+	{
+		for (auto& threadFrame : threadFrames) {
+			for (auto& slot : threadFrame.slots) {
+				slot.recorded = false;
+			}
+		}
+	}
+
+	uint32_t CommandCache::getRecordedCount() const
+	{
+		uint32_t count = 0;
+		for (uint32_t t = 0; t < threadCount; t++) {
+			count += getThreadFrame(t).recordedCount;
+		}
+		return count;
+	}
+
+	/**
+	* 64 bit FNV-1a hash of raw memory
+	*
+	* @param data Pointer to the data to hash, structures should not contain uninitialized padding
+	* @param size Size of the data in bytes
+	* @param (Optional) seed Result of a previous call to combine multiple values (Defaults to hashSeed)
+	*
+	* @return Hash of the data
+	*/
+	uint64_t CommandCache::hash(const void* data, size_t size, uint64_t seed)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		uint64_t result = seed;
+		for (size_t i = 0; i < size; i++) {
+			result ^= bytes[i];
+			result *= 1099511628211ull;
+		}
+		return result;
+	}
+}
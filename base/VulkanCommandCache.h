@@ -0,0 +1,82 @@
+/*
+* Vulkan secondary command buffer cache
+*
+* Secondary command buffers that are only re-recorded when the state they were recorded from changes
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <cassert>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+#include "VulkanTools.h"
+
+namespace vks
+{
+	struct VulkanDevice;
+
+	/**
+	* @brief Fixed number of secondary command buffers (slots) per recording thread, each tagged with a hash of the state it was recorded from
+	* @note Every thread and frame in flight gets its own command pool, so threads can record their slots concurrently without locking.
+	* record() only hands out a slot's command buffer for recording if the passed state hash differs from the one of its last recording,
+	* unchanged slots are executed as they are. Recordings must not depend on the framebuffer (record with a VK_NULL_HANDLE framebuffer
+	* in the inheritance info), as the same secondary is executed for all swap chain images.
+	*/
+	class CommandCache
+	{
+	public:
+		/** @brief Seed for hash(), pass the result of a previous call to combine several values */
+		static const uint64_t hashSeed = 14695981039346656037ull;
+
+		void create(vks::VulkanDevice* device, uint32_t queueFamilyIndex, uint32_t threadCount, uint32_t slotsPerThread, uint32_t frameCount = 1);
+		void destroy();
+		bool isCreated() const { return device != nullptr; }
+
+		void beginFrame(uint32_t frameIndex);
+		VkCommandBuffer record(uint32_t threadIndex, uint32_t slot, uint64_t stateHash, const VkCommandBufferInheritanceInfo& inheritanceInfo, VkCommandBufferUsageFlags usageFlags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT);
+		void invalidate();
+
+		/** @brief Command buffer of a slot in the current frame, valid for execution once it has been recorded */
+		VkCommandBuffer get(uint32_t threadIndex, uint32_t slot) const { return getThreadFrame(threadIndex).slots[slot].commandBuffer; }
+		uint32_t getThreadCount() const { return threadCount; }
+		uint32_t getSlotsPerThread() const { return slotsPerThread; }
+		/** @brief Number of slots re-recorded in the current frame so far */
+		uint32_t getRecordedCount() const;
+
+		template <typename T>
+		static uint64_t hash(const T& value, uint64_t seed = hashSeed)
+		{
+			return hash(&value, sizeof(T), seed);
+		}
+		static uint64_t hash(const void* data, size_t size, uint64_t seed = hashSeed);
+
+	private:
+		struct Slot {
+			VkCommandBuffer commandBuffer{ VK_NULL_HANDLE };
+			uint64_t stateHash{ 0 };
+			bool recorded{ false };
+		};
+		// Only ever accessed by the thread it belongs to
+		struct ThreadFrame {
+			VkCommandPool commandPool{ VK_NULL_HANDLE };
+			std::vector<Slot> slots;
+			uint32_t recordedCount{ 0 };
+		};
+
+		vks::VulkanDevice* device{ nullptr };
+		uint32_t threadCount{ 0 };
+		uint32_t slotsPerThread{ 0 };
+		uint32_t frameCount{ 0 };
+		uint32_t frameIndex{ 0 };
+		// Indexed by frame * threadCount + thread
+		std::vector<ThreadFrame> threadFrames;
+
+		ThreadFrame& getThreadFrame(uint32_t threadIndex) { assert(threadIndex < threadCount); return threadFrames[frameIndex * threadCount + threadIndex]; }
+		const ThreadFrame& getThreadFrame(uint32_t threadIndex) const { assert(threadIndex < threadCount); return threadFrames[frameIndex * threadCount + threadIndex]; }
+	};
+}
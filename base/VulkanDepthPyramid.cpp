@@ -0,0 +1,290 @@
+/*
+* Vulkan hierarchical depth pyramid
+*
+* Mip chain of the farthest depth values of a depth buffer, built with a single compute dispatch for hierarchical-z (Hi-Z) occlusion culling
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <string>
+
+#include "VulkanDepthPyramid.h"
+#include "VulkanDevice.h"
+
+namespace vks
+{
+	namespace
+	{
+		// Size of the level image array of the depth pyramid shader, enough for 32768 x 32768 depth buffers
+		const uint32_t maxLevels = 16;
+		// Level 0 texels covered by one workgroup along each axis
+		const uint32_t tileSize = 32;
+
+		// Push constant block of the depth pyramid shader
+		struct ReductionParams {
+			int32_t inputSize[2];
+			int32_t outputSize[2];
+			int32_t levelCount;
+			uint32_t workgroupCount;
+		};
+
+		uint32_t previousPowerOfTwo(uint32_t value)
+		{
+			uint32_t result = 1;
+			while (result * 2 <= value) {
+				result *= 2;
+			}
+			return result;
+		}
+	}
+
+	/**
+	* Create the pyramid for a depth buffer and the compute pipeline that builds it
+	*
+	* @param device Pointer to the device the pyramid is created on
+	* @param queue Queue used to clear the pyramid after creation
+	* @param depthImage Depth buffer the pyramid is built from, needs to be created with VK_IMAGE_USAGE_SAMPLED_BIT
+	* @param depthFormat Format of the depth buffer
+	* @param depthWidth Width of the depth buffer
+	* @param depthHeight Height of the depth buffer
+	* @param shaderStage Compute shader stage of base/depthpyramid.comp, if its module is VK_NULL_HANDLE (e.g. the shader hasn't been compiled) the pyramid is never built and stays at the far plane, so nothing gets culled
+	* @param (Optional) pipelineCache Pipeline cache used for creating the compute pipeline
+	*
+	* @note Needs to be recreated if the depth buffer is recreated (e.g. on window resize)
+	* @note The levels are bound as an array of 16 storage images, which is above the minimum of maxPerStageDescriptorStorageImages but supported by all desktop implementations
+	*/
+	void DepthPyramid::create(vks::VulkanDevice* device, VkQueue queue, VkImage depthImage, VkFormat depthFormat, uint32_t depthWidth, uint32_t depthHeight, VkPipelineShaderStageCreateInfo shaderStage, VkPipelineCache pipelineCache)
+	{
+		this->device = device;
+		this->depthImage = depthImage;
+		this->depthWidth = depthWidth;
+		this->depthHeight = depthHeight;
+		const VkDevice logicalDevice = device->m_device;
+
+		width = previousPowerOfTwo(depthWidth);
+		height = previousPowerOfTwo(depthHeight);
+		mipLevels = 1;
+		while ((std::max(width, height) >> mipLevels) > 0) {
+			mipLevels++;
+		}
+		assert(mipLevels <= maxLevels);
+		if (device->m_vkPhysicalDeviceProperties.limits.maxPerStageDescriptorStorageImages < maxLevels) {
+			vks::tools::exitFatal("The depth pyramid requires at least " + std::to_string(maxLevels) + " storage images per shader stage", -1);
+		}
+
+		// Pyramid image
+		VkImageCreateInfo imageCI = vks::initializers::imageCreateInfo();
+		imageCI.imageType = VK_IMAGE_TYPE_2D;
+		imageCI.format = VK_FORMAT_R32_SFLOAT;
+		imageCI.extent = { width, height, 1 };
+		imageCI.mipLevels = mipLevels;
+		imageCI.arrayLayers = 1;
+		imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageCI.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VK_CHECK_RESULT(vkCreateImage(logicalDevice, &imageCI, nullptr, &image));
+		VkMemoryRequirements memReqs;
+		vkGetImageMemoryRequirements(logicalDevice, image, &memReqs);
+		VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
+		memAllocInfo.allocationSize = memReqs.size;
+		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		VK_CHECK_RESULT(vkAllocateMemory(logicalDevice, &memAllocInfo, nullptr, &memory));
+		VK_CHECK_RESULT(vkBindImageMemory(logicalDevice, image, memory, 0));
+
+		VkImageViewCreateInfo viewCI = vks::initializers::imageViewCreateInfo();
+		viewCI.image = image;
+		viewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewCI.format = VK_FORMAT_R32_SFLOAT;
+		viewCI.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1 };
+		VK_CHECK_RESULT(vkCreateImageView(logicalDevice, &viewCI, nullptr, &view));
+		mipViews.resize(mipLevels);
+		for (uint32_t i = 0; i < mipLevels; i++) {
+			viewCI.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, i, 1, 0, 1 };
+			VK_CHECK_RESULT(vkCreateImageView(logicalDevice, &viewCI, nullptr, &mipViews[i]));
+		}
+
+		// Only the depth aspect can be sampled
+		depthAspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		if (vks::tools::formatHasStencil(depthFormat)) {
+			depthAspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
+		viewCI.image = depthImage;
+		viewCI.format = depthFormat;
+		viewCI.subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+		VK_CHECK_RESULT(vkCreateImageView(logicalDevice, &viewCI, nullptr, &depthView));
+
+		VkSamplerCreateInfo samplerCI = vks::initializers::samplerCreateInfo();
+		samplerCI.magFilter = VK_FILTER_NEAREST;
+		samplerCI.minFilter = VK_FILTER_NEAREST;
+		samplerCI.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerCI.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerCI.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerCI.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerCI.minLod = 0.0f;
+		samplerCI.maxLod = 0.0f;
+		samplerCI.maxAnisotropy = 1.0f;
+		VK_CHECK_RESULT(vkCreateSampler(logicalDevice, &samplerCI, nullptr, &reductionSampler));
+		samplerCI.maxLod = static_cast<float>(mipLevels);
+		VK_CHECK_RESULT(vkCreateSampler(logicalDevice, &samplerCI, nullptr, &sampler));
+		descriptor = vks::initializers::descriptorImageInfo(sampler, view, VK_IMAGE_LAYOUT_GENERAL);
+
+		VK_CHECK_RESULT(device->createBuffer(
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			&counterBuffer,
+			sizeof(uint32_t)));
+
+		// A single set with the depth buffer as input and all levels as outputs
+		std::vector<VkDescriptorPoolSize> poolSizes = {
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, maxLevels),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1),
+		};
+		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, 1);
+		VK_CHECK_RESULT(vkCreateDescriptorPool(logicalDevice, &descriptorPoolInfo, nullptr, &descriptorPool));
+		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 1, maxLevels),
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2),
+		};
+		VkDescriptorSetLayoutCreateInfo descriptorLayout = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(logicalDevice, &descriptorLayout, nullptr, &descriptorSetLayout));
+		VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayout, 1);
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(logicalDevice, &allocInfo, &descriptorSet));
+		VkDescriptorImageInfo inputDescriptor = vks::initializers::descriptorImageInfo(reductionSampler, depthView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+		// Array elements beyond the last level are never accessed by the shader, but still need valid views
+		std::vector<VkDescriptorImageInfo> levelDescriptors(maxLevels);
+		for (uint32_t i = 0; i < maxLevels; i++) {
+			levelDescriptors[i] = vks::initializers::descriptorImageInfo(VK_NULL_HANDLE, mipViews[std::min(i, mipLevels - 1)], VK_IMAGE_LAYOUT_GENERAL);
+		}
+		std::array<VkWriteDescriptorSet, 3> writeDescriptorSets = {
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &inputDescriptor),
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, levelDescriptors.data(), maxLevels),
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &counterBuffer.descriptor),
+		};
+		vkUpdateDescriptorSets(logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+
+		// Pipeline, the reduction is selected with a specialization constant
+		VkPushConstantRange pushConstantRange = vks::initializers::pushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(ReductionParams), 0);
+		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = vks::initializers::pipelineLayoutCreateInfo(&descriptorSetLayout, 1);
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+		VK_CHECK_RESULT(vkCreatePipelineLayout(logicalDevice, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout));
+		if (shaderStage.module != VK_NULL_HANDLE) {
+			const VkBool32 reduceMin = (reduction == Reduction::Min) ? VK_TRUE : VK_FALSE;
+			VkSpecializationMapEntry specializationMapEntry = vks::initializers::specializationMapEntry(0, 0, sizeof(VkBool32));
+			VkSpecializationInfo specializationInfo = vks::initializers::specializationInfo(1, &specializationMapEntry, sizeof(VkBool32), &reduceMin);
+			shaderStage.pSpecializationInfo = &specializationInfo;
+			VkComputePipelineCreateInfo computePipelineCreateInfo = vks::initializers::computePipelineCreateInfo(pipelineLayout, 0);
+			computePipelineCreateInfo.stage = shaderStage;
+			VK_CHECK_RESULT(vkCreateComputePipelines(logicalDevice, pipelineCache, 1, &computePipelineCreateInfo, nullptr, &pipeline));
+		}
+
+		// Everything is visible until the pyramid has been built for the first time
+		VkCommandPool commandPool = device->createCommandPool(device->queueFamilyIndices.graphics);
+		VkCommandBuffer commandBuffer = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, commandPool, true);
+		const VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1 };
+		vks::tools::setImageLayout(commandBuffer, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, subresourceRange);
+		const float farDepth = (reduction == Reduction::Min) ? 0.0f : 1.0f;
+		const VkClearColorValue farPlane = { { farDepth, farDepth, farDepth, farDepth } };
+		vkCmdClearColorImage(commandBuffer, image, VK_IMAGE_LAYOUT_GENERAL, &farPlane, 1, &subresourceRange);
+		vks::tools::insertImageMemoryBarrier(commandBuffer, image, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, subresourceRange);
+		vkCmdFillBuffer(commandBuffer, counterBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+		device->flushCommandBuffer(commandBuffer, queue, commandPool);
+		vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
+	}
+
+	/**
+	* Release all Vulkan resources of the pyramid
+	*/
+	void DepthPyramid::destroy()
+	{
+		if (!device) {
+			return;
+		}
+		const VkDevice logicalDevice = device->m_device;
+		vkDestroyPipeline(logicalDevice, pipeline, nullptr);
+		vkDestroyPipelineLayout(logicalDevice, pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(logicalDevice, descriptorSetLayout, nullptr);
+		vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
+		vkDestroySampler(logicalDevice, sampler, nullptr);
+		vkDestroySampler(logicalDevice, reductionSampler, nullptr);
+		vkDestroyImageView(logicalDevice, depthView, nullptr);
+		for (VkImageView mipView : mipViews) {
+			vkDestroyImageView(logicalDevice, mipView, nullptr);
+		}
+		vkDestroyImageView(logicalDevice, view, nullptr);
+		vkDestroyImage(logicalDevice, image, nullptr);
+		vkFreeMemory(logicalDevice, memory, nullptr);
+		counterBuffer.destroy();
+		mipViews.clear();
+		descriptorSet = VK_NULL_HANDLE;
+		device = nullptr;
+	}
+
+	/**
+	* Record the commands that build all levels of the pyramid from the depth buffer
+	*
+	* @param commandBuffer Command buffer to record to, outside of a render pass after the depth buffer has been written
+	*
+	* @note Expects the depth buffer in VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL and leaves it in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+	* Reads of the pyramid by earlier commands (e.g. culling against the previous frame's pyramid) finish before it is overwritten
+	*/
+	void DepthPyramid::build(VkCommandBuffer commandBuffer)
+	{
+		const VkImageSubresourceRange depthRange = { depthAspectMask, 0, 1, 0, 1 };
+		const VkImageSubresourceRange pyramidRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1 };
+		vks::tools::insertImageMemoryBarrier(commandBuffer, depthImage,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			depthRange);
+		// Without a pipeline the pyramid keeps its far plane clear values, the depth buffer still has to end up in the documented layout
+		if (pipeline == VK_NULL_HANDLE) {
+			return;
+		}
+		vks::tools::insertImageMemoryBarrier(commandBuffer, image,
+			VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			pyramidRange);
+		// The counter has been reset by the last workgroup of the previous build (or filled on creation)
+		VkBufferMemoryBarrier counterBarrier = vks::initializers::bufferMemoryBarrier();
+		counterBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+		counterBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		counterBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		counterBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		counterBarrier.buffer = counterBuffer.buffer;
+		counterBarrier.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &counterBarrier, 0, nullptr);
+
+		// One workgroup per tile of level 0, level 5 has one texel per workgroup
+		const uint32_t groupCountX = (width + tileSize - 1) / tileSize;
+		const uint32_t groupCountY = (height + tileSize - 1) / tileSize;
+		ReductionParams params{};
+		params.inputSize[0] = static_cast<int32_t>(depthWidth);
+		params.inputSize[1] = static_cast<int32_t>(depthHeight);
+		params.outputSize[0] = static_cast<int32_t>(width);
+		params.outputSize[1] = static_cast<int32_t>(height);
+		params.levelCount = static_cast<int32_t>(mipLevels);
+		params.workgroupCount = groupCountX * groupCountY;
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReductionParams), &params);
+		vkCmdDispatch(commandBuffer, groupCountX, groupCountY, 1);
+
+		// Later culling passes read all levels
+		vks::tools::insertImageMemoryBarrier(commandBuffer, image,
+			VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			pyramidRange);
+	}
+}
@@ -0,0 +1,74 @@
+/*
+* Vulkan hierarchical depth pyramid
+*
+* Mip chain of the farthest depth values of a depth buffer, built with a single compute dispatch for hierarchical-z (Hi-Z) occlusion culling
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "vulkan/vulkan.h"
+#include "VulkanTools.h"
+#include "VulkanBuffer.h"
+
+namespace vks
+{
+	struct VulkanDevice;
+
+	/**
+	* @brief Hierarchical depth pyramid of a depth buffer for occlusion culling
+	* @note Mip 0 has the size of the largest power of two that fits into the depth buffer, every texel stores the farthest depth
+	* of all depth buffer texels it covers. Every further level stores the farthest depth of the texels of the previous level it covers.
+	* An object is occluded if the nearest depth of its bounds is behind the texels of the level that covers its screen rectangle with 2 x 2 texels.
+	* The pyramid is kept in VK_IMAGE_LAYOUT_GENERAL and cleared to the far plane on creation, so nothing is culled before it has been built.
+	*
+	* All levels are built with a single dispatch: Every workgroup reduces a 32 x 32 tile of level 0 down to one texel of level 5 in shared memory,
+	* the last workgroup to finish (found with an atomic counter) reduces the remaining levels. See shaders/glsl/base/hiz.glsl for the matching culling test.
+	*/
+	class DepthPyramid
+	{
+	public:
+		/** @brief Farthest depth for regular depth buffers (far plane at 1), nearest depth for reversed depth buffers (far plane at 0) */
+		enum class Reduction { Max, Min };
+
+		VkImage image{ VK_NULL_HANDLE };
+		VkDeviceMemory memory{ VK_NULL_HANDLE };
+		// View of all levels for sampling
+		VkImageView view{ VK_NULL_HANDLE };
+		// Nearest sampler with clamp to edge addressing, levels are selected with textureLod
+		VkSampler sampler{ VK_NULL_HANDLE };
+		VkDescriptorImageInfo descriptor{};
+		uint32_t width{ 0 };
+		uint32_t height{ 0 };
+		uint32_t mipLevels{ 0 };
+		// Needs to be set before creating the pyramid
+		Reduction reduction{ Reduction::Max };
+
+		void create(vks::VulkanDevice* device, VkQueue queue, VkImage depthImage, VkFormat depthFormat, uint32_t depthWidth, uint32_t depthHeight, VkPipelineShaderStageCreateInfo shaderStage, VkPipelineCache pipelineCache = VK_NULL_HANDLE);
+		void destroy();
+		void build(VkCommandBuffer commandBuffer);
+
+	private:
+		vks::VulkanDevice* device{ nullptr };
+		VkImage depthImage{ VK_NULL_HANDLE };
+		VkImageAspectFlags depthAspectMask{ 0 };
+		VkImageView depthView{ VK_NULL_HANDLE };
+		VkSampler reductionSampler{ VK_NULL_HANDLE };
+		uint32_t depthWidth{ 0 };
+		uint32_t depthHeight{ 0 };
+		std::vector<VkImageView> mipViews;
+		// Number of workgroups that finished the current build, reset by the last one
+		vks::Buffer counterBuffer;
+		VkDescriptorPool descriptorPool{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout descriptorSetLayout{ VK_NULL_HANDLE };
+		// Reads the depth buffer and writes all levels
+		VkDescriptorSet descriptorSet{ VK_NULL_HANDLE };
+		VkPipelineLayout pipelineLayout{ VK_NULL_HANDLE };
+		VkPipeline pipeline{ VK_NULL_HANDLE };
+	};
+}
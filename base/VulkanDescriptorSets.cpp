@@ -0,0 +1,520 @@
+/*
+* Vulkan descriptor sets
+*
+* Backend independent descriptor sets, bindings are written once and are then bound through pooled descriptor sets, push descriptors or descriptor buffers
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "VulkanDescriptorSets.h"
+#include "VulkanDevice.h"
+
+namespace vks
+{
+	/**
+	* Set (or replace) the buffer descriptor of a binding, takes effect with the next update()
+	*
+	* @param binding Binding number of the set layout
+	* @param type Descriptor type of the binding
+	* @param bufferInfo Buffer, offset and range of the descriptor, range must not be VK_WHOLE_SIZE
+	*
+	* @return The set, so writes can be chained
+	*/
+	DescriptorSet& DescriptorSet::writeBuffer(uint32_t binding, VkDescriptorType type, const VkDescriptorBufferInfo& bufferInfo)
+	{
+		assert(bufferInfo.range != VK_WHOLE_SIZE);
+		auto write = std::find_if(writes.begin(), writes.end(), [binding](const Write& write) { return write.binding == binding; });
+		if (write == writes.end()) {
+			write = writes.insert(writes.end(), Write{});
+		}
+		write->binding = binding;
+		write->type = type;
+		write->bufferInfo = bufferInfo;
+		write->imageInfo = {};
+		return *this;
+	}
+
+	/**
+	* Set (or replace) the image or sampler descriptor of a binding, takes effect with the next update()
+	*
+	* @param binding Binding number of the set layout
+	* @param type Descriptor type of the binding
+	* @param imageInfo Sampler, image view and layout of the descriptor
+	*
+	* @return The set, so writes can be chained
+	*/
+	DescriptorSet& DescriptorSet::writeImage(uint32_t binding, VkDescriptorType type, const VkDescriptorImageInfo& imageInfo)
+	{
+		auto write = std::find_if(writes.begin(), writes.end(), [binding](const Write& write) { return write.binding == binding; });
+		if (write == writes.end()) {
+			write = writes.insert(writes.end(), Write{});
+		}
+		write->binding = binding;
+		write->type = type;
+		write->bufferInfo = {};
+		write->imageInfo = imageInfo;
+		return *this;
+	}
+
+	/**
+	* Make the writes of the set visible to the backend, the set must not be in use by the GPU
+	*
+	* @note With the pooled backend this is the only place that calls vkUpdateDescriptorSets, with descriptor buffers the only place that writes descriptor memory
+	*/
+	void DescriptorSet::update()
+	{
+		assert(manager);
+		switch (manager->backend) {
+		case DescriptorBackend::Pooled:
+			manager->updatePooled(*this);
+			break;
+		case DescriptorBackend::Push:
+			manager->updatePush(*this);
+			break;
+		case DescriptorBackend::Buffer:
+			manager->updateBuffer(*this);
+			break;
+		}
+	}
+
+	/**
+	* Bind the set with the backend of the manager that created it, see DescriptorManager::bind()
+	*/
+	void DescriptorSet::bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t setIndex) const
+	{
+		assert(manager);
+		manager->bind(commandBuffer, bindPoint, pipelineLayout, setIndex, *this);
+	}
+
+	/**
+	* Check if a backend can be used on a device
+	*
+	* @param device Device to check
+	* @param backend Backend to check
+	*
+	* @return True if the device supports the backend's extensions and features, those still need to be enabled at device creation (see getRequiredExtensions())
+	*/
+	bool DescriptorManager::isSupported(vks::VulkanDevice* device, DescriptorBackend backend)
+	{
+		switch (backend) {
+		case DescriptorBackend::Pooled:
+			return true;
+		case DescriptorBackend::Push:
+			return device->extensionSupported(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+		case DescriptorBackend::Buffer:
+		{
+			for (const char* extension : getRequiredExtensions(backend)) {
+				if (!device->extensionSupported(extension)) {
+					return false;
+				}
+			}
+			VkPhysicalDeviceBufferDeviceAddressFeatures bufferDeviceAddressFeatures{};
+			bufferDeviceAddressFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+			VkPhysicalDeviceDescriptorBufferFeaturesEXT descriptorBufferFeatures{};
+			descriptorBufferFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT;
+			descriptorBufferFeatures.pNext = &bufferDeviceAddressFeatures;
+			VkPhysicalDeviceFeatures2 features2{};
+			features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			features2.pNext = &descriptorBufferFeatures;
+			vkGetPhysicalDeviceFeatures2(device->m_physicalDevice, &features2);
+			return descriptorBufferFeatures.descriptorBuffer && bufferDeviceAddressFeatures.bufferDeviceAddress;
+		}
+		}
+		return false;
+	}
+
+	/**
+	* Device extensions a backend depends on
+	*
+	* @param backend Backend to get the extensions for
+	*
+	* @return Names of the extensions that need to be enabled at device creation time, the descriptor buffer backend also requires the descriptorBuffer and bufferDeviceAddress features
+	*/
+	std::vector<const char*> DescriptorManager::getRequiredExtensions(DescriptorBackend backend)
+	{
+		switch (backend) {
+		case DescriptorBackend::Push:
+			return { VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME };
+		case DescriptorBackend::Buffer:
+			return { VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME, VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME, VK_KHR_MAINTENANCE3_EXTENSION_NAME };
+		default:
+			return {};
+		}
+	}
+
+	const char* DescriptorManager::getBackendName(DescriptorBackend backend)
+	{
+		switch (backend) {
+		case DescriptorBackend::Pooled:
+			return "Descriptor pools";
+		case DescriptorBackend::Push:
+			return "Push descriptors";
+		case DescriptorBackend::Buffer:
+			return "Descriptor buffers";
+		}
+		return "Unknown";
+	}
+
+	/**
+	* Prepare the manager for one of the backends
+	*
+	* @param device Pointer to the device the descriptors are created on, the backend's extensions must have been enabled on it
+	* @param backend Backend used for all layouts and sets of this manager
+	* @param (Optional) setsPerPool Number of sets of each descriptor pool (pooled backend), a new pool is added once all pools are exhausted
+	* @param (Optional) bufferSize Size of the resource and the sampler descriptor buffer (descriptor buffer backend)
+	*/
+	void DescriptorManager::create(vks::VulkanDevice* device, DescriptorBackend backend, uint32_t setsPerPool, VkDeviceSize bufferSize)
+	{
+		assert(!isCreated());
+		assert(isSupported(device, backend));
+		this->device = device;
+		this->backend = backend;
+		this->setsPerPool = setsPerPool;
+
+		if (backend == DescriptorBackend::Push) {
+			vkCmdPushDescriptorSetKHR = reinterpret_cast<PFN_vkCmdPushDescriptorSetKHR>(vkGetDeviceProcAddr(*device, "vkCmdPushDescriptorSetKHR"));
+			assert(vkCmdPushDescriptorSetKHR);
+		}
+
+		if (backend == DescriptorBackend::Buffer) {
+			vkGetDescriptorSetLayoutSizeEXT = reinterpret_cast<PFN_vkGetDescriptorSetLayoutSizeEXT>(vkGetDeviceProcAddr(*device, "vkGetDescriptorSetLayoutSizeEXT"));
+			vkGetDescriptorSetLayoutBindingOffsetEXT = reinterpret_cast<PFN_vkGetDescriptorSetLayoutBindingOffsetEXT>(vkGetDeviceProcAddr(*device, "vkGetDescriptorSetLayoutBindingOffsetEXT"));
+			vkGetDescriptorEXT = reinterpret_cast<PFN_vkGetDescriptorEXT>(vkGetDeviceProcAddr(*device, "vkGetDescriptorEXT"));
+			vkCmdBindDescriptorBuffersEXT = reinterpret_cast<PFN_vkCmdBindDescriptorBuffersEXT>(vkGetDeviceProcAddr(*device, "vkCmdBindDescriptorBuffersEXT"));
+			vkCmdSetDescriptorBufferOffsetsEXT = reinterpret_cast<PFN_vkCmdSetDescriptorBufferOffsetsEXT>(vkGetDeviceProcAddr(*device, "vkCmdSetDescriptorBufferOffsetsEXT"));
+			vkGetBufferDeviceAddressKHR = reinterpret_cast<PFN_vkGetBufferDeviceAddressKHR>(vkGetDeviceProcAddr(*device, "vkGetBufferDeviceAddressKHR"));
+			assert(vkGetDescriptorSetLayoutSizeEXT && vkGetDescriptorEXT && vkCmdBindDescriptorBuffersEXT && vkCmdSetDescriptorBufferOffsetsEXT && vkGetBufferDeviceAddressKHR);
+
+			descriptorBufferProperties = {};
+			descriptorBufferProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT;
+			VkPhysicalDeviceProperties2 properties2{};
+			properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+			properties2.pNext = &descriptorBufferProperties;
+			vkGetPhysicalDeviceProperties2(device->m_physicalDevice, &properties2);
+
+			// Resource descriptors and sets with samplers are kept apart, as the amount of memory addressable for samplers is often much lower
+			createDescriptorBuffer(descriptorBuffers[0], VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT, std::min(bufferSize, descriptorBufferProperties.maxResourceDescriptorBufferRange));
+			// Combined image samplers need both usages
+			createDescriptorBuffer(descriptorBuffers[1], VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT, std::min(bufferSize, descriptorBufferProperties.maxSamplerDescriptorBufferRange));
+		}
+	}
+
+	/**
+	* Destroy all layouts, sets, pools and descriptor buffers of the manager, the GPU must no longer use any of them
+	*/
+	void DescriptorManager::destroy()
+	{
+		if (!isCreated()) {
+			return;
+		}
+		for (auto& layout : layouts) {
+			vkDestroyDescriptorSetLayout(*device, layout.layout, nullptr);
+		}
+		layouts.clear();
+		sets.clear();
+		for (auto& pool : pools) {
+			vkDestroyDescriptorPool(*device, pool, nullptr);
+		}
+		pools.clear();
+		for (auto& descriptorBuffer : descriptorBuffers) {
+			if (descriptorBuffer.buffer != VK_NULL_HANDLE) {
+				vkUnmapMemory(*device, descriptorBuffer.memory);
+				vkDestroyBuffer(*device, descriptorBuffer.buffer, nullptr);
+				vkFreeMemory(*device, descriptorBuffer.memory, nullptr);
+			}
+			descriptorBuffer = {};
+		}
+		device = nullptr;
+	}
+
+	/**
+	* Create a descriptor set layout for the manager's backend, the layout is owned by the manager
+	*
+	* @param bindings Bindings of the layout, all with a descriptorCount of one and without dynamic descriptor types
+	*
+	* @return The layout, to be used for pipeline layouts and allocate()
+	*/
+	VkDescriptorSetLayout DescriptorManager::createSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+	{
+		assert(isCreated());
+		Layout layout{};
+		layout.bindings = bindings;
+		for (const auto& binding : bindings) {
+			assert(binding.descriptorCount == 1);
+			assert(binding.descriptorType != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC && binding.descriptorType != VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC);
+			layout.containsSamplers |= (binding.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER || binding.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+		}
+
+		VkDescriptorSetLayoutCreateInfo descriptorLayoutCI = vks::initializers::descriptorSetLayoutCreateInfo(bindings);
+		if (backend == DescriptorBackend::Push) {
+			descriptorLayoutCI.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
+		}
+		if (backend == DescriptorBackend::Buffer) {
+			descriptorLayoutCI.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+		}
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(*device, &descriptorLayoutCI, nullptr, &layout.layout));
+
+		if (backend == DescriptorBackend::Buffer) {
+			// Sets are placed back to back in the descriptor buffers, so every set starts at an aligned offset
+			vkGetDescriptorSetLayoutSizeEXT(*device, layout.layout, &layout.size);
+			layout.size = vks::tools::alignedVkSize(layout.size, descriptorBufferProperties.descriptorBufferOffsetAlignment);
+			layout.bindingOffsets.resize(bindings.size());
+			for (size_t i = 0; i < bindings.size(); i++) {
+				vkGetDescriptorSetLayoutBindingOffsetEXT(*device, layout.layout, bindings[i].binding, &layout.bindingOffsets[i]);
+			}
+		}
+
+		layouts.push_back(layout);
+		return layout.layout;
+	}
+
+	/**
+	* Allocate a set, the set's bindings are written with writeBuffer()/writeImage() followed by update()
+	*
+	* @param layout Layout created with createSetLayout() of this manager
+	*
+	* @return Pointer to the set, owned by the manager and valid until destroy()
+	*
+	* @throw Throws an exception if the descriptor buffer the set is placed in is exhausted
+	*/
+	DescriptorSet* DescriptorManager::allocate(VkDescriptorSetLayout layout)
+	{
+		assert(isCreated());
+		const Layout& layoutInfo = getLayout(layout);
+
+		DescriptorSet set{};
+		set.manager = this;
+		set.layout = layout;
+
+		if (backend == DescriptorBackend::Pooled) {
+			// Pools are only added when all existing ones are exhausted, so samples don't have to count their descriptors up front
+			VkResult result = VK_ERROR_OUT_OF_POOL_MEMORY;
+			if (!pools.empty()) {
+				VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(pools.back(), &layout, 1);
+				result = vkAllocateDescriptorSets(*device, &allocInfo, &set.descriptorSet);
+			}
+			if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+				pools.push_back(createPool());
+				VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(pools.back(), &layout, 1);
+				result = vkAllocateDescriptorSets(*device, &allocInfo, &set.descriptorSet);
+			}
+			VK_CHECK_RESULT(result);
+		}
+
+		if (backend == DescriptorBackend::Buffer) {
+			set.bufferIndex = layoutInfo.containsSamplers ? 1 : 0;
+			DescriptorBuffer& descriptorBuffer = descriptorBuffers[set.bufferIndex];
+			const VkDeviceSize offset = vks::tools::alignedVkSize(descriptorBuffer.head, descriptorBufferProperties.descriptorBufferOffsetAlignment);
+			if (offset + layoutInfo.size > descriptorBuffer.size) {
+				throw std::runtime_error("Descriptor set exceeds the size of the descriptor buffer");
+			}
+			set.bufferOffset = offset;
+			descriptorBuffer.head = offset + layoutInfo.size;
+		}
+
+		sets.push_back(set);
+		return &sets.back();
+	}
+
+	/**
+	* Bind the descriptor buffers to a command buffer (descriptor buffer backend only, no-op for the others)
+	*
+	* @param commandBuffer Command buffer to bind the descriptor buffers to, needs to be called before any set of this manager is bound in it
+	*/
+	void DescriptorManager::bindBuffers(VkCommandBuffer commandBuffer) const
+	{
+		if (backend != DescriptorBackend::Buffer) {
+			return;
+		}
+		VkDescriptorBufferBindingInfoEXT bindingInfos[2]{};
+		bindingInfos[0].sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT;
+		bindingInfos[0].address = descriptorBuffers[0].address;
+		bindingInfos[0].usage = VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT;
+		bindingInfos[1].sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT;
+		bindingInfos[1].address = descriptorBuffers[1].address;
+		bindingInfos[1].usage = VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT;
+		vkCmdBindDescriptorBuffersEXT(commandBuffer, 2, bindingInfos);
+	}
+
+	/**
+	* Bind a set to a command buffer
+	*
+	* @param commandBuffer Command buffer to record the bind into
+	* @param bindPoint Pipeline bind point the set is used with
+	* @param pipelineLayout Layout of the pipeline(s) the set is used with
+	* @param setIndex Index of the set in the pipeline layout
+	* @param set Set allocated from this manager
+	*
+	* @note Pooled sets are bound with vkCmdBindDescriptorSets, push descriptor sets record their writes, descriptor buffer sets only set an offset
+	*/
+	void DescriptorManager::bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t setIndex, const DescriptorSet& set) const
+	{
+		assert(set.manager == this);
+		switch (backend) {
+		case DescriptorBackend::Pooled:
+			vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, setIndex, 1, &set.descriptorSet, 0, nullptr);
+			break;
+		case DescriptorBackend::Push:
+			vkCmdPushDescriptorSetKHR(commandBuffer, bindPoint, pipelineLayout, setIndex, static_cast<uint32_t>(set.pushWrites.size()), set.pushWrites.data());
+			break;
+		case DescriptorBackend::Buffer:
+			vkCmdSetDescriptorBufferOffsetsEXT(commandBuffer, bindPoint, pipelineLayout, setIndex, 1, &set.bufferIndex, &set.bufferOffset);
+			break;
+		}
+	}
+
+	const DescriptorManager::Layout& DescriptorManager::getLayout(VkDescriptorSetLayout layout) const
+	{
+		auto it = std::find_if(layouts.begin(), layouts.end(), [layout](const Layout& l) { return l.layout == layout; });
+		assert(it != layouts.end());
+		return *it;
+	}
+
+	VkDescriptorPool DescriptorManager::createPool()
+	{
+		// Sized for sets with a few descriptors of the common types each
+		const uint32_t descriptorsPerSet = 4;
+		std::vector<VkDescriptorPoolSize> poolSizes = {
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, setsPerPool * descriptorsPerSet),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, setsPerPool * descriptorsPerSet),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, setsPerPool * descriptorsPerSet),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, setsPerPool * descriptorsPerSet),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, setsPerPool * descriptorsPerSet),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_SAMPLER, setsPerPool),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, setsPerPool),
+		};
+		VkDescriptorPoolCreateInfo descriptorPoolCI = vks::initializers::descriptorPoolCreateInfo(poolSizes, setsPerPool);
+		VkDescriptorPool pool;
+		VK_CHECK_RESULT(vkCreateDescriptorPool(*device, &descriptorPoolCI, nullptr, &pool));
+		return pool;
+	}
+
+	void DescriptorManager::createDescriptorBuffer(DescriptorBuffer& descriptorBuffer, VkBufferUsageFlags usage, VkDeviceSize size)
+	{
+		descriptorBuffer.size = size;
+		descriptorBuffer.head = 0;
+		VK_CHECK_RESULT(device->createBuffer(usage | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, size, &descriptorBuffer.buffer, &descriptorBuffer.memory));
+		void* data;
+		VK_CHECK_RESULT(vkMapMemory(*device, descriptorBuffer.memory, 0, VK_WHOLE_SIZE, 0, &data));
+		descriptorBuffer.mapped = static_cast<uint8_t*>(data);
+		VkBufferDeviceAddressInfo bufferDeviceAI{};
+		bufferDeviceAI.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+		bufferDeviceAI.buffer = descriptorBuffer.buffer;
+		descriptorBuffer.address = vkGetBufferDeviceAddressKHR(*device, &bufferDeviceAI);
+	}
+
+	void DescriptorManager::updatePooled(DescriptorSet& set)
+	{
+		std::vector<VkWriteDescriptorSet> writeDescriptorSets(set.writes.size());
+		for (size_t i = 0; i < set.writes.size(); i++) {
+			const DescriptorSet::Write& write = set.writes[i];
+			writeDescriptorSets[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptorSets[i].dstSet = set.descriptorSet;
+			writeDescriptorSets[i].dstBinding = write.binding;
+			writeDescriptorSets[i].descriptorCount = 1;
+			writeDescriptorSets[i].descriptorType = write.type;
+			writeDescriptorSets[i].pBufferInfo = &write.bufferInfo;
+			writeDescriptorSets[i].pImageInfo = &write.imageInfo;
+		}
+		vkUpdateDescriptorSets(*device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+	}
+
+	void DescriptorManager::updatePush(DescriptorSet& set)
+	{
+		// The writes point into the set's own write list, which doesn't change until the next update
+		set.pushWrites.resize(set.writes.size());
+		for (size_t i = 0; i < set.writes.size(); i++) {
+			const DescriptorSet::Write& write = set.writes[i];
+			set.pushWrites[i] = {};
+			set.pushWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			set.pushWrites[i].dstSet = VK_NULL_HANDLE;
+			set.pushWrites[i].dstBinding = write.binding;
+			set.pushWrites[i].descriptorCount = 1;
+			set.pushWrites[i].descriptorType = write.type;
+			set.pushWrites[i].pBufferInfo = &write.bufferInfo;
+			set.pushWrites[i].pImageInfo = &write.imageInfo;
+		}
+	}
+
+	void DescriptorManager::updateBuffer(DescriptorSet& set)
+	{
+		const Layout& layout = getLayout(set.layout);
+		uint8_t* setData = descriptorBuffers[set.bufferIndex].mapped + set.bufferOffset;
+		for (const DescriptorSet::Write& write : set.writes) {
+			auto binding = std::find_if(layout.bindings.begin(), layout.bindings.end(), [&write](const VkDescriptorSetLayoutBinding& binding) { return binding.binding == write.binding; });
+			assert(binding != layout.bindings.end());
+			const VkDeviceSize bindingOffset = layout.bindingOffsets[std::distance(layout.bindings.begin(), binding)];
+
+			VkDescriptorGetInfoEXT descriptorInfo{};
+			descriptorInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT;
+			descriptorInfo.type = write.type;
+			// Buffer descriptors are built from device addresses, image descriptors from the image info
+			VkDescriptorAddressInfoEXT addressInfo{};
+			addressInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT;
+			switch (write.type) {
+			case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+			case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+			{
+				VkBufferDeviceAddressInfo bufferDeviceAI{};
+				bufferDeviceAI.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+				bufferDeviceAI.buffer = write.bufferInfo.buffer;
+				addressInfo.address = vkGetBufferDeviceAddressKHR(*device, &bufferDeviceAI) + write.bufferInfo.offset;
+				addressInfo.range = write.bufferInfo.range;
+				addressInfo.format = VK_FORMAT_UNDEFINED;
+				if (write.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
+					descriptorInfo.data.pUniformBuffer = &addressInfo;
+				} else {
+					descriptorInfo.data.pStorageBuffer = &addressInfo;
+				}
+				break;
+			}
+			case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+				descriptorInfo.data.pCombinedImageSampler = &write.imageInfo;
+				break;
+			case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+				descriptorInfo.data.pSampledImage = &write.imageInfo;
+				break;
+			case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+				descriptorInfo.data.pStorageImage = &write.imageInfo;
+				break;
+			case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+				descriptorInfo.data.pInputAttachmentImage = &write.imageInfo;
+				break;
+			case VK_DESCRIPTOR_TYPE_SAMPLER:
+				descriptorInfo.data.pSampler = &write.imageInfo.sampler;
+				break;
+			default:
+				assert(!"Descriptor type not supported by the descriptor buffer backend");
+				break;
+			}
+			vkGetDescriptorEXT(*device, &descriptorInfo, getDescriptorSize(write.type), setData + bindingOffset);
+		}
+	}
+
+	size_t DescriptorManager::getDescriptorSize(VkDescriptorType type) const
+	{
+		switch (type) {
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+			return descriptorBufferProperties.uniformBufferDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+			return descriptorBufferProperties.storageBufferDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+			return descriptorBufferProperties.combinedImageSamplerDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+			return descriptorBufferProperties.sampledImageDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+			return descriptorBufferProperties.storageImageDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+			return descriptorBufferProperties.inputAttachmentDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_SAMPLER:
+			return descriptorBufferProperties.samplerDescriptorSize;
+		default:
+			return 0;
+		}
+	}
+}
@@ -0,0 +1,155 @@
+/*
+* Vulkan descriptor sets
+*
+* Backend independent descriptor sets, bindings are written once and are then bound through pooled descriptor sets, push descriptors or descriptor buffers
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <cassert>
+#include <deque>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+#include "VulkanTools.h"
+
+namespace vks
+{
+	struct VulkanDevice;
+	class DescriptorManager;
+
+	/** @brief How the descriptors of a DescriptorManager reach the GPU */
+	enum class DescriptorBackend {
+		// Descriptor sets allocated from pools managed by the manager, written once with vkUpdateDescriptorSets
+		Pooled,
+		// No sets at all, the writes are recorded into the command buffer with vkCmdPushDescriptorSetKHR (VK_KHR_push_descriptor)
+		Push,
+		// Descriptors are written to host visible memory with vkGetDescriptorEXT and bound by offset (VK_EXT_descriptor_buffer)
+		Buffer
+	};
+
+	/**
+	* @brief Descriptor set created by a DescriptorManager, the same writes work with all backends
+	* @note Only single descriptors per binding are supported and no dynamic descriptor types, as push descriptor and descriptor buffer layouts can't contain those.
+	* Buffer ranges must not be VK_WHOLE_SIZE, as descriptor buffers store the range inside of the descriptor.
+	*/
+	class DescriptorSet
+	{
+	public:
+		DescriptorSet& writeBuffer(uint32_t binding, VkDescriptorType type, const VkDescriptorBufferInfo& bufferInfo);
+		DescriptorSet& writeImage(uint32_t binding, VkDescriptorType type, const VkDescriptorImageInfo& imageInfo);
+		void update();
+		void bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t setIndex) const;
+		VkDescriptorSetLayout getLayout() const { return layout; }
+
+	private:
+		friend class DescriptorManager;
+		struct Write {
+			uint32_t binding;
+			VkDescriptorType type;
+			VkDescriptorBufferInfo bufferInfo;
+			VkDescriptorImageInfo imageInfo;
+		};
+		DescriptorManager* manager{ nullptr };
+		VkDescriptorSetLayout layout{ VK_NULL_HANDLE };
+		std::vector<Write> writes;
+		// Pooled backend
+		VkDescriptorSet descriptorSet{ VK_NULL_HANDLE };
+		// Push backend, built by update() so binding doesn't have to translate the writes
+		std::vector<VkWriteDescriptorSet> pushWrites;
+		// Descriptor buffer backend
+		uint32_t bufferIndex{ 0 };
+		VkDeviceSize bufferOffset{ 0 };
+	};
+
+	/**
+	* @brief Creates set layouts and descriptor sets for one of the descriptor backends and binds them
+	* @note Samples write their bindings once against DescriptorSet and select the backend at runtime with isSupported().
+	* Pipelines using the manager's layouts need to be created with getPipelineCreateFlags(), and with the descriptor buffer backend
+	* bindBuffers() has to be called once per command buffer before the first set is bound. Buffers referenced by descriptor buffer sets
+	* need to be created with getBufferUsageFlags() and thus with the bufferDeviceAddress feature enabled.
+	*/
+	class DescriptorManager
+	{
+	public:
+		/** @brief Default number of sets per descriptor pool of the pooled backend */
+		static const uint32_t defaultSetsPerPool = 256;
+		/** @brief Default size of each descriptor buffer of the descriptor buffer backend */
+		static const VkDeviceSize defaultBufferSize = 256 * 1024;
+
+		static bool isSupported(vks::VulkanDevice* device, DescriptorBackend backend);
+		static std::vector<const char*> getRequiredExtensions(DescriptorBackend backend);
+		static const char* getBackendName(DescriptorBackend backend);
+
+		void create(vks::VulkanDevice* device, DescriptorBackend backend, uint32_t setsPerPool = defaultSetsPerPool, VkDeviceSize bufferSize = defaultBufferSize);
+		void destroy();
+		bool isCreated() const { return device != nullptr; }
+
+		VkDescriptorSetLayout createSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+		DescriptorSet* allocate(VkDescriptorSetLayout layout);
+		void bindBuffers(VkCommandBuffer commandBuffer) const;
+		void bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t setIndex, const DescriptorSet& set) const;
+
+		DescriptorBackend getBackend() const { return backend; }
+		/** @brief Flags the pipelines using the manager's set layouts need to be created with */
+		VkPipelineCreateFlags getPipelineCreateFlags() const { return (backend == DescriptorBackend::Buffer) ? VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT : 0; }
+		/** @brief Usage flags buffers referenced by the manager's sets need to be created with */
+		VkBufferUsageFlags getBufferUsageFlags() const { return (backend == DescriptorBackend::Buffer) ? VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT : 0; }
+		/** @brief Number of sets and bytes of descriptor pool or descriptor buffer memory used by them */
+		uint32_t getSetCount() const { return static_cast<uint32_t>(sets.size()); }
+		VkDeviceSize getBufferUsage() const { return descriptorBuffers[0].head + descriptorBuffers[1].head; }
+		uint32_t getPoolCount() const { return static_cast<uint32_t>(pools.size()); }
+
+	private:
+		friend class DescriptorSet;
+		struct Layout {
+			VkDescriptorSetLayout layout{ VK_NULL_HANDLE };
+			std::vector<VkDescriptorSetLayoutBinding> bindings;
+			// Descriptor buffer backend: size of the layout and offset of every binding (in the order of bindings)
+			VkDeviceSize size{ 0 };
+			std::vector<VkDeviceSize> bindingOffsets;
+			bool containsSamplers{ false };
+		};
+		// Descriptor buffer backend: [0] holds resource descriptors, [1] sets containing samplers or combined image samplers
+		struct DescriptorBuffer {
+			VkBuffer buffer{ VK_NULL_HANDLE };
+			VkDeviceMemory memory{ VK_NULL_HANDLE };
+			uint8_t* mapped{ nullptr };
+			VkDeviceAddress address{ 0 };
+			VkDeviceSize size{ 0 };
+			VkDeviceSize head{ 0 };
+		};
+
+		vks::VulkanDevice* device{ nullptr };
+		DescriptorBackend backend{ DescriptorBackend::Pooled };
+		std::vector<Layout> layouts;
+		// Deque, so pointers to the sets stay valid while more sets are allocated
+		std::deque<DescriptorSet> sets;
+
+		uint32_t setsPerPool{ 0 };
+		std::vector<VkDescriptorPool> pools;
+
+		VkPhysicalDeviceDescriptorBufferPropertiesEXT descriptorBufferProperties{};
+		DescriptorBuffer descriptorBuffers[2];
+
+		PFN_vkCmdPushDescriptorSetKHR vkCmdPushDescriptorSetKHR{ nullptr };
+		PFN_vkGetDescriptorSetLayoutSizeEXT vkGetDescriptorSetLayoutSizeEXT{ nullptr };
+		PFN_vkGetDescriptorSetLayoutBindingOffsetEXT vkGetDescriptorSetLayoutBindingOffsetEXT{ nullptr };
+		PFN_vkGetDescriptorEXT vkGetDescriptorEXT{ nullptr };
+		PFN_vkCmdBindDescriptorBuffersEXT vkCmdBindDescriptorBuffersEXT{ nullptr };
+		PFN_vkCmdSetDescriptorBufferOffsetsEXT vkCmdSetDescriptorBufferOffsetsEXT{ nullptr };
+		PFN_vkGetBufferDeviceAddressKHR vkGetBufferDeviceAddressKHR{ nullptr };
+
+		const Layout& getLayout(VkDescriptorSetLayout layout) const;
+		VkDescriptorPool createPool();
+		void createDescriptorBuffer(DescriptorBuffer& descriptorBuffer, VkBufferUsageFlags usage, VkDeviceSize size);
+		void updatePooled(DescriptorSet& set);
+		void updatePush(DescriptorSet& set);
+		void updateBuffer(DescriptorSet& set);
+		size_t getDescriptorSize(VkDescriptorType type) const;
+	};
+}
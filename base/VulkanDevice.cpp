@@ -14,6 +14,9 @@
 #endif
 #include <VulkanDevice.h>
 #include <unordered_set>
+#include <atomic>
+#include <iostream>
+#include "threadpool.hpp"
 
 namespace vks
 {	
@@ -37,6 +40,30 @@ namespace vks
 		assert(queueFamilyCount > 0);
 		m_vkQueueFamilyProperties.resize(queueFamilyCount);
 		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, m_vkQueueFamilyProperties.data());
+		// Prefer a dedicated transfer family for uploads (falls back to the first family supporting transfers)
+		queueFamilyIndices.transfer = getQueueFamilyIndex(VK_QUEUE_TRANSFER_BIT);
+
+		// Host image copies are core since Vulkan 1.4, all supported features of that version are enabled at device creation
+		if (m_vkPhysicalDeviceProperties.apiVersion >= VK_API_VERSION_1_4 && m_physicalDevice.getPhysicalDeviceFeatures2().m_featuresV14.hostImageCopy)
+		{
+			VkPhysicalDeviceHostImageCopyProperties hostImageCopyProperties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES };
+			VkPhysicalDeviceProperties2 properties2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
+			properties2.pNext = &hostImageCopyProperties;
+			vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+			hostImageCopy.copyDstLayouts.resize(hostImageCopyProperties.copyDstLayoutCount);
+			hostImageCopyProperties.pCopyDstLayouts = hostImageCopy.copyDstLayouts.data();
+			vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+			hostImageCopy.vkCopyMemoryToImage = reinterpret_cast<PFN_vkCopyMemoryToImage>(vkGetDeviceProcAddr(m_device, "vkCopyMemoryToImage"));
+			hostImageCopy.vkTransitionImageLayout = reinterpret_cast<PFN_vkTransitionImageLayout>(vkGetDeviceProcAddr(m_device, "vkTransitionImageLayout"));
+			hostImageCopy.supported = hostImageCopy.vkCopyMemoryToImage && hostImageCopy.vkTransitionImageLayout;
+			if (hostImageCopy.supported)
+			{
+				// The calling thread takes part in the copies, so one thread less is enough
+				const uint32_t threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+				hostImageCopy.threadPool = std::make_unique<vks::ThreadPool>();
+				hostImageCopy.threadPool->setThreadCount(threadCount);
+			}
+		}
 
 		// Get list of supported extensions
 		uint32_t extCount = 0;
@@ -61,6 +88,7 @@ namespace vks
 	*/
 	VulkanDevice::~VulkanDevice()
 	{
+		stagingRing.destroy();
 		if (m_vkCommandPool)
 		{
 			vkDestroyCommandPool(m_device, m_vkCommandPool, nullptr);
@@ -111,21 +139,24 @@ namespace vks
 	* Get the index of a queue family that supports the requested queue flags
 	* SRS - support VkQueueFlags parameter for requesting multiple flags vs. VkQueueFlagBits for a single flag only
 	*
+	* @param queueFamilyProperties Properties of the physical device's queue families
 	* @param queueFlags Queue flags to find a queue family index for
 	*
+	* @note Static so the queue families can be selected before the logical device (and with it this class) is created
+	*
 	* @return Index of the queue family index that matches the flags
 	*
 	* @throw Throws an exception if no queue family index could be found that supports the requested flags
 	*/
-	uint32_t VulkanDevice::getQueueFamilyIndex(VkQueueFlags queueFlags) const
+	uint32_t VulkanDevice::getQueueFamilyIndex(const std::vector<VkQueueFamilyProperties>& queueFamilyProperties, VkQueueFlags queueFlags)
 	{
 		// Dedicated queue for compute
 		// Try to find a queue family index that supports compute but not graphics
 		if ((queueFlags & VK_QUEUE_COMPUTE_BIT) == queueFlags)
 		{
-			for (uint32_t i = 0; i < static_cast<uint32_t>(m_vkQueueFamilyProperties.size()); i++)
+			for (uint32_t i = 0; i < static_cast<uint32_t>(queueFamilyProperties.size()); i++)
 			{
-				if ((m_vkQueueFamilyProperties[i].queueFlags & VK_QUEUE_COMPUTE_BIT) && ((m_vkQueueFamilyProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0))
+				if ((queueFamilyProperties[i].queueFlags & VK_QUEUE_COMPUTE_BIT) && ((queueFamilyProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0))
 				{
 					return i;
 				}
@@ -136,9 +167,9 @@ namespace vks
 		// Try to find a queue family index that supports transfer but not graphics and compute
 		if ((queueFlags & VK_QUEUE_TRANSFER_BIT) == queueFlags)
 		{
-			for (uint32_t i = 0; i < static_cast<uint32_t>(m_vkQueueFamilyProperties.size()); i++)
+			for (uint32_t i = 0; i < static_cast<uint32_t>(queueFamilyProperties.size()); i++)
 			{
-				if ((m_vkQueueFamilyProperties[i].queueFlags & VK_QUEUE_TRANSFER_BIT) && ((m_vkQueueFamilyProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0) && ((m_vkQueueFamilyProperties[i].queueFlags & VK_QUEUE_COMPUTE_BIT) == 0))
+				if ((queueFamilyProperties[i].queueFlags & VK_QUEUE_TRANSFER_BIT) && ((queueFamilyProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0) && ((queueFamilyProperties[i].queueFlags & VK_QUEUE_COMPUTE_BIT) == 0))
 				{
 					return i;
 				}
@@ -146,9 +177,9 @@ namespace vks
 		}
 
 		// For other queue types or if no separate compute queue is present, return the first one to support the requested flags
-		for (uint32_t i = 0; i < static_cast<uint32_t>(m_vkQueueFamilyProperties.size()); i++)
+		for (uint32_t i = 0; i < static_cast<uint32_t>(queueFamilyProperties.size()); i++)
 		{
-			if ((m_vkQueueFamilyProperties[i].queueFlags & queueFlags) == queueFlags)
+			if ((queueFamilyProperties[i].queueFlags & queueFlags) == queueFlags)
 			{
 				return i;
 			}
@@ -157,6 +188,20 @@ namespace vks
 		throw std::runtime_error("Could not find a matching queue family index");
 	}
 
+	/**
+	* Get the index of a queue family of this device that supports the requested queue flags
+	*
+	* @param queueFlags Queue flags to find a queue family index for
+	*
+	* @return Index of the queue family index that matches the flags
+	*
+	* @throw Throws an exception if no queue family index could be found that supports the requested flags
+	*/
+	uint32_t VulkanDevice::getQueueFamilyIndex(VkQueueFlags queueFlags) const
+	{
+		return getQueueFamilyIndex(m_vkQueueFamilyProperties, queueFlags);
+	}
+
 	/**
 	* Create the logical device based on the assigned physical device, also gets default queue family indices
 	*
@@ -178,10 +223,18 @@ namespace vks
 	* @param memory Pointer to the memory handle acquired by the function
 	* @param data Pointer to the data that should be copied to the buffer after creation (optional, if not set, no data is copied over)
 	*
+	* @note For memory that is not host visible, the data is uploaded through the staging ring and the copy is submitted but not waited on
+	*
 	* @return VK_SUCCESS if buffer handle and memory have been created and (optionally passed) data has been copied
 	*/
 	VkResult VulkanDevice::createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, VkBuffer *buffer, VkDeviceMemory *memory, void *data)
 	{
+		if (data != nullptr && (memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0)
+		{
+			assert(stagingRing.isCreated());
+			usageFlags |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		}
+
 		// Create the buffer handle
 		VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo(usageFlags, size);
 		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
@@ -203,6 +256,15 @@ namespace vks
 		}
 		VK_CHECK_RESULT(vkAllocateMemory(m_device, &memAlloc, nullptr, memory));
 			
+		// Memory that can't be mapped is filled through the staging ring
+		if (data != nullptr && (memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0)
+		{
+			VK_CHECK_RESULT(vkBindBufferMemory(m_device, *buffer, *memory, 0));
+			stagingRing.copyToBuffer(data, size, *buffer);
+			stagingRing.submit();
+			return VK_SUCCESS;
+		}
+
 		// If a pointer to the buffer data has been passed, map the buffer and copy over the data
 		if (data != nullptr)
 		{
@@ -236,12 +298,20 @@ namespace vks
 	* @param size Size of the buffer in bytes
 	* @param data Pointer to the data that should be copied to the buffer after creation (optional, if not set, no data is copied over)
 	*
+	* @note For memory that is not host visible, the data is uploaded through the staging ring and the copy is submitted but not waited on
+	*
 	* @return VK_SUCCESS if buffer handle and memory have been created and (optionally passed) data has been copied
 	*/
 	VkResult VulkanDevice::createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, vks::Buffer *buffer, VkDeviceSize size, void *data)
 	{
 		buffer->device = m_device;
 
+		if (data != nullptr && (memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0)
+		{
+			assert(stagingRing.isCreated());
+			usageFlags |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		}
+
 		// Create the buffer handle
 		VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo(usageFlags, size);
 		VK_CHECK_RESULT(vkCreateBuffer(m_device, &bufferCreateInfo, nullptr, &buffer->buffer));
@@ -267,6 +337,16 @@ namespace vks
 		buffer->usageFlags = usageFlags;
 		buffer->memoryPropertyFlags = memoryPropertyFlags;
 
+		// Memory that can't be mapped is filled through the staging ring
+		if (data != nullptr && (memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0)
+		{
+			buffer->setupDescriptor();
+			VK_CHECK_RESULT(buffer->bind());
+			stagingRing.copyToBuffer(data, size, buffer->buffer);
+			stagingRing.submit();
+			return VK_SUCCESS;
+		}
+
 		// If a pointer to the buffer data has been passed, map the buffer and copy over the data
 		if (data != nullptr)
 		{
@@ -315,6 +395,141 @@ namespace vks
 		flushCommandBuffer(copyCmd, queue);
 	}
 
+	/**
+	* Check if an optimal tiled image can be filled with host image copies
+	*
+	* @param format Format of the image
+	* @param usageFlags Usage flags the image is created with (the host transfer usage is added by this function)
+	* @param layout Layout the image is copied into and used with
+	* @param (Optional) createFlags Create flags of the image (e.g. cube compatible)
+	*
+	* @return True if host image copies are enabled on the device and supported for this image
+	*/
+	bool VulkanDevice::hostImageCopySupported(VkFormat format, VkImageUsageFlags usageFlags, VkImageLayout layout, VkImageCreateFlags createFlags) const
+	{
+		if (!hostImageCopy.supported)
+		{
+			return false;
+		}
+		// Host copies can only write to a limited set of layouts
+		if (std::find(hostImageCopy.copyDstLayouts.begin(), hostImageCopy.copyDstLayouts.end(), layout) == hostImageCopy.copyDstLayouts.end())
+		{
+			return false;
+		}
+		// Support for host transfers is a per-format feature that is only reported through the extended format properties
+		VkFormatProperties3 formatProperties3{ VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3 };
+		VkFormatProperties2 formatProperties2{ VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2 };
+		formatProperties2.pNext = &formatProperties3;
+		vkGetPhysicalDeviceFormatProperties2(m_physicalDevice, format, &formatProperties2);
+		if ((formatProperties3.optimalTilingFeatures & VK_FORMAT_FEATURE_2_HOST_IMAGE_TRANSFER_BIT) == 0)
+		{
+			return false;
+		}
+		// The other usages requested for the image must be supported in combination with host transfers
+		VkImageFormatProperties imageFormatProperties;
+		return vkGetPhysicalDeviceImageFormatProperties(m_physicalDevice, format, VK_IMAGE_TYPE_2D, VK_IMAGE_TILING_OPTIMAL, usageFlags | VK_IMAGE_USAGE_HOST_TRANSFER_BIT, createFlags, &imageFormatProperties) == VK_SUCCESS;
+	}
+
+	/**
+	* Fill an image directly from host memory using host image copies
+	*
+	* @param data Pointer to the host memory the region offsets are relative to
+	* @param image Image to copy to, must have been created with VK_IMAGE_USAGE_HOST_TRANSFER_BIT and bound to memory
+	* @param regions Copy regions, buffer offsets are used as offsets into data
+	* @param subresourceRange Subresources of the image covered by the regions
+	* @param layout Layout the image is transitioned to (on the host) and copied into
+	*
+	* @note The image must not be in use by the device. Each region must target a separate subresource, as the regions are copied in parallel on worker threads.
+	* Nothing is submitted to a queue and no staging memory is used, the image can be used by the device once this function returns.
+	*/
+	void VulkanDevice::copyMemoryToImage(const void* data, VkImage image, const std::vector<VkBufferImageCopy>& regions, VkImageSubresourceRange subresourceRange, VkImageLayout layout)
+	{
+		assert(hostImageCopy.supported);
+
+		VkHostImageLayoutTransitionInfo transitionInfo{ VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO };
+		transitionInfo.image = image;
+		transitionInfo.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		transitionInfo.newLayout = layout;
+		transitionInfo.subresourceRange = subresourceRange;
+		VK_CHECK_RESULT(hostImageCopy.vkTransitionImageLayout(m_device, 1, &transitionInfo));
+
+		// Workers pick the next region until all have been copied, regions are usually ordered from large to small mip levels
+		const uint8_t* src = static_cast<const uint8_t*>(data);
+		std::atomic<uint32_t> nextRegion{ 0 };
+		auto copyRegions = [&]() {
+			for (uint32_t i = nextRegion++; i < static_cast<uint32_t>(regions.size()); i = nextRegion++)
+			{
+				const VkBufferImageCopy& region = regions[i];
+				VkMemoryToImageCopy memoryToImageCopy{ VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY };
+				memoryToImageCopy.pHostPointer = src + region.bufferOffset;
+				memoryToImageCopy.memoryRowLength = region.bufferRowLength;
+				memoryToImageCopy.memoryImageHeight = region.bufferImageHeight;
+				memoryToImageCopy.imageSubresource = region.imageSubresource;
+				memoryToImageCopy.imageOffset = region.imageOffset;
+				memoryToImageCopy.imageExtent = region.imageExtent;
+
+				VkCopyMemoryToImageInfo copyInfo{ VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO };
+				copyInfo.dstImage = image;
+				copyInfo.dstImageLayout = layout;
+				copyInfo.regionCount = 1;
+				copyInfo.pRegions = &memoryToImageCopy;
+				VK_CHECK_RESULT(hostImageCopy.vkCopyMemoryToImage(m_device, &copyInfo));
+			}
+		};
+
+		// Single regions are copied on the calling thread, otherwise the device's workers help out
+		const uint32_t workerCount = std::min(static_cast<uint32_t>(hostImageCopy.threadPool->threads.size()), static_cast<uint32_t>(std::max(regions.size(), size_t(1)) - 1));
+		for (uint32_t i = 0; i < workerCount; i++)
+		{
+			hostImageCopy.threadPool->threads[i]->addJob(copyRegions);
+		}
+		copyRegions();
+		if (workerCount > 0)
+		{
+			hostImageCopy.threadPool->wait();
+		}
+	}
+
+	/**
+	* Add a texture upload to the upload statistics
+	*
+	* @param hostCopy True if the texture was uploaded with host image copies, false if it went through the staging ring
+	* @param size Size of the uploaded texture data in bytes
+	* @param start Time the upload was started at
+	*
+	* @note For staged uploads only the time spent on the host is counted (copying into the ring and submitting), the copies on the device run asynchronously
+	*/
+	void VulkanDevice::addTextureUpload(bool hostCopy, VkDeviceSize size, std::chrono::high_resolution_clock::time_point start)
+	{
+		auto& uploads = textureUploads[hostCopy ? 0 : 1];
+		uploads.count++;
+		uploads.size += size;
+		uploads.time += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	/**
+	* Print the number, size and time of the texture uploads per upload path
+	*
+	* @note Staged uploads need as much staging ring memory as they upload (up to half the ring at once), host image copies need none
+	*/
+	void VulkanDevice::printTextureUploads() const
+	{
+		const char* names[2] = { "host image copy", "staging ring" };
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			if (textureUploads[i].count == 0)
+			{
+				continue;
+			}
+			std::cout << "Texture uploads via " << names[i] << ": " << textureUploads[i].count << " textures, " << textureUploads[i].size / 1024 << " KiB in " << textureUploads[i].time << " ms";
+			if (i == 1)
+			{
+				std::cout << " through a " << stagingRing.getSize() / (1024 * 1024) << " MiB staging ring";
+			}
+			std::cout << std::endl;
+		}
+	}
+
 	/** 
 	* Create a command pool for allocation command buffers from
 	* 
@@ -391,8 +606,15 @@ namespace vks
 		VkFenceCreateInfo fenceInfo = vks::initializers::fenceCreateInfo(VK_FLAGS_NONE);
 		VkFence fence;
 		VK_CHECK_RESULT(vkCreateFence(m_device, &fenceInfo, nullptr, &fence));
-		// Submit to the queue
-		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, fence));
+		// Submit to the queue, on the graphics queue together with the ownership acquires of pending uploads
+		if (stagingRing.isCreated() && (queue == stagingRing.getGraphicsQueue()))
+		{
+			stagingRing.submitGraphics(submitInfo, fence);
+		}
+		else
+		{
+			VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, fence));
+		}
 		// Wait for the fence to signal that command buffer has finished executing
 		VK_CHECK_RESULT(vkWaitForFences(m_device, 1, &fence, VK_TRUE, DEFAULT_FENCE_TIMEOUT));
 		vkDestroyFence(m_device, fence, nullptr);
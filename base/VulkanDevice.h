@@ -12,13 +12,18 @@
 
 #include <VulkanCpp.hpp>
 #include "VulkanBuffer.h"
+#include "VulkanStagingRing.h"
 #include "VulkanTools.h"
 #include "vulkan/vulkan.h"
 #include <algorithm>
+#include <chrono>
 #include <assert.h>
 #include <exception>
+#include <memory>
 
 namespace vks {
+class ThreadPool;
+
 struct VulkanDevice {
     /** @brief Physical device representation */
     vkcpp::PhysicalDevice m_physicalDevice;
@@ -47,6 +52,25 @@ struct VulkanDevice {
         uint32_t compute = 0;
         uint32_t transfer = 0;
     } queueFamilyIndices;
+    /** @brief Persistently mapped staging ring shared by all uploads to device local memory */
+    vks::StagingRing stagingRing;
+    /** @brief Host image copy support (core since Vulkan 1.4), the function pointers are only valid if supported is set */
+    struct
+    {
+        bool supported = false;
+        std::vector<VkImageLayout> copyDstLayouts;
+        PFN_vkCopyMemoryToImage vkCopyMemoryToImage = nullptr;
+        PFN_vkTransitionImageLayout vkTransitionImageLayout = nullptr;
+        /** @brief Worker threads copying the regions of an image in parallel, created once with the device */
+        std::unique_ptr<vks::ThreadPool> threadPool;
+    } hostImageCopy;
+    /** @brief Number, size and host time of the texture uploads of the base loaders, [0] for host image copies and [1] for uploads through the staging ring */
+    struct
+    {
+        uint32_t count = 0;
+        VkDeviceSize size = 0;
+        double time = 0.0;
+    } textureUploads[2];
 
     operator VkDevice() const
     {
@@ -65,10 +89,15 @@ struct VulkanDevice {
     VulkanDevice& operator=(VulkanDevice&&) = delete;
 
     uint32_t getMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties, VkBool32* memTypeFound = nullptr) const;
+    static uint32_t getQueueFamilyIndex(const std::vector<VkQueueFamilyProperties>& queueFamilyProperties, VkQueueFlags queueFlags);
     uint32_t getQueueFamilyIndex(VkQueueFlags queueFlags) const;
     VkResult createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, VkBuffer* buffer, VkDeviceMemory* memory, void* data = nullptr);
     VkResult createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, vks::Buffer* buffer, VkDeviceSize size, void* data = nullptr);
     void copyBuffer(vks::Buffer* src, vks::Buffer* dst, VkQueue queue, VkBufferCopy* copyRegion = nullptr);
+    bool hostImageCopySupported(VkFormat format, VkImageUsageFlags usageFlags, VkImageLayout layout, VkImageCreateFlags createFlags = 0) const;
+    void copyMemoryToImage(const void* data, VkImage image, const std::vector<VkBufferImageCopy>& regions, VkImageSubresourceRange subresourceRange, VkImageLayout layout);
+    void addTextureUpload(bool hostCopy, VkDeviceSize size, std::chrono::high_resolution_clock::time_point start);
+    void printTextureUploads() const;
     VkCommandPool createCommandPool(uint32_t queueFamilyIndex, VkCommandPoolCreateFlags createFlags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
     VkCommandBuffer createCommandBuffer(VkCommandBufferLevel level, VkCommandPool pool, bool begin = false);
     VkCommandBuffer createCommandBuffer(VkCommandBufferLevel level, bool begin = false);
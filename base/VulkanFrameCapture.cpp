@@ -0,0 +1,655 @@
+/*
+* Vulkan frame capture
+*
+* Asynchronous readback of rendered images into a pool of persistently mapped buffers, encoding and file output is done on a worker thread
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include "VulkanFrameCapture.h"
+#include "VulkanDevice.h"
+
+#if defined(__SSSE3__) || (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_AMD64)))
+#include <tmmintrin.h>
+#define VKS_FRAMECAPTURE_SSSE3
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VKS_FRAMECAPTURE_NEON
+#endif
+
+namespace vks
+{
+	namespace
+	{
+		// Drops the alpha channel of 8 bit four component pixels and optionally swaps red and blue
+		// The SIMD paths may write up to 16 bytes past pixelCount * 3, so dst needs to be padded accordingly
+		void convertToRGB(const uint8_t* src, uint8_t* dst, size_t pixelCount, bool swapRB)
+		{
+			size_t i = 0;
+#if defined(VKS_FRAMECAPTURE_SSSE3)
+			const __m128i shuffle = swapRB ?
+				_mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1) :
+				_mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+			for (; i + 4 <= pixelCount; i += 4) {
+				const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 3), _mm_shuffle_epi8(pixels, shuffle));
+			}
+#elif defined(VKS_FRAMECAPTURE_NEON)
+			for (; i + 16 <= pixelCount; i += 16) {
+				const uint8x16x4_t pixels = vld4q_u8(src + i * 4);
+				uint8x16x3_t out;
+				out.val[0] = swapRB ? pixels.val[2] : pixels.val[0];
+				out.val[1] = pixels.val[1];
+				out.val[2] = swapRB ? pixels.val[0] : pixels.val[2];
+				vst3q_u8(dst + i * 3, out);
+			}
+#endif
+			for (; i < pixelCount; i++) {
+				dst[i * 3 + 0] = src[i * 4 + (swapRB ? 2 : 0)];
+				dst[i * 3 + 1] = src[i * 4 + 1];
+				dst[i * 3 + 2] = src[i * 4 + (swapRB ? 0 : 2)];
+			}
+		}
+
+		uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+		{
+			static const std::array<uint32_t, 256> table = [] {
+				std::array<uint32_t, 256> values{};
+				for (uint32_t i = 0; i < 256; i++) {
+					uint32_t c = i;
+					for (uint32_t k = 0; k < 8; k++) {
+						c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : (c >> 1);
+					}
+					values[i] = c;
+				}
+				return values;
+			}();
+			crc = ~crc;
+			for (size_t i = 0; i < size; i++) {
+				crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+			}
+			return ~crc;
+		}
+
+		uint32_t adler32(const uint8_t* data, size_t size)
+		{
+			uint32_t a = 1, b = 0;
+			while (size > 0) {
+				// Largest block that can't overflow the sums before taking the modulo
+				const size_t blockSize = std::min<size_t>(size, 5552);
+				for (size_t i = 0; i < blockSize; i++) {
+					a += data[i];
+					b += a;
+				}
+				a %= 65521;
+				b %= 65521;
+				data += blockSize;
+				size -= blockSize;
+			}
+			return (b << 16) | a;
+		}
+
+		// Writes deflate bit streams, which are filled starting at the least significant bit
+		struct BitWriter
+		{
+			std::vector<uint8_t>& out;
+			uint32_t bitBuffer{ 0 };
+			uint32_t bitCount{ 0 };
+
+			explicit BitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+			void write(uint32_t bits, uint32_t count)
+			{
+				bitBuffer |= bits << bitCount;
+				bitCount += count;
+				while (bitCount >= 8) {
+					out.push_back(static_cast<uint8_t>(bitBuffer & 0xFF));
+					bitBuffer >>= 8;
+					bitCount -= 8;
+				}
+			}
+
+			// Huffman codes are stored starting with their most significant bit
+			void writeCode(uint32_t code, uint32_t length)
+			{
+				uint32_t reversed = 0;
+				for (uint32_t i = 0; i < length; i++) {
+					reversed |= ((code >> i) & 1) << (length - 1 - i);
+				}
+				write(reversed, length);
+			}
+
+			// Symbol of the fixed literal/length alphabet (RFC 1951, 3.2.6)
+			void writeSymbol(uint32_t symbol)
+			{
+				if (symbol <= 143) {
+					writeCode(0x30 + symbol, 8);
+				} else if (symbol <= 255) {
+					writeCode(0x190 + symbol - 144, 9);
+				} else if (symbol <= 279) {
+					writeCode(symbol - 256, 7);
+				} else {
+					writeCode(0xC0 + symbol - 280, 8);
+				}
+			}
+
+			void writeMatch(uint32_t length, uint32_t distance)
+			{
+				static const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+				static const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+				static const uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+				static const uint8_t distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+				uint32_t l = 28;
+				while (lengthBase[l] > length) {
+					l--;
+				}
+				writeSymbol(257 + l);
+				write(length - lengthBase[l], lengthExtra[l]);
+				uint32_t d = 29;
+				while (distanceBase[d] > distance) {
+					d--;
+				}
+				writeCode(d, 5);
+				write(distance - distanceBase[d], distanceExtra[d]);
+			}
+
+			void flush()
+			{
+				if (bitCount > 0) {
+					out.push_back(static_cast<uint8_t>(bitBuffer & 0xFF));
+				}
+				bitBuffer = 0;
+				bitCount = 0;
+			}
+		};
+
+		// Compresses into a zlib stream with a single fixed Huffman block, matches are searched with hash chains over a 32 KiB window
+		std::vector<uint8_t> zlibCompress(const uint8_t* data, size_t size)
+		{
+			const int64_t windowSize = 32768;
+			const uint32_t hashBits = 15;
+			const uint32_t maxChainLength = 32;
+			const uint32_t maxMatchLength = 258;
+
+			std::vector<uint8_t> out = { 0x78, 0x01 };
+			out.reserve(size / 2 + 64);
+			BitWriter bits(out);
+			// Final block, fixed Huffman codes
+			bits.write(1, 1);
+			bits.write(1, 2);
+
+			std::vector<int64_t> head(static_cast<size_t>(1) << hashBits, -1);
+			std::vector<int64_t> prev(windowSize, -1);
+			auto hash = [&](size_t pos) {
+				const uint32_t v = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16);
+				return (v * 2654435761u) >> (32 - hashBits);
+			};
+			auto insert = [&](size_t pos) {
+				if (pos + 3 <= size) {
+					const uint32_t h = hash(pos);
+					prev[pos & (windowSize - 1)] = head[h];
+					head[h] = static_cast<int64_t>(pos);
+				}
+			};
+
+			size_t pos = 0;
+			while (pos < size) {
+				uint32_t bestLength = 0;
+				uint32_t bestDistance = 0;
+				if (pos + 3 <= size) {
+					const uint32_t maxLength = static_cast<uint32_t>(std::min<size_t>(maxMatchLength, size - pos));
+					int64_t candidate = head[hash(pos)];
+					uint32_t chainLength = 0;
+					while ((candidate >= 0) && (static_cast<int64_t>(pos) - candidate <= windowSize) && (chainLength++ < maxChainLength)) {
+						uint32_t length = 0;
+						while ((length < maxLength) && (data[candidate + length] == data[pos + length])) {
+							length++;
+						}
+						if (length > bestLength) {
+							bestLength = length;
+							bestDistance = static_cast<uint32_t>(pos - candidate);
+							if (length == maxLength) {
+								break;
+							}
+						}
+						// Entries of the chain that have been overwritten by newer positions end the search
+						const int64_t next = prev[candidate & (windowSize - 1)];
+						if (next >= candidate) {
+							break;
+						}
+						candidate = next;
+					}
+				}
+				if (bestLength >= 3) {
+					bits.writeMatch(bestLength, bestDistance);
+					for (uint32_t i = 0; i < bestLength; i++) {
+						insert(pos + i);
+					}
+					pos += bestLength;
+				} else {
+					bits.writeSymbol(data[pos]);
+					insert(pos);
+					pos++;
+				}
+			}
+			// End of block
+			bits.writeSymbol(256);
+			bits.flush();
+
+			const uint32_t adler = adler32(data, size);
+			for (int32_t shift = 24; shift >= 0; shift -= 8) {
+				out.push_back(static_cast<uint8_t>(adler >> shift));
+			}
+			return out;
+		}
+
+		uint8_t paethPredictor(int32_t a, int32_t b, int32_t c)
+		{
+			const int32_t p = a + b - c;
+			const int32_t pa = std::abs(p - a);
+			const int32_t pb = std::abs(p - b);
+			const int32_t pc = std::abs(p - c);
+			if ((pa <= pb) && (pa <= pc)) {
+				return static_cast<uint8_t>(a);
+			}
+			return static_cast<uint8_t>((pb <= pc) ? b : c);
+		}
+
+		// Writes 8 bit RGB pixels as a PNG, the filter of each row is selected by the minimum sum of absolute differences
+		void writePNG(const std::string& filename, uint32_t width, uint32_t height, const uint8_t* rgb)
+		{
+			const size_t stride = static_cast<size_t>(width) * 3;
+			std::vector<uint8_t> filtered((stride + 1) * height);
+			std::vector<uint8_t> row(stride);
+			for (uint32_t y = 0; y < height; y++) {
+				const uint8_t* current = rgb + y * stride;
+				const uint8_t* above = (y > 0) ? current - stride : nullptr;
+				uint8_t* target = filtered.data() + y * (stride + 1);
+				uint64_t bestSum = UINT64_MAX;
+				for (uint8_t filter = 0; filter < 5; filter++) {
+					uint64_t sum = 0;
+					for (size_t x = 0; x < stride; x++) {
+						const uint8_t a = (x >= 3) ? current[x - 3] : 0;
+						const uint8_t b = above ? above[x] : 0;
+						const uint8_t c = (above && (x >= 3)) ? above[x - 3] : 0;
+						uint8_t value = current[x];
+						switch (filter) {
+						case 1: value -= a; break;
+						case 2: value -= b; break;
+						case 3: value -= static_cast<uint8_t>((a + b) / 2); break;
+						case 4: value -= paethPredictor(a, b, c); break;
+						}
+						row[x] = value;
+						sum += std::abs(static_cast<int8_t>(value));
+					}
+					if (sum < bestSum) {
+						bestSum = sum;
+						target[0] = filter;
+						std::copy(row.begin(), row.end(), target + 1);
+					}
+				}
+			}
+
+			std::ofstream file(filename, std::ios::out | std::ios::binary);
+			auto writeChunk = [&file](const char* type, const std::vector<uint8_t>& chunkData) {
+				const uint32_t length = static_cast<uint32_t>(chunkData.size());
+				const uint8_t header[8] = { uint8_t(length >> 24), uint8_t(length >> 16), uint8_t(length >> 8), uint8_t(length), uint8_t(type[0]), uint8_t(type[1]), uint8_t(type[2]), uint8_t(type[3]) };
+				const uint32_t crc = crc32(chunkData.data(), chunkData.size(), crc32(header + 4, 4));
+				const uint8_t footer[4] = { uint8_t(crc >> 24), uint8_t(crc >> 16), uint8_t(crc >> 8), uint8_t(crc) };
+				file.write(reinterpret_cast<const char*>(header), sizeof(header));
+				file.write(reinterpret_cast<const char*>(chunkData.data()), chunkData.size());
+				file.write(reinterpret_cast<const char*>(footer), sizeof(footer));
+			};
+			const uint8_t signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+			file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+			// 8 bit RGB, no interlacing
+			const std::vector<uint8_t> imageHeader = {
+				uint8_t(width >> 24), uint8_t(width >> 16), uint8_t(width >> 8), uint8_t(width),
+				uint8_t(height >> 24), uint8_t(height >> 16), uint8_t(height >> 8), uint8_t(height),
+				8, 2, 0, 0, 0
+			};
+			writeChunk("IHDR", imageHeader);
+			writeChunk("IDAT", zlibCompress(filtered.data(), filtered.size()));
+			writeChunk("IEND", {});
+		}
+	}
+
+	/**
+	* Create the readback buffer pool and start the worker thread
+	*
+	* @param device Pointer to the device the buffers are allocated from
+	* @param queueFamilyIndex Family of the queue the captures will be submitted to
+	* @param width Width of the images to capture
+	* @param height Height of the images to capture
+	* @param format Format of the images to capture, formats other than 8 bit RGBA or BGRA are converted to 8 bit RGBA with a blit
+	* @param (Optional) poolSize Number of readback buffers, limits the number of captures in flight (Defaults to 3)
+	*
+	* @return False if the format can't be read back or converted on this device
+	*/
+	bool FrameCapture::create(vks::VulkanDevice* device, uint32_t queueFamilyIndex, uint32_t width, uint32_t height, VkFormat format, uint32_t poolSize)
+	{
+		assert(!isCreated());
+		this->device = device;
+		this->width = width;
+		this->height = height;
+		this->format = format;
+
+		const std::vector<VkFormat> formatsBGR = { VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_B8G8R8A8_SNORM };
+		const std::vector<VkFormat> formatsRGB = { VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R8G8B8A8_SNORM, VK_FORMAT_A8B8G8R8_UNORM_PACK32, VK_FORMAT_A8B8G8R8_SRGB_PACK32 };
+		swapRB = std::find(formatsBGR.begin(), formatsBGR.end(), format) != formatsBGR.end();
+		convert = !swapRB && (std::find(formatsRGB.begin(), formatsRGB.end(), format) == formatsRGB.end());
+
+		// Other formats (e.g. 10 bit or floating point swapchains) are blitted into an 8 bit RGBA image first, which also does the format conversion
+		if (convert) {
+			VkFormatProperties formatProps;
+			vkGetPhysicalDeviceFormatProperties(device->m_physicalDevice, format, &formatProps);
+			const bool blitSrc = (formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT) != 0;
+			vkGetPhysicalDeviceFormatProperties(device->m_physicalDevice, VK_FORMAT_R8G8B8A8_UNORM, &formatProps);
+			const bool blitDst = (formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT) != 0;
+			if (!blitSrc || !blitDst) {
+				std::cerr << "Error: Frame capture is not supported for swapchain format " << format << " (device can't blit it to VK_FORMAT_R8G8B8A8_UNORM)" << std::endl;
+				return false;
+			}
+			VkImageCreateInfo imageCreateInfo = vks::initializers::imageCreateInfo();
+			imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageCreateInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+			imageCreateInfo.extent = { width, height, 1 };
+			imageCreateInfo.mipLevels = 1;
+			imageCreateInfo.arrayLayers = 1;
+			imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VK_CHECK_RESULT(vkCreateImage(device->m_device, &imageCreateInfo, nullptr, &convertImage));
+			VkMemoryRequirements memReqs;
+			vkGetImageMemoryRequirements(device->m_device, convertImage, &memReqs);
+			VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
+			memAlloc.allocationSize = memReqs.size;
+			memAlloc.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			VK_CHECK_RESULT(vkAllocateMemory(device->m_device, &memAlloc, nullptr, &convertMemory));
+			VK_CHECK_RESULT(vkBindImageMemory(device->m_device, convertImage, convertMemory, 0));
+		}
+
+		const VkDeviceSize bufferSize = static_cast<VkDeviceSize>(width) * height * 4;
+
+		VkCommandPoolCreateInfo cmdPoolInfo = vks::initializers::commandPoolCreateInfo();
+		cmdPoolInfo.queueFamilyIndex = queueFamilyIndex;
+		cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		VK_CHECK_RESULT(vkCreateCommandPool(device->m_device, &cmdPoolInfo, nullptr, &commandPool));
+
+		slots.resize(poolSize);
+		for (auto& slot : slots) {
+			VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo(VK_BUFFER_USAGE_TRANSFER_DST_BIT, bufferSize);
+			VK_CHECK_RESULT(vkCreateBuffer(device->m_device, &bufferCreateInfo, nullptr, &slot.buffer));
+			VkMemoryRequirements memReqs;
+			vkGetBufferMemoryRequirements(device->m_device, slot.buffer, &memReqs);
+			// Reading back from uncached memory is very slow, so prefer cached memory (which may not be coherent)
+			VkBool32 cachedFound = false;
+			VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
+			memAlloc.allocationSize = memReqs.size;
+			memAlloc.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, &cachedFound);
+			if (!cachedFound) {
+				memAlloc.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			}
+			coherent = (device->m_vkPhysicalDeviceMemoryProperties.memoryTypes[memAlloc.memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+			VK_CHECK_RESULT(vkAllocateMemory(device->m_device, &memAlloc, nullptr, &slot.memory));
+			VK_CHECK_RESULT(vkBindBufferMemory(device->m_device, slot.buffer, slot.memory, 0));
+			VK_CHECK_RESULT(vkMapMemory(device->m_device, slot.memory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&slot.mapped)));
+
+			VkCommandBufferAllocateInfo cmdBufAllocateInfo = vks::initializers::commandBufferAllocateInfo(commandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+			VK_CHECK_RESULT(vkAllocateCommandBuffers(device->m_device, &cmdBufAllocateInfo, &slot.commandBuffer));
+			VkFenceCreateInfo fenceInfo = vks::initializers::fenceCreateInfo(0);
+			VK_CHECK_RESULT(vkCreateFence(device->m_device, &fenceInfo, nullptr, &slot.fence));
+		}
+
+		// Padding for the SIMD conversion
+		rgb.resize(static_cast<size_t>(width) * height * 3 + 16);
+
+		stopping = false;
+		worker = std::thread(&FrameCapture::workerLoop, this);
+		return true;
+	}
+
+	/**
+	* Write all pending captures, stop the worker thread and release all resources
+	*/
+	void FrameCapture::destroy()
+	{
+		if (!isCreated()) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		condition.notify_all();
+		worker.join();
+		for (auto& slot : slots) {
+			vkUnmapMemory(device->m_device, slot.memory);
+			vkDestroyBuffer(device->m_device, slot.buffer, nullptr);
+			vkFreeMemory(device->m_device, slot.memory, nullptr);
+			vkDestroyFence(device->m_device, slot.fence, nullptr);
+		}
+		vkDestroyCommandPool(device->m_device, commandPool, nullptr);
+		commandPool = VK_NULL_HANDLE;
+		if (convertImage != VK_NULL_HANDLE) {
+			vkDestroyImage(device->m_device, convertImage, nullptr);
+			vkFreeMemory(device->m_device, convertMemory, nullptr);
+			convertImage = VK_NULL_HANDLE;
+			convertMemory = VK_NULL_HANDLE;
+		}
+		slots.clear();
+	}
+
+	/**
+	* Copy an image into a readback buffer and queue it for writing to disk
+	*
+	* @param queue Queue to submit the copy to, must be from the family passed at creation
+	* @param image Image to capture, must have been created with VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+	* @param layout Layout of the image at the time of the capture, the image is transitioned back to it after the copy
+	* @param filename File to write the capture to
+	* @param (Optional) fileFormat File format to write (Defaults to PPM)
+	* @param (Optional) semaphore Binary semaphore that the copy waits on and signals again after it has finished (e.g. the render complete semaphore waited on by present)
+	*
+	* @note Only blocks if no readback buffer is free
+	*/
+	void FrameCapture::capture(VkQueue queue, VkImage image, VkImageLayout layout, const std::string& filename, FileFormat fileFormat, VkSemaphore semaphore)
+	{
+		assert(isCreated());
+
+		uint32_t index = 0;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this] { return std::any_of(slots.begin(), slots.end(), [](const Slot& slot) { return !slot.busy; }); });
+			while (slots[index].busy) {
+				index++;
+			}
+			slots[index].busy = true;
+		}
+		Slot& slot = slots[index];
+		slot.filename = filename;
+		slot.fileFormat = fileFormat;
+
+		const VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
+		cmdBufInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VK_CHECK_RESULT(vkBeginCommandBuffer(slot.commandBuffer, &cmdBufInfo));
+		vks::tools::insertImageMemoryBarrier(
+			slot.commandBuffer,
+			image,
+			VK_ACCESS_MEMORY_WRITE_BIT,
+			VK_ACCESS_TRANSFER_READ_BIT,
+			layout,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			subresourceRange);
+		VkImage copySource = image;
+		if (convert) {
+			// The conversion image is shared by all slots, the barrier also orders this blit after the copies of earlier captures
+			vks::tools::insertImageMemoryBarrier(
+				slot.commandBuffer,
+				convertImage,
+				0,
+				VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				subresourceRange);
+			VkImageBlit blitRegion{};
+			blitRegion.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			blitRegion.srcOffsets[1] = { static_cast<int32_t>(width), static_cast<int32_t>(height), 1 };
+			blitRegion.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			blitRegion.dstOffsets[1] = { static_cast<int32_t>(width), static_cast<int32_t>(height), 1 };
+			vkCmdBlitImage(slot.commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, convertImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blitRegion, VK_FILTER_NEAREST);
+			vks::tools::insertImageMemoryBarrier(
+				slot.commandBuffer,
+				convertImage,
+				VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_ACCESS_TRANSFER_READ_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				subresourceRange);
+			copySource = convertImage;
+		}
+		// Rows are tightly packed in the buffer, so the whole image can be written with a single call
+		VkBufferImageCopy region{};
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		region.imageExtent = { width, height, 1 };
+		vkCmdCopyImageToBuffer(slot.commandBuffer, copySource, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer, 1, &region);
+		vks::tools::insertImageMemoryBarrier(
+			slot.commandBuffer,
+			image,
+			VK_ACCESS_TRANSFER_READ_BIT,
+			VK_ACCESS_MEMORY_READ_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			layout,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			subresourceRange);
+		VkBufferMemoryBarrier bufferBarrier = vks::initializers::bufferMemoryBarrier();
+		bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		bufferBarrier.buffer = slot.buffer;
+		bufferBarrier.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(slot.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+		VK_CHECK_RESULT(vkEndCommandBuffer(slot.commandBuffer));
+
+		const VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		VkSubmitInfo submitInfo = vks::initializers::submitInfo();
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &slot.commandBuffer;
+		if (semaphore != VK_NULL_HANDLE) {
+			submitInfo.waitSemaphoreCount = 1;
+			submitInfo.pWaitSemaphores = &semaphore;
+			submitInfo.pWaitDstStageMask = &waitStageMask;
+			submitInfo.signalSemaphoreCount = 1;
+			submitInfo.pSignalSemaphores = &semaphore;
+		}
+		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, slot.fence));
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending.push_back(index);
+		}
+		condition.notify_all();
+	}
+
+	/**
+	* Wait until all queued captures have been written to disk
+	*/
+	void FrameCapture::waitIdle()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [this] { return std::none_of(slots.begin(), slots.end(), [](const Slot& slot) { return slot.busy; }); });
+	}
+
+	void FrameCapture::workerLoop()
+	{
+		while (true) {
+			uint32_t index;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				condition.wait(lock, [this] { return !pending.empty() || stopping; });
+				// Pending captures are still written when stopping
+				if (pending.empty()) {
+					break;
+				}
+				index = pending.front();
+				pending.pop_front();
+			}
+
+			Slot& slot = slots[index];
+			VK_CHECK_RESULT(vkWaitForFences(device->m_device, 1, &slot.fence, VK_TRUE, UINT64_MAX));
+			VK_CHECK_RESULT(vkResetFences(device->m_device, 1, &slot.fence));
+			if (!coherent) {
+				VkMappedMemoryRange mappedRange = vks::initializers::mappedMemoryRange();
+				mappedRange.memory = slot.memory;
+				mappedRange.size = VK_WHOLE_SIZE;
+				VK_CHECK_RESULT(vkInvalidateMappedMemoryRanges(device->m_device, 1, &mappedRange));
+			}
+			writeFile(slot);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				slot.busy = false;
+			}
+			completed++;
+			condition.notify_all();
+		}
+	}
+
+	void FrameCapture::writeFile(const Slot& slot)
+	{
+		const size_t pixelCount = static_cast<size_t>(width) * height;
+		if (slot.fileFormat == FileFormat::Raw) {
+			// Raw dumps contain the image data as stored in the source format
+			std::ofstream file(slot.filename, std::ios::out | std::ios::binary);
+			file.write(reinterpret_cast<const char*>(slot.mapped), pixelCount * 4);
+			return;
+		}
+
+		convertToRGB(slot.mapped, rgb.data(), pixelCount, swapRB);
+		if (slot.fileFormat == FileFormat::PNG) {
+			writePNG(slot.filename, width, height, rgb.data());
+			return;
+		}
+		std::ofstream file(slot.filename, std::ios::out | std::ios::binary);
+		file << "P6\n" << width << "\n" << height << "\n" << 255 << "\n";
+		file.write(reinterpret_cast<const char*>(rgb.data()), pixelCount * 3);
+	}
+
+	FrameCapture::FileFormat FrameCapture::fileFormatFromString(const std::string& name)
+	{
+		if (name == "png") {
+			return FileFormat::PNG;
+		}
+		if (name == "raw") {
+			return FileFormat::Raw;
+		}
+		return FileFormat::PPM;
+	}
+
+	std::string FrameCapture::fileExtension(FileFormat fileFormat)
+	{
+		switch (fileFormat) {
+		case FileFormat::PNG:
+			return ".png";
+		case FileFormat::Raw:
+			return ".raw";
+		default:
+			return ".ppm";
+		}
+	}
+}
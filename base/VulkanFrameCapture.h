@@ -0,0 +1,98 @@
+/*
+* Vulkan frame capture
+*
+* Asynchronous readback of rendered images into a pool of persistently mapped buffers, encoding and file output is done on a worker thread
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#include "vulkan/vulkan.h"
+#include "VulkanTools.h"
+
+namespace vks
+{
+	struct VulkanDevice;
+
+	/**
+	* @brief Captures rendered images to disk without waiting on the device
+	* @note Each capture copies the image into a free readback buffer of the pool and submits that copy with a fence.
+	* A worker thread waits for the fence, converts the pixels and writes the file. The render loop only blocks if all buffers
+	* of the pool are still waiting to be written. 8 bit RGBA and BGRA formats are copied directly, other formats are converted
+	* to 8 bit RGBA with a blit if the device supports it.
+	*/
+	class FrameCapture
+	{
+	public:
+		enum class FileFormat { PPM, PNG, Raw };
+
+		/** @brief Default number of readback buffers */
+		static const uint32_t defaultPoolSize = 3;
+
+		bool create(vks::VulkanDevice* device, uint32_t queueFamilyIndex, uint32_t width, uint32_t height, VkFormat format, uint32_t poolSize = defaultPoolSize);
+		void destroy();
+		bool isCreated() const { return !slots.empty(); }
+
+		void capture(VkQueue queue, VkImage image, VkImageLayout layout, const std::string& filename, FileFormat fileFormat = FileFormat::PPM, VkSemaphore semaphore = VK_NULL_HANDLE);
+		void waitIdle();
+
+		uint32_t getWidth() const { return width; }
+		uint32_t getHeight() const { return height; }
+		VkFormat getFormat() const { return format; }
+		/** @brief Number of captures that have been written to disk */
+		uint32_t getCompletedCount() const { return completed; }
+
+		static FileFormat fileFormatFromString(const std::string& name);
+		static std::string fileExtension(FileFormat fileFormat);
+
+	private:
+		struct Slot {
+			VkBuffer buffer{ VK_NULL_HANDLE };
+			VkDeviceMemory memory{ VK_NULL_HANDLE };
+			uint8_t* mapped{ nullptr };
+			VkCommandBuffer commandBuffer{ VK_NULL_HANDLE };
+			VkFence fence{ VK_NULL_HANDLE };
+			std::string filename;
+			FileFormat fileFormat{ FileFormat::PPM };
+			// Set from submission until the file has been written
+			bool busy{ false };
+		};
+
+		vks::VulkanDevice* device{ nullptr };
+		VkCommandPool commandPool{ VK_NULL_HANDLE };
+		uint32_t width{ 0 };
+		uint32_t height{ 0 };
+		VkFormat format{ VK_FORMAT_UNDEFINED };
+		bool swapRB{ false };
+		// Set if the source format has to be blitted into convertImage before the readback
+		bool convert{ false };
+		VkImage convertImage{ VK_NULL_HANDLE };
+		VkDeviceMemory convertMemory{ VK_NULL_HANDLE };
+		bool coherent{ true };
+		std::vector<Slot> slots;
+
+		std::thread worker;
+		std::mutex mutex;
+		std::condition_variable condition;
+		// Indices into slots, in submission order
+		std::deque<uint32_t> pending;
+		bool stopping{ false };
+		std::atomic<uint32_t> completed{ 0 };
+		// RGB conversion target, only accessed by the worker
+		std::vector<uint8_t> rgb;
+
+		void workerLoop();
+		void writeFile(const Slot& slot);
+	};
+}
@@ -0,0 +1,314 @@
+/*
+* Vulkan occlusion culling with occlusion queries
+*
+* Temporally coherent visibility of many objects from occlusion queries, read back without waiting for the GPU or consumed on the GPU with conditional rendering
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+#include "VulkanOcclusionCuller.h"
+#include "VulkanDevice.h"
+
+namespace vks
+{
+	namespace
+	{
+		const std::array<float, 24> boxVertices = {
+			0.0f, 0.0f, 0.0f,  1.0f, 0.0f, 0.0f,  1.0f, 1.0f, 0.0f,  0.0f, 1.0f, 0.0f,
+			0.0f, 0.0f, 1.0f,  1.0f, 0.0f, 1.0f,  1.0f, 1.0f, 1.0f,  0.0f, 1.0f, 1.0f,
+		};
+		// Two triangles per face, boxes are drawn without culling so the winding doesn't matter
+		const std::array<uint16_t, 36> boxIndices = {
+			0, 1, 2, 2, 3, 0,
+			4, 5, 6, 6, 7, 4,
+			0, 1, 5, 5, 4, 0,
+			3, 2, 6, 6, 7, 3,
+			0, 3, 7, 7, 4, 0,
+			1, 2, 6, 6, 5, 1,
+		};
+	}
+
+	/**
+	* Create the query pools and the buffers used for culling a fixed number of objects
+	*
+	* @param device Pointer to the device the culler is created on
+	* @param queue Queue used to initialize the query pools
+	* @param objectCount Number of objects, each object is identified by its index for queries, visibility and conditional rendering
+	* @param frameCount Number of query pools for host readback, needs to be at least the number of frames in flight so a pool is only reused once its frame has finished
+	* @param mode Read results on the host or predicate draws on them with conditional rendering, the latter requires VK_EXT_conditional_rendering to be enabled
+	*
+	* @note Host readback resets the query pools from the host (hostQueryReset, core since Vulkan 1.2), so unsubmitted frames always read as unavailable
+	*/
+	void OcclusionCuller::create(vks::VulkanDevice* device, VkQueue queue, uint32_t objectCount, uint32_t frameCount, Mode mode)
+	{
+		assert(objectCount > 0);
+		this->device = device;
+		this->objectCount = objectCount;
+		this->mode = mode;
+		const VkDevice logicalDevice = device->m_device;
+
+		// All results are copied on the GPU in submission order with conditional rendering, so a single pool is enough
+		frames.resize((mode == Mode::ConditionalRendering) ? 1 : std::max(frameCount, 1u));
+		currentFrame = 0;
+		frameNumber = 0;
+		VkQueryPoolCreateInfo queryPoolCI{};
+		queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolCI.queryType = VK_QUERY_TYPE_OCCLUSION;
+		queryPoolCI.queryCount = objectCount;
+		for (Frame& frame : frames) {
+			frame = Frame{};
+			VK_CHECK_RESULT(vkCreateQueryPool(logicalDevice, &queryPoolCI, nullptr, &frame.queryPool));
+		}
+
+		// Everything is visible until the first results arrive
+		visibility.assign(objectCount, 1);
+		visibilityFrameNumbers.assign(objectCount, 0);
+		results.resize(static_cast<size_t>(objectCount) * 2);
+		statistics = Statistics{};
+
+		VK_CHECK_RESULT(device->createBuffer(
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&boxVertexBuffer,
+			sizeof(boxVertices),
+			(void*)boxVertices.data()));
+		VK_CHECK_RESULT(device->createBuffer(
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&boxIndexBuffer,
+			sizeof(boxIndices),
+			(void*)boxIndices.data()));
+
+		if (mode == Mode::HostReadback) {
+			for (Frame& frame : frames) {
+				vkResetQueryPool(logicalDevice, frame.queryPool, 0, objectCount);
+			}
+			return;
+		}
+
+		// The conditional rendering functions are part of an extension so they have to be loaded manually
+		vkCmdBeginConditionalRenderingEXT = reinterpret_cast<PFN_vkCmdBeginConditionalRenderingEXT>(vkGetDeviceProcAddr(logicalDevice, "vkCmdBeginConditionalRenderingEXT"));
+		vkCmdEndConditionalRenderingEXT = reinterpret_cast<PFN_vkCmdEndConditionalRenderingEXT>(vkGetDeviceProcAddr(logicalDevice, "vkCmdEndConditionalRenderingEXT"));
+		if (!vkCmdBeginConditionalRenderingEXT || !vkCmdEndConditionalRenderingEXT) {
+			vks::tools::exitFatal("Could not get valid function pointers for VK_EXT_conditional_rendering", -1);
+		}
+
+		// Host visible, so the predicates of the last finished frame can be counted on the host for statistics
+		std::vector<uint32_t> predicates(objectCount, 1);
+		VK_CHECK_RESULT(device->createBuffer(
+			VK_BUFFER_USAGE_CONDITIONAL_RENDERING_BIT_EXT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&predicateBuffer,
+			sizeof(uint32_t) * objectCount,
+			predicates.data()));
+		VK_CHECK_RESULT(predicateBuffer.map());
+
+		// The first frame copies the results before any queries have been recorded, empty queries make them available (with no passed samples)
+		VkCommandPool commandPool = device->createCommandPool(device->queueFamilyIndices.graphics);
+		VkCommandBuffer commandBuffer = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, commandPool, true);
+		vkCmdResetQueryPool(commandBuffer, frames[0].queryPool, 0, objectCount);
+		for (uint32_t i = 0; i < objectCount; i++) {
+			vkCmdBeginQuery(commandBuffer, frames[0].queryPool, i, 0);
+			vkCmdEndQuery(commandBuffer, frames[0].queryPool, i);
+		}
+		device->flushCommandBuffer(commandBuffer, queue, commandPool);
+		vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
+	}
+
+	/**
+	* Release all Vulkan resources of the culler
+	*/
+	void OcclusionCuller::destroy()
+	{
+		if (!device) {
+			return;
+		}
+		for (Frame& frame : frames) {
+			vkDestroyQueryPool(device->m_device, frame.queryPool, nullptr);
+		}
+		frames.clear();
+		boxVertexBuffer.destroy();
+		boxIndexBuffer.destroy();
+		predicateBuffer.destroy();
+		device = nullptr;
+	}
+
+	void OcclusionCuller::readResults(Frame& frame)
+	{
+		// Never waits, queries that haven't finished yet are returned with an availability of zero
+		const VkResult result = vkGetQueryPoolResults(device->m_device, frame.queryPool, 0, objectCount, sizeof(uint64_t) * results.size(), results.data(), sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		if (result != VK_NOT_READY) {
+			VK_CHECK_RESULT(result);
+		}
+		uint32_t resultCount = 0;
+		for (uint32_t i = 0; i < objectCount; i++) {
+			if (results[i * 2 + 1] == 0) {
+				continue;
+			}
+			resultCount++;
+			// Results of older frames may arrive after those of newer frames, only the newest result of an object is kept
+			if (frame.frameNumber > visibilityFrameNumbers[i]) {
+				visibility[i] = (results[i * 2] > 0) ? 1 : 0;
+				visibilityFrameNumbers[i] = frame.frameNumber;
+			}
+		}
+		frame.resultCount = resultCount;
+		frame.pending = (resultCount < frame.queryCount);
+	}
+
+	/**
+	* Update the visibility of all objects, needs to be called once per frame before recording the frame's queries
+	*
+	* @note With host readback this reads the available results of all submitted frames and moves on to the next frame's query pool,
+	* with conditional rendering it only counts the predicates of the last finished frame for the statistics
+	*/
+	void OcclusionCuller::update()
+	{
+		assert(device);
+		statistics.visible = 0;
+		if (mode == Mode::ConditionalRendering) {
+			const uint32_t* predicates = static_cast<const uint32_t*>(predicateBuffer.mapped);
+			for (uint32_t i = 0; i < objectCount; i++) {
+				statistics.visible += (predicates[i] != 0) ? 1 : 0;
+			}
+			statistics.occluded = objectCount - statistics.visible;
+			return;
+		}
+
+		statistics.pending = 0;
+		const uint32_t count = static_cast<uint32_t>(frames.size());
+		for (uint32_t i = 1; i <= count; i++) {
+			Frame& frame = frames[(currentFrame + i) % count];
+			if (frame.pending) {
+				readResults(frame);
+				statistics.pending += frame.queryCount - frame.resultCount;
+			}
+		}
+
+		// The pool was last used frameCount frames ago, that frame has finished so the pool can be reset from the host
+		currentFrame = (currentFrame + 1) % count;
+		frameNumber++;
+		Frame& frame = frames[currentFrame];
+		if (frame.pending) {
+			statistics.droppedFrames++;
+		}
+		vkResetQueryPool(device->m_device, frame.queryPool, 0, objectCount);
+		frame.frameNumber = frameNumber;
+		frame.queryCount = 0;
+		frame.resultCount = 0;
+		frame.pending = false;
+
+		for (uint32_t i = 0; i < objectCount; i++) {
+			statistics.visible += visibility[i];
+		}
+		statistics.occluded = objectCount - statistics.visible;
+	}
+
+	/**
+	* Visibility of an object, as known on the host
+	* @note Objects that are not visible should be queried with their bounding box (host readback)
+	*/
+	bool OcclusionCuller::visible(uint32_t object) const
+	{
+		assert(object < objectCount);
+		if (mode == Mode::ConditionalRendering) {
+			return static_cast<const uint32_t*>(predicateBuffer.mapped)[object] != 0;
+		}
+		return visibility[object] != 0;
+	}
+
+	/**
+	* Record the start of a frame, needs to be recorded outside of a render pass and before any queries of the frame
+	*
+	* @note With conditional rendering this copies the results of the last submitted frame into the predicate buffer and resets the queries,
+	* the copy waits for the results on the GPU (which has usually finished the previous frame) instead of on the host
+	*/
+	void OcclusionCuller::beginFrame(VkCommandBuffer commandBuffer)
+	{
+		Frame& frame = frames[currentFrame];
+		if (mode == Mode::HostReadback) {
+			// The pool has been reset from the host in update, recording a frame again (e.g. after an overlay update) replaces its queries
+			frame.queryCount = 0;
+			frame.pending = true;
+			return;
+		}
+
+		// Previous frames may still read the predicates
+		VkBufferMemoryBarrier bufferBarrier = vks::initializers::bufferMemoryBarrier();
+		bufferBarrier.srcAccessMask = VK_ACCESS_CONDITIONAL_RENDERING_READ_BIT_EXT;
+		bufferBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		bufferBarrier.buffer = predicateBuffer.buffer;
+		bufferBarrier.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_CONDITIONAL_RENDERING_BIT_EXT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+		// Non-zero sample counts enable draws, 32 bit results match the size of a predicate
+		vkCmdCopyQueryPoolResults(commandBuffer, frame.queryPool, 0, objectCount, predicateBuffer.buffer, 0, sizeof(uint32_t), VK_QUERY_RESULT_WAIT_BIT);
+
+		bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		bufferBarrier.dstAccessMask = VK_ACCESS_CONDITIONAL_RENDERING_READ_BIT_EXT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_CONDITIONAL_RENDERING_BIT_EXT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+		// Resets are ordered after the copy of the same queries
+		vkCmdResetQueryPool(commandBuffer, frame.queryPool, 0, objectCount);
+	}
+
+	/**
+	* Begin the query of an object, all draws until endQuery count towards its visibility
+	* @note Queries are not precise, only zero and non-zero sample counts are distinguished
+	*/
+	void OcclusionCuller::beginQuery(VkCommandBuffer commandBuffer, uint32_t object)
+	{
+		assert(object < objectCount);
+		Frame& frame = frames[currentFrame];
+		vkCmdBeginQuery(commandBuffer, frame.queryPool, object, 0);
+		frame.queryCount++;
+	}
+
+	void OcclusionCuller::endQuery(VkCommandBuffer commandBuffer, uint32_t object)
+	{
+		vkCmdEndQuery(commandBuffer, frames[currentFrame].queryPool, object);
+	}
+
+	/**
+	* Begin a section of draws that is only executed if the object was visible in the last finished frame
+	*
+	* @param commandBuffer Command buffer to record to
+	* @param object Index of the object
+	* @param inverted Only execute the draws if the object was occluded instead
+	*/
+	void OcclusionCuller::beginConditionalRendering(VkCommandBuffer commandBuffer, uint32_t object, bool inverted)
+	{
+		assert(mode == Mode::ConditionalRendering);
+		VkConditionalRenderingBeginInfoEXT conditionalRenderingBeginInfo{};
+		conditionalRenderingBeginInfo.sType = VK_STRUCTURE_TYPE_CONDITIONAL_RENDERING_BEGIN_INFO_EXT;
+		conditionalRenderingBeginInfo.buffer = predicateBuffer.buffer;
+		conditionalRenderingBeginInfo.offset = sizeof(uint32_t) * object;
+		conditionalRenderingBeginInfo.flags = inverted ? VK_CONDITIONAL_RENDERING_INVERTED_BIT_EXT : 0;
+		vkCmdBeginConditionalRenderingEXT(commandBuffer, &conditionalRenderingBeginInfo);
+	}
+
+	void OcclusionCuller::endConditionalRendering(VkCommandBuffer commandBuffer)
+	{
+		vkCmdEndConditionalRenderingEXT(commandBuffer);
+	}
+
+	/**
+	* Draw the unit cube, the bound pipeline needs a single vec3 position attribute at binding 0 and transforms the cube to the object's bounds
+	* @note The pipeline should test against the depth buffer without writing depth or color
+	*/
+	void OcclusionCuller::drawBoundingBox(VkCommandBuffer commandBuffer)
+	{
+		const VkDeviceSize offsets[1] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &boxVertexBuffer.buffer, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, boxIndexBuffer.buffer, 0, VK_INDEX_TYPE_UINT16);
+		vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(boxIndices.size()), 1, 0, 0, 0);
+	}
+}
@@ -0,0 +1,94 @@
+/*
+* Vulkan occlusion culling with occlusion queries
+*
+* Temporally coherent visibility of many objects from occlusion queries, read back without waiting for the GPU or consumed on the GPU with conditional rendering
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "vulkan/vulkan.h"
+#include "VulkanTools.h"
+#include "VulkanBuffer.h"
+
+namespace vks
+{
+	struct VulkanDevice;
+
+	/**
+	* @brief Occlusion culling of many objects with one occlusion query per object and frame, without stalling the host on the GPU
+	* @note Visibility is temporally coherent: Objects that were visible in the last frame with results are rendered, all other objects are only tested with their bounding box.
+	* Objects that become visible are rendered one frame late (or more, if results arrive late), occluded objects are never rendered in frames they are visible in.
+	*
+	* With host readback every frame has its own query pool, update reads the results of all submitted frames with VK_QUERY_RESULT_WITH_AVAILABILITY_BIT and never waits.
+	* Visible objects are queried with the draws of their geometry, occluded objects with their bounding box, so the visibility needs to be known while recording.
+	*
+	* With conditional rendering (VK_EXT_conditional_rendering) the results are copied into a predicate buffer on the GPU at the start of each frame and draws are predicated on them.
+	* Command buffers don't depend on the results and can be recorded once, all objects are queried with their bounding boxes.
+	*/
+	class OcclusionCuller
+	{
+	public:
+		enum class Mode { HostReadback, ConditionalRendering };
+
+		struct Statistics {
+			// Objects rendered in the next recorded frame (host readback) or in the last finished frame (conditional rendering)
+			uint32_t visible{ 0 };
+			uint32_t occluded{ 0 };
+			// Queries of submitted frames that had no result yet at the last update
+			uint32_t pending{ 0 };
+			// Frames whose query pool had to be reused before all of its results were available
+			uint64_t droppedFrames{ 0 };
+		} statistics;
+
+		// Unit cube from (0, 0, 0) to (1, 1, 1) with three floats per vertex and 16 bit indices, drawn by drawBoundingBox
+		vks::Buffer boxVertexBuffer;
+		vks::Buffer boxIndexBuffer;
+		// One 32 bit predicate per object, only used with conditional rendering
+		vks::Buffer predicateBuffer;
+
+		Mode mode{ Mode::HostReadback };
+		uint32_t objectCount{ 0 };
+
+		void create(vks::VulkanDevice* device, VkQueue queue, uint32_t objectCount, uint32_t frameCount, Mode mode);
+		void destroy();
+		void update();
+		bool visible(uint32_t object) const;
+		void beginFrame(VkCommandBuffer commandBuffer);
+		void beginQuery(VkCommandBuffer commandBuffer, uint32_t object);
+		void endQuery(VkCommandBuffer commandBuffer, uint32_t object);
+		void beginConditionalRendering(VkCommandBuffer commandBuffer, uint32_t object, bool inverted = false);
+		void endConditionalRendering(VkCommandBuffer commandBuffer);
+		void drawBoundingBox(VkCommandBuffer commandBuffer);
+
+	private:
+		struct Frame {
+			VkQueryPool queryPool{ VK_NULL_HANDLE };
+			// Number of the frame the pool's queries were recorded for, 0 if it hasn't been used yet
+			uint64_t frameNumber{ 0 };
+			// Queries recorded for the frame and how many of them have a result
+			uint32_t queryCount{ 0 };
+			uint32_t resultCount{ 0 };
+			// Submitted and not all results read yet
+			bool pending{ false };
+		};
+
+		vks::VulkanDevice* device{ nullptr };
+		std::vector<Frame> frames;
+		uint32_t currentFrame{ 0 };
+		uint64_t frameNumber{ 0 };
+		// Per object visibility and the number of the frame it was last determined from
+		std::vector<uint8_t> visibility;
+		std::vector<uint64_t> visibilityFrameNumbers;
+		std::vector<uint64_t> results;
+		PFN_vkCmdBeginConditionalRenderingEXT vkCmdBeginConditionalRenderingEXT{ VK_NULL_HANDLE };
+		PFN_vkCmdEndConditionalRenderingEXT vkCmdEndConditionalRenderingEXT{ VK_NULL_HANDLE };
+
+		void readResults(Frame& frame);
+	};
+}
@@ -0,0 +1,189 @@
+/*
+* Vulkan compute radix sort
+*
+* Stable GPU sort of 32 bit keys with attached 32 bit values (e.g. depth keys and particle indices) in storage buffers
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <cassert>
+#include <vector>
+
+#include "VulkanRadixSort.h"
+#include "VulkanDevice.h"
+
+namespace vks
+{
+	namespace
+	{
+		const uint32_t digitBits = 8;
+		const uint32_t digitCount = 1 << digitBits;
+
+		// Push constant block of the radix sort shader
+		struct PassConstants {
+			uint32_t count;
+			uint32_t shift;
+			uint32_t blockCount;
+		};
+	}
+
+	/**
+	* Create the internal buffers and the compute pipelines of the sort
+	*
+	* @param device Pointer to the device the sort is created on
+	* @param keyBuffer Buffer with the keys to sort, needs to be created with VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+	* @param valueBuffer Buffer with one value per key, needs to be created with VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+	* @param maxCount Maximum number of keys sorted by a single call of record
+	* @param shaderStage Compute shader stage of base/radixsort.comp
+	* @param (Optional) pipelineCache Pipeline cache used for creating the compute pipelines
+	*/
+	void ComputeRadixSort::create(vks::VulkanDevice* device, VkBuffer keyBuffer, VkBuffer valueBuffer, uint32_t maxCount, VkPipelineShaderStageCreateInfo shaderStage, VkPipelineCache pipelineCache)
+	{
+		this->device = device;
+		this->keyBuffer = keyBuffer;
+		this->valueBuffer = valueBuffer;
+		this->maxCount = maxCount;
+		const VkDevice logicalDevice = device->m_device;
+
+		// All internal buffers share one allocation
+		const uint32_t maxBlockCount = (maxCount + blockSize - 1) / blockSize;
+		const VkDeviceSize elementsSize = static_cast<VkDeviceSize>(maxCount) * sizeof(uint32_t);
+		const VkDeviceSize histogramsSize = static_cast<VkDeviceSize>(maxBlockCount) * digitCount * sizeof(uint32_t);
+		std::array<VkBuffer*, 3> buffers = { &tempKeyBuffer, &tempValueBuffer, &histogramBuffer };
+		std::array<VkDeviceSize, 3> sizes = { elementsSize, elementsSize, histogramsSize };
+		std::array<VkDeviceSize, 3> offsets{};
+		VkDeviceSize memorySize = 0;
+		uint32_t memoryTypeBits = ~0u;
+		for (size_t i = 0; i < buffers.size(); i++) {
+			VkBufferCreateInfo bufferCI = vks::initializers::bufferCreateInfo(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizes[i]);
+			VK_CHECK_RESULT(vkCreateBuffer(logicalDevice, &bufferCI, nullptr, buffers[i]));
+			VkMemoryRequirements memReqs;
+			vkGetBufferMemoryRequirements(logicalDevice, *buffers[i], &memReqs);
+			offsets[i] = (memorySize + memReqs.alignment - 1) & ~(memReqs.alignment - 1);
+			memorySize = offsets[i] + memReqs.size;
+			memoryTypeBits &= memReqs.memoryTypeBits;
+		}
+		VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
+		memAllocInfo.allocationSize = memorySize;
+		memAllocInfo.memoryTypeIndex = device->getMemoryType(memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		VK_CHECK_RESULT(vkAllocateMemory(logicalDevice, &memAllocInfo, nullptr, &memory));
+		for (size_t i = 0; i < buffers.size(); i++) {
+			VK_CHECK_RESULT(vkBindBufferMemory(logicalDevice, *buffers[i], memory, offsets[i]));
+		}
+
+		// Binding 0 : Keys in, binding 1 : Values in, binding 2 : Keys out, binding 3 : Values out, binding 4 : Block histograms
+		std::vector<VkDescriptorPoolSize> poolSizes = {
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 10),
+		};
+		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, 2);
+		VK_CHECK_RESULT(vkCreateDescriptorPool(logicalDevice, &descriptorPoolInfo, nullptr, &descriptorPool));
+		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings;
+		for (uint32_t binding = 0; binding < 5; binding++) {
+			setLayoutBindings.push_back(vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, binding));
+		}
+		VkDescriptorSetLayoutCreateInfo descriptorLayout = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(logicalDevice, &descriptorLayout, nullptr, &descriptorSetLayout));
+		std::array<VkDescriptorSetLayout, 2> setLayouts = { descriptorSetLayout, descriptorSetLayout };
+		VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, setLayouts.data(), 2);
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(logicalDevice, &allocInfo, descriptorSets.data()));
+		VkDescriptorBufferInfo keys = { keyBuffer, 0, elementsSize };
+		VkDescriptorBufferInfo values = { valueBuffer, 0, elementsSize };
+		VkDescriptorBufferInfo tempKeys = { tempKeyBuffer, 0, elementsSize };
+		VkDescriptorBufferInfo tempValues = { tempValueBuffer, 0, elementsSize };
+		VkDescriptorBufferInfo histograms = { histogramBuffer, 0, histogramsSize };
+		for (uint32_t i = 0; i < 2; i++) {
+			const bool fromCaller = (i == 0);
+			std::array<VkWriteDescriptorSet, 5> writeDescriptorSets = {
+				vks::initializers::writeDescriptorSet(descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, fromCaller ? &keys : &tempKeys),
+				vks::initializers::writeDescriptorSet(descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, fromCaller ? &values : &tempValues),
+				vks::initializers::writeDescriptorSet(descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, fromCaller ? &tempKeys : &keys),
+				vks::initializers::writeDescriptorSet(descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, fromCaller ? &tempValues : &values),
+				vks::initializers::writeDescriptorSet(descriptorSets[i], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, &histograms),
+			};
+			vkUpdateDescriptorSets(logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+		}
+
+		// One pipeline per kernel, all of them share the layout
+		VkPushConstantRange pushConstantRange = vks::initializers::pushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(PassConstants), 0);
+		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = vks::initializers::pipelineLayoutCreateInfo(&descriptorSetLayout, 1);
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+		VK_CHECK_RESULT(vkCreatePipelineLayout(logicalDevice, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout));
+		const VkSpecializationMapEntry specializationMapEntry = vks::initializers::specializationMapEntry(0, 0, sizeof(uint32_t));
+		for (uint32_t kernel = 0; kernel < KernelCount; kernel++) {
+			const VkSpecializationInfo specializationInfo = vks::initializers::specializationInfo(1, &specializationMapEntry, sizeof(uint32_t), &kernel);
+			VkComputePipelineCreateInfo computePipelineCreateInfo = vks::initializers::computePipelineCreateInfo(pipelineLayout, 0);
+			computePipelineCreateInfo.stage = shaderStage;
+			computePipelineCreateInfo.stage.pSpecializationInfo = &specializationInfo;
+			VK_CHECK_RESULT(vkCreateComputePipelines(logicalDevice, pipelineCache, 1, &computePipelineCreateInfo, nullptr, &pipelines[kernel]));
+		}
+	}
+
+	/**
+	* Release all Vulkan resources of the sort, the caller's buffers are not touched
+	*/
+	void ComputeRadixSort::destroy()
+	{
+		if (!device) {
+			return;
+		}
+		const VkDevice logicalDevice = device->m_device;
+		for (VkPipeline pipeline : pipelines) {
+			vkDestroyPipeline(logicalDevice, pipeline, nullptr);
+		}
+		vkDestroyPipelineLayout(logicalDevice, pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(logicalDevice, descriptorSetLayout, nullptr);
+		vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
+		vkDestroyBuffer(logicalDevice, tempKeyBuffer, nullptr);
+		vkDestroyBuffer(logicalDevice, tempValueBuffer, nullptr);
+		vkDestroyBuffer(logicalDevice, histogramBuffer, nullptr);
+		vkFreeMemory(logicalDevice, memory, nullptr);
+		pipelines = {};
+		descriptorSets = {};
+		device = nullptr;
+	}
+
+	/**
+	* Record the commands that sort the first count keys (and their values) in ascending order
+	*
+	* @param commandBuffer Command buffer to record to, outside of a render pass
+	* @param count Number of keys to sort, at most the maxCount the sort was created with
+	*
+	* @note Compute shader writes to the keys and values before this are made visible, the sorted buffers are made visible to all later commands
+	*/
+	void ComputeRadixSort::record(VkCommandBuffer commandBuffer, uint32_t count)
+	{
+		assert(count <= maxCount);
+		if (count < 2) {
+			return;
+		}
+		VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		PassConstants constants{};
+		constants.count = count;
+		constants.blockCount = (count + blockSize - 1) / blockSize;
+		for (uint32_t pass = 0; pass < 32 / digitBits; pass++) {
+			constants.shift = pass * digitBits;
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[pass % 2], 0, nullptr);
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PassConstants), &constants);
+			// Every kernel reads what the previous one wrote
+			const std::array<uint32_t, KernelCount> groupCounts = { constants.blockCount, 1, constants.blockCount };
+			for (uint32_t kernel = 0; kernel < KernelCount; kernel++) {
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines[kernel]);
+				vkCmdDispatch(commandBuffer, groupCounts[kernel], 1, 1);
+				if ((pass < 32 / digitBits - 1) || (kernel != Scatter)) {
+					vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+				}
+			}
+		}
+
+		// The sorted values are often used as indices or read by vertex shaders
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	}
+}
@@ -0,0 +1,57 @@
+/*
+* Vulkan compute radix sort
+*
+* Stable GPU sort of 32 bit keys with attached 32 bit values (e.g. depth keys and particle indices) in storage buffers
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <array>
+
+#include "vulkan/vulkan.h"
+#include "VulkanTools.h"
+
+namespace vks
+{
+	struct VulkanDevice;
+
+	/**
+	* @brief Least significant digit radix sort of key/value buffers with compute shaders
+	* @note Sorts in four passes of eight bits, every pass runs three kernels of base/radixsort.comp (selected with a specialization constant):
+	* Per block digit histograms, one prefix sum over all histograms (digit major, so equal keys keep their order) and a stable scatter of every block.
+	* Passes ping-pong between the caller's buffers and internal buffers of the same size, after an even number of passes the result is back in the caller's buffers.
+	*/
+	class ComputeRadixSort
+	{
+	public:
+		/** @brief Number of keys sorted by one workgroup, needs to match the shader */
+		static const uint32_t blockSize = 1024;
+
+		void create(vks::VulkanDevice* device, VkBuffer keyBuffer, VkBuffer valueBuffer, uint32_t maxCount, VkPipelineShaderStageCreateInfo shaderStage, VkPipelineCache pipelineCache = VK_NULL_HANDLE);
+		void destroy();
+		void record(VkCommandBuffer commandBuffer, uint32_t count);
+
+	private:
+		enum Kernel : uint32_t { Histogram = 0, Scan = 1, Scatter = 2, KernelCount = 3 };
+
+		vks::VulkanDevice* device{ nullptr };
+		uint32_t maxCount{ 0 };
+		VkBuffer keyBuffer{ VK_NULL_HANDLE };
+		VkBuffer valueBuffer{ VK_NULL_HANDLE };
+		// Ping-pong buffers and the block histograms
+		VkBuffer tempKeyBuffer{ VK_NULL_HANDLE };
+		VkBuffer tempValueBuffer{ VK_NULL_HANDLE };
+		VkBuffer histogramBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory memory{ VK_NULL_HANDLE };
+		VkDescriptorPool descriptorPool{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout descriptorSetLayout{ VK_NULL_HANDLE };
+		// Set 0 reads the caller's buffers and writes the internal ones, set 1 the other way round
+		std::array<VkDescriptorSet, 2> descriptorSets{};
+		VkPipelineLayout pipelineLayout{ VK_NULL_HANDLE };
+		std::array<VkPipeline, KernelCount> pipelines{};
+	};
+}
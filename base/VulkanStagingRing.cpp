@@ -0,0 +1,578 @@
+/*
+* Vulkan staging ring buffer
+*
+* Persistently mapped, host coherent staging memory shared by all upload paths of a device
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "VulkanStagingRing.h"
+#include "VulkanDevice.h"
+
+namespace vks
+{
+	/**
+	* Create the ring buffer, its command pools and the fixed set of batches used to submit copies
+	*
+	* @param device Pointer to the device the ring allocates its memory from
+	* @param queue Graphics queue that uploaded resources are used on
+	* @param queueFamilyIndex Family index of the graphics queue
+	* @param (Optional) transferQueue Queue from a dedicated transfer family to execute the copies on (Defaults to none, copies are executed on queue)
+	* @param (Optional) transferQueueFamilyIndex Family index of the transfer queue
+	* @param (Optional) size Size of the ring in bytes (Defaults to 64 MiB)
+	*
+	* @note The ring is not thread safe, all uploads using it must be issued from the same thread
+	*/
+	void StagingRing::create(vks::VulkanDevice* device, VkQueue queue, uint32_t queueFamilyIndex, VkQueue transferQueue, uint32_t transferQueueFamilyIndex, VkDeviceSize size)
+	{
+		assert(!isCreated());
+		this->device = device;
+		this->queue = queue;
+		this->queueFamilyIndex = queueFamilyIndex;
+		this->size = size;
+
+		// Timeline semaphores are core since 1.2, but still an optional feature
+		VkPhysicalDeviceVulkan12Features features12{};
+		features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		VkPhysicalDeviceFeatures2 features2{};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &features12;
+		vkGetPhysicalDeviceFeatures2(device->m_physicalDevice, &features2);
+		if (features12.timelineSemaphore) {
+			VkSemaphoreTypeCreateInfo semaphoreTypeCI{};
+			semaphoreTypeCI.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+			semaphoreTypeCI.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+			semaphoreTypeCI.initialValue = 0;
+			VkSemaphoreCreateInfo semaphoreCI = vks::initializers::semaphoreCreateInfo();
+			semaphoreCI.pNext = &semaphoreTypeCI;
+			VK_CHECK_RESULT(vkCreateSemaphore(*device, &semaphoreCI, nullptr, &timelineSemaphore));
+		}
+		timelineValue = 0;
+
+		// Copies only run on a separate queue if the graphics queue can wait for them on the timeline semaphore
+		dedicatedTransfer = (transferQueue != VK_NULL_HANDLE) && (transferQueueFamilyIndex != queueFamilyIndex) && (timelineSemaphore != VK_NULL_HANDLE);
+		if (dedicatedTransfer) {
+			VkSemaphoreTypeCreateInfo semaphoreTypeCI{};
+			semaphoreTypeCI.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+			semaphoreTypeCI.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+			semaphoreTypeCI.initialValue = 0;
+			VkSemaphoreCreateInfo semaphoreCI = vks::initializers::semaphoreCreateInfo();
+			semaphoreCI.pNext = &semaphoreTypeCI;
+			VK_CHECK_RESULT(vkCreateSemaphore(*device, &semaphoreCI, nullptr, &acquireSemaphore));
+		}
+		this->transferQueue = dedicatedTransfer ? transferQueue : queue;
+		this->transferQueueFamilyIndex = dedicatedTransfer ? transferQueueFamilyIndex : queueFamilyIndex;
+
+		VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, size, &buffer, &memory));
+		// Keep the ring mapped for its whole lifetime
+		void* data;
+		VK_CHECK_RESULT(vkMapMemory(*device, memory, 0, VK_WHOLE_SIZE, 0, &data));
+		mapped = static_cast<uint8_t*>(data);
+
+		commandPool = device->createCommandPool(this->transferQueueFamilyIndex, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+		if (dedicatedTransfer) {
+			graphicsCommandPool = device->createCommandPool(queueFamilyIndex, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+		}
+
+		batches.resize(maxBatchesInFlight);
+		VkFenceCreateInfo fenceInfo = vks::initializers::fenceCreateInfo(VK_FLAGS_NONE);
+		for (uint32_t i = 0; i < maxBatchesInFlight; i++) {
+			batches[i].commandBuffer = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, commandPool, false);
+			if (dedicatedTransfer) {
+				batches[i].graphicsCommandBuffer = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, graphicsCommandPool, false);
+			}
+			VK_CHECK_RESULT(vkCreateFence(*device, &fenceInfo, nullptr, &batches[i].fence));
+			available.push_back(i);
+		}
+		head = tail = 0;
+		recording = -1;
+	}
+
+	/**
+	* Wait for all pending copies and release all Vulkan resources of the ring
+	*/
+	void StagingRing::destroy()
+	{
+		if (!isCreated()) {
+			return;
+		}
+		flush();
+		for (auto& batch : batches) {
+			vkDestroyFence(*device, batch.fence, nullptr);
+		}
+		batches.clear();
+		available.clear();
+		inFlight.clear();
+		vkDestroyCommandPool(*device, commandPool, nullptr);
+		if (graphicsCommandPool != VK_NULL_HANDLE) {
+			vkDestroyCommandPool(*device, graphicsCommandPool, nullptr);
+		}
+		if (timelineSemaphore != VK_NULL_HANDLE) {
+			vkDestroySemaphore(*device, timelineSemaphore, nullptr);
+		}
+		if (acquireSemaphore != VK_NULL_HANDLE) {
+			vkDestroySemaphore(*device, acquireSemaphore, nullptr);
+		}
+		vkUnmapMemory(*device, memory);
+		vkDestroyBuffer(*device, buffer, nullptr);
+		vkFreeMemory(*device, memory, nullptr);
+		commandPool = VK_NULL_HANDLE;
+		graphicsCommandPool = VK_NULL_HANDLE;
+		timelineSemaphore = VK_NULL_HANDLE;
+		acquireSemaphore = VK_NULL_HANDLE;
+		buffer = VK_NULL_HANDLE;
+		memory = VK_NULL_HANDLE;
+		mapped = nullptr;
+	}
+
+	/**
+	* Try to place an allocation between head and tail without waiting
+	*
+	* @note The ring is full when head is right behind tail, head and tail are only equal if the ring is empty
+	*/
+	bool StagingRing::tryPlace(VkDeviceSize allocSize, VkDeviceSize alignment, VkDeviceSize& offset)
+	{
+		// Alignment is not necessarily a power of two (e.g. for three component formats)
+		VkDeviceSize aligned = ((head + alignment - 1) / alignment) * alignment;
+		if (head >= tail) {
+			// Free space is [head, size) and [0, tail)
+			if (aligned + allocSize <= size) {
+				offset = aligned;
+				head = aligned + allocSize;
+				return true;
+			}
+			if (allocSize < tail) {
+				offset = 0;
+				head = allocSize;
+				return true;
+			}
+			return false;
+		}
+		// Free space is [head, tail)
+		if (aligned + allocSize < tail) {
+			offset = aligned;
+			head = aligned + allocSize;
+			return true;
+		}
+		return false;
+	}
+
+	/**
+	* Start recording a new batch, waits for the oldest batch if all of them are in flight
+	*/
+	void StagingRing::beginBatch()
+	{
+		// Reclaim everything the GPU has already finished with
+		while (!inFlight.empty() && retire(false));
+		if (available.empty()) {
+			retire(true);
+		}
+		recording = available.back();
+		available.pop_back();
+		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
+		cmdBufInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VK_CHECK_RESULT(vkBeginCommandBuffer(batches[recording].commandBuffer, &cmdBufInfo));
+		if (dedicatedTransfer) {
+			VK_CHECK_RESULT(vkBeginCommandBuffer(batches[recording].graphicsCommandBuffer, &cmdBufInfo));
+		}
+	}
+
+	/**
+	* Release the ring memory of the oldest batch in flight
+	*
+	* @param wait If true, blocks until the batch has finished executing, otherwise only checks the fence status
+	*
+	* @return True if a batch has been retired
+	*/
+	bool StagingRing::retire(bool wait)
+	{
+		assert(!inFlight.empty());
+		Batch& batch = batches[inFlight.front()];
+		if (wait) {
+			VK_CHECK_RESULT(vkWaitForFences(*device, 1, &batch.fence, VK_TRUE, DEFAULT_FENCE_TIMEOUT));
+		} else if (vkGetFenceStatus(*device, batch.fence) != VK_SUCCESS) {
+			return false;
+		}
+		if (dedicatedTransfer) {
+			// The acquire command buffer can only be reused once the graphics queue has executed it
+			const bool acquirePending = std::find(pendingAcquires.begin(), pendingAcquires.end(), inFlight.front()) != pendingAcquires.end();
+			if (wait) {
+				if (acquirePending) {
+					submitAcquires();
+				}
+				VkSemaphoreWaitInfo waitInfo{};
+				waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+				waitInfo.semaphoreCount = 1;
+				waitInfo.pSemaphores = &acquireSemaphore;
+				waitInfo.pValues = &batch.timelineValue;
+				VK_CHECK_RESULT(vkWaitSemaphores(*device, &waitInfo, DEFAULT_FENCE_TIMEOUT));
+			} else {
+				uint64_t acquiredValue = 0;
+				if (acquirePending || (vkGetSemaphoreCounterValue(*device, acquireSemaphore, &acquiredValue) != VK_SUCCESS) || (acquiredValue < batch.timelineValue)) {
+					return false;
+				}
+			}
+		}
+		VK_CHECK_RESULT(vkResetFences(*device, 1, &batch.fence));
+		VK_CHECK_RESULT(vkResetCommandBuffer(batch.commandBuffer, 0));
+		if (dedicatedTransfer) {
+			VK_CHECK_RESULT(vkResetCommandBuffer(batch.graphicsCommandBuffer, 0));
+		}
+		tail = batch.end;
+		available.push_back(inFlight.front());
+		inFlight.pop_front();
+		// Nothing references ring memory anymore, so start over at the beginning to avoid unnecessary wrapping
+		if (inFlight.empty() && !pendingCopies) {
+			head = tail = 0;
+		}
+		return true;
+	}
+
+	/**
+	* Return the command buffer of the batch currently being recorded (starts a new batch if required)
+	*
+	* @note Barriers and copies recorded into this command buffer are executed in order with all copies issued through the ring
+	*/
+	VkCommandBuffer StagingRing::getCommandBuffer()
+	{
+		assert(isCreated());
+		if (recording < 0) {
+			beginBatch();
+		}
+		return batches[recording].commandBuffer;
+	}
+
+	/**
+	* Return the graphics queue command buffer of the batch currently being recorded
+	*
+	* @note Use this for work that requires a graphics queue (e.g. blits) on resources that have been released with releaseBuffer/releaseImage.
+	* Commands recorded into it execute after the copies and acquire barriers of the batch. Without a dedicated transfer queue this is the same as getCommandBuffer().
+	*/
+	VkCommandBuffer StagingRing::getGraphicsCommandBuffer()
+	{
+		VkCommandBuffer commandBuffer = getCommandBuffer();
+		return dedicatedTransfer ? batches[recording].graphicsCommandBuffer : commandBuffer;
+	}
+
+	/**
+	* Allocate staging memory from the ring, waits for previous batches to finish if the ring is full
+	*
+	* @param allocSize Size of the allocation in bytes
+	* @param alignment (Optional) Alignment of the allocation's offset (Defaults to 16)
+	*
+	* @return The allocation, copies reading from it must be recorded into the returned command buffer
+	*
+	* @throw Throws an exception if the requested size exceeds the size of the ring
+	*/
+	StagingRing::Allocation StagingRing::allocate(VkDeviceSize allocSize, VkDeviceSize alignment)
+	{
+		if (allocSize > size) {
+			throw std::runtime_error("Staging allocation exceeds the size of the staging ring");
+		}
+		Allocation allocation{};
+		VkDeviceSize offset = 0;
+		getCommandBuffer();
+		while (!tryPlace(allocSize, alignment, offset)) {
+			// Ring is full: submit what has been recorded so far and wait for the oldest batch to free up space
+			if (pendingCopies) {
+				submit();
+			}
+			if (inFlight.empty()) {
+				head = tail = 0;
+			} else {
+				retire(true);
+			}
+			getCommandBuffer();
+		}
+		pendingCopies = true;
+		allocation.buffer = buffer;
+		allocation.offset = offset;
+		allocation.size = allocSize;
+		allocation.mapped = mapped + offset;
+		allocation.commandBuffer = batches[recording].commandBuffer;
+		return allocation;
+	}
+
+	/**
+	* Upload data to a buffer through the ring, splitting the copy if the data is larger than the ring
+	*
+	* @param data Pointer to the source data
+	* @param dataSize Size of the data in bytes
+	* @param dstBuffer Destination buffer (must have been created with VK_BUFFER_USAGE_TRANSFER_DST_BIT)
+	* @param dstOffset (Optional) Offset into the destination buffer
+	*
+	* @note Releases the copied range to the graphics queue family, so the data is visible to all work submitted to the graphics queue later on
+	*/
+	void StagingRing::copyToBuffer(const void* data, VkDeviceSize dataSize, VkBuffer dstBuffer, VkDeviceSize dstOffset)
+	{
+		// Split large uploads so that the GPU can already consume the first chunks while the rest is written
+		const VkDeviceSize maxChunkSize = size / 4;
+		const uint8_t* src = static_cast<const uint8_t*>(data);
+		VkDeviceSize copied = 0;
+		while (copied < dataSize) {
+			VkDeviceSize chunkSize = std::min(dataSize - copied, maxChunkSize);
+			Allocation allocation = allocate(chunkSize);
+			memcpy(allocation.mapped, src + copied, chunkSize);
+			VkBufferCopy copyRegion{ allocation.offset, dstOffset + copied, chunkSize };
+			vkCmdCopyBuffer(allocation.commandBuffer, allocation.buffer, dstBuffer, 1, &copyRegion);
+			copied += chunkSize;
+		}
+		releaseBuffer(dstBuffer, dstOffset, dataSize);
+	}
+
+	/**
+	* Upload data to an image through the ring
+	*
+	* @param data Pointer to the source data, the buffer offsets of the regions are relative to this
+	* @param dataSize Size of the data in bytes
+	* @param dstImage Destination image, must be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL at the time the copies execute
+	* @param regions Copy regions
+	* @param texelBlockSize (Optional) Size of a texel (block) of the image format in bytes, used to align the staging offset
+	*
+	* @note If the data does not fit into the ring at once, it's uploaded region by region
+	*/
+	void StagingRing::copyToImage(const void* data, VkDeviceSize dataSize, VkImage dstImage, const std::vector<VkBufferImageCopy>& regions, VkDeviceSize texelBlockSize)
+	{
+		// Buffer offsets for image copies need to be a multiple of the texel block size and of four
+		const VkDeviceSize alignment = (texelBlockSize % 4 == 0) ? texelBlockSize : texelBlockSize * 4;
+		const uint8_t* src = static_cast<const uint8_t*>(data);
+
+		if (dataSize <= size / 2) {
+			Allocation allocation = allocate(dataSize, alignment);
+			memcpy(allocation.mapped, src, dataSize);
+			std::vector<VkBufferImageCopy> stagedRegions = regions;
+			for (auto& region : stagedRegions) {
+				region.bufferOffset += allocation.offset;
+			}
+			vkCmdCopyBufferToImage(allocation.commandBuffer, allocation.buffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(stagedRegions.size()), stagedRegions.data());
+			return;
+		}
+
+		// Data for each region is assumed to span up to the start of the next region in memory
+		std::vector<VkDeviceSize> offsets;
+		for (auto& region : regions) {
+			offsets.push_back(region.bufferOffset);
+		}
+		offsets.push_back(dataSize);
+		std::sort(offsets.begin(), offsets.end());
+
+		for (auto region : regions) {
+			VkDeviceSize regionEnd = *std::upper_bound(offsets.begin(), offsets.end(), region.bufferOffset);
+			VkDeviceSize regionSize = regionEnd - region.bufferOffset;
+			if (regionSize <= size / 2) {
+				Allocation allocation = allocate(regionSize, alignment);
+				memcpy(allocation.mapped, src + region.bufferOffset, regionSize);
+				region.bufferOffset = allocation.offset;
+				vkCmdCopyBufferToImage(allocation.commandBuffer, allocation.buffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+			} else {
+				// Single region too large for the ring, fall back to a dedicated staging buffer
+				VkBuffer stagingBuffer;
+				VkDeviceMemory stagingMemory;
+				VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, regionSize, &stagingBuffer, &stagingMemory, const_cast<uint8_t*>(src + region.bufferOffset)));
+				region.bufferOffset = 0;
+				vkCmdCopyBufferToImage(getCommandBuffer(), stagingBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+				flush();
+				vkDestroyBuffer(*device, stagingBuffer, nullptr);
+				vkFreeMemory(*device, stagingMemory, nullptr);
+			}
+		}
+	}
+
+	/**
+	* Make a buffer range written by the ring available to the graphics queue
+	*
+	* @param dstBuffer Buffer that has been written by copies recorded against the ring
+	* @param offset (Optional) Start of the written range
+	* @param range (Optional) Size of the written range
+	* @param dstStageMask (Optional) Pipeline stages that access the buffer on the graphics queue
+	* @param dstAccessMask (Optional) Access types of these stages
+	*
+	* @note With a dedicated transfer queue this records a queue family ownership release and the matching acquire on the graphics queue
+	*/
+	void StagingRing::releaseBuffer(VkBuffer dstBuffer, VkDeviceSize offset, VkDeviceSize range, VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask)
+	{
+		VkBufferMemoryBarrier bufferBarrier = vks::initializers::bufferMemoryBarrier();
+		bufferBarrier.buffer = dstBuffer;
+		bufferBarrier.offset = offset;
+		bufferBarrier.size = range;
+		bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		bufferBarrier.dstAccessMask = dstAccessMask;
+		if (!dedicatedTransfer) {
+			vkCmdPipelineBarrier(getCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, dstStageMask, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+			return;
+		}
+		// Release on the transfer queue, destination access is ignored for the releasing queue
+		bufferBarrier.srcQueueFamilyIndex = transferQueueFamilyIndex;
+		bufferBarrier.dstQueueFamilyIndex = queueFamilyIndex;
+		bufferBarrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier(getCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+		// Acquire on the graphics queue, source access is ignored for the acquiring queue
+		bufferBarrier.srcAccessMask = 0;
+		bufferBarrier.dstAccessMask = dstAccessMask;
+		vkCmdPipelineBarrier(getGraphicsCommandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStageMask, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+	}
+
+	/**
+	* Transition an image written by the ring to its final layout and make it available to the graphics queue
+	*
+	* @param image Image that has been written by copies recorded against the ring
+	* @param subresourceRange Subresources that have been written
+	* @param oldLayout Layout the image is in after the copies (usually VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+	* @param newLayout Layout the image is used in on the graphics queue
+	* @param dstStageMask (Optional) Pipeline stages that access the image on the graphics queue
+	* @param dstAccessMask (Optional) Access types of these stages
+	*
+	* @note With a dedicated transfer queue this records a queue family ownership release and the matching acquire on the graphics queue,
+	* the layout transition is part of that ownership transfer
+	*/
+	void StagingRing::releaseImage(VkImage image, VkImageSubresourceRange subresourceRange, VkImageLayout oldLayout, VkImageLayout newLayout, VkPipelineStageFlags dstStageMask, VkAccessFlags dstAccessMask)
+	{
+		VkImageMemoryBarrier imageBarrier = vks::initializers::imageMemoryBarrier();
+		imageBarrier.image = image;
+		imageBarrier.subresourceRange = subresourceRange;
+		imageBarrier.oldLayout = oldLayout;
+		imageBarrier.newLayout = newLayout;
+		imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		imageBarrier.dstAccessMask = dstAccessMask;
+		if (!dedicatedTransfer) {
+			vkCmdPipelineBarrier(getCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, dstStageMask, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+			return;
+		}
+		imageBarrier.srcQueueFamilyIndex = transferQueueFamilyIndex;
+		imageBarrier.dstQueueFamilyIndex = queueFamilyIndex;
+		imageBarrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier(getCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+		imageBarrier.srcAccessMask = 0;
+		imageBarrier.dstAccessMask = dstAccessMask;
+		vkCmdPipelineBarrier(getGraphicsCommandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStageMask, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+	}
+
+	/**
+	* Submit all copies recorded so far without waiting for them to finish
+	*
+	* @note With a dedicated transfer queue, the copies are submitted to the transfer queue and signal the timeline semaphore.
+	* The acquire barriers of the batch wait on that value, but are only submitted to the graphics queue together with the next
+	* submitGraphics() or submitAcquires() call, so uploads don't cost an extra graphics queue submission per batch.
+	*/
+	void StagingRing::submit()
+	{
+		if (recording < 0) {
+			return;
+		}
+		Batch& batch = batches[recording];
+		VK_CHECK_RESULT(vkEndCommandBuffer(batch.commandBuffer));
+		const uint64_t signalValue = timelineValue + 1;
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.signalSemaphoreValueCount = 1;
+		timelineInfo.pSignalSemaphoreValues = &signalValue;
+		VkSubmitInfo submitInfo = vks::initializers::submitInfo();
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &batch.commandBuffer;
+		if (timelineSemaphore != VK_NULL_HANDLE) {
+			submitInfo.pNext = &timelineInfo;
+			submitInfo.signalSemaphoreCount = 1;
+			submitInfo.pSignalSemaphores = &timelineSemaphore;
+		}
+		// The fence guards the ring memory of the batch, which is no longer read once the copies have finished
+		VK_CHECK_RESULT(vkQueueSubmit(transferQueue, 1, &submitInfo, batch.fence));
+		if (dedicatedTransfer) {
+			VK_CHECK_RESULT(vkEndCommandBuffer(batch.graphicsCommandBuffer));
+			pendingAcquires.push_back(recording);
+		}
+		timelineValue = signalValue;
+		batch.timelineValue = signalValue;
+		batch.end = head;
+		inFlight.push_back(recording);
+		recording = -1;
+		pendingCopies = false;
+	}
+
+	/**
+	* Collect the acquire command buffers of all pending batches into a single graphics queue submission
+	*
+	* @param submission Submission to fill, needs to stay alive until it has been submitted
+	*
+	* @return True if there are acquires to submit
+	*/
+	bool StagingRing::prepareAcquireSubmission(AcquireSubmission& submission)
+	{
+		if (pendingAcquires.empty()) {
+			return false;
+		}
+		submission.commandBuffers.clear();
+		for (uint32_t batchIndex : pendingAcquires) {
+			submission.commandBuffers.push_back(batches[batchIndex].graphicsCommandBuffer);
+		}
+		// Timeline values increase with every batch, so waiting for the last one covers the copies of all of them
+		submission.value = batches[pendingAcquires.back()].timelineValue;
+		pendingAcquires.clear();
+		submission.timelineInfo = {};
+		submission.timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		submission.timelineInfo.waitSemaphoreValueCount = 1;
+		submission.timelineInfo.pWaitSemaphoreValues = &submission.value;
+		submission.timelineInfo.signalSemaphoreValueCount = 1;
+		submission.timelineInfo.pSignalSemaphoreValues = &submission.value;
+		submission.submitInfo = vks::initializers::submitInfo();
+		submission.submitInfo.pNext = &submission.timelineInfo;
+		submission.submitInfo.waitSemaphoreCount = 1;
+		submission.submitInfo.pWaitSemaphores = &timelineSemaphore;
+		submission.submitInfo.pWaitDstStageMask = &submission.waitStageMask;
+		submission.submitInfo.commandBufferCount = static_cast<uint32_t>(submission.commandBuffers.size());
+		submission.submitInfo.pCommandBuffers = submission.commandBuffers.data();
+		submission.submitInfo.signalSemaphoreCount = 1;
+		submission.submitInfo.pSignalSemaphores = &acquireSemaphore;
+		return true;
+	}
+
+	/**
+	* Submit work to the graphics queue, preceded by the acquire barriers of all batches submitted since the last graphics submission
+	*
+	* @param submitInfo Submission of the caller's work
+	* @param fence Fence signaled once the caller's work (and the acquires) have finished executing, may be VK_NULL_HANDLE
+	*
+	* @note Both end up in the same vkQueueSubmit call, the acquires are ordered before the caller's work by submission order
+	*/
+	void StagingRing::submitGraphics(const VkSubmitInfo& submitInfo, VkFence fence)
+	{
+		AcquireSubmission acquireSubmission;
+		if (!prepareAcquireSubmission(acquireSubmission)) {
+			VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, fence));
+			return;
+		}
+		const VkSubmitInfo submitInfos[2] = { acquireSubmission.submitInfo, submitInfo };
+		VK_CHECK_RESULT(vkQueueSubmit(queue, 2, submitInfos, fence));
+	}
+
+	/**
+	* Submit the pending acquire barriers on their own, for graphics work that isn't submitted through submitGraphics()
+	*
+	* @note Acquires of all batches submitted since the last graphics submission are combined into a single submission
+	*/
+	void StagingRing::submitAcquires()
+	{
+		AcquireSubmission acquireSubmission;
+		if (prepareAcquireSubmission(acquireSubmission)) {
+			VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &acquireSubmission.submitInfo, VK_NULL_HANDLE));
+		}
+	}
+
+	/**
+	* Submit all copies recorded so far and wait until all batches have finished executing
+	*/
+	void StagingRing::flush()
+	{
+		submit();
+		submitAcquires();
+		while (!inFlight.empty()) {
+			retire(true);
+		}
+		head = tail = 0;
+	}
+}
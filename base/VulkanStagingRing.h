@@ -0,0 +1,131 @@
+/*
+* Vulkan staging ring buffer
+*
+* Persistently mapped, host coherent staging memory shared by all upload paths of a device
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+#include <deque>
+
+#include "vulkan/vulkan.h"
+#include "VulkanTools.h"
+
+namespace vks
+{
+	struct VulkanDevice;
+
+	/**
+	* @brief Ring allocator on top of a single persistently mapped staging buffer
+	* @note Copies recorded against the ring are batched into one command buffer and submitted with a fence,
+	* ring memory is reclaimed once that fence has been signaled. No memory is allocated after create().
+	* If a dedicated transfer queue is passed at creation, copies are executed on that queue and ownership
+	* of the destination resources is transferred to the graphics queue family by the release functions.
+	* The matching acquires are not submitted on their own, but together with the next graphics submission
+	* made through submitGraphics() (or by submitAcquires() before graphics work that isn't).
+	*/
+	class StagingRing
+	{
+	public:
+		/** @brief A sub allocation from the ring, commands reading from it must be recorded into commandBuffer */
+		struct Allocation {
+			VkBuffer buffer{ VK_NULL_HANDLE };
+			VkDeviceSize offset{ 0 };
+			VkDeviceSize size{ 0 };
+			void* mapped{ nullptr };
+			VkCommandBuffer commandBuffer{ VK_NULL_HANDLE };
+		};
+
+		/** @brief Default size of the ring (can be overriden at creation time) */
+		static const VkDeviceSize defaultSize = 64 * 1024 * 1024;
+		/** @brief Number of batches that may be in flight at the same time */
+		static const uint32_t maxBatchesInFlight = 4;
+
+		void create(vks::VulkanDevice* device, VkQueue queue, uint32_t queueFamilyIndex, VkQueue transferQueue = VK_NULL_HANDLE, uint32_t transferQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED, VkDeviceSize size = defaultSize);
+		void destroy();
+		bool isCreated() const { return buffer != VK_NULL_HANDLE; }
+
+		Allocation allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+		VkCommandBuffer getCommandBuffer();
+		VkCommandBuffer getGraphicsCommandBuffer();
+		void copyToBuffer(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+		void copyToImage(const void* data, VkDeviceSize size, VkImage dstImage, const std::vector<VkBufferImageCopy>& regions, VkDeviceSize texelBlockSize = 4);
+		void releaseBuffer(VkBuffer dstBuffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE, VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VkAccessFlags dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT);
+		void releaseImage(VkImage image, VkImageSubresourceRange subresourceRange, VkImageLayout oldLayout, VkImageLayout newLayout, VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VkAccessFlags dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT);
+		void submit();
+		void submitGraphics(const VkSubmitInfo& submitInfo, VkFence fence);
+		void submitAcquires();
+		void flush();
+
+		VkDeviceSize getSize() const { return size; }
+		VkQueue getQueue() const { return dedicatedTransfer ? transferQueue : queue; }
+		/** @brief Queue the uploaded resources are used on, submissions to it should go through submitGraphics() */
+		VkQueue getGraphicsQueue() const { return queue; }
+		/** @brief True if copies are executed on a queue from a separate (transfer) family */
+		bool usesDedicatedTransferQueue() const { return dedicatedTransfer; }
+		/** @brief Timeline semaphore that is signaled with getSubmittedValue() once the copies of the last submission have finished */
+		VkSemaphore getTimelineSemaphore() const { return timelineSemaphore; }
+		uint64_t getSubmittedValue() const { return timelineValue; }
+
+	private:
+		struct Batch {
+			VkCommandBuffer commandBuffer{ VK_NULL_HANDLE };
+			// Acquire barriers and graphics work on the uploaded resources (dedicated transfer queue only)
+			VkCommandBuffer graphicsCommandBuffer{ VK_NULL_HANDLE };
+			VkFence fence{ VK_NULL_HANDLE };
+			// Ring head at the time the batch was submitted, everything up to this offset is released once the fence signals
+			VkDeviceSize end{ 0 };
+			// Timeline value signaled by the batch's copies
+			uint64_t timelineValue{ 0 };
+		};
+		// Graphics queue submission of the pending acquires, needs to stay alive until it has been passed to vkQueueSubmit
+		struct AcquireSubmission {
+			std::vector<VkCommandBuffer> commandBuffers;
+			uint64_t value{ 0 };
+			VkPipelineStageFlags waitStageMask{ VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+			VkTimelineSemaphoreSubmitInfo timelineInfo{};
+			VkSubmitInfo submitInfo{};
+		};
+
+		vks::VulkanDevice* device{ nullptr };
+		// Graphics queue, uploaded resources are owned by its family once a batch has been executed
+		VkQueue queue{ VK_NULL_HANDLE };
+		uint32_t queueFamilyIndex{ 0 };
+		VkQueue transferQueue{ VK_NULL_HANDLE };
+		uint32_t transferQueueFamilyIndex{ 0 };
+		bool dedicatedTransfer{ false };
+		VkCommandPool commandPool{ VK_NULL_HANDLE };
+		VkCommandPool graphicsCommandPool{ VK_NULL_HANDLE };
+		VkSemaphore timelineSemaphore{ VK_NULL_HANDLE };
+		uint64_t timelineValue{ 0 };
+		// Signaled on the graphics queue with the timeline value of the last batch whose acquires have been executed (dedicated transfer queue only)
+		VkSemaphore acquireSemaphore{ VK_NULL_HANDLE };
+		VkBuffer buffer{ VK_NULL_HANDLE };
+		VkDeviceMemory memory{ VK_NULL_HANDLE };
+		uint8_t* mapped{ nullptr };
+		VkDeviceSize size{ 0 };
+		VkDeviceSize head{ 0 };
+		VkDeviceSize tail{ 0 };
+
+		std::vector<Batch> batches;
+		// Indices into batches, in submission order
+		std::deque<uint32_t> inFlight;
+		std::vector<uint32_t> available;
+		// Batch currently being recorded (-1 if none)
+		int32_t recording{ -1 };
+		// Set if the batch being recorded references ring memory
+		bool pendingCopies{ false };
+		// Submitted batches whose acquire command buffers haven't been submitted to the graphics queue yet, in submission order
+		std::vector<uint32_t> pendingAcquires;
+
+		bool tryPlace(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+		void beginBatch();
+		bool retire(bool wait);
+		bool prepareAcquireSubmission(AcquireSubmission& submission);
+	};
+}
@@ -58,7 +58,7 @@ namespace vks
 	* @param filename File to load (supports .ktx)
 	* @param format Vulkan format of the image data stored in the file
 	* @param device Vulkan device to create the texture on
-	* @param copyQueue Queue used for the texture staging copy commands (must support transfer)
+	* @param copyQueue Queue used for the texture copy commands if no staging is involved (staged copies are submitted by the device's staging ring, host image copies don't use a queue)
 	* @param (Optional) imageUsageFlags Usage flags for the texture's image (defaults to VK_IMAGE_USAGE_SAMPLED_BIT)
 	* @param (Optional) imageLayout Usage layout for the texture (defaults VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
 	* @param (Optional) forceLinear Force linear tiling (not advised, defaults to false)
@@ -92,38 +92,10 @@ namespace vks
 		VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
 		VkMemoryRequirements memReqs;
 
-		// Use a separate command buffer for texture loading
-		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
 		if (useStaging)
 		{
-			// Create a host-visible staging buffer that contains the raw image data
-			VkBuffer stagingBuffer;
-			VkDeviceMemory stagingMemory;
-
-			VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo();
-			bufferCreateInfo.size = ktxTextureSize;
-			// This buffer is used as a transfer source for the buffer copy
-			bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-			bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-			VK_CHECK_RESULT(vkCreateBuffer(device->m_device, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-			// Get memory requirements for the staging buffer (alignment, memory type bits)
-			vkGetBufferMemoryRequirements(device->m_device, stagingBuffer, &memReqs);
-
-			memAllocInfo.allocationSize = memReqs.size;
-			// Get memory type index for a host visible buffer
-			memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-			VK_CHECK_RESULT(vkAllocateMemory(device->m_device, &memAllocInfo, nullptr, &stagingMemory));
-			VK_CHECK_RESULT(vkBindBufferMemory(device->m_device, stagingBuffer, stagingMemory, 0));
-
-			// Copy texture data into staging buffer
-			uint8_t *data;
-			VK_CHECK_RESULT(vkMapMemory(device->m_device, stagingMemory, 0, memReqs.size, 0, (void **)&data));
-			memcpy(data, ktxTextureData, ktxTextureSize);
-			vkUnmapMemory(device->m_device, stagingMemory);
+			// Upload directly from host memory if the device supports host image copies for this format, otherwise go through the staging ring
+			const bool hostCopy = device->hostImageCopySupported(format, imageUsageFlags, imageLayout);
 
 			// Setup buffer copy regions for each mip level
 			std::vector<VkBufferImageCopy> bufferCopyRegions;
@@ -159,8 +131,12 @@ namespace vks
 			imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 			imageCreateInfo.extent = { width, height, 1 };
 			imageCreateInfo.usage = imageUsageFlags;
-			// Ensure that the TRANSFER_DST bit is set for staging
-			if (!(imageCreateInfo.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
+			// Images filled on the host need the host transfer usage, staged images the TRANSFER_DST bit
+			if (hostCopy)
+			{
+				imageCreateInfo.usage |= VK_IMAGE_USAGE_HOST_TRANSFER_BIT;
+			}
+			else if (!(imageCreateInfo.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
 			{
 				imageCreateInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 			}
@@ -180,39 +156,34 @@ namespace vks
 			subresourceRange.levelCount = mipLevels;
 			subresourceRange.layerCount = 1;
 
-			// Image barrier for optimal image (target)
-			// Optimal image will be used as destination for the copy
-			vks::tools::setImageLayout(
-				copyCmd,
-				image,
-				VK_IMAGE_LAYOUT_UNDEFINED,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				subresourceRange);
-
-			// Copy mip levels from staging buffer
-			vkCmdCopyBufferToImage(
-				copyCmd,
-				stagingBuffer,
-				image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				static_cast<uint32_t>(bufferCopyRegions.size()),
-				bufferCopyRegions.data()
-			);
-
-			// Change texture image layout to shader read after all mip levels have been copied
 			this->imageLayout = imageLayout;
-			vks::tools::setImageLayout(
-				copyCmd,
-				image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				imageLayout,
-				subresourceRange);
 
-			device->flushCommandBuffer(copyCmd, copyQueue);
-
-			// Clean up staging resources
-			vkDestroyBuffer(device->m_device, stagingBuffer, nullptr);
-			vkFreeMemory(device->m_device, stagingMemory, nullptr);
+			const auto uploadStart = std::chrono::high_resolution_clock::now();
+			if (hostCopy)
+			{
+				// Copy mip levels straight from the ktx data into the image, no staging memory or queue submission involved
+				device->copyMemoryToImage(ktxTextureData, image, bufferCopyRegions, subresourceRange, imageLayout);
+			}
+			else
+			{
+				// Image barrier for optimal image (target)
+				// Optimal image will be used as destination for the copy
+				vks::tools::setImageLayout(
+					device->stagingRing.getCommandBuffer(),
+					image,
+					VK_IMAGE_LAYOUT_UNDEFINED,
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					subresourceRange);
+
+				// Copy mip levels through the device's staging ring
+				device->stagingRing.copyToImage(ktxTextureData, ktxTextureSize, image, bufferCopyRegions, ktxTexture_GetElementSize(ktxTexture));
+
+				// Change texture image layout to shader read after all mip levels have been copied and hand the image over to the graphics queue
+				device->stagingRing.releaseImage(image, subresourceRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, imageLayout);
+
+				device->stagingRing.submit();
+			}
+			device->addTextureUpload(hostCopy, ktxTextureSize, uploadStart);
 		}
 		else
 		{
@@ -284,6 +255,7 @@ namespace vks
 			this->imageLayout = imageLayout;
 
 			// Setup image memory barrier
+			VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
 			vks::tools::setImageLayout(copyCmd, image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, imageLayout);
 
 			device->flushCommandBuffer(copyCmd, copyQueue);
@@ -339,7 +311,7 @@ namespace vks
 	* @param height Height of the texture to create
 	* @param format Vulkan format of the image data stored in the file
 	* @param device Vulkan device to create the texture on
-	* @param copyQueue Queue used for the texture staging copy commands (must support transfer)
+	* @param copyQueue Queue used for the texture copy commands if no staging is involved (staged copies are submitted by the device's staging ring, host image copies don't use a queue)
 	* @param (Optional) filter Texture filtering for the sampler (defaults to VK_FILTER_LINEAR)
 	* @param (Optional) imageUsageFlags Usage flags for the texture's image (defaults to VK_IMAGE_USAGE_SAMPLED_BIT)
 	* @param (Optional) imageLayout Usage layout for the texture (defaults VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
@@ -353,40 +325,12 @@ namespace vks
 		height = texHeight;
 		mipLevels = 1;
 
+		// Upload directly from host memory if the device supports host image copies for this format, otherwise go through the staging ring
+		const bool hostCopy = device->hostImageCopySupported(format, imageUsageFlags, imageLayout);
+
 		VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
 		VkMemoryRequirements memReqs;
 
-		// Use a separate command buffer for texture loading
-		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-		// Create a host-visible staging buffer that contains the raw image data
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-
-		VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo();
-		bufferCreateInfo.size = bufferSize;
-		// This buffer is used as a transfer source for the buffer copy
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-		VK_CHECK_RESULT(vkCreateBuffer(device->m_device, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-		// Get memory requirements for the staging buffer (alignment, memory type bits)
-		vkGetBufferMemoryRequirements(device->m_device, stagingBuffer, &memReqs);
-
-		memAllocInfo.allocationSize = memReqs.size;
-		// Get memory type index for a host visible buffer
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-		VK_CHECK_RESULT(vkAllocateMemory(device->m_device, &memAllocInfo, nullptr, &stagingMemory));
-		VK_CHECK_RESULT(vkBindBufferMemory(device->m_device, stagingBuffer, stagingMemory, 0));
-
-		// Copy texture data into staging buffer
-		uint8_t *data;
-		VK_CHECK_RESULT(vkMapMemory(device->m_device, stagingMemory, 0, memReqs.size, 0, (void **)&data));
-		memcpy(data, buffer, bufferSize);
-		vkUnmapMemory(device->m_device, stagingMemory);
-
 		VkBufferImageCopy bufferCopyRegion = {};
 		bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		bufferCopyRegion.imageSubresource.mipLevel = 0;
@@ -409,8 +353,12 @@ namespace vks
 		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 		imageCreateInfo.extent = { width, height, 1 };
 		imageCreateInfo.usage = imageUsageFlags;
-		// Ensure that the TRANSFER_DST bit is set for staging
-		if (!(imageCreateInfo.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
+		// Images filled on the host need the host transfer usage, staged images the TRANSFER_DST bit
+		if (hostCopy)
+		{
+			imageCreateInfo.usage |= VK_IMAGE_USAGE_HOST_TRANSFER_BIT;
+		}
+		else if (!(imageCreateInfo.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
 		{
 			imageCreateInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 		}
@@ -430,39 +378,34 @@ namespace vks
 		subresourceRange.levelCount = mipLevels;
 		subresourceRange.layerCount = 1;
 
-		// Image barrier for optimal image (target)
-		// Optimal image will be used as destination for the copy
-		vks::tools::setImageLayout(
-			copyCmd,
-			image,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			subresourceRange);
-
-		// Copy mip levels from staging buffer
-		vkCmdCopyBufferToImage(
-			copyCmd,
-			stagingBuffer,
-			image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1,
-			&bufferCopyRegion
-		);
-
-		// Change texture image layout to shader read after all mip levels have been copied
 		this->imageLayout = imageLayout;
-		vks::tools::setImageLayout(
-			copyCmd,
-			image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			imageLayout,
-			subresourceRange);
 
-		device->flushCommandBuffer(copyCmd, copyQueue);
+		const auto uploadStart = std::chrono::high_resolution_clock::now();
+		if (hostCopy)
+		{
+			// Copy the image data straight from the passed buffer
+			device->copyMemoryToImage(buffer, image, { bufferCopyRegion }, subresourceRange, imageLayout);
+		}
+		else
+		{
+			// Image barrier for optimal image (target)
+			// Optimal image will be used as destination for the copy
+			vks::tools::setImageLayout(
+				device->stagingRing.getCommandBuffer(),
+				image,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				subresourceRange);
+
+			// Copy the image data through the device's staging ring
+			device->stagingRing.copyToImage(buffer, bufferSize, image, { bufferCopyRegion }, bufferSize / (static_cast<VkDeviceSize>(width) * height));
 
-		// Clean up staging resources
-		vkDestroyBuffer(device->m_device, stagingBuffer, nullptr);
-		vkFreeMemory(device->m_device, stagingMemory, nullptr);
+			// Change texture image layout to shader read after all mip levels have been copied and hand the image over to the graphics queue
+			device->stagingRing.releaseImage(image, subresourceRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, imageLayout);
+
+			device->stagingRing.submit();
+		}
+		device->addTextureUpload(hostCopy, bufferSize, uploadStart);
 
 		// Create sampler
 		VkSamplerCreateInfo samplerCreateInfo = {};
@@ -501,7 +444,7 @@ namespace vks
 	* @param filename File to load (supports .ktx)
 	* @param format Vulkan format of the image data stored in the file
 	* @param device Vulkan device to create the texture on
-	* @param copyQueue Queue used for the texture staging copy commands (must support transfer)
+	* @param copyQueue Queue used for the texture copy commands if no staging is involved (staged copies are submitted by the device's staging ring, host image copies don't use a queue)
 	* @param (Optional) imageUsageFlags Usage flags for the texture's image (defaults to VK_IMAGE_USAGE_SAMPLED_BIT)
 	* @param (Optional) imageLayout Usage layout for the texture (defaults VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
 	*
@@ -521,37 +464,12 @@ namespace vks
 		ktx_uint8_t *ktxTextureData = ktxTexture_GetData(ktxTexture);
 		ktx_size_t ktxTextureSize = ktxTexture_GetSize(ktxTexture);
 
+		// Upload directly from host memory if the device supports host image copies for this format, otherwise go through the staging ring
+		const bool hostCopy = device->hostImageCopySupported(format, imageUsageFlags, imageLayout);
+
 		VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
 		VkMemoryRequirements memReqs;
 
-		// Create a host-visible staging buffer that contains the raw image data
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-
-		VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo();
-		bufferCreateInfo.size = ktxTextureSize;
-		// This buffer is used as a transfer source for the buffer copy
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-		VK_CHECK_RESULT(vkCreateBuffer(device->m_device, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-		// Get memory requirements for the staging buffer (alignment, memory type bits)
-		vkGetBufferMemoryRequirements(device->m_device, stagingBuffer, &memReqs);
-
-		memAllocInfo.allocationSize = memReqs.size;
-		// Get memory type index for a host visible buffer
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-		VK_CHECK_RESULT(vkAllocateMemory(device->m_device, &memAllocInfo, nullptr, &stagingMemory));
-		VK_CHECK_RESULT(vkBindBufferMemory(device->m_device, stagingBuffer, stagingMemory, 0));
-
-		// Copy texture data into staging buffer
-		uint8_t *data;
-		VK_CHECK_RESULT(vkMapMemory(device->m_device, stagingMemory, 0, memReqs.size, 0, (void **)&data));
-		memcpy(data, ktxTextureData, ktxTextureSize);
-		vkUnmapMemory(device->m_device, stagingMemory);
-
 		// Setup buffer copy regions for each layer including all of its miplevels
 		std::vector<VkBufferImageCopy> bufferCopyRegions;
 
@@ -587,8 +505,12 @@ namespace vks
 		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 		imageCreateInfo.extent = { width, height, 1 };
 		imageCreateInfo.usage = imageUsageFlags;
-		// Ensure that the TRANSFER_DST bit is set for staging
-		if (!(imageCreateInfo.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
+		// Images filled on the host need the host transfer usage, staged images the TRANSFER_DST bit
+		if (hostCopy)
+		{
+			imageCreateInfo.usage |= VK_IMAGE_USAGE_HOST_TRANSFER_BIT;
+		}
+		else if (!(imageCreateInfo.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
 		{
 			imageCreateInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 		}
@@ -605,43 +527,43 @@ namespace vks
 		VK_CHECK_RESULT(vkAllocateMemory(device->m_device, &memAllocInfo, nullptr, &deviceMemory));
 		VK_CHECK_RESULT(vkBindImageMemory(device->m_device, image, deviceMemory, 0));
 
-		// Use a separate command buffer for texture loading
-		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-		// Image barrier for optimal image (target)
-		// Set initial layout for all array layers (faces) of the optimal (target) tiled texture
 		VkImageSubresourceRange subresourceRange = {};
 		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		subresourceRange.baseMipLevel = 0;
 		subresourceRange.levelCount = mipLevels;
 		subresourceRange.layerCount = layerCount;
 
-		vks::tools::setImageLayout(
-			copyCmd,
-			image,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			subresourceRange);
-
-		// Copy the layers and mip levels from the staging buffer to the optimal tiled image
-		vkCmdCopyBufferToImage(
-			copyCmd,
-			stagingBuffer,
-			image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			static_cast<uint32_t>(bufferCopyRegions.size()),
-			bufferCopyRegions.data());
-
-		// Change texture image layout to shader read after all faces have been copied
 		this->imageLayout = imageLayout;
-		vks::tools::setImageLayout(
-			copyCmd,
-			image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			imageLayout,
-			subresourceRange);
 
-		device->flushCommandBuffer(copyCmd, copyQueue);
+		const auto uploadStart = std::chrono::high_resolution_clock::now();
+		if (hostCopy)
+		{
+			// Copy the layers and mip levels straight from the ktx data, each region is copied by a separate worker
+			device->copyMemoryToImage(ktxTextureData, image, bufferCopyRegions, subresourceRange, imageLayout);
+		}
+		else
+		{
+			// Copies are recorded into the staging ring's current batch
+			VkCommandBuffer copyCmd = device->stagingRing.getCommandBuffer();
+
+			// Image barrier for optimal image (target)
+			// Set initial layout for all array layers (faces) of the optimal (target) tiled texture
+			vks::tools::setImageLayout(
+				copyCmd,
+				image,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				subresourceRange);
+
+			// Copy the layers and mip levels through the staging ring to the optimal tiled image
+			device->stagingRing.copyToImage(ktxTextureData, ktxTextureSize, image, bufferCopyRegions, ktxTexture_GetElementSize(ktxTexture));
+
+			// Change texture image layout to shader read after all faces have been copied and hand the image over to the graphics queue
+			device->stagingRing.releaseImage(image, subresourceRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, imageLayout);
+
+			device->stagingRing.submit();
+		}
+		device->addTextureUpload(hostCopy, ktxTextureSize, uploadStart);
 
 		// Create sampler
 		VkSamplerCreateInfo samplerCreateInfo = vks::initializers::samplerCreateInfo();
@@ -670,10 +592,7 @@ namespace vks
 		viewCreateInfo.image = image;
 		VK_CHECK_RESULT(vkCreateImageView(device->m_device, &viewCreateInfo, nullptr, &view));
 
-		// Clean up staging resources
 		ktxTexture_Destroy(ktxTexture);
-		vkDestroyBuffer(device->m_device, stagingBuffer, nullptr);
-		vkFreeMemory(device->m_device, stagingMemory, nullptr);
 
 		// Update descriptor image info member that can be used for setting up descriptor sets
 		updateDescriptor();
@@ -685,7 +604,7 @@ namespace vks
 	* @param filename File to load (supports .ktx)
 	* @param format Vulkan format of the image data stored in the file
 	* @param device Vulkan device to create the texture on
-	* @param copyQueue Queue used for the texture staging copy commands (must support transfer)
+	* @param copyQueue Queue used for the texture copy commands if no staging is involved (staged copies are submitted by the device's staging ring, host image copies don't use a queue)
 	* @param (Optional) imageUsageFlags Usage flags for the texture's image (defaults to VK_IMAGE_USAGE_SAMPLED_BIT)
 	* @param (Optional) imageLayout Usage layout for the texture (defaults VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
 	*
@@ -704,37 +623,12 @@ namespace vks
 		ktx_uint8_t *ktxTextureData = ktxTexture_GetData(ktxTexture);
 		ktx_size_t ktxTextureSize = ktxTexture_GetSize(ktxTexture);
 
+		// Upload directly from host memory if the device supports host image copies for this format, otherwise go through the staging ring
+		const bool hostCopy = device->hostImageCopySupported(format, imageUsageFlags, imageLayout, VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT);
+
 		VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
 		VkMemoryRequirements memReqs;
 
-		// Create a host-visible staging buffer that contains the raw image data
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-
-		VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo();
-		bufferCreateInfo.size = ktxTextureSize;
-		// This buffer is used as a transfer source for the buffer copy
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-		VK_CHECK_RESULT(vkCreateBuffer(device->m_device, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-		// Get memory requirements for the staging buffer (alignment, memory type bits)
-		vkGetBufferMemoryRequirements(device->m_device, stagingBuffer, &memReqs);
-
-		memAllocInfo.allocationSize = memReqs.size;
-		// Get memory type index for a host visible buffer
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-		VK_CHECK_RESULT(vkAllocateMemory(device->m_device, &memAllocInfo, nullptr, &stagingMemory));
-		VK_CHECK_RESULT(vkBindBufferMemory(device->m_device, stagingBuffer, stagingMemory, 0));
-
-		// Copy texture data into staging buffer
-		uint8_t *data;
-		VK_CHECK_RESULT(vkMapMemory(device->m_device, stagingMemory, 0, memReqs.size, 0, (void **)&data));
-		memcpy(data, ktxTextureData, ktxTextureSize);
-		vkUnmapMemory(device->m_device, stagingMemory);
-
 		// Setup buffer copy regions for each face including all of its mip levels
 		std::vector<VkBufferImageCopy> bufferCopyRegions;
 
@@ -771,8 +665,12 @@ namespace vks
 		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 		imageCreateInfo.extent = { width, height, 1 };
 		imageCreateInfo.usage = imageUsageFlags;
-		// Ensure that the TRANSFER_DST bit is set for staging
-		if (!(imageCreateInfo.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
+		// Images filled on the host need the host transfer usage, staged images the TRANSFER_DST bit
+		if (hostCopy)
+		{
+			imageCreateInfo.usage |= VK_IMAGE_USAGE_HOST_TRANSFER_BIT;
+		}
+		else if (!(imageCreateInfo.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
 		{
 			imageCreateInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 		}
@@ -792,43 +690,43 @@ namespace vks
 		VK_CHECK_RESULT(vkAllocateMemory(device->m_device, &memAllocInfo, nullptr, &deviceMemory));
 		VK_CHECK_RESULT(vkBindImageMemory(device->m_device, image, deviceMemory, 0));
 
-		// Use a separate command buffer for texture loading
-		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-		// Image barrier for optimal image (target)
-		// Set initial layout for all array layers (faces) of the optimal (target) tiled texture
 		VkImageSubresourceRange subresourceRange = {};
 		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		subresourceRange.baseMipLevel = 0;
 		subresourceRange.levelCount = mipLevels;
 		subresourceRange.layerCount = 6;
 
-		vks::tools::setImageLayout(
-			copyCmd,
-			image,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			subresourceRange);
-
-		// Copy the cube map faces from the staging buffer to the optimal tiled image
-		vkCmdCopyBufferToImage(
-			copyCmd,
-			stagingBuffer,
-			image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			static_cast<uint32_t>(bufferCopyRegions.size()),
-			bufferCopyRegions.data());
-
-		// Change texture image layout to shader read after all faces have been copied
 		this->imageLayout = imageLayout;
-		vks::tools::setImageLayout(
-			copyCmd,
-			image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			imageLayout,
-			subresourceRange);
 
-		device->flushCommandBuffer(copyCmd, copyQueue);
+		const auto uploadStart = std::chrono::high_resolution_clock::now();
+		if (hostCopy)
+		{
+			// Copy the cube map faces straight from the ktx data, each region is copied by a separate worker
+			device->copyMemoryToImage(ktxTextureData, image, bufferCopyRegions, subresourceRange, imageLayout);
+		}
+		else
+		{
+			// Copies are recorded into the staging ring's current batch
+			VkCommandBuffer copyCmd = device->stagingRing.getCommandBuffer();
+
+			// Image barrier for optimal image (target)
+			// Set initial layout for all array layers (faces) of the optimal (target) tiled texture
+			vks::tools::setImageLayout(
+				copyCmd,
+				image,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				subresourceRange);
+
+			// Copy the cube map faces through the staging ring to the optimal tiled image
+			device->stagingRing.copyToImage(ktxTextureData, ktxTextureSize, image, bufferCopyRegions, ktxTexture_GetElementSize(ktxTexture));
+
+			// Change texture image layout to shader read after all faces have been copied and hand the image over to the graphics queue
+			device->stagingRing.releaseImage(image, subresourceRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, imageLayout);
+
+			device->stagingRing.submit();
+		}
+		device->addTextureUpload(hostCopy, ktxTextureSize, uploadStart);
 
 		// Create sampler
 		VkSamplerCreateInfo samplerCreateInfo = vks::initializers::samplerCreateInfo();
@@ -857,10 +755,7 @@ namespace vks
 		viewCreateInfo.image = image;
 		VK_CHECK_RESULT(vkCreateImageView(device->m_device, &viewCreateInfo, nullptr, &view));
 
-		// Clean up staging resources
 		ktxTexture_Destroy(ktxTexture);
-		vkDestroyBuffer(device->m_device, stagingBuffer, nullptr);
-		vkFreeMemory(device->m_device, stagingMemory, nullptr);
 
 		// Update descriptor image info member that can be used for setting up descriptor sets
 		updateDescriptor();
@@ -120,21 +120,8 @@ namespace vks
 		viewInfo.subresourceRange.layerCount = 1;
 		VK_CHECK_RESULT(vkCreateImageView(device->m_device, &viewInfo, nullptr, &fontView));
 
-		// Staging buffers for font data upload
-		vks::Buffer stagingBuffer;
-
-		VK_CHECK_RESULT(device->createBuffer(
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&stagingBuffer,
-			uploadSize));
-
-		stagingBuffer.map();
-		memcpy(stagingBuffer.mapped, fontData, uploadSize);
-		stagingBuffer.unmap();
-
-		// Copy buffer data to font image
-		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		// Copy font data to the font image through the device's staging ring
+		VkCommandBuffer copyCmd = device->stagingRing.getCommandBuffer();
 
 		// Prepare for transfer
 		vks::tools::setImageLayout(
@@ -154,28 +141,18 @@ namespace vks
 		bufferCopyRegion.imageExtent.height = texHeight;
 		bufferCopyRegion.imageExtent.depth = 1;
 
-		vkCmdCopyBufferToImage(
-			copyCmd,
-			stagingBuffer.buffer,
-			fontImage,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1,
-			&bufferCopyRegion
-		);
+		device->stagingRing.copyToImage(fontData, uploadSize, fontImage, { bufferCopyRegion });
 
-		// Prepare for shader read
-		vks::tools::setImageLayout(
-			copyCmd,
+		// Prepare for shader read on the graphics queue
+		device->stagingRing.releaseImage(
 			fontImage,
-			VK_IMAGE_ASPECT_COLOR_BIT,
+			{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 },
 			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
-
-		device->flushCommandBuffer(copyCmd, queue, true);
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			VK_ACCESS_SHADER_READ_BIT);
 
-		stagingBuffer.destroy();
+		device->stagingRing.submit();
 
 		// Font texture Sampler
 		VkSamplerCreateInfo samplerInfo = vks::initializers::samplerCreateInfo();
@@ -0,0 +1,98 @@
+/*
+* Vulkan uniform ring buffer
+*
+* Per frame linear allocator for uniform data, all allocations are bound through dynamic offsets into a single persistently mapped buffer
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "VulkanUniformRing.h"
+#include "VulkanDevice.h"
+
+namespace vks
+{
+	/**
+	* Create the ring buffer and map it for its whole lifetime
+	*
+	* @param device Pointer to the device the ring allocates its memory from
+	* @param frameCount Number of frames that may be in flight at the same time, usually the number of command buffers recorded per frame
+	* @param (Optional) frameSize Size of a frame's region in bytes (Defaults to 4 MiB)
+	*
+	* @note Dynamic offsets are 32 bit values, so the whole ring needs to be smaller than 4 GiB
+	*/
+	void UniformRing::create(vks::VulkanDevice* device, uint32_t frameCount, VkDeviceSize frameSize)
+	{
+		assert(!isCreated());
+		assert(frameCount > 0);
+		this->device = device;
+		this->frameCount = frameCount;
+		alignment = std::max<VkDeviceSize>(device->m_vkPhysicalDeviceProperties.limits.minUniformBufferOffsetAlignment, 1);
+		// Every region starts at an aligned offset
+		this->frameSize = vks::tools::alignedVkSize(frameSize, alignment);
+		const VkDeviceSize bufferSize = this->frameSize * frameCount;
+		assert(bufferSize <= UINT32_MAX);
+
+		VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, bufferSize, &buffer, &memory));
+		void* data;
+		VK_CHECK_RESULT(vkMapMemory(*device, memory, 0, VK_WHOLE_SIZE, 0, &data));
+		mapped = static_cast<uint8_t*>(data);
+		frameStart = head = 0;
+	}
+
+	/**
+	* Release all Vulkan resources of the ring, the GPU must no longer use any of its allocations
+	*/
+	void UniformRing::destroy()
+	{
+		if (!isCreated()) {
+			return;
+		}
+		vkUnmapMemory(*device, memory);
+		vkDestroyBuffer(*device, buffer, nullptr);
+		vkFreeMemory(*device, memory, nullptr);
+		buffer = VK_NULL_HANDLE;
+		memory = VK_NULL_HANDLE;
+		mapped = nullptr;
+	}
+
+	/**
+	* Start allocating from the region of a frame, all previous allocations from that region become invalid
+	*
+	* @param frameIndex Index of the frame's region, the commands of the last frame that used this region must have finished executing
+	*/
+	void UniformRing::beginFrame(uint32_t frameIndex)
+	{
+		assert(isCreated());
+		assert(frameIndex < frameCount);
+		frameStart = head = frameIndex * frameSize;
+	}
+
+	/**
+	* Allocate uniform data from the current frame's region
+	*
+	* @param allocSize Size of the allocation in bytes
+	*
+	* @return The allocation, bind it by passing its offset as the dynamic offset of a descriptor created with getDescriptor()
+	*
+	* @throw Throws an exception if the current frame's region is exhausted
+	*/
+	UniformRing::Allocation UniformRing::allocate(VkDeviceSize allocSize)
+	{
+		assert(isCreated());
+		const VkDeviceSize offset = vks::tools::alignedVkSize(head, alignment);
+		if (offset + allocSize > frameStart + frameSize) {
+			throw std::runtime_error("Uniform allocation exceeds the frame's region of the uniform ring");
+		}
+		head = offset + allocSize;
+		Allocation allocation{};
+		allocation.mapped = mapped + offset;
+		allocation.offset = static_cast<uint32_t>(offset);
+		allocation.size = allocSize;
+		return allocation;
+	}
+}
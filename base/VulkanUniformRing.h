@@ -0,0 +1,105 @@
+/*
+* Vulkan uniform ring buffer
+*
+* Per frame linear allocator for uniform data, all allocations are bound through dynamic offsets into a single persistently mapped buffer
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <cassert>
+
+#include "vulkan/vulkan.h"
+#include "VulkanTools.h"
+
+namespace vks
+{
+	struct VulkanDevice;
+
+	/**
+	* @brief Linear allocator for per frame uniform data on top of a single persistently mapped, host coherent buffer
+	* @note The buffer is split into one region per frame in flight. beginFrame() starts over at the beginning of a frame's region,
+	* every allocation only moves the region's head, aligned to minUniformBufferOffsetAlignment. The buffer is bound once as
+	* VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC (see getDescriptor()) and the offsets of the allocations are passed as dynamic offsets.
+	* A frame's region must not be restarted before the GPU has finished the commands of that frame.
+	*/
+	class UniformRing
+	{
+	public:
+		/** @brief A sub allocation from the current frame's region, offset is the dynamic offset to bind it with */
+		struct Allocation {
+			void* mapped{ nullptr };
+			uint32_t offset{ 0 };
+			VkDeviceSize size{ 0 };
+		};
+
+		/** @brief Typed allocation returned by allocate<T>() */
+		template <typename T>
+		struct TypedAllocation {
+			T* data{ nullptr };
+			uint32_t offset{ 0 };
+		};
+
+		/** @brief Default size of a frame's region (can be overriden at creation time) */
+		static const VkDeviceSize defaultFrameSize = 4 * 1024 * 1024;
+
+		void create(vks::VulkanDevice* device, uint32_t frameCount, VkDeviceSize frameSize = defaultFrameSize);
+		void destroy();
+		bool isCreated() const { return buffer != VK_NULL_HANDLE; }
+
+		void beginFrame(uint32_t frameIndex);
+		Allocation allocate(VkDeviceSize size);
+
+		/**
+		* Allocate uniform data for one instance of T from the current frame
+		*
+		* @return Pointer to the mapped data and the dynamic offset to bind it with
+		*/
+		template <typename T>
+		TypedAllocation<T> allocate()
+		{
+			Allocation allocation = allocate(sizeof(T));
+			return { static_cast<T*>(allocation.mapped), allocation.offset };
+		}
+
+		/**
+		* Allocate uniform data for one instance of T from the current frame and copy value to it
+		*
+		* @return The dynamic offset to bind the data with
+		*/
+		template <typename T>
+		uint32_t push(const T& value)
+		{
+			TypedAllocation<T> allocation = allocate<T>();
+			*allocation.data = value;
+			return allocation.offset;
+		}
+
+		/**
+		* Descriptor for binding the ring as a dynamic uniform buffer
+		*
+		* @param range Size of the uniform block read by the shader, must not be larger than the allocations bound with it
+		*/
+		VkDescriptorBufferInfo getDescriptor(VkDeviceSize range) const { return { buffer, 0, range }; }
+		VkBuffer getBuffer() const { return buffer; }
+		VkDeviceSize getFrameSize() const { return frameSize; }
+		uint32_t getFrameCount() const { return frameCount; }
+		/** @brief Bytes allocated from the current frame's region so far (including alignment padding) */
+		VkDeviceSize getFrameUsage() const { return head - frameStart; }
+
+	private:
+		vks::VulkanDevice* device{ nullptr };
+		VkBuffer buffer{ VK_NULL_HANDLE };
+		VkDeviceMemory memory{ VK_NULL_HANDLE };
+		uint8_t* mapped{ nullptr };
+		uint32_t frameCount{ 0 };
+		VkDeviceSize frameSize{ 0 };
+		VkDeviceSize alignment{ 0 };
+		// Region of the current frame is [frameStart, frameStart + frameSize), head is the next free byte
+		VkDeviceSize frameStart{ 0 };
+		VkDeviceSize head{ 0 };
+	};
+}
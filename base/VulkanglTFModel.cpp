@@ -18,12 +18,202 @@
 #define TINYGLTF_NO_STB_IMAGE_WRITE
 
 #include "VulkanglTFModel.h"
+#include "threadpool.hpp"
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <unordered_map>
+#include <glm/gtc/packing.hpp>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 VkDescriptorSetLayout vkglTF::descriptorSetLayoutImage = VK_NULL_HANDLE;
 VkDescriptorSetLayout vkglTF::descriptorSetLayoutUbo = VK_NULL_HANDLE;
 VkMemoryPropertyFlags vkglTF::memoryPropertyFlags = 0;
 uint32_t vkglTF::descriptorBindingFlags = vkglTF::DescriptorBindingFlags::ImageBaseColor;
 
+namespace
+{
+	/*
+		Read only memory mapping of a whole file, the pages are only read from disk when they are accessed
+	*/
+	class MappedFile
+	{
+	public:
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+
+		bool open(const std::string& filename)
+		{
+#if defined(_WIN32)
+			file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (file == INVALID_HANDLE_VALUE) {
+				return false;
+			}
+			LARGE_INTEGER fileSize{};
+			if (!GetFileSizeEx(file, &fileSize) || (fileSize.QuadPart == 0)) {
+				return false;
+			}
+			mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping == nullptr) {
+				return false;
+			}
+			data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			size = static_cast<size_t>(fileSize.QuadPart);
+#else
+			const int fd = ::open(filename.c_str(), O_RDONLY);
+			if (fd < 0) {
+				return false;
+			}
+			struct stat fileStat{};
+			if ((fstat(fd, &fileStat) != 0) || (fileStat.st_size == 0)) {
+				::close(fd);
+				return false;
+			}
+			void* mapped = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+			// The mapping stays valid after the descriptor has been closed
+			::close(fd);
+			if (mapped == MAP_FAILED) {
+				return false;
+			}
+			// The whole file is copied into staging memory, so let the kernel read ahead
+			madvise(mapped, static_cast<size_t>(fileStat.st_size), MADV_WILLNEED);
+			data = static_cast<const uint8_t*>(mapped);
+			size = static_cast<size_t>(fileStat.st_size);
+#endif
+			return data != nullptr;
+		}
+
+		~MappedFile()
+		{
+#if defined(_WIN32)
+			if (data) {
+				UnmapViewOfFile(data);
+			}
+			if (mapping) {
+				CloseHandle(mapping);
+			}
+			if (file != INVALID_HANDLE_VALUE) {
+				CloseHandle(file);
+			}
+#else
+			if (data) {
+				munmap(const_cast<uint8_t*>(data), size);
+			}
+#endif
+		}
+
+	private:
+#if defined(_WIN32)
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = nullptr;
+#endif
+	};
+
+	/*
+		Convert a single accessor component to float, normalized integers are mapped to [0..1] or [-1..1]
+	*/
+	float componentToFloat(const uint8_t* src, int componentType, bool normalized)
+	{
+		switch (componentType) {
+		case TINYGLTF_COMPONENT_TYPE_FLOAT: {
+			float value;
+			memcpy(&value, src, sizeof(value));
+			return value;
+		}
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+			return normalized ? *src / 255.0f : static_cast<float>(*src);
+		case TINYGLTF_COMPONENT_TYPE_BYTE: {
+			const int8_t value = static_cast<int8_t>(*src);
+			return normalized ? std::max(value / 127.0f, -1.0f) : static_cast<float>(value);
+		}
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+			uint16_t value;
+			memcpy(&value, src, sizeof(value));
+			return normalized ? value / 65535.0f : static_cast<float>(value);
+		}
+		case TINYGLTF_COMPONENT_TYPE_SHORT: {
+			int16_t value;
+			memcpy(&value, src, sizeof(value));
+			return normalized ? std::max(value / 32767.0f, -1.0f) : static_cast<float>(value);
+		}
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+			uint32_t value;
+			memcpy(&value, src, sizeof(value));
+			return static_cast<float>(value);
+		}
+		}
+		return 0.0f;
+	}
+
+	/*
+		Copy tightly packed float vectors with N components to a strided destination, the fixed size copies compile to plain vector loads and stores
+	*/
+	template<uint32_t N>
+	void copyPackedFloats(const uint8_t* src, size_t count, uint8_t* dst, size_t dstStride)
+	{
+		for (size_t i = 0; i < count; i++) {
+			memcpy(dst + i * dstStride, src + i * N * sizeof(float), N * sizeof(float));
+		}
+	}
+
+	/*
+		Widen tightly packed indices and add the offset of the primitive's first vertex
+	*/
+	template<typename T>
+	void copyIndices(const uint8_t* src, size_t count, uint32_t offset, uint32_t* dst)
+	{
+		for (size_t i = 0; i < count; i++) {
+			T index;
+			memcpy(&index, src + i * sizeof(T), sizeof(T));
+			dst[i] = static_cast<uint32_t>(index) + offset;
+		}
+	}
+
+	bool isBinaryglTF(const std::string& filename)
+	{
+		const size_t pos = filename.find_last_of('.');
+		if (pos == std::string::npos) {
+			return false;
+		}
+		std::string extension = filename.substr(pos + 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		return extension == "glb";
+	}
+
+	/*
+		Locate the binary chunk of a glb file, which follows the JSON chunk, returns nullptr if the file has none
+	*/
+	const uint8_t* glbBinaryChunk(const uint8_t* data, size_t size, size_t& chunkSize)
+	{
+		const uint32_t chunkTypeBin = 0x004E4942;
+		uint32_t jsonLength = 0;
+		if (size < 20) {
+			return nullptr;
+		}
+		memcpy(&jsonLength, data + 12, sizeof(jsonLength));
+		const size_t binHeader = 20 + static_cast<size_t>(jsonLength);
+		if (binHeader + 8 > size) {
+			return nullptr;
+		}
+		uint32_t binLength = 0;
+		uint32_t binType = 0;
+		memcpy(&binLength, data + binHeader, sizeof(binLength));
+		memcpy(&binType, data + binHeader + 4, sizeof(binType));
+		if ((binType != chunkTypeBin) || (binHeader + 8 + binLength > size)) {
+			return nullptr;
+		}
+		chunkSize = binLength;
+		return data + binHeader + 8;
+	}
+}
+
 /*
 	We use a custom image loading function with tinyglTF, so we can do custom stuff loading ktx textures
 */
@@ -125,26 +315,6 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 		memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
 		VkMemoryRequirements memReqs{};
 
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-
-		VkBufferCreateInfo bufferCreateInfo{};
-		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferCreateInfo.size = bufferSize;
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		VK_CHECK_RESULT(vkCreateBuffer(device->m_device, &bufferCreateInfo, nullptr, &stagingBuffer));
-		vkGetBufferMemoryRequirements(device->m_device, stagingBuffer, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device->m_device, &memAllocInfo, nullptr, &stagingMemory));
-		VK_CHECK_RESULT(vkBindBufferMemory(device->m_device, stagingBuffer, stagingMemory, 0));
-
-		uint8_t* data;
-		VK_CHECK_RESULT(vkMapMemory(device->m_device, stagingMemory, 0, memReqs.size, 0, (void**)&data));
-		memcpy(data, buffer, bufferSize);
-		vkUnmapMemory(device->m_device, stagingMemory);
-
 		VkImageCreateInfo imageCreateInfo{};
 		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -165,7 +335,8 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 		VK_CHECK_RESULT(vkAllocateMemory(device->m_device, &memAllocInfo, nullptr, &deviceMemory));
 		VK_CHECK_RESULT(vkBindImageMemory(device->m_device, image, deviceMemory, 0));
 
-		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		// Upload and mip generation are recorded into the same staging ring batch
+		VkCommandBuffer copyCmd = device->stagingRing.getCommandBuffer();
 
 		VkImageSubresourceRange subresourceRange = {};
 		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -192,24 +363,12 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 		bufferCopyRegion.imageExtent.height = height;
 		bufferCopyRegion.imageExtent.depth = 1;
 
-		vkCmdCopyBufferToImage(copyCmd, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
-
-		imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-		imageMemoryBarrier.image = image;
-		imageMemoryBarrier.subresourceRange = subresourceRange;
-  		vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
-
-		device->flushCommandBuffer(copyCmd, copyQueue, true);
-
-		vkDestroyBuffer(device->m_device, stagingBuffer, nullptr);
-		vkFreeMemory(device->m_device, stagingMemory, nullptr);
+		device->stagingRing.copyToImage(buffer, bufferSize, image, { bufferCopyRegion });
+		device->stagingRing.releaseImage(image, subresourceRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
 
 		// Generate the mip chain (glTF uses jpg and png, so we need to create this manually)
-		VkCommandBuffer blitCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		// Blits require a graphics queue, so they're recorded after the first mip level has been acquired by it
+		VkCommandBuffer blitCmd = device->stagingRing.getGraphicsCommandBuffer();
 		for (uint32_t i = 1; i < mipLevels; i++) {
 			VkImageBlit imageBlit{};
 
@@ -276,7 +435,7 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
             delete[] buffer;
         }
 
-		device->flushCommandBuffer(blitCmd, copyQueue, true);
+		device->stagingRing.submit();
 	}
 	else {
 		// Texture is stored in an external ktx file
@@ -305,45 +464,8 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 #endif		
 		assert(result == KTX_SUCCESS);
 
-		this->device = device;
-		width = ktxTexture->baseWidth;
-		height = ktxTexture->baseHeight;
-		mipLevels = ktxTexture->numLevels;
-
-		ktx_uint8_t* ktxTextureData = ktxTexture_GetData(ktxTexture);
-		ktx_size_t ktxTextureSize = ktxTexture_GetSize(ktxTexture);
-		format = ktxTexture_GetVkFormat(ktxTexture);
-
-		// Get device m_vkPhysicalDeviceProperties for the requested texture format
-		VkFormatProperties formatProperties;
-		vkGetPhysicalDeviceFormatProperties(device->m_physicalDevice, format, &formatProperties);
-
-		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-
-		VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo();
-		bufferCreateInfo.size = ktxTextureSize;
-		// This buffer is used as a transfer source for the buffer copy
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		VK_CHECK_RESULT(vkCreateBuffer(device->m_device, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-		VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
-		VkMemoryRequirements memReqs;
-		vkGetBufferMemoryRequirements(device->m_device, stagingBuffer, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device->m_device, &memAllocInfo, nullptr, &stagingMemory));
-		VK_CHECK_RESULT(vkBindBufferMemory(device->m_device, stagingBuffer, stagingMemory, 0));
-
-		uint8_t* data;
-		VK_CHECK_RESULT(vkMapMemory(device->m_device, stagingMemory, 0, memReqs.size, 0, (void**)&data));
-		memcpy(data, ktxTextureData, ktxTextureSize);
-		vkUnmapMemory(device->m_device, stagingMemory);
-
 		std::vector<VkBufferImageCopy> bufferCopyRegions;
-		for (uint32_t i = 0; i < mipLevels; i++)
+		for (uint32_t i = 0; i < ktxTexture->numLevels; i++)
 		{
 			ktx_size_t offset;
 			KTX_error_code result = ktxTexture_GetImageOffset(ktxTexture, i, 0, 0, &offset);
@@ -360,44 +482,74 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 			bufferCopyRegions.push_back(bufferCopyRegion);
 		}
 
-		// Create optimal tiled target image
-		VkImageCreateInfo imageCreateInfo = vks::initializers::imageCreateInfo();
-		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
-		imageCreateInfo.format = format;
-		imageCreateInfo.mipLevels = mipLevels;
-		imageCreateInfo.arrayLayers = 1;
-		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		imageCreateInfo.extent = { width, height, 1 };
-		imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-		VK_CHECK_RESULT(vkCreateImage(device->m_device, &imageCreateInfo, nullptr, &image));
+		fromMipChain(ktxTexture_GetData(ktxTexture), ktxTexture_GetSize(ktxTexture), ktxTexture_GetVkFormat(ktxTexture), ktxTexture->baseWidth, ktxTexture->baseHeight, bufferCopyRegions, ktxTexture_GetElementSize(ktxTexture), device);
+		ktxTexture_Destroy(ktxTexture);
+		return;
+	}
 
-		vkGetImageMemoryRequirements(device->m_device, image, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device->m_device, &memAllocInfo, nullptr, &deviceMemory));
-		VK_CHECK_RESULT(vkBindImageMemory(device->m_device, image, deviceMemory, 0));
+	createSamplerAndView(format);
+}
 
-		VkImageSubresourceRange subresourceRange = {};
-		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		subresourceRange.baseMipLevel = 0;
-		subresourceRange.levelCount = mipLevels;
-		subresourceRange.layerCount = 1;
+/*
+	Create the texture from a complete mip chain in host memory, with one copy region per mip level
+	Used for ktx files and for textures read from the scene cache, no mips are generated
+*/
+void vkglTF::Texture::fromMipChain(const void* data, VkDeviceSize size, VkFormat format, uint32_t width, uint32_t height, const std::vector<VkBufferImageCopy>& regions, VkDeviceSize texelBlockSize, vks::VulkanDevice* device)
+{
+	this->device = device;
+	this->width = width;
+	this->height = height;
+	mipLevels = static_cast<uint32_t>(regions.size());
+
+	VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
+	VkMemoryRequirements memReqs;
+
+	// Create optimal tiled target image
+	VkImageCreateInfo imageCreateInfo = vks::initializers::imageCreateInfo();
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format = format;
+	imageCreateInfo.mipLevels = mipLevels;
+	imageCreateInfo.arrayLayers = 1;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageCreateInfo.extent = { width, height, 1 };
+	// Upload directly from host memory if the device supports host image copies for this format, otherwise go through the staging ring
+	const bool hostCopy = device->hostImageCopySupported(format, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | (hostCopy ? VK_IMAGE_USAGE_HOST_TRANSFER_BIT : VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+	VK_CHECK_RESULT(vkCreateImage(device->m_device, &imageCreateInfo, nullptr, &image));
 
-		vks::tools::setImageLayout(copyCmd, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
-		vkCmdCopyBufferToImage(copyCmd, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(bufferCopyRegions.size()), bufferCopyRegions.data());
-		vks::tools::setImageLayout(copyCmd, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
-		device->flushCommandBuffer(copyCmd, copyQueue);
-		this->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	vkGetImageMemoryRequirements(device->m_device, image, &memReqs);
+	memAllocInfo.allocationSize = memReqs.size;
+	memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	VK_CHECK_RESULT(vkAllocateMemory(device->m_device, &memAllocInfo, nullptr, &deviceMemory));
+	VK_CHECK_RESULT(vkBindImageMemory(device->m_device, image, deviceMemory, 0));
 
-		vkDestroyBuffer(device->m_device, stagingBuffer, nullptr);
-		vkFreeMemory(device->m_device, stagingMemory, nullptr);
+	VkImageSubresourceRange subresourceRange = {};
+	subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	subresourceRange.baseMipLevel = 0;
+	subresourceRange.levelCount = mipLevels;
+	subresourceRange.layerCount = 1;
 
-		ktxTexture_Destroy(ktxTexture);
+	const auto uploadStart = std::chrono::high_resolution_clock::now();
+	if (hostCopy) {
+		device->copyMemoryToImage(data, image, regions, subresourceRange, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 	}
+	else {
+		vks::tools::setImageLayout(device->stagingRing.getCommandBuffer(), image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
+		device->stagingRing.copyToImage(data, size, image, regions, texelBlockSize);
+		device->stagingRing.releaseImage(image, subresourceRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		device->stagingRing.submit();
+	}
+	device->addTextureUpload(hostCopy, size, uploadStart);
+	imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	createSamplerAndView(format);
+}
 
+void vkglTF::Texture::createSamplerAndView(VkFormat format)
+{
 	VkSamplerCreateInfo samplerInfo{};
 	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
 	samplerInfo.magFilter = VK_FILTER_LINEAR;
@@ -468,6 +620,23 @@ void vkglTF::Material::createDescriptorSet(VkDescriptorPool descriptorPool, VkDe
 	vkUpdateDescriptorSets(device->m_device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 }
 
+/*
+	Writes the material images once through a descriptor manager, so they work with any of its backends
+*/
+void vkglTF::Material::createDescriptor(vks::DescriptorManager& descriptorManager, VkDescriptorSetLayout descriptorSetLayout, uint32_t descriptorBindingFlags)
+{
+	descriptor = descriptorManager.allocate(descriptorSetLayout);
+	uint32_t binding = 0;
+	if (descriptorBindingFlags & DescriptorBindingFlags::ImageBaseColor) {
+		descriptor->writeImage(binding++, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, baseColorTexture->descriptor);
+	}
+	if (descriptorBindingFlags & DescriptorBindingFlags::ImageNormalMap) {
+		// Layouts of a descriptor manager have fixed bindings, materials without a normal map use the base color image instead
+		descriptor->writeImage(binding++, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, normalTexture ? normalTexture->descriptor : baseColorTexture->descriptor);
+	}
+	descriptor->update();
+}
+
 
 /*
 	glTF primitive
@@ -480,26 +649,28 @@ void vkglTF::Primitive::setDimensions(glm::vec3 min, glm::vec3 max) {
 	dimensions.radius = glm::distance(min, max) / 2.0f;
 }
 
+/*
+	Select the coarsest level of detail whose error doesn't exceed maxError (in model units)
+	For a screen space threshold of pixelError pixels, maxError = distance * pixelError * 2 * tan(fovy / 2) / viewportHeight
+*/
+uint32_t vkglTF::Primitive::selectLod(float maxError) const
+{
+	uint32_t level = 0;
+	while ((level + 1 < lods.size()) && (lods[level + 1].error <= maxError)) {
+		level++;
+	}
+	return level;
+}
+
 /*
 	glTF mesh
 */
 vkglTF::Mesh::Mesh(vks::VulkanDevice *device, glm::mat4 matrix) {
 	this->device = device;
 	this->uniformBlock.matrix = matrix;
-	VK_CHECK_RESULT(device->createBuffer(
-		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		sizeof(uniformBlock),
-		&uniformBuffer.buffer,
-		&uniformBuffer.memory,
-		&uniformBlock));
-	VK_CHECK_RESULT(vkMapMemory(device->m_device, uniformBuffer.memory, 0, sizeof(uniformBlock), 0, &uniformBuffer.mapped));
-	uniformBuffer.descriptor = { uniformBuffer.buffer, 0, sizeof(uniformBlock) };
 };
 
 vkglTF::Mesh::~Mesh() {
-	vkDestroyBuffer(device->m_device, uniformBuffer.buffer, nullptr);
-	vkFreeMemory(device->m_device, uniformBuffer.memory, nullptr);
     for(auto primitive : primitives)
     {
         delete primitive;
@@ -523,23 +694,20 @@ glm::mat4 vkglTF::Node::getMatrix() {
 	return m;
 }
 
+/*
+	Update the uniform blocks of the node's mesh and its children's meshes
+	Joint matrices are updated for all skins at once with Model::updateJointMatrices
+*/
 void vkglTF::Node::update() {
 	if (mesh) {
-		glm::mat4 m = getMatrix();
+		mesh->uniformBlock.matrix = getMatrix();
 		if (skin) {
-			mesh->uniformBlock.matrix = m;
-			// Update join matrices
-			glm::mat4 inverseTransform = glm::inverse(m);
-			for (size_t i = 0; i < skin->joints.size(); i++) {
-				vkglTF::Node *jointNode = skin->joints[i];
-				glm::mat4 jointMat = jointNode->getMatrix() * skin->inverseBindMatrices[i];
-				jointMat = inverseTransform * jointMat;
-				mesh->uniformBlock.jointMatrix[i] = jointMat;
-			}
-			mesh->uniformBlock.jointcount = (float)skin->joints.size();
+			mesh->uniformBlock.jointOffset = skin->jointOffset;
+			mesh->uniformBlock.jointCount = static_cast<uint32_t>(skin->joints.size());
+		}
+		// The uniform buffer is created once all nodes are loaded
+		if (mesh->uniformBuffer.mapped) {
 			memcpy(mesh->uniformBuffer.mapped, &mesh->uniformBlock, sizeof(mesh->uniformBlock));
-		} else {
-			memcpy(mesh->uniformBuffer.mapped, &m, sizeof(glm::mat4));
 		}
 	}
 
@@ -562,6 +730,7 @@ vkglTF::Node::~Node() {
 */
 
 VkVertexInputBindingDescription vkglTF::Vertex::vertexInputBindingDescription;
+std::vector<VkVertexInputBindingDescription> vkglTF::Vertex::vertexInputBindingDescriptions;
 std::vector<VkVertexInputAttributeDescription> vkglTF::Vertex::vertexInputAttributeDescriptions;
 VkPipelineVertexInputStateCreateInfo vkglTF::Vertex::pipelineVertexInputStateCreateInfo;
 
@@ -600,18 +769,112 @@ std::vector<VkVertexInputAttributeDescription> vkglTF::Vertex::inputAttributeDes
 	return result;
 }
 
-/** @brief Returns the default pipeline vertex input state create info structure for the requested vertex components */
-VkPipelineVertexInputStateCreateInfo* vkglTF::Vertex::getPipelineVertexInputState(const std::vector<VertexComponent> components) {
-	vertexInputBindingDescription = Vertex::inputBindingDescription(0);
-	Vertex::vertexInputAttributeDescriptions = Vertex::inputAttributeDescriptions(0, components);
+/** @brief Returns the pipeline vertex input state create info structure for the requested vertex components in the given vertex layout */
+VkPipelineVertexInputStateCreateInfo* vkglTF::Vertex::getPipelineVertexInputState(const std::vector<VertexComponent> components, VertexLayout layout) {
 	pipelineVertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	pipelineVertexInputStateCreateInfo.vertexBindingDescriptionCount = 1;
-	pipelineVertexInputStateCreateInfo.pVertexBindingDescriptions = &Vertex::vertexInputBindingDescription;
+	if (layout == VertexLayout::Quantized) {
+		// Only the streams that contain one of the requested components are added, so e.g. a position only pipeline fetches from a single stream
+		Vertex::vertexInputBindingDescriptions.clear();
+		Vertex::vertexInputAttributeDescriptions.clear();
+		uint32_t location = 0;
+		for (VertexComponent component : components) {
+			const VkVertexInputAttributeDescription attributeDescription = QuantizedVertex::inputAttributeDescription(location, component);
+			Vertex::vertexInputAttributeDescriptions.push_back(attributeDescription);
+			const bool bindingAdded = std::any_of(Vertex::vertexInputBindingDescriptions.begin(), Vertex::vertexInputBindingDescriptions.end(), [attributeDescription](const VkVertexInputBindingDescription& bindingDescription) { return bindingDescription.binding == attributeDescription.binding; });
+			if (!bindingAdded) {
+				Vertex::vertexInputBindingDescriptions.push_back(QuantizedVertex::inputBindingDescription(attributeDescription.binding));
+			}
+			location++;
+		}
+		pipelineVertexInputStateCreateInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(Vertex::vertexInputBindingDescriptions.size());
+		pipelineVertexInputStateCreateInfo.pVertexBindingDescriptions = Vertex::vertexInputBindingDescriptions.data();
+	} else {
+		vertexInputBindingDescription = Vertex::inputBindingDescription(0);
+		Vertex::vertexInputAttributeDescriptions = Vertex::inputAttributeDescriptions(0, components);
+		pipelineVertexInputStateCreateInfo.vertexBindingDescriptionCount = 1;
+		pipelineVertexInputStateCreateInfo.pVertexBindingDescriptions = &Vertex::vertexInputBindingDescription;
+	}
 	pipelineVertexInputStateCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(Vertex::vertexInputAttributeDescriptions.size());
 	pipelineVertexInputStateCreateInfo.pVertexAttributeDescriptions = Vertex::vertexInputAttributeDescriptions.data();
 	return &pipelineVertexInputStateCreateInfo;
 }
 
+/*
+	glTF quantized vertex layout
+*/
+
+vkglTF::QuantizedVertex::Attributes vkglTF::QuantizedVertex::quantizeAttributes(const Vertex& vertex)
+{
+	Attributes attributes{};
+	const glm::vec3 normal = glm::length(vertex.normal) > 0.0f ? glm::normalize(vertex.normal) : glm::vec3(0.0f);
+	attributes.normal = glm::packSnorm4x8(glm::vec4(normal, 0.0f));
+	attributes.uv = glm::packHalf2x16(vertex.uv);
+	attributes.color = glm::packUnorm4x8(glm::clamp(vertex.color, glm::vec4(0.0f), glm::vec4(1.0f)));
+	const glm::vec3 tangent = glm::length(glm::vec3(vertex.tangent)) > 0.0f ? glm::normalize(glm::vec3(vertex.tangent)) : glm::vec3(0.0f);
+	attributes.tangent = glm::packSnorm4x8(glm::vec4(tangent, vertex.tangent.w < 0.0f ? -1.0f : 1.0f));
+	return attributes;
+}
+
+vkglTF::QuantizedVertex::Skin vkglTF::QuantizedVertex::quantizeSkin(const Vertex& vertex)
+{
+	Skin skin{};
+	// Skins aren't limited in size, glTF stores joint indices as 8 or 16 bit unsigned integers
+	for (uint32_t i = 0; i < 4; i++) {
+		assert((vertex.joint0[i] >= 0.0f) && (vertex.joint0[i] <= 65535.0f));
+		skin.joint0[i / 2] |= static_cast<uint32_t>(vertex.joint0[i]) << ((i % 2) * 16);
+	}
+	// Rounding may change the sum of the weights, the difference is added to the largest weight so they still add up to one
+	uint32_t weights[4];
+	uint32_t sum = 0;
+	uint32_t largest = 0;
+	for (uint32_t i = 0; i < 4; i++) {
+		weights[i] = static_cast<uint32_t>(glm::clamp(vertex.weight0[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+		sum += weights[i];
+		if (weights[i] > weights[largest]) {
+			largest = i;
+		}
+	}
+	if (sum > 0) {
+		weights[largest] = static_cast<uint32_t>(std::clamp(static_cast<int32_t>(weights[largest]) + 255 - static_cast<int32_t>(sum), 0, 255));
+	}
+	for (uint32_t i = 0; i < 4; i++) {
+		skin.weight0 |= weights[i] << (i * 8);
+	}
+	return skin;
+}
+
+VkVertexInputBindingDescription vkglTF::QuantizedVertex::inputBindingDescription(uint32_t binding) {
+	switch (binding) {
+		case positionBinding:
+			return VkVertexInputBindingDescription({ binding, sizeof(glm::vec3), VK_VERTEX_INPUT_RATE_VERTEX });
+		case attributeBinding:
+			return VkVertexInputBindingDescription({ binding, sizeof(Attributes), VK_VERTEX_INPUT_RATE_VERTEX });
+		default:
+			return VkVertexInputBindingDescription({ binding, sizeof(Skin), VK_VERTEX_INPUT_RATE_VERTEX });
+	}
+}
+
+VkVertexInputAttributeDescription vkglTF::QuantizedVertex::inputAttributeDescription(uint32_t location, VertexComponent component) {
+	switch (component) {
+		case VertexComponent::Position:
+			return VkVertexInputAttributeDescription({ location, positionBinding, VK_FORMAT_R32G32B32_SFLOAT, 0 });
+		case VertexComponent::Normal:
+			return VkVertexInputAttributeDescription({ location, attributeBinding, VK_FORMAT_R8G8B8A8_SNORM, offsetof(Attributes, normal) });
+		case VertexComponent::UV:
+			return VkVertexInputAttributeDescription({ location, attributeBinding, VK_FORMAT_R16G16_SFLOAT, offsetof(Attributes, uv) });
+		case VertexComponent::Color:
+			return VkVertexInputAttributeDescription({ location, attributeBinding, VK_FORMAT_R8G8B8A8_UNORM, offsetof(Attributes, color) });
+		case VertexComponent::Tangent:
+			return VkVertexInputAttributeDescription({ location, attributeBinding, VK_FORMAT_R8G8B8A8_SNORM, offsetof(Attributes, tangent) });
+		case VertexComponent::Joint0:
+			return VkVertexInputAttributeDescription({ location, skinBinding, VK_FORMAT_R16G16B16A16_USCALED, offsetof(Skin, joint0) });
+		case VertexComponent::Weight0:
+			return VkVertexInputAttributeDescription({ location, skinBinding, VK_FORMAT_R8G8B8A8_UNORM, offsetof(Skin, weight0) });
+		default:
+			return VkVertexInputAttributeDescription({});
+	}
+}
+
 vkglTF::Texture* vkglTF::Model::getTexture(uint32_t index)
 {
 
@@ -633,28 +896,8 @@ void vkglTF::Model::createEmptyTexture(VkQueue transferQueue)
 	unsigned char* buffer = new unsigned char[bufferSize];
 	memset(buffer, 0, bufferSize);
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingMemory;
-	VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo();
-	bufferCreateInfo.size = bufferSize;
-	// This buffer is used as a transfer source for the buffer copy
-	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	VK_CHECK_RESULT(vkCreateBuffer(device->m_device, &bufferCreateInfo, nullptr, &stagingBuffer));
-
 	VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
 	VkMemoryRequirements memReqs;
-	vkGetBufferMemoryRequirements(device->m_device, stagingBuffer, &memReqs);
-	memAllocInfo.allocationSize = memReqs.size;
-	memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	VK_CHECK_RESULT(vkAllocateMemory(device->m_device, &memAllocInfo, nullptr, &stagingMemory));
-	VK_CHECK_RESULT(vkBindBufferMemory(device->m_device, stagingBuffer, stagingMemory, 0));
-
-	// Copy texture data into staging buffer
-	uint8_t* data;
-	VK_CHECK_RESULT(vkMapMemory(device->m_device, stagingMemory, 0, memReqs.size, 0, (void**)&data));
-	memcpy(data, buffer, bufferSize);
-	vkUnmapMemory(device->m_device, stagingMemory);
 
 	VkBufferImageCopy bufferCopyRegion = {};
 	bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -689,17 +932,12 @@ void vkglTF::Model::createEmptyTexture(VkQueue transferQueue)
 	subresourceRange.levelCount = 1;
 	subresourceRange.layerCount = 1;
 
-	VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-	vks::tools::setImageLayout(copyCmd, emptyTexture.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
-	vkCmdCopyBufferToImage(copyCmd, stagingBuffer, emptyTexture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
-	vks::tools::setImageLayout(copyCmd, emptyTexture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
-	device->flushCommandBuffer(copyCmd, transferQueue);
+	vks::tools::setImageLayout(device->stagingRing.getCommandBuffer(), emptyTexture.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
+	device->stagingRing.copyToImage(buffer, bufferSize, emptyTexture.image, { bufferCopyRegion });
+	device->stagingRing.releaseImage(emptyTexture.image, subresourceRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	device->stagingRing.submit();
 	emptyTexture.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-	// Clean up staging resources
-	vkDestroyBuffer(device->m_device, stagingBuffer, nullptr);
-	vkFreeMemory(device->m_device, stagingMemory, nullptr);
-
 	VkSamplerCreateInfo samplerCreateInfo = vks::initializers::samplerCreateInfo();
 	samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
 	samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
@@ -731,8 +969,55 @@ vkglTF::Model::~Model()
 {
 	vkDestroyBuffer(device->m_device, vertices.buffer, nullptr);
 	vkFreeMemory(device->m_device, vertices.memory, nullptr);
+	for (VertexStream* stream : { &attributeStream, &skinStream }) {
+		if (stream->buffer != VK_NULL_HANDLE) {
+			vkDestroyBuffer(device->m_device, stream->buffer, nullptr);
+			vkFreeMemory(device->m_device, stream->memory, nullptr);
+		}
+	}
 	vkDestroyBuffer(device->m_device, indices.buffer, nullptr);
 	vkFreeMemory(device->m_device, indices.memory, nullptr);
+	for (StorageBuffer* storageBuffer : { &meshlets.meshletBuffer, &meshlets.boundsBuffer, &meshlets.vertexBuffer, &meshlets.triangleBuffer }) {
+		if (storageBuffer->buffer != VK_NULL_HANDLE) {
+			vkDestroyBuffer(device->m_device, storageBuffer->buffer, nullptr);
+			vkFreeMemory(device->m_device, storageBuffer->memory, nullptr);
+		}
+	}
+	for (StorageBuffer* storageBuffer : { &indirect.drawBuffer, &indirect.materialBuffer, &indirect.commandBuffer, &indirect.countBuffer, &indirect.cullUniformBuffer }) {
+		if (storageBuffer->buffer != VK_NULL_HANDLE) {
+			vkDestroyBuffer(device->m_device, storageBuffer->buffer, nullptr);
+			vkFreeMemory(device->m_device, storageBuffer->memory, nullptr);
+		}
+	}
+	for (StorageBuffer* storageBuffer : { &jointPalette.buffer, &skinning.positions, &skinning.normals }) {
+		if (storageBuffer->buffer != VK_NULL_HANDLE) {
+			vkDestroyBuffer(device->m_device, storageBuffer->buffer, nullptr);
+			vkFreeMemory(device->m_device, storageBuffer->memory, nullptr);
+		}
+	}
+	if (nodeBuffer.buffer != VK_NULL_HANDLE) {
+		vkDestroyBuffer(device->m_device, nodeBuffer.buffer, nullptr);
+		vkFreeMemory(device->m_device, nodeBuffer.memory, nullptr);
+	}
+	if (jointPalette.descriptorSetLayout != VK_NULL_HANDLE) {
+		vkDestroyDescriptorSetLayout(device->m_device, jointPalette.descriptorSetLayout, nullptr);
+	}
+	if (jointPalette.descriptorPool != VK_NULL_HANDLE) {
+		vkDestroyDescriptorPool(device->m_device, jointPalette.descriptorPool, nullptr);
+	}
+	if (skinning.pipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(device->m_device, skinning.pipeline, nullptr);
+		vkDestroyPipelineLayout(device->m_device, skinning.pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device->m_device, skinning.descriptorSetLayout, nullptr);
+		vkDestroyDescriptorPool(device->m_device, skinning.descriptorPool, nullptr);
+	}
+	if (indirect.cullPipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(device->m_device, indirect.cullPipeline, nullptr);
+		vkDestroyPipelineLayout(device->m_device, indirect.cullPipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device->m_device, indirect.cullDescriptorSetLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device->m_device, indirect.descriptorSetLayout, nullptr);
+		vkDestroyDescriptorPool(device->m_device, indirect.descriptorPool, nullptr);
+	}
 	for (auto texture : textures) {
 		texture.destroy();
 	}
@@ -754,6 +1039,109 @@ vkglTF::Model::~Model()
 	emptyTexture.destroy();
 }
 
+/*
+	Get a view on the elements of an accessor, accessors without a buffer view or with out of range data return a view without data
+*/
+vkglTF::Model::AccessorView vkglTF::Model::accessorView(const tinygltf::Model& model, int accessorIndex) const
+{
+	const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
+	AccessorView view{};
+	view.count = accessor.count;
+	view.componentType = accessor.componentType;
+	view.componentCount = static_cast<uint32_t>(tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type)));
+	view.normalized = accessor.normalized;
+	if (accessor.bufferView < 0) {
+		return view;
+	}
+	const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+	const int stride = accessor.ByteStride(bufferView);
+	if ((stride <= 0) || (bufferView.buffer < 0) || (bufferView.buffer >= static_cast<int>(gltfBuffers.size()))) {
+		return view;
+	}
+	const BufferData& buffer = gltfBuffers[bufferView.buffer];
+	const size_t offset = accessor.byteOffset + bufferView.byteOffset;
+	const size_t elementSize = view.componentCount * tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(accessor.componentType));
+	if ((view.count > 0) && (offset + (view.count - 1) * stride + elementSize > buffer.size)) {
+		return view;
+	}
+	view.stride = static_cast<size_t>(stride);
+	view.data = static_cast<const uint8_t*>(buffer.data) + offset;
+	return view;
+}
+
+/*
+	Read the elements of an accessor into a strided float destination, e.g. one component of the interleaved vertices
+	Only the components both the accessor and the destination have are written, the others keep their values
+*/
+void vkglTF::Model::readAccessor(const AccessorView& view, float* dst, uint32_t componentCount, size_t dstStride)
+{
+	if (view.data == nullptr) {
+		return;
+	}
+	uint8_t* dstBytes = reinterpret_cast<uint8_t*>(dst);
+	const uint32_t components = std::min(view.componentCount, componentCount);
+	// Fast path for tightly packed float accessors, which is what most exporters write
+	if ((view.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) && (view.stride == view.componentCount * sizeof(float)) && (components == view.componentCount)) {
+		switch (components) {
+		case 1:
+			copyPackedFloats<1>(view.data, view.count, dstBytes, dstStride);
+			return;
+		case 2:
+			copyPackedFloats<2>(view.data, view.count, dstBytes, dstStride);
+			return;
+		case 3:
+			copyPackedFloats<3>(view.data, view.count, dstBytes, dstStride);
+			return;
+		case 4:
+			copyPackedFloats<4>(view.data, view.count, dstBytes, dstStride);
+			return;
+		case 16:
+			copyPackedFloats<16>(view.data, view.count, dstBytes, dstStride);
+			return;
+		}
+	}
+	// Interleaved, normalized integer and other component types are converted component by component
+	const size_t componentSize = tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(view.componentType));
+	for (size_t i = 0; i < view.count; i++) {
+		const uint8_t* src = view.data + i * view.stride;
+		float* element = reinterpret_cast<float*>(dstBytes + i * dstStride);
+		for (uint32_t c = 0; c < components; c++) {
+			element[c] = componentToFloat(src + c * componentSize, view.componentType, view.normalized);
+		}
+	}
+}
+
+/*
+	Read the indices of an accessor with the offset of the primitive's first vertex added, fails for component types that aren't valid for indices
+*/
+bool vkglTF::Model::readIndices(const AccessorView& view, uint32_t offset, uint32_t* dst)
+{
+	switch (view.componentType) {
+	case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT:
+	case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
+	case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE:
+		break;
+	default:
+		return false;
+	}
+	if (view.data == nullptr) {
+		std::fill(dst, dst + view.count, offset);
+		return true;
+	}
+	switch (view.componentType) {
+	case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT:
+		copyIndices<uint32_t>(view.data, view.count, offset, dst);
+		break;
+	case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
+		copyIndices<uint16_t>(view.data, view.count, offset, dst);
+		break;
+	case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE:
+		copyIndices<uint8_t>(view.data, view.count, offset, dst);
+		break;
+	}
+	return true;
+}
+
 void vkglTF::Model::loadNode(vkglTF::Node *parent, const tinygltf::Node &node, uint32_t nodeIndex, const tinygltf::Model &model, std::vector<uint32_t>& indexBuffer, std::vector<Vertex>& vertexBuffer, float globalscale)
 {
 	vkglTF::Node *newNode = new Node{};
@@ -812,130 +1200,56 @@ void vkglTF::Model::loadNode(vkglTF::Node *parent, const tinygltf::Node &node, u
 			bool hasSkin = false;
 			// Vertices
 			{
-				const float *bufferPos = nullptr;
-				const float *bufferNormals = nullptr;
-				const float *bufferTexCoords = nullptr;
-				const float* bufferColors = nullptr;
-				const float *bufferTangents = nullptr;
-				uint32_t numColorComponents;
-				const uint16_t *bufferJoints = nullptr;
-				const float *bufferWeights = nullptr;
-
 				// Position attribute is required
 				assert(primitive.attributes.find("POSITION") != primitive.attributes.end());
 
 				const tinygltf::Accessor &posAccessor = model.accessors[primitive.attributes.find("POSITION")->second];
-				const tinygltf::BufferView &posView = model.bufferViews[posAccessor.bufferView];
-				bufferPos = reinterpret_cast<const float *>(&(model.buffers[posView.buffer].data[posAccessor.byteOffset + posView.byteOffset]));
 				posMin = glm::vec3(posAccessor.minValues[0], posAccessor.minValues[1], posAccessor.minValues[2]);
 				posMax = glm::vec3(posAccessor.maxValues[0], posAccessor.maxValues[1], posAccessor.maxValues[2]);
+				vertexCount = static_cast<uint32_t>(posAccessor.count);
 
-				if (primitive.attributes.find("NORMAL") != primitive.attributes.end()) {
-					const tinygltf::Accessor &normAccessor = model.accessors[primitive.attributes.find("NORMAL")->second];
-					const tinygltf::BufferView &normView = model.bufferViews[normAccessor.bufferView];
-					bufferNormals = reinterpret_cast<const float *>(&(model.buffers[normView.buffer].data[normAccessor.byteOffset + normView.byteOffset]));
-				}
-
-				if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end()) {
-					const tinygltf::Accessor &uvAccessor = model.accessors[primitive.attributes.find("TEXCOORD_0")->second];
-					const tinygltf::BufferView &uvView = model.bufferViews[uvAccessor.bufferView];
-					bufferTexCoords = reinterpret_cast<const float *>(&(model.buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
-				}
-
-				if (primitive.attributes.find("COLOR_0") != primitive.attributes.end())
-				{
-					const tinygltf::Accessor& colorAccessor = model.accessors[primitive.attributes.find("COLOR_0")->second];
-					const tinygltf::BufferView& colorView = model.bufferViews[colorAccessor.bufferView];
-					// Color buffer are either of type vec3 or vec4
-					numColorComponents = colorAccessor.type == TINYGLTF_PARAMETER_TYPE_FLOAT_VEC3 ? 3 : 4;
-					bufferColors = reinterpret_cast<const float*>(&(model.buffers[colorView.buffer].data[colorAccessor.byteOffset + colorView.byteOffset]));
-				}
-
-				if (primitive.attributes.find("TANGENT") != primitive.attributes.end())
-				{
-					const tinygltf::Accessor &tangentAccessor = model.accessors[primitive.attributes.find("TANGENT")->second];
-					const tinygltf::BufferView &tangentView = model.bufferViews[tangentAccessor.bufferView];
-					bufferTangents = reinterpret_cast<const float *>(&(model.buffers[tangentView.buffer].data[tangentAccessor.byteOffset + tangentView.byteOffset]));
-				}
+				// Components the primitive doesn't provide keep these values
+				Vertex defaultVertex{};
+				defaultVertex.color = glm::vec4(1.0f);
+				vertexBuffer.resize(vertexStart + vertexCount, defaultVertex);
+				Vertex* vertices = vertexBuffer.data() + vertexStart;
+
+				// Each attribute is converted with one pass over its accessor, colors with three components keep an alpha of one
+				auto readAttribute = [&](const char* name, float* dst, uint32_t componentCount) {
+					const auto attribute = primitive.attributes.find(name);
+					if (attribute == primitive.attributes.end()) {
+						return false;
+					}
+					readAccessor(accessorView(model, attribute->second), dst, componentCount, sizeof(Vertex));
+					return true;
+				};
+				readAttribute("POSITION", &vertices->pos.x, 3);
+				const bool hasNormals = readAttribute("NORMAL", &vertices->normal.x, 3);
+				readAttribute("TEXCOORD_0", &vertices->uv.x, 2);
+				readAttribute("COLOR_0", &vertices->color.x, 4);
+				readAttribute("TANGENT", &vertices->tangent.x, 4);
 
 				// Skinning
-				// Joints
-				if (primitive.attributes.find("JOINTS_0") != primitive.attributes.end()) {
-					const tinygltf::Accessor &jointAccessor = model.accessors[primitive.attributes.find("JOINTS_0")->second];
-					const tinygltf::BufferView &jointView = model.bufferViews[jointAccessor.bufferView];
-					bufferJoints = reinterpret_cast<const uint16_t *>(&(model.buffers[jointView.buffer].data[jointAccessor.byteOffset + jointView.byteOffset]));
-				}
-
-				if (primitive.attributes.find("WEIGHTS_0") != primitive.attributes.end()) {
-					const tinygltf::Accessor &uvAccessor = model.accessors[primitive.attributes.find("WEIGHTS_0")->second];
-					const tinygltf::BufferView &uvView = model.bufferViews[uvAccessor.bufferView];
-					bufferWeights = reinterpret_cast<const float *>(&(model.buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
+				hasSkin = (primitive.attributes.find("JOINTS_0") != primitive.attributes.end()) && (primitive.attributes.find("WEIGHTS_0") != primitive.attributes.end());
+				if (hasSkin) {
+					readAttribute("JOINTS_0", &vertices->joint0.x, 4);
+					readAttribute("WEIGHTS_0", &vertices->weight0.x, 4);
 				}
 
-				hasSkin = (bufferJoints && bufferWeights);
-
-				vertexCount = static_cast<uint32_t>(posAccessor.count);
-
-				for (size_t v = 0; v < posAccessor.count; v++) {
-					Vertex vert{};
-					vert.pos = glm::vec4(glm::make_vec3(&bufferPos[v * 3]), 1.0f);
-					vert.normal = glm::normalize(glm::vec3(bufferNormals ? glm::make_vec3(&bufferNormals[v * 3]) : glm::vec3(0.0f)));
-					vert.uv = bufferTexCoords ? glm::make_vec2(&bufferTexCoords[v * 2]) : glm::vec3(0.0f);
-					if (bufferColors) {
-						switch (numColorComponents) {
-							case 3: 
-								vert.color = glm::vec4(glm::make_vec3(&bufferColors[v * 3]), 1.0f);
-							case 4:
-								vert.color = glm::make_vec4(&bufferColors[v * 4]);
-						}
+				if (hasNormals) {
+					for (uint32_t v = 0; v < vertexCount; v++) {
+						vertices[v].normal = glm::normalize(vertices[v].normal);
 					}
-					else {
-						vert.color = glm::vec4(1.0f);
-					}
-					vert.tangent = bufferTangents ? glm::vec4(glm::make_vec4(&bufferTangents[v * 4])) : glm::vec4(0.0f);
-					vert.joint0 = hasSkin ? glm::vec4(glm::make_vec4(&bufferJoints[v * 4])) : glm::vec4(0.0f);
-					vert.weight0 = hasSkin ? glm::make_vec4(&bufferWeights[v * 4]) : glm::vec4(0.0f);
-					vertexBuffer.push_back(vert);
 				}
 			}
 			// Indices
 			{
-				const tinygltf::Accessor &accessor = model.accessors[primitive.indices];
-				const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
-				const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
-
-				indexCount = static_cast<uint32_t>(accessor.count);
-
-				switch (accessor.componentType) {
-				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT: {
-					uint32_t *buf = new uint32_t[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint32_t));
-					for (size_t index = 0; index < accessor.count; index++) {
-						indexBuffer.push_back(buf[index] + vertexStart);
-					}
-                    delete[] buf;
-					break;
-				}
-				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT: {
-					uint16_t *buf = new uint16_t[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint16_t));
-					for (size_t index = 0; index < accessor.count; index++) {
-						indexBuffer.push_back(buf[index] + vertexStart);
-					}
-                    delete[] buf;
-                    break;
-				}
-				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE: {
-					uint8_t *buf = new uint8_t[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint8_t));
-					for (size_t index = 0; index < accessor.count; index++) {
-						indexBuffer.push_back(buf[index] + vertexStart);
-					}
-                    delete[] buf;
-                    break;
-				}
-				default:
-					std::cerr << "Index component type " << accessor.componentType << " not supported!" << std::endl;
+				const AccessorView view = accessorView(model, primitive.indices);
+				indexCount = static_cast<uint32_t>(view.count);
+				indexBuffer.resize(indexStart + indexCount);
+				if (!readIndices(view, vertexStart, indexBuffer.data() + indexStart)) {
+					indexBuffer.resize(indexStart);
+					std::cerr << "Index component type " << view.componentType << " not supported!" << std::endl;
 					return;
 				}
 			}
@@ -976,11 +1290,9 @@ void vkglTF::Model::loadSkins(tinygltf::Model &gltfModel)
 
 		// Get inverse bind matrices from buffer
 		if (source.inverseBindMatrices > -1) {
-			const tinygltf::Accessor &accessor = gltfModel.accessors[source.inverseBindMatrices];
-			const tinygltf::BufferView &bufferView = gltfModel.bufferViews[accessor.bufferView];
-			const tinygltf::Buffer &buffer = gltfModel.buffers[bufferView.buffer];
-			newSkin->inverseBindMatrices.resize(accessor.count);
-			memcpy(newSkin->inverseBindMatrices.data(), &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(glm::mat4));
+			const AccessorView view = accessorView(gltfModel, source.inverseBindMatrices);
+			newSkin->inverseBindMatrices.resize(view.count, glm::mat4(1.0f));
+			readAccessor(view, reinterpret_cast<float*>(newSkin->inverseBindMatrices.data()), 16, sizeof(glm::mat4));
 		}
 
 		skins.push_back(newSkin);
@@ -1074,18 +1386,9 @@ void vkglTF::Model::loadAnimations(tinygltf::Model &gltfModel)
 
 			// Read sampler input time values
 			{
-				const tinygltf::Accessor &accessor = gltfModel.accessors[samp.input];
-				const tinygltf::BufferView &bufferView = gltfModel.bufferViews[accessor.bufferView];
-				const tinygltf::Buffer &buffer = gltfModel.buffers[bufferView.buffer];
-
-				assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-
-				float *buf = new float[accessor.count];
-				memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(float));
-				for (size_t index = 0; index < accessor.count; index++) {
-					sampler.inputs.push_back(buf[index]);
-				}
-                delete[] buf;
+				const AccessorView view = accessorView(gltfModel, samp.input);
+				sampler.inputs.resize(view.count);
+				readAccessor(view, sampler.inputs.data(), 1, sizeof(float));
 				for (auto input : sampler.inputs) {
 					if (input < animation.start) {
 						animation.start = input;
@@ -1096,37 +1399,14 @@ void vkglTF::Model::loadAnimations(tinygltf::Model &gltfModel)
 				}
 			}
 
-			// Read sampler output T/R/S values 
+			// Read sampler output T/R/S values, translations and scales are stored with a w of zero
 			{
-				const tinygltf::Accessor &accessor = gltfModel.accessors[samp.output];
-				const tinygltf::BufferView &bufferView = gltfModel.bufferViews[accessor.bufferView];
-				const tinygltf::Buffer &buffer = gltfModel.buffers[bufferView.buffer];
-
-				assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-
-				switch (accessor.type) {
-				case TINYGLTF_TYPE_VEC3: {
-					glm::vec3 *buf = new glm::vec3[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(glm::vec3));
-					for (size_t index = 0; index < accessor.count; index++) {
-						sampler.outputsVec4.push_back(glm::vec4(buf[index], 0.0f));
-					}
-                    delete[] buf;
-                    break;
-				}
-				case TINYGLTF_TYPE_VEC4: {
-					glm::vec4 *buf = new glm::vec4[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(glm::vec4));
-					for (size_t index = 0; index < accessor.count; index++) {
-						sampler.outputsVec4.push_back(buf[index]);
-					}
-                    delete[] buf;
-                    break;
-				}
-				default: {
+				const AccessorView view = accessorView(gltfModel, samp.output);
+				if ((view.componentCount == 3) || (view.componentCount == 4)) {
+					sampler.outputsVec4.resize(view.count, glm::vec4(0.0f));
+					readAccessor(view, reinterpret_cast<float*>(sampler.outputsVec4.data()), 4, sizeof(glm::vec4));
+				} else {
 					std::cout << "unknown type" << std::endl;
-					break;
-				}
 				}
 			}
 
@@ -1183,18 +1463,58 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 	std::string error, warning;
 
 	this->device = device;
+	loadingFlags = fileLoadingFlags;
+
+	const auto loadStart = std::chrono::high_resolution_clock::now();
+	// Skip parsing and processing the glTF file if the scene cache is up to date
+	// The cache stores the final vertex and index buffers, the node hierarchy, materials, animations and complete mip chains of all textures next to the glTF file
+	const bool sceneCache = (fileLoadingFlags & FileLoadingFlags::UseSceneCache) != 0;
+	const std::string sceneCacheFilename = filename + ".scenecache";
+	const uint64_t sceneKey = sceneCache ? sceneCacheKey(filename, scale) : 0;
+	loadedFromSceneCache = sceneCache && loadSceneCache(sceneCacheFilename, sceneKey, transferQueue);
+	if (loadedFromSceneCache) {
+		getSceneDimensions();
+		setupDescriptors();
+		loadTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+		std::cout << "Loaded " << filename << " from the scene cache in " << loadTime << " ms" << std::endl;
+		return;
+	}
 
+	// Binary files are memory mapped and accessors into their binary chunk read from the mapping, so tinygltf's copy of it can be released right away
+	const bool binary = isBinaryglTF(filename);
+	MappedFile glbFile;
+	const uint8_t* binChunk = nullptr;
+	size_t binChunkSize = 0;
+	bool fileLoaded = false;
+	if (binary) {
 #if defined(__ANDROID__)
-	// On Android all assets are packed with the apk in a compressed form, so we need to open them using the asset manager
-	// We let tinygltf handle this, by passing the asset manager of our app
-	tinygltf::asset_manager = androidApp->activity->assetManager;
+		fileLoaded = gltfContext.LoadBinaryFromFile(&gltfModel, &error, &warning, filename);
+#else
+		if (glbFile.open(filename)) {
+			fileLoaded = gltfContext.LoadBinaryFromMemory(&gltfModel, &error, &warning, glbFile.data, static_cast<unsigned int>(glbFile.size), path);
+			binChunk = glbBinaryChunk(glbFile.data, glbFile.size, binChunkSize);
+		} else {
+			error = "Could not open file";
+		}
 #endif
-	bool fileLoaded = gltfContext.LoadASCIIFromFile(&gltfModel, &error, &warning, filename);
+	} else {
+		fileLoaded = gltfContext.LoadASCIIFromFile(&gltfModel, &error, &warning, filename);
+	}
 
 	std::vector<uint32_t> indexBuffer;
 	std::vector<Vertex> vertexBuffer;
 
 	if (fileLoaded) {
+		gltfBuffers.clear();
+		for (size_t i = 0; i < gltfModel.buffers.size(); i++) {
+			tinygltf::Buffer& buffer = gltfModel.buffers[i];
+			if ((i == 0) && binChunk && buffer.uri.empty() && (buffer.data.size() <= binChunkSize)) {
+				gltfBuffers.push_back({ binChunk, buffer.data.size() });
+				std::vector<unsigned char>().swap(buffer.data);
+			} else {
+				gltfBuffers.push_back({ buffer.data.data(), buffer.data.size() });
+			}
+		}
 		if (!(fileLoadingFlags & FileLoadingFlags::DontLoadImages)) {
 			loadImages(gltfModel, device, transferQueue);
 		}
@@ -1219,6 +1539,8 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 				node->update();
 			}
 		}
+		// All accessors have been read, the views would point into the file mapping once it's closed
+		gltfBuffers.clear();
 	}
 	else {
 		vks::tools::exitFatal("Could not load glTF file \"" + filename + "\": " + error, -1);
@@ -1263,73 +1585,153 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 		}
 	}
 
-	size_t vertexBufferSize = vertexBuffer.size() * sizeof(Vertex);
-	size_t indexBufferSize = indexBuffer.size() * sizeof(uint32_t);
+	if (fileLoadingFlags & FileLoadingFlags::OptimizeMeshes) {
+		optimizeMeshes(indexBuffer, vertexBuffer);
+	}
+	if (fileLoadingFlags & FileLoadingFlags::GenerateLods) {
+		generateLods(indexBuffer, vertexBuffer);
+	}
+	if (fileLoadingFlags & FileLoadingFlags::BuildMeshlets) {
+		// Mirroring the vertices along the y axis turns the winding of front faces to clockwise
+		buildMeshlets(filename, indexBuffer, vertexBuffer, fileLoadingFlags & FileLoadingFlags::FlipY);
+	}
+
+	// 16 bit indices are stored in the lower half of the index buffer, so they can be uploaded in place
+	if (indices.type == VK_INDEX_TYPE_UINT16) {
+		uint16_t* indices16 = reinterpret_cast<uint16_t*>(indexBuffer.data());
+		for (size_t i = 0; i < indexBuffer.size(); i++) {
+			indices16[i] = static_cast<uint16_t>(indexBuffer[i]);
+		}
+	}
+	const BufferData indexData{ indexBuffer.data(), indexBuffer.size() * (indices.type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t)) };
 	indices.count = static_cast<uint32_t>(indexBuffer.size());
 	vertices.count = static_cast<uint32_t>(vertexBuffer.size());
 
-	assert((vertexBufferSize > 0) && (indexBufferSize > 0));
+	assert((vertexBuffer.size() > 0) && (indexData.size > 0));
+
+	// Vertex streams in the order of their bindings
+	std::vector<glm::vec3> positions;
+	std::vector<QuantizedVertex::Attributes> attributes;
+	std::vector<QuantizedVertex::Skin> skin;
+	std::vector<BufferData> vertexStreams;
+	if (fileLoadingFlags & FileLoadingFlags::QuantizeVertices) {
+		quantizeVertices(vertexBuffer, positions, attributes, skin);
+		vertexStreams.push_back({ positions.data(), positions.size() * sizeof(glm::vec3) });
+		vertexStreams.push_back({ attributes.data(), attributes.size() * sizeof(QuantizedVertex::Attributes) });
+		if (!skin.empty()) {
+			vertexStreams.push_back({ skin.data(), skin.size() * sizeof(QuantizedVertex::Skin) });
+		}
+	} else {
+		vertexStreams.push_back({ vertexBuffer.data(), vertexBuffer.size() * sizeof(Vertex) });
+	}
 
-	struct StagingBuffer {
-		VkBuffer buffer;
-		VkDeviceMemory memory;
-	} vertexStaging, indexStaging;
+	createBuffers(vertexStreams, indexData);
+	if (fileLoadingFlags & FileLoadingFlags::BuildBvh) {
+		buildBvh(vertexStreams[0], indexData);
+	}
+	getSceneDimensions();
+	if (sceneCache) {
+		saveSceneCache(sceneCacheFilename, sceneKey, gltfModel, vertexStreams, indexData);
+	}
+	setupDescriptors();
+	loadTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+	// Only reported when the scene cache is used, for comparing against the cached load
+	if (sceneCache) {
+		std::cout << "Loaded " << filename << " in " << loadTime << " ms" << std::endl;
+	}
+}
 
-	// Create staging buffers
-	// Vertex data
-	VK_CHECK_RESULT(device->createBuffer(
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		vertexBufferSize,
-		&vertexStaging.buffer,
-		&vertexStaging.memory,
-		vertexBuffer.data()));
-	// Index data
-	VK_CHECK_RESULT(device->createBuffer(
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		indexBufferSize,
-		&indexStaging.buffer,
-		&indexStaging.memory,
-		indexBuffer.data()));
-
-	// Create device local buffers
-	// Vertex buffer
-	VK_CHECK_RESULT(device->createBuffer(
-	    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | memoryPropertyFlags,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		vertexBufferSize,
-		&vertices.buffer,
-		&vertices.memory));
+/*
+	Create the device local vertex, index and meshlet buffers and upload their data through the device's staging ring
+*/
+void vkglTF::Model::createBuffers(const std::vector<BufferData>& vertexStreams, BufferData indexData)
+{
+	// Vertex buffer(s)
+	vertexLayout = (loadingFlags & FileLoadingFlags::QuantizeVertices) ? VertexLayout::Quantized : VertexLayout::Default;
+	const std::pair<VkBuffer*, VkDeviceMemory*> vertexBuffers[] = {
+		{ &vertices.buffer, &vertices.memory },
+		{ &attributeStream.buffer, &attributeStream.memory },
+		{ &skinStream.buffer, &skinStream.memory },
+	};
+	assert(vertexStreams.size() <= 3);
+	vertexBufferSize = 0;
+	for (size_t i = 0; i < vertexStreams.size(); i++) {
+		createVertexBuffer(vertexStreams[i].data, vertexStreams[i].size, vertexBuffers[i].first, vertexBuffers[i].second);
+		vertexBufferSize += vertexStreams[i].size;
+	}
 	// Index buffer
 	VK_CHECK_RESULT(device->createBuffer(
 	    VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | memoryPropertyFlags,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		indexBufferSize,
+		indexData.size,
 		&indices.buffer,
 		&indices.memory));
+	device->stagingRing.copyToBuffer(indexData.data, indexData.size, indices.buffer);
+	// Meshlet storage buffers
+	if (!meshlets.meshlets.empty()) {
+		createMeshletBuffers();
+	}
+	device->stagingRing.submit();
+}
 
-	// Copy from staging buffers
-	VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-	VkBufferCopy copyRegion = {};
-
-	copyRegion.size = vertexBufferSize;
-	vkCmdCopyBuffer(copyCmd, vertexStaging.buffer, vertices.buffer, 1, &copyRegion);
-
-	copyRegion.size = indexBufferSize;
-	vkCmdCopyBuffer(copyCmd, indexStaging.buffer, indices.buffer, 1, &copyRegion);
+/*
+	Create the shared uniform buffer of all meshes and the joint palette of all skins and write the current pose to them
+*/
+void vkglTF::Model::createNodeBuffers()
+{
+	// Mesh uniform blocks
+	const VkDeviceSize uniformBlockSize = vks::tools::alignedVkSize(sizeof(Mesh::UniformBlock), device->m_vkPhysicalDeviceProperties.limits.minUniformBufferOffsetAlignment);
+	std::vector<Mesh*> meshes;
+	for (Node* node : linearNodes) {
+		if (node->mesh) {
+			meshes.push_back(node->mesh);
+		}
+	}
+	if (!meshes.empty()) {
+		const VkDeviceSize bufferSize = meshes.size() * uniformBlockSize;
+		VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, bufferSize, &nodeBuffer.buffer, &nodeBuffer.memory));
+		VK_CHECK_RESULT(vkMapMemory(device->m_device, nodeBuffer.memory, 0, bufferSize, 0, &nodeBuffer.mapped));
+		for (size_t i = 0; i < meshes.size(); i++) {
+			Mesh::UniformBuffer& uniformBuffer = meshes[i]->uniformBuffer;
+			uniformBuffer.buffer = nodeBuffer.buffer;
+			uniformBuffer.descriptor = { nodeBuffer.buffer, i * uniformBlockSize, sizeof(Mesh::UniformBlock) };
+			uniformBuffer.mapped = static_cast<uint8_t*>(nodeBuffer.mapped) + i * uniformBlockSize;
+		}
+	}
 
-	device->flushCommandBuffer(copyCmd, transferQueue, true);
+	// Joint palette
+	jointPalette.jointCount = 0;
+	for (Skin* skin : skins) {
+		// Joints without an inverse bind matrix use the identity
+		skin->inverseBindMatrices.resize(skin->joints.size(), glm::mat4(1.0f));
+		skin->jointOffset = jointPalette.jointCount;
+		jointPalette.jointCount += static_cast<uint32_t>(skin->joints.size());
+	}
+	if (jointPalette.jointCount > 0) {
+		jointPalette.frameCount = std::max(jointPaletteFrameCount, 1u);
+		jointPalette.frameSize = vks::tools::alignedVkSize(jointPalette.jointCount * sizeof(glm::mat4), device->m_vkPhysicalDeviceProperties.limits.minStorageBufferOffsetAlignment);
+		const VkDeviceSize bufferSize = jointPalette.frameCount * jointPalette.frameSize;
+		VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, bufferSize, &jointPalette.buffer.buffer, &jointPalette.buffer.memory));
+		VK_CHECK_RESULT(vkMapMemory(device->m_device, jointPalette.buffer.memory, 0, bufferSize, 0, reinterpret_cast<void**>(&jointPalette.mapped)));
+		jointPalette.buffer.descriptor = { jointPalette.buffer.buffer, 0, jointPalette.jointCount * sizeof(glm::mat4) };
+	}
 
-	vkDestroyBuffer(device->m_device, vertexStaging.buffer, nullptr);
-	vkFreeMemory(device->m_device, vertexStaging.memory, nullptr);
-	vkDestroyBuffer(device->m_device, indexStaging.buffer, nullptr);
-	vkFreeMemory(device->m_device, indexStaging.memory, nullptr);
+	// Initial pose
+	for (Node* node : nodes) {
+		node->update();
+	}
+	for (uint32_t i = 0; i < jointPalette.frameCount; i++) {
+		updateJointMatrices(i);
+	}
+}
 
-	getSceneDimensions();
+/*
+	Create the descriptor pool and the descriptor sets for the per-node uniform buffers, the joint palette and the per-material images
+*/
+void vkglTF::Model::setupDescriptors()
+{
+	createNodeBuffers();
 
-	// Setup descriptors
 	uint32_t uboCount{ 0 };
 	uint32_t imageCount{ 0 };
 	for (auto node : linearNodes) {
@@ -1378,6 +1780,20 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 		}
 	}
 
+	// Descriptor for the joint palette, with a dynamic offset selecting the frame
+	if (jointPalette.jointCount > 0) {
+		VkDescriptorPoolSize poolSize = vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1);
+		VkDescriptorPoolCreateInfo jointPoolCI = vks::initializers::descriptorPoolCreateInfo(1, &poolSize, 1);
+		VK_CHECK_RESULT(vkCreateDescriptorPool(device->m_device, &jointPoolCI, nullptr, &jointPalette.descriptorPool));
+		VkDescriptorSetLayoutBinding setLayoutBinding = vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 0);
+		VkDescriptorSetLayoutCreateInfo descriptorLayoutCI = vks::initializers::descriptorSetLayoutCreateInfo(&setLayoutBinding, 1);
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->m_device, &descriptorLayoutCI, nullptr, &jointPalette.descriptorSetLayout));
+		VkDescriptorSetAllocateInfo descriptorSetAI = vks::initializers::descriptorSetAllocateInfo(jointPalette.descriptorPool, &jointPalette.descriptorSetLayout, 1);
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(device->m_device, &descriptorSetAI, &jointPalette.descriptorSet));
+		VkWriteDescriptorSet writeDescriptorSet = vks::initializers::writeDescriptorSet(jointPalette.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 0, &jointPalette.buffer.descriptor);
+		vkUpdateDescriptorSets(device->m_device, 1, &writeDescriptorSet, 0, nullptr);
+	}
+
 	// Descriptors for per-material images
 	{
 		// Layout is global, so only create if it hasn't already been created before
@@ -1403,186 +1819,1488 @@ void vkglTF::Model::loadFromFile(std::string filename, vks::VulkanDevice *device
 	}
 }
 
-void vkglTF::Model::bindBuffers(VkCommandBuffer commandBuffer)
+/*
+	Write the per-material images through a descriptor manager, draw() with RenderFlags::BindImages then binds them with the manager's backend
+	Returns the layout of the material sets (owned by the manager), pipelines drawing the model need to use it for the image set
+*/
+VkDescriptorSetLayout vkglTF::Model::createMaterialDescriptors(vks::DescriptorManager& descriptorManager, uint32_t descriptorBindingFlags)
 {
-	const VkDeviceSize offsets[1] = {0};
-	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertices.buffer, offsets);
-	vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, VK_INDEX_TYPE_UINT32);
-	buffersBound = true;
+	std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+	if (descriptorBindingFlags & DescriptorBindingFlags::ImageBaseColor) {
+		setLayoutBindings.push_back(vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, static_cast<uint32_t>(setLayoutBindings.size())));
+	}
+	if (descriptorBindingFlags & DescriptorBindingFlags::ImageNormalMap) {
+		setLayoutBindings.push_back(vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, static_cast<uint32_t>(setLayoutBindings.size())));
+	}
+	VkDescriptorSetLayout layout = descriptorManager.createSetLayout(setLayoutBindings);
+	for (auto& material : materials) {
+		if (material.baseColorTexture != nullptr) {
+			material.createDescriptor(descriptorManager, layout, descriptorBindingFlags);
+		}
+	}
+	return layout;
 }
 
-void vkglTF::Model::drawNode(Node *node, VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet)
+/*
+	Build the CPU bounding volume hierarchy from the final vertex positions and indices, so it matches what's uploaded to the GPU
+	Vertices are transformed by their node's matrix unless they have been pre-transformed already, so the hierarchy is in model space
+	The triangles keep their order in the index buffer, so a hit's triangle index times three is the first index of the triangle
+*/
+void vkglTF::Model::buildBvh(BufferData positionStream, BufferData indexData)
 {
-	if (node->mesh) {
+	// Positions are the first member of the default vertex and the only member of the quantized position stream
+	const size_t positionStride = (vertexLayout == VertexLayout::Quantized) ? sizeof(glm::vec3) : sizeof(Vertex);
+	const uint8_t* positionData = static_cast<const uint8_t*>(positionStream.data);
+	const bool preTransformed = loadingFlags & FileLoadingFlags::PreTransformVertices;
+
+	std::vector<glm::vec3> positions(vertices.count);
+	for (uint32_t i = 0; i < vertices.count; i++) {
+		memcpy(&positions[i], positionData + i * positionStride, sizeof(glm::vec3));
+	}
+	// Only the primitives' own index ranges are added, levels of detail stored behind them in the index buffer would duplicate the geometry
+	// The gaps they leave are skipped, so the triangle list is compacted and the position of each triangle in the index buffer is kept separately
+	std::vector<uint32_t> triangleIndices;
+	std::vector<uint32_t> sourceTriangles;
+	for (Node* node : linearNodes) {
+		if (!node->mesh) {
+			continue;
+		}
+		const glm::mat4 matrix = preTransformed ? glm::mat4(1.0f) : node->getMatrix();
 		for (Primitive* primitive : node->mesh->primitives) {
-			bool skip = false;
-			const vkglTF::Material& material = primitive->material;
-			if (renderFlags & RenderFlags::RenderOpaqueNodes) {
-				skip = (material.alphaMode != Material::ALPHAMODE_OPAQUE);
-			}
-			if (renderFlags & RenderFlags::RenderAlphaMaskedNodes) {
-				skip = (material.alphaMode != Material::ALPHAMODE_MASK);
-			}
-			if (renderFlags & RenderFlags::RenderAlphaBlendedNodes) {
-				skip = (material.alphaMode != Material::ALPHAMODE_BLEND);
+			if (!preTransformed) {
+				for (uint32_t i = primitive->firstVertex; i < primitive->firstVertex + primitive->vertexCount; i++) {
+					positions[i] = glm::vec3(matrix * glm::vec4(positions[i], 1.0f));
+				}
 			}
-			if (!skip) {
-				if (renderFlags & RenderFlags::BindImages) {
-					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, bindImageSet, 1, &material.descriptorSet, 0, nullptr);
+			for (uint32_t i = primitive->firstIndex; i < primitive->firstIndex + primitive->indexCount; i++) {
+				const uint32_t index = (indices.type == VK_INDEX_TYPE_UINT16) ? static_cast<const uint16_t*>(indexData.data)[i] : static_cast<const uint32_t*>(indexData.data)[i];
+				// Optimized meshes store indices relative to the primitive's first vertex
+				triangleIndices.push_back(index + primitive->vertexOffset);
+				if (i % 3 == 0) {
+					sourceTriangles.push_back(i / 3);
 				}
-				vkCmdDrawIndexed(commandBuffer, primitive->indexCount, 1, primitive->firstIndex, 0, 0);
 			}
 		}
 	}
-	for (auto& child : node->children) {
-		drawNode(child, commandBuffer, renderFlags, pipelineLayout, bindImageSet);
+
+	vks::bvh::build(bvh, triangleIndices, &positions[0].x, sizeof(glm::vec3), positions.size());
+	// Point the triangle ids back at the triangles' positions in the index buffer
+	for (uint32_t& triangleId : bvh.triangleIds) {
+		triangleId = sourceTriangles[triangleId];
 	}
+	std::cout << "Built BVH with " << bvh.statistics.nodeCount << " nodes for " << bvh.statistics.triangleCount << " triangles in " << bvh.statistics.buildTime << " ms (SAH cost " << bvh.statistics.sahCost << ")" << std::endl;
 }
 
-void vkglTF::Model::draw(VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet)
+/*
+	Deduplicate vertices, reorder triangles for vertex cache efficiency and overdraw and reorder vertices for fetch locality
+	Primitives are optimized in parallel, the results are gathered into new vertex and index buffers with indices relative to each primitive's first vertex
+*/
+void vkglTF::Model::optimizeMeshes(std::vector<uint32_t>& indexBuffer, std::vector<Vertex>& vertexBuffer)
 {
-	if (!buffersBound) {
-		const VkDeviceSize offsets[1] = {0};
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertices.buffer, offsets);
-		vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+	std::vector<Primitive*> primitives;
+	for (Node* node : linearNodes) {
+		if (node->mesh) {
+			primitives.insert(primitives.end(), node->mesh->primitives.begin(), node->mesh->primitives.end());
+		}
 	}
-	for (auto& node : nodes) {
-		drawNode(node, commandBuffer, renderFlags, pipelineLayout, bindImageSet);
+
+	struct OptimizedPrimitive {
+		std::vector<uint32_t> indices;
+		std::vector<Vertex> vertices;
+	};
+	std::vector<OptimizedPrimitive> optimizedPrimitives(primitives.size());
+
+	vks::ThreadPool threadPool;
+	threadPool.setThreadCount(std::max(std::thread::hardware_concurrency(), 1u));
+	for (size_t i = 0; i < primitives.size(); i++) {
+		threadPool.threads[i % threadPool.threads.size()]->addJob([&, i] {
+			const Primitive* primitive = primitives[i];
+			OptimizedPrimitive& result = optimizedPrimitives[i];
+			result.indices.assign(indexBuffer.begin() + primitive->firstIndex, indexBuffer.begin() + primitive->firstIndex + primitive->indexCount);
+			for (uint32_t& index : result.indices) {
+				index -= primitive->firstVertex;
+			}
+			const Vertex* vertices = &vertexBuffer[primitive->firstVertex];
+			std::vector<uint32_t> remap;
+			// Bitwise identical vertices are merged, unreferenced vertices are dropped
+			const size_t uniqueCount = vks::meshoptimizer::generateVertexRemap(remap, result.indices, vertices, primitive->vertexCount, sizeof(Vertex));
+			std::vector<Vertex> uniqueVertices(uniqueCount);
+			vks::meshoptimizer::remapIndices(result.indices, remap);
+			vks::meshoptimizer::remapVertices(uniqueVertices.data(), vertices, primitive->vertexCount, sizeof(Vertex), remap);
+			vks::meshoptimizer::optimizeVertexCache(result.indices, uniqueCount);
+			vks::meshoptimizer::optimizeOverdraw(result.indices, &uniqueVertices[0].pos.x, sizeof(Vertex), uniqueCount, overdrawThreshold);
+			// Vertices are stored in the order they are first referenced by the final triangle order
+			vks::meshoptimizer::generateVertexFetchRemap(remap, result.indices, uniqueCount);
+			result.vertices.resize(uniqueCount);
+			vks::meshoptimizer::remapIndices(result.indices, remap);
+			vks::meshoptimizer::remapVertices(result.vertices.data(), uniqueVertices.data(), uniqueCount, sizeof(Vertex), remap);
+		});
+	}
+	threadPool.wait();
+
+	indexBuffer.clear();
+	vertexBuffer.clear();
+	indices.type = VK_INDEX_TYPE_UINT16;
+	for (size_t i = 0; i < primitives.size(); i++) {
+		Primitive* primitive = primitives[i];
+		const OptimizedPrimitive& result = optimizedPrimitives[i];
+		primitive->firstIndex = static_cast<uint32_t>(indexBuffer.size());
+		primitive->indexCount = static_cast<uint32_t>(result.indices.size());
+		primitive->firstVertex = static_cast<uint32_t>(vertexBuffer.size());
+		primitive->vertexCount = static_cast<uint32_t>(result.vertices.size());
+		primitive->vertexOffset = static_cast<int32_t>(primitive->firstVertex);
+		if (result.vertices.size() > 65536) {
+			indices.type = VK_INDEX_TYPE_UINT32;
+		}
+		indexBuffer.insert(indexBuffer.end(), result.indices.begin(), result.indices.end());
+		vertexBuffer.insert(vertexBuffer.end(), result.vertices.begin(), result.vertices.end());
 	}
 }
 
-void vkglTF::Model::getNodeDimensions(Node *node, glm::vec3 &min, glm::vec3 &max)
+/*
+	Generate a chain of simplified index lists per primitive that reference the primitive's vertices
+	Primitives are simplified in parallel, the levels are appended to the index buffer using the same vertex offset as the primitive
+*/
+void vkglTF::Model::generateLods(std::vector<uint32_t>& indexBuffer, const std::vector<Vertex>& vertexBuffer)
 {
-	if (node->mesh) {
-		for (Primitive *primitive : node->mesh->primitives) {
-			glm::vec4 locMin = glm::vec4(primitive->dimensions.min, 1.0f) * node->getMatrix();
-			glm::vec4 locMax = glm::vec4(primitive->dimensions.max, 1.0f) * node->getMatrix();
-			if (locMin.x < min.x) { min.x = locMin.x; }
-			if (locMin.y < min.y) { min.y = locMin.y; }
-			if (locMin.z < min.z) { min.z = locMin.z; }
-			if (locMax.x > max.x) { max.x = locMax.x; }
-			if (locMax.y > max.y) { max.y = locMax.y; }
-			if (locMax.z > max.z) { max.z = locMax.z; }
+	std::vector<Primitive*> primitives;
+	for (Node* node : linearNodes) {
+		if (node->mesh) {
+			primitives.insert(primitives.end(), node->mesh->primitives.begin(), node->mesh->primitives.end());
 		}
 	}
-	for (auto child : node->children) {
-		getNodeDimensions(child, min, max);
-	}
-}
 
-void vkglTF::Model::getSceneDimensions()
-{
-	dimensions.min = glm::vec3(FLT_MAX);
-	dimensions.max = glm::vec3(-FLT_MAX);
-	for (auto node : nodes) {
-		getNodeDimensions(node, dimensions.min, dimensions.max);
+	struct PrimitiveLods {
+		std::vector<std::vector<uint32_t>> indices;
+		std::vector<float> errors;
+	};
+	std::vector<PrimitiveLods> primitiveLods(primitives.size());
+
+	vks::ThreadPool threadPool;
+	threadPool.setThreadCount(std::max(std::thread::hardware_concurrency(), 1u));
+	for (size_t i = 0; i < primitives.size(); i++) {
+		threadPool.threads[i % threadPool.threads.size()]->addJob([&, i] {
+			const Primitive* primitive = primitives[i];
+			PrimitiveLods& result = primitiveLods[i];
+			// Indices are made relative to the primitive's first vertex, optimized meshes already store them that way
+			const uint32_t indexBase = primitive->firstVertex - primitive->vertexOffset;
+			std::vector<uint32_t> sourceIndices(indexBuffer.begin() + primitive->firstIndex, indexBuffer.begin() + primitive->firstIndex + primitive->indexCount);
+			for (uint32_t& index : sourceIndices) {
+				index -= indexBase;
+			}
+			const Vertex* vertices = &vertexBuffer[primitive->firstVertex];
+			float error = 0.0f;
+			size_t previousCount = sourceIndices.size();
+			for (uint32_t level = 1; level < lodCount; level++) {
+				// Every level is simplified from the full detail mesh, so errors don't accumulate across levels
+				std::vector<uint32_t> lodIndices = sourceIndices;
+				const size_t targetCount = static_cast<size_t>(static_cast<float>(sourceIndices.size()) * std::pow(lodReduction, static_cast<float>(level))) / 3 * 3;
+				// Normal and texture coordinate are adjacent in the vertex, so they are passed as one attribute range
+				const float lodError = vks::meshoptimizer::simplify(lodIndices, &vertices[0].pos.x, sizeof(Vertex), primitive->vertexCount, targetCount, lodMaxError,
+					&vertices[0].normal.x, sizeof(Vertex), 5, lodAttributeWeight);
+				// Stop once the simplification can't remove a meaningful number of triangles anymore
+				if (lodIndices.empty() || (lodIndices.size() > previousCount * 9 / 10)) {
+					break;
+				}
+				vks::meshoptimizer::optimizeVertexCache(lodIndices, primitive->vertexCount);
+				for (uint32_t& index : lodIndices) {
+					index += indexBase;
+				}
+				error = std::max(error, lodError);
+				previousCount = lodIndices.size();
+				result.indices.push_back(std::move(lodIndices));
+				result.errors.push_back(error);
+			}
+		});
+	}
+	threadPool.wait();
+
+	for (size_t i = 0; i < primitives.size(); i++) {
+		Primitive* primitive = primitives[i];
+		const PrimitiveLods& result = primitiveLods[i];
+		primitive->lods.clear();
+		primitive->lods.push_back({ primitive->firstIndex, primitive->indexCount, 0.0f });
+		for (size_t level = 0; level < result.indices.size(); level++) {
+			primitive->lods.push_back({ static_cast<uint32_t>(indexBuffer.size()), static_cast<uint32_t>(result.indices[level].size()), result.errors[level] });
+			indexBuffer.insert(indexBuffer.end(), result.indices[level].begin(), result.indices[level].end());
+		}
 	}
-	dimensions.size = dimensions.max - dimensions.min;
-	dimensions.center = (dimensions.min + dimensions.max) / 2.0f;
-	dimensions.radius = glm::distance(dimensions.min, dimensions.max) / 2.0f;
 }
 
-void vkglTF::Model::updateAnimation(uint32_t index, float time)
+/*
+	Partition all primitives into meshlets and compute their culling bounds
+	Primitives are processed in parallel, the results are reused from a cache file next to the glTF file if the source data didn't change
+*/
+void vkglTF::Model::buildMeshlets(const std::string& filename, const std::vector<uint32_t>& indexBuffer, const std::vector<Vertex>& vertexBuffer, bool clockwise)
 {
-	if (index > static_cast<uint32_t>(animations.size()) - 1) {
-		std::cout << "No animation with index " << index << std::endl;
-		return;
+	std::vector<Primitive*> primitives;
+	for (Node* node : linearNodes) {
+		if (node->mesh) {
+			primitives.insert(primitives.end(), node->mesh->primitives.begin(), node->mesh->primitives.end());
+		}
 	}
-	Animation &animation = animations[index];
 
-	bool updated = false;
-	for (auto& channel : animation.channels) {
-		vkglTF::AnimationSampler &sampler = animation.samplers[channel.samplerIndex];
-		if (sampler.inputs.size() > sampler.outputsVec4.size()) {
-			continue;
+	// The cache is keyed by the final vertex and index data, so it also depends on all loading flags that change them
+	uint64_t sourceHash = 14695981039346656037ull;
+	auto hashData = [&sourceHash](const void* data, size_t size) {
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i++) {
+			sourceHash = (sourceHash ^ bytes[i]) * 1099511628211ull;
 		}
+	};
+	const uint32_t settings[3] = { meshletMaxVertices, meshletMaxTriangles, clockwise ? 1u : 0u };
+	hashData(settings, sizeof(settings));
+	hashData(indexBuffer.data(), indexBuffer.size() * sizeof(uint32_t));
+	hashData(vertexBuffer.data(), vertexBuffer.size() * sizeof(Vertex));
+	const std::string cacheFilename = filename + ".meshlets";
+	if (meshletCache && loadMeshletCache(cacheFilename, sourceHash, primitives)) {
+		return;
+	}
 
-		for (auto i = 0; i < sampler.inputs.size() - 1; i++) {
-			if ((time >= sampler.inputs[i]) && (time <= sampler.inputs[i + 1])) {
-				float u = std::max(0.0f, time - sampler.inputs[i]) / (sampler.inputs[i + 1] - sampler.inputs[i]);
-				if (u <= 1.0f) {
-					switch (channel.path) {
-					case vkglTF::AnimationChannel::PathType::TRANSLATION: {
-						glm::vec4 trans = glm::mix(sampler.outputsVec4[i], sampler.outputsVec4[i + 1], u);
-						channel.node->translation = glm::vec3(trans);
-						break;
-					}
-					case vkglTF::AnimationChannel::PathType::SCALE: {
-						glm::vec4 trans = glm::mix(sampler.outputsVec4[i], sampler.outputsVec4[i + 1], u);
-						channel.node->scale = glm::vec3(trans);
-						break;
-					}
-					case vkglTF::AnimationChannel::PathType::ROTATION: {
-						glm::quat q1;
-						q1.x = sampler.outputsVec4[i].x;
-						q1.y = sampler.outputsVec4[i].y;
-						q1.z = sampler.outputsVec4[i].z;
-						q1.w = sampler.outputsVec4[i].w;
-						glm::quat q2;
-						q2.x = sampler.outputsVec4[i + 1].x;
-						q2.y = sampler.outputsVec4[i + 1].y;
-						q2.z = sampler.outputsVec4[i + 1].z;
-						q2.w = sampler.outputsVec4[i + 1].w;
-						channel.node->rotation = glm::normalize(glm::slerp(q1, q2, u));
-						break;
-					}
-					}
-					updated = true;
-				}
+	struct PrimitiveMeshlets {
+		std::vector<vks::meshoptimizer::Meshlet> meshlets;
+		std::vector<vks::meshoptimizer::MeshletBounds> bounds;
+		std::vector<uint32_t> vertices;
+		std::vector<uint8_t> triangles;
+	};
+	std::vector<PrimitiveMeshlets> primitiveMeshlets(primitives.size());
+
+	vks::ThreadPool threadPool;
+	threadPool.setThreadCount(std::max(std::thread::hardware_concurrency(), 1u));
+	for (size_t i = 0; i < primitives.size(); i++) {
+		threadPool.threads[i % threadPool.threads.size()]->addJob([&, i] {
+			const Primitive* primitive = primitives[i];
+			PrimitiveMeshlets& result = primitiveMeshlets[i];
+			const uint32_t indexBase = primitive->firstVertex - primitive->vertexOffset;
+			std::vector<uint32_t> primitiveIndices(indexBuffer.begin() + primitive->firstIndex, indexBuffer.begin() + primitive->firstIndex + primitive->indexCount);
+			for (uint32_t& index : primitiveIndices) {
+				index -= indexBase;
 			}
-		}
+			const float* positions = &vertexBuffer[primitive->firstVertex].pos.x;
+			vks::meshoptimizer::buildMeshlets(result.meshlets, result.vertices, result.triangles, primitiveIndices, positions, sizeof(Vertex), primitive->vertexCount, meshletMaxVertices, meshletMaxTriangles);
+			result.bounds.resize(result.meshlets.size());
+			for (size_t m = 0; m < result.meshlets.size(); m++) {
+				result.bounds[m] = vks::meshoptimizer::computeMeshletBounds(result.meshlets[m], result.vertices, result.triangles, positions, sizeof(Vertex), clockwise);
+			}
+		});
 	}
-	if (updated) {
-		for (auto &node : nodes) {
-			node->update();
+	threadPool.wait();
+
+	meshlets.meshlets.clear();
+	meshlets.bounds.clear();
+	meshlets.vertices.clear();
+	meshlets.triangles.clear();
+	for (size_t i = 0; i < primitives.size(); i++) {
+		Primitive* primitive = primitives[i];
+		const PrimitiveMeshlets& result = primitiveMeshlets[i];
+		primitive->firstMeshlet = static_cast<uint32_t>(meshlets.meshlets.size());
+		primitive->meshletCount = static_cast<uint32_t>(result.meshlets.size());
+		for (vks::meshoptimizer::Meshlet meshlet : result.meshlets) {
+			meshlet.vertexOffset += static_cast<uint32_t>(meshlets.vertices.size());
+			meshlet.triangleOffset += static_cast<uint32_t>(meshlets.triangles.size());
+			meshlets.meshlets.push_back(meshlet);
+		}
+		meshlets.bounds.insert(meshlets.bounds.end(), result.bounds.begin(), result.bounds.end());
+		for (uint32_t vertex : result.vertices) {
+			meshlets.vertices.push_back(vertex + primitive->firstVertex);
+		}
+		for (size_t t = 0; t < result.triangles.size(); t += 3) {
+			meshlets.triangles.push_back(result.triangles[t] | (result.triangles[t + 1] << 8) | (result.triangles[t + 2] << 16));
 		}
 	}
+
+	if (meshletCache) {
+		saveMeshletCache(cacheFilename, sourceHash, primitives);
+	}
+}
+
+namespace
+{
+	struct MeshletCacheHeader {
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceHash;
+		uint32_t primitiveCount;
+		uint32_t meshletCount;
+		uint32_t vertexCount;
+		uint32_t triangleCount;
+	};
+	const char meshletCacheMagic[4] = { 'V', 'K', 'M', 'L' };
+	const uint32_t meshletCacheVersion = 1;
 }
 
 /*
-	Helper functions
+	Read the meshlets of all primitives from a cache file, fails if the file doesn't exist, is outdated or doesn't match the source data
 */
-vkglTF::Node* vkglTF::Model::findNode(Node *parent, uint32_t index) {
-	Node* nodeFound = nullptr;
-	if (parent->index == index) {
-		return parent;
+bool vkglTF::Model::loadMeshletCache(const std::string& filename, uint64_t sourceHash, const std::vector<Primitive*>& primitives)
+{
+#if defined(__ANDROID__)
+	// Assets are read only on Android
+	return false;
+#else
+	std::ifstream file(filename, std::ios::binary);
+	if (!file.is_open()) {
+		return false;
 	}
-	for (auto& child : parent->children) {
-		nodeFound = findNode(child, index);
-		if (nodeFound) {
-			break;
-		}
+	MeshletCacheHeader header{};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || (memcmp(header.magic, meshletCacheMagic, sizeof(header.magic)) != 0) || (header.version != meshletCacheVersion) || (header.sourceHash != sourceHash) || (header.primitiveCount != primitives.size())) {
+		return false;
 	}
-	return nodeFound;
+	std::vector<uint32_t> ranges(header.primitiveCount * 2);
+	meshlets.meshlets.resize(header.meshletCount);
+	meshlets.bounds.resize(header.meshletCount);
+	meshlets.vertices.resize(header.vertexCount);
+	meshlets.triangles.resize(header.triangleCount);
+	file.read(reinterpret_cast<char*>(ranges.data()), ranges.size() * sizeof(uint32_t));
+	file.read(reinterpret_cast<char*>(meshlets.meshlets.data()), meshlets.meshlets.size() * sizeof(vks::meshoptimizer::Meshlet));
+	file.read(reinterpret_cast<char*>(meshlets.bounds.data()), meshlets.bounds.size() * sizeof(vks::meshoptimizer::MeshletBounds));
+	file.read(reinterpret_cast<char*>(meshlets.vertices.data()), meshlets.vertices.size() * sizeof(uint32_t));
+	file.read(reinterpret_cast<char*>(meshlets.triangles.data()), meshlets.triangles.size() * sizeof(uint32_t));
+	if (!file) {
+		meshlets.meshlets.clear();
+		meshlets.bounds.clear();
+		meshlets.vertices.clear();
+		meshlets.triangles.clear();
+		return false;
+	}
+	for (size_t i = 0; i < primitives.size(); i++) {
+		primitives[i]->firstMeshlet = ranges[i * 2 + 0];
+		primitives[i]->meshletCount = ranges[i * 2 + 1];
+	}
+	return true;
+#endif
 }
 
-vkglTF::Node* vkglTF::Model::nodeFromIndex(uint32_t index) {
-	Node* nodeFound = nullptr;
-	for (auto &node : nodes) {
-		nodeFound = findNode(node, index);
-		if (nodeFound) {
-			break;
-		}
+/*
+	Write the meshlets of all primitives to a cache file, failing to write the file (e.g. for read only asset folders) is not an error
+*/
+void vkglTF::Model::saveMeshletCache(const std::string& filename, uint64_t sourceHash, const std::vector<Primitive*>& primitives)
+{
+#if !defined(__ANDROID__)
+	std::ofstream file(filename, std::ios::binary);
+	if (!file.is_open()) {
+		return;
 	}
-	return nodeFound;
+	MeshletCacheHeader header{};
+	memcpy(header.magic, meshletCacheMagic, sizeof(header.magic));
+	header.version = meshletCacheVersion;
+	header.sourceHash = sourceHash;
+	header.primitiveCount = static_cast<uint32_t>(primitives.size());
+	header.meshletCount = static_cast<uint32_t>(meshlets.meshlets.size());
+	header.vertexCount = static_cast<uint32_t>(meshlets.vertices.size());
+	header.triangleCount = static_cast<uint32_t>(meshlets.triangles.size());
+	std::vector<uint32_t> ranges;
+	for (const Primitive* primitive : primitives) {
+		ranges.push_back(primitive->firstMeshlet);
+		ranges.push_back(primitive->meshletCount);
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(ranges.data()), ranges.size() * sizeof(uint32_t));
+	file.write(reinterpret_cast<const char*>(meshlets.meshlets.data()), meshlets.meshlets.size() * sizeof(vks::meshoptimizer::Meshlet));
+	file.write(reinterpret_cast<const char*>(meshlets.bounds.data()), meshlets.bounds.size() * sizeof(vks::meshoptimizer::MeshletBounds));
+	file.write(reinterpret_cast<const char*>(meshlets.vertices.data()), meshlets.vertices.size() * sizeof(uint32_t));
+	file.write(reinterpret_cast<const char*>(meshlets.triangles.data()), meshlets.triangles.size() * sizeof(uint32_t));
+#endif
 }
 
-void vkglTF::Model::prepareNodeDescriptor(vkglTF::Node* node, VkDescriptorSetLayout descriptorSetLayout) {
-	if (node->mesh) {
-		VkDescriptorSetAllocateInfo descriptorSetAllocInfo{};
-		descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		descriptorSetAllocInfo.descriptorPool = descriptorPool;
-		descriptorSetAllocInfo.pSetLayouts = &descriptorSetLayout;
-		descriptorSetAllocInfo.descriptorSetCount = 1;
-		VK_CHECK_RESULT(vkAllocateDescriptorSets(device->m_device, &descriptorSetAllocInfo, &node->mesh->uniformBuffer.descriptorSet));
+namespace
+{
+	const char sceneCacheMagic[4] = { 'V', 'K', 'S', 'C' };
+	// Has to be increased whenever the layout of the cache or of one of the structures stored in it changes
+	const uint32_t sceneCacheVersion = 2;
+	// All blobs start at a multiple of this, so they can be copied out of the mapped file with aligned loads
+	const uint64_t sceneCacheAlignment = 64;
+
+	struct SceneCacheHeader {
+		char magic[4];
+		uint32_t version;
+		uint64_t key;
+		uint64_t fileSize;
+		// Blob with the scene description, all other blobs are referenced from it
+		uint64_t sceneOffset;
+		uint64_t sceneSize;
+	};
 
-		VkWriteDescriptorSet writeDescriptorSet{};
-		writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		writeDescriptorSet.descriptorCount = 1;
-		writeDescriptorSet.dstSet = node->mesh->uniformBuffer.descriptorSet;
-		writeDescriptorSet.dstBinding = 0;
-		writeDescriptorSet.pBufferInfo = &node->mesh->uniformBuffer.descriptor;
+	struct SceneCacheBlob {
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	struct SceneCacheTexture {
+		uint32_t format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t texelBlockSize;
+		// All mip levels, the offsets of the levels are stored after the texture
+		SceneCacheBlob data;
+	};
+
+	struct SceneCacheMaterial {
+		glm::vec4 baseColorFactor;
+		uint32_t alphaMode;
+		float alphaCutoff;
+		float metallicFactor;
+		float roughnessFactor;
+		// Indices into the textures of the model, -1 for no texture and -2 for the empty texture
+		int32_t baseColorTexture;
+		int32_t metallicRoughnessTexture;
+		int32_t normalTexture;
+		int32_t occlusionTexture;
+		int32_t emissiveTexture;
+	};
+
+	// Nodes are stored in the order of the linear node list and reference each other by their position in that list
+	struct SceneCacheNode {
+		glm::mat4 matrix;
+		glm::quat rotation;
+		glm::vec3 translation;
+		glm::vec3 scale;
+		int32_t parent;
+		uint32_t index;
+		int32_t skinIndex;
+		// -1 for nodes without a mesh
+		int32_t primitiveCount;
+	};
+
+	struct SceneCachePrimitive {
+		glm::vec3 min;
+		glm::vec3 max;
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		uint32_t firstVertex;
+		uint32_t vertexCount;
+		int32_t vertexOffset;
+		uint32_t material;
+		uint32_t firstMeshlet;
+		uint32_t meshletCount;
+	};
+
+	struct SceneCacheChannel {
+		uint32_t path;
+		uint32_t node;
+		uint32_t samplerIndex;
+	};
+
+	/*
+		Writes blobs straight to the cache file and collects the scene description in memory
+	*/
+	class SceneCacheWriter
+	{
+	public:
+		std::ofstream file;
+		std::vector<uint8_t> scene;
+
+		template<typename T>
+		void write(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			append(&value, sizeof(T));
+		}
+
+		template<typename T>
+		void write(const std::vector<T>& values)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			write(static_cast<uint64_t>(values.size()));
+			append(values.data(), values.size() * sizeof(T));
+		}
+
+		void write(const std::string& value)
+		{
+			write(static_cast<uint64_t>(value.size()));
+			append(value.data(), value.size());
+		}
+
+		SceneCacheBlob writeBlob(const void* data, uint64_t size)
+		{
+			const uint64_t offset = static_cast<uint64_t>(file.tellp());
+			const uint64_t padding = (sceneCacheAlignment - offset % sceneCacheAlignment) % sceneCacheAlignment;
+			const char zeros[sceneCacheAlignment]{};
+			file.write(zeros, padding);
+			file.write(static_cast<const char*>(data), size);
+			return { offset + padding, size };
+		}
+
+	private:
+		void append(const void* data, size_t size)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			scene.insert(scene.end(), bytes, bytes + size);
+		}
+	};
+
+	/*
+		Reads the scene description from the mapped cache file, all reads are bounds checked and invalidate the reader on failure
+	*/
+	class SceneCacheReader
+	{
+	public:
+		bool valid = true;
+
+		SceneCacheReader(const MappedFile& file, const SceneCacheBlob& sceneBlob) : file(file)
+		{
+			cursor = blob(sceneBlob);
+			end = cursor ? cursor + sceneBlob.size : nullptr;
+		}
+
+		template<typename T>
+		T read()
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			T value{};
+			copy(&value, sizeof(T));
+			return value;
+		}
+
+		template<typename T>
+		void read(std::vector<T>& values)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			const uint64_t count = read<uint64_t>();
+			if (!valid || (count > remaining() / sizeof(T))) {
+				valid = false;
+				return;
+			}
+			values.resize(count);
+			copy(values.data(), count * sizeof(T));
+		}
+
+		void read(std::string& value)
+		{
+			const uint64_t length = read<uint64_t>();
+			if (!valid || (length > remaining())) {
+				valid = false;
+				return;
+			}
+			value.assign(reinterpret_cast<const char*>(cursor), length);
+			cursor += length;
+		}
+
+		/** @brief Reads an element count, every element takes up at least one byte, so larger counts can only come from a corrupted file */
+		uint32_t readCount()
+		{
+			const uint32_t count = read<uint32_t>();
+			if (count > remaining()) {
+				valid = false;
+				return 0;
+			}
+			return count;
+		}
+
+		/** @brief Returns a pointer to the data of a blob inside the mapped file */
+		const uint8_t* blob(const SceneCacheBlob& blob)
+		{
+			if ((blob.offset % sceneCacheAlignment != 0) || (blob.offset > file.size) || (blob.size > file.size - blob.offset)) {
+				valid = false;
+				return nullptr;
+			}
+			return file.data + blob.offset;
+		}
+
+	private:
+		const MappedFile& file;
+		const uint8_t* cursor = nullptr;
+		const uint8_t* end = nullptr;
+
+		size_t remaining() const
+		{
+			return valid ? static_cast<size_t>(end - cursor) : 0;
+		}
+
+		void copy(void* dst, size_t size)
+		{
+			if (size > remaining()) {
+				valid = false;
+				return;
+			}
+			memcpy(dst, cursor, size);
+			cursor += size;
+		}
+	};
+
+	/*
+		Generate the complete mip chain of an RGBA8 image with a 2x2 box filter, the levels are tightly packed one after another
+	*/
+	void generateMipChain(const uint8_t* rgba, uint32_t width, uint32_t height, std::vector<uint8_t>& mipChain, std::vector<uint64_t>& levelOffsets)
+	{
+		const uint32_t mipLevels = static_cast<uint32_t>(floor(log2(std::max(width, height))) + 1.0);
+		mipChain.assign(rgba, rgba + static_cast<size_t>(width) * height * 4);
+		levelOffsets = { 0 };
+		for (uint32_t level = 1; level < mipLevels; level++) {
+			const uint32_t srcWidth = std::max(1u, width >> (level - 1));
+			const uint32_t srcHeight = std::max(1u, height >> (level - 1));
+			const uint32_t dstWidth = std::max(1u, width >> level);
+			const uint32_t dstHeight = std::max(1u, height >> level);
+			const uint64_t srcOffset = levelOffsets.back();
+			levelOffsets.push_back(mipChain.size());
+			mipChain.resize(mipChain.size() + static_cast<size_t>(dstWidth) * dstHeight * 4);
+			const uint8_t* src = mipChain.data() + srcOffset;
+			uint8_t* dst = mipChain.data() + levelOffsets.back();
+			for (uint32_t y = 0; y < dstHeight; y++) {
+				const uint32_t y0 = std::min(y * 2, srcHeight - 1);
+				const uint32_t y1 = std::min(y * 2 + 1, srcHeight - 1);
+				for (uint32_t x = 0; x < dstWidth; x++) {
+					const uint32_t x0 = std::min(x * 2, srcWidth - 1);
+					const uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+					for (uint32_t c = 0; c < 4; c++) {
+						const uint32_t sum = src[(y0 * srcWidth + x0) * 4 + c] + src[(y0 * srcWidth + x1) * 4 + c] + src[(y1 * srcWidth + x0) * 4 + c] + src[(y1 * srcWidth + x1) * 4 + c];
+						dst[(y * dstWidth + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+					}
+				}
+			}
+		}
+	}
+}
+
+/*
+	Key of the scene cache, combines the glTF file, the contents of all files it references and all settings that change the loaded data
+*/
+uint64_t vkglTF::Model::sceneCacheKey(const std::string& filename, float scale) const
+{
+#if defined(__ANDROID__)
+	return 0;
+#else
+	uint64_t key = 14695981039346656037ull;
+	// FNV-1a, bulk data is consumed eight bytes at a time, as all referenced files are hashed completely on every load
+	auto hashData = [&key](const void* data, size_t size) {
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+			uint64_t word;
+			memcpy(&word, bytes + i, sizeof(word));
+			key = (key ^ word) * 1099511628211ull;
+			key ^= key >> 32;
+		}
+		for (; i < size; i++) {
+			key = (key ^ bytes[i]) * 1099511628211ull;
+		}
+	};
+	// Modification times aren't used, as copying or checking out an asset pack changes them without changing the data
+	auto hashFile = [&hashData](const uint8_t* data, size_t size) {
+		const uint64_t hashedSize = size;
+		hashData(&hashedSize, sizeof(hashedSize));
+		hashData(data, size);
+	};
+	const uint32_t settings[6] = { sceneCacheVersion, loadingFlags, lodCount, meshletMaxVertices, meshletMaxTriangles, static_cast<uint32_t>(sizeof(Vertex)) };
+	const float factors[6] = { scale, overdrawThreshold, lodReduction, lodMaxError, lodAttributeWeight, 0.0f };
+	hashData(settings, sizeof(settings));
+	hashData(factors, sizeof(factors));
+
+	MappedFile file;
+	if (!file.open(filename)) {
+		return 0;
+	}
+	// The whole file is hashed, for binary files this includes the binary chunk
+	hashFile(file.data, file.size);
+	std::string source;
+	if (isBinaryglTF(filename)) {
+		uint32_t header[5]{};
+		if (file.size >= sizeof(header)) {
+			memcpy(header, file.data, sizeof(header));
+			if (header[3] <= file.size - sizeof(header)) {
+				source.assign(reinterpret_cast<const char*>(file.data) + sizeof(header), header[3]);
+			}
+		}
+	} else {
+		source.assign(reinterpret_cast<const char*>(file.data), file.size);
+	}
+
+	size_t pos = 0;
+	while ((pos = source.find("\"uri\"", pos)) != std::string::npos) {
+		const size_t begin = source.find('"', pos + 5);
+		const size_t end = (begin != std::string::npos) ? source.find('"', begin + 1) : std::string::npos;
+		if (end == std::string::npos) {
+			break;
+		}
+		const std::string uri = source.substr(begin + 1, end - begin - 1);
+		pos = end + 1;
+		// Embedded data is already part of the glTF file
+		if (uri.rfind("data:", 0) == 0) {
+			continue;
+		}
+		MappedFile resourceFile;
+		if (!resourceFile.open((std::filesystem::path(path) / tinygltf::dlib::urldecode(uri)).string())) {
+			// Missing files still change the key, so the cache is rebuilt once they appear
+			const uint64_t missing = ~0ull;
+			hashData(&missing, sizeof(missing));
+			continue;
+		}
+		hashFile(resourceFile.data, resourceFile.size);
+	}
+	return key;
+#endif
+}
+
+/*
+	Restore the whole scene from the cache file, the vertex, index and texture data is copied from the mapped file straight into staging memory
+	Fails without creating any resources if the file doesn't exist, is outdated, doesn't match the key or is damaged
+*/
+bool vkglTF::Model::loadSceneCache(const std::string& filename, uint64_t key, VkQueue transferQueue)
+{
+#if defined(__ANDROID__)
+	// Assets are read only on Android
+	return false;
+#else
+	MappedFile file;
+	if (!file.open(filename) || (file.size < sizeof(SceneCacheHeader))) {
+		return false;
+	}
+	SceneCacheHeader header{};
+	memcpy(&header, file.data, sizeof(header));
+	if ((memcmp(header.magic, sceneCacheMagic, sizeof(header.magic)) != 0) || (header.version != sceneCacheVersion) || (header.key != key) || (header.fileSize != file.size)) {
+		return false;
+	}
+
+	SceneCacheReader reader(file, { header.sceneOffset, header.sceneSize });
+
+	// Geometry
+	const uint32_t vertexCount = reader.read<uint32_t>();
+	const uint32_t indexCount = reader.read<uint32_t>();
+	const VkIndexType indexType = static_cast<VkIndexType>(reader.read<uint32_t>());
+	const bool metallicRoughness = reader.read<uint32_t>() != 0;
+	std::vector<BufferData> vertexStreams(std::min(reader.read<uint32_t>(), 3u));
+	for (BufferData& vertexStream : vertexStreams) {
+		const SceneCacheBlob blob = reader.read<SceneCacheBlob>();
+		vertexStream = { reader.blob(blob), blob.size };
+	}
+	const SceneCacheBlob indexBlob = reader.read<SceneCacheBlob>();
+	const BufferData indexData{ reader.blob(indexBlob), indexBlob.size };
+	Meshlets cachedMeshlets;
+	reader.read(cachedMeshlets.meshlets);
+	reader.read(cachedMeshlets.bounds);
+	reader.read(cachedMeshlets.vertices);
+	reader.read(cachedMeshlets.triangles);
+
+	// Textures
+	struct TextureRecord {
+		SceneCacheTexture texture;
+		std::vector<uint64_t> levelOffsets;
+		const uint8_t* data;
+	};
+	std::vector<TextureRecord> textureRecords(reader.readCount());
+	for (TextureRecord& record : textureRecords) {
+		record.texture = reader.read<SceneCacheTexture>();
+		reader.read(record.levelOffsets);
+		record.data = reader.blob(record.texture.data);
+		for (uint64_t levelOffset : record.levelOffsets) {
+			reader.valid &= (levelOffset < record.texture.data.size);
+		}
+		reader.valid &= !record.levelOffsets.empty() && (record.texture.texelBlockSize > 0);
+	}
+
+	// Materials
+	std::vector<SceneCacheMaterial> materialRecords;
+	reader.read(materialRecords);
+	for (const SceneCacheMaterial& record : materialRecords) {
+		for (int32_t textureIndex : { record.baseColorTexture, record.metallicRoughnessTexture, record.normalTexture, record.occlusionTexture, record.emissiveTexture }) {
+			reader.valid &= (textureIndex >= -2) && (textureIndex < static_cast<int32_t>(textureRecords.size()));
+		}
+	}
+
+	// Nodes
+	struct NodeRecord {
+		SceneCacheNode node;
+		std::string name;
+		std::string meshName;
+		std::vector<SceneCachePrimitive> primitives;
+		std::vector<std::vector<Primitive::Lod>> lods;
+	};
+	std::vector<NodeRecord> nodeRecords(reader.readCount());
+	for (NodeRecord& record : nodeRecords) {
+		record.node = reader.read<SceneCacheNode>();
+		reader.read(record.name);
+		if (record.node.primitiveCount < 0) {
+			continue;
+		}
+		reader.read(record.meshName);
+		reader.read(record.primitives);
+		reader.valid &= (record.primitives.size() == static_cast<size_t>(record.node.primitiveCount));
+		record.lods.resize(record.primitives.size());
+		for (size_t i = 0; i < record.primitives.size(); i++) {
+			const SceneCachePrimitive& primitive = record.primitives[i];
+			reader.read(record.lods[i]);
+			reader.valid &= (primitive.material < materialRecords.size()) && (primitive.firstIndex + uint64_t(primitive.indexCount) <= indexCount) && (primitive.firstVertex + uint64_t(primitive.vertexCount) <= vertexCount);
+		}
+	}
+	for (size_t i = 0; i < nodeRecords.size(); i++) {
+		// Children are added to the linear node list before their parent
+		const int32_t parent = nodeRecords[i].node.parent;
+		reader.valid &= (parent == -1) || ((parent > static_cast<int32_t>(i)) && (parent < static_cast<int32_t>(nodeRecords.size())));
+	}
+
+	// Skins
+	struct SkinRecord {
+		std::string name;
+		int32_t skeletonRoot;
+		std::vector<int32_t> joints;
+		std::vector<glm::mat4> inverseBindMatrices;
+	};
+	std::vector<SkinRecord> skinRecords(reader.readCount());
+	for (SkinRecord& record : skinRecords) {
+		reader.read(record.name);
+		record.skeletonRoot = reader.read<int32_t>();
+		reader.read(record.joints);
+		reader.read(record.inverseBindMatrices);
+		for (int32_t nodeIndex : record.joints) {
+			reader.valid &= (nodeIndex >= 0) && (nodeIndex < static_cast<int32_t>(nodeRecords.size()));
+		}
+		reader.valid &= (record.skeletonRoot >= -1) && (record.skeletonRoot < static_cast<int32_t>(nodeRecords.size()));
+	}
+	for (const NodeRecord& record : nodeRecords) {
+		reader.valid &= (record.node.skinIndex >= -1) && (record.node.skinIndex < static_cast<int32_t>(skinRecords.size()));
+	}
+
+	// Animations
+	std::vector<Animation> cachedAnimations(reader.readCount());
+	std::vector<std::vector<SceneCacheChannel>> channelRecords(cachedAnimations.size());
+	for (size_t i = 0; i < cachedAnimations.size(); i++) {
+		Animation& animation = cachedAnimations[i];
+		reader.read(animation.name);
+		animation.start = reader.read<float>();
+		animation.end = reader.read<float>();
+		animation.samplers.resize(reader.readCount());
+		for (AnimationSampler& sampler : animation.samplers) {
+			sampler.interpolation = static_cast<AnimationSampler::InterpolationType>(reader.read<uint32_t>());
+			reader.read(sampler.inputs);
+			reader.read(sampler.outputsVec4);
+		}
+		reader.read(channelRecords[i]);
+		for (const SceneCacheChannel& channel : channelRecords[i]) {
+			reader.valid &= (channel.node < nodeRecords.size()) && (channel.samplerIndex < animation.samplers.size());
+		}
+	}
+
+	if (!reader.valid) {
+		return false;
+	}
+
+	// Everything has been read and validated, so from here on resources are created
+	for (const TextureRecord& record : textureRecords) {
+		std::vector<VkBufferImageCopy> bufferCopyRegions(record.levelOffsets.size());
+		for (uint32_t i = 0; i < record.levelOffsets.size(); i++) {
+			VkBufferImageCopy& bufferCopyRegion = bufferCopyRegions[i];
+			bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			bufferCopyRegion.imageSubresource.mipLevel = i;
+			bufferCopyRegion.imageSubresource.layerCount = 1;
+			bufferCopyRegion.imageExtent.width = std::max(1u, record.texture.width >> i);
+			bufferCopyRegion.imageExtent.height = std::max(1u, record.texture.height >> i);
+			bufferCopyRegion.imageExtent.depth = 1;
+			bufferCopyRegion.bufferOffset = record.levelOffsets[i];
+		}
+		vkglTF::Texture texture;
+		texture.fromMipChain(record.data, record.texture.data.size, static_cast<VkFormat>(record.texture.format), record.texture.width, record.texture.height, bufferCopyRegions, record.texture.texelBlockSize, device);
+		texture.index = static_cast<uint32_t>(textures.size());
+		textures.push_back(texture);
+	}
+	if (!(loadingFlags & FileLoadingFlags::DontLoadImages)) {
+		createEmptyTexture(transferQueue);
+	}
+
+	auto textureFromIndex = [this](int32_t index) -> vkglTF::Texture* {
+		return (index == -2) ? &emptyTexture : getTexture(static_cast<uint32_t>(index));
+	};
+	for (const SceneCacheMaterial& record : materialRecords) {
+		vkglTF::Material material(device);
+		material.baseColorFactor = record.baseColorFactor;
+		material.alphaMode = static_cast<Material::AlphaMode>(record.alphaMode);
+		material.alphaCutoff = record.alphaCutoff;
+		material.metallicFactor = record.metallicFactor;
+		material.roughnessFactor = record.roughnessFactor;
+		material.baseColorTexture = textureFromIndex(record.baseColorTexture);
+		material.metallicRoughnessTexture = textureFromIndex(record.metallicRoughnessTexture);
+		material.normalTexture = textureFromIndex(record.normalTexture);
+		material.occlusionTexture = textureFromIndex(record.occlusionTexture);
+		material.emissiveTexture = textureFromIndex(record.emissiveTexture);
+		materials.push_back(material);
+	}
+
+	for (const NodeRecord& record : nodeRecords) {
+		vkglTF::Node* node = new Node{};
+		node->index = record.node.index;
+		node->name = record.name;
+		node->skinIndex = record.node.skinIndex;
+		node->matrix = record.node.matrix;
+		node->translation = record.node.translation;
+		node->rotation = record.node.rotation;
+		node->scale = record.node.scale;
+		if (record.node.primitiveCount >= 0) {
+			node->mesh = new Mesh(device, node->matrix);
+			node->mesh->name = record.meshName;
+			for (size_t i = 0; i < record.primitives.size(); i++) {
+				const SceneCachePrimitive& source = record.primitives[i];
+				Primitive* primitive = new Primitive(source.firstIndex, source.indexCount, materials[source.material]);
+				primitive->firstVertex = source.firstVertex;
+				primitive->vertexCount = source.vertexCount;
+				primitive->vertexOffset = source.vertexOffset;
+				primitive->firstMeshlet = source.firstMeshlet;
+				primitive->meshletCount = source.meshletCount;
+				primitive->lods = record.lods[i];
+				primitive->setDimensions(source.min, source.max);
+				node->mesh->primitives.push_back(primitive);
+			}
+		}
+		linearNodes.push_back(node);
+	}
+	for (size_t i = 0; i < nodeRecords.size(); i++) {
+		Node* node = linearNodes[i];
+		if (nodeRecords[i].node.parent > -1) {
+			node->parent = linearNodes[nodeRecords[i].node.parent];
+			node->parent->children.push_back(node);
+		} else {
+			nodes.push_back(node);
+		}
+	}
+
+	for (const SkinRecord& record : skinRecords) {
+		Skin* skin = new Skin{};
+		skin->name = record.name;
+		skin->skeletonRoot = (record.skeletonRoot > -1) ? linearNodes[record.skeletonRoot] : nullptr;
+		for (int32_t nodeIndex : record.joints) {
+			skin->joints.push_back(linearNodes[nodeIndex]);
+		}
+		skin->inverseBindMatrices = record.inverseBindMatrices;
+		skins.push_back(skin);
+	}
+
+	for (size_t i = 0; i < cachedAnimations.size(); i++) {
+		for (const SceneCacheChannel& record : channelRecords[i]) {
+			AnimationChannel channel{};
+			channel.path = static_cast<AnimationChannel::PathType>(record.path);
+			channel.node = linearNodes[record.node];
+			channel.samplerIndex = record.samplerIndex;
+			cachedAnimations[i].channels.push_back(channel);
+		}
+	}
+	animations = std::move(cachedAnimations);
+
+	for (auto node : linearNodes) {
+		// Assign skins
+		if (node->skinIndex > -1) {
+			node->skin = skins[node->skinIndex];
+		}
+		// Initial pose
+		if (node->mesh) {
+			node->update();
+		}
+	}
+
+	metallicRoughnessWorkflow = metallicRoughness;
+	indices.type = indexType;
+	indices.count = indexCount;
+	vertices.count = vertexCount;
+	meshlets.meshlets = std::move(cachedMeshlets.meshlets);
+	meshlets.bounds = std::move(cachedMeshlets.bounds);
+	meshlets.vertices = std::move(cachedMeshlets.vertices);
+	meshlets.triangles = std::move(cachedMeshlets.triangles);
+
+	createBuffers(vertexStreams, indexData);
+	if (loadingFlags & FileLoadingFlags::BuildBvh) {
+		buildBvh(vertexStreams[0], indexData);
+	}
+	return true;
+#endif
+}
+
+/*
+	Write the loaded scene to the cache file, failing to write the file (e.g. for read only asset folders) is not an error
+	Images decoded from png or jpg files are stored with a mip chain generated on the host, ktx files are stored as they are
+*/
+void vkglTF::Model::saveSceneCache(const std::string& filename, uint64_t key, const tinygltf::Model& gltfModel, const std::vector<BufferData>& vertexStreams, BufferData indexData)
+{
+#if !defined(__ANDROID__)
+	// The cache is written to a temporary file that replaces it once complete, so a partially written cache is never read
+	const std::string tempFilename = filename + ".tmp";
+	SceneCacheWriter writer;
+	writer.file.open(tempFilename, std::ios::binary | std::ios::trunc);
+	if (!writer.file.is_open()) {
+		return;
+	}
+	SceneCacheHeader header{};
+	writer.file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	// Geometry
+	writer.write(static_cast<uint32_t>(vertices.count));
+	writer.write(static_cast<uint32_t>(indices.count));
+	writer.write(static_cast<uint32_t>(indices.type));
+	writer.write(static_cast<uint32_t>(metallicRoughnessWorkflow ? 1 : 0));
+	writer.write(static_cast<uint32_t>(vertexStreams.size()));
+	for (const BufferData& vertexStream : vertexStreams) {
+		writer.write(writer.writeBlob(vertexStream.data, vertexStream.size));
+	}
+	writer.write(writer.writeBlob(indexData.data, indexData.size));
+	writer.write(meshlets.meshlets);
+	writer.write(meshlets.bounds);
+	writer.write(meshlets.vertices);
+	writer.write(meshlets.triangles);
+
+	// Textures, in the same order as the images of the glTF file
+	writer.write(static_cast<uint32_t>(textures.size()));
+	for (size_t i = 0; i < textures.size(); i++) {
+		const tinygltf::Image& image = gltfModel.images[i];
+		SceneCacheTexture record{};
+		std::vector<uint64_t> levelOffsets;
+		const bool isKtx = (image.uri.find_last_of(".") != std::string::npos) && (image.uri.substr(image.uri.find_last_of(".") + 1) == "ktx");
+		if (isKtx) {
+			ktxTexture* ktxTexture = nullptr;
+			if (ktxTexture_CreateFromNamedFile((path + "/" + image.uri).c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &ktxTexture) != KTX_SUCCESS) {
+				writer.file.close();
+				std::filesystem::remove(tempFilename);
+				return;
+			}
+			for (uint32_t level = 0; level < ktxTexture->numLevels; level++) {
+				ktx_size_t offset = 0;
+				ktxTexture_GetImageOffset(ktxTexture, level, 0, 0, &offset);
+				levelOffsets.push_back(offset);
+			}
+			record.format = static_cast<uint32_t>(ktxTexture_GetVkFormat(ktxTexture));
+			record.width = ktxTexture->baseWidth;
+			record.height = ktxTexture->baseHeight;
+			record.texelBlockSize = ktxTexture_GetElementSize(ktxTexture);
+			record.data = writer.writeBlob(ktxTexture_GetData(ktxTexture), ktxTexture_GetSize(ktxTexture));
+			ktxTexture_Destroy(ktxTexture);
+		} else {
+			// RGB images are expanded to RGBA at load time, see Texture::fromglTfImage
+			std::vector<uint8_t> rgba(static_cast<size_t>(image.width) * image.height * 4);
+			if (image.component == 3) {
+				for (size_t p = 0; p < static_cast<size_t>(image.width) * image.height; p++) {
+					memcpy(&rgba[p * 4], &image.image[p * 3], 3);
+					rgba[p * 4 + 3] = 255;
+				}
+			} else {
+				memcpy(rgba.data(), image.image.data(), rgba.size());
+			}
+			std::vector<uint8_t> mipChain;
+			generateMipChain(rgba.data(), image.width, image.height, mipChain, levelOffsets);
+			record.format = VK_FORMAT_R8G8B8A8_UNORM;
+			record.width = image.width;
+			record.height = image.height;
+			record.texelBlockSize = 4;
+			record.data = writer.writeBlob(mipChain.data(), mipChain.size());
+		}
+		writer.write(record);
+		writer.write(levelOffsets);
+	}
+
+	// Materials
+	auto textureIndex = [this](const vkglTF::Texture* texture) -> int32_t {
+		if (texture == nullptr) {
+			return -1;
+		}
+		return (texture == &emptyTexture) ? -2 : static_cast<int32_t>(texture - textures.data());
+	};
+	std::vector<SceneCacheMaterial> materialRecords;
+	for (const Material& material : materials) {
+		SceneCacheMaterial record{};
+		record.baseColorFactor = material.baseColorFactor;
+		record.alphaMode = static_cast<uint32_t>(material.alphaMode);
+		record.alphaCutoff = material.alphaCutoff;
+		record.metallicFactor = material.metallicFactor;
+		record.roughnessFactor = material.roughnessFactor;
+		record.baseColorTexture = textureIndex(material.baseColorTexture);
+		record.metallicRoughnessTexture = textureIndex(material.metallicRoughnessTexture);
+		record.normalTexture = textureIndex(material.normalTexture);
+		record.occlusionTexture = textureIndex(material.occlusionTexture);
+		record.emissiveTexture = textureIndex(material.emissiveTexture);
+		materialRecords.push_back(record);
+	}
+	writer.write(materialRecords);
+
+	// Nodes
+	std::unordered_map<const Node*, int32_t> linearIndices;
+	for (size_t i = 0; i < linearNodes.size(); i++) {
+		linearIndices[linearNodes[i]] = static_cast<int32_t>(i);
+	}
+	writer.write(static_cast<uint32_t>(linearNodes.size()));
+	for (const Node* node : linearNodes) {
+		SceneCacheNode record{};
+		record.matrix = node->matrix;
+		record.rotation = node->rotation;
+		record.translation = node->translation;
+		record.scale = node->scale;
+		record.parent = node->parent ? linearIndices[node->parent] : -1;
+		record.index = node->index;
+		record.skinIndex = node->skinIndex;
+		record.primitiveCount = node->mesh ? static_cast<int32_t>(node->mesh->primitives.size()) : -1;
+		writer.write(record);
+		writer.write(node->name);
+		if (!node->mesh) {
+			continue;
+		}
+		writer.write(node->mesh->name);
+		std::vector<SceneCachePrimitive> primitiveRecords;
+		for (const Primitive* primitive : node->mesh->primitives) {
+			SceneCachePrimitive primitiveRecord{};
+			primitiveRecord.min = primitive->dimensions.min;
+			primitiveRecord.max = primitive->dimensions.max;
+			primitiveRecord.firstIndex = primitive->firstIndex;
+			primitiveRecord.indexCount = primitive->indexCount;
+			primitiveRecord.firstVertex = primitive->firstVertex;
+			primitiveRecord.vertexCount = primitive->vertexCount;
+			primitiveRecord.vertexOffset = primitive->vertexOffset;
+			primitiveRecord.material = static_cast<uint32_t>(&primitive->material - materials.data());
+			primitiveRecord.firstMeshlet = primitive->firstMeshlet;
+			primitiveRecord.meshletCount = primitive->meshletCount;
+			primitiveRecords.push_back(primitiveRecord);
+		}
+		writer.write(primitiveRecords);
+		for (const Primitive* primitive : node->mesh->primitives) {
+			writer.write(primitive->lods);
+		}
+	}
+
+	// Skins
+	writer.write(static_cast<uint32_t>(skins.size()));
+	for (const Skin* skin : skins) {
+		std::vector<int32_t> joints;
+		for (const Node* joint : skin->joints) {
+			joints.push_back(linearIndices[joint]);
+		}
+		writer.write(skin->name);
+		writer.write(skin->skeletonRoot ? linearIndices[skin->skeletonRoot] : -1);
+		writer.write(joints);
+		writer.write(skin->inverseBindMatrices);
+	}
+
+	// Animations
+	writer.write(static_cast<uint32_t>(animations.size()));
+	for (const Animation& animation : animations) {
+		writer.write(animation.name);
+		writer.write(animation.start);
+		writer.write(animation.end);
+		writer.write(static_cast<uint32_t>(animation.samplers.size()));
+		for (const AnimationSampler& sampler : animation.samplers) {
+			writer.write(static_cast<uint32_t>(sampler.interpolation));
+			writer.write(sampler.inputs);
+			writer.write(sampler.outputsVec4);
+		}
+		std::vector<SceneCacheChannel> channelRecords;
+		for (const AnimationChannel& channel : animation.channels) {
+			channelRecords.push_back({ static_cast<uint32_t>(channel.path), static_cast<uint32_t>(linearIndices[channel.node]), channel.samplerIndex });
+		}
+		writer.write(channelRecords);
+	}
+
+	// The header is written last, it references the scene description
+	const SceneCacheBlob sceneBlob = writer.writeBlob(writer.scene.data(), writer.scene.size());
+	memcpy(header.magic, sceneCacheMagic, sizeof(header.magic));
+	header.version = sceneCacheVersion;
+	header.key = key;
+	header.fileSize = static_cast<uint64_t>(writer.file.tellp());
+	header.sceneOffset = sceneBlob.offset;
+	header.sceneSize = sceneBlob.size;
+	writer.file.seekp(0);
+	writer.file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	writer.file.close();
+
+	std::error_code errorCode;
+	if (writer.file.fail()) {
+		std::filesystem::remove(tempFilename, errorCode);
+		return;
+	}
+	std::filesystem::rename(tempFilename, filename, errorCode);
+	if (errorCode) {
+		std::filesystem::remove(tempFilename, errorCode);
+	}
+#endif
+}
+
+/*
+	Create the device local storage buffers for the meshlet data and queue their uploads on the device's staging ring
+*/
+void vkglTF::Model::createMeshletBuffers()
+{
+	const std::pair<StorageBuffer*, std::pair<const void*, VkDeviceSize>> storageBuffers[] = {
+		{ &meshlets.meshletBuffer, { meshlets.meshlets.data(), meshlets.meshlets.size() * sizeof(vks::meshoptimizer::Meshlet) } },
+		{ &meshlets.boundsBuffer, { meshlets.bounds.data(), meshlets.bounds.size() * sizeof(vks::meshoptimizer::MeshletBounds) } },
+		{ &meshlets.vertexBuffer, { meshlets.vertices.data(), meshlets.vertices.size() * sizeof(uint32_t) } },
+		{ &meshlets.triangleBuffer, { meshlets.triangles.data(), meshlets.triangles.size() * sizeof(uint32_t) } },
+	};
+	for (const auto& [storageBuffer, data] : storageBuffers) {
+		VK_CHECK_RESULT(device->createBuffer(
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | memoryPropertyFlags,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			data.second,
+			&storageBuffer->buffer,
+			&storageBuffer->memory));
+		storageBuffer->descriptor = { storageBuffer->buffer, 0, data.second };
+		device->stagingRing.copyToBuffer(data.first, data.second, storageBuffer->buffer);
+	}
+}
+
+/*
+	Create a device local vertex buffer and queue the upload of its data on the device's staging ring
+*/
+void vkglTF::Model::createVertexBuffer(const void* data, VkDeviceSize size, VkBuffer* buffer, VkDeviceMemory* memory)
+{
+	VK_CHECK_RESULT(device->createBuffer(
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | memoryPropertyFlags,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		size,
+		buffer,
+		memory));
+	device->stagingRing.copyToBuffer(data, size, *buffer);
+}
+
+/*
+	Split the loaded vertices into the streams of the quantized vertex layout
+*/
+void vkglTF::Model::quantizeVertices(const std::vector<Vertex>& vertexBuffer, std::vector<glm::vec3>& positions, std::vector<QuantizedVertex::Attributes>& attributes, std::vector<QuantizedVertex::Skin>& skin)
+{
+	positions.resize(vertexBuffer.size());
+	attributes.resize(vertexBuffer.size());
+	for (size_t i = 0; i < vertexBuffer.size(); i++) {
+		positions[i] = vertexBuffer[i].pos;
+		attributes[i] = QuantizedVertex::quantizeAttributes(vertexBuffer[i]);
+	}
+	// Static models don't pay for joints and weights
+	if (!skins.empty()) {
+		skin.resize(vertexBuffer.size());
+		for (size_t i = 0; i < vertexBuffer.size(); i++) {
+			skin[i] = QuantizedVertex::quantizeSkin(vertexBuffer[i]);
+		}
+	}
+}
+
+void vkglTF::Model::bindVertexBuffers(VkCommandBuffer commandBuffer)
+{
+	const VkDeviceSize offsets[1] = {0};
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertices.buffer, offsets);
+	if (attributeStream.buffer != VK_NULL_HANDLE) {
+		vkCmdBindVertexBuffers(commandBuffer, QuantizedVertex::attributeBinding, 1, &attributeStream.buffer, offsets);
+	}
+	if (skinStream.buffer != VK_NULL_HANDLE) {
+		vkCmdBindVertexBuffers(commandBuffer, QuantizedVertex::skinBinding, 1, &skinStream.buffer, offsets);
+	}
+}
+
+void vkglTF::Model::bindBuffers(VkCommandBuffer commandBuffer)
+{
+	bindVertexBuffers(commandBuffer);
+	vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, indices.type);
+	buffersBound = true;
+}
+
+void vkglTF::Model::drawNode(Node *node, VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet)
+{
+	if (node->mesh) {
+		for (Primitive* primitive : node->mesh->primitives) {
+			bool skip = false;
+			const vkglTF::Material& material = primitive->material;
+			if (renderFlags & RenderFlags::RenderOpaqueNodes) {
+				skip = (material.alphaMode != Material::ALPHAMODE_OPAQUE);
+			}
+			if (renderFlags & RenderFlags::RenderAlphaMaskedNodes) {
+				skip = (material.alphaMode != Material::ALPHAMODE_MASK);
+			}
+			if (renderFlags & RenderFlags::RenderAlphaBlendedNodes) {
+				skip = (material.alphaMode != Material::ALPHAMODE_BLEND);
+			}
+			if (!skip) {
+				if (renderFlags & RenderFlags::BindImages) {
+					if (material.descriptor) {
+						material.descriptor->bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, bindImageSet);
+					} else {
+						vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, bindImageSet, 1, &material.descriptorSet, 0, nullptr);
+					}
+				}
+				vkCmdDrawIndexed(commandBuffer, primitive->indexCount, 1, primitive->firstIndex, primitive->vertexOffset, 0);
+			}
+		}
+	}
+	for (auto& child : node->children) {
+		drawNode(child, commandBuffer, renderFlags, pipelineLayout, bindImageSet);
+	}
+}
+
+void vkglTF::Model::draw(VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet)
+{
+	if (!buffersBound) {
+		bindVertexBuffers(commandBuffer);
+		vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, indices.type);
+	}
+	for (auto& node : nodes) {
+		drawNode(node, commandBuffer, renderFlags, pipelineLayout, bindImageSet);
+	}
+}
+
+void vkglTF::Model::getNodeDimensions(Node *node, glm::vec3 &min, glm::vec3 &max)
+{
+	if (node->mesh) {
+		for (Primitive *primitive : node->mesh->primitives) {
+			glm::vec4 locMin = glm::vec4(primitive->dimensions.min, 1.0f) * node->getMatrix();
+			glm::vec4 locMax = glm::vec4(primitive->dimensions.max, 1.0f) * node->getMatrix();
+			if (locMin.x < min.x) { min.x = locMin.x; }
+			if (locMin.y < min.y) { min.y = locMin.y; }
+			if (locMin.z < min.z) { min.z = locMin.z; }
+			if (locMax.x > max.x) { max.x = locMax.x; }
+			if (locMax.y > max.y) { max.y = locMax.y; }
+			if (locMax.z > max.z) { max.z = locMax.z; }
+		}
+	}
+	for (auto child : node->children) {
+		getNodeDimensions(child, min, max);
+	}
+}
+
+void vkglTF::Model::getSceneDimensions()
+{
+	dimensions.min = glm::vec3(FLT_MAX);
+	dimensions.max = glm::vec3(-FLT_MAX);
+	for (auto node : nodes) {
+		getNodeDimensions(node, dimensions.min, dimensions.max);
+	}
+	dimensions.size = dimensions.max - dimensions.min;
+	dimensions.center = (dimensions.min + dimensions.max) / 2.0f;
+	dimensions.radius = glm::distance(dimensions.min, dimensions.max) / 2.0f;
+}
+
+/*
+	Advance the nodes animated by an animation to the given time and update the mesh uniform blocks and the joint palette
+
+	@param index Index of the animation
+	@param time Time in seconds
+	@param frameIndex (Optional) Frame of the joint palette to write to
+*/
+void vkglTF::Model::updateAnimation(uint32_t index, float time, uint32_t frameIndex)
+{
+	if (index > static_cast<uint32_t>(animations.size()) - 1) {
+		std::cout << "No animation with index " << index << std::endl;
+		return;
+	}
+	Animation &animation = animations[index];
+
+	bool updated = false;
+	for (auto& channel : animation.channels) {
+		vkglTF::AnimationSampler &sampler = animation.samplers[channel.samplerIndex];
+		if (sampler.inputs.size() > sampler.outputsVec4.size()) {
+			continue;
+		}
+
+		for (auto i = 0; i < sampler.inputs.size() - 1; i++) {
+			if ((time >= sampler.inputs[i]) && (time <= sampler.inputs[i + 1])) {
+				float u = std::max(0.0f, time - sampler.inputs[i]) / (sampler.inputs[i + 1] - sampler.inputs[i]);
+				if (u <= 1.0f) {
+					switch (channel.path) {
+					case vkglTF::AnimationChannel::PathType::TRANSLATION: {
+						glm::vec4 trans = glm::mix(sampler.outputsVec4[i], sampler.outputsVec4[i + 1], u);
+						channel.node->translation = glm::vec3(trans);
+						break;
+					}
+					case vkglTF::AnimationChannel::PathType::SCALE: {
+						glm::vec4 trans = glm::mix(sampler.outputsVec4[i], sampler.outputsVec4[i + 1], u);
+						channel.node->scale = glm::vec3(trans);
+						break;
+					}
+					case vkglTF::AnimationChannel::PathType::ROTATION: {
+						glm::quat q1;
+						q1.x = sampler.outputsVec4[i].x;
+						q1.y = sampler.outputsVec4[i].y;
+						q1.z = sampler.outputsVec4[i].z;
+						q1.w = sampler.outputsVec4[i].w;
+						glm::quat q2;
+						q2.x = sampler.outputsVec4[i + 1].x;
+						q2.y = sampler.outputsVec4[i + 1].y;
+						q2.z = sampler.outputsVec4[i + 1].z;
+						q2.w = sampler.outputsVec4[i + 1].w;
+						channel.node->rotation = glm::normalize(glm::slerp(q1, q2, u));
+						break;
+					}
+					}
+					updated = true;
+				}
+			}
+		}
+	}
+	if (updated) {
+		for (auto &node : nodes) {
+			node->update();
+		}
+		updateJointMatrices(frameIndex);
+	}
+}
+
+/*
+	Compute the joint matrices of all skins in one pass and write them to a frame of the joint palette
+	The model space matrices of all nodes are resolved once front to back instead of walking up the hierarchy for every joint,
+	the palette is then a flat loop of matrix products per skin, written sequentially into the mapped buffer
+
+	@param frameIndex (Optional) Frame of the joint palette to write to
+*/
+void vkglTF::Model::updateJointMatrices(uint32_t frameIndex)
+{
+	if (jointPalette.jointCount == 0) {
+		return;
+	}
+	assert(frameIndex < jointPalette.frameCount);
+	// Children are stored before their parents, so walking the nodes backwards resolves every parent before its children
+	for (auto it = linearNodes.rbegin(); it != linearNodes.rend(); ++it) {
+		Node* node = *it;
+		node->cachedMatrix = node->parent ? node->parent->cachedMatrix * node->localMatrix() : node->localMatrix();
+	}
+	glm::mat4* palette = reinterpret_cast<glm::mat4*>(jointPalette.mapped + frameIndex * jointPalette.frameSize);
+	for (const Skin* skin : skins) {
+		glm::mat4* jointMatrices = palette + skin->jointOffset;
+		const glm::mat4* inverseBindMatrices = skin->inverseBindMatrices.data();
+		const size_t jointCount = skin->joints.size();
+		for (size_t i = 0; i < jointCount; i++) {
+			jointMatrices[i] = skin->joints[i]->cachedMatrix * inverseBindMatrices[i];
+		}
+	}
+}
+
+/*
+	Dynamic offset of a frame of the joint palette for binding jointPalette.descriptorSet
+*/
+uint32_t vkglTF::Model::jointPaletteOffset(uint32_t frameIndex) const
+{
+	return static_cast<uint32_t>(frameIndex * jointPalette.frameSize);
+}
+
+/*
+	Helper functions
+*/
+vkglTF::Node* vkglTF::Model::findNode(Node *parent, uint32_t index) {
+	Node* nodeFound = nullptr;
+	if (parent->index == index) {
+		return parent;
+	}
+	for (auto& child : parent->children) {
+		nodeFound = findNode(child, index);
+		if (nodeFound) {
+			break;
+		}
+	}
+	return nodeFound;
+}
+
+vkglTF::Node* vkglTF::Model::nodeFromIndex(uint32_t index) {
+	Node* nodeFound = nullptr;
+	for (auto &node : nodes) {
+		nodeFound = findNode(node, index);
+		if (nodeFound) {
+			break;
+		}
+	}
+	return nodeFound;
+}
+
+void vkglTF::Model::prepareNodeDescriptor(vkglTF::Node* node, VkDescriptorSetLayout descriptorSetLayout) {
+	if (node->mesh) {
+		VkDescriptorSetAllocateInfo descriptorSetAllocInfo{};
+		descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		descriptorSetAllocInfo.descriptorPool = descriptorPool;
+		descriptorSetAllocInfo.pSetLayouts = &descriptorSetLayout;
+		descriptorSetAllocInfo.descriptorSetCount = 1;
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(device->m_device, &descriptorSetAllocInfo, &node->mesh->uniformBuffer.descriptorSet));
+
+		VkWriteDescriptorSet writeDescriptorSet{};
+		writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		writeDescriptorSet.descriptorCount = 1;
+		writeDescriptorSet.dstSet = node->mesh->uniformBuffer.descriptorSet;
+		writeDescriptorSet.dstBinding = 0;
+		writeDescriptorSet.pBufferInfo = &node->mesh->uniformBuffer.descriptor;
 
 		vkUpdateDescriptorSets(device->m_device, 1, &writeDescriptorSet, 0, nullptr);
 	}
@@ -1590,3 +3308,398 @@ void vkglTF::Model::prepareNodeDescriptor(vkglTF::Node* node, VkDescriptorSetLay
 		prepareNodeDescriptor(child, descriptorSetLayout);
 	}
 }
+
+/*
+	Indirect draw path
+*/
+
+// Has to match the push constant block of the culling shader
+struct IndirectCullPushConstants {
+	uint32_t firstDraws[3];
+	uint32_t drawCount;
+	// Write visible commands contiguously per alpha mode instead of zeroing the instance count of culled ones
+	uint32_t compact;
+};
+
+// Has to match the uniform block of the culling shader
+struct IndirectCullUniformData {
+	glm::vec4 frustumPlanes[6];
+	uint32_t cull;
+};
+
+uint32_t vkglTF::Model::indirectTextureIndex(const vkglTF::Texture* texture) const
+{
+	if ((texture == nullptr) || (texture == &emptyTexture)) {
+		return static_cast<uint32_t>(textures.size());
+	}
+	return static_cast<uint32_t>(texture - textures.data());
+}
+
+/*
+	Prepare the indirect draw path
+	Gathers the draw data of all primitives and the materials into storage buffers, and creates the descriptor sets and the culling pipeline
+	Transforms and bounds are captured from the current node matrices, so animated nodes aren't supported
+	Shaders used with drawIndirect read the draw data through gl_InstanceIndex, so drawIndirectFirstInstance needs to be enabled,
+	and index the texture array with nonuniformEXT, so runtimeDescriptorArray and shaderSampledImageArrayNonUniformIndexing need to be enabled
+
+	@param cullShaderStage Compute shader stage for culling and compacting the draws (see shaders/glsl/base/indirectcull.comp)
+	@param drawIndirectCount Use vkCmdDrawIndexedIndirectCount (Vulkan 1.2 with the drawIndirectCount feature enabled) to draw the compacted commands
+	@param pipelineCache (Optional) Pipeline cache for the culling pipeline
+*/
+void vkglTF::Model::prepareIndirectDraw(VkPipelineShaderStageCreateInfo cullShaderStage, bool drawIndirectCount, VkPipelineCache pipelineCache)
+{
+	indirect.materials.resize(materials.size());
+	for (size_t i = 0; i < materials.size(); i++) {
+		IndirectMaterialData& materialData = indirect.materials[i];
+		materialData.baseColorFactor = materials[i].baseColorFactor;
+		materialData.baseColorTextureIndex = indirectTextureIndex(materials[i].baseColorTexture);
+		materialData.normalTextureIndex = indirectTextureIndex(materials[i].normalTexture);
+		materialData.alphaMode = static_cast<uint32_t>(materials[i].alphaMode);
+		materialData.alphaCutoff = materials[i].alphaCutoff;
+	}
+
+	// Draws are gathered per alpha mode, so each mode's commands form a contiguous range
+	const bool preTransformed = loadingFlags & FileLoadingFlags::PreTransformVertices;
+	const glm::mat4 flipY = (loadingFlags & FileLoadingFlags::FlipY) ? glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, -1.0f, 1.0f)) : glm::mat4(1.0f);
+	std::vector<IndirectDrawData> draws[3];
+	for (Node* node : linearNodes) {
+		if (!node->mesh) {
+			continue;
+		}
+		const glm::mat4 nodeMatrix = node->getMatrix();
+		const float scale = std::max(glm::length(glm::vec3(nodeMatrix[0])), std::max(glm::length(glm::vec3(nodeMatrix[1])), glm::length(glm::vec3(nodeMatrix[2]))));
+		for (Primitive* primitive : node->mesh->primitives) {
+			IndirectDrawData drawData{};
+			// Pre-transformed vertices already are in world space (and flipped before the transform otherwise)
+			drawData.matrix = preTransformed ? glm::mat4(1.0f) : nodeMatrix;
+			const glm::vec4 center = (preTransformed ? flipY * nodeMatrix : nodeMatrix * flipY) * glm::vec4(primitive->dimensions.center, 1.0f);
+			drawData.boundingSphere = glm::vec4(glm::vec3(center), primitive->dimensions.radius * scale);
+			drawData.materialIndex = static_cast<uint32_t>(&primitive->material - materials.data());
+			drawData.firstIndex = primitive->firstIndex;
+			drawData.indexCount = primitive->indexCount;
+			drawData.vertexOffset = primitive->vertexOffset;
+			draws[primitive->material.alphaMode].push_back(drawData);
+		}
+	}
+	indirect.draws.clear();
+	for (uint32_t i = 0; i < 3; i++) {
+		indirect.ranges[i].firstDraw = static_cast<uint32_t>(indirect.draws.size());
+		indirect.ranges[i].drawCount = static_cast<uint32_t>(draws[i].size());
+		indirect.draws.insert(indirect.draws.end(), draws[i].begin(), draws[i].end());
+	}
+	assert(!indirect.draws.empty());
+
+	// Buffers
+	const VkDeviceSize drawBufferSize = indirect.draws.size() * sizeof(IndirectDrawData);
+	const VkDeviceSize materialBufferSize = std::max(indirect.materials.size(), size_t(1)) * sizeof(IndirectMaterialData);
+	const VkDeviceSize commandBufferSize = indirect.draws.size() * sizeof(VkDrawIndexedIndirectCommand);
+	const VkDeviceSize countBufferSize = 3 * sizeof(uint32_t);
+	const VkDeviceSize cullUniformBufferSize = sizeof(IndirectCullUniformData);
+	VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, drawBufferSize, &indirect.drawBuffer.buffer, &indirect.drawBuffer.memory));
+	VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, materialBufferSize, &indirect.materialBuffer.buffer, &indirect.materialBuffer.memory));
+	VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, commandBufferSize, &indirect.commandBuffer.buffer, &indirect.commandBuffer.memory));
+	VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, countBufferSize, &indirect.countBuffer.buffer, &indirect.countBuffer.memory));
+	indirect.drawBuffer.descriptor = { indirect.drawBuffer.buffer, 0, drawBufferSize };
+	indirect.materialBuffer.descriptor = { indirect.materialBuffer.buffer, 0, materialBufferSize };
+	indirect.commandBuffer.descriptor = { indirect.commandBuffer.buffer, 0, commandBufferSize };
+	VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, cullUniformBufferSize, &indirect.cullUniformBuffer.buffer, &indirect.cullUniformBuffer.memory));
+	indirect.countBuffer.descriptor = { indirect.countBuffer.buffer, 0, countBufferSize };
+	indirect.cullUniformBuffer.descriptor = { indirect.cullUniformBuffer.buffer, 0, cullUniformBufferSize };
+	VK_CHECK_RESULT(vkMapMemory(device->m_device, indirect.countBuffer.memory, 0, countBufferSize, 0, reinterpret_cast<void**>(&indirect.visibleCounts)));
+	memset(indirect.visibleCounts, 0, countBufferSize);
+	VK_CHECK_RESULT(vkMapMemory(device->m_device, indirect.cullUniformBuffer.memory, 0, cullUniformBufferSize, 0, &indirect.cullUniformMapped));
+	updateIndirectCulling(nullptr);
+	device->stagingRing.copyToBuffer(indirect.draws.data(), drawBufferSize, indirect.drawBuffer.buffer);
+	if (!indirect.materials.empty()) {
+		device->stagingRing.copyToBuffer(indirect.materials.data(), materialBufferSize, indirect.materialBuffer.buffer);
+	}
+	device->stagingRing.submit();
+
+	// Descriptors
+	const uint32_t textureCount = static_cast<uint32_t>(textures.size()) + 1;
+	std::vector<VkDescriptorPoolSize> poolSizes = {
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6 },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, textureCount },
+	};
+	VkDescriptorPoolCreateInfo descriptorPoolCI = vks::initializers::descriptorPoolCreateInfo(poolSizes, 2);
+	VK_CHECK_RESULT(vkCreateDescriptorPool(device->m_device, &descriptorPoolCI, nullptr, &indirect.descriptorPool));
+
+	std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+		vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0),
+		vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1),
+		vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 2, textureCount),
+	};
+	VkDescriptorSetLayoutCreateInfo descriptorLayoutCI = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+	VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->m_device, &descriptorLayoutCI, nullptr, &indirect.descriptorSetLayout));
+	VkDescriptorSetAllocateInfo descriptorSetAI = vks::initializers::descriptorSetAllocateInfo(indirect.descriptorPool, &indirect.descriptorSetLayout, 1);
+	VK_CHECK_RESULT(vkAllocateDescriptorSets(device->m_device, &descriptorSetAI, &indirect.descriptorSet));
+	std::vector<VkDescriptorImageInfo> textureDescriptors;
+	for (const Texture& texture : textures) {
+		textureDescriptors.push_back(texture.descriptor);
+	}
+	textureDescriptors.push_back(emptyTexture.descriptor);
+	VkWriteDescriptorSet textureWrite = vks::initializers::writeDescriptorSet(indirect.descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, textureDescriptors.data(), textureCount);
+
+	setLayoutBindings = {
+		vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+		vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+		vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2),
+		vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 3),
+		vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 4),
+	};
+	descriptorLayoutCI = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+	VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->m_device, &descriptorLayoutCI, nullptr, &indirect.cullDescriptorSetLayout));
+	descriptorSetAI = vks::initializers::descriptorSetAllocateInfo(indirect.descriptorPool, &indirect.cullDescriptorSetLayout, 1);
+	VK_CHECK_RESULT(vkAllocateDescriptorSets(device->m_device, &descriptorSetAI, &indirect.cullDescriptorSet));
+
+	std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+		vks::initializers::writeDescriptorSet(indirect.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &indirect.drawBuffer.descriptor),
+		vks::initializers::writeDescriptorSet(indirect.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &indirect.materialBuffer.descriptor),
+		textureWrite,
+		vks::initializers::writeDescriptorSet(indirect.cullDescriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &indirect.drawBuffer.descriptor),
+		vks::initializers::writeDescriptorSet(indirect.cullDescriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &indirect.materialBuffer.descriptor),
+		vks::initializers::writeDescriptorSet(indirect.cullDescriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &indirect.commandBuffer.descriptor),
+		vks::initializers::writeDescriptorSet(indirect.cullDescriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, &indirect.countBuffer.descriptor),
+		vks::initializers::writeDescriptorSet(indirect.cullDescriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 4, &indirect.cullUniformBuffer.descriptor),
+	};
+	vkUpdateDescriptorSets(device->m_device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+
+	// Culling pipeline
+	VkPushConstantRange pushConstantRange = vks::initializers::pushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(IndirectCullPushConstants), 0);
+	VkPipelineLayoutCreateInfo pipelineLayoutCI = vks::initializers::pipelineLayoutCreateInfo(&indirect.cullDescriptorSetLayout, 1);
+	pipelineLayoutCI.pushConstantRangeCount = 1;
+	pipelineLayoutCI.pPushConstantRanges = &pushConstantRange;
+	VK_CHECK_RESULT(vkCreatePipelineLayout(device->m_device, &pipelineLayoutCI, nullptr, &indirect.cullPipelineLayout));
+	VkComputePipelineCreateInfo computePipelineCI = vks::initializers::computePipelineCreateInfo(indirect.cullPipelineLayout, 0);
+	computePipelineCI.stage = cullShaderStage;
+	VK_CHECK_RESULT(vkCreateComputePipelines(device->m_device, pipelineCache, 1, &computePipelineCI, nullptr, &indirect.cullPipeline));
+
+	indirect.vkCmdDrawIndexedIndirectCount = nullptr;
+	if (drawIndirectCount) {
+		indirect.vkCmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCount>(vkGetDeviceProcAddr(device->m_device, "vkCmdDrawIndexedIndirectCount"));
+	}
+}
+
+/*
+	Set the view frustum the draws of the indirect draw path are culled against by the following cullIndirect commands
+
+	@param frustumPlanes Six normalized frustum planes (see vks::Frustum), nullptr disables culling
+*/
+void vkglTF::Model::updateIndirectCulling(const glm::vec4* frustumPlanes)
+{
+	IndirectCullUniformData uniformData{};
+	if (frustumPlanes != nullptr) {
+		memcpy(uniformData.frustumPlanes, frustumPlanes, sizeof(uniformData.frustumPlanes));
+		uniformData.cull = 1;
+	}
+	memcpy(indirect.cullUniformMapped, &uniformData, sizeof(IndirectCullUniformData));
+}
+
+/*
+	Cull all draws of the indirect draw path against the frustum set with updateIndirectCulling and write the commands for the visible ones
+	The frustum is read when the commands are executed, so command buffers can be recorded once
+
+	@param commandBuffer Command buffer to record to, outside of a render pass
+*/
+void vkglTF::Model::cullIndirect(VkCommandBuffer commandBuffer)
+{
+	IndirectCullPushConstants pushConstants{};
+	for (uint32_t i = 0; i < 3; i++) {
+		pushConstants.firstDraws[i] = indirect.ranges[i].firstDraw;
+	}
+	pushConstants.drawCount = static_cast<uint32_t>(indirect.draws.size());
+	pushConstants.compact = (indirect.vkCmdDrawIndexedIndirectCount != nullptr) ? 1 : 0;
+
+	// The draws of the previous use of the commands have to finish before they are rewritten
+	VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+	memoryBarrier.srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	vkCmdFillBuffer(commandBuffer, indirect.countBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+	memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, indirect.cullPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, indirect.cullPipelineLayout, 0, 1, &indirect.cullDescriptorSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, indirect.cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(IndirectCullPushConstants), &pushConstants);
+	vkCmdDispatch(commandBuffer, (pushConstants.drawCount + 63) / 64, 1, 1);
+
+	// Commands and counts are read by the indirect draws, the counts also by the host
+	memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+/*
+	Draw the commands written by cullIndirect with one indirect draw per alpha mode (or one per draw without multi draw indirect support)
+
+	@param commandBuffer Command buffer to record to
+	@param renderFlags (Optional) Flags to select the alpha modes (RenderOpaqueNodes, RenderAlphaMaskedNodes, RenderAlphaBlendedNodes), all modes are drawn if none is set
+	@param pipelineLayout (Optional) Pipeline layout for binding the draw data, material and texture descriptor set
+	@param bindSet (Optional) Index of the set the indirect draw descriptor set is bound to
+*/
+void vkglTF::Model::drawIndirect(VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindSet)
+{
+	if (!buffersBound) {
+		bindVertexBuffers(commandBuffer);
+		vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, indices.type);
+	}
+	if (pipelineLayout != VK_NULL_HANDLE) {
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, bindSet, 1, &indirect.descriptorSet, 0, nullptr);
+	}
+	const uint32_t modeFlags[3] = { RenderFlags::RenderOpaqueNodes, RenderFlags::RenderAlphaMaskedNodes, RenderFlags::RenderAlphaBlendedNodes };
+	const bool allModes = (renderFlags & (RenderFlags::RenderOpaqueNodes | RenderFlags::RenderAlphaMaskedNodes | RenderFlags::RenderAlphaBlendedNodes)) == 0;
+	const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+	for (uint32_t i = 0; i < 3; i++) {
+		const IndirectDraw::Range& range = indirect.ranges[i];
+		if ((range.drawCount == 0) || (!allModes && !(renderFlags & modeFlags[i]))) {
+			continue;
+		}
+		const VkDeviceSize offset = range.firstDraw * stride;
+		if (indirect.vkCmdDrawIndexedIndirectCount != nullptr) {
+			indirect.vkCmdDrawIndexedIndirectCount(commandBuffer, indirect.commandBuffer.buffer, offset, indirect.countBuffer.buffer, i * sizeof(uint32_t), range.drawCount, stride);
+		} else if (device->m_vkPhysicalDeviceFeaturesEnabled.multiDrawIndirect) {
+			vkCmdDrawIndexedIndirect(commandBuffer, indirect.commandBuffer.buffer, offset, range.drawCount, stride);
+		} else {
+			// If multi draw is not available, we must issue separate draw commands
+			for (uint32_t j = 0; j < range.drawCount; j++) {
+				vkCmdDrawIndexedIndirect(commandBuffer, indirect.commandBuffer.buffer, offset + j * stride, 1, stride);
+			}
+		}
+	}
+}
+
+/*
+	Compute pre-skinning
+*/
+
+// Has to match the push constant block of the skinning shader
+struct SkinningPushConstants {
+	// Node matrix of unskinned meshes
+	glm::mat4 matrix;
+	uint32_t firstVertex;
+	uint32_t vertexCount;
+	uint32_t jointOffset;
+	uint32_t skinned;
+};
+
+/*
+	Prepare the compute pre-skinning of all vertices (see Model::Skinning)
+	The shader reads the vertex streams as storage buffers, so VK_BUFFER_USAGE_STORAGE_BUFFER_BIT needs to be added through vkglTF::memoryPropertyFlags before loading,
+	these usage flags are also added to the skinned buffers (e.g. for building acceleration structures from them)
+
+	@param skinningShaderStage Compute shader stage for skinning the vertices (see shaders/glsl/base/skinning.comp)
+	@param pipelineCache (Optional) Pipeline cache for the skinning pipeline
+*/
+void vkglTF::Model::prepareSkinning(VkPipelineShaderStageCreateInfo skinningShaderStage, VkPipelineCache pipelineCache)
+{
+	assert(memoryPropertyFlags & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	assert(!(loadingFlags & FileLoadingFlags::PreTransformVertices) || skins.empty());
+
+	const VkDeviceSize bufferSize = static_cast<VkDeviceSize>(vertices.count) * sizeof(glm::vec3);
+	for (StorageBuffer* storageBuffer : { &skinning.positions, &skinning.normals }) {
+		VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | memoryPropertyFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, bufferSize, &storageBuffer->buffer, &storageBuffer->memory));
+		storageBuffer->descriptor = { storageBuffer->buffer, 0, bufferSize };
+	}
+
+	// Source streams, the default layout reads all components from the interleaved vertex buffer
+	const bool quantized = (vertexLayout == VertexLayout::Quantized);
+	VkDescriptorBufferInfo vertexDescriptor = { vertices.buffer, 0, VK_WHOLE_SIZE };
+	VkDescriptorBufferInfo attributeDescriptor = quantized ? VkDescriptorBufferInfo{ attributeStream.buffer, 0, VK_WHOLE_SIZE } : vertexDescriptor;
+	// Unskinned quantized models have no skin stream, the attribute stream is bound in its place but never read
+	VkDescriptorBufferInfo skinDescriptor = (quantized && skinStream.buffer != VK_NULL_HANDLE) ? VkDescriptorBufferInfo{ skinStream.buffer, 0, VK_WHOLE_SIZE } : attributeDescriptor;
+
+	std::vector<VkDescriptorPoolSize> poolSizes = { vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5) };
+	if (jointPalette.jointCount == 0) {
+		poolSizes.push_back(vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1));
+	}
+	VkDescriptorPoolCreateInfo descriptorPoolCI = vks::initializers::descriptorPoolCreateInfo(poolSizes, 1);
+	VK_CHECK_RESULT(vkCreateDescriptorPool(device->m_device, &descriptorPoolCI, nullptr, &skinning.descriptorPool));
+	std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings;
+	for (uint32_t i = 0; i < 5; i++) {
+		setLayoutBindings.push_back(vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, i));
+	}
+	VkDescriptorSetLayoutCreateInfo descriptorLayoutCI = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+	VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->m_device, &descriptorLayoutCI, nullptr, &skinning.descriptorSetLayout));
+	VkDescriptorSetAllocateInfo descriptorSetAI = vks::initializers::descriptorSetAllocateInfo(skinning.descriptorPool, &skinning.descriptorSetLayout, 1);
+	VK_CHECK_RESULT(vkAllocateDescriptorSets(device->m_device, &descriptorSetAI, &skinning.descriptorSet));
+	std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+		vks::initializers::writeDescriptorSet(skinning.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &vertexDescriptor),
+		vks::initializers::writeDescriptorSet(skinning.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &attributeDescriptor),
+		vks::initializers::writeDescriptorSet(skinning.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &skinDescriptor),
+		vks::initializers::writeDescriptorSet(skinning.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, &skinning.positions.descriptor),
+		vks::initializers::writeDescriptorSet(skinning.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, &skinning.normals.descriptor),
+	};
+	vkUpdateDescriptorSets(device->m_device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+
+	// Models without skins still need a joint palette layout for the pipeline layout, the set itself is never bound
+	VkDescriptorSetLayout jointSetLayout = jointPalette.descriptorSetLayout;
+	if (jointSetLayout == VK_NULL_HANDLE) {
+		VkDescriptorSetLayoutBinding setLayoutBinding = vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 0);
+		VkDescriptorSetLayoutCreateInfo jointLayoutCI = vks::initializers::descriptorSetLayoutCreateInfo(&setLayoutBinding, 1);
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->m_device, &jointLayoutCI, nullptr, &jointPalette.descriptorSetLayout));
+		jointSetLayout = jointPalette.descriptorSetLayout;
+	}
+
+	const std::array<VkDescriptorSetLayout, 2> setLayouts = { skinning.descriptorSetLayout, jointSetLayout };
+	VkPushConstantRange pushConstantRange = vks::initializers::pushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(SkinningPushConstants), 0);
+	VkPipelineLayoutCreateInfo pipelineLayoutCI = vks::initializers::pipelineLayoutCreateInfo(setLayouts.data(), static_cast<uint32_t>(setLayouts.size()));
+	pipelineLayoutCI.pushConstantRangeCount = 1;
+	pipelineLayoutCI.pPushConstantRanges = &pushConstantRange;
+	VK_CHECK_RESULT(vkCreatePipelineLayout(device->m_device, &pipelineLayoutCI, nullptr, &skinning.pipelineLayout));
+
+	// The vertex layout is selected with a specialization constant
+	const uint32_t specializationData[2] = { quantized ? 1u : 0u, static_cast<uint32_t>(sizeof(Vertex) / sizeof(float)) };
+	const std::array<VkSpecializationMapEntry, 2> specializationMapEntries = {
+		vks::initializers::specializationMapEntry(0, 0, sizeof(uint32_t)),
+		vks::initializers::specializationMapEntry(1, sizeof(uint32_t), sizeof(uint32_t)),
+	};
+	VkSpecializationInfo specializationInfo = vks::initializers::specializationInfo(static_cast<uint32_t>(specializationMapEntries.size()), specializationMapEntries.data(), sizeof(specializationData), specializationData);
+	skinningShaderStage.pSpecializationInfo = &specializationInfo;
+	VkComputePipelineCreateInfo computePipelineCI = vks::initializers::computePipelineCreateInfo(skinning.pipelineLayout, 0);
+	computePipelineCI.stage = skinningShaderStage;
+	VK_CHECK_RESULT(vkCreateComputePipelines(device->m_device, pipelineCache, 1, &computePipelineCI, nullptr, &skinning.pipeline));
+}
+
+/*
+	Write the skinned positions and normals of all vertices to the skinning buffers with one dispatch per primitive, using a frame of the joint palette
+
+	@param commandBuffer Command buffer to record to, outside of a render pass
+	@param frameIndex (Optional) Frame of the joint palette to read from
+	@param dstStageMask (Optional) Stages that read the skinned buffers afterwards, e.g. VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR for refitting an acceleration structure
+*/
+void vkglTF::Model::skinVertices(VkCommandBuffer commandBuffer, uint32_t frameIndex, VkPipelineStageFlags dstStageMask)
+{
+	// The previous readers of the skinned buffers have to finish before they are rewritten
+	vkCmdPipelineBarrier(commandBuffer, dstStageMask, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, skinning.pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, skinning.pipelineLayout, 0, 1, &skinning.descriptorSet, 0, nullptr);
+	if (jointPalette.jointCount > 0) {
+		const uint32_t dynamicOffset = jointPaletteOffset(frameIndex);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, skinning.pipelineLayout, 1, 1, &jointPalette.descriptorSet, 1, &dynamicOffset);
+	}
+	const bool preTransformed = loadingFlags & FileLoadingFlags::PreTransformVertices;
+	for (Node* node : linearNodes) {
+		if (!node->mesh) {
+			continue;
+		}
+		SkinningPushConstants pushConstants{};
+		pushConstants.matrix = preTransformed ? glm::mat4(1.0f) : node->mesh->uniformBlock.matrix;
+		pushConstants.jointOffset = node->mesh->uniformBlock.jointOffset;
+		pushConstants.skinned = node->skin ? 1 : 0;
+		for (const Primitive* primitive : node->mesh->primitives) {
+			pushConstants.firstVertex = primitive->firstVertex;
+			pushConstants.vertexCount = primitive->vertexCount;
+			vkCmdPushConstants(commandBuffer, skinning.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SkinningPushConstants), &pushConstants);
+			vkCmdDispatch(commandBuffer, (primitive->vertexCount + 63) / 64, 1, 1);
+		}
+	}
+
+	VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+	memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStageMask, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
@@ -22,6 +22,9 @@
 
 #include "vulkan/vulkan.h"
 #include "VulkanDevice.h"
+#include "VulkanDescriptorSets.h"
+#include "MeshOptimizer.h"
+#include "Bvh.h"
 
 #include <ktx.h>
 #include <ktxvulkan.h>
@@ -74,6 +77,10 @@ namespace vkglTF
 		void updateDescriptor();
 		void destroy();
 		void fromglTfImage(tinygltf::Image& gltfimage, std::string path, vks::VulkanDevice* device, VkQueue copyQueue);
+		/** @brief Creates the texture from a complete mip chain in host memory, the buffer offsets of the regions are relative to data */
+		void fromMipChain(const void* data, VkDeviceSize size, VkFormat format, uint32_t width, uint32_t height, const std::vector<VkBufferImageCopy>& regions, VkDeviceSize texelBlockSize, vks::VulkanDevice* device);
+	private:
+		void createSamplerAndView(VkFormat format);
 	};
 
 	/*
@@ -97,9 +104,12 @@ namespace vkglTF
 		vkglTF::Texture* diffuseTexture;
 
 		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		/** @brief Images written through a descriptor manager (see Model::createMaterialDescriptors), bound instead of descriptorSet if set */
+		vks::DescriptorSet* descriptor = nullptr;
 
 		Material(vks::VulkanDevice* device) : device(device) {};
 		void createDescriptorSet(VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout, uint32_t descriptorBindingFlags);
+		void createDescriptor(vks::DescriptorManager& descriptorManager, VkDescriptorSetLayout descriptorSetLayout, uint32_t descriptorBindingFlags);
 	};
 
 	/*
@@ -110,6 +120,8 @@ namespace vkglTF
 		uint32_t indexCount;
 		uint32_t firstVertex;
 		uint32_t vertexCount;
+		// Added to the indices when drawing, used by optimized meshes with indices relative to the primitive's first vertex
+		int32_t vertexOffset = 0;
 		Material& material;
 
 		struct Dimensions {
@@ -120,7 +132,20 @@ namespace vkglTF
 			float radius;
 		} dimensions;
 
+		// Levels of detail generated with FileLoadingFlags::GenerateLods, stored in the shared index buffer with the same vertex offset, the first level is the primitive itself
+		struct Lod {
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			// Geometric error in model units, doesn't decrease from one level to the next
+			float error;
+		};
+		std::vector<Lod> lods;
+		// Range of the primitive's meshlets in Model::meshlets, built with FileLoadingFlags::BuildMeshlets
+		uint32_t firstMeshlet = 0;
+		uint32_t meshletCount = 0;
+
 		void setDimensions(glm::vec3 min, glm::vec3 max);
+		uint32_t selectLod(float maxError) const;
 		Primitive(uint32_t firstIndex, uint32_t indexCount, Material& material) : firstIndex(firstIndex), indexCount(indexCount), material(material) {};
 	};
 
@@ -133,18 +158,22 @@ namespace vkglTF
 		std::vector<Primitive*> primitives;
 		std::string name;
 
+		// Range of the mesh in the node uniform buffer of the model, which is shared by all meshes
 		struct UniformBuffer {
-			VkBuffer buffer;
-			VkDeviceMemory memory;
-			VkDescriptorBufferInfo descriptor;
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkDescriptorBufferInfo descriptor{};
 			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
-			void* mapped;
+			void* mapped = nullptr;
 		} uniformBuffer;
 
+		/*
+			Skinned meshes address the joint matrices of their skin in the joint palette of the model (see Model::jointPalette)
+			Joint matrices are in model space, so skinned vertices are not transformed with the mesh matrix
+		*/
 		struct UniformBlock {
 			glm::mat4 matrix;
-			glm::mat4 jointMatrix[64]{};
-			float jointcount{ 0 };
+			uint32_t jointOffset{ 0 };
+			uint32_t jointCount{ 0 };
 		} uniformBlock;
 
 		Mesh(vks::VulkanDevice* device, glm::mat4 matrix);
@@ -159,6 +188,8 @@ namespace vkglTF
 		Node* skeletonRoot = nullptr;
 		std::vector<glm::mat4> inverseBindMatrices;
 		std::vector<Node*> joints;
+		// Index of the first joint matrix of the skin in the joint palette
+		uint32_t jointOffset = 0;
 	};
 
 	/*
@@ -176,6 +207,8 @@ namespace vkglTF
 		glm::vec3 translation{};
 		glm::vec3 scale{ 1.0f };
 		glm::quat rotation{};
+		// Result of getMatrix, updated for all nodes in one pass by Model::updateJointMatrices
+		glm::mat4 cachedMatrix{ 1.0f };
 		glm::mat4 localMatrix();
 		glm::mat4 getMatrix();
 		void update();
@@ -218,6 +251,12 @@ namespace vkglTF
 	*/
 	enum class VertexComponent { Position, Normal, UV, Color, Tangent, Joint0, Weight0 };
 
+	/*
+		Default: All components interleaved as full floats in a single stream (see Vertex)
+		Quantized: Compact components split into separate streams (see QuantizedVertex), selected with FileLoadingFlags::QuantizeVertices
+	*/
+	enum class VertexLayout { Default, Quantized };
+
 	struct Vertex {
 		glm::vec3 pos;
 		glm::vec3 normal;
@@ -227,13 +266,44 @@ namespace vkglTF
 		glm::vec4 weight0;
 		glm::vec4 tangent;
 		static VkVertexInputBindingDescription vertexInputBindingDescription;
+		static std::vector<VkVertexInputBindingDescription> vertexInputBindingDescriptions;
 		static std::vector<VkVertexInputAttributeDescription> vertexInputAttributeDescriptions;
 		static VkPipelineVertexInputStateCreateInfo pipelineVertexInputStateCreateInfo;
 		static VkVertexInputBindingDescription inputBindingDescription(uint32_t binding);
 		static VkVertexInputAttributeDescription inputAttributeDescription(uint32_t binding, uint32_t location, VertexComponent component);
 		static std::vector<VkVertexInputAttributeDescription> inputAttributeDescriptions(uint32_t binding, const std::vector<VertexComponent> components);
-		/** @brief Returns the default pipeline vertex input state create info structure for the requested vertex components */
-		static VkPipelineVertexInputStateCreateInfo* getPipelineVertexInputState(const std::vector<VertexComponent> components);
+		/** @brief Returns the pipeline vertex input state create info structure for the requested vertex components in the given vertex layout */
+		static VkPipelineVertexInputStateCreateInfo* getPipelineVertexInputState(const std::vector<VertexComponent> components, VertexLayout layout = VertexLayout::Default);
+	};
+
+	/*
+		Quantized vertex layout with one stream per binding
+		Positions stay full floats in their own stream, so depth only passes (e.g. shadow maps) only fetch 12 bytes per vertex
+		All other components use formats that are expanded to floats by the vertex input stage, so shaders written for the default layout can be used unchanged
+		The skin stream is only created for models with skins
+	*/
+	struct QuantizedVertex {
+		static const uint32_t positionBinding = 0;
+		static const uint32_t attributeBinding = 1;
+		static const uint32_t skinBinding = 2;
+
+		// Normal and tangent as 8 bit signed normalized (tangent.w stores the handedness), uv as 16 bit float and color as 8 bit normalized
+		struct Attributes {
+			uint32_t normal;
+			uint32_t uv;
+			uint32_t color;
+			uint32_t tangent;
+		};
+		// Joint indices as 16 bit unsigned integers (scaled to float), so joint palettes with more than 256 entries can be addressed, and weights as 8 bit normalized
+		struct Skin {
+			uint32_t joint0[2];
+			uint32_t weight0;
+		};
+
+		static Attributes quantizeAttributes(const Vertex& vertex);
+		static Skin quantizeSkin(const Vertex& vertex);
+		static VkVertexInputBindingDescription inputBindingDescription(uint32_t binding);
+		static VkVertexInputAttributeDescription inputAttributeDescription(uint32_t location, VertexComponent component);
 	};
 
 	enum FileLoadingFlags {
@@ -241,7 +311,13 @@ namespace vkglTF
 		PreTransformVertices = 0x00000001,
 		PreMultiplyVertexColors = 0x00000002,
 		FlipY = 0x00000004,
-		DontLoadImages = 0x00000008
+		DontLoadImages = 0x00000008,
+		QuantizeVertices = 0x00000010,
+		OptimizeMeshes = 0x00000020,
+		GenerateLods = 0x00000040,
+		BuildMeshlets = 0x00000080,
+		BuildBvh = 0x00000100,
+		UseSceneCache = 0x00000200
 	};
 
 	enum RenderFlags {
@@ -259,21 +335,197 @@ namespace vkglTF
 		vkglTF::Texture* getTexture(uint32_t index);
 		vkglTF::Texture emptyTexture;
 		void createEmptyTexture(VkQueue transferQueue);
+		// Host data of a buffer upload, vertex streams are passed in the order of their bindings
+		struct BufferData {
+			const void* data;
+			VkDeviceSize size;
+		};
+		// Strided view on the elements of an accessor, pointing into the memory mapped file or into a buffer loaded by tinygltf
+		struct AccessorView {
+			const uint8_t* data = nullptr;
+			size_t count = 0;
+			size_t stride = 0;
+			int componentType = 0;
+			uint32_t componentCount = 0;
+			bool normalized = false;
+		};
+		// Data of the glTF buffers while loading, the binary chunk of a glb file is read from its memory mapping
+		std::vector<BufferData> gltfBuffers;
+		AccessorView accessorView(const tinygltf::Model& model, int accessorIndex) const;
+		static void readAccessor(const AccessorView& view, float* dst, uint32_t componentCount, size_t dstStride);
+		static bool readIndices(const AccessorView& view, uint32_t offset, uint32_t* dst);
+		void createVertexBuffer(const void* data, VkDeviceSize size, VkBuffer* buffer, VkDeviceMemory* memory);
+		void quantizeVertices(const std::vector<Vertex>& vertexBuffer, std::vector<glm::vec3>& positions, std::vector<QuantizedVertex::Attributes>& attributes, std::vector<QuantizedVertex::Skin>& skin);
+		void createBuffers(const std::vector<BufferData>& vertexStreams, BufferData indexData);
+		void createNodeBuffers();
+		void setupDescriptors();
+		void optimizeMeshes(std::vector<uint32_t>& indexBuffer, std::vector<Vertex>& vertexBuffer);
+		void generateLods(std::vector<uint32_t>& indexBuffer, const std::vector<Vertex>& vertexBuffer);
+		void buildMeshlets(const std::string& filename, const std::vector<uint32_t>& indexBuffer, const std::vector<Vertex>& vertexBuffer, bool clockwise);
+		bool loadMeshletCache(const std::string& filename, uint64_t sourceHash, const std::vector<Primitive*>& primitives);
+		void saveMeshletCache(const std::string& filename, uint64_t sourceHash, const std::vector<Primitive*>& primitives);
+		void createMeshletBuffers();
+		void buildBvh(BufferData positionStream, BufferData indexData);
+		uint64_t sceneCacheKey(const std::string& filename, float scale) const;
+		bool loadSceneCache(const std::string& filename, uint64_t key, VkQueue transferQueue);
+		void saveSceneCache(const std::string& filename, uint64_t key, const tinygltf::Model& gltfModel, const std::vector<BufferData>& vertexStreams, BufferData indexData);
+		void bindVertexBuffers(VkCommandBuffer commandBuffer);
+		uint32_t indirectTextureIndex(const vkglTF::Texture* texture) const;
+		uint32_t loadingFlags = 0;
 	public:
 		vks::VulkanDevice* device;
 		VkDescriptorPool descriptorPool;
 
+		// Interleaved vertices with the default layout, positions only with the quantized layout
 		struct Vertices {
 			int count;
 			VkBuffer buffer;
 			VkDeviceMemory memory;
 		} vertices;
+		// Additional streams of the quantized vertex layout
+		struct VertexStream {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+		};
+		VertexStream attributeStream;
+		VertexStream skinStream;
+		VertexLayout vertexLayout = VertexLayout::Default;
+		/** @brief Size of all vertex streams in bytes */
+		VkDeviceSize vertexBufferSize = 0;
 		struct Indices {
 			int count;
 			VkBuffer buffer;
 			VkDeviceMemory memory;
+			// Optimized meshes use 16 bit indices if no primitive has more than 65536 vertices
+			VkIndexType type = VK_INDEX_TYPE_UINT32;
 		} indices;
 
+		/*
+			Meshlets of all primitives for mesh shading, built with FileLoadingFlags::BuildMeshlets
+			The data is kept on the host and stored in device local storage buffers, the meshlet vertices index into the vertex buffer,
+			which needs VK_BUFFER_USAGE_STORAGE_BUFFER_BIT to be added through vkglTF::memoryPropertyFlags to be read by a mesh shader
+		*/
+		struct StorageBuffer {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDescriptorBufferInfo descriptor{};
+		};
+		struct Meshlets {
+			std::vector<vks::meshoptimizer::Meshlet> meshlets;
+			std::vector<vks::meshoptimizer::MeshletBounds> bounds;
+			std::vector<uint32_t> vertices;
+			// The three local indices of a triangle packed into the lower 24 bits, so shaders don't need 8 bit storage
+			std::vector<uint32_t> triangles;
+			StorageBuffer meshletBuffer;
+			StorageBuffer boundsBuffer;
+			StorageBuffer vertexBuffer;
+			StorageBuffer triangleBuffer;
+		} meshlets;
+
+		/*
+			CPU bounding volume hierarchy over the model space triangles of all primitives in their bind pose, built with FileLoadingFlags::BuildBvh
+			Used to trace rays on the host, e.g. to render reference images or on devices without ray tracing support, hits report the triangle's index into the shared index buffer divided by three
+		*/
+		vks::bvh::Bvh bvh;
+
+		/*
+			GPU driven rendering of all primitives with a handful of indirect draws, set up with prepareIndirectDraw
+			Per draw transforms, bounds and material indices and all materials are stored in storage buffers, all textures in a single (bindless) array
+			A compute shader culls the draws against the view frustum and compacts the visible ones into the indirect command buffer,
+			with one range of commands and one draw count per alpha mode, so drawIndirect only records one indirect draw per alpha mode
+			Every command draws a single instance with firstInstance set to the draw's index, so shaders fetch their draw data with gl_InstanceIndex
+		*/
+		struct IndirectDrawData {
+			glm::mat4 matrix;
+			// World space bounding sphere with the radius in w
+			glm::vec4 boundingSphere;
+			uint32_t materialIndex;
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			int32_t vertexOffset;
+		};
+		struct IndirectMaterialData {
+			glm::vec4 baseColorFactor;
+			// Indices into the texture array, materials without a texture use the empty texture at the end of the array
+			uint32_t baseColorTextureIndex;
+			uint32_t normalTextureIndex;
+			uint32_t alphaMode;
+			float alphaCutoff;
+		};
+		struct IndirectDraw {
+			std::vector<IndirectDrawData> draws;
+			std::vector<IndirectMaterialData> materials;
+			// Draws are sorted by alpha mode, with one range per Material::AlphaMode
+			struct Range {
+				uint32_t firstDraw = 0;
+				uint32_t drawCount = 0;
+			} ranges[3];
+			StorageBuffer drawBuffer;
+			StorageBuffer materialBuffer;
+			// One VkDrawIndexedIndirectCommand per draw, written by the culling shader
+			StorageBuffer commandBuffer;
+			// Visible draws per alpha mode, host visible so they can be read for statistics
+			StorageBuffer countBuffer;
+			uint32_t* visibleCounts = nullptr;
+			// Frustum planes for culling, written by updateIndirectCulling
+			StorageBuffer cullUniformBuffer;
+			void* cullUniformMapped = nullptr;
+			// Set used for drawing: Draw data (binding 0), materials (binding 1) and the texture array (binding 2)
+			VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+			VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+			VkDescriptorSetLayout cullDescriptorSetLayout = VK_NULL_HANDLE;
+			VkDescriptorSet cullDescriptorSet = VK_NULL_HANDLE;
+			VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+			VkPipeline cullPipeline = VK_NULL_HANDLE;
+			// Without vkCmdDrawIndexedIndirectCount the commands aren't compacted, culled draws get an instance count of zero instead
+			PFN_vkCmdDrawIndexedIndirectCount vkCmdDrawIndexedIndirectCount = nullptr;
+		} indirect;
+
+		/*
+			Uniform blocks of all meshes in a single host visible buffer, each mesh owns a range aligned to the uniform buffer offset alignment
+		*/
+		struct NodeBuffer {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			void* mapped = nullptr;
+		} nodeBuffer;
+
+		/*
+			Joint matrices of all skins packed into a single host visible storage buffer, every skin owns a contiguous range of joints (Skin::jointOffset)
+			The buffer holds one copy of the palette per frame, so the matrices of frames still in flight aren't overwritten by updateJointMatrices
+			Shaders select the frame with a dynamic offset (jointPaletteOffset), the descriptor set only contains the palette buffer (binding 0)
+		*/
+		struct JointPalette {
+			StorageBuffer buffer;
+			// Number of joint matrices of all skins
+			uint32_t jointCount = 0;
+			uint32_t frameCount = 0;
+			// Size of one frame's palette, aligned to the storage buffer offset alignment
+			VkDeviceSize frameSize = 0;
+			uint8_t* mapped = nullptr;
+			VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+			VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+		} jointPalette;
+
+		/*
+			Compute pre-skinning set up with prepareSkinning
+			skinVertices writes the model space positions and normals of all mesh vertices into tightly packed buffers with the layout of the vertex buffer,
+			so passes that only need positions (shadow maps, depth prepasses, acceleration structure builds and refits) can reuse them without skinning again
+			Unskinned meshes are transformed with their node matrix, so the whole model is written in model space
+		*/
+		struct Skinning {
+			// Three floats per vertex, usable as VK_FORMAT_R32G32B32_SFLOAT vertex input
+			StorageBuffer positions;
+			StorageBuffer normals;
+			VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+			VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+			VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+			VkPipeline pipeline = VK_NULL_HANDLE;
+		} skinning;
+
 		std::vector<Node*> nodes;
 		std::vector<Node*> linearNodes;
 
@@ -291,6 +543,27 @@ namespace vkglTF
 			float radius;
 		} dimensions;
 
+		/** @brief Allowed increase in vertex cache misses when reordering triangles for overdraw with FileLoadingFlags::OptimizeMeshes */
+		float overdrawThreshold = vks::meshoptimizer::defaultOverdrawThreshold;
+		/** @brief Number of levels of detail (including the full detail level) generated per primitive with FileLoadingFlags::GenerateLods */
+		uint32_t lodCount = 4;
+		/** @brief Fraction of the indices of the previous level each level of detail is simplified to */
+		float lodReduction = 0.5f;
+		/** @brief Maximum error of a level of detail as a fraction of the primitive's extent, simplification stops early if it is reached */
+		float lodMaxError = 0.05f;
+		/** @brief Weight of normal and texture coordinate differences when simplifying */
+		float lodAttributeWeight = vks::meshoptimizer::defaultAttributeWeight;
+		/** @brief Limits for meshlets built with FileLoadingFlags::BuildMeshlets */
+		uint32_t meshletMaxVertices = vks::meshoptimizer::defaultMeshletMaxVertices;
+		uint32_t meshletMaxTriangles = vks::meshoptimizer::defaultMeshletMaxTriangles;
+		/** @brief Store built meshlets next to the glTF file and reuse them on the next load if the source data and limits didn't change */
+		bool meshletCache = true;
+		/** @brief Number of frames the joint palette holds matrices for, needs to be set before loading */
+		uint32_t jointPaletteFrameCount = 2;
+		/** @brief Duration of the last loadFromFile call in milliseconds and whether it was served from the scene cache */
+		double loadTime = 0.0;
+		bool loadedFromSceneCache = false;
+
 		bool metallicRoughnessWorkflow = true;
 		bool buffersBound = false;
 		std::string path;
@@ -308,9 +581,18 @@ namespace vkglTF
 		void draw(VkCommandBuffer commandBuffer, uint32_t renderFlags = 0, VkPipelineLayout pipelineLayout = VK_NULL_HANDLE, uint32_t bindImageSet = 1);
 		void getNodeDimensions(Node* node, glm::vec3& min, glm::vec3& max);
 		void getSceneDimensions();
-		void updateAnimation(uint32_t index, float time);
+		void updateAnimation(uint32_t index, float time, uint32_t frameIndex = 0);
+		void updateJointMatrices(uint32_t frameIndex = 0);
+		uint32_t jointPaletteOffset(uint32_t frameIndex) const;
+		void prepareSkinning(VkPipelineShaderStageCreateInfo skinningShaderStage, VkPipelineCache pipelineCache = VK_NULL_HANDLE);
+		void skinVertices(VkCommandBuffer commandBuffer, uint32_t frameIndex = 0, VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
 		Node* findNode(Node* parent, uint32_t index);
 		Node* nodeFromIndex(uint32_t index);
 		void prepareNodeDescriptor(vkglTF::Node* node, VkDescriptorSetLayout descriptorSetLayout);
+		VkDescriptorSetLayout createMaterialDescriptors(vks::DescriptorManager& descriptorManager, uint32_t descriptorBindingFlags = DescriptorBindingFlags::ImageBaseColor);
+		void prepareIndirectDraw(VkPipelineShaderStageCreateInfo cullShaderStage, bool drawIndirectCount, VkPipelineCache pipelineCache = VK_NULL_HANDLE);
+		void updateIndirectCulling(const glm::vec4* frustumPlanes);
+		void cullIndirect(VkCommandBuffer commandBuffer);
+		void drawIndirect(VkCommandBuffer commandBuffer, uint32_t renderFlags = 0, VkPipelineLayout pipelineLayout = VK_NULL_HANDLE, uint32_t bindSet = 1);
 	};
 }
\ No newline at end of file
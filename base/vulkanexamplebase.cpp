@@ -23,14 +23,48 @@ extern CAMetalLayer* layer;
 
 std::vector<const char*> VulkanExampleBase::args;
 
+// Number of offscreen images that take the place of the swapchain images in headless mode
+static const uint32_t headlessImageCount = 3;
+
+static const char* getPlatformSurfaceExtension()
+{
+#if defined(_WIN32)
+    return VK_KHR_WIN32_SURFACE_EXTENSION_NAME;
+#elif defined(VK_USE_PLATFORM_ANDROID_KHR)
+    return VK_KHR_ANDROID_SURFACE_EXTENSION_NAME;
+#elif defined(_DIRECT2DISPLAY)
+    return VK_KHR_DISPLAY_EXTENSION_NAME;
+#elif defined(VK_USE_PLATFORM_DIRECTFB_EXT)
+    return VK_EXT_DIRECTFB_SURFACE_EXTENSION_NAME;
+#elif defined(VK_USE_PLATFORM_WAYLAND_KHR)
+    return VK_KHR_WAYLAND_SURFACE_EXTENSION_NAME;
+#elif defined(VK_USE_PLATFORM_XCB_KHR)
+    return VK_KHR_XCB_SURFACE_EXTENSION_NAME;
+#elif defined(VK_USE_PLATFORM_IOS_MVK)
+    return VK_MVK_IOS_SURFACE_EXTENSION_NAME;
+#elif defined(VK_USE_PLATFORM_MACOS_MVK)
+    return VK_MVK_MACOS_SURFACE_EXTENSION_NAME;
+#elif defined(VK_USE_PLATFORM_METAL_EXT)
+    return VK_EXT_METAL_SURFACE_EXTENSION_NAME;
+#elif defined(VK_USE_PLATFORM_HEADLESS_EXT)
+    return VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME;
+#elif defined(VK_USE_PLATFORM_SCREEN_QNX)
+    return VK_QNX_SCREEN_SURFACE_EXTENSION_NAME;
+#endif
+}
+
 void VulkanExampleBase::createVulkanAssets()
 {
     vkcpp::VulkanInstanceCreateInfo vulkanInstanceCreateInfo {};
     vulkanInstanceCreateInfo.addLayer("VK_LAYER_KHRONOS_validation");
 
     vulkanInstanceCreateInfo.addExtension("VK_EXT_debug_utils");
-    vulkanInstanceCreateInfo.addExtension("VK_KHR_surface");
-    vulkanInstanceCreateInfo.addExtension("VK_KHR_win32_surface");
+    // VK_KHR_surface is platform independent and required by VK_KHR_swapchain, which in turn makes the present layout used by all render passes valid
+    // The window system surface extension is only required if there is a window to present to
+    vulkanInstanceCreateInfo.addExtension(VK_KHR_SURFACE_EXTENSION_NAME);
+    if (!m_exampleSettings.m_headless) {
+        vulkanInstanceCreateInfo.addExtension(getPlatformSurfaceExtension());
+    }
 
     VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo = vkcpp::DebugUtilsMessenger::getCreateInfo();
     vulkanInstanceCreateInfo.pNext = &debugCreateInfo;
@@ -72,6 +106,12 @@ void VulkanExampleBase::createVulkanAssets()
     deviceCreateInfo.addDeviceQueue(1, 1);
     deviceCreateInfo.addDeviceQueue(1, 1);
 
+    // Also request a queue from the family the device uses for uploads, selected the same way VulkanDevice selects it (families 0 and 1 are already requested)
+    const uint32_t transferQueueFamily = vks::VulkanDevice::getQueueFamilyIndex(physicalDevice.getAllQueueFamilyProperties(), VK_QUEUE_TRANSFER_BIT);
+    if (transferQueueFamily > 1) {
+        deviceCreateInfo.addDeviceQueue(transferQueueFamily, 1);
+    }
+
     vkcpp::DeviceFeatures deviceFeatures = physicalDevice.getPhysicalDeviceFeatures2();
     deviceCreateInfo.setDeviceFeatures(deviceFeatures);
     vkcpp::Device device = vkcpp::Device(deviceCreateInfo, physicalDevice);
@@ -81,10 +121,11 @@ void VulkanExampleBase::createVulkanAssets()
 
 void VulkanExampleBase::renderFrame()
 {
-    VulkanExampleBase::prepareFrame();
+    VulkanExampleBase::prepareFrame(false);
     m_vkSubmitInfo.commandBufferCount = 1;
     m_vkSubmitInfo.pCommandBuffers = &drawCmdBuffers[m_currentBufferIndex];
-    VK_CHECK_RESULT(vkQueueSubmit(m_vkQueue, 1, &m_vkSubmitInfo, VK_NULL_HANDLE));
+    // Ownership acquires of pending uploads are submitted in the same vkQueueSubmit call as the frame
+    m_pVulkanDevice->stagingRing.submitGraphics(m_vkSubmitInfo, VK_NULL_HANDLE);
     VulkanExampleBase::submitFrame();
 }
 
@@ -128,9 +169,14 @@ void VulkanExampleBase::createPipelineCache()
 
 void VulkanExampleBase::prepare()
 {
-    createSurface();
-    createCommandPool();
-    createSwapChain();
+    if (m_exampleSettings.m_headless) {
+        createHeadlessTargets();
+        createCommandPool();
+    } else {
+        createSurface();
+        createCommandPool();
+        createSwapChain();
+    }
     createCommandBuffers();
     createSynchronizationPrimitives();
     setupDepthStencil();
@@ -166,6 +212,21 @@ VkPipelineShaderStageCreateInfo VulkanExampleBase::loadShader(std::string fileNa
     return shaderStage;
 }
 
+bool VulkanExampleBase::shaderExists(const std::string& fileName) const
+{
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+    // Shaders are packaged as assets on Android
+    AAsset* asset = AAssetManager_open(androidApp->activity->assetManager, fileName.c_str(), AASSET_MODE_UNKNOWN);
+    if (!asset) {
+        return false;
+    }
+    AAsset_close(asset);
+    return true;
+#else
+    return vks::tools::fileExists(fileName);
+#endif
+}
+
 void VulkanExampleBase::nextFrame()
 {
     auto tStart = std::chrono::high_resolution_clock::now();
@@ -198,7 +259,7 @@ void VulkanExampleBase::nextFrame()
     if (fpsTimer > 1000.0f) {
         m_lastFPS = static_cast<uint32_t>((float)m_frameCounter * (1000.0f / fpsTimer));
 #if defined(_WIN32)
-        if (!m_exampleSettings.m_showUIOverlay) {
+        if (!m_exampleSettings.m_showUIOverlay && !m_exampleSettings.m_headless) {
             std::string windowTitle = getWindowTitle();
             SetWindowText(m_hwnd, windowTitle.c_str());
         }
@@ -241,6 +302,21 @@ void VulkanExampleBase::renderLoop()
     }
 #endif
 
+    // There are no window events to handle in headless mode, so frames are rendered until all requested captures have been taken
+    if (m_exampleSettings.m_headless) {
+        if (m_exampleSettings.m_captureFrames == 0) {
+            std::cout << "Headless mode without --benchmark or --capture-frames, rendering a single frame\n";
+        }
+        m_lastTimestamp = std::chrono::high_resolution_clock::now();
+        m_tPrevEnd = m_lastTimestamp;
+        do {
+            nextFrame();
+        } while (m_capturedFrames < m_exampleSettings.m_captureFrames);
+        vkDeviceWaitIdle(m_deviceOriginal);
+        m_frameCapture.waitIdle();
+        return;
+    }
+
     m_destWidth = m_drawAreaWidth;
     m_destHeight = m_drawAreaHeight;
     m_lastTimestamp = std::chrono::high_resolution_clock::now();
@@ -611,8 +687,17 @@ void VulkanExampleBase::drawUI(const VkCommandBuffer commandBuffer)
     }
 }
 
-void VulkanExampleBase::prepareFrame()
+void VulkanExampleBase::prepareFrame(bool submitPendingAcquires)
 {
+    // Samples submitting their frames on their own need the acquires of uploads done since the last frame in front of their work
+    if (submitPendingAcquires) {
+        m_pVulkanDevice->stagingRing.submitAcquires();
+    }
+    // Offscreen images are used round robin, frames are serialized by the queue wait in submitFrame
+    if (m_exampleSettings.m_headless) {
+        m_currentBufferIndex = (m_currentBufferIndex + 1) % m_swapChain.imageCount;
+        return;
+    }
     // Acquire the next m_vkImage from the swap chain
     VkResult result = m_swapChain.acquireNextImage(semaphores.m_vkSemaphorePresentComplete, m_currentBufferIndex);
     // Recreate the swapchain if it's no longer compatible with the m_vkSurface (OUT_OF_DATE)
@@ -629,6 +714,12 @@ void VulkanExampleBase::prepareFrame()
 
 void VulkanExampleBase::submitFrame()
 {
+    // Captures have to be copied after the frame's commands and before the image is handed to the presentation engine
+    captureCurrentFrame();
+    if (m_exampleSettings.m_headless) {
+        VK_CHECK_RESULT(vkQueueWaitIdle(m_vkQueue));
+        return;
+    }
     VkResult result = m_swapChain.queuePresent(m_vkQueue, m_currentBufferIndex, semaphores.m_vkSemaphoreRenderComplete);
     // Recreate the swapchain if it's no longer compatible with the m_vkSurface (OUT_OF_DATE) or no longer optimal for presentation (SUBOPTIMAL)
     if ((result == VK_ERROR_OUT_OF_DATE_KHR) || (result == VK_SUBOPTIMAL_KHR)) {
@@ -642,6 +733,62 @@ void VulkanExampleBase::submitFrame()
     VK_CHECK_RESULT(vkQueueWaitIdle(m_vkQueue));
 }
 
+std::vector<VkSemaphore> VulkanExampleBase::getPresentWaitSemaphores() const
+{
+    // Nothing is acquired in headless mode, so nothing would ever signal the present complete semaphore
+    if (m_exampleSettings.m_headless) {
+        return {};
+    }
+    return { semaphores.m_vkSemaphorePresentComplete };
+}
+
+std::vector<VkSemaphore> VulkanExampleBase::getPresentSignalSemaphores() const
+{
+    if (m_exampleSettings.m_headless) {
+        return {};
+    }
+    return { semaphores.m_vkSemaphoreRenderComplete };
+}
+
+void VulkanExampleBase::captureFrame(const std::string& filename, vks::FrameCapture::FileFormat fileFormat)
+{
+    m_captureRequest = filename;
+    m_captureRequestFormat = fileFormat;
+}
+
+void VulkanExampleBase::captureCurrentFrame()
+{
+    std::string filename;
+    vks::FrameCapture::FileFormat fileFormat;
+    if (!m_captureRequest.empty()) {
+        filename = m_captureRequest;
+        fileFormat = m_captureRequestFormat;
+        m_captureRequest.clear();
+    } else if (m_capturedFrames < m_exampleSettings.m_captureFrames) {
+        char index[16];
+        snprintf(index, sizeof(index), "%05u", m_capturedFrames++);
+        filename = name + "_" + index + vks::FrameCapture::fileExtension(m_exampleSettings.m_captureFileFormat);
+        fileFormat = m_exampleSettings.m_captureFileFormat;
+    } else {
+        return;
+    }
+
+    // Readback buffers are created on first use and recreated if the swapchain has changed
+    if (m_frameCapture.isCreated() && ((m_frameCapture.getWidth() != m_drawAreaWidth) || (m_frameCapture.getHeight() != m_drawAreaHeight) || (m_frameCapture.getFormat() != m_swapChain.colorFormat))) {
+        m_frameCapture.destroy();
+    }
+    if (!m_frameCapture.isCreated()) {
+        if (!m_frameCapture.create(m_pVulkanDevice, m_pVulkanDevice->queueFamilyIndices.graphics, m_drawAreaWidth, m_drawAreaHeight, m_swapChain.colorFormat)) {
+            // Unsupported formats are reported by create, further captures are skipped
+            m_exampleSettings.m_captureFrames = m_capturedFrames;
+            return;
+        }
+    }
+    // The copy waits on the render complete semaphore and signals it again for presentation (no semaphores are used in headless mode)
+    const VkSemaphore semaphore = m_exampleSettings.m_headless ? VK_NULL_HANDLE : semaphores.m_vkSemaphoreRenderComplete;
+    m_frameCapture.capture(m_vkQueue, m_swapChain.images[m_currentBufferIndex], VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, filename, fileFormat, semaphore);
+}
+
 void VulkanExampleBase::setCommandLineOptions()
 {
     m_commandLineParser.add("help", { "--help" }, 0, "Show help");
@@ -660,6 +807,10 @@ void VulkanExampleBase::setCommandLineOptions()
     m_commandLineParser.add("benchmarkresultfile", { "-bf", "--benchfilename" }, 1, "Set file name for m_benchmark results");
     m_commandLineParser.add("benchmarkresultframes", { "-bt", "--benchframetimes" }, 0, "Save frame times to m_benchmark results file");
     m_commandLineParser.add("benchmarkframes", { "-bfs", "--benchmarkframes" }, 1, "Only render the given number of frames");
+    m_commandLineParser.add("headless", { "--headless" }, 0, "Render into offscreen images without a window or swapchain");
+    m_commandLineParser.add("captureframes", { "-cf", "--capture-frames" }, 1, "Write the given number of frames to image files");
+    m_commandLineParser.add("captureformat", { "-cff", "--capture-format" }, 1, "Set file format for captured frames (ppm, png or raw)");
+    m_commandLineParser.add("nohostimagecopy", { "-nhic", "--nohostimagecopy" }, 0, "Upload textures through staging memory even if host image copies are supported");
 #if (!(defined(VK_USE_PLATFORM_IOS_MVK) || defined(VK_USE_PLATFORM_MACOS_MVK) || defined(VK_USE_PLATFORM_METAL_EXT)))
     m_commandLineParser.add("resourcepath", { "-rp", "--resourcepath" }, 1, "Set path for dir where assets and shaders folder is present");
 #endif
@@ -698,6 +849,9 @@ void VulkanExampleBase::setCommandLineOptions()
             m_shaderDir = value;
         }
     }
+    if (m_commandLineParser.isSet("nohostimagecopy")) {
+        m_exampleSettings.m_disableHostImageCopy = true;
+    }
     if (m_commandLineParser.isSet("m_benchmark")) {
         m_benchmark.active = true;
         vks::tools::errorModeSilent = true;
@@ -718,6 +872,15 @@ void VulkanExampleBase::setCommandLineOptions()
         m_benchmark.outputFrames = m_commandLineParser.getValueAsInt("benchmarkframes", m_benchmark.outputFrames);
     }
 #if (!(defined(VK_USE_PLATFORM_IOS_MVK) || defined(VK_USE_PLATFORM_MACOS_MVK) || defined(VK_USE_PLATFORM_METAL_EXT)))
+    if (m_commandLineParser.isSet("headless")) {
+        m_exampleSettings.m_headless = true;
+    }
+    if (m_commandLineParser.isSet("captureframes")) {
+        m_exampleSettings.m_captureFrames = m_commandLineParser.getValueAsInt("captureframes", 0);
+    }
+    if (m_commandLineParser.isSet("captureformat")) {
+        m_exampleSettings.m_captureFileFormat = vks::FrameCapture::fileFormatFromString(m_commandLineParser.getValueAsString("captureformat", "ppm"));
+    }
     if (m_commandLineParser.isSet("resourcepath")) {
         vks::tools::resourcePath = m_commandLineParser.getValueAsString("resourcepath", "");
     }
@@ -770,9 +933,13 @@ VulkanExampleBase::VulkanExampleBase()
 #elif defined(_DIRECT2DISPLAY)
 
 #elif defined(VK_USE_PLATFORM_WAYLAND_KHR)
-    initWaylandConnection();
+    if (!m_exampleSettings.m_headless) {
+        initWaylandConnection();
+    }
 #elif defined(VK_USE_PLATFORM_XCB_KHR)
-    initxcbConnection();
+    if (!m_exampleSettings.m_headless) {
+        initxcbConnection();
+    }
 #endif
 
 #if defined(_WIN32)
@@ -788,7 +955,11 @@ VulkanExampleBase::VulkanExampleBase()
 
 VulkanExampleBase::~VulkanExampleBase()
 {
+    // Write out captures that are still in flight
+    m_frameCapture.destroy();
+
     // Clean up Vulkan resources
+    destroyHeadlessTargets();
     m_swapChain.cleanup();
     if (m_vkDescriptorPool != VK_NULL_HANDLE) {
         vkDestroyDescriptorPool(m_deviceOriginal, m_vkDescriptorPool, nullptr);
@@ -822,6 +993,9 @@ VulkanExampleBase::~VulkanExampleBase()
         m_UIOverlay.freeResources();
     }
 
+    if (m_pVulkanDevice) {
+        m_pVulkanDevice->printTextureUploads();
+    }
     delete m_pVulkanDevice;
 
     //if (m_exampleSettings.m_useValidationLayers) {
@@ -844,26 +1018,32 @@ VulkanExampleBase::~VulkanExampleBase()
     if (dfb)
         dfb->Release(dfb);
 #elif defined(VK_USE_PLATFORM_WAYLAND_KHR)
-    xdg_toplevel_destroy(xdg_toplevel);
-    xdg_surface_destroy(xdg_surface);
-    wl_surface_destroy(m_vkSurface);
-    if (keyboard)
-        wl_keyboard_destroy(keyboard);
-    if (pointer)
-        wl_pointer_destroy(pointer);
-    if (seat)
-        wl_seat_destroy(seat);
-    xdg_wm_base_destroy(shell);
-    wl_compositor_destroy(compositor);
-    wl_registry_destroy(registry);
-    wl_display_disconnect(display);
+    if (!m_exampleSettings.m_headless) {
+        xdg_toplevel_destroy(xdg_toplevel);
+        xdg_surface_destroy(xdg_surface);
+        wl_surface_destroy(m_vkSurface);
+        if (keyboard)
+            wl_keyboard_destroy(keyboard);
+        if (pointer)
+            wl_pointer_destroy(pointer);
+        if (seat)
+            wl_seat_destroy(seat);
+        xdg_wm_base_destroy(shell);
+        wl_compositor_destroy(compositor);
+        wl_registry_destroy(registry);
+        wl_display_disconnect(display);
+    }
 #elif defined(VK_USE_PLATFORM_XCB_KHR)
-    xcb_destroy_window(connection, m_hwnd);
-    xcb_disconnect(connection);
+    if (!m_exampleSettings.m_headless) {
+        xcb_destroy_window(connection, m_hwnd);
+        xcb_disconnect(connection);
+    }
 #elif defined(VK_USE_PLATFORM_SCREEN_QNX)
-    screen_destroy_event(screen_event);
-    screen_destroy_window(screen_window);
-    screen_destroy_context(screen_context);
+    if (!m_exampleSettings.m_headless) {
+        screen_destroy_event(screen_event);
+        screen_destroy_window(screen_window);
+        screen_destroy_context(screen_context);
+    }
 #endif
 }
 
@@ -894,6 +1074,10 @@ bool VulkanExampleBase::initVulkan()
     // This is handled by a separate class that gets a logical m_vkDevice representation
     // and encapsulates functions related to a m_vkDevice
     m_pVulkanDevice = new vks::VulkanDevice(m_physicalDeviceOriginal, m_deviceOriginal);
+    // Allows comparing texture load times and memory between host image copies and staged uploads
+    if (m_exampleSettings.m_disableHostImageCopy) {
+        m_pVulkanDevice->hostImageCopy.supported = false;
+    }
 
     // Derived examples can enable extensions based on the list of supported extensions read from the physical m_vkDevice
     getEnabledExtensions();
@@ -901,6 +1085,14 @@ bool VulkanExampleBase::initVulkan()
     // Get a graphics m_vkQueue from the m_vkDevice
     vkGetDeviceQueue(m_deviceOriginal, m_pVulkanDevice->queueFamilyIndices.graphics, 0, &m_vkQueue);
 
+    // Staging memory for all uploads to device local resources is allocated once up front
+    // If the device has a dedicated transfer family, uploads are executed on that queue and overlap with rendering
+    VkQueue transferQueue { VK_NULL_HANDLE };
+    if (m_pVulkanDevice->queueFamilyIndices.transfer != m_pVulkanDevice->queueFamilyIndices.graphics) {
+        vkGetDeviceQueue(m_deviceOriginal, m_pVulkanDevice->queueFamilyIndices.transfer, 0, &transferQueue);
+    }
+    m_pVulkanDevice->stagingRing.create(m_pVulkanDevice, m_vkQueue, m_pVulkanDevice->queueFamilyIndices.graphics, transferQueue, m_pVulkanDevice->queueFamilyIndices.transfer);
+
     // Find a suitable depth and/or stencil format
     VkBool32 validFormat { false };
     // Samples that make use of stencil will require a depth + stencil format, so we select from a different list
@@ -927,9 +1119,10 @@ bool VulkanExampleBase::initVulkan()
     // Command buffer submission info is set by each example
     m_vkSubmitInfo = vks::initializers::submitInfo();
     m_vkSubmitInfo.pWaitDstStageMask = &submitPipelineStages;
-    m_vkSubmitInfo.waitSemaphoreCount = 1;
+    // Without image acquisition and presentation nothing would signal or wait on these semaphores, samples with their own semaphore lists use getPresentWaitSemaphores / getPresentSignalSemaphores
+    m_vkSubmitInfo.waitSemaphoreCount = m_exampleSettings.m_headless ? 0 : 1;
     m_vkSubmitInfo.pWaitSemaphores = &semaphores.m_vkSemaphorePresentComplete;
-    m_vkSubmitInfo.signalSemaphoreCount = 1;
+    m_vkSubmitInfo.signalSemaphoreCount = m_exampleSettings.m_headless ? 0 : 1;
     m_vkSubmitInfo.pSignalSemaphores = &semaphores.m_vkSemaphoreRenderComplete;
 
     return true;
@@ -2759,7 +2952,7 @@ void VulkanExampleBase::setupDepthStencil()
     imageCI.arrayLayers = 1;
     imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
     imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
-    imageCI.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    imageCI.usage = m_depthStencilUsage;
 
     VK_CHECK_RESULT(vkCreateImage(m_deviceOriginal, &imageCI, nullptr, &m_defaultDepthStencil.m_vkImage));
     VkMemoryRequirements memReqs {};
@@ -3001,6 +3194,61 @@ void VulkanExampleBase::createSurface()
 #endif
 }
 
+void VulkanExampleBase::createHeadlessTargets()
+{
+    // The offscreen images are stored in place of the swapchain images, so samples set up their frame buffers and command buffers unchanged
+    m_swapChain.queueNodeIndex = m_pVulkanDevice->queueFamilyIndices.graphics;
+    m_swapChain.colorFormat = VK_FORMAT_B8G8R8A8_UNORM;
+    m_swapChain.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    m_swapChain.imageCount = headlessImageCount;
+    m_swapChain.images.resize(headlessImageCount);
+    m_swapChain.imageViews.resize(headlessImageCount);
+    m_headlessImageMemory.resize(headlessImageCount);
+    for (uint32_t i = 0; i < headlessImageCount; i++) {
+        VkImageCreateInfo imageCI = vks::initializers::imageCreateInfo();
+        imageCI.imageType = VK_IMAGE_TYPE_2D;
+        imageCI.format = m_swapChain.colorFormat;
+        imageCI.extent = { m_drawAreaWidth, m_drawAreaHeight, 1 };
+        imageCI.mipLevels = 1;
+        imageCI.arrayLayers = 1;
+        imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+        // Same usage as the swapchain images, transfer source is required for frame capture
+        imageCI.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VK_CHECK_RESULT(vkCreateImage(m_deviceOriginal, &imageCI, nullptr, &m_swapChain.images[i]));
+
+        VkMemoryRequirements memReqs;
+        vkGetImageMemoryRequirements(m_deviceOriginal, m_swapChain.images[i], &memReqs);
+        VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
+        memAlloc.allocationSize = memReqs.size;
+        memAlloc.memoryTypeIndex = m_pVulkanDevice->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        VK_CHECK_RESULT(vkAllocateMemory(m_deviceOriginal, &memAlloc, nullptr, &m_headlessImageMemory[i]));
+        VK_CHECK_RESULT(vkBindImageMemory(m_deviceOriginal, m_swapChain.images[i], m_headlessImageMemory[i], 0));
+
+        VkImageViewCreateInfo imageViewCI = vks::initializers::imageViewCreateInfo();
+        imageViewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        imageViewCI.format = m_swapChain.colorFormat;
+        imageViewCI.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        imageViewCI.image = m_swapChain.images[i];
+        VK_CHECK_RESULT(vkCreateImageView(m_deviceOriginal, &imageViewCI, nullptr, &m_swapChain.imageViews[i]));
+    }
+}
+
+void VulkanExampleBase::destroyHeadlessTargets()
+{
+    for (size_t i = 0; i < m_headlessImageMemory.size(); i++) {
+        vkDestroyImageView(m_deviceOriginal, m_swapChain.imageViews[i], nullptr);
+        vkDestroyImage(m_deviceOriginal, m_swapChain.images[i], nullptr);
+        vkFreeMemory(m_deviceOriginal, m_headlessImageMemory[i], nullptr);
+    }
+    if (!m_headlessImageMemory.empty()) {
+        m_swapChain.images.clear();
+        m_swapChain.imageViews.clear();
+        m_headlessImageMemory.clear();
+    }
+}
+
 void VulkanExampleBase::createSwapChain()
 {
     m_swapChain.create(m_drawAreaWidth, m_drawAreaHeight, m_exampleSettings.m_forceSwapChainVsync, m_exampleSettings.m_fullscreen);
@@ -70,6 +70,7 @@
 #include "VulkanBuffer.h"
 #include "VulkanDevice.h"
 #include "VulkanTexture.h"
+#include "VulkanFrameCapture.h"
 
 #include "VulkanInitializers.hpp"
 #include "camera.hpp"
@@ -101,8 +102,19 @@ private:
 	void createSynchronizationPrimitives();
 	void createSurface();
 	void createSwapChain();
+	void createHeadlessTargets();
+	void destroyHeadlessTargets();
 	void createCommandBuffers();
 	void destroyCommandBuffers();
+	void captureCurrentFrame();
+
+	// Number of frames written in frame capture mode
+	uint32_t m_capturedFrames = 0;
+	// Memory backing the offscreen images that replace the swapchain images in headless mode
+	std::vector<VkDeviceMemory> m_headlessImageMemory;
+	// Single capture requested via captureFrame() (empty if none)
+	std::string m_captureRequest;
+	vks::FrameCapture::FileFormat m_captureRequestFormat = vks::FrameCapture::FileFormat::PPM;
 
 protected:
 
@@ -190,6 +202,9 @@ public:
 
 	vks::Benchmark m_benchmark;
 
+	/** @brief Asynchronous readback of presented images for frame capture mode and captureFrame() */
+	vks::FrameCapture m_frameCapture;
+
 	/** @brief Encapsulated physical and logical vulkan device */
 	vks::VulkanDevice *m_pVulkanDevice{};
 
@@ -204,6 +219,14 @@ public:
 		bool m_forceSwapChainVsync = false;
 		/** @brief Enable UI overlay */
 		bool m_showUIOverlay = true;
+		/** @brief Number of frames to write to image files after startup (0 = frame capture disabled) */
+		uint32_t m_captureFrames = 0;
+		/** @brief File format used in frame capture mode */
+		vks::FrameCapture::FileFormat m_captureFileFormat = vks::FrameCapture::FileFormat::PPM;
+		/** @brief Render into a ring of offscreen images instead of a window's swapchain (set via --headless) */
+		bool m_headless = false;
+		/** @brief Upload textures through the staging ring even if the device supports host image copies (set via --nohostimagecopy) */
+		bool m_disableHostImageCopy = false;
 	} m_exampleSettings;
 
 	/** @brief State of gamepad input (only used on Android) */
@@ -245,6 +268,8 @@ public:
 		VkDeviceMemory m_vkDeviceMemory;
 		VkImageView m_vkImageView;
 	} m_defaultDepthStencil{};
+	/** @brief Usage of the default depth stencil image, samples that read the depth buffer (e.g. for occlusion culling) can add VK_IMAGE_USAGE_SAMPLED_BIT */
+	VkImageUsageFlags m_depthStencilUsage{ VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT };
 
 	// OS specific
 #if defined(_WIN32)
@@ -416,6 +441,8 @@ public:
 
 	/** @brief Loads a SPIR-V shader file for the given shader stage */
 	VkPipelineShaderStageCreateInfo loadShader(std::string fileName, VkShaderStageFlagBits stage);
+	/** @brief Checks if a SPIR-V shader file is present, used to disable optional features whose shaders haven't been compiled for the selected shading language */
+	bool shaderExists(const std::string& fileName) const;
 
 	void windowResize();
 
@@ -425,10 +452,19 @@ public:
 	/** @brief Adds the drawing commands for the ImGui overlay to the given command buffer */
 	void drawUI(const VkCommandBuffer commandBuffer);
 
-	/** Prepare the next frame for workload submission by acquiring the next swap chain m_vkImage */
-	void prepareFrame();
+	/**
+	* Prepare the next frame for workload submission by acquiring the next swap chain m_vkImage
+	* Also submits the graphics queue ownership acquires of pending uploads, unless the frame's work is submitted through the device's staging ring (submitPendingAcquires = false)
+	*/
+	void prepareFrame(bool submitPendingAcquires = true);
 	/** @brief Presents the current image to the swap chain */
 	void submitFrame();
+	/** @brief Semaphores the first submission of a frame has to wait on for the acquired swap chain image (empty in headless mode) */
+	std::vector<VkSemaphore> getPresentWaitSemaphores() const;
+	/** @brief Semaphores the last submission of a frame has to signal before the image can be presented (empty in headless mode) */
+	std::vector<VkSemaphore> getPresentSignalSemaphores() const;
+	/** @brief Writes the next presented frame to the given file, the capture is done asynchronously and doesn't stall the render loop */
+	void captureFrame(const std::string& filename, vks::FrameCapture::FileFormat fileFormat = vks::FrameCapture::FileFormat::PPM);
 	/** @brief (Virtual) Default image acquire + submission and command buffer submission function */
 	virtual void renderFrame();
 
@@ -3,6 +3,8 @@
 *
 * A compute shader updates a shader storage buffer that contains particles held together by springs and also does basic
 * collision detection against a sphere. This storage buffer is then used as the vertex input for the graphics part of the sample
+* Grid size and substeps can be changed at runtime, several solver iterations can be merged into one dispatch in shared memory,
+* the cloth can collide with itself (spatial hash) and with an arbitrary mesh (signed distance field)
 *
 * Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
 *
@@ -11,6 +13,7 @@
 
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
+#include "SignedDistanceField.h"
 
 
 class VulkanExample : public VulkanExampleBase
@@ -19,6 +22,7 @@ public:
 	uint32_t readSet{ 0 };
 	uint32_t m_indexCount{ 0 };
 	bool simulateWind{ false };
+	bool selfCollision{ false };
 	// This will be set to true, if the m_vkDevice has a dedicated m_vkQueue from a compute only m_vkQueue family
 	// With such a m_vkQueue graphics and compute workloads can run in parallel, but this also requires additional barriers (often called "async compute")
 	// These barriers will release and acquire the resources used in graphics and compute between the different m_vkQueue families
@@ -26,6 +30,38 @@ public:
 
 	vks::Texture2D textureCloth;
 	vkglTF::Model modelSphere;
+	// Arbitrary mesh collider, the cloth collides with its signed distance field
+	vkglTF::Model modelMesh;
+
+	enum Collider : int32_t { Sphere = 0, Mesh = 1 };
+	int32_t collider{ Sphere };
+	// Scales and centers the mesh collider, the distance field is stored in the same (world) space
+	glm::mat4 meshTransform{ 1.0f };
+	vks::Buffer sdfBuffer;
+	const uint32_t sdfResolution{ 48 };
+
+	// Particles per side of the cloth
+	const std::vector<uint32_t> gridSizes = { 60, 128, 256, 512 };
+	int32_t gridSizeIndex{ 0 };
+	// Solver iterations per frame, a multiple of twice the largest number of iterations per dispatch so the result ends up in the output buffer
+	const std::vector<uint32_t> substepCounts = { 16, 32, 64, 128, 256 };
+	int32_t substepIndex{ 2 };
+	// 1 runs every iteration as a separate dispatch, more iterations per dispatch are merged in shared memory (cloth_tiled.comp)
+	const std::vector<uint32_t> iterationsPerDispatch = { 1, 2, 4 };
+	int32_t iterationsPerDispatchIndex{ 1 };
+	// The merged solver and self collision are only available if their shaders have been compiled for the selected shading language
+	bool tiledSupported{ false };
+	bool selfCollisionSupported{ false };
+	// Tiles of the merged solver cover 32 x 32 particles and overlap by the number of iterations per dispatch
+	const uint32_t tileSize{ 32 };
+
+	struct BenchmarkResult {
+		uint32_t gridSize;
+		uint32_t iterationsPerDispatch;
+		// Simulated vertices times substeps per second
+		double vertexSubstepsPerSecond;
+	};
+	std::vector<BenchmarkResult> benchmarkResults;
 
 	// The cloth is made from a grid of particles
 	struct Particle {
@@ -50,6 +86,15 @@ public:
 		vks::Buffer output;
 	} storageBuffers;
 
+	// Self collision hash table, each bucket counts the particles inserted into it and stores up to bucketCapacity of them
+	struct SelfCollisionBuffers {
+		vks::Buffer counts;
+		vks::Buffer entries;
+		uint32_t tableSize{ 0 };
+	} selfCollisionBuffers;
+	// Needs to match BUCKET_CAPACITY in cloth.glsl
+	static constexpr uint32_t bucketCapacity = 8;
+
 	// Resources for the graphics part of the example
 	struct Graphics {
 		VkDescriptorSetLayout descriptorSetLayout{ VK_NULL_HANDLE };
@@ -85,6 +130,13 @@ public:
 		std::array<VkDescriptorSet, 2> descriptorSets{ VK_NULL_HANDLE };
 		VkPipelineLayout pipelineLayout{ VK_NULL_HANDLE };
 		VkPipeline pipeline{ VK_NULL_HANDLE };
+		// Merged solver for 2 and 4 iterations per dispatch
+		std::array<VkPipeline, 2> pipelinesTiled{};
+		VkPipeline pipelineHash{ VK_NULL_HANDLE };
+		VkPipeline pipelineSelfCollision{ VK_NULL_HANDLE };
+		// Timestamps at the start and end of each compute command buffer, only written if the compute m_vkQueue supports them
+		VkQueryPool timestampQueryPool{ VK_NULL_HANDLE };
+		float solverTime{ 0.0f };
 		struct UniformData {
 			float deltaT{ 0.0f };
 			// These arguments define the spring setup for the cloth piece
@@ -99,6 +151,12 @@ public:
 			glm::vec4 spherePos{ 0.0f, 0.0f, 0.0f, 0.0f };
 			glm::vec4 gravity{ 0.0f, 9.8f, 0.0f, 0.0f };
 			glm::ivec2 particleCount{ 0 };
+			uint32_t collider{ Sphere };
+			float selfCollisionDistance{ 0.0f };
+			// xyz: World space position of the first distance field sample, w: Distance between samples
+			glm::vec4 sdfOrigin{ 0.0f };
+			uint32_t sdfResolution{ 0 };
+			uint32_t hashTableSize{ 0 };
 		} uniformData;
 		vks::Buffer uniformBuffer;
 	} compute;
@@ -129,6 +187,12 @@ public:
 			vkDestroyPipelineLayout(m_vkDevice, compute.pipelineLayout, nullptr);
 			vkDestroyDescriptorSetLayout(m_vkDevice, compute.descriptorSetLayout, nullptr);
 			vkDestroyPipeline(m_vkDevice, compute.pipeline, nullptr);
+			for (VkPipeline pipeline : compute.pipelinesTiled) {
+				vkDestroyPipeline(m_vkDevice, pipeline, nullptr);
+			}
+			vkDestroyPipeline(m_vkDevice, compute.pipelineHash, nullptr);
+			vkDestroyPipeline(m_vkDevice, compute.pipelineSelfCollision, nullptr);
+			vkDestroyQueryPool(m_vkDevice, compute.timestampQueryPool, nullptr);
 			for (uint32_t i = 0; i < compute.semaphores.size(); i++) {
 				vkDestroySemaphore(m_vkDevice, compute.semaphores[i].ready, nullptr);
 				vkDestroySemaphore(m_vkDevice, compute.semaphores[i].complete, nullptr);
@@ -138,6 +202,9 @@ public:
 			// SSBOs
 			storageBuffers.input.destroy();
 			storageBuffers.output.destroy();
+			selfCollisionBuffers.counts.destroy();
+			selfCollisionBuffers.entries.destroy();
+			sdfBuffer.destroy();
 		}
 	}
 
@@ -153,6 +220,8 @@ public:
 	{
 		const uint32_t glTFLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::PreMultiplyVertexColors | vkglTF::FileLoadingFlags::FlipY;
 		modelSphere.loadFromFile(getAssetPath() + "models/sphere.gltf", m_pVulkanDevice, m_vkQueue, glTFLoadingFlags);
+		// The distance field is built from the model's BVH
+		modelMesh.loadFromFile(getAssetPath() + "models/teapot.gltf", m_pVulkanDevice, m_vkQueue, glTFLoadingFlags | vkglTF::FileLoadingFlags::BuildBvh);
 		textureCloth.loadFromFile(getAssetPath() + "textures/vulkan_cloth_rgba.ktx", VK_FORMAT_R8G8B8A8_UNORM, m_pVulkanDevice, m_vkQueue);
 	}
 
@@ -278,10 +347,16 @@ public:
 
 			VkDeviceSize offsets[1] = { 0 };
 
-			// Render sphere
+			// Render the collider
 			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphics.pipelines.sphere);
 			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphics.pipelineLayout, 0, 1, &graphics.descriptorSet, 0, NULL);
-			modelSphere.draw(drawCmdBuffers[i]);
+			const glm::mat4 colliderTransform = (collider == Mesh) ? meshTransform : glm::mat4(1.0f);
+			vkCmdPushConstants(drawCmdBuffers[i], graphics.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &colliderTransform);
+			if (collider == Mesh) {
+				modelMesh.draw(drawCmdBuffers[i]);
+			} else {
+				modelSphere.draw(drawCmdBuffers[i]);
+			}
 
 			// Render cloth
 			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphics.pipelines.cloth);
@@ -302,6 +377,73 @@ public:
 
 	}
 
+	/*
+		Record the solver iterations of one frame, followed by the optional self collision passes
+		Every dispatch of the merged solver runs several iterations in shared memory, so there are fewer dispatches and barriers per frame
+	*/
+	void recordSimulation(VkCommandBuffer commandBuffer)
+	{
+		const uint32_t substeps = substepCounts[substepIndex];
+		const uint32_t localIterations = iterationsPerDispatch[iterationsPerDispatchIndex];
+		// SRS - Dispatches **must** be an even number, so that readSet starts at 1 and the final result ends up in output.buffer with readSet equal to 0
+		const uint32_t dispatches = substeps / localIterations;
+		assert((dispatches % 2) == 0);
+
+		if (selfCollision) {
+			// Previously recorded collision passes need to be done reading the counts before they're cleared
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_FLAGS_NONE, 0, nullptr, 0, nullptr, 0, nullptr);
+			vkCmdFillBuffer(commandBuffer, selfCollisionBuffers.counts.buffer, 0, VK_WHOLE_SIZE, 0);
+			VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_FLAGS_NONE, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+		}
+
+		glm::uvec2 groupCount;
+		if (localIterations == 1) {
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipeline);
+			groupCount = (cloth.gridsize + glm::uvec2(9)) / glm::uvec2(10);
+		} else {
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelinesTiled[iterationsPerDispatchIndex - 1]);
+			const uint32_t tileOutput = tileSize - 2 * localIterations;
+			groupCount = (cloth.gridsize + glm::uvec2(tileOutput - 1)) / glm::uvec2(tileOutput);
+		}
+
+		uint32_t calculateNormals = 0;
+		vkCmdPushConstants(commandBuffer, compute.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &calculateNormals);
+
+		for (uint32_t j = 0; j < dispatches; j++) {
+			readSet = 1 - readSet;
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelineLayout, 0, 1, &compute.descriptorSets[readSet], 0, 0);
+
+			if (j == dispatches - 1) {
+				calculateNormals = 1;
+				vkCmdPushConstants(commandBuffer, compute.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &calculateNormals);
+			}
+
+			vkCmdDispatch(commandBuffer, groupCount.x, groupCount.y, 1);
+
+			// Don't add a barrier on the last iteration of the loop, since we'll have an explicit release to the graphics m_vkQueue
+			if ((j != dispatches - 1) || selfCollision) {
+				addComputeToComputeBarriers(commandBuffer, readSet);
+			}
+		}
+
+		if (selfCollision) {
+			// Both passes work on the output buffer, which is bound at binding 1 of the first descriptor set
+			const uint32_t particleGroupCount = (cloth.gridsize.x * cloth.gridsize.y + 255) / 256;
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelineLayout, 0, 1, &compute.descriptorSets[0], 0, 0);
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelineHash);
+			vkCmdDispatch(commandBuffer, particleGroupCount, 1, 1);
+			VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+			memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_FLAGS_NONE, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelineSelfCollision);
+			vkCmdDispatch(commandBuffer, particleGroupCount, 1, 1);
+		}
+	}
+
 	void buildComputeCommandBuffer()
 	{
 		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
@@ -314,30 +456,15 @@ public:
 			// Acquire the storage buffers from the graphics m_vkQueue
 			addGraphicsToComputeBarriers(compute.commandBuffers[i], 0, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
 
-			vkCmdBindPipeline(compute.commandBuffers[i], VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipeline);
-
-			uint32_t calculateNormals = 0;
-			vkCmdPushConstants(compute.commandBuffers[i], compute.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &calculateNormals);
-
-			// Dispatch the compute job
-			// SRS - Iterations **must** be an even number, so that readSet starts at 1 and the final result ends up in output.buffer with readSet equal to 0
-			const uint32_t iterations = 64;
-			for (uint32_t j = 0; j < iterations; j++) {
-				readSet = 1 - readSet;
-				vkCmdBindDescriptorSets(compute.commandBuffers[i], VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelineLayout, 0, 1, &compute.descriptorSets[readSet], 0, 0);
-
-				if (j == iterations - 1) {
-					calculateNormals = 1;
-					vkCmdPushConstants(compute.commandBuffers[i], compute.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &calculateNormals);
-				}
-
-				vkCmdDispatch(compute.commandBuffers[i], cloth.gridsize.x / 10, cloth.gridsize.y / 10, 1);
+			if (compute.timestampQueryPool != VK_NULL_HANDLE) {
+				vkCmdResetQueryPool(compute.commandBuffers[i], compute.timestampQueryPool, i * 2, 2);
+				vkCmdWriteTimestamp(compute.commandBuffers[i], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, compute.timestampQueryPool, i * 2);
+			}
 
-				// Don't add a barrier on the last iteration of the loop, since we'll have an explicit release to the graphics m_vkQueue
-				if (j != iterations - 1) {
-					addComputeToComputeBarriers(compute.commandBuffers[i], readSet);
-				}
+			recordSimulation(compute.commandBuffers[i]);
 
+			if (compute.timestampQueryPool != VK_NULL_HANDLE) {
+				vkCmdWriteTimestamp(compute.commandBuffers[i], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, compute.timestampQueryPool, i * 2 + 1);
 			}
 
 			// release the storage buffers back to the graphics m_vkQueue
@@ -453,7 +580,7 @@ public:
 		// Descriptor pool
 		std::vector<VkDescriptorPoolSize> poolSizes = {
 			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3),
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 10),
 			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2)
 		};
 		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, 3);
@@ -477,7 +604,11 @@ public:
 		vkUpdateDescriptorSets(m_vkDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 
 		// Layout
+		// The collider's transform is passed as a push constant
+		VkPushConstantRange pushConstantRange = vks::initializers::pushConstantRange(VK_SHADER_STAGE_VERTEX_BIT, sizeof(glm::mat4), 0);
 		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = vks::initializers::pipelineLayoutCreateInfo(&graphics.descriptorSetLayout, 1);
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
 		VK_CHECK_RESULT(vkCreatePipelineLayout(m_vkDevice, &pipelineLayoutCreateInfo, nullptr, &graphics.pipelineLayout));
 
 		// Pipeline
@@ -556,19 +687,18 @@ public:
 		VK_CHECK_RESULT(compute.uniformBuffer.map());
 
 		// Set some initial values
-		float dx = cloth.size.x / (cloth.gridsize.x - 1);
-		float dy = cloth.size.y / (cloth.gridsize.y - 1);
-
-		compute.uniformData.restDistH = dx;
-		compute.uniformData.restDistV = dy;
-		compute.uniformData.restDistD = sqrtf(dx * dx + dy * dy);
-		compute.uniformData.particleCount = cloth.gridsize;
+		updateClothParameters();
 
 		// Create compute pipeline
 		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2),
+			// Signed distance field of the mesh collider
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 3),
+			// Self collision hash table counts and entries
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 4),
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 5),
 		};
 
 		VkDescriptorSetLayoutCreateInfo descriptorLayout = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
@@ -587,24 +717,51 @@ public:
 		// Create two descriptor sets with input and output buffers switched
 		VK_CHECK_RESULT(vkAllocateDescriptorSets(m_vkDevice, &allocInfo, &compute.descriptorSets[0]));
 		VK_CHECK_RESULT(vkAllocateDescriptorSets(m_vkDevice, &allocInfo, &compute.descriptorSets[1]));
-
-		std::vector<VkWriteDescriptorSet> computeWriteDescriptorSets = {
-			vks::initializers::writeDescriptorSet(compute.descriptorSets[0], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &storageBuffers.input.descriptor),
-			vks::initializers::writeDescriptorSet(compute.descriptorSets[0], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &storageBuffers.output.descriptor),
-			vks::initializers::writeDescriptorSet(compute.descriptorSets[0], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2, &compute.uniformBuffer.descriptor),
-
-			vks::initializers::writeDescriptorSet(compute.descriptorSets[1], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &storageBuffers.output.descriptor),
-			vks::initializers::writeDescriptorSet(compute.descriptorSets[1], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &storageBuffers.input.descriptor),
-			vks::initializers::writeDescriptorSet(compute.descriptorSets[1], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2, &compute.uniformBuffer.descriptor)
-		};
-
-		vkUpdateDescriptorSets(m_vkDevice, static_cast<uint32_t>(computeWriteDescriptorSets.size()), computeWriteDescriptorSets.data(), 0, NULL);
+		updateComputeDescriptorSets();
 
 		// Create pipeline
 		VkComputePipelineCreateInfo computePipelineCreateInfo = vks::initializers::computePipelineCreateInfo(compute.pipelineLayout, 0);
 		computePipelineCreateInfo.stage = loadShader(getShadersPath() + "computecloth/cloth.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
 		VK_CHECK_RESULT(vkCreateComputePipelines(m_vkDevice, m_vkPipelineCache, 1, &computePipelineCreateInfo, nullptr, &compute.pipeline));
 
+		// The merged solver gets the number of iterations per dispatch as a specialization constant
+		tiledSupported = shaderExists(getShadersPath() + "computecloth/cloth_tiled.comp.spv");
+		if (tiledSupported) {
+			for (uint32_t i = 0; i < compute.pipelinesTiled.size(); i++) {
+				int32_t localIterations = static_cast<int32_t>(iterationsPerDispatch[i + 1]);
+				VkSpecializationMapEntry specializationMapEntry = vks::initializers::specializationMapEntry(0, 0, sizeof(int32_t));
+				VkSpecializationInfo specializationInfo = vks::initializers::specializationInfo(1, &specializationMapEntry, sizeof(int32_t), &localIterations);
+				computePipelineCreateInfo.stage = loadShader(getShadersPath() + "computecloth/cloth_tiled.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+				computePipelineCreateInfo.stage.pSpecializationInfo = &specializationInfo;
+				VK_CHECK_RESULT(vkCreateComputePipelines(m_vkDevice, m_vkPipelineCache, 1, &computePipelineCreateInfo, nullptr, &compute.pipelinesTiled[i]));
+			}
+		} else {
+			std::cerr << "Shader for the merged solver not found, every solver iteration runs as a separate dispatch\n";
+			iterationsPerDispatchIndex = 0;
+		}
+
+		// Self collision
+		selfCollisionSupported = shaderExists(getShadersPath() + "computecloth/cloth_hash.comp.spv") && shaderExists(getShadersPath() + "computecloth/cloth_selfcollision.comp.spv");
+		if (selfCollisionSupported) {
+			computePipelineCreateInfo.stage = loadShader(getShadersPath() + "computecloth/cloth_hash.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+			VK_CHECK_RESULT(vkCreateComputePipelines(m_vkDevice, m_vkPipelineCache, 1, &computePipelineCreateInfo, nullptr, &compute.pipelineHash));
+			computePipelineCreateInfo.stage = loadShader(getShadersPath() + "computecloth/cloth_selfcollision.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+			VK_CHECK_RESULT(vkCreateComputePipelines(m_vkDevice, m_vkPipelineCache, 1, &computePipelineCreateInfo, nullptr, &compute.pipelineSelfCollision));
+		} else {
+			std::cerr << "Shaders for self collision not found, self collision is disabled\n";
+			selfCollision = false;
+		}
+
+		// Timestamps are optional for compute only m_vkQueue families
+		if (m_pVulkanDevice->m_vkQueueFamilyProperties[m_pVulkanDevice->queueFamilyIndices.compute].timestampValidBits > 0) {
+			VkQueryPoolCreateInfo queryPoolCI{};
+			queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			queryPoolCI.queryCount = static_cast<uint32_t>(compute.commandBuffers.size()) * 2;
+			VK_CHECK_RESULT(vkCreateQueryPool(m_vkDevice, &queryPoolCI, nullptr, &compute.timestampQueryPool));
+			vkResetQueryPool(m_vkDevice, compute.timestampQueryPool, 0, queryPoolCI.queryCount);
+		}
+
 		// Separate command pool as m_vkQueue family for compute may be different than graphics
 		VkCommandPoolCreateInfo cmdPoolInfo = {};
 		cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
@@ -627,11 +784,184 @@ public:
 		buildComputeCommandBuffer();
 	}
 
+	// Parameters that depend on the grid size
+	void updateClothParameters()
+	{
+		float dx = cloth.size.x / (cloth.gridsize.x - 1);
+		float dy = cloth.size.y / (cloth.gridsize.y - 1);
+
+		compute.uniformData.restDistH = dx;
+		compute.uniformData.restDistV = dy;
+		compute.uniformData.restDistD = sqrtf(dx * dx + dy * dy);
+		compute.uniformData.particleCount = cloth.gridsize;
+		// Particles that aren't connected by springs are kept apart by a bit less than the spring length
+		compute.uniformData.selfCollisionDistance = std::min(dx, dy) * 0.75f;
+		compute.uniformData.hashTableSize = selfCollisionBuffers.tableSize;
+	}
+
+	void updateComputeDescriptorSets()
+	{
+		std::vector<VkWriteDescriptorSet> computeWriteDescriptorSets = {
+			vks::initializers::writeDescriptorSet(compute.descriptorSets[0], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &storageBuffers.input.descriptor),
+			vks::initializers::writeDescriptorSet(compute.descriptorSets[0], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &storageBuffers.output.descriptor),
+			vks::initializers::writeDescriptorSet(compute.descriptorSets[0], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2, &compute.uniformBuffer.descriptor),
+
+			vks::initializers::writeDescriptorSet(compute.descriptorSets[1], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &storageBuffers.output.descriptor),
+			vks::initializers::writeDescriptorSet(compute.descriptorSets[1], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &storageBuffers.input.descriptor),
+			vks::initializers::writeDescriptorSet(compute.descriptorSets[1], VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2, &compute.uniformBuffer.descriptor)
+		};
+		// The collider and the self collision buffers are the same for both sets
+		for (VkDescriptorSet descriptorSet : compute.descriptorSets) {
+			computeWriteDescriptorSets.push_back(vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, &sdfBuffer.descriptor));
+			computeWriteDescriptorSets.push_back(vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, &selfCollisionBuffers.counts.descriptor));
+			computeWriteDescriptorSets.push_back(vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5, &selfCollisionBuffers.entries.descriptor));
+		}
+
+		vkUpdateDescriptorSets(m_vkDevice, static_cast<uint32_t>(computeWriteDescriptorSets.size()), computeWriteDescriptorSets.data(), 0, NULL);
+	}
+
+	// The hash table has at least as many buckets as there are particles
+	void prepareSelfCollisionBuffers()
+	{
+		const uint32_t particleCount = cloth.gridsize.x * cloth.gridsize.y;
+		selfCollisionBuffers.tableSize = 1;
+		while (selfCollisionBuffers.tableSize < particleCount) {
+			selfCollisionBuffers.tableSize <<= 1;
+		}
+		m_pVulkanDevice->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &selfCollisionBuffers.counts, selfCollisionBuffers.tableSize * sizeof(uint32_t));
+		m_pVulkanDevice->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &selfCollisionBuffers.entries, static_cast<VkDeviceSize>(selfCollisionBuffers.tableSize) * bucketCapacity * sizeof(glm::vec4));
+	}
+
+	/*
+		Build the signed distance field of the mesh collider from the BVH of its triangles and upload it
+		The mesh is scaled to roughly the size of the sphere and centered at the origin, the field is converted to world space, so the shaders don't need the transform
+	*/
+	void prepareMeshCollider()
+	{
+		vks::sdf::Grid grid;
+		vks::sdf::build(grid, modelMesh.bvh, sdfResolution, 0.1f);
+		std::cout << "Built " << sdfResolution << "^3 distance field for " << modelMesh.bvh.statistics.triangleCount << " triangles in " << grid.buildTime << " ms" << std::endl;
+
+		const vks::bvh::Node& root = modelMesh.bvh.nodes[0];
+		const glm::vec3 boundsMin = glm::make_vec3(root.boundsMin);
+		const glm::vec3 boundsMax = glm::make_vec3(root.boundsMax);
+		const glm::vec3 extent = boundsMax - boundsMin;
+		const float scale = 2.5f / std::max(extent.x, std::max(extent.y, extent.z));
+		const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		meshTransform = glm::scale(glm::mat4(1.0f), glm::vec3(scale)) * glm::translate(glm::mat4(1.0f), -center);
+
+		for (float& distance : grid.distances) {
+			distance *= scale;
+		}
+		compute.uniformData.sdfOrigin = glm::vec4((glm::make_vec3(grid.origin) - center) * scale, grid.spacing * scale);
+		compute.uniformData.sdfResolution = grid.resolution;
+
+		vks::Buffer stagingBuffer;
+		const VkDeviceSize bufferSize = grid.distances.size() * sizeof(float);
+		m_pVulkanDevice->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, bufferSize, grid.distances.data());
+		m_pVulkanDevice->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &sdfBuffer, bufferSize);
+		VkCommandBuffer copyCmd = m_pVulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		VkBufferCopy copyRegion = { 0, 0, bufferSize };
+		vkCmdCopyBuffer(copyCmd, stagingBuffer.buffer, sdfBuffer.buffer, 1, &copyRegion);
+		m_pVulkanDevice->flushCommandBuffer(copyCmd, m_vkQueue, true);
+		stagingBuffer.destroy();
+	}
+
+	// Recreate everything that depends on the number of particles
+	void changeGridSize()
+	{
+		vkDeviceWaitIdle(m_vkDevice);
+		storageBuffers.input.destroy();
+		storageBuffers.output.destroy();
+		graphics.indices.destroy();
+		selfCollisionBuffers.counts.destroy();
+		selfCollisionBuffers.entries.destroy();
+		cloth.gridsize = glm::uvec2(gridSizes[gridSizeIndex]);
+		prepareStorageBuffers();
+		prepareSelfCollisionBuffers();
+		updateClothParameters();
+		updateComputeDescriptorSets();
+		buildCommandBuffers();
+		buildComputeCommandBuffer();
+	}
+
+	// Read the timestamps of the compute command buffers, results that aren't available yet are skipped
+	void updateSolverTime()
+	{
+		if (compute.timestampQueryPool == VK_NULL_HANDLE) {
+			return;
+		}
+		for (uint32_t i = 0; i < compute.commandBuffers.size(); i++) {
+			uint64_t results[4]{};
+			const VkResult result = vkGetQueryPoolResults(m_vkDevice, compute.timestampQueryPool, i * 2, 2, sizeof(results), results, sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+			if ((result == VK_SUCCESS) && results[1] && results[3]) {
+				compute.solverTime = static_cast<float>(results[2] - results[0]) * m_pVulkanDevice->m_vkPhysicalDeviceProperties.limits.timestampPeriod / 1000000.0f;
+			}
+		}
+	}
+
+	/*
+		Measure the solver on the compute m_vkQueue alone, without rendering or presenting, for all grid sizes and iterations per dispatch
+		Each measurement runs a batch of frames in one submission, the cloth is reset afterwards
+	*/
+	void runSolverBenchmark()
+	{
+		const int32_t gridIndex = gridSizeIndex;
+		const int32_t dispatchIndex = iterationsPerDispatchIndex;
+		const uint32_t frameCount = 8;
+		const uint32_t substeps = substepCounts[substepIndex];
+		compute.uniformData.deltaT = 0.02f * 0.0025f * 64.0f / substeps;
+		memcpy(compute.uniformBuffer.mapped, &compute.uniformData, sizeof(Compute::UniformData));
+
+		// Same ownership transfers as a regular frame, so the buffers are back with the graphics m_vkQueue afterwards
+		auto submit = [&]() {
+			VkCommandBuffer commandBuffer = m_pVulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, compute.commandPool, true);
+			addGraphicsToComputeBarriers(commandBuffer, 0, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+			for (uint32_t frame = 0; frame < frameCount; frame++) {
+				recordSimulation(commandBuffer);
+				addComputeToComputeBarriers(commandBuffer, readSet);
+			}
+			addComputeToGraphicsBarriers(commandBuffer, VK_ACCESS_SHADER_WRITE_BIT, 0, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+			m_pVulkanDevice->flushCommandBuffer(commandBuffer, compute.queue, compute.commandPool, true);
+			if (dedicatedComputeQueue) {
+				VkCommandBuffer barrierCmd = m_pVulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+				addComputeToGraphicsBarriers(barrierCmd, 0, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+				addGraphicsToComputeBarriers(barrierCmd, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+				m_pVulkanDevice->flushCommandBuffer(barrierCmd, m_vkQueue, true);
+			}
+		};
+
+		benchmarkResults.clear();
+		for (int32_t i = 0; i < static_cast<int32_t>(gridSizes.size()); i++) {
+			gridSizeIndex = i;
+			changeGridSize();
+			const int32_t dispatchVariants = tiledSupported ? static_cast<int32_t>(iterationsPerDispatch.size()) : 1;
+			for (int32_t j = 0; j < dispatchVariants; j++) {
+				iterationsPerDispatchIndex = j;
+				// Warm up run excludes pipeline and memory setup costs from the measurement
+				submit();
+				const auto tStart = std::chrono::high_resolution_clock::now();
+				submit();
+				const double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - tStart).count();
+				const double vertexSubsteps = static_cast<double>(cloth.gridsize.x) * cloth.gridsize.y * substeps * frameCount;
+				benchmarkResults.push_back({ gridSizes[i], iterationsPerDispatch[j], vertexSubsteps / seconds });
+			}
+		}
+		std::cout << "Cloth solver throughput (" << substeps << " substeps" << (selfCollision ? ", self collision" : "") << "):\n";
+		for (const BenchmarkResult& result : benchmarkResults) {
+			std::cout << "  " << result.gridSize << " x " << result.gridSize << ", " << result.iterationsPerDispatch << " iterations per dispatch: " << result.vertexSubstepsPerSecond / 1000000.0 << " M vertex substeps/s\n";
+		}
+		gridSizeIndex = gridIndex;
+		iterationsPerDispatchIndex = dispatchIndex;
+		changeGridSize();
+	}
+
 	void updateComputeUBO()
 	{
 		if (!paused) {
 			// SRS - Clamp m_frameTimer to max 20ms refresh period (e.g. if blocked on resize), otherwise m_vkImage breakup can occur
-			compute.uniformData.deltaT = fmin(m_frameTimer, 0.02f) * 0.0025f;
+			// The simulated time per frame doesn't depend on the number of substeps
+			compute.uniformData.deltaT = fmin(m_frameTimer, 0.02f) * 0.0025f * 64.0f / substepCounts[substepIndex];
 
 			if (simulateWind) {
 				std::default_random_engine rndEngine(m_benchmark.active ? 0 : (unsigned)time(nullptr));
@@ -709,21 +1039,22 @@ public:
 		// Submit graphics commands
 		VulkanExampleBase::prepareFrame();
 
+		// The swap chain semaphores go last, there are none in headless mode
 		VkPipelineStageFlags waitDstStageMask[2] = {
-			submitPipelineStages, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
-		};
-		VkSemaphore waitSemaphores[2] = {
-			semaphores.m_vkSemaphorePresentComplete, compute.semaphores[graphicsSubmitIndex].complete
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, submitPipelineStages
 		};
-		VkSemaphore signalSemaphores[2] = {
-			semaphores.m_vkSemaphoreRenderComplete, compute.semaphores[graphicsSubmitIndex].ready
-		};
-
-		m_vkSubmitInfo.waitSemaphoreCount = 2;
+		std::vector<VkSemaphore> waitSemaphores = { compute.semaphores[graphicsSubmitIndex].complete };
+		std::vector<VkSemaphore> signalSemaphores = { compute.semaphores[graphicsSubmitIndex].ready };
+		const std::vector<VkSemaphore> presentWaitSemaphores = getPresentWaitSemaphores();
+		const std::vector<VkSemaphore> presentSignalSemaphores = getPresentSignalSemaphores();
+		waitSemaphores.insert(waitSemaphores.end(), presentWaitSemaphores.begin(), presentWaitSemaphores.end());
+		signalSemaphores.insert(signalSemaphores.end(), presentSignalSemaphores.begin(), presentSignalSemaphores.end());
+
+		m_vkSubmitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
 		m_vkSubmitInfo.pWaitDstStageMask = waitDstStageMask;
-		m_vkSubmitInfo.pWaitSemaphores = waitSemaphores;
-		m_vkSubmitInfo.signalSemaphoreCount = 2;
-		m_vkSubmitInfo.pSignalSemaphores = signalSemaphores;
+		m_vkSubmitInfo.pWaitSemaphores = waitSemaphores.data();
+		m_vkSubmitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+		m_vkSubmitInfo.pSignalSemaphores = signalSemaphores.data();
 		m_vkSubmitInfo.commandBufferCount = 1;
 		m_vkSubmitInfo.pCommandBuffers = &drawCmdBuffers[m_currentBufferIndex];
 		VK_CHECK_RESULT(vkQueueSubmit(m_vkQueue, 1, &m_vkSubmitInfo, VK_NULL_HANDLE));
@@ -742,9 +1073,15 @@ public:
 		// Check whether the compute m_vkQueue family is distinct from the graphics m_vkQueue family
 		dedicatedComputeQueue = m_pVulkanDevice->queueFamilyIndices.graphics != m_pVulkanDevice->queueFamilyIndices.compute;
 		loadAssets();
+		cloth.gridsize = glm::uvec2(gridSizes[gridSizeIndex]);
 		prepareStorageBuffers();
+		prepareSelfCollisionBuffers();
+		prepareMeshCollider();
 		prepareGraphics();
 		prepareCompute();
+		if (m_benchmark.active) {
+			runSolverBenchmark();
+		}
 		m_prepared = true;
 	}
 
@@ -754,6 +1091,7 @@ public:
 			return;
 		updateGraphicsUBO();
 		updateComputeUBO();
+		updateSolverTime();
 		draw();
 	}
 
@@ -761,6 +1099,48 @@ public:
 	{
 		if (overlay->header("Settings")) {
 			overlay->checkBox("Simulate wind", &simulateWind);
+			std::vector<std::string> gridSizeNames;
+			for (uint32_t gridSize : gridSizes) {
+				gridSizeNames.push_back(std::to_string(gridSize) + " x " + std::to_string(gridSize));
+			}
+			if (overlay->comboBox("Grid size", &gridSizeIndex, gridSizeNames)) {
+				changeGridSize();
+			}
+			// The compute command buffers are only recorded once, so they need to be idle before they're rebuilt
+			bool rebuildCompute = false;
+			std::vector<std::string> substepNames;
+			for (uint32_t substeps : substepCounts) {
+				substepNames.push_back(std::to_string(substeps));
+			}
+			rebuildCompute |= overlay->comboBox("Substeps", &substepIndex, substepNames);
+			if (tiledSupported) {
+				rebuildCompute |= overlay->comboBox("Iterations per dispatch", &iterationsPerDispatchIndex, { "1", "2 (shared memory)", "4 (shared memory)" });
+			}
+			if (selfCollisionSupported) {
+				rebuildCompute |= overlay->checkBox("Self collision", &selfCollision);
+			}
+			if (rebuildCompute) {
+				vkDeviceWaitIdle(m_vkDevice);
+				buildComputeCommandBuffer();
+			}
+			if (overlay->comboBox("Collider", &collider, { "Sphere", "Mesh (signed distance field)" })) {
+				compute.uniformData.collider = static_cast<uint32_t>(collider);
+				vkDeviceWaitIdle(m_vkDevice);
+				buildCommandBuffers();
+			}
+			if (overlay->button("Benchmark solver")) {
+				runSolverBenchmark();
+			}
+		}
+		if (overlay->header("Statistics")) {
+			if (compute.timestampQueryPool != VK_NULL_HANDLE) {
+				const double vertexSubsteps = static_cast<double>(cloth.gridsize.x) * cloth.gridsize.y * substepCounts[substepIndex];
+				overlay->text("Solver: %.3f ms", compute.solverTime);
+				overlay->text("%.1f M vertex substeps/s", (compute.solverTime > 0.0f) ? vertexSubsteps / (compute.solverTime * 1000.0) : 0.0);
+			}
+			for (const BenchmarkResult& result : benchmarkResults) {
+				overlay->text("%u x %u, %u per dispatch: %.1f M/s", result.gridSize, result.gridSize, result.iterationsPerDispatch, result.vertexSubstepsPerSecond / 1000000.0);
+			}
 		}
 	}
 };
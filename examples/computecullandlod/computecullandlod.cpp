@@ -9,6 +9,7 @@
 
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
+#include "VulkanDepthPyramid.h"
 #include "frustum.hpp"
 
 
@@ -21,13 +22,26 @@ constexpr auto OBJECT_COUNT = 64;
 
 constexpr auto MAX_LOD_LEVEL = 5;
 
+// Culling phases of the compute shader (see cull.comp)
+constexpr uint32_t PHASE_FRUSTUM = 0;
+constexpr uint32_t PHASE_EARLY = 1;
+constexpr uint32_t PHASE_LATE = 2;
+
 class VulkanExample : public VulkanExampleBase
 {
 public:
 	bool fixedFrustum = false;
+	// Cull against a depth pyramid in two phases on the graphics queue, otherwise only frustum culling is done on the compute queue
+	bool occlusionCulling = true;
+	// Occlusion culling needs the depth pyramid shader, which may not have been compiled for the selected shading language
+	bool occlusionCullingSupported = true;
 
 	// The model contains multiple versions of a single object with different levels of detail
 	vkglTF::Model lodModel;
+	// Use the levels of detail generated by the glTF loader for the first object instead of the ones stored in the model
+	bool generatedLods = true;
+	// Index count per level of detail for the triangle statistics
+	std::vector<uint32_t> lodIndexCounts;
 
 	// Per-m_vulkanInstance data block
 	struct InstanceData {
@@ -44,6 +58,9 @@ public:
 	// Indirect draw statistics (updated via compute)
 	struct {
 		uint32_t drawCount;						// Total number of indirect draw counts to be issued
+		uint32_t lateDrawCount;					// Draws of objects that became visible, issued after the depth pyramid has been built
+		uint32_t frustumCulled;					// Objects outside of the view frustum
+		uint32_t occlusionCulled;				// Objects inside of the view frustum that are occluded according to the depth pyramid
 		uint32_t lodCount[MAX_LOD_LEVEL + 1];	// Statistics for number of draws per LOD level (written by compute shader)
 	} indirectStats;
 
@@ -55,6 +72,9 @@ public:
 		glm::mat4 modelview;
 		glm::vec4 cameraPos;
 		glm::vec4 frustumPlanes[6];
+		glm::vec2 pyramidSize;
+		float boundingRadius;
+		float _pad0;
 	} uboScene;
 
 	struct {
@@ -80,6 +100,23 @@ public:
 		VkPipeline pipeline;						// Compute m_vkPipeline for updating particle positions
 	} compute{};
 
+	// Resources for two phase occlusion culling: Objects visible in the last frame are drawn first and a depth pyramid is built from their depth,
+	// all objects are then tested against the pyramid and the ones that became visible are drawn on top
+	struct {
+		// Commands of the early phase followed by those of the late phase
+		vks::Buffer commandsBuffer;
+		// Visibility of every object in the last frame, written by the late phase
+		vks::Buffer visibilityBuffer;
+		VkDescriptorSet descriptorSet{ VK_NULL_HANDLE };
+		// Same as the default render pass, but keeps the color and depth of the early phase
+		VkRenderPass lateRenderPass{ VK_NULL_HANDLE };
+	} hiz;
+	vks::DepthPyramid depthPyramid;
+
+	// Pipeline statistics of the draws (early and late phase with occlusion culling)
+	VkQueryPool queryPool{ VK_NULL_HANDLE };
+	std::array<std::array<uint64_t, 4>, 2> pipelineStats{};
+
 	// View frustum for culling invisible objects
 	vks::Frustum frustum;
 
@@ -93,6 +130,8 @@ public:
 		camera.setTranslation(glm::vec3(0.5f, 0.0f, 0.0f));
 		camera.movementSpeed = 5.0f;
 		memset(&indirectStats, 0, sizeof(indirectStats));
+		// The depth pyramid is built from the depth buffer
+		m_depthStencilUsage |= VK_IMAGE_USAGE_SAMPLED_BIT;
 	}
 
 	~VulkanExample()
@@ -112,6 +151,13 @@ public:
 			vkDestroyFence(m_vkDevice, compute.fence, nullptr);
 			vkDestroyCommandPool(m_vkDevice, compute.commandPool, nullptr);
 			vkDestroySemaphore(m_vkDevice, compute.semaphore, nullptr);
+			hiz.commandsBuffer.destroy();
+			hiz.visibilityBuffer.destroy();
+			vkDestroyRenderPass(m_vkDevice, hiz.lateRenderPass, nullptr);
+			depthPyramid.destroy();
+			if (queryPool != VK_NULL_HANDLE) {
+				vkDestroyQueryPool(m_vkDevice, queryPool, nullptr);
+			}
 		}
 	}
 
@@ -123,6 +169,106 @@ public:
 		}
 		// This is required for for using firstInstance
 		m_vkPhysicalDeviceFeatures10.drawIndirectFirstInstance = VK_TRUE;
+		// Pipeline statistics are optional
+		if (m_vkPhysicalDeviceFeatures.pipelineStatisticsQuery) {
+			m_vkPhysicalDeviceFeatures10.pipelineStatisticsQuery = VK_TRUE;
+		}
+	}
+
+	// Draw the objects with the indirect commands starting at the given offset
+	void drawObjects(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset)
+	{
+		VkViewport viewport = vks::initializers::viewport((float)m_drawAreaWidth, (float)m_drawAreaHeight, 0.0f, 1.0f);
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+		VkRect2D scissor = vks::initializers::rect2D(m_drawAreaWidth, m_drawAreaHeight, 0, 0);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+		VkDeviceSize offsets[1] = { 0 };
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, 1, &descriptorSet, 0, NULL);
+
+		// Mesh containing the LODs
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipeline);
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &lodModel.vertices.buffer, offsets);
+		vkCmdBindVertexBuffers(commandBuffer, 1, 1, &instanceBuffer.buffer, offsets);
+
+		vkCmdBindIndexBuffer(commandBuffer, lodModel.indices.buffer, 0, lodModel.indices.type);
+
+		if (m_pVulkanDevice->m_vkPhysicalDeviceFeatures.multiDrawIndirect)
+		{
+			vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset, objectCount, sizeof(VkDrawIndexedIndirectCommand));
+		}
+		else
+		{
+			// If multi draw is not available, we must issue separate draw commands
+			for (uint32_t j = 0; j < objectCount; j++)
+			{
+				vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset + j * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+			}
+		}
+	}
+
+	// Run one phase of the culling shader on the graphics queue and make its commands available for drawing
+	void cullObjects(VkCommandBuffer commandBuffer, uint32_t phase)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelineLayout, 0, 1, &hiz.descriptorSet, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, compute.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &phase);
+		vkCmdDispatch(commandBuffer, objectCount / 16, 1, 1);
+
+		VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_FLAGS_NONE, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	// Two phase occlusion culling, everything is recorded to the graphics command buffer
+	void buildOcclusionCullingCommandBuffer(VkCommandBuffer commandBuffer, VkRenderPassBeginInfo renderPassBeginInfo)
+	{
+		if (queryPool != VK_NULL_HANDLE) {
+			vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+		}
+
+		// Clear the statistics, the previous frame has finished reading the commands and writing the visibility
+		vkCmdFillBuffer(commandBuffer, indirectDrawCountBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+		VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_FLAGS_NONE, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		// Early phase: Objects that were visible in the last frame
+		cullObjects(commandBuffer, PHASE_EARLY);
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		if (queryPool != VK_NULL_HANDLE) {
+			vkCmdBeginQuery(commandBuffer, queryPool, 0, 0);
+		}
+		drawObjects(commandBuffer, hiz.commandsBuffer.buffer, 0);
+		if (queryPool != VK_NULL_HANDLE) {
+			vkCmdEndQuery(commandBuffer, queryPool, 0);
+		}
+		vkCmdEndRenderPass(commandBuffer);
+
+		// Late phase: All objects against the depth of the early phase, only the ones that became visible are drawn
+		depthPyramid.build(commandBuffer);
+		cullObjects(commandBuffer, PHASE_LATE);
+		renderPassBeginInfo.renderPass = hiz.lateRenderPass;
+		renderPassBeginInfo.clearValueCount = 0;
+		renderPassBeginInfo.pClearValues = nullptr;
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		if (queryPool != VK_NULL_HANDLE) {
+			vkCmdBeginQuery(commandBuffer, queryPool, 1, 0);
+		}
+		drawObjects(commandBuffer, hiz.commandsBuffer.buffer, objectCount * sizeof(VkDrawIndexedIndirectCommand));
+		if (queryPool != VK_NULL_HANDLE) {
+			vkCmdEndQuery(commandBuffer, queryPool, 1);
+		}
+		drawUI(commandBuffer);
+		vkCmdEndRenderPass(commandBuffer);
+
+		// The statistics are read on the host after the frame has finished
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, VK_FLAGS_NONE, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
 	}
 
 	void buildCommandBuffers()
@@ -147,6 +293,18 @@ public:
 
 			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
 
+			if (occlusionCulling)
+			{
+				buildOcclusionCullingCommandBuffer(drawCmdBuffers[i], renderPassBeginInfo);
+				VK_CHECK_RESULT(vkEndCommandBuffer(drawCmdBuffers[i]));
+				continue;
+			}
+
+			if (queryPool != VK_NULL_HANDLE)
+			{
+				vkCmdResetQueryPool(drawCmdBuffers[i], queryPool, 0, 2);
+			}
+
 			// Acquire barrier
 			if (m_pVulkanDevice->queueFamilyIndices.graphics != m_pVulkanDevice->queueFamilyIndices.compute)
 			{
@@ -175,33 +333,14 @@ public:
 
 			vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-			VkViewport viewport = vks::initializers::viewport((float)m_drawAreaWidth, (float)m_drawAreaHeight, 0.0f, 1.0f);
-			vkCmdSetViewport(drawCmdBuffers[i], 0, 1, &viewport);
-
-			VkRect2D scissor = vks::initializers::rect2D(m_drawAreaWidth, m_drawAreaHeight, 0, 0);
-			vkCmdSetScissor(drawCmdBuffers[i], 0, 1, &scissor);
-
-			VkDeviceSize offsets[1] = { 0 };
-			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, 1, &descriptorSet, 0, NULL);
-
-			// Mesh containing the LODs
-			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipeline);
-			vkCmdBindVertexBuffers(drawCmdBuffers[i], 0, 1, &lodModel.vertices.buffer, offsets);
-			vkCmdBindVertexBuffers(drawCmdBuffers[i], 1, 1, &instanceBuffer.buffer, offsets);
-
-			vkCmdBindIndexBuffer(drawCmdBuffers[i], lodModel.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
-
-			if (m_pVulkanDevice->m_vkPhysicalDeviceFeatures.multiDrawIndirect)
+			if (queryPool != VK_NULL_HANDLE)
 			{
-				vkCmdDrawIndexedIndirect(drawCmdBuffers[i], indirectCommandsBuffer.buffer, 0, static_cast<uint32_t>(indirectCommands.size()), sizeof(VkDrawIndexedIndirectCommand));
+				vkCmdBeginQuery(drawCmdBuffers[i], queryPool, 0, 0);
 			}
-			else
+			drawObjects(drawCmdBuffers[i], indirectCommandsBuffer.buffer, 0);
+			if (queryPool != VK_NULL_HANDLE)
 			{
-				// If multi draw is not available, we must issue separate draw commands
-				for (auto j = 0; j < indirectCommands.size(); j++)
-				{
-					vkCmdDrawIndexedIndirect(drawCmdBuffers[i], indirectCommandsBuffer.buffer, j * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
-				}
+				vkCmdEndQuery(drawCmdBuffers[i], queryPool, 0);
 			}
 
 			drawUI(drawCmdBuffers[i]);
@@ -240,7 +379,11 @@ public:
 
 	void loadAssets()
 	{
-		const uint32_t glTFLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::PreMultiplyVertexColors | vkglTF::FileLoadingFlags::FlipY;
+		uint32_t glTFLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::PreMultiplyVertexColors | vkglTF::FileLoadingFlags::FlipY;
+		if (generatedLods) {
+			glTFLoadingFlags |= vkglTF::FileLoadingFlags::GenerateLods;
+			lodModel.lodCount = MAX_LOD_LEVEL + 1;
+		}
 		lodModel.loadFromFile(getAssetPath() + "models/suzanne_lods.gltf", m_pVulkanDevice, m_vkQueue, glTFLoadingFlags);
 	}
 
@@ -279,9 +422,11 @@ public:
 
 		vkCmdBindPipeline(compute.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipeline);
 		vkCmdBindDescriptorSets(compute.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelineLayout, 0, 1, &compute.descriptorSet, 0, 0);
+		const uint32_t phase = PHASE_FRUSTUM;
+		vkCmdPushConstants(compute.commandBuffer, compute.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &phase);
 
 		// Clear the buffer that the compute shader pass will write statistics and draw calls to
-		vkCmdFillBuffer(compute.commandBuffer, indirectDrawCountBuffer.buffer, 0, indirectCommandsBuffer.descriptor.range, 0);
+		vkCmdFillBuffer(compute.commandBuffer, indirectDrawCountBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
 
 		// This barrier ensures that the fill command is finished before the compute shader can start writing to the buffer
 		VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
@@ -338,10 +483,11 @@ public:
 	{
 		// Pool
 		std::vector<VkDescriptorPoolSize> poolSizes = {
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2),
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4)
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 10),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2)
 		};
-		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, 2);
+		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, 3);
 		VK_CHECK_RESULT(vkCreateDescriptorPool(m_vkDevice, &descriptorPoolInfo, nullptr, &m_vkDescriptorPool));
 
 		// Layout
@@ -470,6 +616,36 @@ public:
 
 		stagingBuffer.destroy();
 
+		// Occlusion culling writes separate commands for the early and the late phase, both use the same instances
+		std::vector<VkDrawIndexedIndirectCommand> phaseCommands(indirectCommands);
+		phaseCommands.insert(phaseCommands.end(), indirectCommands.begin(), indirectCommands.end());
+		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&stagingBuffer,
+			phaseCommands.size() * sizeof(VkDrawIndexedIndirectCommand),
+			phaseCommands.data()));
+
+		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			&hiz.commandsBuffer,
+			stagingBuffer.size));
+
+		m_pVulkanDevice->copyBuffer(&stagingBuffer, &hiz.commandsBuffer, m_vkQueue);
+
+		stagingBuffer.destroy();
+
+		// Nothing has been visible before the first frame, so everything is left to its late phase
+		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			&hiz.visibilityBuffer,
+			objectCount * sizeof(uint32_t)));
+		VkCommandBuffer fillCmd = m_pVulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		vkCmdFillBuffer(fillCmd, hiz.visibilityBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+		m_pVulkanDevice->flushCommandBuffer(fillCmd, m_vkQueue, true);
+
 		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(
 			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
@@ -493,6 +669,10 @@ public:
 			}
 		}
 
+		// Bounding sphere of the scaled object around its position, the levels of detail don't extend beyond the full detail mesh
+		const vkglTF::Primitive* primitive = lodModel.nodes[0]->mesh->primitives[0];
+		uboScene.boundingRadius = glm::length(glm::max(glm::abs(primitive->dimensions.min), glm::abs(primitive->dimensions.max))) * 2.0f;
+
 		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(
 			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
@@ -550,15 +730,39 @@ public:
 			float _pad0;
 		};
 		std::vector<LOD> LODLevels;
-		uint32_t n = 0;
-		for (auto node : lodModel.nodes)
+		if (generatedLods)
+		{
+			// A level is used up to the distance at which the error of the next level projects to less than a pixel on screen
+			const float pixelError = 1.0f;
+			const float errorToDistance = (float)m_drawAreaHeight * fabs(camera.matrices.perspective[1][1]) / (pixelError * 2.0f);
+			const std::vector<vkglTF::Primitive::Lod>& lods = lodModel.nodes[0]->mesh->primitives[0]->lods;
+			for (size_t n = 0; n < lods.size(); n++)
+			{
+				LOD lod{};
+				lod.firstIndex = lods[n].firstIndex;
+				lod.indexCount = lods[n].indexCount;
+				// Objects are drawn with a scale of 2 (see prepareBuffers)
+				lod.distance = (n + 1 < lods.size()) ? lods[n + 1].error * 2.0f * errorToDistance : FLT_MAX;
+				LODLevels.push_back(lod);
+			}
+		}
+		else
+		{
+			uint32_t n = 0;
+			for (auto node : lodModel.nodes)
+			{
+				LOD lod{};
+				lod.firstIndex = node->mesh->primitives[0]->firstIndex;	// First index for this LOD
+				lod.indexCount = node->mesh->primitives[0]->indexCount;	// Index count for this LOD
+				lod.distance = 5.0f + n * 5.0f;							// Starting distance (to viewer) for this LOD
+				n++;
+				LODLevels.push_back(lod);
+			}
+		}
+		lodIndexCounts.clear();
+		for (const LOD& lod : LODLevels)
 		{
-			LOD lod{};
-			lod.firstIndex = node->mesh->primitives[0]->firstIndex;	// First index for this LOD
-			lod.indexCount = node->mesh->primitives[0]->indexCount;	// Index count for this LOD
-			lod.distance = 5.0f + n * 5.0f;							// Starting distance (to viewer) for this LOD
-			n++;
-			LODLevels.push_back(lod);
+			lodIndexCounts.push_back(lod.indexCount);
 		}
 
 		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(
@@ -624,6 +828,16 @@ public:
 				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
 				VK_SHADER_STAGE_COMPUTE_BIT,
 				4),
+			// Binding 5: Depth pyramid (input)
+			vks::initializers::descriptorSetLayoutBinding(
+				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				5),
+			// Binding 6: Object visibility of the last frame
+			vks::initializers::descriptorSetLayoutBinding(
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				6),
 		};
 
 		VkDescriptorSetLayoutCreateInfo descriptorLayout =
@@ -633,11 +847,16 @@ public:
 
 		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(m_vkDevice, &descriptorLayout, nullptr, &compute.descriptorSetLayout));
 
+		// The culling phase is passed as a push constant
+		VkPushConstantRange pushConstantRange = vks::initializers::pushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(uint32_t), 0);
 		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = vks::initializers::pipelineLayoutCreateInfo(&compute.descriptorSetLayout, 1);
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
 		VK_CHECK_RESULT(vkCreatePipelineLayout(m_vkDevice, &pipelineLayoutCreateInfo, nullptr, &compute.pipelineLayout));
 
 		VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(m_vkDescriptorPool, &compute.descriptorSetLayout, 1);
 		VK_CHECK_RESULT(vkAllocateDescriptorSets(m_vkDevice, &allocInfo, &compute.descriptorSet));
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(m_vkDevice, &allocInfo, &hiz.descriptorSet));
 
 		std::vector<VkWriteDescriptorSet> computeWriteDescriptorSets =
 		{
@@ -670,11 +889,31 @@ public:
 				compute.descriptorSet,
 				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
 				4,
-				&compute.lodLevelsBuffers.descriptor)
+				&compute.lodLevelsBuffers.descriptor),
+			// Binding 5: Depth pyramid, not used by frustum culling
+			vks::initializers::writeDescriptorSet(
+				compute.descriptorSet,
+				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				5,
+				&depthPyramid.descriptor),
+			// Binding 6: Object visibility, not used by frustum culling
+			vks::initializers::writeDescriptorSet(
+				compute.descriptorSet,
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				6,
+				&hiz.visibilityBuffer.descriptor)
 		};
 
 		vkUpdateDescriptorSets(m_vkDevice, static_cast<uint32_t>(computeWriteDescriptorSets.size()), computeWriteDescriptorSets.data(), 0, nullptr);
 
+		// Occlusion culling uses the same bindings, but writes the commands of both phases
+		for (VkWriteDescriptorSet& writeDescriptorSet : computeWriteDescriptorSets)
+		{
+			writeDescriptorSet.dstSet = hiz.descriptorSet;
+		}
+		computeWriteDescriptorSets[1].pBufferInfo = &hiz.commandsBuffer.descriptor;
+		vkUpdateDescriptorSets(m_vkDevice, static_cast<uint32_t>(computeWriteDescriptorSets.size()), computeWriteDescriptorSets.data(), 0, nullptr);
+
 		// Create m_vkPipeline
 		VkComputePipelineCreateInfo computePipelineCreateInfo = vks::initializers::computePipelineCreateInfo(compute.pipelineLayout, 0);
 		computePipelineCreateInfo.stage = loadShader(getShadersPath() + "computecullandlod/cull.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
@@ -685,7 +924,7 @@ public:
 		specializationEntry.offset = 0;
 		specializationEntry.size = sizeof(uint32_t);
 
-		uint32_t specializationData = static_cast<uint32_t>(lodModel.nodes.size()) - 1;
+		uint32_t specializationData = static_cast<uint32_t>(lodIndexCounts.size()) - 1;
 
 		VkSpecializationInfo specializationInfo{};
 		specializationInfo.mapEntryCount = 1;
@@ -724,10 +963,115 @@ public:
 		buildComputeCommandBuffer();
 	}
 
+	void prepareDepthPyramid()
+	{
+		// Without the pyramid shader only frustum culling on the compute queue is available
+		VkPipelineShaderStageCreateInfo shaderStage{};
+		const std::string shaderFile = getShadersPath() + "base/depthpyramid.comp.spv";
+		if (shaderExists(shaderFile)) {
+			shaderStage = loadShader(shaderFile, VK_SHADER_STAGE_COMPUTE_BIT);
+		} else if (occlusionCullingSupported) {
+			std::cerr << "Shader \"" << shaderFile << "\" not found, occlusion culling is disabled\n";
+			occlusionCullingSupported = false;
+			occlusionCulling = false;
+		}
+		depthPyramid.create(m_pVulkanDevice, m_vkQueue, m_defaultDepthStencil.m_vkImage, m_vkFormatDepth, m_drawAreaWidth, m_drawAreaHeight, shaderStage, m_vkPipelineCache);
+	}
+
+	// The late phase continues rendering into the color and depth attachments of the early phase, the depth pyramid build left the depth attachment in a read only layout
+	void prepareLateRenderPass()
+	{
+		std::array<VkAttachmentDescription, 2> attachments = {};
+		attachments[0].format = m_swapChain.colorFormat;
+		attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[0].initialLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		attachments[0].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		attachments[1].format = m_vkFormatDepth;
+		attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		VkAttachmentReference colorReference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		VkAttachmentReference depthReference = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+		VkSubpassDescription subpassDescription = {};
+		subpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpassDescription.colorAttachmentCount = 1;
+		subpassDescription.pColorAttachments = &colorReference;
+		subpassDescription.pDepthStencilAttachment = &depthReference;
+
+		// Color writes of the early phase and depth pyramid reads of the depth attachment have to finish first
+		std::array<VkSubpassDependency, 2> dependencies = {};
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[0].srcAccessMask = 0;
+		dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependencies[1].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[1].dstSubpass = 0;
+		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[1].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+		VkRenderPassCreateInfo renderPassInfo = vks::initializers::renderPassCreateInfo();
+		renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+		renderPassInfo.pAttachments = attachments.data();
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpassDescription;
+		renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+		renderPassInfo.pDependencies = dependencies.data();
+		VK_CHECK_RESULT(vkCreateRenderPass(m_vkDevice, &renderPassInfo, nullptr, &hiz.lateRenderPass));
+	}
+
+	// Pipeline statistics of the draws of both phases, the culled objects never reach the input assembly
+	void setupQueryPool()
+	{
+		if (!m_pVulkanDevice->m_vkPhysicalDeviceFeatures.pipelineStatisticsQuery)
+		{
+			return;
+		}
+		VkQueryPoolCreateInfo queryPoolInfo = {};
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		queryPoolInfo.pipelineStatistics =
+			VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+		queryPoolInfo.queryCount = 2;
+		VK_CHECK_RESULT(vkCreateQueryPool(m_vkDevice, &queryPoolInfo, nullptr, &queryPool));
+	}
+
+	// Results are only read once available, so this never waits
+	void getQueryResults()
+	{
+		if (queryPool == VK_NULL_HANDLE)
+		{
+			return;
+		}
+		const uint32_t queryCount = occlusionCulling ? 2 : 1;
+		VkResult result = vkGetQueryPoolResults(m_vkDevice, queryPool, 0, queryCount, queryCount * sizeof(pipelineStats[0]), pipelineStats.data(), sizeof(pipelineStats[0]), VK_QUERY_RESULT_64_BIT);
+		if (result != VK_NOT_READY)
+		{
+			VK_CHECK_RESULT(result);
+		}
+	}
+
 	void updateUniformBuffer()
 	{
 		uboScene.projection = camera.matrices.perspective;
 		uboScene.modelview = camera.matrices.view;
+		uboScene.pyramidSize = glm::vec2(static_cast<float>(depthPyramid.width), static_cast<float>(depthPyramid.height));
 		if (!fixedFrustum)
 		{
 			uboScene.cameraPos = glm::vec4(camera.position, 1.0f) * -1.0f;
@@ -741,6 +1085,9 @@ public:
 	{
 		VulkanExampleBase::prepare();
 		loadAssets();
+		prepareDepthPyramid();
+		prepareLateRenderPass();
+		setupQueryPool();
 		prepareBuffers();
 		setupDescriptors();
 		preparePipelines();
@@ -749,6 +1096,21 @@ public:
 		m_prepared = true;
 	}
 
+	virtual void windowResized()
+	{
+		// The depth pyramid depends on the size of the recreated depth buffer
+		depthPyramid.destroy();
+		prepareDepthPyramid();
+		std::array<VkWriteDescriptorSet, 2> writeDescriptorSets = {
+			vks::initializers::writeDescriptorSet(compute.descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 5, &depthPyramid.descriptor),
+			vks::initializers::writeDescriptorSet(hiz.descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 5, &depthPyramid.descriptor),
+		};
+		vkUpdateDescriptorSets(m_vkDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+		// Updating the descriptor sets invalidated the command buffers that use them
+		buildComputeCommandBuffer();
+		buildCommandBuffers();
+	}
+
 	void draw()
 	{
 		VulkanExampleBase::prepareFrame();
@@ -759,28 +1121,31 @@ public:
 		vkWaitForFences(m_vkDevice, 1, &compute.fence, VK_TRUE, UINT64_MAX);
 		vkResetFences(m_vkDevice, 1, &compute.fence);
 
-		VkSubmitInfo computeSubmitInfo = vks::initializers::submitInfo();
-		computeSubmitInfo.commandBufferCount = 1;
-		computeSubmitInfo.pCommandBuffers = &compute.commandBuffer;
-		computeSubmitInfo.signalSemaphoreCount = 1;
-		computeSubmitInfo.pSignalSemaphores = &compute.semaphore;
+		// Occlusion culling is part of the graphics command buffer
+		if (!occlusionCulling)
+		{
+			VkSubmitInfo computeSubmitInfo = vks::initializers::submitInfo();
+			computeSubmitInfo.commandBufferCount = 1;
+			computeSubmitInfo.pCommandBuffers = &compute.commandBuffer;
+			computeSubmitInfo.signalSemaphoreCount = 1;
+			computeSubmitInfo.pSignalSemaphores = &compute.semaphore;
 
-		VK_CHECK_RESULT(vkQueueSubmit(compute.queue, 1, &computeSubmitInfo, VK_NULL_HANDLE));
+			VK_CHECK_RESULT(vkQueueSubmit(compute.queue, 1, &computeSubmitInfo, VK_NULL_HANDLE));
+		}
 
 		// Submit graphics command buffer
 
 		m_vkSubmitInfo.commandBufferCount = 1;
 		m_vkSubmitInfo.pCommandBuffers = &drawCmdBuffers[m_currentBufferIndex];
 
-		// Wait on present and compute semaphores
-		std::array<VkPipelineStageFlags, 2> stageFlags = {
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-		};
-		std::array<VkSemaphore, 2> waitSemaphores = {
-			semaphores.m_vkSemaphorePresentComplete,						// Wait for presentation to finished
-			compute.semaphore								// Wait for compute to finish
-		};
+		// Wait on present and compute semaphores (there's nothing to wait on for presentation in headless mode)
+		std::vector<VkSemaphore> waitSemaphores = getPresentWaitSemaphores();
+		std::vector<VkPipelineStageFlags> stageFlags(waitSemaphores.size(), VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+		if (!occlusionCulling) {
+			// Wait for compute to finish
+			waitSemaphores.push_back(compute.semaphore);
+			stageFlags.push_back(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		}
 
 		m_vkSubmitInfo.pWaitSemaphores = waitSemaphores.data();
 		m_vkSubmitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
@@ -793,6 +1158,7 @@ public:
 
 		// Get draw count from compute
 		memcpy(&indirectStats, indirectDrawCountBuffer.mapped, sizeof(indirectStats));
+		getQueryResults();
 	}
 
 	virtual void render()
@@ -809,11 +1175,36 @@ public:
 	{
 		if (overlay->header("Settings")) {
 			overlay->checkBox("Freeze frustum", &fixedFrustum);
+			if (occlusionCullingSupported) {
+				overlay->checkBox("Occlusion culling", &occlusionCulling);
+			}
 		}
 		if (overlay->header("Statistics")) {
 			overlay->text("Visible objects: %d", indirectStats.drawCount);
+			overlay->text("Frustum culled: %d", indirectStats.frustumCulled);
+			if (occlusionCulling) {
+				overlay->text("Occlusion culled: %d", indirectStats.occlusionCulled);
+				overlay->text("Late draws: %d", indirectStats.lateDrawCount);
+			}
+			uint64_t triangleCount = 0;
 			for (uint32_t i = 0; i < MAX_LOD_LEVEL + 1; i++) {
 				overlay->text("LOD %d: %d", i, indirectStats.lodCount[i]);
+				if (i < lodIndexCounts.size()) {
+					triangleCount += static_cast<uint64_t>(indirectStats.lodCount[i]) * lodIndexCounts[i] / 3;
+				}
+			}
+			overlay->text("Triangles: %llu", static_cast<unsigned long long>(triangleCount));
+		}
+		if ((queryPool != VK_NULL_HANDLE) && overlay->header("Pipeline statistics")) {
+			const uint32_t phaseCount = occlusionCulling ? 2 : 1;
+			for (uint32_t i = 0; i < phaseCount; i++) {
+				if (occlusionCulling) {
+					overlay->text(i == 0 ? "Early phase" : "Late phase");
+				}
+				overlay->text("IA primitives: %llu", static_cast<unsigned long long>(pipelineStats[i][0]));
+				overlay->text("VS invocations: %llu", static_cast<unsigned long long>(pipelineStats[i][1]));
+				overlay->text("Clipping primitives: %llu", static_cast<unsigned long long>(pipelineStats[i][2]));
+				overlay->text("FS invocations: %llu", static_cast<unsigned long long>(pipelineStats[i][3]));
 			}
 		}
 	}
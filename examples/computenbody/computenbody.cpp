@@ -5,6 +5,9 @@
 * It calculates the particle system movement using two separate compute passes: calculating particle positions and integrating particles
 * For that a shader storage buffer is used which is then used as a vertex buffer for drawing the particle system with a graphics pipeline
 * To optimize performance, the compute shaders use shared m_vkDeviceMemory
+* Instead of all particle pairs the velocities can also be calculated with Barnes-Hut over an octree built on the GPU each step, which scales to millions of particles
+* Both modes can be validated against the CPU reference in base/NBody.cpp and benchmarked at several particle counts
+* Optionally the particles are sorted back to front on the GPU (depth keys plus a compute radix sort) and drawn with alpha blending through the sorted index buffer
 *
 * Copyright (C) 2016-2023 by Sascha Willems - www.saschawillems.de
 *
@@ -12,6 +15,8 @@
 */
 
 #include "vulkanexamplebase.h"
+#include "VulkanRadixSort.h"
+#include "NBody.h"
 
 #if defined(__ANDROID__)
 // Lower particle count on Android for performance reasons
@@ -34,6 +39,17 @@ public:
 		glm::vec4 vel;								// xyz = velocity, w = gradient texture position
 	};
 	uint32_t numParticles{ 0 };
+	static_assert(sizeof(Particle) == sizeof(vks::nbody::Particle), "Particle layout needs to match the CPU reference");
+
+	// The simulation has six attractors, the particle count per attractor is selectable
+	const std::vector<uint32_t> particlesPerAttractor = { PARTICLES_PER_ATTRACTOR, 16 * 1024, 64 * 1024, 256 * 1024 };
+	int32_t particleCountIndex{ 0 };
+	// Calculating all particle pairs is O(N^2), larger particle counts always use the octree
+	const uint32_t maxAllPairsParticles{ 100000 };
+	enum SimulationMode : int32_t { AllPairs = 0, Octree = 1 };
+	int32_t simulationMode{ AllPairs };
+	// The octree shaders have been compiled for the selected shading language, without them only counts up to maxAllPairsParticles are offered
+	bool octreeSupported{ false };
 
 	// We use a shader storage buffer object to store the particlces
 	// This is updated by the compute pipeline and displayed as a vertex buffer by the graphics pipeline
@@ -46,6 +62,7 @@ public:
 		VkDescriptorSet descriptorSet;				// Particle system rendering shader bindings
 		VkPipelineLayout pipelineLayout;			// Layout of the graphics pipeline
 		VkPipeline pipeline;						// Particle rendering pipeline
+		VkPipeline pipelineSorted{ VK_NULL_HANDLE };	// Particle rendering pipeline with alpha blending for back to front sorted particles
 		VkSemaphore semaphore;                      // Execution dependency between compute & graphic submission
 		struct UniformData {
 			glm::mat4 projection;
@@ -67,6 +84,10 @@ public:
 		VkPipelineLayout pipelineLayout;			// Layout of the compute pipeline
 		VkPipeline pipelineCalculate;				// Compute pipeline for N-Body velocity calculation (1st pass)
 		VkPipeline pipelineIntegrate;				// Compute pipeline for euler integration (2nd pass)
+		VkPipeline pipelineAccumulate{ VK_NULL_HANDLE };		// Octree mode: Adds the particles to the finest octree level
+		VkPipeline pipelineReduce{ VK_NULL_HANDLE };			// Octree mode: Sums the cells of one octree level from the level below
+		VkPipeline pipelineCalculateOctree{ VK_NULL_HANDLE };	// Octree mode: Barnes-Hut velocity calculation replacing the 1st pass
+		vks::Buffer octreeBuffer;					// Cells of all octree levels, rebuilt every step
 		struct UniformData {						// Compute shader uniform block object
 			float deltaT{ 0.0f };					// Frame delta time
 			int32_t particleCount{ 0 };
@@ -74,10 +95,50 @@ public:
 			float gravity{ 0.002f };
 			float power{ 0.75f };
 			float soften{ 0.05f };
+			// Octree parameters, see vks::nbody::Settings
+			float theta{ 0.5f };
+			uint32_t levels{ 6 };
+			float boundsSize{ 32.0f };
+			glm::vec4 boundsMin{ -16.0f, -16.0f, -16.0f, 0.0f };
 		} uniformData;
 		vks::Buffer uniformBuffer;					// Uniform buffer object containing particle system parameters
+		// Timestamps around the simulation (0, 1) and the sort (2, 3), only written if the compute m_vkQueue supports them
+		VkQueryPool timestampQueryPool{ VK_NULL_HANDLE };
+		float stepTime{ 0.0f };
 	} compute;
 
+	// Resources for sorting the particles back to front, which is done on the compute m_vkQueue after the simulation
+	struct Sort {
+		// All shaders of the sort have been compiled for the selected shading language
+		bool supported{ false };
+		bool enabled{ false };
+		vks::Buffer keys;							// View space depth of every particle as a sortable integer
+		vks::Buffer values;							// Particle indices, used as the index buffer for drawing after sorting
+		vks::ComputeRadixSort radixSort;
+		VkDescriptorSetLayout descriptorSetLayout{ VK_NULL_HANDLE };
+		VkDescriptorSet descriptorSet{ VK_NULL_HANDLE };
+		VkPipelineLayout pipelineLayout{ VK_NULL_HANDLE };
+		VkPipeline pipelineDepth{ VK_NULL_HANDLE };	// Writes the depth keys and particle indices
+		float time{ 0.0f };
+		double totalTime{ 0.0 };
+		uint64_t sortCount{ 0 };
+	} sort;
+
+	// Result of the last comparison of the GPU velocity calculation with the CPU reference
+	struct Validation {
+		bool done{ false };
+		uint32_t sampleCount{ 0 };
+		vks::nbody::Error gpu;						// GPU against the CPU reference in the same mode
+		vks::nbody::Error approximation;			// Octree against all pairs, both on the CPU
+	} validation;
+
+	struct StepBenchmark {
+		uint32_t particleCount;
+		int32_t mode;
+		double stepsPerSecond;
+	};
+	std::vector<StepBenchmark> stepBenchmarks;
+
 	VulkanExample() : VulkanExampleBase()
 	{
 		title = "Compute shader N-body system";
@@ -86,6 +147,8 @@ public:
 		camera.setRotation(glm::vec3(-26.0f, 75.0f, 0.0f));
 		camera.setTranslation(glm::vec3(0.0f, 0.0f, -14.0f));
 		camera.movementSpeed = 2.5f;
+		// The benchmark reports the sort cost
+		sort.enabled = m_benchmark.active;
 	}
 
 	~VulkanExample()
@@ -94,6 +157,7 @@ public:
 			// Graphics
 			graphics.uniformBuffer.destroy();
 			vkDestroyPipeline(m_vkDevice, graphics.pipeline, nullptr);
+			vkDestroyPipeline(m_vkDevice, graphics.pipelineSorted, nullptr);
 			vkDestroyPipelineLayout(m_vkDevice, graphics.pipelineLayout, nullptr);
 			vkDestroyDescriptorSetLayout(m_vkDevice, graphics.descriptorSetLayout, nullptr);
 			vkDestroySemaphore(m_vkDevice, graphics.semaphore, nullptr);
@@ -104,14 +168,30 @@ public:
 			vkDestroyDescriptorSetLayout(m_vkDevice, compute.descriptorSetLayout, nullptr);
 			vkDestroyPipeline(m_vkDevice, compute.pipelineCalculate, nullptr);
 			vkDestroyPipeline(m_vkDevice, compute.pipelineIntegrate, nullptr);
+			vkDestroyPipeline(m_vkDevice, compute.pipelineAccumulate, nullptr);
+			vkDestroyPipeline(m_vkDevice, compute.pipelineReduce, nullptr);
+			vkDestroyPipeline(m_vkDevice, compute.pipelineCalculateOctree, nullptr);
+			vkDestroyQueryPool(m_vkDevice, compute.timestampQueryPool, nullptr);
+			compute.octreeBuffer.destroy();
 			vkDestroySemaphore(m_vkDevice, compute.semaphore, nullptr);
 			vkDestroyCommandPool(m_vkDevice, compute.commandPool, nullptr);
 
+			// Sort
+			sort.radixSort.destroy();
+			vkDestroyPipeline(m_vkDevice, sort.pipelineDepth, nullptr);
+			vkDestroyPipelineLayout(m_vkDevice, sort.pipelineLayout, nullptr);
+			vkDestroyDescriptorSetLayout(m_vkDevice, sort.descriptorSetLayout, nullptr);
+			sort.keys.destroy();
+			sort.values.destroy();
+
 			storageBuffer.destroy();
 
 			textures.particle.destroy();
 			textures.gradient.destroy();
 		}
+		if (m_benchmark.active && (sort.sortCount > 0)) {
+			std::cout << "Sorting " << numParticles << " particles took " << (sort.totalTime / sort.sortCount) * 1000000.0 / numParticles << " ms per million particles\n";
+		}
 	}
 
 	void loadAssets()
@@ -120,6 +200,21 @@ public:
 		textures.gradient.loadFromFile(getAssetPath() + "textures/particle_gradient_rgba.ktx", VK_FORMAT_R8G8B8A8_UNORM, m_pVulkanDevice, m_vkQueue);
 	}
 
+	// The sorted index buffer changes queue family ownership along with the storage buffer if sorting is enabled
+	std::vector<VkBufferMemoryBarrier> ownershipBarriers(const VkBufferMemoryBarrier& storageBufferBarrier)
+	{
+		std::vector<VkBufferMemoryBarrier> barriers = { storageBufferBarrier };
+		if (sort.enabled) {
+			VkBufferMemoryBarrier indexBufferBarrier = storageBufferBarrier;
+			indexBufferBarrier.srcAccessMask = (indexBufferBarrier.srcAccessMask == VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT) ? VK_ACCESS_INDEX_READ_BIT : indexBufferBarrier.srcAccessMask;
+			indexBufferBarrier.dstAccessMask = (indexBufferBarrier.dstAccessMask == VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT) ? VK_ACCESS_INDEX_READ_BIT : indexBufferBarrier.dstAccessMask;
+			indexBufferBarrier.buffer = sort.values.buffer;
+			indexBufferBarrier.size = sort.values.size;
+			barriers.push_back(indexBufferBarrier);
+		}
+		return barriers;
+	}
+
 	void buildCommandBuffers()
 	{
 		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
@@ -159,6 +254,7 @@ public:
 					0,
 					storageBuffer.size
 				};
+				const std::vector<VkBufferMemoryBarrier> barriers = ownershipBarriers(buffer_barrier);
 
 				vkCmdPipelineBarrier(
 					drawCmdBuffers[i],
@@ -166,7 +262,7 @@ public:
 					VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
 					0,
 					0, nullptr,
-					1, &buffer_barrier,
+					static_cast<uint32_t>(barriers.size()), barriers.data(),
 					0, nullptr);
 			}
 
@@ -179,12 +275,18 @@ public:
 			VkRect2D scissor = vks::initializers::rect2D(m_drawAreaWidth, m_drawAreaHeight, 0, 0);
 			vkCmdSetScissor(drawCmdBuffers[i], 0, 1, &scissor);
 
-			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphics.pipeline);
+			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, sort.enabled ? graphics.pipelineSorted : graphics.pipeline);
 			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphics.pipelineLayout, 0, 1, &graphics.descriptorSet, 0, nullptr);
 
 			VkDeviceSize offsets[1] = { 0 };
 			vkCmdBindVertexBuffers(drawCmdBuffers[i], 0, 1, &storageBuffer.buffer, offsets);
-			vkCmdDraw(drawCmdBuffers[i], numParticles, 1, 0, 0);
+			if (sort.enabled) {
+				// The sorted particle indices draw the particles back to front
+				vkCmdBindIndexBuffer(drawCmdBuffers[i], sort.values.buffer, 0, VK_INDEX_TYPE_UINT32);
+				vkCmdDrawIndexed(drawCmdBuffers[i], numParticles, 1, 0, 0, 0);
+			} else {
+				vkCmdDraw(drawCmdBuffers[i], numParticles, 1, 0, 0);
+			}
 
 			drawUI(drawCmdBuffers[i]);
 
@@ -205,6 +307,7 @@ public:
 					0,
 					storageBuffer.size
 				};
+				const std::vector<VkBufferMemoryBarrier> barriers = ownershipBarriers(buffer_barrier);
 
 				vkCmdPipelineBarrier(
 					drawCmdBuffers[i],
@@ -212,7 +315,7 @@ public:
 					VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
 					0,
 					0, nullptr,
-					1, &buffer_barrier,
+					static_cast<uint32_t>(barriers.size()), barriers.data(),
 					0, nullptr);
 			}
 
@@ -221,6 +324,85 @@ public:
 
 	}
 
+	/*
+		Record one simulation step: the velocity calculation (all pairs or Barnes-Hut), optionally followed by the integration
+		Dispatches are rounded up, so particle counts don't need to be a multiple of the workgroup size
+	*/
+	void recordSimulationStep(VkCommandBuffer commandBuffer, bool integrate)
+	{
+		const uint32_t particleGroupCount = (numParticles + 255) / 256;
+
+		// Previous steps (or commands submitted before) have finished writing the particles and reading the octree
+		VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_FLAGS_NONE, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelineLayout, 0, 1, &compute.descriptorSet, 0, 0);
+
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		if (simulationMode == Octree)
+		{
+			// Build the octree: Clear all cells, add the particles to the finest level and sum up the levels above it
+			vkCmdFillBuffer(commandBuffer, compute.octreeBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+			VkMemoryBarrier clearBarrier = vks::initializers::memoryBarrier();
+			clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_FLAGS_NONE, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelineAccumulate);
+			vkCmdDispatch(commandBuffer, particleGroupCount, 1, 1);
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelineReduce);
+			for (uint32_t level = compute.uniformData.levels; level-- > 0;) {
+				vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_FLAGS_NONE, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+				const uint32_t cellCount = 1u << (3 * level);
+				vkCmdPushConstants(commandBuffer, compute.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &level);
+				vkCmdDispatch(commandBuffer, (cellCount + 255) / 256, 1, 1);
+			}
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_FLAGS_NONE, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+			// First pass: Calculate particle movement by traversing the octree
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelineCalculateOctree);
+			vkCmdDispatch(commandBuffer, particleGroupCount, 1, 1);
+		}
+		else
+		{
+			// First pass: Calculate particle movement
+			// -------------------------------------------------------------------------------------------------------
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelineCalculate);
+			vkCmdDispatch(commandBuffer, particleGroupCount, 1, 1);
+		}
+
+		if (!integrate) {
+			return;
+		}
+
+		// Add m_vkDeviceMemory barrier to ensure that the computer shader has finished writing to the buffer
+		VkBufferMemoryBarrier bufferBarrier = vks::initializers::bufferMemoryBarrier();
+		bufferBarrier.buffer = storageBuffer.buffer;
+		bufferBarrier.size = storageBuffer.descriptor.range;
+		bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		// Transfer ownership if compute and graphics m_vkQueue family indices differ
+		bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_FLAGS_NONE,
+			0, nullptr,
+			1, &bufferBarrier,
+			0, nullptr);
+
+		// Second pass: Integrate particles
+		// -------------------------------------------------------------------------------------------------------
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelineIntegrate);
+		vkCmdDispatch(commandBuffer, particleGroupCount, 1, 1);
+	}
+
 	void buildComputeCommandBuffer()
 	{
 		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
@@ -242,6 +424,7 @@ public:
 				0,
 				storageBuffer.size
 			};
+			const std::vector<VkBufferMemoryBarrier> barriers = ownershipBarriers(buffer_barrier);
 
 			vkCmdPipelineBarrier(
 				compute.commandBuffer,
@@ -249,39 +432,39 @@ public:
 				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
 				0,
 				0, nullptr,
-				1, &buffer_barrier,
+				static_cast<uint32_t>(barriers.size()), barriers.data(),
 				0, nullptr);
 		}
 
-		// First pass: Calculate particle movement
-		// -------------------------------------------------------------------------------------------------------
-		vkCmdBindPipeline(compute.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelineCalculate);
-		vkCmdBindDescriptorSets(compute.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelineLayout, 0, 1, &compute.descriptorSet, 0, 0);
-		vkCmdDispatch(compute.commandBuffer, numParticles / 256, 1, 1);
-
-		// Add m_vkDeviceMemory barrier to ensure that the computer shader has finished writing to the buffer
-		VkBufferMemoryBarrier bufferBarrier = vks::initializers::bufferMemoryBarrier();
-		bufferBarrier.buffer = storageBuffer.buffer;
-		bufferBarrier.size = storageBuffer.descriptor.range;
-		bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-		bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		// Transfer ownership if compute and graphics m_vkQueue family indices differ
-		bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-
-		vkCmdPipelineBarrier(
-			compute.commandBuffer,
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-			VK_FLAGS_NONE,
-			0, nullptr,
-			1, &bufferBarrier,
-			0, nullptr);
+		if (compute.timestampQueryPool != VK_NULL_HANDLE) {
+			vkCmdResetQueryPool(compute.commandBuffer, compute.timestampQueryPool, 0, 4);
+			vkCmdWriteTimestamp(compute.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, compute.timestampQueryPool, 0);
+		}
+		recordSimulationStep(compute.commandBuffer, true);
+		if (compute.timestampQueryPool != VK_NULL_HANDLE) {
+			vkCmdWriteTimestamp(compute.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, compute.timestampQueryPool, 1);
+		}
 
-		// Second pass: Integrate particles
+		// Optional third pass: Sort the particles back to front
 		// -------------------------------------------------------------------------------------------------------
-		vkCmdBindPipeline(compute.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute.pipelineIntegrate);
-		vkCmdDispatch(compute.commandBuffer, numParticles / 256, 1, 1);
+		if (sort.enabled)
+		{
+			if (compute.timestampQueryPool != VK_NULL_HANDLE) {
+				vkCmdWriteTimestamp(compute.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, compute.timestampQueryPool, 2);
+			}
+			VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+			memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(compute.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_FLAGS_NONE, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+			vkCmdBindPipeline(compute.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, sort.pipelineDepth);
+			vkCmdBindDescriptorSets(compute.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, sort.pipelineLayout, 0, 1, &sort.descriptorSet, 0, nullptr);
+			vkCmdPushConstants(compute.commandBuffer, sort.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &numParticles);
+			vkCmdDispatch(compute.commandBuffer, (numParticles + 255) / 256, 1, 1);
+			sort.radixSort.record(compute.commandBuffer, numParticles);
+			if (compute.timestampQueryPool != VK_NULL_HANDLE) {
+				vkCmdWriteTimestamp(compute.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, compute.timestampQueryPool, 3);
+			}
+		}
 
 		// Release barrier
 		if (graphics.queueFamilyIndex != compute.queueFamilyIndex)
@@ -298,6 +481,7 @@ public:
 				0,
 				storageBuffer.size
 			};
+			const std::vector<VkBufferMemoryBarrier> barriers = ownershipBarriers(buffer_barrier);
 
 			vkCmdPipelineBarrier(
 				compute.commandBuffer,
@@ -305,7 +489,7 @@ public:
 				VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
 				0,
 				0, nullptr,
-				1, &buffer_barrier,
+				static_cast<uint32_t>(barriers.size()), barriers.data(),
 				0, nullptr);
 		}
 
@@ -325,7 +509,8 @@ public:
 			glm::vec3(0.0f, -8.0f, 0.0f),
 		};
 
-		numParticles = static_cast<uint32_t>(attractors.size()) * PARTICLES_PER_ATTRACTOR;
+		const uint32_t particlesPerGroup = particlesPerAttractor[particleCountIndex];
+		numParticles = static_cast<uint32_t>(attractors.size()) * particlesPerGroup;
 
 		// Initial particle positions
 		std::vector<Particle> particleBuffer(numParticles);
@@ -335,9 +520,9 @@ public:
 
 		for (uint32_t i = 0; i < static_cast<uint32_t>(attractors.size()); i++)
 		{
-			for (uint32_t j = 0; j < PARTICLES_PER_ATTRACTOR; j++)
+			for (uint32_t j = 0; j < particlesPerGroup; j++)
 			{
-				Particle& particle = particleBuffer[i * PARTICLES_PER_ATTRACTOR + j];
+				Particle& particle = particleBuffer[i * particlesPerGroup + j];
 
 				// First particle in group as heavy center of gravity
 				if (j == 0)
@@ -377,7 +562,8 @@ public:
 
 		m_pVulkanDevice->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, storageBufferSize, particleBuffer.data());
 		// The SSBO will be used as a storage buffer for the compute pipeline and as a vertex buffer in the graphics pipeline
-		m_pVulkanDevice->createBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &storageBuffer, storageBufferSize);
+		// It's also a transfer source for reading back particles when validating against the CPU reference
+		m_pVulkanDevice->createBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &storageBuffer, storageBufferSize);
 
 		// Copy from staging buffer to storage buffer
 		VkCommandBuffer copyCmd = m_pVulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
@@ -422,11 +608,11 @@ public:
 
 		// Descriptor pool
 		std::vector<VkDescriptorPoolSize> poolSizes = {
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2),
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5),
 			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2)
 		};
-		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, 2);
+		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, 3);
 		VK_CHECK_RESULT(vkCreateDescriptorPool(m_vkDevice, &descriptorPoolInfo, nullptr, &m_vkDescriptorPool));
 
 		// Descriptor layout
@@ -512,6 +698,22 @@ public:
 
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCreateInfo, nullptr, &graphics.pipeline));
 
+		// Sorting is optional, the sample still runs if its shaders haven't been compiled for the selected shading language
+		sort.supported = shaderExists(getShadersPath() + "computenbody/particle_sorted.frag.spv") && shaderExists(getShadersPath() + "computenbody/particle_depth.comp.spv") && shaderExists(getShadersPath() + "base/radixsort.comp.spv");
+		if (!sort.supported) {
+			std::cerr << "Shaders for depth sorting not found, depth sorted alpha blending is disabled\n";
+			sort.enabled = false;
+		}
+
+		// Premultiplied alpha blending, which depends on the drawing order, for particles sorted back to front
+		if (sort.supported) {
+			blendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+			blendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+			blendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+			shaderStages[1] = loadShader(getShadersPath() + "computenbody/particle_sorted.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+			VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCreateInfo, nullptr, &graphics.pipelineSorted));
+		}
+
 		// We use a semaphore to synchronize compute and graphics
 		VkSemaphoreCreateInfo semaphoreCreateInfo = vks::initializers::semaphoreCreateInfo();
 		VK_CHECK_RESULT(vkCreateSemaphore(m_vkDevice, &semaphoreCreateInfo, nullptr, &graphics.semaphore));
@@ -523,6 +725,11 @@ public:
 		VK_CHECK_RESULT(vkQueueSubmit(m_vkQueue, 1, &submitInfo, VK_NULL_HANDLE));
 		VK_CHECK_RESULT(vkQueueWaitIdle(m_vkQueue));
 
+		// The draw command buffers use the sorted index buffer
+		if (sort.supported) {
+			prepareSort();
+		}
+
 		buildCommandBuffers();
 	}
 
@@ -538,6 +745,10 @@ public:
 		m_pVulkanDevice->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &compute.uniformBuffer, sizeof(Compute::UniformData));
 		VK_CHECK_RESULT(compute.uniformBuffer.map());
 
+		// Cells of all levels of the octree used by the Barnes-Hut mode, the size doesn't depend on the particle count
+		const VkDeviceSize octreeSize = static_cast<VkDeviceSize>(vks::nbody::levelOffset(compute.uniformData.levels + 1)) * 5 * sizeof(uint32_t);
+		m_pVulkanDevice->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &compute.octreeBuffer, octreeSize);
+
 		// Create compute pipeline
 		// Compute pipelines are created separate from graphics pipelines even if they use the same m_vkQueue (family index)
 
@@ -546,6 +757,8 @@ public:
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
 			// Binding 1 : Uniform buffer
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+			// Binding 2 : Octree cells
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2),
 		};
 
 		VkDescriptorSetLayoutCreateInfo descriptorLayout = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
@@ -558,12 +771,18 @@ public:
 			// Binding 0 : Particle position storage buffer
 			vks::initializers::writeDescriptorSet(compute.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &storageBuffer.descriptor),
 			// Binding 1 : Uniform buffer
-			vks::initializers::writeDescriptorSet(compute.descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,1,&compute.uniformBuffer.descriptor)
+			vks::initializers::writeDescriptorSet(compute.descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,1,&compute.uniformBuffer.descriptor),
+			// Binding 2 : Octree cells
+			vks::initializers::writeDescriptorSet(compute.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &compute.octreeBuffer.descriptor)
 		};
 		vkUpdateDescriptorSets(m_vkDevice, static_cast<uint32_t>(computeWriteDescriptorSets.size()), computeWriteDescriptorSets.data(), 0, nullptr);
 
 		// Create pipelines
+		// The octree reduction passes the level to sum up as a push constant
+		VkPushConstantRange pushConstantRange = vks::initializers::pushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(uint32_t), 0);
 		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = vks::initializers::pipelineLayoutCreateInfo(&compute.descriptorSetLayout, 1);
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
 		VK_CHECK_RESULT(vkCreatePipelineLayout(m_vkDevice, &pipelineLayoutCreateInfo, nullptr, &compute.pipelineLayout));
 
 		VkComputePipelineCreateInfo computePipelineCreateInfo = vks::initializers::computePipelineCreateInfo(compute.pipelineLayout, 0);
@@ -583,6 +802,30 @@ public:
 		computePipelineCreateInfo.stage = loadShader(getShadersPath() + "computenbody/particle_integrate.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
 		VK_CHECK_RESULT(vkCreateComputePipelines(m_vkDevice, m_vkPipelineCache, 1, &computePipelineCreateInfo, nullptr, &compute.pipelineIntegrate));
 
+		// Octree mode: Build the octree and replace the 1st pass with a Barnes-Hut traversal
+		octreeSupported = shaderExists(getShadersPath() + "computenbody/particle_accumulate.comp.spv") && shaderExists(getShadersPath() + "computenbody/particle_reduce.comp.spv") && shaderExists(getShadersPath() + "computenbody/particle_calculate_octree.comp.spv");
+		if (octreeSupported) {
+			computePipelineCreateInfo.stage = loadShader(getShadersPath() + "computenbody/particle_accumulate.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+			VK_CHECK_RESULT(vkCreateComputePipelines(m_vkDevice, m_vkPipelineCache, 1, &computePipelineCreateInfo, nullptr, &compute.pipelineAccumulate));
+			computePipelineCreateInfo.stage = loadShader(getShadersPath() + "computenbody/particle_reduce.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+			VK_CHECK_RESULT(vkCreateComputePipelines(m_vkDevice, m_vkPipelineCache, 1, &computePipelineCreateInfo, nullptr, &compute.pipelineReduce));
+			computePipelineCreateInfo.stage = loadShader(getShadersPath() + "computenbody/particle_calculate_octree.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+			VK_CHECK_RESULT(vkCreateComputePipelines(m_vkDevice, m_vkPipelineCache, 1, &computePipelineCreateInfo, nullptr, &compute.pipelineCalculateOctree));
+		} else {
+			std::cerr << "Shaders for the octree not found, the Barnes-Hut simulation is disabled\n";
+			simulationMode = AllPairs;
+		}
+
+		// Timestamps are optional for compute only m_vkQueue families
+		if (m_pVulkanDevice->m_vkQueueFamilyProperties[compute.queueFamilyIndex].timestampValidBits > 0) {
+			VkQueryPoolCreateInfo queryPoolCI{};
+			queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			queryPoolCI.queryCount = 4;
+			VK_CHECK_RESULT(vkCreateQueryPool(m_vkDevice, &queryPoolCI, nullptr, &compute.timestampQueryPool));
+			vkResetQueryPool(m_vkDevice, compute.timestampQueryPool, 0, queryPoolCI.queryCount);
+		}
+
 		// Separate command pool as m_vkQueue family for compute may be different than graphics
 		VkCommandPoolCreateInfo cmdPoolInfo = {};
 		cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
@@ -601,6 +844,280 @@ public:
 		buildComputeCommandBuffer();
 	}
 
+	// Buffers and pipelines for sorting the particles back to front on the compute m_vkQueue
+	void prepareSort()
+	{
+		prepareSortBuffers();
+
+		// Depth key pass
+		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+			// Binding 0 : Particle position storage buffer
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+			// Binding 1 : Graphics uniform buffer with the view matrix
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+			// Binding 2 : Depth keys
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2),
+			// Binding 3 : Particle indices
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 3),
+		};
+		VkDescriptorSetLayoutCreateInfo descriptorLayout = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(m_vkDevice, &descriptorLayout, nullptr, &sort.descriptorSetLayout));
+		VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(m_vkDescriptorPool, &sort.descriptorSetLayout, 1);
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(m_vkDevice, &allocInfo, &sort.descriptorSet));
+		updateSortDescriptorSet();
+
+		VkPushConstantRange pushConstantRange = vks::initializers::pushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(uint32_t), 0);
+		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = vks::initializers::pipelineLayoutCreateInfo(&sort.descriptorSetLayout, 1);
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+		VK_CHECK_RESULT(vkCreatePipelineLayout(m_vkDevice, &pipelineLayoutCreateInfo, nullptr, &sort.pipelineLayout));
+		VkComputePipelineCreateInfo computePipelineCreateInfo = vks::initializers::computePipelineCreateInfo(sort.pipelineLayout, 0);
+		computePipelineCreateInfo.stage = loadShader(getShadersPath() + "computenbody/particle_depth.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+		VK_CHECK_RESULT(vkCreateComputePipelines(m_vkDevice, m_vkPipelineCache, 1, &computePipelineCreateInfo, nullptr, &sort.pipelineDepth));
+	}
+
+	// Key and index buffers depend on the particle count
+	void prepareSortBuffers()
+	{
+		VkDeviceSize bufferSize = numParticles * sizeof(uint32_t);
+		m_pVulkanDevice->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &sort.keys, bufferSize);
+		// The sorted values are the particle indices in drawing order
+		m_pVulkanDevice->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &sort.values, bufferSize);
+		sort.radixSort.create(m_pVulkanDevice, sort.keys.buffer, sort.values.buffer, numParticles, loadShader(getShadersPath() + "base/radixsort.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT), m_vkPipelineCache);
+	}
+
+	void updateSortDescriptorSet()
+	{
+		std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+			vks::initializers::writeDescriptorSet(sort.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &storageBuffer.descriptor),
+			vks::initializers::writeDescriptorSet(sort.descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, &graphics.uniformBuffer.descriptor),
+			vks::initializers::writeDescriptorSet(sort.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &sort.keys.descriptor),
+			vks::initializers::writeDescriptorSet(sort.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, &sort.values.descriptor),
+		};
+		vkUpdateDescriptorSets(m_vkDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+	}
+
+	// Read the simulation and sort timestamps of the last compute submission, results that aren't available yet are skipped
+	void updateTimings()
+	{
+		if (compute.timestampQueryPool == VK_NULL_HANDLE) {
+			return;
+		}
+		const float timestampPeriod = m_pVulkanDevice->m_vkPhysicalDeviceProperties.limits.timestampPeriod;
+		uint64_t results[4]{};
+		VkResult result = vkGetQueryPoolResults(m_vkDevice, compute.timestampQueryPool, 0, 2, sizeof(results), results, sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		if ((result == VK_SUCCESS) && results[1] && results[3]) {
+			compute.stepTime = static_cast<float>(results[2] - results[0]) * timestampPeriod / 1000000.0f;
+		}
+		if (!sort.enabled) {
+			return;
+		}
+		result = vkGetQueryPoolResults(m_vkDevice, compute.timestampQueryPool, 2, 2, sizeof(results), results, sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		if ((result == VK_SUCCESS) && results[1] && results[3]) {
+			sort.time = static_cast<float>(results[2] - results[0]) * timestampPeriod / 1000000.0f;
+			sort.totalTime += sort.time;
+			sort.sortCount++;
+		}
+	}
+
+	/*
+		Record and submit commands on the compute m_vkQueue outside of the frame loop and wait for them
+		The frames hand the particle buffers back and forth between the m_vkQueue families, so if these differ the buffers
+		are acquired and released like in the compute command buffer, followed by the matching graphics side transfer
+	*/
+	void submitComputeOnce(const std::function<void(VkCommandBuffer)>& record)
+	{
+		const bool transferOwnership = graphics.queueFamilyIndex != compute.queueFamilyIndex;
+		VkBufferMemoryBarrier bufferBarrier = vks::initializers::bufferMemoryBarrier();
+		bufferBarrier.buffer = storageBuffer.buffer;
+		bufferBarrier.size = storageBuffer.size;
+
+		VkCommandBuffer commandBuffer = m_pVulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, compute.commandPool, true);
+		if (transferOwnership) {
+			bufferBarrier.srcAccessMask = 0;
+			bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+			bufferBarrier.srcQueueFamilyIndex = graphics.queueFamilyIndex;
+			bufferBarrier.dstQueueFamilyIndex = compute.queueFamilyIndex;
+			const std::vector<VkBufferMemoryBarrier> barriers = ownershipBarriers(bufferBarrier);
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+		}
+		record(commandBuffer);
+		if (transferOwnership) {
+			bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+			bufferBarrier.dstAccessMask = 0;
+			bufferBarrier.srcQueueFamilyIndex = compute.queueFamilyIndex;
+			bufferBarrier.dstQueueFamilyIndex = graphics.queueFamilyIndex;
+			const std::vector<VkBufferMemoryBarrier> barriers = ownershipBarriers(bufferBarrier);
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+		}
+		m_pVulkanDevice->flushCommandBuffer(commandBuffer, compute.queue, compute.commandPool, true);
+
+		if (transferOwnership) {
+			// Acquire on the graphics m_vkQueue and release again, so the next frame's compute submission finds the buffers where it expects them
+			commandBuffer = m_pVulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+			bufferBarrier.srcAccessMask = 0;
+			bufferBarrier.dstAccessMask = 0;
+			std::vector<VkBufferMemoryBarrier> barriers = ownershipBarriers(bufferBarrier);
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+			bufferBarrier.srcQueueFamilyIndex = graphics.queueFamilyIndex;
+			bufferBarrier.dstQueueFamilyIndex = compute.queueFamilyIndex;
+			barriers = ownershipBarriers(bufferBarrier);
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+			m_pVulkanDevice->flushCommandBuffer(commandBuffer, m_vkQueue, true);
+		}
+	}
+
+	// Recreate all buffers that depend on the particle count
+	void changeParticleCount()
+	{
+		vkDeviceWaitIdle(m_vkDevice);
+		storageBuffer.destroy();
+		sort.radixSort.destroy();
+		sort.keys.destroy();
+		sort.values.destroy();
+		prepareStorageBuffers();
+		std::vector<VkWriteDescriptorSet> computeWriteDescriptorSets = {
+			vks::initializers::writeDescriptorSet(compute.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &storageBuffer.descriptor),
+		};
+		vkUpdateDescriptorSets(m_vkDevice, static_cast<uint32_t>(computeWriteDescriptorSets.size()), computeWriteDescriptorSets.data(), 0, nullptr);
+		if (sort.supported) {
+			prepareSortBuffers();
+			updateSortDescriptorSet();
+		}
+		validation.done = false;
+		buildComputeCommandBuffer();
+		buildCommandBuffers();
+	}
+
+	/*
+		Compare the velocity calculation of the GPU with the CPU reference (base/NBody.cpp) for a sample of particles
+		Runs the 1st pass with a time step of one, so the change in velocity equals the acceleration, and restores the particles afterwards
+	*/
+	void validate()
+	{
+		vkDeviceWaitIdle(m_vkDevice);
+		const VkDeviceSize size = storageBuffer.size;
+		vks::Buffer before, after;
+		m_pVulkanDevice->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &before, size);
+		m_pVulkanDevice->createBuffer(VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &after, size);
+
+		const Compute::UniformData uniformData = compute.uniformData;
+		compute.uniformData.deltaT = 1.0f;
+		memcpy(compute.uniformBuffer.mapped, &compute.uniformData, sizeof(Compute::UniformData));
+
+		submitComputeOnce([&](VkCommandBuffer commandBuffer) {
+			VkBufferCopy copyRegion = { 0, 0, size };
+			VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+			vkCmdCopyBuffer(commandBuffer, storageBuffer.buffer, before.buffer, 1, &copyRegion);
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_FLAGS_NONE, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+			recordSimulationStep(commandBuffer, false);
+			memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_FLAGS_NONE, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+			vkCmdCopyBuffer(commandBuffer, storageBuffer.buffer, after.buffer, 1, &copyRegion);
+			// Undo the velocity change
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_FLAGS_NONE, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+			vkCmdCopyBuffer(commandBuffer, before.buffer, storageBuffer.buffer, 1, &copyRegion);
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, VK_FLAGS_NONE, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+		});
+
+		compute.uniformData = uniformData;
+		memcpy(compute.uniformBuffer.mapped, &compute.uniformData, sizeof(Compute::UniformData));
+
+		VK_CHECK_RESULT(before.map());
+		VK_CHECK_RESULT(after.map());
+		std::vector<vks::nbody::Particle> particles(numParticles);
+		memcpy(particles.data(), before.mapped, size);
+		const vks::nbody::Particle* results = static_cast<const vks::nbody::Particle*>(after.mapped);
+
+		// Evenly spaced sample, the all pairs reference is O(N) per particle
+		const uint32_t sampleCount = std::min(numParticles, 1024u);
+		std::vector<uint32_t> targets(sampleCount);
+		std::vector<float> gpuAccelerations(sampleCount * 3);
+		for (uint32_t i = 0; i < sampleCount; i++) {
+			targets[i] = static_cast<uint32_t>(static_cast<uint64_t>(i) * numParticles / sampleCount);
+			for (uint32_t j = 0; j < 3; j++) {
+				gpuAccelerations[i * 3 + j] = results[targets[i]].velocity[j] - particles[targets[i]].velocity[j];
+			}
+		}
+		before.destroy();
+		after.destroy();
+
+		vks::nbody::Settings settings;
+		settings.gravity = compute.uniformData.gravity;
+		settings.power = compute.uniformData.power;
+		settings.soften = compute.uniformData.soften;
+		settings.theta = compute.uniformData.theta;
+		settings.levels = compute.uniformData.levels;
+		settings.boundsSize = compute.uniformData.boundsSize;
+		for (uint32_t j = 0; j < 3; j++) {
+			settings.boundsMin[j] = compute.uniformData.boundsMin[j];
+		}
+		std::vector<float> allPairs, hierarchical;
+		vks::nbody::accelerations(particles, settings, vks::nbody::Mode::AllPairs, targets, allPairs);
+		vks::nbody::accelerations(particles, settings, vks::nbody::Mode::Hierarchical, targets, hierarchical);
+		validation.gpu = vks::nbody::compare((simulationMode == Octree) ? hierarchical : allPairs, gpuAccelerations);
+		validation.approximation = vks::nbody::compare(allPairs, hierarchical);
+		validation.sampleCount = sampleCount;
+		validation.done = true;
+		std::cout << "Validation (" << sampleCount << " particles): GPU vs CPU rms error " << validation.gpu.rmsRelative * 100.0 << "%, max " << validation.gpu.maxRelative * 100.0 << "%"
+			<< ", octree vs all pairs rms error " << validation.approximation.rmsRelative * 100.0 << "%\n";
+	}
+
+	/*
+		Measure simulation steps per second for all particle counts in both modes, all pairs is skipped for counts where it's impractical
+		Every measurement runs a batch of steps in one submission, timed on the host, the particles are reset afterwards
+	*/
+	void runStepBenchmark()
+	{
+		const int32_t countIndex = particleCountIndex;
+		const int32_t mode = simulationMode;
+		const uint32_t stepCount = 16;
+		compute.uniformData.deltaT = 0.0f;
+		memcpy(compute.uniformBuffer.mapped, &compute.uniformData, sizeof(Compute::UniformData));
+		stepBenchmarks.clear();
+		for (int32_t i = 0; i < static_cast<int32_t>(particlesPerAttractor.size()); i++) {
+			if (!octreeSupported && (particlesPerAttractor[i] * 6 > maxAllPairsParticles)) {
+				break;
+			}
+			particleCountIndex = i;
+			changeParticleCount();
+			for (int32_t m : { AllPairs, Octree }) {
+				if ((m == AllPairs) && (numParticles > maxAllPairsParticles)) {
+					continue;
+				}
+				if ((m == Octree) && !octreeSupported) {
+					continue;
+				}
+				simulationMode = m;
+				const auto record = [&](VkCommandBuffer commandBuffer) {
+					for (uint32_t step = 0; step < stepCount; step++) {
+						recordSimulationStep(commandBuffer, true);
+					}
+				};
+				// Warm up run excludes pipeline and memory setup costs from the measurement
+				submitComputeOnce(record);
+				const auto tStart = std::chrono::high_resolution_clock::now();
+				submitComputeOnce(record);
+				const double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - tStart).count();
+				stepBenchmarks.push_back({ numParticles, m, stepCount / seconds });
+			}
+		}
+		std::cout << "Simulation steps per second:\n";
+		for (const StepBenchmark& result : stepBenchmarks) {
+			std::cout << "  " << result.particleCount << " particles, " << ((result.mode == AllPairs) ? "all pairs" : "octree") << ": " << result.stepsPerSecond << "\n";
+		}
+		particleCountIndex = countIndex;
+		simulationMode = mode;
+		changeParticleCount();
+	}
+
 	void updateComputeUniformBuffers()
 	{
 		compute.uniformData.deltaT = paused ? 0.0f : m_frameTimer * 0.05f;
@@ -626,6 +1143,9 @@ public:
 		prepareStorageBuffers();
 		prepareGraphics();
 		prepareCompute();
+		if (m_benchmark.active) {
+			runStepBenchmark();
+		}
 		m_prepared = true;
 	}
 
@@ -647,18 +1167,23 @@ public:
 
 		VulkanExampleBase::prepareFrame();
 
+		// The swap chain semaphores go last, there are none in headless mode
 		VkPipelineStageFlags graphicsWaitStageMasks[] = { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		VkSemaphore graphicsWaitSemaphores[] = { compute.semaphore, semaphores.m_vkSemaphorePresentComplete };
-		VkSemaphore graphicsSignalSemaphores[] = { graphics.semaphore, semaphores.m_vkSemaphoreRenderComplete };
+		std::vector<VkSemaphore> graphicsWaitSemaphores = { compute.semaphore };
+		std::vector<VkSemaphore> graphicsSignalSemaphores = { graphics.semaphore };
+		const std::vector<VkSemaphore> presentWaitSemaphores = getPresentWaitSemaphores();
+		const std::vector<VkSemaphore> presentSignalSemaphores = getPresentSignalSemaphores();
+		graphicsWaitSemaphores.insert(graphicsWaitSemaphores.end(), presentWaitSemaphores.begin(), presentWaitSemaphores.end());
+		graphicsSignalSemaphores.insert(graphicsSignalSemaphores.end(), presentSignalSemaphores.begin(), presentSignalSemaphores.end());
 
 		// Submit graphics commands
 		m_vkSubmitInfo.commandBufferCount = 1;
 		m_vkSubmitInfo.pCommandBuffers = &drawCmdBuffers[m_currentBufferIndex];
-		m_vkSubmitInfo.waitSemaphoreCount = 2;
-		m_vkSubmitInfo.pWaitSemaphores = graphicsWaitSemaphores;
+		m_vkSubmitInfo.waitSemaphoreCount = static_cast<uint32_t>(graphicsWaitSemaphores.size());
+		m_vkSubmitInfo.pWaitSemaphores = graphicsWaitSemaphores.data();
 		m_vkSubmitInfo.pWaitDstStageMask = graphicsWaitStageMasks;
-		m_vkSubmitInfo.signalSemaphoreCount = 2;
-		m_vkSubmitInfo.pSignalSemaphores = graphicsSignalSemaphores;
+		m_vkSubmitInfo.signalSemaphoreCount = static_cast<uint32_t>(graphicsSignalSemaphores.size());
+		m_vkSubmitInfo.pSignalSemaphores = graphicsSignalSemaphores.data();
 		VK_CHECK_RESULT(vkQueueSubmit(m_vkQueue, 1, &m_vkSubmitInfo, VK_NULL_HANDLE));
 
 		VulkanExampleBase::submitFrame();
@@ -670,8 +1195,69 @@ public:
 			return;
 		updateComputeUniformBuffers();
 		updateGraphicsUniformBuffers();
+		updateTimings();
 		draw();
 	}
+
+	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay)
+	{
+		if (overlay->header("Settings")) {
+			std::vector<std::string> particleCounts;
+			for (uint32_t count : particlesPerAttractor) {
+				// Counts are ascending, the larger ones can only be simulated with the octree
+				if (!octreeSupported && (count * 6 > maxAllPairsParticles)) {
+					break;
+				}
+				particleCounts.push_back(std::to_string(count * 6));
+			}
+			if (overlay->comboBox("Particles", &particleCountIndex, particleCounts)) {
+				if (particlesPerAttractor[particleCountIndex] * 6 > maxAllPairsParticles) {
+					simulationMode = Octree;
+				}
+				changeParticleCount();
+			}
+			if (octreeSupported && overlay->comboBox("Simulation", &simulationMode, { "All pairs", "Barnes-Hut octree" })) {
+				if (numParticles > maxAllPairsParticles) {
+					simulationMode = Octree;
+				}
+				// The compute command buffer is only recorded once, so it needs to be idle before it's rebuilt
+				vkQueueWaitIdle(compute.queue);
+				validation.done = false;
+				buildComputeCommandBuffer();
+			}
+			if ((simulationMode == Octree) && overlay->sliderFloat("Opening angle", &compute.uniformData.theta, 0.0f, 1.5f)) {
+				validation.done = false;
+			}
+			if (sort.supported && overlay->checkBox("Depth sorted alpha blending", &sort.enabled)) {
+				vkQueueWaitIdle(compute.queue);
+				vkQueueWaitIdle(m_vkQueue);
+				buildComputeCommandBuffer();
+				buildCommandBuffers();
+			}
+			if (overlay->button("Validate against CPU reference")) {
+				validate();
+			}
+			if (overlay->button("Benchmark steps")) {
+				runStepBenchmark();
+			}
+		}
+		if (overlay->header("Statistics")) {
+			if (compute.timestampQueryPool != VK_NULL_HANDLE) {
+				overlay->text("Step: %.3f ms (%.0f steps/s)", compute.stepTime, (compute.stepTime > 0.0f) ? 1000.0f / compute.stepTime : 0.0f);
+				if (sort.enabled) {
+					overlay->text("Sort: %.3f ms", sort.time);
+					overlay->text("%.3f ms per million particles", sort.time * 1000000.0f / numParticles);
+				}
+			}
+			if (validation.done) {
+				overlay->text("GPU vs CPU: %.3f%% rms, %.3f%% max", validation.gpu.rmsRelative * 100.0, validation.gpu.maxRelative * 100.0);
+				overlay->text("Octree vs all pairs: %.3f%% rms", validation.approximation.rmsRelative * 100.0);
+			}
+			for (const StepBenchmark& result : stepBenchmarks) {
+				overlay->text("%u %s: %.1f steps/s", result.particleCount, (result.mode == AllPairs) ? "all pairs" : "octree", result.stepsPerSecond);
+			}
+		}
+	}
 };
 
 VULKAN_EXAMPLE_MAIN()
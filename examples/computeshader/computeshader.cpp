@@ -542,18 +542,23 @@ public:
 		VK_CHECK_RESULT(vkQueueSubmit(compute.queue, 1, &computeSubmitInfo, VK_NULL_HANDLE));
 		VulkanExampleBase::prepareFrame();
 
+		// The swap chain semaphores go last, there are none in headless mode
 		VkPipelineStageFlags graphicsWaitStageMasks[] = { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		VkSemaphore graphicsWaitSemaphores[] = { compute.semaphore, semaphores.m_vkSemaphorePresentComplete };
-		VkSemaphore graphicsSignalSemaphores[] = { graphics.semaphore, semaphores.m_vkSemaphoreRenderComplete };
+		std::vector<VkSemaphore> graphicsWaitSemaphores = { compute.semaphore };
+		std::vector<VkSemaphore> graphicsSignalSemaphores = { graphics.semaphore };
+		const std::vector<VkSemaphore> presentWaitSemaphores = getPresentWaitSemaphores();
+		const std::vector<VkSemaphore> presentSignalSemaphores = getPresentSignalSemaphores();
+		graphicsWaitSemaphores.insert(graphicsWaitSemaphores.end(), presentWaitSemaphores.begin(), presentWaitSemaphores.end());
+		graphicsSignalSemaphores.insert(graphicsSignalSemaphores.end(), presentSignalSemaphores.begin(), presentSignalSemaphores.end());
 
 		// Submit graphics commands
 		m_vkSubmitInfo.commandBufferCount = 1;
 		m_vkSubmitInfo.pCommandBuffers = &drawCmdBuffers[m_currentBufferIndex];
-		m_vkSubmitInfo.waitSemaphoreCount = 2;
-		m_vkSubmitInfo.pWaitSemaphores = graphicsWaitSemaphores;
+		m_vkSubmitInfo.waitSemaphoreCount = static_cast<uint32_t>(graphicsWaitSemaphores.size());
+		m_vkSubmitInfo.pWaitSemaphores = graphicsWaitSemaphores.data();
 		m_vkSubmitInfo.pWaitDstStageMask = graphicsWaitStageMasks;
-		m_vkSubmitInfo.signalSemaphoreCount = 2;
-		m_vkSubmitInfo.pSignalSemaphores = graphicsSignalSemaphores;
+		m_vkSubmitInfo.signalSemaphoreCount = static_cast<uint32_t>(graphicsSignalSemaphores.size());
+		m_vkSubmitInfo.pSignalSemaphores = graphicsSignalSemaphores.data();
 		VK_CHECK_RESULT(vkQueueSubmit(m_vkQueue, 1, &m_vkSubmitInfo, VK_NULL_HANDLE));
 
 		VulkanExampleBase::submitFrame();
@@ -760,9 +760,12 @@ public:
 
 		// Offscreen rendering
 
-		// Wait for swap chain presentation to finish
-		m_vkSubmitInfo.pWaitSemaphores = &semaphores.m_vkSemaphorePresentComplete;
+		// Wait for swap chain presentation to finish (there's nothing to wait on in headless mode)
+		const std::vector<VkSemaphore> presentWaitSemaphores = getPresentWaitSemaphores();
+		m_vkSubmitInfo.waitSemaphoreCount = static_cast<uint32_t>(presentWaitSemaphores.size());
+		m_vkSubmitInfo.pWaitSemaphores = presentWaitSemaphores.data();
 		// Signal ready with offscreen semaphore
+		m_vkSubmitInfo.signalSemaphoreCount = 1;
 		m_vkSubmitInfo.pSignalSemaphores = &offscreenSemaphore;
 
 		// Submit work
@@ -773,9 +776,12 @@ public:
 		// Scene rendering
 
 		// Wait for offscreen semaphore
+		m_vkSubmitInfo.waitSemaphoreCount = 1;
 		m_vkSubmitInfo.pWaitSemaphores = &offscreenSemaphore;
-		// Signal ready with render complete semaphore
-		m_vkSubmitInfo.pSignalSemaphores = &semaphores.m_vkSemaphoreRenderComplete;
+		// Signal ready with render complete semaphore (not used for presentation in headless mode)
+		const std::vector<VkSemaphore> presentSignalSemaphores = getPresentSignalSemaphores();
+		m_vkSubmitInfo.signalSemaphoreCount = static_cast<uint32_t>(presentSignalSemaphores.size());
+		m_vkSubmitInfo.pSignalSemaphores = presentSignalSemaphores.data();
 
 		// Submit work
 		m_vkSubmitInfo.pCommandBuffers = &drawCmdBuffers[m_currentBufferIndex];
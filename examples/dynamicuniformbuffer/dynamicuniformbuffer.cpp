@@ -8,17 +8,17 @@
 * Summary:
 * Demonstrates the use of dynamic uniform buffers.
 *
-* Instead of using one uniform buffer per-object, this example allocates one big uniform buffer
-* with respect to the alignment reported by the m_vkDevice via minUniformBufferOffsetAlignment that
-* contains all matrices for the objects in the scene.
+* Instead of using one uniform buffer per-object, this example allocates all uniform data of a frame
+* from a per frame linear allocator (vks::UniformRing) on top of one big persistently mapped buffer.
+* Allocations are aligned to the minUniformBufferOffsetAlignment reported by the m_vkDevice.
 *
 * The used descriptor type VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC then allows to set a dynamic
 * offset used to pass data from the single uniform buffer to the connected shader binding point.
+* As every frame writes its data to its own region of the buffer, data isn't overwritten while the GPU may still read it.
 */
 
 #include "vulkanexamplebase.h"
-
-#define OBJECT_INSTANCES 125
+#include "VulkanUniformRing.h"
 
 // Vertex layout for this example
 struct Vertex {
@@ -26,30 +26,6 @@ struct Vertex {
 	float color[3];
 };
 
-// Wrapper functions for aligned m_vkDeviceMemory allocation
-// There is currently no standard for this in C++ that works across all platforms and vendors, so we abstract this
-void* alignedAlloc(size_t size, size_t alignment)
-{
-	void *data = nullptr;
-#if defined(_MSC_VER) || defined(__MINGW32__)
-	data = _aligned_malloc(size, alignment);
-#else
-	int res = posix_memalign(&data, alignment, size);
-	if (res != 0)
-		data = nullptr;
-#endif
-	return data;
-}
-
-void alignedFree(void* data)
-{
-#if	defined(_MSC_VER) || defined(__MINGW32__)
-	_aligned_free(data);
-#else
-	free(data);
-#endif
-}
-
 class VulkanExample : public VulkanExampleBase
 {
 public:
@@ -57,35 +33,30 @@ public:
 	vks::Buffer indexBuffer;
 	uint32_t m_indexCount{ 0 };
 
-	struct {
-		vks::Buffer view;
-		vks::Buffer dynamic;
-	} uniformBuffers;
+	// All uniform data of a frame is allocated from the ring
+	vks::UniformRing uniformRing;
 
-	struct {
+	struct UboVS {
 		glm::mat4 projection;
 		glm::mat4 view;
 	} uboVS;
 
-	// Store random per-object rotations
-	glm::vec3 rotations[OBJECT_INSTANCES];
-	glm::vec3 rotationSpeeds[OBJECT_INSTANCES];
+	// Dynamic offsets of the current frame's allocations
+	uint32_t viewOffset{ 0 };
+	std::vector<uint32_t> modelOffsets;
+
+	// Objects are placed on a grid with this many objects along each axis
+	int32_t objectsPerAxis{ 5 };
 
-	// One big uniform buffer that contains all matrices
-	// Note that we need to manually allocate the data to cope for GPU-specific uniform buffer offset alignments
-	struct UboDataDynamic {
-		glm::mat4* model{ nullptr };
-	} uboDataDynamic;
+	// Store random per-object rotations
+	std::vector<glm::vec3> rotations;
+	std::vector<glm::vec3> rotationSpeeds;
 
 	VkPipeline m_vkPipeline{ VK_NULL_HANDLE };
 	VkPipelineLayout m_vkPipelineLayout{ VK_NULL_HANDLE };
 	VkDescriptorSet descriptorSet{ VK_NULL_HANDLE };
 	VkDescriptorSetLayout m_vkDescriptorSetLayout{ VK_NULL_HANDLE };
 
-	float animationTimer{ 0.0f };
-
-	size_t dynamicAlignment{ 0 };
-
 	VulkanExample() : VulkanExampleBase()
 	{
 		title = "Dynamic uniform buffers";
@@ -98,20 +69,17 @@ public:
 	~VulkanExample()
 	{
 		if (m_vkDevice) {
-			if (uboDataDynamic.model) {
-				alignedFree(uboDataDynamic.model);
-			}
 			vkDestroyPipeline(m_vkDevice, m_vkPipeline, nullptr);
 			vkDestroyPipelineLayout(m_vkDevice, m_vkPipelineLayout, nullptr);
 			vkDestroyDescriptorSetLayout(m_vkDevice, m_vkDescriptorSetLayout, nullptr);
 			vertexBuffer.destroy();
 			indexBuffer.destroy();
-			uniformBuffers.view.destroy();
-			uniformBuffers.dynamic.destroy();
+			uniformRing.destroy();
 		}
 	}
 
-	void buildCommandBuffers()
+	// The dynamic offsets change every frame, so the command buffer is recorded every frame in draw
+	void recordCommandBuffer(uint32_t index)
 	{
 		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
 
@@ -127,44 +95,47 @@ public:
 		renderPassBeginInfo.renderArea.extent.height = m_drawAreaHeight;
 		renderPassBeginInfo.clearValueCount = 2;
 		renderPassBeginInfo.pClearValues = clearValues;
+		renderPassBeginInfo.framebuffer = m_vkFrameBuffers[index];
 
-		for (int32_t i = 0; i < drawCmdBuffers.size(); ++i)
-		{
-			renderPassBeginInfo.framebuffer = m_vkFrameBuffers[i];
+		VkCommandBuffer commandBuffer = drawCmdBuffers[index];
 
-			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
+		VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &cmdBufInfo));
 
-			vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-			VkViewport viewport = vks::initializers::viewport((float)m_drawAreaWidth, (float)m_drawAreaHeight, 0.0f, 1.0f);
-			vkCmdSetViewport(drawCmdBuffers[i], 0, 1, &viewport);
+		VkViewport viewport = vks::initializers::viewport((float)m_drawAreaWidth, (float)m_drawAreaHeight, 0.0f, 1.0f);
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
-			VkRect2D scissor = vks::initializers::rect2D(m_drawAreaWidth, m_drawAreaHeight, 0, 0);
-			vkCmdSetScissor(drawCmdBuffers[i], 0, 1, &scissor);
+		VkRect2D scissor = vks::initializers::rect2D(m_drawAreaWidth, m_drawAreaHeight, 0, 0);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipeline);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipeline);
 
-			VkDeviceSize offsets[1] = { 0 };
-			vkCmdBindVertexBuffers(drawCmdBuffers[i], 0, 1, &vertexBuffer.buffer, offsets);
-			vkCmdBindIndexBuffer(drawCmdBuffers[i], indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+		VkDeviceSize offsets[1] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer.buffer, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
 
-			// Render multiple objects using different model matrices by dynamically offsetting into one uniform buffer
-			for (uint32_t j = 0; j < OBJECT_INSTANCES; j++)
-			{
-				// One dynamic offset per dynamic descriptor to offset into the ubo containing all model matrices
-				uint32_t dynamicOffset = j * static_cast<uint32_t>(dynamicAlignment);
-				// Bind the descriptor set for rendering a mesh using the dynamic offset
-				vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, 1, &descriptorSet, 1, &dynamicOffset);
+		// Render multiple objects using different model matrices by dynamically offsetting into one uniform buffer
+		for (uint32_t modelOffset : modelOffsets)
+		{
+			// One dynamic offset per dynamic descriptor, in binding order: The view matrices and the object's model matrix
+			std::array<uint32_t, 2> dynamicOffsets = { viewOffset, modelOffset };
+			// Bind the descriptor set for rendering a mesh using the dynamic offsets
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, 1, &descriptorSet, static_cast<uint32_t>(dynamicOffsets.size()), dynamicOffsets.data());
 
-				vkCmdDrawIndexed(drawCmdBuffers[i], m_indexCount, 1, 0, 0, 0);
-			}
+			vkCmdDrawIndexed(commandBuffer, m_indexCount, 1, 0, 0, 0);
+		}
 
-			drawUI(drawCmdBuffers[i]);
+		drawUI(commandBuffer);
 
-			vkCmdEndRenderPass(drawCmdBuffers[i]);
+		vkCmdEndRenderPass(commandBuffer);
 
-			VK_CHECK_RESULT(vkEndCommandBuffer(drawCmdBuffers[i]));
-		}
+		VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
+	}
+
+	void buildCommandBuffers()
+	{
+		// Recorded every frame in draw, after the frame's uniform data has been allocated
 	}
 
 	void generateCube()
@@ -208,9 +179,8 @@ public:
 	{
 		// Pool
 		std::vector<VkDescriptorPoolSize> poolSizes = {
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1),
-			// Dynamic uniform buffer
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1)
+			// Dynamic uniform buffers
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 2)
 		};
 
 		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, 2);
@@ -218,8 +188,8 @@ public:
 
 		// Layout
 		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
-			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0),
-			// Dynamic uniform buffer
+			// Both bindings read from the uniform ring, so both are dynamic
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT, 0),
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT, 1)
 		};
 
@@ -230,11 +200,14 @@ public:
 		VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(m_vkDescriptorPool, &m_vkDescriptorSetLayout, 1);
 		VK_CHECK_RESULT(vkAllocateDescriptorSets(m_vkDevice, &allocInfo, &descriptorSet));
 
+		// The descriptors only cover one block, the dynamic offsets select the block
+		VkDescriptorBufferInfo viewDescriptor = uniformRing.getDescriptor(sizeof(UboVS));
+		VkDescriptorBufferInfo modelDescriptor = uniformRing.getDescriptor(sizeof(glm::mat4));
 		std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
-			// Binding 0 : Projection/View matrix as uniform buffer
-			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &uniformBuffers.view.descriptor),
+			// Binding 0 : Projection/View matrix as dynamic uniform buffer
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 0, &viewDescriptor),
 			// Binding 1 : Instance matrix as dynamic uniform buffer
-			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, &uniformBuffers.dynamic.descriptor),
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, &modelDescriptor),
 		};
 		vkUpdateDescriptorSets(m_vkDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 	}
@@ -288,60 +261,29 @@ public:
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCreateInfo, nullptr, &m_vkPipeline));
 	}
 
-	// Prepare and initialize uniform buffer containing shader uniforms
+	// Prepare the uniform ring all uniform data is allocated from
 	void prepareUniformBuffers()
 	{
-		// Allocate data for the dynamic uniform buffer object
-		// We allocate this manually as the alignment of the offset differs between GPUs
-
-		// Calculate required alignment based on minimum m_vkDevice offset alignment
-		size_t minUboAlignment = m_pVulkanDevice->m_vkPhysicalDeviceProperties.limits.minUniformBufferOffsetAlignment;
-		dynamicAlignment = sizeof(glm::mat4);
-		if (minUboAlignment > 0) {
-			dynamicAlignment = (dynamicAlignment + minUboAlignment - 1) & ~(minUboAlignment - 1);
-		}
-
-		size_t bufferSize = OBJECT_INSTANCES * dynamicAlignment;
+		// One region per command buffer, a region is only reused once the command buffer that read from it has been executed
+		uniformRing.create(m_pVulkanDevice, static_cast<uint32_t>(drawCmdBuffers.size()));
 
-		uboDataDynamic.model = (glm::mat4*)alignedAlloc(bufferSize, dynamicAlignment);
-		assert(uboDataDynamic.model);
+		std::cout << "minUniformBufferOffsetAlignment = " << m_pVulkanDevice->m_vkPhysicalDeviceProperties.limits.minUniformBufferOffsetAlignment << std::endl;
 
-		std::cout << "minUniformBufferOffsetAlignment = " << minUboAlignment << std::endl;
-		std::cout << "dynamicAlignment = " << dynamicAlignment << std::endl;
-
-		// Vertex shader uniform buffer block
-
-		// Static shared uniform buffer object with projection and m_vkImageView matrix
-		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&uniformBuffers.view,
-			sizeof(uboVS)));
-
-		// Uniform buffer object with per-object matrices
-		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-			&uniformBuffers.dynamic,
-			bufferSize));
-
-		// Override descriptor range to [base, base + dynamicAlignment]
-		uniformBuffers.dynamic.descriptor.range = dynamicAlignment;
-
-		// Map persistent
-		VK_CHECK_RESULT(uniformBuffers.view.map());
-		VK_CHECK_RESULT(uniformBuffers.dynamic.map());
+		prepareObjects();
+	}
 
-		// Prepare per-object matrices with offsets and random rotations
+	// Random rotations for all objects of the grid
+	void prepareObjects()
+	{
+		const uint32_t objectCount = static_cast<uint32_t>(objectsPerAxis * objectsPerAxis * objectsPerAxis);
 		std::default_random_engine rndEngine(m_benchmark.active ? 0 : (unsigned)time(nullptr));
 		std::normal_distribution<float> rndDist(-1.0f, 1.0f);
-		for (uint32_t i = 0; i < OBJECT_INSTANCES; i++) {
+		rotations.resize(objectCount);
+		rotationSpeeds.resize(objectCount);
+		for (uint32_t i = 0; i < objectCount; i++) {
 			rotations[i] = glm::vec3(rndDist(rndEngine), rndDist(rndEngine), rndDist(rndEngine)) * 2.0f * (float)M_PI;
 			rotationSpeeds[i] = glm::vec3(rndDist(rndEngine), rndDist(rndEngine), rndDist(rndEngine));
 		}
-
-		updateUniformBuffers();
-		updateDynamicUniformBuffer();
 	}
 
 	void updateUniformBuffers()
@@ -350,21 +292,17 @@ public:
 		uboVS.projection = camera.matrices.perspective;
 		uboVS.view = camera.matrices.view;
 
-		memcpy(uniformBuffers.view.mapped, &uboVS, sizeof(uboVS));
+		viewOffset = uniformRing.push(uboVS);
 	}
 
 	void updateDynamicUniformBuffer()
 	{
-		// Update at max. 60 fps
-		animationTimer += m_frameTimer;	
-		if (animationTimer <= 1.0f / 60.0f) {
-			return;
-		}
-
 		// Dynamic ubo with per-object model matrices indexed by offsets in the command buffer
-		uint32_t dim = static_cast<uint32_t>(pow(OBJECT_INSTANCES, (1.0f / 3.0f)));
+		// Every matrix is a bump allocation from the current frame's region, which is written directly into mapped memory
+		const uint32_t dim = static_cast<uint32_t>(objectsPerAxis);
 		glm::vec3 offset(5.0f);
 
+		modelOffsets.resize(rotations.size());
 		for (uint32_t x = 0; x < dim; x++)
 		{
 			for (uint32_t y = 0; y < dim; y++)
@@ -373,30 +311,24 @@ public:
 				{
 					uint32_t index = x * dim * dim + y * dim + z;
 
-					// Aligned offset
-					glm::mat4* modelMat = (glm::mat4*)(((uint64_t)uboDataDynamic.model + (index * dynamicAlignment)));
+					vks::UniformRing::TypedAllocation<glm::mat4> modelMat = uniformRing.allocate<glm::mat4>();
+					modelOffsets[index] = modelMat.offset;
 
 					// Update rotations
-					rotations[index] += animationTimer * rotationSpeeds[index];
+					if (!paused) {
+						rotations[index] += m_frameTimer * rotationSpeeds[index];
+					}
 
 					// Update matrices
 					glm::vec3 pos = glm::vec3(-((dim * offset.x) / 2.0f) + offset.x / 2.0f + x * offset.x, -((dim * offset.y) / 2.0f) + offset.y / 2.0f + y * offset.y, -((dim * offset.z) / 2.0f) + offset.z / 2.0f + z * offset.z);
-					*modelMat = glm::translate(glm::mat4(1.0f), pos);
-					*modelMat = glm::rotate(*modelMat, rotations[index].x, glm::vec3(1.0f, 1.0f, 0.0f));
-					*modelMat = glm::rotate(*modelMat, rotations[index].y, glm::vec3(0.0f, 1.0f, 0.0f));
-					*modelMat = glm::rotate(*modelMat, rotations[index].z, glm::vec3(0.0f, 0.0f, 1.0f));
+					glm::mat4 model = glm::translate(glm::mat4(1.0f), pos);
+					model = glm::rotate(model, rotations[index].x, glm::vec3(1.0f, 1.0f, 0.0f));
+					model = glm::rotate(model, rotations[index].y, glm::vec3(0.0f, 1.0f, 0.0f));
+					model = glm::rotate(model, rotations[index].z, glm::vec3(0.0f, 0.0f, 1.0f));
+					*modelMat.data = model;
 				}
 			}
 		}
-
-		animationTimer = 0.0f;
-
-		memcpy(uniformBuffers.dynamic.mapped, uboDataDynamic.model, uniformBuffers.dynamic.size);
-		// Flush to make changes visible to the host
-		VkMappedMemoryRange memoryRange = vks::initializers::mappedMemoryRange();
-		memoryRange.memory = uniformBuffers.dynamic.memory;
-		memoryRange.size = uniformBuffers.dynamic.size;
-		vkFlushMappedMemoryRanges(m_vkDevice, 1, &memoryRange);
 	}
 
 	void prepare()
@@ -413,6 +345,11 @@ public:
 	void draw()
 	{
 		VulkanExampleBase::prepareFrame();
+		// The ring memory is host coherent, so the writes are visible to the GPU without flushing
+		uniformRing.beginFrame(m_currentBufferIndex);
+		updateUniformBuffers();
+		updateDynamicUniformBuffer();
+		recordCommandBuffer(m_currentBufferIndex);
 		m_vkSubmitInfo.commandBufferCount = 1;
 		m_vkSubmitInfo.pCommandBuffers = &drawCmdBuffers[m_currentBufferIndex];
 		VK_CHECK_RESULT(vkQueueSubmit(m_vkQueue, 1, &m_vkSubmitInfo, VK_NULL_HANDLE));
@@ -423,10 +360,21 @@ public:
 	{
 		if (!m_prepared)
 			return;
-		updateUniformBuffers();
-		updateDynamicUniformBuffer();
 		draw();
 	}
+
+	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay)
+	{
+		if (overlay->header("Settings")) {
+			if (overlay->sliderInt("Objects per axis", &objectsPerAxis, 1, 20)) {
+				prepareObjects();
+			}
+		}
+		if (overlay->header("Statistics")) {
+			overlay->text("Objects: %u", static_cast<uint32_t>(rotations.size()));
+			overlay->text("Uniform data: %.1f KB per frame", static_cast<float>(uniformRing.getFrameUsage()) / 1024.0f);
+		}
+	}
 };
 
 VULKAN_EXAMPLE_MAIN()
@@ -0,0 +1,294 @@
+/*
+* Vulkan Example - GPU driven rendering of a glTF scene with indirect draws
+*
+* Uses the indirect draw path of the glTF model class: All primitives of the scene are stored as draws with their transforms and material indices in storage buffers,
+* all textures are bound as a single array. A compute shader culls the draws against the view frustum and compacts the visible ones,
+* which are then drawn with a single vkCmdDrawIndexedIndirectCount per alpha mode, independent of the number of primitives
+*
+* Copyright (C) 2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include "vulkanexamplebase.h"
+#include "VulkanglTFModel.h"
+#include "frustum.hpp"
+
+class VulkanExample : public VulkanExampleBase
+{
+public:
+	vkglTF::Model scene;
+
+	bool frustumCulling = true;
+	bool fixedFrustum = false;
+
+	struct UniformData {
+		glm::mat4 projection;
+		glm::mat4 view;
+		glm::vec4 lightPos = glm::vec4(0.0f, -5.0f, 0.0f, 1.0f);
+		glm::vec4 viewPos;
+	} uniformData;
+	vks::Buffer uniformBuffer;
+
+	vks::Frustum frustum;
+
+	struct Pipelines {
+		VkPipeline opaque{ VK_NULL_HANDLE };
+		VkPipeline blend{ VK_NULL_HANDLE };
+	} pipelines;
+	VkPipelineLayout m_vkPipelineLayout{ VK_NULL_HANDLE };
+	VkDescriptorSet descriptorSet{ VK_NULL_HANDLE };
+	VkDescriptorSetLayout m_vkDescriptorSetLayout{ VK_NULL_HANDLE };
+
+	// Indirect draw counts and the texture array need features introduced with Vulkan 1.2
+	VkPhysicalDeviceVulkan12Features enabledFeatures12{};
+	bool drawIndirectCount{ false };
+
+	VulkanExample() : VulkanExampleBase()
+	{
+		title = "glTF indirect draw";
+		camera.type = Camera::CameraType::firstperson;
+#ifndef __ANDROID__
+		camera.rotationSpeed = 0.25f;
+#endif
+		camera.position = { 1.0f, 0.75f, 0.0f };
+		camera.setRotation(glm::vec3(0.0f, 90.0f, 0.0f));
+		camera.setPerspective(60.0f, (float)m_drawAreaWidth / (float)m_drawAreaHeight, 0.1f, 64.0f);
+
+		m_requestedApiVersion = VK_API_VERSION_1_2;
+	}
+
+	~VulkanExample()
+	{
+		if (m_vkDevice) {
+			vkDestroyPipeline(m_vkDevice, pipelines.opaque, nullptr);
+			vkDestroyPipeline(m_vkDevice, pipelines.blend, nullptr);
+			vkDestroyPipelineLayout(m_vkDevice, m_vkPipelineLayout, nullptr);
+			vkDestroyDescriptorSetLayout(m_vkDevice, m_vkDescriptorSetLayout, nullptr);
+			uniformBuffer.destroy();
+		}
+	}
+
+	virtual void getEnabledFeatures()
+	{
+		// Enable multi draw indirect if supported
+		if (m_vkPhysicalDeviceFeatures.multiDrawIndirect) {
+			m_vkPhysicalDeviceFeatures10.multiDrawIndirect = VK_TRUE;
+		}
+		// Draws fetch their data with gl_InstanceIndex, which is set through firstInstance
+		m_vkPhysicalDeviceFeatures10.drawIndirectFirstInstance = VK_TRUE;
+		m_vkPhysicalDeviceFeatures10.samplerAnisotropy = m_vkPhysicalDeviceFeatures.samplerAnisotropy;
+
+		VkPhysicalDeviceVulkan12Features supportedFeatures12{};
+		supportedFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		VkPhysicalDeviceFeatures2 physicalDeviceFeatures2{};
+		physicalDeviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		physicalDeviceFeatures2.pNext = &supportedFeatures12;
+		vkGetPhysicalDeviceFeatures2(m_vkPhysicalDevice, &physicalDeviceFeatures2);
+
+		enabledFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		// Required for the texture array indexed with the material's texture indices
+		enabledFeatures12.runtimeDescriptorArray = VK_TRUE;
+		enabledFeatures12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+		// Without draw counts, culled draws are kept with an instance count of zero
+		drawIndirectCount = supportedFeatures12.drawIndirectCount;
+		enabledFeatures12.drawIndirectCount = supportedFeatures12.drawIndirectCount;
+		m_deviceCreatepNextChain = &enabledFeatures12;
+	}
+
+	void buildCommandBuffers()
+	{
+		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
+
+		VkClearValue clearValues[2];
+		clearValues[0].color = m_vkClearColorValueDefault;
+		clearValues[1].depthStencil = { 1.0f, 0 };
+
+		VkRenderPassBeginInfo renderPassBeginInfo = vks::initializers::renderPassBeginInfo();
+		renderPassBeginInfo.renderPass = m_vkRenderPass;
+		renderPassBeginInfo.renderArea.offset.x = 0;
+		renderPassBeginInfo.renderArea.offset.y = 0;
+		renderPassBeginInfo.renderArea.extent.width = m_drawAreaWidth;
+		renderPassBeginInfo.renderArea.extent.height = m_drawAreaHeight;
+		renderPassBeginInfo.clearValueCount = 2;
+		renderPassBeginInfo.pClearValues = clearValues;
+
+		for (int32_t i = 0; i < drawCmdBuffers.size(); ++i)
+		{
+			renderPassBeginInfo.framebuffer = m_vkFrameBuffers[i];
+
+			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
+
+			// Cull the draws and write the commands for the visible ones
+			scene.cullIndirect(drawCmdBuffers[i]);
+
+			vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+			VkViewport viewport = vks::initializers::viewport((float)m_drawAreaWidth, (float)m_drawAreaHeight, 0.0f, 1.0f);
+			vkCmdSetViewport(drawCmdBuffers[i], 0, 1, &viewport);
+
+			VkRect2D scissor = vks::initializers::rect2D(m_drawAreaWidth, m_drawAreaHeight, 0, 0);
+			vkCmdSetScissor(drawCmdBuffers[i], 0, 1, &scissor);
+
+			// Set 0 contains the scene matrices, set 1 the draw data, materials and textures, which is bound by the model
+			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+
+			// Opaque and alpha masked draws share a pipeline, the fragment shader discards masked fragments based on the material
+			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.opaque);
+			scene.drawIndirect(drawCmdBuffers[i], vkglTF::RenderFlags::RenderOpaqueNodes | vkglTF::RenderFlags::RenderAlphaMaskedNodes, m_vkPipelineLayout, 1);
+			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.blend);
+			scene.drawIndirect(drawCmdBuffers[i], vkglTF::RenderFlags::RenderAlphaBlendedNodes, m_vkPipelineLayout, 1);
+
+			drawUI(drawCmdBuffers[i]);
+
+			vkCmdEndRenderPass(drawCmdBuffers[i]);
+
+			VK_CHECK_RESULT(vkEndCommandBuffer(drawCmdBuffers[i]));
+		}
+	}
+
+	void loadAssets()
+	{
+		const uint32_t glTFLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::FlipY;
+		scene.loadFromFile(getAssetPath() + "models/sponza/sponza.gltf", m_pVulkanDevice, m_vkQueue, glTFLoadingFlags);
+		scene.prepareIndirectDraw(loadShader(getShadersPath() + "base/indirectcull.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT), drawIndirectCount, m_vkPipelineCache);
+	}
+
+	void setupDescriptors()
+	{
+		// Pool
+		std::vector<VkDescriptorPoolSize> poolSizes = {
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1),
+		};
+		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, 1);
+		VK_CHECK_RESULT(vkCreateDescriptorPool(m_vkDevice, &descriptorPoolInfo, nullptr, &m_vkDescriptorPool));
+
+		// Layout
+		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+			// Binding 0 : Vertex and fragment shader uniform buffer
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0),
+		};
+		VkDescriptorSetLayoutCreateInfo descriptorLayout = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(m_vkDevice, &descriptorLayout, nullptr, &m_vkDescriptorSetLayout));
+
+		// Set
+		VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(m_vkDescriptorPool, &m_vkDescriptorSetLayout, 1);
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(m_vkDevice, &allocInfo, &descriptorSet));
+		VkWriteDescriptorSet writeDescriptorSet = vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &uniformBuffer.descriptor);
+		vkUpdateDescriptorSets(m_vkDevice, 1, &writeDescriptorSet, 0, nullptr);
+	}
+
+	void preparePipelines()
+	{
+		// Layout
+		const std::vector<VkDescriptorSetLayout> setLayouts = { m_vkDescriptorSetLayout, scene.indirect.descriptorSetLayout };
+		VkPipelineLayoutCreateInfo pipelineLayoutCI = vks::initializers::pipelineLayoutCreateInfo(setLayouts.data(), static_cast<uint32_t>(setLayouts.size()));
+		VK_CHECK_RESULT(vkCreatePipelineLayout(m_vkDevice, &pipelineLayoutCI, nullptr, &m_vkPipelineLayout));
+
+		// Pipelines
+		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = vks::initializers::pipelineInputAssemblyStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 0, VK_FALSE);
+		VkPipelineRasterizationStateCreateInfo rasterizationState = vks::initializers::pipelineRasterizationStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE, 0);
+		VkPipelineColorBlendAttachmentState blendAttachmentState = vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE);
+		VkPipelineColorBlendStateCreateInfo colorBlendState = vks::initializers::pipelineColorBlendStateCreateInfo(1, &blendAttachmentState);
+		VkPipelineDepthStencilStateCreateInfo depthStencilState = vks::initializers::pipelineDepthStencilStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
+		VkPipelineViewportStateCreateInfo viewportState = vks::initializers::pipelineViewportStateCreateInfo(1, 1, 0);
+		VkPipelineMultisampleStateCreateInfo multisampleState = vks::initializers::pipelineMultisampleStateCreateInfo(VK_SAMPLE_COUNT_1_BIT, 0);
+		std::vector<VkDynamicState> dynamicStateEnables = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+		VkPipelineDynamicStateCreateInfo dynamicState = vks::initializers::pipelineDynamicStateCreateInfo(dynamicStateEnables);
+		std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages;
+
+		VkGraphicsPipelineCreateInfo pipelineCI = vks::initializers::pipelineCreateInfo(m_vkPipelineLayout, m_vkRenderPass, 0);
+		pipelineCI.pInputAssemblyState = &inputAssemblyState;
+		pipelineCI.pRasterizationState = &rasterizationState;
+		pipelineCI.pColorBlendState = &colorBlendState;
+		pipelineCI.pMultisampleState = &multisampleState;
+		pipelineCI.pViewportState = &viewportState;
+		pipelineCI.pDepthStencilState = &depthStencilState;
+		pipelineCI.pDynamicState = &dynamicState;
+		pipelineCI.stageCount = static_cast<uint32_t>(shaderStages.size());
+		pipelineCI.pStages = shaderStages.data();
+		pipelineCI.pVertexInputState = vkglTF::Vertex::getPipelineVertexInputState({ vkglTF::VertexComponent::Position, vkglTF::VertexComponent::Normal, vkglTF::VertexComponent::UV, vkglTF::VertexComponent::Color });
+
+		shaderStages[0] = loadShader(getShadersPath() + "gltfindirectdraw/scene.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+		shaderStages[1] = loadShader(getShadersPath() + "gltfindirectdraw/scene.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCI, nullptr, &pipelines.opaque));
+
+		// Alpha blended draws are drawn after all opaque ones without writing depth
+		blendAttachmentState.blendEnable = VK_TRUE;
+		blendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+		blendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		blendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
+		blendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		blendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+		blendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
+		depthStencilState.depthWriteEnable = VK_FALSE;
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCI, nullptr, &pipelines.blend));
+	}
+
+	// Prepare and initialize uniform buffer containing shader uniforms
+	void prepareUniformBuffers()
+	{
+		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &uniformBuffer, sizeof(UniformData)));
+		VK_CHECK_RESULT(uniformBuffer.map());
+		updateUniformBuffers();
+	}
+
+	void updateUniformBuffers()
+	{
+		uniformData.projection = camera.matrices.perspective;
+		uniformData.view = camera.matrices.view;
+		uniformData.viewPos = camera.viewPos;
+		memcpy(uniformBuffer.mapped, &uniformData, sizeof(UniformData));
+
+		// The culling shader reads the frustum when the command buffer is executed
+		if (!fixedFrustum) {
+			frustum.update(uniformData.projection * uniformData.view);
+		}
+		scene.updateIndirectCulling(frustumCulling ? frustum.planes.data() : nullptr);
+	}
+
+	void draw()
+	{
+		VulkanExampleBase::prepareFrame();
+		m_vkSubmitInfo.commandBufferCount = 1;
+		m_vkSubmitInfo.pCommandBuffers = &drawCmdBuffers[m_currentBufferIndex];
+		VK_CHECK_RESULT(vkQueueSubmit(m_vkQueue, 1, &m_vkSubmitInfo, VK_NULL_HANDLE));
+		VulkanExampleBase::submitFrame();
+	}
+
+	void prepare()
+	{
+		VulkanExampleBase::prepare();
+		loadAssets();
+		prepareUniformBuffers();
+		setupDescriptors();
+		preparePipelines();
+		buildCommandBuffers();
+		m_prepared = true;
+	}
+
+	virtual void render()
+	{
+		if (!m_prepared)
+			return;
+		updateUniformBuffers();
+		draw();
+	}
+
+	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay)
+	{
+		if (overlay->header("Settings")) {
+			overlay->checkBox("Frustum culling", &frustumCulling);
+			overlay->checkBox("Freeze frustum", &fixedFrustum);
+		}
+		if (overlay->header("Statistics")) {
+			// The counts are read after the queue has become idle at the end of the previous frame
+			const uint32_t* visibleCounts = scene.indirect.visibleCounts;
+			overlay->text("Draws: %d / %d", visibleCounts[0] + visibleCounts[1] + visibleCounts[2], static_cast<uint32_t>(scene.indirect.draws.size()));
+			overlay->text("Opaque: %d, masked: %d, blended: %d", visibleCounts[0], visibleCounts[1], visibleCounts[2]);
+			overlay->text("Draw count buffer: %s", drawIndirectCount ? "yes" : "no");
+		}
+	}
+};
+
+VULKAN_EXAMPLE_MAIN()
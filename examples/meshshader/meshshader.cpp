@@ -1,24 +1,63 @@
 /*
- * Vulkan Example - Basic sample for using mesh and task shader to replace the traditional vertex m_vkPipeline
+ * Vulkan Example - Mesh shading of a glTF scene split into meshlets
  *
- * Copyright (C) 2022-2023 by Sascha Willems - www.saschawillems.de
+ * The glTF loader splits all primitives into meshlets of up to 64 vertices and 124 triangles (vkglTF::FileLoadingFlags::BuildMeshlets)
+ * The task shader culls groups of 32 meshlets against the view frustum, their normal cone (backfacing meshlets) and a hierarchical depth pyramid
+ * of the previous frame (occluded meshlets), and only emits mesh shader workgroups for the visible ones
+ *
+ * Copyright (C) 2022-2025 by Sascha Willems - www.saschawillems.de
  *
  * This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
  */
 
 #include "vulkanexamplebase.h"
+#include "VulkanglTFModel.h"
+#include "VulkanDepthPyramid.h"
+#include "frustum.hpp"
+
+// Has to match the workgroup size of the task shader
+#define MESHLETS_PER_TASK 32
 
 class VulkanExample : public VulkanExampleBase
 {
 public:
+	vkglTF::Model model;
+
+	// Culling tests enabled in the task shader and shading options of the mesh shader
+	enum ShaderFlags : uint32_t {
+		CullFrustum = 0x1,
+		CullCone = 0x2,
+		CullOcclusion = 0x4,
+		ColorMeshlets = 0x8,
+	};
+	bool frustumCulling = true;
+	bool coneCulling = true;
+	bool occlusionCulling = true;
+	bool colorMeshlets = false;
+
 	struct UniformData {
 		glm::mat4 projection;
-		glm::mat4 model;
 		glm::mat4 view;
+		glm::vec4 frustumPlanes[6];
+		glm::vec4 cameraPos;
+		uint32_t meshletCount;
+		uint32_t flags;
+		float pyramidWidth;
+		float pyramidHeight;
 	} uniformData;
 	vks::Buffer uniformBuffer;
 
-	uint32_t m_indexCount{ 0 };
+	// Written by the task shader with atomics, read back on the host
+	struct Statistics {
+		uint32_t visibleMeshlets;
+		uint32_t visibleTriangles;
+	} statistics{};
+	vks::Buffer statisticsBuffer;
+	// Triangles the same scene submits with the classic vertex pipeline (vkglTF::Model::draw)
+	uint64_t classicTriangleCount{ 0 };
+
+	vks::Frustum frustum;
+	vks::DepthPyramid depthPyramid;
 
 	VkPipeline m_vkPipeline{ VK_NULL_HANDLE };
 	VkPipelineLayout m_vkPipelineLayout{ VK_NULL_HANDLE };
@@ -32,11 +71,13 @@ public:
 	VulkanExample() : VulkanExampleBase()
 	{
 		title = "Mesh shaders";
-		timerSpeed *= 0.25f;
-		camera.type = Camera::CameraType::lookat;
-		camera.setPerspective(60.0f, (float)m_drawAreaWidth / (float)m_drawAreaHeight, 0.1f, 512.0f);
-		camera.setRotation(glm::vec3(0.0f, 15.0f, 0.0f));
-		camera.setTranslation(glm::vec3(0.0f, 0.0f, -5.0f));
+		camera.type = Camera::CameraType::firstperson;
+#ifndef __ANDROID__
+		camera.rotationSpeed = 0.25f;
+#endif
+		camera.position = { 1.0f, 0.75f, 0.0f };
+		camera.setRotation(glm::vec3(0.0f, 90.0f, 0.0f));
+		camera.setPerspective(60.0f, (float)m_drawAreaWidth / (float)m_drawAreaHeight, 0.1f, 64.0f);
 
 		// The mesh shader extension requires at least Vulkan Core 1.1
 		m_requestedApiVersion = VK_API_VERSION_1_1;
@@ -55,6 +96,9 @@ public:
 		enabledMeshShaderFeatures.taskShader = VK_TRUE;
 
 		m_deviceCreatepNextChain = &enabledMeshShaderFeatures;
+
+		// The depth pyramid is built from the depth buffer of the previous frame
+		m_depthStencilUsage |= VK_IMAGE_USAGE_SAMPLED_BIT;
 	}
 
 	~VulkanExample()
@@ -64,6 +108,8 @@ public:
 			vkDestroyPipelineLayout(m_vkDevice, m_vkPipelineLayout, nullptr);
 			vkDestroyDescriptorSetLayout(m_vkDevice, m_vkDescriptorSetLayout, nullptr);
 			uniformBuffer.destroy();
+			statisticsBuffer.destroy();
+			depthPyramid.destroy();
 		}
 	}
 
@@ -72,7 +118,7 @@ public:
 		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
 
 		VkClearValue clearValues[2];
-		clearValues[0].color = { { 0.0f, 0.0f, 0.2f, 1.0f } };;
+		clearValues[0].color = m_vkClearColorValueDefault;
 		clearValues[1].depthStencil = { 1.0f, 0 };
 
 		VkRenderPassBeginInfo renderPassBeginInfo = vks::initializers::renderPassBeginInfo();
@@ -84,12 +130,28 @@ public:
 		renderPassBeginInfo.clearValueCount = 2;
 		renderPassBeginInfo.pClearValues = clearValues;
 
+		const uint32_t meshletCount = static_cast<uint32_t>(model.meshlets.meshlets.size());
+
 		for (int32_t i = 0; i < drawCmdBuffers.size(); ++i)
 		{
 			renderPassBeginInfo.framebuffer = m_vkFrameBuffers[i];
 
 			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
 
+			// Reset the statistics after the task shaders of the previous frame are done with them
+			VkBufferMemoryBarrier bufferBarrier = vks::initializers::bufferMemoryBarrier();
+			bufferBarrier.buffer = statisticsBuffer.buffer;
+			bufferBarrier.size = VK_WHOLE_SIZE;
+			bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			bufferBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			vkCmdPipelineBarrier(drawCmdBuffers[i], VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+			vkCmdFillBuffer(drawCmdBuffers[i], statisticsBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+			bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			vkCmdPipelineBarrier(drawCmdBuffers[i], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
 			vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 			VkViewport viewport = vks::initializers::viewport((float)m_drawAreaWidth, (float)m_drawAreaHeight, 0.0f, 1.0f);
@@ -102,29 +164,79 @@ public:
 
 			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipeline);
 
-			// Use mesh and task shader to draw the scene
-			vkCmdDrawMeshTasksEXT(drawCmdBuffers[i], 1, 1, 1);
+			// Every task shader workgroup culls MESHLETS_PER_TASK meshlets and launches one mesh shader workgroup per visible meshlet
+			vkCmdDrawMeshTasksEXT(drawCmdBuffers[i], (meshletCount + MESHLETS_PER_TASK - 1) / MESHLETS_PER_TASK, 1, 1);
 
 			drawUI(drawCmdBuffers[i]);
 
 			vkCmdEndRenderPass(drawCmdBuffers[i]);
 
+			// Build the depth pyramid the next frame's occlusion culling tests against
+			depthPyramid.build(drawCmdBuffers[i]);
+
 			VK_CHECK_RESULT(vkEndCommandBuffer(drawCmdBuffers[i]));
 		}
 	}
 
+	void loadAssets()
+	{
+		// The meshlet and vertex data is read by the task and mesh shaders as storage buffers
+		vkglTF::memoryPropertyFlags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		const uint32_t glTFLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::PreMultiplyVertexColors | vkglTF::FileLoadingFlags::FlipY | vkglTF::FileLoadingFlags::BuildMeshlets;
+		model.loadFromFile(getAssetPath() + "models/sponza/sponza.gltf", m_pVulkanDevice, m_vkQueue, glTFLoadingFlags);
+		for (auto node : model.linearNodes) {
+			if (node->mesh) {
+				for (auto primitive : node->mesh->primitives) {
+					classicTriangleCount += primitive->indexCount / 3;
+				}
+			}
+		}
+	}
+
+	void prepareDepthPyramid()
+	{
+		// Without the pyramid shader the pyramid stays at the far plane and occlusion culling keeps all meshlets
+		VkPipelineShaderStageCreateInfo shaderStage{};
+		const std::string shaderFile = getShadersPath() + "base/depthpyramid.comp.spv";
+		if (shaderExists(shaderFile)) {
+			shaderStage = loadShader(shaderFile, VK_SHADER_STAGE_COMPUTE_BIT);
+		} else {
+			std::cerr << "Shader \"" << shaderFile << "\" not found, occlusion culling is disabled\n";
+			occlusionCulling = false;
+		}
+		depthPyramid.create(m_pVulkanDevice, m_vkQueue, m_defaultDepthStencil.m_vkImage, m_vkFormatDepth, m_drawAreaWidth, m_drawAreaHeight, shaderStage, m_vkPipelineCache);
+	}
+
 	void setupDescriptors()
 	{
 		// Pool
 		std::vector<VkDescriptorPoolSize> poolSizes = {
 			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1),
 		};
 		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(static_cast<uint32_t>(poolSizes.size()), poolSizes.data(), 1);
 		VK_CHECK_RESULT(vkCreateDescriptorPool(m_vkDevice, &descriptorPoolInfo, nullptr, &m_vkDescriptorPool));
 
 		// Layout
+		const VkShaderStageFlags taskMeshStages = VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
 		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
-			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_MESH_BIT_EXT, 0),
+			// Binding 0: Uniform buffer
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, taskMeshStages, 0),
+			// Binding 1: Meshlets
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, taskMeshStages, 1),
+			// Binding 2: Meshlet bounds
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_TASK_BIT_EXT, 2),
+			// Binding 3: Meshlet vertex indices
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_MESH_BIT_EXT, 3),
+			// Binding 4: Meshlet triangles
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_MESH_BIT_EXT, 4),
+			// Binding 5: Vertices of the model
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_MESH_BIT_EXT, 5),
+			// Binding 6: Depth pyramid
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_TASK_BIT_EXT, 6),
+			// Binding 7: Culling statistics
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_TASK_BIT_EXT, 7),
 		};
 		VkDescriptorSetLayoutCreateInfo descriptorLayoutInfo = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
 		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(m_vkDevice, &descriptorLayoutInfo, nullptr, &m_vkDescriptorSetLayout));
@@ -132,8 +244,16 @@ public:
 		// Set
 		VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(m_vkDescriptorPool, &m_vkDescriptorSetLayout, 1);
 		VK_CHECK_RESULT(vkAllocateDescriptorSets(m_vkDevice, &allocInfo, &descriptorSet));
+		VkDescriptorBufferInfo vertexBufferDescriptor{ model.vertices.buffer, 0, VK_WHOLE_SIZE };
 		std::vector<VkWriteDescriptorSet> modelWriteDescriptorSets = {
 			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &uniformBuffer.descriptor),
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &model.meshlets.meshletBuffer.descriptor),
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &model.meshlets.boundsBuffer.descriptor),
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, &model.meshlets.vertexBuffer.descriptor),
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, &model.meshlets.triangleBuffer.descriptor),
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5, &vertexBufferDescriptor),
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 6, &depthPyramid.descriptor),
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 7, &statisticsBuffer.descriptor),
 		};
 		vkUpdateDescriptorSets(m_vkDevice, static_cast<uint32_t>(modelWriteDescriptorSets.size()), modelWriteDescriptorSets.data(), 0, nullptr);
 	}
@@ -145,8 +265,8 @@ public:
 		VK_CHECK_RESULT(vkCreatePipelineLayout(m_vkDevice, &pipelineLayoutInfo, nullptr, &m_vkPipelineLayout));
 
 		// Pipeline
-		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = vks::initializers::pipelineInputAssemblyStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 0, VK_FALSE);
-		VkPipelineRasterizationStateCreateInfo rasterizationState = vks::initializers::pipelineRasterizationStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE, 0);
+		// Backfacing triangles of meshlets that pass the cone test are still culled by the rasterizer
+		VkPipelineRasterizationStateCreateInfo rasterizationState = vks::initializers::pipelineRasterizationStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE, 0);
 		VkPipelineColorBlendAttachmentState blendAttachmentState = vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE);
 		VkPipelineColorBlendStateCreateInfo colorBlendState = vks::initializers::pipelineColorBlendStateCreateInfo(1, &blendAttachmentState);
 		VkPipelineDepthStencilStateCreateInfo depthStencilState = vks::initializers::pipelineDepthStencilStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
@@ -184,6 +304,9 @@ public:
 	{
 		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &uniformBuffer, sizeof(UniformData)));
 		VK_CHECK_RESULT(uniformBuffer.map());
+		// Host visible, so the statistics can be read back without a copy
+		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &statisticsBuffer, sizeof(Statistics)));
+		VK_CHECK_RESULT(statisticsBuffer.map());
 		updateUniformBuffers();
 	}
 
@@ -191,7 +314,13 @@ public:
 	{
 		uniformData.projection = camera.matrices.perspective;
 		uniformData.view = camera.matrices.view;
-		uniformData.model = glm::mat4(1.0f);
+		frustum.update(uniformData.projection * uniformData.view);
+		memcpy(uniformData.frustumPlanes, frustum.planes.data(), sizeof(glm::vec4) * 6);
+		uniformData.cameraPos = glm::vec4(camera.position * -1.0f, 1.0f);
+		uniformData.meshletCount = static_cast<uint32_t>(model.meshlets.meshlets.size());
+		uniformData.flags = (frustumCulling ? CullFrustum : 0) | (coneCulling ? CullCone : 0) | (occlusionCulling ? CullOcclusion : 0) | (colorMeshlets ? ColorMeshlets : 0);
+		uniformData.pyramidWidth = static_cast<float>(depthPyramid.width);
+		uniformData.pyramidHeight = static_cast<float>(depthPyramid.height);
 		memcpy(uniformBuffer.mapped, &uniformData, sizeof(UniformData));
 	}
 
@@ -202,6 +331,9 @@ public:
 		m_vkSubmitInfo.pCommandBuffers = &drawCmdBuffers[m_currentBufferIndex];
 		VK_CHECK_RESULT(vkQueueSubmit(m_vkQueue, 1, &m_vkSubmitInfo, VK_NULL_HANDLE));
 		VulkanExampleBase::submitFrame();
+
+		// The queue is idle after submitting the frame, so the statistics are complete
+		memcpy(&statistics, statisticsBuffer.mapped, sizeof(Statistics));
 	}
 
 	void prepare()
@@ -211,6 +343,8 @@ public:
 		// Get the function pointer of the mesh shader drawing funtion
 		vkCmdDrawMeshTasksEXT = reinterpret_cast<PFN_vkCmdDrawMeshTasksEXT>(vkGetDeviceProcAddr(m_vkDevice, "vkCmdDrawMeshTasksEXT"));
 
+		loadAssets();
+		prepareDepthPyramid();
 		prepareUniformBuffers();
 		setupDescriptors();
 		preparePipelines();
@@ -218,6 +352,16 @@ public:
 		m_prepared = true;
 	}
 
+	virtual void windowResized()
+	{
+		// The depth pyramid depends on the size of the recreated depth buffer
+		depthPyramid.destroy();
+		prepareDepthPyramid();
+		VkWriteDescriptorSet writeDescriptorSet = vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 6, &depthPyramid.descriptor);
+		vkUpdateDescriptorSets(m_vkDevice, 1, &writeDescriptorSet, 0, nullptr);
+		buildCommandBuffers();
+	}
+
 	virtual void render()
 	{
 		if (!m_prepared)
@@ -225,6 +369,24 @@ public:
 		updateUniformBuffers();
 		draw();
 	}
+
+	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay)
+	{
+		if (overlay->header("Settings")) {
+			overlay->checkBox("Frustum culling", &frustumCulling);
+			overlay->checkBox("Cone culling", &coneCulling);
+			overlay->checkBox("Occlusion culling", &occlusionCulling);
+			overlay->checkBox("Color meshlets", &colorMeshlets);
+		}
+		if (overlay->header("Statistics")) {
+			overlay->text("Meshlets: %d / %d", statistics.visibleMeshlets, static_cast<uint32_t>(model.meshlets.meshlets.size()));
+			overlay->text("Triangles (mesh shading): %d", statistics.visibleTriangles);
+			overlay->text("Triangles (vertex pipeline): %llu", static_cast<unsigned long long>(classicTriangleCount));
+			if (classicTriangleCount > 0) {
+				overlay->text("Culled: %.1f %%", 100.0f * (1.0f - static_cast<float>(statistics.visibleTriangles) / static_cast<float>(classicTriangleCount)));
+			}
+		}
+	}
 };
 
 VULKAN_EXAMPLE_MAIN()
@@ -1,22 +1,33 @@
 /*
 * Vulkan Example - Multi threaded command buffer generation and rendering
 *
+* The objects of every thread are grouped into batches that are recorded into cached secondary command buffers (see vks::CommandCache),
+* a batch is only re-recorded if the push constants or the visibility of one of its objects changed. The background and the UI overlay
+* are cached in their own secondaries, so the UI is only recorded again if the overlay changed.
+*
 * Copyright (C) 2016-2024 by Sascha Willems - www.saschawillems.de
 *
 * This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 
+#include <chrono>
+
 #include "vulkanexamplebase.h"
 
 #include "threadpool.hpp"
 #include "frustum.hpp"
 
 #include "VulkanglTFModel.h"
+#include "VulkanCommandCache.h"
 
 class VulkanExample : public VulkanExampleBase
 {
 public:
 	bool displayStarSphere = true;
+	// Disabling the cache re-records all secondaries each frame for comparison
+	bool commandCaching = true;
+	// Percentage of the objects (of every thread) that are animated, static objects only change with the camera
+	int32_t animatedPercentage = 100;
 
 	struct {
 		vkglTF::Model ufo;
@@ -36,15 +47,25 @@ public:
 	VkPipelineLayout m_vkPipelineLayout{ VK_NULL_HANDLE };
 	VkCommandBuffer primaryCommandBuffer{ VK_NULL_HANDLE };
 
-	// Secondary scene command buffers used to store backdrop and user interface
-	struct SecondaryCommandBuffers {
-		VkCommandBuffer background{ VK_NULL_HANDLE };
-		VkCommandBuffer ui{ VK_NULL_HANDLE };
-	} secondaryCommandBuffers;
+	// Secondary command buffers of the objects, one slot per batch of every thread
+	vks::CommandCache commandCache;
+	// Secondary command buffers for backdrop and user interface, recorded on the main thread
+	vks::CommandCache sceneCommandCache;
+	enum SceneSlot { SceneSlotBackground = 0, SceneSlotUI = 1, SceneSlotCount = 2 };
+	// Incremented whenever the overlay changed, which invalidates the UI secondary
+	uint64_t uiRevision{ 0 };
 
 	// Number of animated objects to be renderer
 	// by using threads and secondary command buffers
 	uint32_t numObjectsPerThread{ 0 };
+	// Visible objects of a batch are recorded into a single secondary command buffer
+	const uint32_t objectsPerBatch{ 16 };
+	uint32_t numBatchesPerThread{ 0 };
+
+	// Statistics of the last frame
+	uint32_t recordedSecondaries{ 0 };
+	uint32_t executedSecondaries{ 0 };
+	double recordTime{ 0.0 };
 
 	// Multi threaded stuff
 	// Max. number of concurrent threads
@@ -67,12 +88,12 @@ public:
 		float deltaT;
 		float stateT = 0;
 		bool visible = true;
+		bool animated = true;
 	};
 
 	struct ThreadData {
-		VkCommandPool commandPool{ VK_NULL_HANDLE };
-		// One command buffer per render object
-		std::vector<VkCommandBuffer> commandBuffer;
+		// Batches with at least one visible object, only those are executed
+		std::vector<bool> batchVisible;
 		// One push constant block per render object
 		std::vector<ThreadPushConstantBlock> pushConstBlock;
 		// Per object information (position, rotation, etc.)
@@ -118,10 +139,8 @@ public:
 			vkDestroyPipeline(m_vkDevice, pipelines.phong, nullptr);
 			vkDestroyPipeline(m_vkDevice, pipelines.starsphere, nullptr);
 			vkDestroyPipelineLayout(m_vkDevice, m_vkPipelineLayout, nullptr);
-			for (auto& thread : threadData) {
-				vkFreeCommandBuffers(m_vkDevice, thread.commandPool, static_cast<uint32_t>(thread.commandBuffer.size()), thread.commandBuffer.data());
-				vkDestroyCommandPool(m_vkDevice, thread.commandPool, nullptr);
-			}
+			commandCache.destroy();
+			sceneCommandCache.destroy();
 			vkDestroyFence(m_vkDevice, renderFence, nullptr);
 		}
 	}
@@ -145,10 +164,11 @@ public:
 				1);
 		VK_CHECK_RESULT(vkAllocateCommandBuffers(m_vkDevice, &cmdBufAllocateInfo, &primaryCommandBuffer));
 
-		// Create additional secondary CBs for background and m_UIOverlay
-		cmdBufAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
-		VK_CHECK_RESULT(vkAllocateCommandBuffers(m_vkDevice, &cmdBufAllocateInfo, &secondaryCommandBuffers.background));
-		VK_CHECK_RESULT(vkAllocateCommandBuffers(m_vkDevice, &cmdBufAllocateInfo, &secondaryCommandBuffers.ui));
+		// One command pool per thread with one secondary command buffer per batch of objects updated by that thread
+		// The render fence only lets a single frame be in flight, so one set of pools is enough
+		numBatchesPerThread = (numObjectsPerThread + objectsPerBatch - 1) / objectsPerBatch;
+		commandCache.create(m_pVulkanDevice, m_swapChain.queueNodeIndex, numThreads, numBatchesPerThread);
+		sceneCommandCache.create(m_pVulkanDevice, m_swapChain.queueNodeIndex, 1, SceneSlotCount);
 
 		threadData.resize(numThreads);
 
@@ -159,22 +179,7 @@ public:
 		for (uint32_t i = 0; i < numThreads; i++) {
 			ThreadData *thread = &threadData[i];
 
-			// Create one command pool for each thread
-			VkCommandPoolCreateInfo cmdPoolInfo = vks::initializers::commandPoolCreateInfo();
-			cmdPoolInfo.queueFamilyIndex = m_swapChain.queueNodeIndex;
-			cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-			VK_CHECK_RESULT(vkCreateCommandPool(m_vkDevice, &cmdPoolInfo, nullptr, &thread->commandPool));
-
-			// One secondary command buffer per object that is updated by this thread
-			thread->commandBuffer.resize(numObjectsPerThread);
-			// Generate secondary command buffers for each thread
-			VkCommandBufferAllocateInfo secondaryCmdBufAllocateInfo =
-				vks::initializers::commandBufferAllocateInfo(
-					thread->commandPool,
-					VK_COMMAND_BUFFER_LEVEL_SECONDARY,
-					static_cast<uint32_t>(thread->commandBuffer.size()));
-			VK_CHECK_RESULT(vkAllocateCommandBuffers(m_vkDevice, &secondaryCmdBufAllocateInfo, thread->commandBuffer.data()));
-
+			thread->batchVisible.resize(numBatchesPerThread, false);
 			thread->pushConstBlock.resize(numObjectsPerThread);
 			thread->objectData.resize(numObjectsPerThread);
 
@@ -193,130 +198,166 @@ public:
 			}
 		}
 
+		updateAnimatedObjects();
 	}
 
-	// Builds the secondary command buffer for each thread
-	void threadRenderCode(uint32_t threadIndex, uint32_t cmdBufferIndex, VkCommandBufferInheritanceInfo inheritanceInfo)
+	// The first objects of every thread are animated, so the static ones share batches whose secondaries stay valid
+	void updateAnimatedObjects()
+	{
+		const uint32_t animatedCount = numObjectsPerThread * static_cast<uint32_t>(animatedPercentage) / 100;
+		for (auto& thread : threadData) {
+			for (uint32_t j = 0; j < numObjectsPerThread; j++) {
+				thread.objectData[j].animated = (j < animatedCount);
+			}
+		}
+	}
+
+	// Updates the objects of a thread and the push constant blocks derived from them
+	void updateObjects(uint32_t threadIndex)
 	{
 		ThreadData *thread = &threadData[threadIndex];
-		ObjectData *objectData = &thread->objectData[cmdBufferIndex];
+		for (uint32_t i = 0; i < numObjectsPerThread; i++) {
+			ObjectData *objectData = &thread->objectData[i];
 
-		// Check visibility against m_vkImageView frustum using a simple sphere check based on the radius of the mesh
-		objectData->visible = frustum.checkSphere(objectData->pos, models.ufo.dimensions.radius * 0.5f);
+			// Check visibility against m_vkImageView frustum using a simple sphere check based on the radius of the mesh
+			objectData->visible = frustum.checkSphere(objectData->pos, models.ufo.dimensions.radius * 0.5f);
 
-		if (!objectData->visible)
-		{
-			return;
+			if (objectData->animated && !paused) {
+				objectData->rotation.y += 2.5f * objectData->rotationSpeed * m_frameTimer;
+				if (objectData->rotation.y > 360.0f) {
+					objectData->rotation.y -= 360.0f;
+				}
+				objectData->deltaT += 0.15f * m_frameTimer;
+				if (objectData->deltaT > 1.0f)
+					objectData->deltaT -= 1.0f;
+				objectData->pos.y = sin(glm::radians(objectData->deltaT * 360.0f)) * 2.5f;
+			}
+
+			objectData->model = glm::translate(glm::mat4(1.0f), objectData->pos);
+			objectData->model = glm::rotate(objectData->model, -sinf(glm::radians(objectData->deltaT * 360.0f)) * 0.25f, glm::vec3(objectData->rotationDir, 0.0f, 0.0f));
+			objectData->model = glm::rotate(objectData->model, glm::radians(objectData->rotation.y), glm::vec3(0.0f, objectData->rotationDir, 0.0f));
+			objectData->model = glm::rotate(objectData->model, glm::radians(objectData->deltaT * 360.0f), glm::vec3(0.0f, objectData->rotationDir, 0.0f));
+			objectData->model = glm::scale(objectData->model, glm::vec3(objectData->scale));
+
+			thread->pushConstBlock[i].mvp = matrices.projection * matrices.view * objectData->model;
 		}
+	}
 
-		VkCommandBufferBeginInfo commandBufferBeginInfo = vks::initializers::commandBufferBeginInfo();
-		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
-		commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
+	// Builds the secondary command buffers for the batches of a thread
+	// A batch is only recorded again if the visibility or the push constants of one of its objects changed
+	void threadRenderCode(uint32_t threadIndex, VkCommandBufferInheritanceInfo inheritanceInfo)
+	{
+		ThreadData *thread = &threadData[threadIndex];
 
-		VkCommandBuffer cmdBuffer = thread->commandBuffer[cmdBufferIndex];
+		updateObjects(threadIndex);
 
-		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &commandBufferBeginInfo));
+		for (uint32_t batch = 0; batch < numBatchesPerThread; batch++) {
+			const uint32_t first = batch * objectsPerBatch;
+			const uint32_t last = std::min(first + objectsPerBatch, numObjectsPerThread);
 
-		VkViewport viewport = vks::initializers::viewport((float)m_drawAreaWidth, (float)m_drawAreaHeight, 0.0f, 1.0f);
-		vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+			// The recorded commands only depend on which objects are visible and on their push constants
+			uint64_t stateHash = vks::CommandCache::hashSeed;
+			uint32_t visibleCount = 0;
+			for (uint32_t i = first; i < last; i++) {
+				if (thread->objectData[i].visible) {
+					stateHash = vks::CommandCache::hash(i, stateHash);
+					stateHash = vks::CommandCache::hash(thread->pushConstBlock[i], stateHash);
+					visibleCount++;
+				}
+			}
 
-		VkRect2D scissor = vks::initializers::rect2D(m_drawAreaWidth, m_drawAreaHeight, 0, 0);
-		vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+			// Batches without visible objects are neither recorded nor executed
+			thread->batchVisible[batch] = (visibleCount > 0);
+			if (visibleCount == 0) {
+				continue;
+			}
 
-		vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.phong);
+			VkCommandBuffer cmdBuffer = commandCache.record(threadIndex, batch, stateHash, inheritanceInfo);
+			if (cmdBuffer == VK_NULL_HANDLE) {
+				// Nothing changed since the batch was last recorded
+				continue;
+			}
 
-		// Update
-		if (!paused) {
-			objectData->rotation.y += 2.5f * objectData->rotationSpeed * m_frameTimer;
-			if (objectData->rotation.y > 360.0f) {
-				objectData->rotation.y -= 360.0f;
+			VkViewport viewport = vks::initializers::viewport((float)m_drawAreaWidth, (float)m_drawAreaHeight, 0.0f, 1.0f);
+			vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+
+			VkRect2D scissor = vks::initializers::rect2D(m_drawAreaWidth, m_drawAreaHeight, 0, 0);
+			vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+
+			vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.phong);
+
+			VkDeviceSize offsets[1] = { 0 };
+			vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &models.ufo.vertices.buffer, offsets);
+			vkCmdBindIndexBuffer(cmdBuffer, models.ufo.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+
+			for (uint32_t i = first; i < last; i++) {
+				if (!thread->objectData[i].visible) {
+					continue;
+				}
+				// Update shader push constant block
+				// Contains model m_vkImageView matrix
+				vkCmdPushConstants(
+					cmdBuffer,
+					m_vkPipelineLayout,
+					VK_SHADER_STAGE_VERTEX_BIT,
+					0,
+					sizeof(ThreadPushConstantBlock),
+					&thread->pushConstBlock[i]);
+				vkCmdDrawIndexed(cmdBuffer, models.ufo.indices.count, 1, 0, 0, 0);
 			}
-			objectData->deltaT += 0.15f * m_frameTimer;
-			if (objectData->deltaT > 1.0f)
-				objectData->deltaT -= 1.0f;
-			objectData->pos.y = sin(glm::radians(objectData->deltaT * 360.0f)) * 2.5f;
-		}
 
-		objectData->model = glm::translate(glm::mat4(1.0f), objectData->pos);
-		objectData->model = glm::rotate(objectData->model, -sinf(glm::radians(objectData->deltaT * 360.0f)) * 0.25f, glm::vec3(objectData->rotationDir, 0.0f, 0.0f));
-		objectData->model = glm::rotate(objectData->model, glm::radians(objectData->rotation.y), glm::vec3(0.0f, objectData->rotationDir, 0.0f));
-		objectData->model = glm::rotate(objectData->model, glm::radians(objectData->deltaT * 360.0f), glm::vec3(0.0f, objectData->rotationDir, 0.0f));
-		objectData->model = glm::scale(objectData->model, glm::vec3(objectData->scale));
-
-		thread->pushConstBlock[cmdBufferIndex].mvp = matrices.projection * matrices.view * objectData->model;
-
-		// Update shader push constant block
-		// Contains model m_vkImageView matrix
-		vkCmdPushConstants(
-			cmdBuffer,
-			m_vkPipelineLayout,
-			VK_SHADER_STAGE_VERTEX_BIT,
-			0,
-			sizeof(ThreadPushConstantBlock),
-			&thread->pushConstBlock[cmdBufferIndex]);
-
-		VkDeviceSize offsets[1] = { 0 };
-		vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &models.ufo.vertices.buffer, offsets);
-		vkCmdBindIndexBuffer(cmdBuffer, models.ufo.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
-		vkCmdDrawIndexed(cmdBuffer, models.ufo.indices.count, 1, 0, 0, 0);
-
-		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
+			VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
+		}
 	}
 
 	void updateSecondaryCommandBuffers(VkCommandBufferInheritanceInfo inheritanceInfo)
 	{
-		// Secondary command buffer for the sky sphere
-		VkCommandBufferBeginInfo commandBufferBeginInfo = vks::initializers::commandBufferBeginInfo();
-		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
-		commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
-
 		VkViewport viewport = vks::initializers::viewport((float)m_drawAreaWidth, (float)m_drawAreaHeight, 0.0f, 1.0f);
 		VkRect2D scissor = vks::initializers::rect2D(m_drawAreaWidth, m_drawAreaHeight, 0, 0);
 
 		/*
 			Background
-		*/
-
-		VK_CHECK_RESULT(vkBeginCommandBuffer(secondaryCommandBuffers.background, &commandBufferBeginInfo));
-
-		vkCmdSetViewport(secondaryCommandBuffers.background, 0, 1, &viewport);
-		vkCmdSetScissor(secondaryCommandBuffers.background, 0, 1, &scissor);
 
-		vkCmdBindPipeline(secondaryCommandBuffers.background, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.starsphere);
+			Only depends on the rotation of the camera
+		*/
 
 		glm::mat4 mvp = matrices.projection * matrices.view;
 		mvp[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
 		mvp = glm::scale(mvp, glm::vec3(2.0f));
 
-		vkCmdPushConstants(
-			secondaryCommandBuffers.background,
-			m_vkPipelineLayout,
-			VK_SHADER_STAGE_VERTEX_BIT,
-			0,
-			sizeof(mvp),
-			&mvp);
+		VkCommandBuffer cmdBuffer = sceneCommandCache.record(0, SceneSlotBackground, vks::CommandCache::hash(mvp), inheritanceInfo);
+		if (cmdBuffer != VK_NULL_HANDLE) {
+			vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+			vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+
+			vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.starsphere);
 
-		models.starSphere.draw(secondaryCommandBuffers.background);
-		
-		VK_CHECK_RESULT(vkEndCommandBuffer(secondaryCommandBuffers.background));
+			vkCmdPushConstants(
+				cmdBuffer,
+				m_vkPipelineLayout,
+				VK_SHADER_STAGE_VERTEX_BIT,
+				0,
+				sizeof(mvp),
+				&mvp);
+
+			models.starSphere.draw(cmdBuffer);
+
+			VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
+		}
 
 		/*
 			User interface
 
 			With VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, the primary command buffer's content has to be defined
 			by secondary command buffers, which also applies to the UI overlay command buffer
+			The UI is recorded independently of the scene and only if the overlay changed (see buildCommandBuffers)
 		*/
 
-		VK_CHECK_RESULT(vkBeginCommandBuffer(secondaryCommandBuffers.ui, &commandBufferBeginInfo));
-
-		vkCmdSetViewport(secondaryCommandBuffers.ui, 0, 1, &viewport);
-		vkCmdSetScissor(secondaryCommandBuffers.ui, 0, 1, &scissor);
-
-		vkCmdBindPipeline(secondaryCommandBuffers.ui, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.starsphere);
-
-		drawUI(secondaryCommandBuffers.ui);
-
-		VK_CHECK_RESULT(vkEndCommandBuffer(secondaryCommandBuffers.ui));
+		cmdBuffer = sceneCommandCache.record(0, SceneSlotUI, vks::CommandCache::hash(uiRevision), inheritanceInfo);
+		if (cmdBuffer != VK_NULL_HANDLE) {
+			drawUI(cmdBuffer);
+			VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
+		}
 	}
 
 	// Updates the secondary command buffers using a thread pool
@@ -354,44 +395,56 @@ public:
 		// Inheritance info for the secondary command buffers
 		VkCommandBufferInheritanceInfo inheritanceInfo = vks::initializers::commandBufferInheritanceInfo();
 		inheritanceInfo.renderPass = m_vkRenderPass;
-		// Secondary command buffer also use the currently active framebuffer
-		inheritanceInfo.framebuffer = frameBuffer;
-
-		// Update secondary sene command buffers
-		updateSecondaryCommandBuffers(inheritanceInfo);
-
-		if (displayStarSphere) {
-			commandBuffers.push_back(secondaryCommandBuffers.background);
+		// Cached secondaries are executed with the framebuffers of all swap chain images, so they can't name a specific one
+		inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+
+		// The render fence guarantees that none of the secondaries is still executing
+		commandCache.beginFrame(0);
+		sceneCommandCache.beginFrame(0);
+		if (!commandCaching) {
+			commandCache.invalidate();
+			sceneCommandCache.invalidate();
 		}
 
-		// Add a job to the thread's m_vkQueue for each object to be rendered
+		const auto tStart = std::chrono::high_resolution_clock::now();
+
+		// Add a job to the thread's m_vkQueue that updates and records all batches of its objects
 		for (uint32_t t = 0; t < numThreads; t++)
 		{
-			for (uint32_t i = 0; i < numObjectsPerThread; i++)
-			{
-				threadPool.threads[t]->addJob([=] { threadRenderCode(t, i, inheritanceInfo); });
-			}
+			threadPool.threads[t]->addJob([=] { threadRenderCode(t, inheritanceInfo); });
 		}
 
+		// Update secondary scene command buffers while the threads record the objects
+		updateSecondaryCommandBuffers(inheritanceInfo);
+
 		threadPool.wait();
 
-		// Only submit if object is within the current m_vkImageView frustum
+		recordTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+		recordedSecondaries = commandCache.getRecordedCount() + sceneCommandCache.getRecordedCount();
+
+		if (displayStarSphere) {
+			commandBuffers.push_back(sceneCommandCache.get(0, SceneSlotBackground));
+		}
+
+		// Only submit batches with objects within the current m_vkImageView frustum
 		for (uint32_t t = 0; t < numThreads; t++)
 		{
-			for (uint32_t i = 0; i < numObjectsPerThread; i++)
+			for (uint32_t batch = 0; batch < numBatchesPerThread; batch++)
 			{
-				if (threadData[t].objectData[i].visible)
+				if (threadData[t].batchVisible[batch])
 				{
-					commandBuffers.push_back(threadData[t].commandBuffer[i]);
+					commandBuffers.push_back(commandCache.get(t, batch));
 				}
 			}
 		}
 
 		// Render m_UIOverlay last
 		if (m_UIOverlay.visible) {
-			commandBuffers.push_back(secondaryCommandBuffers.ui);
+			commandBuffers.push_back(sceneCommandCache.get(0, SceneSlotUI));
 		}
 
+		executedSecondaries = static_cast<uint32_t>(commandBuffers.size());
+
 		// Execute render commands from the secondary command buffer
 		vkCmdExecuteCommands(primaryCommandBuffer, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
 
@@ -505,13 +558,33 @@ public:
 		draw();
 	}
 
+	// Called by the base class whenever the overlay changed, the scene secondaries are not affected by this
+	void buildCommandBuffers()
+	{
+		uiRevision++;
+	}
+
+	virtual void windowResized()
+	{
+		// Viewport and scissor are part of all recordings
+		commandCache.invalidate();
+		sceneCommandCache.invalidate();
+	}
+
 	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay)
 	{
 		if (overlay->header("Statistics")) {
 			overlay->text("Active threads: %d", numThreads);
+			overlay->text("Secondaries recorded: %d", recordedSecondaries);
+			overlay->text("Secondaries executed: %d", executedSecondaries);
+			overlay->text("Recording: %.3f ms", recordTime);
 		}
 		if (overlay->header("Settings")) {
 			overlay->checkBox("Stars", &displayStarSphere);
+			overlay->checkBox("Cache command buffers", &commandCaching);
+			if (overlay->sliderInt("Animated objects (%)", &animatedPercentage, 0, 100)) {
+				updateAnimatedObjects();
+			}
 		}
 
 	}
@@ -699,7 +699,11 @@ public:
 		// Multiview offscreen render
 		VK_CHECK_RESULT(vkWaitForFences(m_vkDevice, 1, &multiviewPass.waitFences[m_currentBufferIndex], VK_TRUE, UINT64_MAX));
 		VK_CHECK_RESULT(vkResetFences(m_vkDevice, 1, &multiviewPass.waitFences[m_currentBufferIndex]));
-		m_vkSubmitInfo.pWaitSemaphores = &semaphores.m_vkSemaphorePresentComplete;
+		// There's no swap chain image to wait on in headless mode
+		const std::vector<VkSemaphore> presentWaitSemaphores = getPresentWaitSemaphores();
+		m_vkSubmitInfo.waitSemaphoreCount = static_cast<uint32_t>(presentWaitSemaphores.size());
+		m_vkSubmitInfo.pWaitSemaphores = presentWaitSemaphores.data();
+		m_vkSubmitInfo.signalSemaphoreCount = 1;
 		m_vkSubmitInfo.pSignalSemaphores = &multiviewPass.semaphore;
 		m_vkSubmitInfo.commandBufferCount = 1;
 		m_vkSubmitInfo.pCommandBuffers = &multiviewPass.commandBuffers[m_currentBufferIndex];
@@ -708,8 +712,11 @@ public:
 		// View display
 		VK_CHECK_RESULT(vkWaitForFences(m_vkDevice, 1, &m_vkFences[m_currentBufferIndex], VK_TRUE, UINT64_MAX));
 		VK_CHECK_RESULT(vkResetFences(m_vkDevice, 1, &m_vkFences[m_currentBufferIndex]));
+		m_vkSubmitInfo.waitSemaphoreCount = 1;
 		m_vkSubmitInfo.pWaitSemaphores = &multiviewPass.semaphore;
-		m_vkSubmitInfo.pSignalSemaphores = &semaphores.m_vkSemaphoreRenderComplete;
+		const std::vector<VkSemaphore> presentSignalSemaphores = getPresentSignalSemaphores();
+		m_vkSubmitInfo.signalSemaphoreCount = static_cast<uint32_t>(presentSignalSemaphores.size());
+		m_vkSubmitInfo.pSignalSemaphores = presentSignalSemaphores.data();
 		m_vkSubmitInfo.commandBufferCount = 1;
 		m_vkSubmitInfo.pCommandBuffers = &drawCmdBuffers[m_currentBufferIndex];
 		VK_CHECK_RESULT(vkQueueSubmit(m_vkQueue, 1, &m_vkSubmitInfo, m_vkFences[m_currentBufferIndex]));
@@ -1,13 +1,17 @@
 /*
 * Vulkan Example - Using occlusion query for visibility testing
 *
-* Copyright (C) 2016-2023 by Sascha Willems - www.saschawillems.de
+* Culls a configurable number of objects behind an occluder with one occlusion query per object and frame (see base/VulkanOcclusionCuller.cpp)
+* Results are either read on the host without waiting for the GPU, or consumed on the GPU with conditional rendering (VK_EXT_conditional_rendering) if supported
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
 *
 * This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
+#include "VulkanOcclusionCuller.h"
 
 class VulkanExample : public VulkanExampleBase
 {
@@ -19,42 +23,52 @@ public:
 		vkglTF::Model sphere;
 	} models;
 
-	struct {
-		vks::Buffer occluder;
-		vks::Buffer teapot;
-		vks::Buffer sphere;
-	} uniformBuffers;
+	vks::Buffer uniformBuffer;
 
-	struct UBOVS {
+	struct UniformData {
 		glm::mat4 projection;
 		glm::mat4 view;
-		glm::mat4 model;
-		glm::vec4 color = glm::vec4(0.0f);
 		glm::vec4 lightPos = glm::vec4(10.0f, -10.0f, 10.0f, 1.0f);
-		float visible;
-	} uboVS;
+	} uniformData;
+
+	// Per object data passed to the shaders
+	struct PushConsts {
+		glm::mat4 model;
+		glm::vec4 color;
+	};
+
+	struct Object {
+		vkglTF::Model* model;
+		glm::mat4 matrix;
+		// Transforms the culler's unit cube to the object's bounding box
+		glm::mat4 boundsMatrix;
+		glm::vec4 color;
+	};
+	std::vector<Object> objects;
 
 	struct {
 		VkPipeline solid;
 		VkPipeline occluder;
-		// Pipeline with basic shaders used for occlusion pass
-		VkPipeline simple;
+		// Pipeline for the bounding boxes of occluded objects, tests depth without writing depth or color
+		VkPipeline boundingBox;
 	} pipelines;
 
-	struct {
-		VkDescriptorSet teapot;
-		VkDescriptorSet sphere;
-	} descriptorSets;
-
 	VkPipelineLayout m_vkPipelineLayout;
 	VkDescriptorSet descriptorSet;
 	VkDescriptorSetLayout m_vkDescriptorSetLayout;
 
-	// Pool that stores all occlusion queries
-	VkQueryPool queryPool;
+	vks::OcclusionCuller occlusionCuller;
 
-	// Passed query samples
-	uint64_t passedSamples[2] = { 1,1 };
+	enum CullingMode : int32_t { CullingNone = 0, CullingHostReadback = 1, CullingConditionalRendering = 2 };
+	int32_t cullingMode = CullingHostReadback;
+	int32_t objectCountIndex = 2;
+	// The first setting is the original two object scene, the others are cubic grids of objects around the occluder
+	const std::vector<uint32_t> objectCounts = { 2, 512, 4096, 13824 };
+	VkPhysicalDeviceConditionalRenderingFeaturesEXT conditionalRenderingFeatures{};
+	VkPhysicalDeviceHostQueryResetFeatures hostQueryResetFeatures{};
+	bool conditionalRenderingSupported = false;
+	// Duration of recording the command buffer with host readback, which depends on the visibility and is recorded every frame
+	double recordTime = 0.0;
 
 	VulkanExample() : VulkanExampleBase()
 	{
@@ -64,6 +78,10 @@ public:
 		camera.setRotation(glm::vec3(0.0f, -123.75f, 0.0f));
 		camera.setRotationSpeed(0.5f);
 		camera.setPerspective(60.0f, (float)m_drawAreaWidth / (float)m_drawAreaHeight, 1.0f, 256.0f);
+		// Conditional rendering is enabled if supported, see getEnabledExtensions
+		m_requestedInstanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+		// The occlusion culler resets the query pools of the host readback mode from the host (core since 1.2)
+		m_requestedApiVersion = VK_API_VERSION_1_2;
 	}
 
 	~VulkanExample()
@@ -72,48 +90,51 @@ public:
 		// Note : Inherited destructor cleans up resources stored in base class
 		vkDestroyPipeline(m_vkDevice, pipelines.solid, nullptr);
 		vkDestroyPipeline(m_vkDevice, pipelines.occluder, nullptr);
-		vkDestroyPipeline(m_vkDevice, pipelines.simple, nullptr);
+		vkDestroyPipeline(m_vkDevice, pipelines.boundingBox, nullptr);
 
 		vkDestroyPipelineLayout(m_vkDevice, m_vkPipelineLayout, nullptr);
 		vkDestroyDescriptorSetLayout(m_vkDevice, m_vkDescriptorSetLayout, nullptr);
 
-		vkDestroyQueryPool(m_vkDevice, queryPool, nullptr);
+		occlusionCuller.destroy();
 
-		uniformBuffers.occluder.destroy();
-		uniformBuffers.sphere.destroy();
-		uniformBuffers.teapot.destroy();
+		uniformBuffer.destroy();
 	}
 
-	// Create a query pool for storing the occlusion query result
-	void setupQueryPool()
+	void getEnabledExtensions()
 	{
-		VkQueryPoolCreateInfo queryPoolInfo = {};
-		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
-		queryPoolInfo.queryType = VK_QUERY_TYPE_OCCLUSION;
-		queryPoolInfo.queryCount = 2;
-		VK_CHECK_RESULT(vkCreateQueryPool(m_vkDevice, &queryPoolInfo, NULL, &queryPool));
+		conditionalRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_CONDITIONAL_RENDERING_FEATURES_EXT;
+		hostQueryResetFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES;
+		hostQueryResetFeatures.pNext = &conditionalRenderingFeatures;
+		VkPhysicalDeviceFeatures2 physicalDeviceFeatures2{};
+		physicalDeviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		physicalDeviceFeatures2.pNext = &hostQueryResetFeatures;
+		vkGetPhysicalDeviceFeatures2(m_vkPhysicalDevice, &physicalDeviceFeatures2);
+		if (!hostQueryResetFeatures.hostQueryReset) {
+			vks::tools::exitFatal("Selected GPU does not support resetting queries from the host", VK_ERROR_FEATURE_NOT_PRESENT);
+		}
+		conditionalRenderingSupported = m_pVulkanDevice->extensionSupported(VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME) && conditionalRenderingFeatures.conditionalRendering;
+		// Host query reset is always enabled, conditional rendering is chained behind it if supported
+		hostQueryResetFeatures.pNext = nullptr;
+		if (conditionalRenderingSupported) {
+			m_requestedDeviceExtensions.push_back(VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME);
+			conditionalRenderingFeatures.pNext = nullptr;
+			hostQueryResetFeatures.pNext = &conditionalRenderingFeatures;
+		}
+		m_deviceCreatepNextChain = &hostQueryResetFeatures;
 	}
 
-	// Retrieves the results of the occlusion queries submitted to the command buffer
-	void getQueryResults()
+	// (Re)create the culler for the current objects and culling mode
+	void prepareOcclusionCuller()
 	{
-		// We use vkGetQueryResults to copy the results into a host visible buffer
-		vkGetQueryPoolResults(
-			m_vkDevice,
-			queryPool,
-			0,
-			2,
-			sizeof(passedSamples),
-			passedSamples,
-			sizeof(uint64_t),
-			// Store results a 64 bit values and wait until the results have been finished
-			// If you don't want to wait, you can use VK_QUERY_RESULT_WITH_AVAILABILITY_BIT
-			// which also returns the state of the result (ready) in the result
-			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+		occlusionCuller.destroy();
+		const vks::OcclusionCuller::Mode mode = (cullingMode == CullingConditionalRendering) ? vks::OcclusionCuller::Mode::ConditionalRendering : vks::OcclusionCuller::Mode::HostReadback;
+		// One pool per command buffer, as many frames can be in flight
+		occlusionCuller.create(m_pVulkanDevice, m_vkQueue, static_cast<uint32_t>(objects.size()), static_cast<uint32_t>(drawCmdBuffers.size()), mode);
 	}
 
-	void buildCommandBuffers()
+	void recordCommandBuffer(uint32_t index)
 	{
+		VkCommandBuffer commandBuffer = drawCmdBuffers[index];
 		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
 
 		VkClearValue clearValues[2];
@@ -128,98 +149,92 @@ public:
 		renderPassBeginInfo.renderArea.extent.height = m_drawAreaHeight;
 		renderPassBeginInfo.clearValueCount = 2;
 		renderPassBeginInfo.pClearValues = clearValues;
+		renderPassBeginInfo.framebuffer = m_vkFrameBuffers[index];
 
-		for (int32_t i = 0; i < drawCmdBuffers.size(); ++i)
-		{
-			// Set target frame buffer
-			renderPassBeginInfo.framebuffer = m_vkFrameBuffers[i];
-
-			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
-
-			// Reset query pool
-			// Must be done outside of render pass
-			vkCmdResetQueryPool(drawCmdBuffers[i], queryPool, 0, 2);
-
-			vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-			VkViewport viewport = vks::initializers::viewport(
-				(float)m_drawAreaWidth,
-				(float)m_drawAreaHeight,
-				0.0f,
-				1.0f);
-			vkCmdSetViewport(drawCmdBuffers[i], 0, 1, &viewport);
-
-			VkRect2D scissor = vks::initializers::rect2D(
-				m_drawAreaWidth,
-				m_drawAreaHeight,
-				0,
-				0);
-			vkCmdSetScissor(drawCmdBuffers[i], 0, 1, &scissor);
-
-			glm::mat4 modelMatrix = glm::mat4(1.0f);
+		VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &cmdBufInfo));
 
-			// Occlusion pass
-			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.simple);
-
-			// Occluder first
-			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, 1, &descriptorSet, 0, NULL);
-			models.plane.draw(drawCmdBuffers[i]);
-
-			// Teapot
-			vkCmdBeginQuery(drawCmdBuffers[i], queryPool, 0, VK_FLAGS_NONE);
-			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, 1, &descriptorSets.teapot, 0, NULL);
-			models.teapot.draw(drawCmdBuffers[i]);
-			vkCmdEndQuery(drawCmdBuffers[i], queryPool, 0);
-
-			// Sphere
-			vkCmdBeginQuery(drawCmdBuffers[i], queryPool, 1, VK_FLAGS_NONE);
-			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, 1, &descriptorSets.sphere, 0, NULL);
-			models.sphere.draw(drawCmdBuffers[i]);
-			vkCmdEndQuery(drawCmdBuffers[i], queryPool, 1);
-
-			// Visible pass
-			// Clear color and depth attachments
-			VkClearAttachment clearAttachments[2] = {};
-
-			clearAttachments[0].aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			clearAttachments[0].clearValue.color = m_vkClearColorValueDefault;
-			clearAttachments[0].colorAttachment = 0;
+		// Prepares the queries (and predicates) of the frame
+		// Must be done outside of render pass
+		if (cullingMode != CullingNone) {
+			occlusionCuller.beginFrame(commandBuffer);
+		}
 
-			clearAttachments[1].aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-			clearAttachments[1].clearValue.depthStencil = { 1.0f, 0 };
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-			VkClearRect clearRect = {};
-			clearRect.layerCount = 1;
-			clearRect.rect.offset = { 0, 0 };
-			clearRect.rect.extent = { m_drawAreaWidth, m_drawAreaHeight };
+		VkViewport viewport = vks::initializers::viewport((float)m_drawAreaWidth, (float)m_drawAreaHeight, 0.0f, 1.0f);
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		VkRect2D scissor = vks::initializers::rect2D(m_drawAreaWidth, m_drawAreaHeight, 0, 0);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-			vkCmdClearAttachments(
-				drawCmdBuffers[i],
-				2,
-				clearAttachments,
-				1,
-				&clearRect);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, 1, &descriptorSet, 0, NULL);
 
-			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.solid);
+		auto pushObject = [&](const glm::mat4& matrix, const glm::vec4& color) {
+			const PushConsts pushConsts = { matrix, color };
+			vkCmdPushConstants(commandBuffer, m_vkPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConsts), &pushConsts);
+		};
 
-			// Teapot
-			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, 1, &descriptorSets.teapot, 0, NULL);
-			models.teapot.draw(drawCmdBuffers[i]);
+		// Occluder first, so the objects' queries are tested against it
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.occluder);
+		pushObject(glm::scale(glm::mat4(1.0f), glm::vec3(6.0f)), glm::vec4(0.0f, 0.0f, 1.0f, 0.5f));
+		models.plane.draw(commandBuffer);
+
+		// Objects visible in the last frame with results
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.solid);
+		for (uint32_t i = 0; i < static_cast<uint32_t>(objects.size()); i++) {
+			const Object& object = objects[i];
+			switch (cullingMode) {
+			case CullingNone:
+				pushObject(object.matrix, object.color);
+				object.model->draw(commandBuffer);
+				break;
+			case CullingHostReadback:
+				// Visible objects are queried with their own geometry
+				if (occlusionCuller.visible(i)) {
+					occlusionCuller.beginQuery(commandBuffer, i);
+					pushObject(object.matrix, object.color);
+					object.model->draw(commandBuffer);
+					occlusionCuller.endQuery(commandBuffer, i);
+				}
+				break;
+			case CullingConditionalRendering:
+				// The draw is discarded on the GPU if the object's query of the previous frame had no passed samples
+				occlusionCuller.beginConditionalRendering(commandBuffer, i);
+				pushObject(object.matrix, object.color);
+				object.model->draw(commandBuffer);
+				occlusionCuller.endConditionalRendering(commandBuffer);
+				break;
+			}
+		}
 
-			// Sphere
-			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, 1, &descriptorSets.sphere, 0, NULL);
-			models.sphere.draw(drawCmdBuffers[i]);
+		// Bounding boxes of occluded objects (or all objects with conditional rendering) are tested against the depth buffer of everything drawn before
+		if (cullingMode != CullingNone) {
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.boundingBox);
+			for (uint32_t i = 0; i < static_cast<uint32_t>(objects.size()); i++) {
+				if ((cullingMode == CullingHostReadback) && occlusionCuller.visible(i)) {
+					continue;
+				}
+				occlusionCuller.beginQuery(commandBuffer, i);
+				pushObject(objects[i].boundsMatrix, objects[i].color);
+				occlusionCuller.drawBoundingBox(commandBuffer);
+				occlusionCuller.endQuery(commandBuffer, i);
+			}
+		}
 
-			// Occluder
-			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.occluder);
-			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, 1, &descriptorSet, 0, NULL);
-			models.plane.draw(drawCmdBuffers[i]);
+		drawUI(commandBuffer);
 
-			drawUI(drawCmdBuffers[i]);
+		vkCmdEndRenderPass(commandBuffer);
 
-			vkCmdEndRenderPass(drawCmdBuffers[i]);
+		VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
+	}
 
-			VK_CHECK_RESULT(vkEndCommandBuffer(drawCmdBuffers[i]));
+	void buildCommandBuffers()
+	{
+		// With host readback the command buffer depends on the visibility and is recorded every frame in draw
+		if (cullingMode == CullingHostReadback) {
+			return;
+		}
+		for (uint32_t i = 0; i < static_cast<uint32_t>(drawCmdBuffers.size()); ++i) {
+			recordCommandBuffer(i);
 		}
 	}
 
@@ -231,14 +246,51 @@ public:
 		models.sphere.loadFromFile(getAssetPath() + "models/sphere.gltf", m_pVulkanDevice, m_vkQueue, glTFLoadingFlags);
 	}
 
+	// Place the objects, either the original two objects or a grid of alternating teapots and spheres on both sides of the occluder
+	void prepareObjects()
+	{
+		const uint32_t objectCount = objectCounts[objectCountIndex];
+		objects.clear();
+		objects.reserve(objectCount);
+		auto addObject = [this](vkglTF::Model* model, const glm::mat4& matrix, const glm::vec4& color) {
+			const glm::mat4 boundsMatrix = matrix * glm::translate(glm::mat4(1.0f), model->dimensions.min) * glm::scale(glm::mat4(1.0f), model->dimensions.max - model->dimensions.min);
+			objects.push_back({ model, matrix, boundsMatrix, color });
+		};
+
+		if (objectCount == 2) {
+			addObject(&models.teapot, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -3.0f)), glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
+			addObject(&models.sphere, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 3.0f)), glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
+			return;
+		}
+
+		// Grid with an even number of objects along each axis, so no object intersects the occluder in the z = 0 plane
+		const uint32_t gridSize = static_cast<uint32_t>(std::round(std::cbrt(static_cast<float>(objectCount))));
+		const glm::vec3 planeSize = models.plane.dimensions.max - models.plane.dimensions.min;
+		const float extent = 6.0f * 0.5f * std::max(planeSize.x, planeSize.y);
+		const float spacing = 2.0f * extent / static_cast<float>(gridSize);
+		for (uint32_t z = 0; z < gridSize; z++) {
+			for (uint32_t y = 0; y < gridSize; y++) {
+				for (uint32_t x = 0; x < gridSize; x++) {
+					const uint32_t index = (z * gridSize + y) * gridSize + x;
+					vkglTF::Model* model = (index % 2 == 0) ? &models.teapot : &models.sphere;
+					const glm::vec3 size = model->dimensions.max - model->dimensions.min;
+					const float scale = 0.6f * spacing / std::max(std::max(size.x, size.y), size.z);
+					const glm::vec3 position = (glm::vec3(x, y, z) + glm::vec3(0.5f)) * spacing - glm::vec3(extent);
+					const glm::mat4 matrix = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(scale));
+					const glm::vec4 color = glm::vec4(0.25f + 0.75f * static_cast<float>(x) / gridSize, 0.25f + 0.75f * static_cast<float>(y) / gridSize, 0.25f + 0.75f * static_cast<float>(z) / gridSize, 1.0f);
+					addObject(model, matrix, color);
+				}
+			}
+		}
+	}
+
 	void setupDescriptors()
 	{
 		// Pool
 		std::vector<VkDescriptorPoolSize> poolSizes = {
-			// One uniform buffer block for each mesh
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3)
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1)
 		};
-		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, 3);
+		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, 1);
 		VK_CHECK_RESULT(vkCreateDescriptorPool(m_vkDevice, &descriptorPoolInfo, nullptr, &m_vkDescriptorPool));
 
 		// Layout
@@ -249,31 +301,23 @@ public:
 		VkDescriptorSetLayoutCreateInfo descriptorLayout = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
 		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(m_vkDevice, &descriptorLayout, nullptr, &m_vkDescriptorSetLayout));
 
-		// Sets
+		// Set, shared by all objects which pass their matrices as push constants
 		VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(m_vkDescriptorPool, &m_vkDescriptorSetLayout, 1);
-		// Occluder (plane)
 		VK_CHECK_RESULT(vkAllocateDescriptorSets(m_vkDevice, &allocInfo, &descriptorSet));
 		std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
 			// Binding 0 : Vertex shader uniform buffer
-			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &uniformBuffers.occluder.descriptor)
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &uniformBuffer.descriptor)
 		};
 		vkUpdateDescriptorSets(m_vkDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
-		// Teapot
-		VK_CHECK_RESULT(vkAllocateDescriptorSets(m_vkDevice, &allocInfo, &descriptorSets.teapot));
-		writeDescriptorSets[0].dstSet = descriptorSets.teapot;
-		writeDescriptorSets[0].pBufferInfo = &uniformBuffers.teapot.descriptor;
-		vkUpdateDescriptorSets(m_vkDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
-		// Sphere
-		VK_CHECK_RESULT(vkAllocateDescriptorSets(m_vkDevice, &allocInfo, &descriptorSets.sphere));
-		writeDescriptorSets[0].dstSet = descriptorSets.sphere;
-		writeDescriptorSets[0].pBufferInfo = &uniformBuffers.sphere.descriptor;
-		vkUpdateDescriptorSets(m_vkDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 	}
 
 	void preparePipelines()
 	{
 		// Layout
 		VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = vks::initializers::pipelineLayoutCreateInfo(&m_vkDescriptorSetLayout, 1);
+		VkPushConstantRange pushConstantRange = vks::initializers::pushConstantRange(VK_SHADER_STAGE_VERTEX_BIT, sizeof(PushConsts), 0);
+		pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
 		VK_CHECK_RESULT(vkCreatePipelineLayout(m_vkDevice, &pipelineLayoutCreateInfo, nullptr, &m_vkPipelineLayout));
 
 		// Pipelines
@@ -305,21 +349,26 @@ public:
 		shaderStages[1] = loadShader(getShadersPath() + "occlusionquery/mesh.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCI, nullptr, &pipelines.solid));
 
-		// Basic pipeline for coloring occluded objects
-		shaderStages[0] = loadShader(getShadersPath() + "occlusionquery/simple.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
-		shaderStages[1] = loadShader(getShadersPath() + "occlusionquery/simple.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
-		rasterizationState.cullMode = VK_CULL_MODE_NONE;
-		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCI, nullptr, &pipelines.simple));
-
-		// Visual pipeline for the occluder
+		// Pipeline for the occluder, which is drawn opaque before all objects so it actually occludes them
 		shaderStages[0] = loadShader(getShadersPath() + "occlusionquery/occluder.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
 		shaderStages[1] = loadShader(getShadersPath() + "occlusionquery/occluder.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
-		// Enable blending
-		blendAttachmentState.blendEnable = VK_TRUE;
-		blendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
-		blendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_COLOR;
-		blendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR;
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCI, nullptr, &pipelines.occluder));
+
+		// Bounding box pipeline, only positions from the culler's unit cube
+		// Boxes must not occlude anything themselves, so neither depth nor color is written
+		VkVertexInputBindingDescription vertexInputBinding = vks::initializers::vertexInputBindingDescription(0, sizeof(float) * 3, VK_VERTEX_INPUT_RATE_VERTEX);
+		VkVertexInputAttributeDescription vertexInputAttribute = vks::initializers::vertexInputAttributeDescription(0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0);
+		VkPipelineVertexInputStateCreateInfo vertexInputState = vks::initializers::pipelineVertexInputStateCreateInfo();
+		vertexInputState.vertexBindingDescriptionCount = 1;
+		vertexInputState.pVertexBindingDescriptions = &vertexInputBinding;
+		vertexInputState.vertexAttributeDescriptionCount = 1;
+		vertexInputState.pVertexAttributeDescriptions = &vertexInputAttribute;
+		pipelineCI.pVertexInputState = &vertexInputState;
+		depthStencilState.depthWriteEnable = VK_FALSE;
+		blendAttachmentState.colorWriteMask = 0;
+		shaderStages[0] = loadShader(getShadersPath() + "occlusionquery/simple.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+		shaderStages[1] = loadShader(getShadersPath() + "occlusionquery/simple.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCI, nullptr, &pipelines.boundingBox));
 	}
 
 	// Prepare and initialize uniform buffer containing shader uniforms
@@ -329,62 +378,37 @@ public:
 		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(
 			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&uniformBuffers.occluder,
-			sizeof(uboVS)));
-
-		// Teapot
-		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&uniformBuffers.teapot,
-			sizeof(uboVS)));
-
-		// Sphere
-		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&uniformBuffers.sphere,
-			sizeof(uboVS)));
+			&uniformBuffer,
+			sizeof(uniformData)));
 
 		// Map persistent
-		VK_CHECK_RESULT(uniformBuffers.occluder.map());
-		VK_CHECK_RESULT(uniformBuffers.teapot.map());
-		VK_CHECK_RESULT(uniformBuffers.sphere.map());
+		VK_CHECK_RESULT(uniformBuffer.map());
 
 		updateUniformBuffers();
 	}
 
 	void updateUniformBuffers()
 	{
-		uboVS.projection = camera.matrices.perspective;
-		uboVS.view = camera.matrices.view;
-
-		// Occluder
-		uboVS.visible = 1.0f;
-		uboVS.model = glm::scale(glm::mat4(1.0f), glm::vec3(6.0f));
-		uboVS.color = glm::vec4(0.0f, 0.0f, 1.0f, 0.5f);
-		memcpy(uniformBuffers.occluder.mapped, &uboVS, sizeof(uboVS));
-
-		// Teapot
-		// Toggle color depending on visibility
-		uboVS.visible = (passedSamples[0] > 0) ? 1.0f : 0.0f;
-		uboVS.model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -3.0f));
-		uboVS.color = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
-		memcpy(uniformBuffers.teapot.mapped, &uboVS, sizeof(uboVS));
-
-		// Sphere
-		// Toggle color depending on visibility
-		uboVS.visible = (passedSamples[1] > 0) ? 1.0f : 0.0f;
-		uboVS.model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 3.0f));
-		uboVS.color = glm::vec4(0.0f, 1.0f, 0.0f, 1.0f);
-		memcpy(uniformBuffers.sphere.mapped, &uboVS, sizeof(uboVS));
+		uniformData.projection = camera.matrices.perspective;
+		uniformData.view = camera.matrices.view;
+		memcpy(uniformBuffer.mapped, &uniformData, sizeof(uniformData));
+	}
+
+	// Objects or culling mode changed
+	void changeScene()
+	{
+		vkDeviceWaitIdle(m_vkDevice);
+		prepareObjects();
+		prepareOcclusionCuller();
+		buildCommandBuffers();
 	}
 
 	void prepare()
 	{
 		VulkanExampleBase::prepare();
 		loadAssets();
-		setupQueryPool();
+		prepareObjects();
+		prepareOcclusionCuller();
 		prepareUniformBuffers();
 		setupDescriptors();
 		preparePipelines();
@@ -396,11 +420,18 @@ public:
 	{
 		updateUniformBuffers();
 		VulkanExampleBase::prepareFrame();
+		// Reads the results that are available without waiting for the GPU
+		if (cullingMode != CullingNone) {
+			occlusionCuller.update();
+		}
+		if (cullingMode == CullingHostReadback) {
+			const auto tStart = std::chrono::high_resolution_clock::now();
+			recordCommandBuffer(m_currentBufferIndex);
+			recordTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+		}
 		m_vkSubmitInfo.commandBufferCount = 1;
 		m_vkSubmitInfo.pCommandBuffers = &drawCmdBuffers[m_currentBufferIndex];
 		VK_CHECK_RESULT(vkQueueSubmit(m_vkQueue, 1, &m_vkSubmitInfo, VK_NULL_HANDLE));
-		// Read query results for displaying in next frame
-		getQueryResults();
 		VulkanExampleBase::submitFrame();
 	}
 
@@ -413,9 +444,38 @@ public:
 
 	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay)
 	{
-		if (overlay->header("Occlusion query results")) {
-			overlay->text("Teapot: %d samples passed", passedSamples[0]);
-			overlay->text("Sphere: %d samples passed", passedSamples[1]);
+		if (overlay->header("Settings")) {
+			std::vector<std::string> objectCountNames;
+			for (uint32_t objectCount : objectCounts) {
+				objectCountNames.push_back(std::to_string(objectCount));
+			}
+			if (overlay->comboBox("Objects", &objectCountIndex, objectCountNames)) {
+				changeScene();
+			}
+			std::vector<std::string> cullingModeNames = { "None", "Queries (host readback)" };
+			if (conditionalRenderingSupported) {
+				cullingModeNames.push_back("Queries (conditional rendering)");
+			}
+			if (overlay->comboBox("Occlusion culling", &cullingMode, cullingModeNames)) {
+				changeScene();
+			}
+			if (!conditionalRenderingSupported) {
+				overlay->text("Conditional rendering not supported");
+			}
+		}
+		if ((cullingMode != CullingNone) && overlay->header("Occlusion query results")) {
+			const vks::OcclusionCuller::Statistics& statistics = occlusionCuller.statistics;
+			overlay->text("Visible: %d of %d objects", statistics.visible, static_cast<uint32_t>(objects.size()));
+			overlay->text("Occluded: %d objects", statistics.occluded);
+			if (cullingMode == CullingHostReadback) {
+				overlay->text("Pending results: %d", statistics.pending);
+				overlay->text("Dropped frames: %d", static_cast<uint32_t>(statistics.droppedFrames));
+				overlay->text("Command buffer recording: %.3f ms", recordTime);
+			}
+			if (objects.size() == 2) {
+				overlay->text("Teapot: %s", occlusionCuller.visible(0) ? "visible" : "occluded");
+				overlay->text("Sphere: %s", occlusionCuller.visible(1) ? "visible" : "occluded");
+			}
 		}
 	}
 
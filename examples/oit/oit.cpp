@@ -1,5 +1,8 @@
 /*
-* Vulkan Example - Order Independent Transparency rendering using linked lists
+* Vulkan Example - Order Independent Transparency rendering using linked lists, weighted blending or k-buffers
+*
+* The linked list nodes are allocated from a pool with a fixed memory budget that doesn't depend on the resolution
+* Its size adapts to the fragment count of the last frames, fragments that don't fit are blended into an unsorted tail (weighted blended OIT)
 *
 * Copyright by Sascha Willems - www.saschawillems.de
 * Copyright by Daemyung Jang  - dm86.jang@gmail.com
@@ -10,7 +13,10 @@
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
 
-#define NODE_COUNT 20
+// Number of fragments stored per pixel in k-buffer mode
+#define KBUFFER_SIZE 4
+// Smallest linked list node pool, so the pool isn't reallocated for every small change of the view
+#define MIN_NODE_COUNT (1u << 20)
 
 class VulkanExample : public VulkanExampleBase
 {
@@ -20,25 +26,71 @@ public:
 		vkglTF::Model cube;
 	} models;
 
+	enum Mode : int32_t {
+		// Per pixel linked lists sorted in the resolve pass, exact up to the node budget
+		LinkedList = 0,
+		// Weighted average of all fragments, fixed memory but only an approximation
+		WeightedBlended = 1,
+		// The nearest KBUFFER_SIZE fragments of every pixel, fixed memory per pixel (requires 64 bit atomics)
+		KBuffer = 2
+	};
+	int32_t mode{ LinkedList };
+	const std::vector<std::string> modeNames = { "Linked lists", "Weighted blended", "K-buffer" };
+	bool kBufferSupported{ false };
+	// Modes can be left out by the device (k-buffer) or by missing shaders for the selected shading language
+	std::array<bool, 3> modeSupported{ true, false, false };
+
+	// Upper limit of the memory used by the linked list nodes
+	int32_t nodeBudgetMB{ 128 };
+	// Resize the node pool to the fragment count of the last frames (up to the budget)
+	bool adaptiveNodeCount{ true };
+	uint32_t nodeCount{ 0 };
+	uint32_t underusedFrames{ 0 };
+
+	// Color packed with 8 bits per channel
 	struct Node {
-		glm::vec4 color;
+		uint32_t color{ 0 };
 		float depth{ 0.0f };
 		uint32_t next{ 0 };
 	};
 
-	struct {
+	// Counters written by the shaders and read back by the host for the statistics
+	struct GeometrySBO {
 		uint32_t count{ 0 };
 		uint32_t maxNodeCount{ 0 };
-	} geometrySBO;
+		uint32_t width{ 0 };
+		uint32_t coveredPixels{ 0 };
+		uint32_t maxPixelCount{ 0 };
+		uint32_t overflowPixels{ 0 };
+	} geometryStats;
+
+	struct FrameBufferAttachment {
+		VkImage image{ VK_NULL_HANDLE };
+		VkDeviceMemory memory{ VK_NULL_HANDLE };
+		VkImageView view{ VK_NULL_HANDLE };
+	};
 
 	struct GeometryPass {
 		VkRenderPass renderPass{ VK_NULL_HANDLE };
 		VkFramebuffer framebuffer{ VK_NULL_HANDLE };
+		// Tail of the fragments that don't fit into the linked lists or k-buffers, also the targets of weighted blended OIT
+		FrameBufferAttachment accumulation;
+		FrameBufferAttachment revealage;
+		VkSampler sampler{ VK_NULL_HANDLE };
 		vks::Buffer geometry;
+		// Only allocated for the mode that uses them
 		vks::Texture headIndex;
 		vks::Buffer linkedList;
+		vks::Buffer kBuffer;
 	} geometryPass;
 
+	// Timestamps at the start and the end of every command buffer
+	VkQueryPool timestampQueryPool{ VK_NULL_HANDLE };
+	std::array<float, 3> frameTimes{};
+
+	// 64 bit buffer atomics for the k-buffer were introduced with Vulkan 1.2
+	VkPhysicalDeviceVulkan12Features enabledFeatures12{};
+
 	struct RenderPassUniformData {
 		glm::mat4 projection;
 		glm::mat4 view;
@@ -60,9 +112,10 @@ public:
 		VkPipelineLayout color{ VK_NULL_HANDLE };
 	} pipelineLayouts;
 
+	// One pipeline per mode
 	struct {
-		VkPipeline geometry{ VK_NULL_HANDLE };
-		VkPipeline color{ VK_NULL_HANDLE };
+		std::array<VkPipeline, 3> geometry{};
+		std::array<VkPipeline, 3> color{};
 	} pipelines;
 
 	struct {
@@ -79,18 +132,29 @@ public:
 		camera.setPosition(glm::vec3(0.0f, 0.0f, -6.0f));
 		camera.setRotation(glm::vec3(0.0f, 0.0f, 0.0f));
 		camera.setPerspective(60.0f, (float) m_drawAreaWidth / (float) m_drawAreaHeight, 0.1f, 256.0f);
+
+		m_requestedApiVersion = VK_API_VERSION_1_2;
 	}
 
 	~VulkanExample()
 	{
 		if (m_vkDevice) {
-			vkDestroyPipeline(m_vkDevice, pipelines.geometry, nullptr);
-			vkDestroyPipeline(m_vkDevice, pipelines.color, nullptr);
+			for (VkPipeline pipeline : pipelines.geometry) {
+				vkDestroyPipeline(m_vkDevice, pipeline, nullptr);
+			}
+			for (VkPipeline pipeline : pipelines.color) {
+				vkDestroyPipeline(m_vkDevice, pipeline, nullptr);
+			}
 			vkDestroyPipelineLayout(m_vkDevice, pipelineLayouts.geometry, nullptr);
 			vkDestroyPipelineLayout(m_vkDevice, pipelineLayouts.color, nullptr);
 			vkDestroyDescriptorSetLayout(m_vkDevice, descriptorSetLayouts.geometry, nullptr);
 			vkDestroyDescriptorSetLayout(m_vkDevice, descriptorSetLayouts.color, nullptr);
-			destroyGeometryPass();
+			destroyGeometryTargets();
+			destroyModeResources();
+			vkDestroyRenderPass(m_vkDevice, geometryPass.renderPass, nullptr);
+			vkDestroySampler(m_vkDevice, geometryPass.sampler, nullptr);
+			geometryPass.geometry.destroy();
+			vkDestroyQueryPool(m_vkDevice, timestampQueryPool, nullptr);
 			renderPassUniformBuffer.destroy();
 		}
 	}
@@ -103,6 +167,22 @@ public:
 		} else {
 			vks::tools::exitFatal("Selected GPU does not support stores and atomic operations in the fragment stage", VK_ERROR_FEATURE_NOT_PRESENT);
 		}
+
+		// The k-buffer inserts fragments with 64 bit atomics, that mode isn't available without them
+		VkPhysicalDeviceVulkan12Features supportedFeatures12{};
+		supportedFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		VkPhysicalDeviceFeatures2 physicalDeviceFeatures2{};
+		physicalDeviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		physicalDeviceFeatures2.pNext = &supportedFeatures12;
+		vkGetPhysicalDeviceFeatures2(m_vkPhysicalDevice, &physicalDeviceFeatures2);
+
+		kBufferSupported = m_vkPhysicalDeviceFeatures.shaderInt64 && supportedFeatures12.shaderBufferInt64Atomics;
+		enabledFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		if (kBufferSupported) {
+			m_vkPhysicalDeviceFeatures10.shaderInt64 = VK_TRUE;
+			enabledFeatures12.shaderBufferInt64Atomics = VK_TRUE;
+		}
+		m_deviceCreatepNextChain = &enabledFeatures12;
 	};
 
 	void loadAssets()
@@ -121,148 +201,317 @@ public:
 
 	void prepareGeometryPass()
 	{
+		// The geometry pass writes the unsorted tail of the fragments that don't fit (all fragments for weighted blending)
+		std::array<VkAttachmentDescription, 2> attachmentDescriptions{};
+		attachmentDescriptions[0].format = VK_FORMAT_R16G16B16A16_SFLOAT;
+		attachmentDescriptions[1].format = VK_FORMAT_R16_SFLOAT;
+		for (VkAttachmentDescription& attachmentDescription : attachmentDescriptions) {
+			attachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
+			attachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			attachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			attachmentDescription.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		}
+		std::array<VkAttachmentReference, 2> colorReferences = { {
+			{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+			{ 1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL }
+		} };
+
 		VkSubpassDescription subpassDescription = {};
 		subpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpassDescription.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
+		subpassDescription.pColorAttachments = colorReferences.data();
+
+		// The tail is read by the fragment shader of the color pass
+		std::array<VkSubpassDependency, 2> dependencies{};
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[1].srcSubpass = 0;
+		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-		// Geometry render pass doesn't need any output attachment.
 		VkRenderPassCreateInfo renderPassInfo = vks::initializers::renderPassCreateInfo();
-		renderPassInfo.attachmentCount = 0;
+		renderPassInfo.attachmentCount = static_cast<uint32_t>(attachmentDescriptions.size());
+		renderPassInfo.pAttachments = attachmentDescriptions.data();
 		renderPassInfo.subpassCount = 1;
 		renderPassInfo.pSubpasses = &subpassDescription;
+		renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+		renderPassInfo.pDependencies = dependencies.data();
 
 		VK_CHECK_RESULT(vkCreateRenderPass(m_vkDevice, &renderPassInfo, nullptr, &geometryPass.renderPass));
 
-		// Geometry frame buffer doesn't need any output attachment.
-		VkFramebufferCreateInfo fbufCreateInfo = vks::initializers::framebufferCreateInfo();
-		fbufCreateInfo.renderPass = geometryPass.renderPass;
-		fbufCreateInfo.attachmentCount = 0;
-		fbufCreateInfo.width = m_drawAreaWidth;
-		fbufCreateInfo.height = m_drawAreaHeight;
-		fbufCreateInfo.layers = 1;
-
-		VK_CHECK_RESULT(vkCreateFramebuffer(m_vkDevice, &fbufCreateInfo, nullptr, &geometryPass.framebuffer));
+		// The tail is fetched per pixel, so no filtering is required
+		VkSamplerCreateInfo samplerInfo = vks::initializers::samplerCreateInfo();
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.maxLod = 1.0f;
+		samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+		VK_CHECK_RESULT(vkCreateSampler(m_vkDevice, &samplerInfo, nullptr, &geometryPass.sampler));
 
 		// Create a buffer for GeometrySBO
-		vks::Buffer stagingBuffer;
-	
-		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&stagingBuffer,
-			sizeof(geometrySBO)));
-		VK_CHECK_RESULT(stagingBuffer.map());
-
+		// It's host visible, as the counters are read back after every frame for the statistics and to adapt the node pool
 		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(
 			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 			&geometryPass.geometry,
-			sizeof(geometrySBO)));
+			sizeof(GeometrySBO)));
+		VK_CHECK_RESULT(geometryPass.geometry.map());
+		memset(geometryPass.geometry.mapped, 0, sizeof(GeometrySBO));
 
-		// Set up GeometrySBO data.
-		geometrySBO.count = 0;
-		geometrySBO.maxNodeCount = NODE_COUNT * m_drawAreaWidth * m_drawAreaHeight;
-		memcpy(stagingBuffer.mapped, &geometrySBO, sizeof(geometrySBO));
+		// Start with the whole budget, the node pool shrinks to the actual demand after a few frames
+		nodeCount = nodeBudget();
 
-		// Copy data to m_vkDevice
-		VkCommandBuffer copyCmd = m_pVulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-		VkBufferCopy copyRegion = {};
-		copyRegion.size = sizeof(geometrySBO);
-		vkCmdCopyBuffer(copyCmd, stagingBuffer.buffer, geometryPass.geometry.buffer, 1, &copyRegion);
-		m_pVulkanDevice->flushCommandBuffer(copyCmd, m_vkQueue, true);
+		prepareGeometryTargets();
+		prepareModeResources();
+	}
 
-		stagingBuffer.destroy();
-		
-		// Create a texture for HeadIndex.
-		// This m_vkImage will track the head index of each fragment.
-		geometryPass.headIndex.device = m_pVulkanDevice;
+	// Number of linked list nodes that fit into the memory budget
+	uint32_t nodeBudget() const
+	{
+		return static_cast<uint32_t>((static_cast<VkDeviceSize>(nodeBudgetMB) * 1024 * 1024) / sizeof(Node));
+	}
 
+	void createAttachment(VkFormat format, FrameBufferAttachment& attachment)
+	{
 		VkImageCreateInfo imageInfo = vks::initializers::imageCreateInfo();
 		imageInfo.imageType = VK_IMAGE_TYPE_2D;
-		imageInfo.format = VK_FORMAT_R32_UINT;
+		imageInfo.format = format;
 		imageInfo.extent.width = m_drawAreaWidth;
 		imageInfo.extent.height = m_drawAreaHeight;
 		imageInfo.extent.depth = 1;
 		imageInfo.mipLevels = 1;
 		imageInfo.arrayLayers = 1;
 		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-#if (defined(VK_USE_PLATFORM_IOS_MVK) || defined(VK_USE_PLATFORM_MACOS_MVK) || defined(VK_USE_PLATFORM_METAL_EXT))
-		// SRS - On macOS/iOS use linear tiling for atomic m_vkImage access, see https://github.com/KhronosGroup/MoltenVK/issues/1027
-		imageInfo.tiling = VK_IMAGE_TILING_LINEAR;
-#else
 		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-#endif
-		imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
-
-		VK_CHECK_RESULT(vkCreateImage(m_vkDevice, &imageInfo, nullptr, &geometryPass.headIndex.image));
-
-		geometryPass.headIndex.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		VK_CHECK_RESULT(vkCreateImage(m_vkDevice, &imageInfo, nullptr, &attachment.image));
 
 		VkMemoryRequirements memReqs;
-		vkGetImageMemoryRequirements(m_vkDevice, geometryPass.headIndex.image, &memReqs);
-
+		vkGetImageMemoryRequirements(m_vkDevice, attachment.image, &memReqs);
 		VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
 		memAlloc.allocationSize = memReqs.size;
 		memAlloc.memoryTypeIndex = m_pVulkanDevice->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-		VK_CHECK_RESULT(vkAllocateMemory(m_vkDevice, &memAlloc, nullptr, &geometryPass.headIndex.deviceMemory));
-		VK_CHECK_RESULT(vkBindImageMemory(m_vkDevice, geometryPass.headIndex.image, geometryPass.headIndex.deviceMemory, 0));
+		VK_CHECK_RESULT(vkAllocateMemory(m_vkDevice, &memAlloc, nullptr, &attachment.memory));
+		VK_CHECK_RESULT(vkBindImageMemory(m_vkDevice, attachment.image, attachment.memory, 0));
 
 		VkImageViewCreateInfo imageViewInfo = vks::initializers::imageViewCreateInfo();
 		imageViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		imageViewInfo.format = VK_FORMAT_R32_UINT;
-		imageViewInfo.flags = 0;
-		imageViewInfo.image = geometryPass.headIndex.image;
-		imageViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		imageViewInfo.subresourceRange.baseMipLevel = 0;
-		imageViewInfo.subresourceRange.levelCount = 1;
-		imageViewInfo.subresourceRange.baseArrayLayer = 0;
-		imageViewInfo.subresourceRange.layerCount = 1;
-
-		VK_CHECK_RESULT(vkCreateImageView(m_vkDevice, &imageViewInfo, nullptr, &geometryPass.headIndex.view));
-
-		geometryPass.headIndex.width = m_drawAreaWidth;
-		geometryPass.headIndex.height = m_drawAreaHeight;
-		geometryPass.headIndex.mipLevels = 1;
-		geometryPass.headIndex.layerCount = 1;
-		geometryPass.headIndex.descriptor.imageView = geometryPass.headIndex.view;
-		geometryPass.headIndex.descriptor.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-		geometryPass.headIndex.sampler = VK_NULL_HANDLE;
-
-		// Create a buffer for LinkedListSBO
+		imageViewInfo.format = format;
+		imageViewInfo.image = attachment.image;
+		imageViewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		VK_CHECK_RESULT(vkCreateImageView(m_vkDevice, &imageViewInfo, nullptr, &attachment.view));
+	}
+
+	void destroyAttachment(FrameBufferAttachment& attachment)
+	{
+		vkDestroyImageView(m_vkDevice, attachment.view, nullptr);
+		vkDestroyImage(m_vkDevice, attachment.image, nullptr);
+		vkFreeMemory(m_vkDevice, attachment.memory, nullptr);
+		attachment = {};
+	}
+
+	// Tail targets and frame buffer, these depend on the resolution
+	void prepareGeometryTargets()
+	{
+		createAttachment(VK_FORMAT_R16G16B16A16_SFLOAT, geometryPass.accumulation);
+		createAttachment(VK_FORMAT_R16_SFLOAT, geometryPass.revealage);
+
+		std::array<VkImageView, 2> attachments = { geometryPass.accumulation.view, geometryPass.revealage.view };
+		VkFramebufferCreateInfo fbufCreateInfo = vks::initializers::framebufferCreateInfo();
+		fbufCreateInfo.renderPass = geometryPass.renderPass;
+		fbufCreateInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+		fbufCreateInfo.pAttachments = attachments.data();
+		fbufCreateInfo.width = m_drawAreaWidth;
+		fbufCreateInfo.height = m_drawAreaHeight;
+		fbufCreateInfo.layers = 1;
+		VK_CHECK_RESULT(vkCreateFramebuffer(m_vkDevice, &fbufCreateInfo, nullptr, &geometryPass.framebuffer));
+
+		// The k-buffer is addressed with the pixel position
+		GeometrySBO* geometrySBO = static_cast<GeometrySBO*>(geometryPass.geometry.mapped);
+		geometrySBO->width = m_drawAreaWidth;
+	}
+
+	void destroyGeometryTargets()
+	{
+		vkDestroyFramebuffer(m_vkDevice, geometryPass.framebuffer, nullptr);
+		destroyAttachment(geometryPass.accumulation);
+		destroyAttachment(geometryPass.revealage);
+	}
+
+	// Resources that are only used by the current mode, so switching to a lower memory mode actually frees memory
+	void prepareModeResources()
+	{
+		if (mode == LinkedList) {
+			createNodePool();
+		}
+		prepareModeTargets();
+	}
+
+	// Per pixel resources of the current mode, these depend on the resolution
+	void prepareModeTargets()
+	{
+		if (mode == LinkedList) {
+			// Create a texture for HeadIndex.
+			// This m_vkImage will track the head index of each fragment.
+			geometryPass.headIndex.device = m_pVulkanDevice;
+
+			VkImageCreateInfo imageInfo = vks::initializers::imageCreateInfo();
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.format = VK_FORMAT_R32_UINT;
+			imageInfo.extent.width = m_drawAreaWidth;
+			imageInfo.extent.height = m_drawAreaHeight;
+			imageInfo.extent.depth = 1;
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+#if (defined(VK_USE_PLATFORM_IOS_MVK) || defined(VK_USE_PLATFORM_MACOS_MVK) || defined(VK_USE_PLATFORM_METAL_EXT))
+			// SRS - On macOS/iOS use linear tiling for atomic m_vkImage access, see https://github.com/KhronosGroup/MoltenVK/issues/1027
+			imageInfo.tiling = VK_IMAGE_TILING_LINEAR;
+#else
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+#endif
+			imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+
+			VK_CHECK_RESULT(vkCreateImage(m_vkDevice, &imageInfo, nullptr, &geometryPass.headIndex.image));
+
+			geometryPass.headIndex.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+			VkMemoryRequirements memReqs;
+			vkGetImageMemoryRequirements(m_vkDevice, geometryPass.headIndex.image, &memReqs);
+
+			VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
+			memAlloc.allocationSize = memReqs.size;
+			memAlloc.memoryTypeIndex = m_pVulkanDevice->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+			VK_CHECK_RESULT(vkAllocateMemory(m_vkDevice, &memAlloc, nullptr, &geometryPass.headIndex.deviceMemory));
+			VK_CHECK_RESULT(vkBindImageMemory(m_vkDevice, geometryPass.headIndex.image, geometryPass.headIndex.deviceMemory, 0));
+
+			VkImageViewCreateInfo imageViewInfo = vks::initializers::imageViewCreateInfo();
+			imageViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			imageViewInfo.format = VK_FORMAT_R32_UINT;
+			imageViewInfo.flags = 0;
+			imageViewInfo.image = geometryPass.headIndex.image;
+			imageViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			imageViewInfo.subresourceRange.baseMipLevel = 0;
+			imageViewInfo.subresourceRange.levelCount = 1;
+			imageViewInfo.subresourceRange.baseArrayLayer = 0;
+			imageViewInfo.subresourceRange.layerCount = 1;
+
+			VK_CHECK_RESULT(vkCreateImageView(m_vkDevice, &imageViewInfo, nullptr, &geometryPass.headIndex.view));
+
+			geometryPass.headIndex.width = m_drawAreaWidth;
+			geometryPass.headIndex.height = m_drawAreaHeight;
+			geometryPass.headIndex.mipLevels = 1;
+			geometryPass.headIndex.layerCount = 1;
+			geometryPass.headIndex.descriptor.imageView = geometryPass.headIndex.view;
+			geometryPass.headIndex.descriptor.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+			geometryPass.headIndex.sampler = VK_NULL_HANDLE;
+
+			// Change HeadIndex m_vkImage's layout from UNDEFINED to GENERAL
+			VkCommandBuffer cmdBuf = m_pVulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+
+			VkImageMemoryBarrier barrier = vks::initializers::imageMemoryBarrier();
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+			barrier.image = geometryPass.headIndex.image;
+			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			barrier.subresourceRange.levelCount = 1;
+			barrier.subresourceRange.layerCount = 1;
+
+			vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+			m_pVulkanDevice->flushCommandBuffer(cmdBuf, m_vkQueue, true);
+		}
+
+		if (mode == KBuffer) {
+			// Create a buffer for the k-buffer, KBUFFER_SIZE fragments for every pixel
+			VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				&geometryPass.kBuffer,
+				static_cast<VkDeviceSize>(m_drawAreaWidth) * m_drawAreaHeight * KBUFFER_SIZE * sizeof(uint64_t)));
+		}
+	}
+
+	// Create a buffer for LinkedListSBO, its size only depends on the node count and not on the resolution
+	void createNodePool()
+	{
 		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(
 			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 			&geometryPass.linkedList,
-			sizeof(Node) * geometrySBO.maxNodeCount));
-
-		// Change HeadIndex m_vkImage's layout from UNDEFINED to GENERAL
-		VkCommandBufferAllocateInfo cmdBufAllocInfo = vks::initializers::commandBufferAllocateInfo(m_vkCommandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
-
-		VkCommandBuffer cmdBuf;
-		VK_CHECK_RESULT(vkAllocateCommandBuffers(m_vkDevice, &cmdBufAllocInfo, &cmdBuf));
+			sizeof(Node) * static_cast<VkDeviceSize>(nodeCount)));
 
-		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
-		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuf, &cmdBufInfo));
+		GeometrySBO* geometrySBO = static_cast<GeometrySBO*>(geometryPass.geometry.mapped);
+		geometrySBO->maxNodeCount = nodeCount;
+	}
 
-		VkImageMemoryBarrier barrier = vks::initializers::imageMemoryBarrier();
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
-		barrier.image = geometryPass.headIndex.image;
-		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		barrier.subresourceRange.levelCount = 1;
-		barrier.subresourceRange.layerCount = 1;
+	void destroyNodePool()
+	{
+		if (geometryPass.linkedList.buffer != VK_NULL_HANDLE) {
+			geometryPass.linkedList.destroy();
+			geometryPass.linkedList = {};
+		}
+	}
 
-		vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	void destroyModeTargets()
+	{
+		if (geometryPass.headIndex.image != VK_NULL_HANDLE) {
+			geometryPass.headIndex.destroy();
+			geometryPass.headIndex = {};
+		}
+		if (geometryPass.kBuffer.buffer != VK_NULL_HANDLE) {
+			geometryPass.kBuffer.destroy();
+			geometryPass.kBuffer = {};
+		}
+	}
 
-		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuf));
+	void destroyModeResources()
+	{
+		destroyNodePool();
+		destroyModeTargets();
+	}
 
-		VkSubmitInfo submitInfo = vks::initializers::submitInfo();
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &cmdBuf;
+	// Device memory used by a mode at the current resolution and node count
+	VkDeviceSize modeMemorySize(int32_t modeIndex) const
+	{
+		const VkDeviceSize pixelCount = static_cast<VkDeviceSize>(m_drawAreaWidth) * m_drawAreaHeight;
+		// Accumulation (RGBA16F) and revealage (R16F) targets are used by all modes
+		VkDeviceSize size = pixelCount * 5 * sizeof(uint16_t);
+		if (modeIndex == LinkedList) {
+			size += pixelCount * sizeof(uint32_t) + static_cast<VkDeviceSize>(nodeCount) * sizeof(Node);
+		}
+		if (modeIndex == KBuffer) {
+			size += pixelCount * KBUFFER_SIZE * sizeof(uint64_t);
+		}
+		return size;
+	}
 
-		VK_CHECK_RESULT(vkQueueSubmit(m_vkQueue, 1, &submitInfo, VK_NULL_HANDLE));
-		VK_CHECK_RESULT(vkQueueWaitIdle(m_vkQueue));
+	void setupQueryPool()
+	{
+		// Timestamps are used to measure the GPU time of the different modes
+		if (!m_pVulkanDevice->m_vkPhysicalDeviceProperties.limits.timestampComputeAndGraphics) {
+			return;
+		}
+		VkQueryPoolCreateInfo queryPoolCI{};
+		queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolCI.queryCount = static_cast<uint32_t>(drawCmdBuffers.size()) * 2;
+		VK_CHECK_RESULT(vkCreateQueryPool(m_vkDevice, &queryPoolCI, nullptr, &timestampQueryPool));
 	}
 
 	void setupDescriptors()
@@ -270,14 +519,15 @@ public:
 		// Pool
 		std::vector<VkDescriptorPoolSize> poolSizes = {
 			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1),
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1),
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6),
 			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2),
 		};
 		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::descriptorPoolCreateInfo(poolSizes, 2);
 		VK_CHECK_RESULT(vkCreateDescriptorPool(m_vkDevice, &descriptorPoolInfo, nullptr, &m_vkDescriptorPool));
 
 		// Layouts
+		// They contain the bindings of all modes, only those used by the current mode are written
 
 		// Create a geometry descriptor set layout
 		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
@@ -289,6 +539,8 @@ public:
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_FRAGMENT_BIT, 2),
 			// LinkedListSBO
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 3),
+			// KBufferSBO
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 4),
 		};
 		VkDescriptorSetLayoutCreateInfo descriptorLayoutCI = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
 		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(m_vkDevice, &descriptorLayoutCI, nullptr, &descriptorSetLayouts.geometry));
@@ -299,6 +551,13 @@ public:
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_FRAGMENT_BIT, 0),
 			// LinkedListSBO
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 1),
+			// KBufferSBO
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 2),
+			// Tail accumulation and revealage
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 3),
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 4),
+			// GeometrySBO for the per pixel statistics
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 5),
 		};
 		descriptorLayoutCI = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
 		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(m_vkDevice, &descriptorLayoutCI, nullptr, &descriptorSetLayouts.color));
@@ -308,7 +567,7 @@ public:
 
 	void updateDescriptors()
 	{
-		// Images and linked buffers are recreated on resize and part of the descriptors, so we need to update those at runtime
+		// Images and buffers are recreated on resize, mode changes and node pool changes and are part of the descriptors, so we need to update those at runtime
 		VkDescriptorSetAllocateInfo allocInfo = vks::initializers::descriptorSetAllocateInfo(m_vkDescriptorPool, &descriptorSetLayouts.geometry, 1);
 
 		// Update a geometry descriptor set
@@ -318,28 +577,54 @@ public:
 		std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
 			// Binding 0: renderPassUniformData
 			vks::initializers::writeDescriptorSet(descriptorSets.geometry, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &renderPassUniformBuffer.descriptor),
-			// Binding 2: GeometrySBO
+			// Binding 1: GeometrySBO
 			vks::initializers::writeDescriptorSet(descriptorSets.geometry, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &geometryPass.geometry.descriptor),
-			// Binding 3: headIndexImage
-			vks::initializers::writeDescriptorSet(descriptorSets.geometry, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2, &geometryPass.headIndex.descriptor),
-			// Binding 4: LinkedListSBO
-			vks::initializers::writeDescriptorSet(descriptorSets.geometry, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, &geometryPass.linkedList.descriptor)
 		};
+		if (mode == LinkedList) {
+			// Binding 2: headIndexImage
+			writeDescriptorSets.push_back(vks::initializers::writeDescriptorSet(descriptorSets.geometry, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2, &geometryPass.headIndex.descriptor));
+			// Binding 3: LinkedListSBO
+			writeDescriptorSets.push_back(vks::initializers::writeDescriptorSet(descriptorSets.geometry, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, &geometryPass.linkedList.descriptor));
+		}
+		if (mode == KBuffer) {
+			// Binding 4: KBufferSBO
+			writeDescriptorSets.push_back(vks::initializers::writeDescriptorSet(descriptorSets.geometry, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, &geometryPass.kBuffer.descriptor));
+		}
 		vkUpdateDescriptorSets(m_vkDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 
 		// Update a color descriptor set
 		allocInfo = vks::initializers::descriptorSetAllocateInfo(m_vkDescriptorPool, &descriptorSetLayouts.color, 1);
 		VK_CHECK_RESULT(vkAllocateDescriptorSets(m_vkDevice, &allocInfo, &descriptorSets.color));
 
+		VkDescriptorImageInfo accumulationDescriptor = vks::initializers::descriptorImageInfo(geometryPass.sampler, geometryPass.accumulation.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		VkDescriptorImageInfo revealageDescriptor = vks::initializers::descriptorImageInfo(geometryPass.sampler, geometryPass.revealage.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 		writeDescriptorSets = {
+			// Binding 3: Tail accumulation
+			vks::initializers::writeDescriptorSet(descriptorSets.color, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3, &accumulationDescriptor),
+			// Binding 4: Tail revealage
+			vks::initializers::writeDescriptorSet(descriptorSets.color, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4, &revealageDescriptor),
+			// Binding 5: GeometrySBO
+			vks::initializers::writeDescriptorSet(descriptorSets.color, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5, &geometryPass.geometry.descriptor),
+		};
+		if (mode == LinkedList) {
 			// Binding 0: headIndexImage
-			vks::initializers::writeDescriptorSet(descriptorSets.color, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0, &geometryPass.headIndex.descriptor),
+			writeDescriptorSets.push_back(vks::initializers::writeDescriptorSet(descriptorSets.color, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0, &geometryPass.headIndex.descriptor));
 			// Binding 1: LinkedListSBO
-			vks::initializers::writeDescriptorSet(descriptorSets.color, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &geometryPass.linkedList.descriptor)
-		};
+			writeDescriptorSets.push_back(vks::initializers::writeDescriptorSet(descriptorSets.color, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &geometryPass.linkedList.descriptor));
+		}
+		if (mode == KBuffer) {
+			// Binding 2: KBufferSBO
+			writeDescriptorSets.push_back(vks::initializers::writeDescriptorSet(descriptorSets.color, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &geometryPass.kBuffer.descriptor));
+		}
 		vkUpdateDescriptorSets(m_vkDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 	}
 
+	void resetDescriptors()
+	{
+		vkResetDescriptorPool(m_vkDevice, m_vkDescriptorPool, 0);
+		updateDescriptors();
+	}
+
 	void preparePipelines()
 	{
 		// Layouts
@@ -359,7 +644,16 @@ public:
 		// Pipelines
 		VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = vks::initializers::pipelineInputAssemblyStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 0, VK_FALSE);
 		VkPipelineRasterizationStateCreateInfo rasterizationState = vks::initializers::pipelineRasterizationStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE, 0);
-		VkPipelineColorBlendStateCreateInfo colorBlendState = vks::initializers::pipelineColorBlendStateCreateInfo(0, nullptr);
+		// The tail is accumulated additively in both targets, as the blend states are the same no independent blending is required
+		VkPipelineColorBlendAttachmentState tailBlendAttachmentState = vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_TRUE);
+		tailBlendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+		tailBlendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+		tailBlendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
+		tailBlendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		tailBlendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		tailBlendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
+		std::array<VkPipelineColorBlendAttachmentState, 2> tailBlendAttachmentStates = { tailBlendAttachmentState, tailBlendAttachmentState };
+		VkPipelineColorBlendStateCreateInfo colorBlendState = vks::initializers::pipelineColorBlendStateCreateInfo(static_cast<uint32_t>(tailBlendAttachmentStates.size()), tailBlendAttachmentStates.data());
 		VkPipelineDepthStencilStateCreateInfo depthStencilState = vks::initializers::pipelineDepthStencilStateCreateInfo(VK_FALSE, VK_FALSE, VK_COMPARE_OP_LESS_OR_EQUAL);
 		VkPipelineViewportStateCreateInfo viewportState = vks::initializers::pipelineViewportStateCreateInfo(1, 1, 0);
 		VkPipelineMultisampleStateCreateInfo multisampleState = vks::initializers::pipelineMultisampleStateCreateInfo(VK_SAMPLE_COUNT_1_BIT, 0);
@@ -367,6 +661,13 @@ public:
 		VkPipelineDynamicStateCreateInfo dynamicState = vks::initializers::pipelineDynamicStateCreateInfo(dynamicStateEnables);
 		std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages;
 
+		// Number of fragments per pixel of the k-buffer shaders
+		uint32_t kBufferSize = KBUFFER_SIZE;
+		VkSpecializationMapEntry specializationMapEntry = vks::initializers::specializationMapEntry(0, 0, sizeof(uint32_t));
+		VkSpecializationInfo specializationInfo = vks::initializers::specializationInfo(1, &specializationMapEntry, sizeof(uint32_t), &kBufferSize);
+
+		const std::array<std::string, 3> shaderNames = { "", "_weighted", "_kbuffer" };
+
 		VkGraphicsPipelineCreateInfo pipelineCI = vks::initializers::pipelineCreateInfo(pipelineLayouts.geometry, geometryPass.renderPass);
 		pipelineCI.pInputAssemblyState = &inputAssemblyState;
 		pipelineCI.pRasterizationState = &rasterizationState;
@@ -379,13 +680,29 @@ public:
 		pipelineCI.pStages = shaderStages.data();
 		pipelineCI.pVertexInputState = vkglTF::Vertex::getPipelineVertexInputState({ vkglTF::VertexComponent::Position });
 
-		// Create a geometry pipeline
-		shaderStages[0] = loadShader(getShadersPath() + "oit/geometry.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
-		shaderStages[1] = loadShader(getShadersPath() + "oit/geometry.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+		// The k-buffer shaders use 64 bit types, they can't even be loaded without support for them
+		for (int32_t i = WeightedBlended; i < static_cast<int32_t>(shaderNames.size()); i++) {
+			if ((i == KBuffer) && !kBufferSupported) {
+				continue;
+			}
+			modeSupported[i] = shaderExists(getShadersPath() + "oit/geometry" + shaderNames[i] + ".frag.spv") && shaderExists(getShadersPath() + "oit/color" + shaderNames[i] + ".frag.spv");
+			if (!modeSupported[i]) {
+				std::cerr << "Shaders for the " << modeNames[i] << " mode not found, the mode is disabled\n";
+			}
+		}
 
-		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCI, nullptr, &pipelines.geometry));
+		// Create the geometry pipelines
+		shaderStages[0] = loadShader(getShadersPath() + "oit/geometry.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+		for (int32_t i = 0; i < static_cast<int32_t>(shaderNames.size()); i++) {
+			if (!modeSupported[i]) {
+				continue;
+			}
+			shaderStages[1] = loadShader(getShadersPath() + "oit/geometry" + shaderNames[i] + ".frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+			shaderStages[1].pSpecializationInfo = (i == KBuffer) ? &specializationInfo : nullptr;
+			VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCI, nullptr, &pipelines.geometry[i]));
+		}
 
-		// Create a color pipeline
+		// Create the color pipelines
 		VkPipelineColorBlendAttachmentState blendAttachmentState = vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE);
 		colorBlendState = vks::initializers::pipelineColorBlendStateCreateInfo(1, &blendAttachmentState);
 
@@ -405,11 +722,17 @@ public:
 		pipelineCI.pVertexInputState = &vertexInputInfo;
 
 		shaderStages[0] = loadShader(getShadersPath() + "oit/color.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
-		shaderStages[1] = loadShader(getShadersPath() + "oit/color.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
 		rasterizationState.cullMode = VK_CULL_MODE_FRONT_BIT;
 		rasterizationState.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
 
-		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCI, nullptr, &pipelines.color));
+		for (int32_t i = 0; i < static_cast<int32_t>(shaderNames.size()); i++) {
+			if (!modeSupported[i]) {
+				continue;
+			}
+			shaderStages[1] = loadShader(getShadersPath() + "oit/color" + shaderNames[i] + ".frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+			shaderStages[1].pSpecializationInfo = (i == KBuffer) ? &specializationInfo : nullptr;
+			VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCI, nullptr, &pipelines.color[i]));
+		}
 	}
 
 	void buildCommandBuffers() override
@@ -423,6 +746,11 @@ public:
 		clearValues[0].color = m_vkClearColorValueDefault;
 		clearValues[1].depthStencil = { 1.0f, 0 };
 
+		// The tail starts empty, a revealage (sum of logarithms) of zero means the background is fully visible
+		VkClearValue tailClearValues[2];
+		tailClearValues[0].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+		tailClearValues[1].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+
 		VkRenderPassBeginInfo renderPassBeginInfo = vks::initializers::renderPassBeginInfo();
 		renderPassBeginInfo.renderArea.offset.x = 0;
 		renderPassBeginInfo.renderArea.offset.y = 0;
@@ -436,25 +764,38 @@ public:
 		{
 			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
 
+			if (timestampQueryPool != VK_NULL_HANDLE) {
+				vkCmdResetQueryPool(drawCmdBuffers[i], timestampQueryPool, i * 2, 2);
+				vkCmdWriteTimestamp(drawCmdBuffers[i], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, i * 2);
+			}
+
 			// Update dynamic viewport state
 			vkCmdSetViewport(drawCmdBuffers[i], 0, 1, &viewport);
 
 			// Update dynamic scissor state
 			vkCmdSetScissor(drawCmdBuffers[i], 0, 1, &scissor);
 
-			VkClearColorValue clearColor;
-			clearColor.uint32[0] = 0xffffffff;
+			if (mode == LinkedList) {
+				VkClearColorValue clearColor;
+				clearColor.uint32[0] = 0xffffffff;
 
-			VkImageSubresourceRange subresRange = {};
+				VkImageSubresourceRange subresRange = {};
 
-			subresRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			subresRange.levelCount = 1;
-			subresRange.layerCount = 1;
+				subresRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				subresRange.levelCount = 1;
+				subresRange.layerCount = 1;
 
-			vkCmdClearColorImage(drawCmdBuffers[i], geometryPass.headIndex.image, VK_IMAGE_LAYOUT_GENERAL, &clearColor, 1, &subresRange);
+				vkCmdClearColorImage(drawCmdBuffers[i], geometryPass.headIndex.image, VK_IMAGE_LAYOUT_GENERAL, &clearColor, 1, &subresRange);
+			}
 
-			// Clear previous geometry pass data
-			vkCmdFillBuffer(drawCmdBuffers[i], geometryPass.geometry.buffer, 0, sizeof(uint32_t), 0);
+			if (mode == KBuffer) {
+				// All bits set marks an empty slot, it compares as farther than any fragment
+				vkCmdFillBuffer(drawCmdBuffers[i], geometryPass.kBuffer.buffer, 0, VK_WHOLE_SIZE, 0xffffffff);
+			}
+
+			// Clear previous geometry pass data, the node count and the statistics
+			vkCmdFillBuffer(drawCmdBuffers[i], geometryPass.geometry.buffer, offsetof(GeometrySBO, count), sizeof(uint32_t), 0);
+			vkCmdFillBuffer(drawCmdBuffers[i], geometryPass.geometry.buffer, offsetof(GeometrySBO, coveredPixels), 3 * sizeof(uint32_t), 0);
 
 			// We need a barrier to make sure all writes are finished before starting to write again
 			VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
@@ -465,12 +806,11 @@ public:
 			// Begin the geometry render pass
 			renderPassBeginInfo.renderPass = geometryPass.renderPass;
 			renderPassBeginInfo.framebuffer = geometryPass.framebuffer;
-			renderPassBeginInfo.clearValueCount = 0;
-			renderPassBeginInfo.pClearValues = nullptr;
+			renderPassBeginInfo.clearValueCount = 2;
+			renderPassBeginInfo.pClearValues = tailClearValues;
 
 			vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.geometry);
-			uint32_t dynamicOffset = 0;
+			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.geometry[mode]);
 			models.sphere.bindBuffers(drawCmdBuffers[i]);
 
 			// Render the scene
@@ -506,10 +846,8 @@ public:
 
 			vkCmdEndRenderPass(drawCmdBuffers[i]);
 
-			// Make a pipeline barrier to guarantee the geometry pass is done
-			vkCmdPipelineBarrier(drawCmdBuffers[i], VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
-
 			// We need a barrier to make sure all writes are finished before starting to write again
+			// The tail targets are synchronized by the subpass dependency of the geometry render pass
 			memoryBarrier = vks::initializers::memoryBarrier();
 			memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
 			memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
@@ -522,12 +860,16 @@ public:
 			renderPassBeginInfo.pClearValues = clearValues;
 
 			vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.color);
+			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.color[mode]);
 			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.color, 0, 1, &descriptorSets.color, 0, nullptr);
 			vkCmdDraw(drawCmdBuffers[i], 3, 1, 0, 0);
 			drawUI(drawCmdBuffers[i]);
 			vkCmdEndRenderPass(drawCmdBuffers[i]);
 
+			if (timestampQueryPool != VK_NULL_HANDLE) {
+				vkCmdWriteTimestamp(drawCmdBuffers[i], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, i * 2 + 1);
+			}
+
 			VK_CHECK_RESULT(vkEndCommandBuffer(drawCmdBuffers[i]));
 		}
 	}
@@ -545,6 +887,7 @@ public:
 		loadAssets();
 		prepareUniformBuffers();
 		prepareGeometryPass();
+		setupQueryPool();
 		setupDescriptors();
 		preparePipelines();
 		buildCommandBuffers();
@@ -552,6 +895,55 @@ public:
 		m_prepared = true;
 	}
 
+	// Reads the counters and timestamps of the frame that has just been submitted
+	void getFrameStatistics()
+	{
+		memcpy(&geometryStats, geometryPass.geometry.mapped, sizeof(GeometrySBO));
+		if (timestampQueryPool == VK_NULL_HANDLE) {
+			return;
+		}
+		uint64_t results[4]{};
+		const VkResult result = vkGetQueryPoolResults(m_vkDevice, timestampQueryPool, m_currentBufferIndex * 2, 2, sizeof(results), results, sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		if ((result == VK_SUCCESS) && results[1] && results[3]) {
+			frameTimes[mode] = static_cast<float>(results[2] - results[0]) * m_pVulkanDevice->m_vkPhysicalDeviceProperties.limits.timestampPeriod / 1000000.0f;
+		}
+	}
+
+	// Grows the node pool when fragments didn't fit into it and shrinks it when most of it stayed unused for a while, within the memory budget
+	void adaptNodeCount()
+	{
+		if (mode != LinkedList) {
+			return;
+		}
+		const uint32_t budget = nodeBudget();
+		uint32_t newNodeCount = budget;
+		if (adaptiveNodeCount) {
+			// Some headroom, so the pool isn't resized again as soon as the view changes a bit
+			const uint64_t required = static_cast<uint64_t>(geometryStats.count) + geometryStats.count / 4;
+			newNodeCount = nodeCount;
+			if (geometryStats.count > nodeCount) {
+				newNodeCount = static_cast<uint32_t>(std::min<uint64_t>(required, budget));
+				underusedFrames = 0;
+			} else if (geometryStats.count < nodeCount / 4) {
+				if (++underusedFrames > 120) {
+					newNodeCount = static_cast<uint32_t>(required);
+					underusedFrames = 0;
+				}
+			} else {
+				underusedFrames = 0;
+			}
+			newNodeCount = std::min(std::max(newNodeCount, std::min(MIN_NODE_COUNT, budget)), budget);
+		}
+		if (newNodeCount != nodeCount) {
+			vkDeviceWaitIdle(m_vkDevice);
+			nodeCount = newNodeCount;
+			destroyNodePool();
+			createNodePool();
+			resetDescriptors();
+			buildCommandBuffers();
+		}
+	}
+
 	void draw()
 	{
 		VulkanExampleBase::prepareFrame();
@@ -559,6 +951,9 @@ public:
 		m_vkSubmitInfo.pCommandBuffers = &drawCmdBuffers[m_currentBufferIndex];
 		VK_CHECK_RESULT(vkQueueSubmit(m_vkQueue, 1, &m_vkSubmitInfo, VK_NULL_HANDLE));
 		VulkanExampleBase::submitFrame();
+		// The frame has finished, as submitFrame waits for the queue to become idle
+		getFrameStatistics();
+		adaptNodeCount();
 	}
 
 	void render() override
@@ -569,23 +964,69 @@ public:
 		draw();
 	}
 
-	void windowResized() override
+	void OnUpdateUIOverlay(vks::UIOverlay* overlay) override
 	{
-		destroyGeometryPass();
-		prepareGeometryPass();
-		vkResetDescriptorPool(m_vkDevice, m_vkDescriptorPool, 0);
-		updateDescriptors();
-		m_resized = false;
-		buildCommandBuffers();
+		if (overlay->header("Settings")) {
+			// Unsupported modes are left out, so the combo box index needs to be mapped to the mode
+			std::vector<std::string> availableModeNames;
+			std::vector<int32_t> availableModes;
+			int32_t modeIndex = 0;
+			for (int32_t i = 0; i < static_cast<int32_t>(modeNames.size()); i++) {
+				if (modeSupported[i]) {
+					if (i == mode) {
+						modeIndex = static_cast<int32_t>(availableModes.size());
+					}
+					availableModeNames.push_back(modeNames[i]);
+					availableModes.push_back(i);
+				}
+			}
+			if (overlay->comboBox("Mode", &modeIndex, availableModeNames)) {
+				mode = availableModes[modeIndex];
+				// Only the resources of the selected mode are kept, the command buffers are rebuilt by the base class
+				vkDeviceWaitIdle(m_vkDevice);
+				destroyModeResources();
+				prepareModeResources();
+				resetDescriptors();
+			}
+			if (mode == LinkedList) {
+				overlay->sliderInt("Node budget (MB)", &nodeBudgetMB, 16, 1024);
+				overlay->checkBox("Adapt node count", &adaptiveNodeCount);
+			}
+		}
+		if (overlay->header("Statistics")) {
+			if (mode != WeightedBlended) {
+				const float averageCount = (geometryStats.coveredPixels > 0) ? static_cast<float>(geometryStats.count) / geometryStats.coveredPixels : 0.0f;
+				overlay->text("Fragments: %u", geometryStats.count);
+				overlay->text("Per pixel: %.1f avg, %u max", averageCount, geometryStats.maxPixelCount);
+				overlay->text("Pixels with tail: %u", geometryStats.overflowPixels);
+			}
+			if (mode == LinkedList) {
+				overlay->text("Nodes: %u (%.1f MB)", nodeCount, static_cast<float>(nodeCount) * sizeof(Node) / (1024.0f * 1024.0f));
+			}
+			for (int32_t i = 0; i < static_cast<int32_t>(modeNames.size()); i++) {
+				if (!modeSupported[i]) {
+					continue;
+				}
+				const float memorySize = static_cast<float>(modeMemorySize(i)) / (1024.0f * 1024.0f);
+				if ((timestampQueryPool != VK_NULL_HANDLE) && (frameTimes[i] > 0.0f)) {
+					overlay->text("%s: %.1f MB, %.3f ms", modeNames[i].c_str(), memorySize, frameTimes[i]);
+				} else {
+					overlay->text("%s: %.1f MB", modeNames[i].c_str(), memorySize);
+				}
+			}
+		}
 	}
 
-	void destroyGeometryPass()
+	void windowResized() override
 	{
-		vkDestroyRenderPass(m_vkDevice, geometryPass.renderPass, nullptr);
-		vkDestroyFramebuffer(m_vkDevice, geometryPass.framebuffer, nullptr);
-		geometryPass.geometry.destroy();
-		geometryPass.headIndex.destroy();
-		geometryPass.linkedList.destroy();
+		// Only the resources depending on the resolution are recreated, the node pool keeps its size
+		destroyGeometryTargets();
+		prepareGeometryTargets();
+		destroyModeTargets();
+		prepareModeTargets();
+		resetDescriptors();
+		m_resized = false;
+		buildCommandBuffers();
 	}
 };
 
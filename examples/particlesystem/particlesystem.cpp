@@ -2,34 +2,24 @@
 * Vulkan Example - CPU based particle system
 * 
 * This sample renders a particle system that is updated on the host (by the CPU) and rendered by the GPU using a vertex buffer
+* The particles are simulated by vks::ParticleEngine, which updates them with SIMD kernels on all cores and writes them straight into the mapped vertex buffer
+* The particles are blended with premultiplied alpha, which depends on drawing order, so they are sorted back to front with a parallel radix sort and drawn through an index buffer
 *
-* Copyright (C) 2016-2023 by Sascha Willems - www.saschawillems.de
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
 *
 * This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
-
-#define PARTICLE_COUNT 512
+#include "ParticleEngine.h"
 
 #define FLAME_RADIUS 8.0f
 
 // The particle system is made from two different particle types
-// That type defines how a particle is rendered
-#define PARTICLE_TYPE_FLAME 0
-#define PARTICLE_TYPE_SMOKE 1
-
-struct Particle {
-	glm::vec4 pos;
-	glm::vec4 color;
-	float alpha;
-	float size;
-	float rotation;
-	uint32_t type;
-	glm::vec4 vel;
-	float rotationSpeed;
-};
+// That type defines how a particle is rendered, flame particles are the engine's primary particles, smoke particles its secondary particles
+#define PARTICLE_TYPE_FLAME vks::ParticleEngine::Primary
+#define PARTICLE_TYPE_SMOKE vks::ParticleEngine::Secondary
 
 class VulkanExample : public VulkanExampleBase
 {
@@ -61,8 +51,18 @@ public:
 		void *mappedMemory;
 		// Size of the particle buffer in bytes
 		size_t size{ 0 };
+		// Persistently mapped index buffer receiving the back to front drawing order
+		VkBuffer indexBuffer{ VK_NULL_HANDLE };
+		VkDeviceMemory indexMemory{ VK_NULL_HANDLE };
+		uint32_t* mappedIndices{ nullptr };
 	} particles;
 
+	vks::ParticleEngine particleEngine;
+	// The benchmark mode always simulates the largest number of particles
+	const std::vector<uint32_t> particleCounts = { 512, 65536, 262144, 1048576 };
+	int32_t particleCountIndex = 0;
+	bool sortParticles = true;
+
 	struct {
 		vks::Buffer particles;
 		vks::Buffer environment;
@@ -98,10 +98,6 @@ public:
 		VkDescriptorSet environment{ VK_NULL_HANDLE };
 	} descriptorSets;
 
-	std::vector<Particle> particleBuffer{};
-
-	std::default_random_engine rndEngine;
-
 	VulkanExample() : VulkanExampleBase()
 	{
 		title = "CPU based particle system";
@@ -110,7 +106,8 @@ public:
 		camera.setRotation(glm::vec3(-15.0f, 45.0f, 0.0f));
 		camera.setPerspective(60.0f, (float)m_drawAreaWidth / (float)m_drawAreaHeight, 1.0f, 256.0f);
 		timerSpeed *= 8.0f;
-		rndEngine.seed(m_benchmark.active ? 0 : (unsigned)time(nullptr));
+		particleEngine.seed = m_benchmark.active ? 0 : (uint64_t)time(nullptr);
+		setupParticleEngine();
 	}
 
 	~VulkanExample()
@@ -127,15 +124,17 @@ public:
 			vkDestroyPipelineLayout(m_vkDevice, m_vkPipelineLayout, nullptr);
 			vkDestroyDescriptorSetLayout(m_vkDevice, m_vkDescriptorSetLayout, nullptr);
 
-			vkUnmapMemory(m_vkDevice, particles.memory);
-			vkDestroyBuffer(m_vkDevice, particles.buffer, nullptr);
-			vkFreeMemory(m_vkDevice, particles.memory, nullptr);
+			destroyParticleBuffer();
 
 			uniformBuffers.environment.destroy();
 			uniformBuffers.particles.destroy();
 
 			vkDestroySampler(m_vkDevice, textures.particles.sampler, nullptr);
 		}
+		if (m_benchmark.active) {
+			std::cout << "Simulated " << particleEngine.count() << " particles at " << particleEngine.statistics.particlesPerMs << " particles/ms\n";
+			std::cout << "Depth sorting took " << particleEngine.statistics.sortMsPerMillion << " ms per million particles\n";
+		}
 	}
 
 	virtual void getEnabledFeatures()
@@ -185,11 +184,16 @@ public:
 			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.environment);
 			environment.draw(drawCmdBuffers[i]);
 
-			// Particle system (no index buffer)
+			// Particle system, drawn back to front through the sorted index buffer if enabled
 			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, 1, &descriptorSets.particles, 0, nullptr);
 			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.particles);
 			vkCmdBindVertexBuffers(drawCmdBuffers[i], 0, 1, &particles.buffer, offsets);
-			vkCmdDraw(drawCmdBuffers[i], static_cast<uint32_t>(particleBuffer.size()), 1, 0, 0);
+			if (sortParticles) {
+				vkCmdBindIndexBuffer(drawCmdBuffers[i], particles.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+				vkCmdDrawIndexed(drawCmdBuffers[i], particleEngine.count(), 1, 0, 0, 0);
+			} else {
+				vkCmdDraw(drawCmdBuffers[i], particleEngine.count(), 1, 0, 0);
+			}
 
 			drawUI(drawCmdBuffers[i]);
 
@@ -199,119 +203,111 @@ public:
 		}
 	}
 
-	float rnd(float range)
+	// The behaviour of the two particle types, rates are per second and velocities point up along the negative y axis
+	void setupParticleEngine()
 	{
-		std::uniform_real_distribution<float> rndDist(0.0f, range);
-		return rndDist(rndEngine);
+		vks::ParticleEngine::Settings& settings = particleEngine.settings;
+		settings.emitterPosition[0] = emitterPos.x;
+		settings.emitterPosition[1] = emitterPos.y;
+		settings.emitterPosition[2] = emitterPos.z;
+		settings.emitterRadius = FLAME_RADIUS;
+		settings.lifetimeAlpha = 2.0f;
+		// Flame particles have a chance of turning into smoke
+		settings.transitionChance = 0.05f;
+		settings.transitionPositionScale[0] = 0.5f;
+		settings.transitionPositionScale[2] = 0.5f;
+
+		vks::ParticleEngine::TypeSettings& flame = settings.types[PARTICLE_TYPE_FLAME];
+		flame.velocityScale = 0.45f * 3.5f;
+		flame.alphaRate = 0.45f * 2.5f;
+		flame.sizeRate = -0.45f * 0.5f;
+		flame.colorRate = 0.0f;
+		flame.rotationRate = 0.45f;
+		flame.velocityMin[1] = -maxVel.y;
+		flame.velocityMax[1] = -minVel.y;
+		flame.alphaMin = 0.0f;
+		flame.alphaMax = 0.75f;
+		flame.sizeMin = 1.0f;
+		flame.sizeMax = 1.5f;
+		flame.colorMin = flame.colorMax = 1.0f;
+		flame.rotationSpeedMin = -2.0f;
+		flame.rotationSpeedMax = 2.0f;
+
+		vks::ParticleEngine::TypeSettings& smoke = settings.types[PARTICLE_TYPE_SMOKE];
+		smoke.velocityScale = 1.0f;
+		smoke.alphaRate = 0.45f * 1.25f;
+		smoke.sizeRate = 0.45f * 0.125f;
+		smoke.colorRate = -0.45f * 0.05f;
+		smoke.rotationRate = 0.45f;
+		smoke.velocityMin[0] = smoke.velocityMin[2] = -1.0f;
+		smoke.velocityMax[0] = smoke.velocityMax[2] = 1.0f;
+		smoke.velocityMin[1] = -(minVel.y * 2.0f + maxVel.y - minVel.y);
+		smoke.velocityMax[1] = -(minVel.y * 2.0f);
+		smoke.alphaMin = smoke.alphaMax = 0.0f;
+		smoke.sizeMin = 1.0f;
+		smoke.sizeMax = 1.5f;
+		smoke.colorMin = 0.25f;
+		smoke.colorMax = 0.5f;
+		smoke.rotationSpeedMin = -1.0f;
+		smoke.rotationSpeedMax = 1.0f;
 	}
 
-	void initParticle(Particle *particle, glm::vec3 emitterPos)
-	{
-		particle->vel = glm::vec4(0.0f, minVel.y + rnd(maxVel.y - minVel.y), 0.0f, 0.0f);
-		particle->alpha = rnd(0.75f);
-		particle->size = 1.0f + rnd(0.5f);
-		particle->color = glm::vec4(1.0f);
-		particle->type = PARTICLE_TYPE_FLAME;
-		particle->rotation = rnd(2.0f * float(M_PI));
-		particle->rotationSpeed = rnd(2.0f) - rnd(2.0f);
-
-		// Get random sphere point
-		float theta = rnd(2.0f * float(M_PI));
-		float phi = rnd(float(M_PI)) - float(M_PI) / 2.0f;
-		float r = rnd(FLAME_RADIUS);
-
-		particle->pos.x = r * cos(theta) * cos(phi);
-		particle->pos.y = r * sin(phi);
-		particle->pos.z = r * sin(theta) * cos(phi);
-
-		particle->pos += glm::vec4(emitterPos, 0.0f);
-	}
-
-	// Change the type of a particle, e.g. from flame to smoke
-	void transitionParticle(Particle *particle)
-	{
-		switch (particle->type)
-		{
-		case PARTICLE_TYPE_FLAME:
-			// Flame particles have a chance of turning into smoke
-			if (rnd(1.0f) < 0.05f)
-			{
-				particle->alpha = 0.0f;
-				particle->color = glm::vec4(0.25f + rnd(0.25f));
-				particle->pos.x *= 0.5f;
-				particle->pos.z *= 0.5f;
-				particle->vel = glm::vec4(rnd(1.0f) - rnd(1.0f), (minVel.y * 2) + rnd(maxVel.y - minVel.y), rnd(1.0f) - rnd(1.0f), 0.0f);
-				particle->size = 1.0f + rnd(0.5f);
-				particle->rotationSpeed = rnd(1.0f) - rnd(1.0f);
-				particle->type = PARTICLE_TYPE_SMOKE;
-			}
-			else
-			{
-				initParticle(particle, emitterPos);
-			}
-			break;
-		case PARTICLE_TYPE_SMOKE:
-			// Respawn at end of life
-			initParticle(particle, emitterPos);
-			break;
-		}
-	}
-
-	// Initialize the particle system and create a vertex buffer for rendering the particles
+	// Initialize the particle system and create the persistently mapped vertex and index buffers the engine writes the particles and their drawing order to
 	void prepareParticles()
 	{
-		particleBuffer.resize(PARTICLE_COUNT);
-		for (auto& particle : particleBuffer)
-		{
-			initParticle(&particle, emitterPos);
-			particle.alpha = 1.0f - (abs(particle.pos.y) / (FLAME_RADIUS * 2.0f));
+		if (m_benchmark.active) {
+			particleCountIndex = static_cast<int32_t>(particleCounts.size()) - 1;
 		}
+		particleEngine.reset(particleCounts[particleCountIndex]);
 
-		particles.size = particleBuffer.size() * sizeof(Particle);
+		particles.size = particleEngine.count() * sizeof(vks::ParticleEngine::Vertex);
 
 		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(
 			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 			particles.size,
 			&particles.buffer,
-			&particles.memory,
-			particleBuffer.data()));
+			&particles.memory));
 
 		// Map the m_vkDeviceMemory and store the pointer for reuse
 		VK_CHECK_RESULT(vkMapMemory(m_vkDevice, particles.memory, 0, particles.size, 0, &particles.mappedMemory));
+
+		const VkDeviceSize indexBufferSize = particleEngine.count() * sizeof(uint32_t);
+		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			indexBufferSize,
+			&particles.indexBuffer,
+			&particles.indexMemory));
+		VK_CHECK_RESULT(vkMapMemory(m_vkDevice, particles.indexMemory, 0, indexBufferSize, 0, (void**)&particles.mappedIndices));
+
+		// Write the initial state
+		particleEngine.update(0.0f, particles.mappedMemory);
+		sortParticlesByDepth();
+	}
+
+	void destroyParticleBuffer()
+	{
+		vkUnmapMemory(m_vkDevice, particles.memory);
+		vkDestroyBuffer(m_vkDevice, particles.buffer, nullptr);
+		vkFreeMemory(m_vkDevice, particles.memory, nullptr);
+		vkUnmapMemory(m_vkDevice, particles.indexMemory);
+		vkDestroyBuffer(m_vkDevice, particles.indexBuffer, nullptr);
+		vkFreeMemory(m_vkDevice, particles.indexMemory, nullptr);
 	}
 
 	// Update the state of all particles
 	void updateParticles()
 	{
-		float particleTimer = m_frameTimer * 0.45f;
-		for (auto& particle : particleBuffer)
-		{
-			switch (particle.type)
-			{
-			case PARTICLE_TYPE_FLAME:
-				particle.pos.y -= particle.vel.y * particleTimer * 3.5f;
-				particle.alpha += particleTimer * 2.5f;
-				particle.size -= particleTimer * 0.5f;
-				break;
-			case PARTICLE_TYPE_SMOKE:
-				particle.pos -= particle.vel * m_frameTimer * 1.0f;
-				particle.alpha += particleTimer * 1.25f;
-				particle.size += particleTimer * 0.125f;
-				particle.color -= particleTimer * 0.05f;
-				break;
-			}
-			particle.rotation += particleTimer * particle.rotationSpeed;
-			// If a particle has faded out, turn it into the other type (e.g. flame to smoke and vice versa)
-			if (particle.alpha > 2.0f)
-			{
-				transitionParticle(&particle);
-			}
-		}
-		
-		// Copy the updated particles to the vertex buffer
-		size_t size = particleBuffer.size() * sizeof(Particle);
-		memcpy(particles.mappedMemory, particleBuffer.data(), size);
+		particleEngine.update(m_frameTimer, particles.mappedMemory);
+	}
+
+	// The camera looks down the negative z axis, so sorting by view space z in ascending order puts the farthest particles first
+	void sortParticlesByDepth()
+	{
+		const glm::mat4& view = camera.matrices.view;
+		const float depthPlane[4] = { view[0][2], view[1][2], view[2][2], view[3][2] };
+		particleEngine.sortByDepth(depthPlane, particles.mappedIndices);
 	}
 
 	void loadAssets()
@@ -444,15 +440,16 @@ public:
 		{
 			// Vertex input state
 			VkVertexInputBindingDescription vertexInputBinding =
-				vks::initializers::vertexInputBindingDescription(0, sizeof(Particle), VK_VERTEX_INPUT_RATE_VERTEX);
+				vks::initializers::vertexInputBindingDescription(0, sizeof(vks::ParticleEngine::Vertex), VK_VERTEX_INPUT_RATE_VERTEX);
 
+			using Vertex = vks::ParticleEngine::Vertex;
 			std::vector<VkVertexInputAttributeDescription> vertexInputAttributes = {
-				vks::initializers::vertexInputAttributeDescription(0, 0, VK_FORMAT_R32G32B32A32_SFLOAT,	offsetof(Particle, pos)),	// Location 0: Position
-				vks::initializers::vertexInputAttributeDescription(0, 1, VK_FORMAT_R32G32B32A32_SFLOAT,	offsetof(Particle, color)),	// Location 1: Color
-				vks::initializers::vertexInputAttributeDescription(0, 2, VK_FORMAT_R32_SFLOAT, offsetof(Particle, alpha)),			// Location 2: Alpha
-				vks::initializers::vertexInputAttributeDescription(0, 3, VK_FORMAT_R32_SFLOAT, offsetof(Particle, size)),			// Location 3: Size
-				vks::initializers::vertexInputAttributeDescription(0, 4, VK_FORMAT_R32_SFLOAT, offsetof(Particle, rotation)),		// Location 4: Rotation
-				vks::initializers::vertexInputAttributeDescription(0, 5, VK_FORMAT_R32_SINT, offsetof(Particle, type)),				// Location 5: Particle type
+				vks::initializers::vertexInputAttributeDescription(0, 0, VK_FORMAT_R32G32B32A32_SFLOAT,	offsetof(Vertex, position)),	// Location 0: Position
+				vks::initializers::vertexInputAttributeDescription(0, 1, VK_FORMAT_R32G32B32A32_SFLOAT,	offsetof(Vertex, color)),		// Location 1: Color
+				vks::initializers::vertexInputAttributeDescription(0, 2, VK_FORMAT_R32_SFLOAT, offsetof(Vertex, alpha)),				// Location 2: Alpha
+				vks::initializers::vertexInputAttributeDescription(0, 3, VK_FORMAT_R32_SFLOAT, offsetof(Vertex, size)),					// Location 3: Size
+				vks::initializers::vertexInputAttributeDescription(0, 4, VK_FORMAT_R32_SFLOAT, offsetof(Vertex, rotation)),				// Location 4: Rotation
+				vks::initializers::vertexInputAttributeDescription(0, 5, VK_FORMAT_R32_SINT, offsetof(Vertex, type)),					// Location 5: Particle type
 			};
 
 			VkPipelineVertexInputStateCreateInfo vertexInputState = vks::initializers::pipelineVertexInputStateCreateInfo();
@@ -558,8 +555,38 @@ public:
 		if (!paused) {
 			updateParticles();
 		}
+		// The order also changes with the camera, so it's updated even if the simulation is paused
+		if (sortParticles) {
+			sortParticlesByDepth();
+		}
 		draw();
 	}
+
+	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay)
+	{
+		if (overlay->header("Settings")) {
+			std::vector<std::string> countNames;
+			for (uint32_t count : particleCounts) {
+				countNames.push_back(std::to_string(count));
+			}
+			if (overlay->comboBox("Particles", &particleCountIndex, countNames)) {
+				vkDeviceWaitIdle(m_vkDevice);
+				destroyParticleBuffer();
+				prepareParticles();
+				buildCommandBuffers();
+			}
+			if (overlay->checkBox("Sort back to front", &sortParticles)) {
+				buildCommandBuffers();
+			}
+		}
+		if (overlay->header("Statistics")) {
+			overlay->text("Update: %.2f ms", particleEngine.statistics.updateTime);
+			overlay->text("%.0f particles/ms", particleEngine.statistics.particlesPerMs);
+			if (sortParticles) {
+				overlay->text("Sort: %.2f ms (%.2f ms per million)", particleEngine.statistics.sortTime, particleEngine.statistics.sortMsPerMillion);
+			}
+		}
+	}
 };
 
 VULKAN_EXAMPLE_MAIN()
@@ -1,27 +1,33 @@
 /*
 * Vulkan Example - Push descriptors
 *
-* Note: Requires a m_vkDevice that supports the VK_KHR_push_descriptor extension
+* Note: Push descriptors require a m_vkDevice that supports the VK_KHR_push_descriptor extension, devices without it fall back to another descriptor backend
 *
 * Push descriptors apply the push constants concept to descriptor sets. So instead of creating
 * per-model descriptor sets (along with a pool for each descriptor type) for rendering multiple objects,
 * this example uses push descriptors to pass descriptor sets for per-model textures and matrices
 * at command buffer creation time.
 *
+* The descriptors are written once against vks::DescriptorManager, which can also back them with pooled descriptor sets
+* or descriptor buffers (VK_EXT_descriptor_buffer). All backends supported by the device can be switched at runtime,
+* and a recording benchmark compares the CPU cost of binding descriptors with each of them.
+*
 * Copyright (C) 2018-2023 by Sascha Willems - www.saschawillems.de
 *
 * This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 
+#include <chrono>
+
 #include "vulkanexamplebase.h"
 #include "VulkanglTFModel.h"
+#include "VulkanDescriptorSets.h"
 
 class VulkanExample : public VulkanExampleBase
 {
 public:
 	bool animate = true;
 
-	PFN_vkCmdPushDescriptorSetKHR vkCmdPushDescriptorSetKHR{ VK_NULL_HANDLE };
 	VkPhysicalDevicePushDescriptorPropertiesKHR pushDescriptorProps{};
 
 	struct Cube {
@@ -40,9 +46,32 @@ public:
 	} uniformData;
 	vks::Buffer uniformBuffer;
 
-	VkPipeline m_vkPipeline{ VK_NULL_HANDLE };
-	VkPipelineLayout m_vkPipelineLayout{ VK_NULL_HANDLE };
-	VkDescriptorSetLayout m_vkDescriptorSetLayout{ VK_NULL_HANDLE };
+	// Every backend supported by the device gets its own descriptor manager, set layout and pipeline, so they can be switched and compared at runtime
+	// Indexed by vks::DescriptorBackend
+	struct Backend {
+		bool supported{ false };
+		vks::DescriptorManager descriptors;
+		VkDescriptorSetLayout descriptorSetLayout{ VK_NULL_HANDLE };
+		VkPipelineLayout pipelineLayout{ VK_NULL_HANDLE };
+		VkPipeline pipeline{ VK_NULL_HANDLE };
+		std::array<vks::DescriptorSet*, 2> cubeDescriptors{};
+		// Average CPU time of recording the benchmark command buffer in milliseconds
+		double recordTime{ 0.0 };
+	};
+	std::array<Backend, 3> backends;
+	// Backends available in the UI, selectedBackend indexes this list
+	std::vector<vks::DescriptorBackend> availableBackends;
+	std::vector<std::string> availableBackendNames;
+	int32_t selectedBackend{ 0 };
+
+	// The recording benchmark binds a descriptor set for each of these draws, alternating between the cubes
+	int32_t benchmarkDraws{ 10000 };
+	const uint32_t benchmarkRuns{ 10 };
+	bool benchmarkDone{ false };
+	VkCommandBuffer benchmarkCmdBuffer{ VK_NULL_HANDLE };
+
+	VkPhysicalDeviceBufferDeviceAddressFeatures enabledBufferDeviceAddressFeatures{};
+	VkPhysicalDeviceDescriptorBufferFeaturesEXT enabledDescriptorBufferFeatures{};
 
 	VulkanExample() : VulkanExampleBase()
 	{
@@ -51,18 +80,20 @@ public:
 		camera.setPerspective(60.0f, (float)m_drawAreaWidth / (float)m_drawAreaHeight, 0.1f, 512.0f);
 		camera.setRotation(glm::vec3(0.0f, 0.0f, 0.0f));
 		camera.setTranslation(glm::vec3(0.0f, 0.0f, -5.0f));
-		// Enable extension required for push descriptors
+		m_requestedApiVersion = VK_API_VERSION_1_1;
+		// The extensions of the descriptor backends are enabled if supported, see getEnabledExtensions
 		m_requestedInstanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
-		m_requestedDeviceExtensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
 	}
 
 	~VulkanExample()
 	{
 		if (m_vkDevice) {
-			vkDestroyPipeline(m_vkDevice, m_vkPipeline, nullptr);
-			vkDestroyPipelineLayout(m_vkDevice, m_vkPipelineLayout, nullptr);
-			vkDestroyDescriptorSetLayout(m_vkDevice, m_vkDescriptorSetLayout, nullptr);
-			for (auto cube : cubes) {
+			for (auto& backend : backends) {
+				vkDestroyPipeline(m_vkDevice, backend.pipeline, nullptr);
+				vkDestroyPipelineLayout(m_vkDevice, backend.pipelineLayout, nullptr);
+				backend.descriptors.destroy();
+			}
+			for (auto& cube : cubes) {
 				cube.uniformBuffer.destroy();
 				cube.texture.destroy();
 			}
@@ -77,6 +108,50 @@ public:
 		};
 	}
 
+	void getEnabledExtensions()
+	{
+		for (auto type : { vks::DescriptorBackend::Pooled, vks::DescriptorBackend::Push, vks::DescriptorBackend::Buffer }) {
+			Backend& backend = backends[static_cast<size_t>(type)];
+			backend.supported = vks::DescriptorManager::isSupported(m_pVulkanDevice, type);
+			if (!backend.supported) {
+				continue;
+			}
+			for (const char* extension : vks::DescriptorManager::getRequiredExtensions(type)) {
+				if (std::find_if(m_requestedDeviceExtensions.begin(), m_requestedDeviceExtensions.end(), [extension](const char* name) { return strcmp(name, extension) == 0; }) == m_requestedDeviceExtensions.end()) {
+					m_requestedDeviceExtensions.push_back(extension);
+				}
+			}
+		}
+		// Descriptor buffers also need their features and buffer device addresses enabled
+		if (backends[static_cast<size_t>(vks::DescriptorBackend::Buffer)].supported) {
+			enabledBufferDeviceAddressFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+			enabledBufferDeviceAddressFeatures.bufferDeviceAddress = VK_TRUE;
+			enabledDescriptorBufferFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT;
+			enabledDescriptorBufferFeatures.descriptorBuffer = VK_TRUE;
+			enabledDescriptorBufferFeatures.pNext = &enabledBufferDeviceAddressFeatures;
+			m_deviceCreatepNextChain = &enabledDescriptorBufferFeatures;
+		}
+	}
+
+	Backend& currentBackend()
+	{
+		return backends[static_cast<size_t>(availableBackends[selectedBackend])];
+	}
+
+	// Binds the descriptors of both cubes with the backend's manager and draws them
+	void drawCubes(VkCommandBuffer commandBuffer, const Backend& backend, uint32_t drawCount)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, backend.pipeline);
+		model.bindBuffers(commandBuffer);
+		// Only does something for descriptor buffers, which need to be bound once per command buffer
+		backend.descriptors.bindBuffers(commandBuffer);
+		for (uint32_t i = 0; i < drawCount; i++) {
+			// Depending on the backend this pushes the descriptors of the cube, binds its descriptor set or sets its offset into the descriptor buffer
+			backend.cubeDescriptors[i % cubes.size()]->bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, backend.pipelineLayout, 0);
+			model.draw(commandBuffer);
+		}
+	}
+
 	void buildCommandBuffers()
 	{
 		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
@@ -94,6 +169,8 @@ public:
 		renderPassBeginInfo.clearValueCount = 2;
 		renderPassBeginInfo.pClearValues = clearValues;
 
+		const Backend& backend = currentBackend();
+
 		for (int32_t i = 0; i < drawCmdBuffers.size(); ++i) {
 			renderPassBeginInfo.framebuffer = m_vkFrameBuffers[i];
 
@@ -101,60 +178,61 @@ public:
 
 			vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipeline);
-
 			VkViewport viewport = vks::initializers::viewport((float)m_drawAreaWidth, (float)m_drawAreaHeight, 0.0f, 1.0f);
 			vkCmdSetViewport(drawCmdBuffers[i], 0, 1, &viewport);
 
 			VkRect2D scissor = vks::initializers::rect2D(m_drawAreaWidth, m_drawAreaHeight, 0, 0);
 			vkCmdSetScissor(drawCmdBuffers[i], 0, 1, &scissor);
 
-			model.bindBuffers(drawCmdBuffers[i]);
-
-			// Render two cubes using different descriptor sets using push descriptors
-			for (const auto& cube : cubes) {
+			// Render two cubes using different descriptors
+			// With push descriptors there are no descriptor sets for the cubes, the descriptors are pushed inside of the command buffer
+			drawCubes(drawCmdBuffers[i], backend, static_cast<uint32_t>(cubes.size()));
 
-				// Instead of preparing the descriptor sets up-front, using push descriptors we can set (push) them inside of a command buffer
-				// This allows a more dynamic approach without the need to create descriptor sets for each model
-				// Note: dstSet for each descriptor set write is left at zero as this is ignored when using push descriptors
-
-				std::array<VkWriteDescriptorSet, 3> writeDescriptorSets{};
+			drawUI(drawCmdBuffers[i]);
 
-				// Scene matrices
-				writeDescriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-				writeDescriptorSets[0].dstSet = 0;
-				writeDescriptorSets[0].dstBinding = 0;
-				writeDescriptorSets[0].descriptorCount = 1;
-				writeDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-				writeDescriptorSets[0].pBufferInfo = &uniformBuffer.descriptor;
+			vkCmdEndRenderPass(drawCmdBuffers[i]);
 
-				// Model matrices
-				writeDescriptorSets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-				writeDescriptorSets[1].dstSet = 0;
-				writeDescriptorSets[1].dstBinding = 1;
-				writeDescriptorSets[1].descriptorCount = 1;
-				writeDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-				writeDescriptorSets[1].pBufferInfo = &cube.uniformBuffer.descriptor;
+			VK_CHECK_RESULT(vkEndCommandBuffer(drawCmdBuffers[i]));
+		}
+	}
 
-				// Texture
-				writeDescriptorSets[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-				writeDescriptorSets[2].dstSet = 0;
-				writeDescriptorSets[2].dstBinding = 2;
-				writeDescriptorSets[2].descriptorCount = 1;
-				writeDescriptorSets[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-				writeDescriptorSets[2].pImageInfo = &cube.texture.descriptor;
+	// Records the same number of descriptor binds and draws with every backend and measures the CPU time it takes
+	// The command buffer is never submitted, so this only compares the cost of recording
+	void runRecordingBenchmark()
+	{
+		if (benchmarkCmdBuffer == VK_NULL_HANDLE) {
+			VkCommandBufferAllocateInfo cmdBufAllocateInfo = vks::initializers::commandBufferAllocateInfo(m_vkCommandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+			VK_CHECK_RESULT(vkAllocateCommandBuffers(m_vkDevice, &cmdBufAllocateInfo, &benchmarkCmdBuffer));
+		}
 
-				vkCmdPushDescriptorSetKHR(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, 3, writeDescriptorSets.data());
+		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
+		cmdBufInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VkClearValue clearValues[2];
+		clearValues[0].color = m_vkClearColorValueDefault;
+		clearValues[1].depthStencil = { 1.0f, 0 };
+		VkRenderPassBeginInfo renderPassBeginInfo = vks::initializers::renderPassBeginInfo();
+		renderPassBeginInfo.renderPass = m_vkRenderPass;
+		renderPassBeginInfo.framebuffer = m_vkFrameBuffers[0];
+		renderPassBeginInfo.renderArea.extent.width = m_drawAreaWidth;
+		renderPassBeginInfo.renderArea.extent.height = m_drawAreaHeight;
+		renderPassBeginInfo.clearValueCount = 2;
+		renderPassBeginInfo.pClearValues = clearValues;
 
-				model.draw(drawCmdBuffers[i]);
+		for (auto type : availableBackends) {
+			Backend& backend = backends[static_cast<size_t>(type)];
+			double totalTime = 0.0;
+			for (uint32_t run = 0; run < benchmarkRuns; run++) {
+				const auto tStart = std::chrono::high_resolution_clock::now();
+				VK_CHECK_RESULT(vkBeginCommandBuffer(benchmarkCmdBuffer, &cmdBufInfo));
+				vkCmdBeginRenderPass(benchmarkCmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+				drawCubes(benchmarkCmdBuffer, backend, static_cast<uint32_t>(benchmarkDraws));
+				vkCmdEndRenderPass(benchmarkCmdBuffer);
+				VK_CHECK_RESULT(vkEndCommandBuffer(benchmarkCmdBuffer));
+				totalTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
 			}
-
-			drawUI(drawCmdBuffers[i]);
-
-			vkCmdEndRenderPass(drawCmdBuffers[i]);
-
-			VK_CHECK_RESULT(vkEndCommandBuffer(drawCmdBuffers[i]));
+			backend.recordTime = totalTime / static_cast<double>(benchmarkRuns);
 		}
+		benchmarkDone = true;
 	}
 
 	void loadAssets()
@@ -165,29 +243,31 @@ public:
 		cubes[1].texture.loadFromFile(getAssetPath() + "textures/crate02_color_height_rgba.ktx", VK_FORMAT_R8G8B8A8_UNORM, m_pVulkanDevice, m_vkQueue);
 	}
 
-	void setupDescriptorSetLayout()
+	// The descriptors of the cubes are written once for each backend, the managers take care of layout flags, pools and descriptor memory
+	void setupDescriptors(Backend& backend)
 	{
 		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0),
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1),
 			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 2),
 		};
-
-		VkDescriptorSetLayoutCreateInfo descriptorLayoutCI{};
-		descriptorLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-		// Setting this flag tells the descriptor set layouts that no actual descriptor sets are allocated but instead pushed at command buffer creation time
-		descriptorLayoutCI.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
-		descriptorLayoutCI.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
-		descriptorLayoutCI.pBindings = setLayoutBindings.data();
-		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(m_vkDevice, &descriptorLayoutCI, nullptr, &m_vkDescriptorSetLayout));
-
+		backend.descriptorSetLayout = backend.descriptors.createSetLayout(setLayoutBindings);
+
+		for (size_t i = 0; i < cubes.size(); i++) {
+			// Descriptor buffers store the buffer ranges, so they're passed explicitly instead of VK_WHOLE_SIZE
+			backend.cubeDescriptors[i] = backend.descriptors.allocate(backend.descriptorSetLayout);
+			backend.cubeDescriptors[i]->writeBuffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, { uniformBuffer.buffer, 0, sizeof(UniformData) })
+				.writeBuffer(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, { cubes[i].uniformBuffer.buffer, 0, sizeof(glm::mat4) })
+				.writeImage(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, cubes[i].texture.descriptor);
+			backend.cubeDescriptors[i]->update();
+		}
 	}
 
-	void preparePipelines()
+	void preparePipelines(Backend& backend)
 	{
 		// Layout
-		VkPipelineLayoutCreateInfo pipelineLayoutCI = vks::initializers::pipelineLayoutCreateInfo(&m_vkDescriptorSetLayout, 1);
-		VK_CHECK_RESULT(vkCreatePipelineLayout(m_vkDevice, &pipelineLayoutCI, nullptr, &m_vkPipelineLayout));
+		VkPipelineLayoutCreateInfo pipelineLayoutCI = vks::initializers::pipelineLayoutCreateInfo(&backend.descriptorSetLayout, 1);
+		VK_CHECK_RESULT(vkCreatePipelineLayout(m_vkDevice, &pipelineLayoutCI, nullptr, &backend.pipelineLayout));
 
 		// Pipeline
 		VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCI = vks::initializers::pipelineInputAssemblyStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 0, VK_FALSE);
@@ -201,7 +281,7 @@ public:
 		VkPipelineDynamicStateCreateInfo dynamicStateCI = vks::initializers::pipelineDynamicStateCreateInfo(dynamicStateEnables);
 		std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages;
 
-		VkGraphicsPipelineCreateInfo pipelineCI  = vks::initializers::pipelineCreateInfo(m_vkPipelineLayout, m_vkRenderPass, 0);
+		VkGraphicsPipelineCreateInfo pipelineCI  = vks::initializers::pipelineCreateInfo(backend.pipelineLayout, m_vkRenderPass, 0);
 		pipelineCI.pInputAssemblyState = &inputAssemblyStateCI;
 		pipelineCI.pRasterizationState = &rasterizationStateCI;
 		pipelineCI.pColorBlendState = &colorBlendStateCI;
@@ -212,21 +292,43 @@ public:
 		pipelineCI.stageCount = static_cast<uint32_t>(shaderStages.size());
 		pipelineCI.pStages = shaderStages.data();
 		pipelineCI.pVertexInputState = vkglTF::Vertex::getPipelineVertexInputState({vkglTF::VertexComponent::Position, vkglTF::VertexComponent::Normal, vkglTF::VertexComponent::UV, vkglTF::VertexComponent::Color});
+		// Pipelines using descriptor buffers need to be created with a special flag
+		pipelineCI.flags = backend.descriptors.getPipelineCreateFlags();
 
 		shaderStages[0] = loadShader(getShadersPath() + "pushdescriptors/cube.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
 		shaderStages[1] = loadShader(getShadersPath() + "pushdescriptors/cube.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
-		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCI, nullptr, &m_vkPipeline));
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCI, nullptr, &backend.pipeline));
+	}
+
+	void prepareBackends()
+	{
+		for (auto type : { vks::DescriptorBackend::Push, vks::DescriptorBackend::Buffer, vks::DescriptorBackend::Pooled }) {
+			Backend& backend = backends[static_cast<size_t>(type)];
+			if (!backend.supported) {
+				continue;
+			}
+			backend.descriptors.create(m_pVulkanDevice, type);
+			setupDescriptors(backend);
+			preparePipelines(backend);
+			availableBackends.push_back(type);
+			availableBackendNames.push_back(vks::DescriptorManager::getBackendName(type));
+		}
+		// Push descriptors are preferred (if supported), as they come first in the list
+		selectedBackend = 0;
 	}
 
 	void prepareUniformBuffers()
 	{
+		// Buffers referenced from descriptor buffers are addressed by their device address
+		const VkBufferUsageFlags usageFlags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | (backends[static_cast<size_t>(vks::DescriptorBackend::Buffer)].supported ? VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT : 0);
+
 		// Vertex shader scene uniform buffer block
-		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &uniformBuffer, sizeof(UniformData)));
+		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(usageFlags, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &uniformBuffer, sizeof(UniformData)));
 		VK_CHECK_RESULT(uniformBuffer.map());
 
 		// Vertex shader cube model uniform buffer blocks
 		for (auto& cube : cubes) {
-			VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &cube.uniformBuffer, sizeof(glm::mat4)));
+			VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(usageFlags, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &cube.uniformBuffer, sizeof(glm::mat4)));
 			VK_CHECK_RESULT(cube.uniformBuffer.map());
 		}
 
@@ -268,35 +370,18 @@ public:
 	{
 		VulkanExampleBase::prepare();
 
-		/*
-			Extension specific functions
-		*/
-
-		// The push descriptor update function is part of an extension so it has to be manually loaded
-		vkCmdPushDescriptorSetKHR = (PFN_vkCmdPushDescriptorSetKHR)vkGetDeviceProcAddr(m_vkDevice, "vkCmdPushDescriptorSetKHR");
-		if (!vkCmdPushDescriptorSetKHR) {
-			vks::tools::exitFatal("Could not get a valid function pointer for vkCmdPushDescriptorSetKHR", -1);
-		}
-
 		// Get m_vkDevice push descriptor m_vkPhysicalDeviceProperties (to display them)
-		PFN_vkGetPhysicalDeviceProperties2KHR vkGetPhysicalDeviceProperties2KHR = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2KHR>(vkGetInstanceProcAddr(m_vulkanInstance, "vkGetPhysicalDeviceProperties2KHR"));
-		if (!vkGetPhysicalDeviceProperties2KHR) {
-			vks::tools::exitFatal("Could not get a valid function pointer for vkGetPhysicalDeviceProperties2KHR", -1);
+		if (backends[static_cast<size_t>(vks::DescriptorBackend::Push)].supported) {
+			VkPhysicalDeviceProperties2 deviceProps2{};
+			pushDescriptorProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR;
+			deviceProps2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+			deviceProps2.pNext = &pushDescriptorProps;
+			vkGetPhysicalDeviceProperties2(m_vkPhysicalDevice, &deviceProps2);
 		}
-		VkPhysicalDeviceProperties2KHR deviceProps2{};
-		pushDescriptorProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR;
-		deviceProps2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
-		deviceProps2.pNext = &pushDescriptorProps;
-		vkGetPhysicalDeviceProperties2KHR(m_vkPhysicalDevice, &deviceProps2);
-
-		/*
-			End of extension specific functions
-		*/
 
 		loadAssets();
 		prepareUniformBuffers();
-		setupDescriptorSetLayout();
-		preparePipelines();
+		prepareBackends();
 		buildCommandBuffers();
 		m_prepared = true;
 	}
@@ -325,6 +410,26 @@ public:
 	{
 		if (overlay->header("Settings")) {
 			overlay->checkBox("Animate", &animate);
+			// Command buffers are rebuilt by the base class, all backends have been prepared up front
+			overlay->comboBox("Descriptors", &selectedBackend, availableBackendNames);
+			const Backend& backend = currentBackend();
+			if (backend.descriptors.getBackend() == vks::DescriptorBackend::Pooled) {
+				overlay->text("%d sets in %d pool(s)", backend.descriptors.getSetCount(), backend.descriptors.getPoolCount());
+			}
+			if (backend.descriptors.getBackend() == vks::DescriptorBackend::Buffer) {
+				overlay->text("%d sets in %d bytes of descriptor buffers", backend.descriptors.getSetCount(), static_cast<int32_t>(backend.descriptors.getBufferUsage()));
+			}
+		}
+		if (overlay->header("Recording benchmark")) {
+			overlay->sliderInt("Draws", &benchmarkDraws, 1000, 100000);
+			if (overlay->button("Run")) {
+				runRecordingBenchmark();
+			}
+			if (benchmarkDone) {
+				for (auto type : availableBackends) {
+					overlay->text("%s: %.3f ms", vks::DescriptorManager::getBackendName(type), backends[static_cast<size_t>(type)].recordTime);
+				}
+			}
 		}
 		if (overlay->header("Device m_vkPhysicalDeviceProperties")) {
 			overlay->text("maxPushDescriptors: %d", pushDescriptorProps.maxPushDescriptors);
@@ -7,14 +7,21 @@
  */
 
 #include "VulkanRaytracingSample.h"
+#include "VulkanAccelerationStructureBuilder.h"
 #define VK_GLTF_MATERIAL_IDS
 #include "VulkanglTFModel.h"
 
 class VulkanExample : public VulkanRaytracingSample
 {
 public:
-	AccelerationStructure bottomLevelAS{};
-	AccelerationStructure topLevelAS{};
+	// Builds the acceleration structures in batches with a shared scratch buffer and compacts the bottom level structure
+	vks::AccelerationStructureBuilder accelerationStructureBuilder;
+	uint32_t bottomLevelAS{ 0 };
+	uint32_t topLevelAS{ 0 };
+	vks::Buffer instancesBuffer;
+	// Models with skinned animations are skinned in a compute pass every frame and the acceleration structures are refit instead of rebuilt
+	bool animated{ false };
+	float animationTime{ 0.0f };
 
 	vks::Buffer vertexBuffer;
 	vks::Buffer indexBuffer;
@@ -78,8 +85,8 @@ public:
 			vkDestroyPipelineLayout(m_vkDevice, m_vkPipelineLayout, nullptr);
 			vkDestroyDescriptorSetLayout(m_vkDevice, m_vkDescriptorSetLayout, nullptr);
 			deleteStorageImage();
-			deleteAccelerationStructure(bottomLevelAS);
-			deleteAccelerationStructure(topLevelAS);
+			accelerationStructureBuilder.destroy();
+			instancesBuffer.destroy();
 			vertexBuffer.destroy();
 			indexBuffer.destroy();
 			transformBuffer.destroy();
@@ -91,40 +98,19 @@ public:
 		}
 	}
 
-	void createAccelerationStructureBuffer(AccelerationStructure &accelerationStructure, VkAccelerationStructureBuildSizesInfoKHR buildSizeInfo)
-	{
-		VkBufferCreateInfo bufferCreateInfo{};
-		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferCreateInfo.size = buildSizeInfo.accelerationStructureSize;
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
-		VK_CHECK_RESULT(vkCreateBuffer(m_vkDevice, &bufferCreateInfo, nullptr, &accelerationStructure.buffer));
-		VkMemoryRequirements memoryRequirements{};
-		vkGetBufferMemoryRequirements(m_vkDevice, accelerationStructure.buffer, &memoryRequirements);
-		VkMemoryAllocateFlagsInfo memoryAllocateFlagsInfo{};
-		memoryAllocateFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
-		memoryAllocateFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR;
-		VkMemoryAllocateInfo memoryAllocateInfo{};
-		memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		memoryAllocateInfo.pNext = &memoryAllocateFlagsInfo;
-		memoryAllocateInfo.allocationSize = memoryRequirements.size;
-		memoryAllocateInfo.memoryTypeIndex = m_pVulkanDevice->getMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(m_vkDevice, &memoryAllocateInfo, nullptr, &accelerationStructure.memory));
-		VK_CHECK_RESULT(vkBindBufferMemory(m_vkDevice, accelerationStructure.buffer, accelerationStructure.memory, 0));
-	}
-
 	/*
 		Create the bottom level acceleration structure that contains the scene's actual geometry (vertices, triangles)
 	*/
 	void createBottomLevelAccelerationStructure()
 	{
-		// Use transform matrices from the glTF nodes
+		// Use transform matrices from the glTF nodes, animated models are built from the skinned positions that already are in model space
 		std::vector<VkTransformMatrixKHR> transformMatrices{};
 		for (auto node : model.linearNodes) {
 			if (node->mesh) {
 				for (auto primitive : node->mesh->primitives) {
 					if (primitive->indexCount > 0) {
 						VkTransformMatrixKHR transformMatrix{};
-						auto m = glm::mat3x4(glm::transpose(node->getMatrix()));
+						auto m = glm::mat3x4(glm::transpose(animated ? glm::mat4(1.0f) : node->getMatrix()));
 						memcpy(&transformMatrix, (void*)&m, sizeof(glm::mat3x4));
 						transformMatrices.push_back(transformMatrix);
 					}
@@ -142,10 +128,8 @@ public:
 		
 		// Build
 		// One geometry per glTF node, so we can index materials using gl_GeometryIndexEXT
-		std::vector<uint32_t> maxPrimitiveCounts{};
 		std::vector<VkAccelerationStructureGeometryKHR> geometries{};
 		std::vector<VkAccelerationStructureBuildRangeInfoKHR> buildRangeInfos{};
-		std::vector<VkAccelerationStructureBuildRangeInfoKHR*> pBuildRangeInfos{};
 		std::vector<GeometryNode> geometryNodes{};
 		for (auto node : model.linearNodes) {
 			if (node->mesh) {
@@ -168,11 +152,15 @@ public:
 						geometry.geometry.triangles.maxVertex = model.vertices.count;
 						//geometry.geometry.triangles.maxVertex = primitive->vertexCount;
 						geometry.geometry.triangles.vertexStride = sizeof(vkglTF::Vertex);
+						if (animated) {
+							// Positions written by the skinning pass, tightly packed
+							geometry.geometry.triangles.vertexData.deviceAddress = getBufferDeviceAddress(model.skinning.positions.buffer);
+							geometry.geometry.triangles.vertexStride = sizeof(glm::vec3);
+						}
 						geometry.geometry.triangles.indexType = VK_INDEX_TYPE_UINT32;
 						geometry.geometry.triangles.indexData = indexBufferDeviceAddress;
 						geometry.geometry.triangles.transformData = transformBufferDeviceAddress;
 						geometries.push_back(geometry);
-						maxPrimitiveCounts.push_back(primitive->indexCount / 3);
 
 						VkAccelerationStructureBuildRangeInfoKHR buildRangeInfo{};
 						buildRangeInfo.firstVertex = 0;
@@ -191,9 +179,6 @@ public:
 				}
 			}
 		}
-		for (auto& rangeInfo : buildRangeInfos) {
-			pBuildRangeInfos.push_back(&rangeInfo);
-		}
 
 		vks::Buffer stagingBuffer;
 
@@ -213,58 +198,12 @@ public:
 		m_pVulkanDevice->copyBuffer(&stagingBuffer, &geometryNodesBuffer, m_vkQueue);
 
 		stagingBuffer.destroy();
-	
-		// Get size info
-		VkAccelerationStructureBuildGeometryInfoKHR accelerationStructureBuildGeometryInfo{};
-		accelerationStructureBuildGeometryInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
-		accelerationStructureBuildGeometryInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-		accelerationStructureBuildGeometryInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-		accelerationStructureBuildGeometryInfo.geometryCount = static_cast<uint32_t>(geometries.size());
-		accelerationStructureBuildGeometryInfo.pGeometries = geometries.data();
-		
-		VkAccelerationStructureBuildSizesInfoKHR accelerationStructureBuildSizesInfo{};
-		accelerationStructureBuildSizesInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
-		vkGetAccelerationStructureBuildSizesKHR(
-			m_vkDevice,
-			VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
-			&accelerationStructureBuildGeometryInfo,
-			maxPrimitiveCounts.data(),
-			&accelerationStructureBuildSizesInfo);
-
-		createAccelerationStructureBuffer(bottomLevelAS, accelerationStructureBuildSizesInfo);
-
-		VkAccelerationStructureCreateInfoKHR accelerationStructureCreateInfo{};
-		accelerationStructureCreateInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
-		accelerationStructureCreateInfo.buffer = bottomLevelAS.buffer;
-		accelerationStructureCreateInfo.size = accelerationStructureBuildSizesInfo.accelerationStructureSize;
-		accelerationStructureCreateInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-		vkCreateAccelerationStructureKHR(m_vkDevice, &accelerationStructureCreateInfo, nullptr, &bottomLevelAS.handle);
-
-		// Create a small scratch buffer used during build of the bottom level acceleration structure
-		ScratchBuffer scratchBuffer = createScratchBuffer(accelerationStructureBuildSizesInfo.buildScratchSize);
-
-		accelerationStructureBuildGeometryInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
-		accelerationStructureBuildGeometryInfo.dstAccelerationStructure = bottomLevelAS.handle;
-		accelerationStructureBuildGeometryInfo.scratchData.deviceAddress = scratchBuffer.deviceAddress;
-
-		const VkAccelerationStructureBuildRangeInfoKHR* buildOffsetInfo = buildRangeInfos.data();
-
-		// Build the acceleration structure on the m_vkDevice via a one-time command buffer submission
-		// Some implementations may support acceleration structure building on the host (VkPhysicalDeviceAccelerationStructureFeaturesKHR->accelerationStructureHostCommands), but we prefer m_vkDevice builds
-		VkCommandBuffer commandBuffer = m_pVulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-		vkCmdBuildAccelerationStructuresKHR(
-			commandBuffer,
-			1,
-			&accelerationStructureBuildGeometryInfo,
-			pBuildRangeInfos.data());
-		m_pVulkanDevice->flushCommandBuffer(commandBuffer, m_vkQueue);
-
-		VkAccelerationStructureDeviceAddressInfoKHR accelerationDeviceAddressInfo{};
-		accelerationDeviceAddressInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
-		accelerationDeviceAddressInfo.accelerationStructure = bottomLevelAS.handle;
-		bottomLevelAS.deviceAddress = vkGetAccelerationStructureDeviceAddressKHR(m_vkDevice, &accelerationDeviceAddressInfo);
-
-		deleteScratchBuffer(scratchBuffer);
+
+		// The builder batches all pending builds into one command buffer, compacts the acceleration structure and reports its size before and after compaction
+		// Animated models refit the acceleration structure every frame, which needs it to be built with updates allowed
+		const VkBuildAccelerationStructureFlagsKHR flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | (animated ? VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR : 0);
+		bottomLevelAS = accelerationStructureBuilder.addBottomLevel(geometries, buildRangeInfos, flags);
+		accelerationStructureBuilder.build(m_vkQueue);
 	}
 
 	/*
@@ -278,16 +217,16 @@ public:
 			0.0f, -1.0f, 0.0f, 0.0f,
 			0.0f, 0.0f, 1.0f, 0.0f };
 
+		// The bottom level acceleration structure has been compacted, so its final address is known now
 		VkAccelerationStructureInstanceKHR instance{};
 		instance.transform = transformMatrix;
 		instance.instanceCustomIndex = 0;
 		instance.mask = 0xFF;
 		instance.instanceShaderBindingTableRecordOffset = 0;
 		instance.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
-		instance.accelerationStructureReference = bottomLevelAS.deviceAddress;
+		instance.accelerationStructureReference = accelerationStructureBuilder.get(bottomLevelAS).deviceAddress;
 
-		// Buffer for m_vulkanInstance data
-		vks::Buffer instancesBuffer;
+		// Buffer for instance data, kept for refitting
 		VK_CHECK_RESULT(m_pVulkanDevice->createBuffer(
 			VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
@@ -295,84 +234,9 @@ public:
 			sizeof(VkAccelerationStructureInstanceKHR),
 			&instance));
 
-		VkDeviceOrHostAddressConstKHR instanceDataDeviceAddress{};
-		instanceDataDeviceAddress.deviceAddress = getBufferDeviceAddress(instancesBuffer.buffer);
-
-		VkAccelerationStructureGeometryKHR accelerationStructureGeometry{};
-		accelerationStructureGeometry.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
-		accelerationStructureGeometry.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
-		accelerationStructureGeometry.flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
-		accelerationStructureGeometry.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
-		accelerationStructureGeometry.geometry.instances.arrayOfPointers = VK_FALSE;
-		accelerationStructureGeometry.geometry.instances.data = instanceDataDeviceAddress;
-
-		// Get size info
-		/*
-		The pSrcAccelerationStructure, dstAccelerationStructure, and mode members of pBuildInfo are ignored. Any VkDeviceOrHostAddressKHR members of pBuildInfo are ignored by this command, except that the hostAddress member of VkAccelerationStructureGeometryTrianglesDataKHR::transformData will be examined to check if it is NULL.*
-		*/
-		VkAccelerationStructureBuildGeometryInfoKHR accelerationStructureBuildGeometryInfo{};
-		accelerationStructureBuildGeometryInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
-		accelerationStructureBuildGeometryInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-		accelerationStructureBuildGeometryInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-		accelerationStructureBuildGeometryInfo.geometryCount = 1;
-		accelerationStructureBuildGeometryInfo.pGeometries = &accelerationStructureGeometry;
-
-		uint32_t primitive_count = 1;
-
-		VkAccelerationStructureBuildSizesInfoKHR accelerationStructureBuildSizesInfo{};
-		accelerationStructureBuildSizesInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
-		vkGetAccelerationStructureBuildSizesKHR(
-			m_vkDevice, 
-			VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
-			&accelerationStructureBuildGeometryInfo,
-			&primitive_count,
-			&accelerationStructureBuildSizesInfo);
-
-		createAccelerationStructureBuffer(topLevelAS, accelerationStructureBuildSizesInfo);
-
-		VkAccelerationStructureCreateInfoKHR accelerationStructureCreateInfo{};
-		accelerationStructureCreateInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
-		accelerationStructureCreateInfo.buffer = topLevelAS.buffer;
-		accelerationStructureCreateInfo.size = accelerationStructureBuildSizesInfo.accelerationStructureSize;
-		accelerationStructureCreateInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-		vkCreateAccelerationStructureKHR(m_vkDevice, &accelerationStructureCreateInfo, nullptr, &topLevelAS.handle);
-
-		// Create a small scratch buffer used during build of the top level acceleration structure
-		ScratchBuffer scratchBuffer = createScratchBuffer(accelerationStructureBuildSizesInfo.buildScratchSize);
-
-		VkAccelerationStructureBuildGeometryInfoKHR accelerationBuildGeometryInfo{};
-		accelerationBuildGeometryInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
-		accelerationBuildGeometryInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-		accelerationBuildGeometryInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
-		accelerationBuildGeometryInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
-		accelerationBuildGeometryInfo.dstAccelerationStructure = topLevelAS.handle;
-		accelerationBuildGeometryInfo.geometryCount = 1;
-		accelerationBuildGeometryInfo.pGeometries = &accelerationStructureGeometry;
-		accelerationBuildGeometryInfo.scratchData.deviceAddress = scratchBuffer.deviceAddress;
-
-		VkAccelerationStructureBuildRangeInfoKHR accelerationStructureBuildRangeInfo{};
-		accelerationStructureBuildRangeInfo.primitiveCount = 1;
-		accelerationStructureBuildRangeInfo.primitiveOffset = 0;
-		accelerationStructureBuildRangeInfo.firstVertex = 0;
-		accelerationStructureBuildRangeInfo.transformOffset = 0;
-		std::vector<VkAccelerationStructureBuildRangeInfoKHR*> accelerationBuildStructureRangeInfos = { &accelerationStructureBuildRangeInfo };
-
-		// Build the acceleration structure on the m_vkDevice via a one-time command buffer submission
-		// Some implementations may support acceleration structure building on the host (VkPhysicalDeviceAccelerationStructureFeaturesKHR->accelerationStructureHostCommands), but we prefer m_vkDevice builds
-		VkCommandBuffer commandBuffer = m_pVulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-		vkCmdBuildAccelerationStructuresKHR(
-			commandBuffer,
-			1,
-			&accelerationBuildGeometryInfo,
-			accelerationBuildStructureRangeInfos.data());
-		m_pVulkanDevice->flushCommandBuffer(commandBuffer, m_vkQueue);
-
-		VkAccelerationStructureDeviceAddressInfoKHR accelerationDeviceAddressInfo{};
-		accelerationDeviceAddressInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
-		accelerationDeviceAddressInfo.accelerationStructure = topLevelAS.handle;
-
-		deleteScratchBuffer(scratchBuffer);
-		instancesBuffer.destroy();
+		const VkBuildAccelerationStructureFlagsKHR flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | (animated ? VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR : 0);
+		topLevelAS = accelerationStructureBuilder.addTopLevel(getBufferDeviceAddress(instancesBuffer.buffer), 1, flags);
+		accelerationStructureBuilder.build(m_vkQueue);
 	}
 
 	/*
@@ -545,7 +409,7 @@ public:
 
 		VkWriteDescriptorSetAccelerationStructureKHR descriptorAccelerationStructureInfo = vks::initializers::writeDescriptorSetAccelerationStructureKHR();
 		descriptorAccelerationStructureInfo.accelerationStructureCount = 1;
-		descriptorAccelerationStructureInfo.pAccelerationStructures = &topLevelAS.handle;
+		descriptorAccelerationStructureInfo.pAccelerationStructures = &accelerationStructureBuilder.get(topLevelAS).handle;
 
 		VkWriteDescriptorSet accelerationStructureWrite{};
 		accelerationStructureWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -639,6 +503,19 @@ public:
 		{
 			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
 
+			/*
+				Skin the animated model and refit the acceleration structures to the skinned positions
+			*/
+			if (animated) {
+				// Rays of the previous frame need to be traced before the acceleration structures are updated
+				VkMemoryBarrier memoryBarrier = vks::initializers::memoryBarrier();
+				memoryBarrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
+				memoryBarrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+				vkCmdPipelineBarrier(drawCmdBuffers[i], VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+				model.skinVertices(drawCmdBuffers[i], i, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR);
+				accelerationStructureBuilder.refit(drawCmdBuffers[i], { bottomLevelAS, topLevelAS });
+			}
+
 			/*
 				Dispatch the ray tracing commands
 			*/
@@ -746,7 +623,24 @@ public:
 	void loadAssets()
 	{
 		vkglTF::memoryPropertyFlags = VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		// One joint palette per command buffer, as every command buffer skins with its own palette
+		model.jointPaletteFrameCount = static_cast<uint32_t>(drawCmdBuffers.size());
 		model.loadFromFile(getAssetPath() + "models/FlightHelmet/glTF/FlightHelmet.gltf", m_pVulkanDevice, m_vkQueue);
+
+		animated = !model.skins.empty() && !model.animations.empty();
+		const std::string skinningShader = getShadersPath() + "base/skinning.comp.spv";
+		if (animated && !shaderExists(skinningShader)) {
+			// The model is then ray traced with its static node transforms
+			std::cerr << "Shader \"" << skinningShader << "\" not found, animation is disabled\n";
+			animated = false;
+		}
+		if (animated) {
+			// Skin the initial pose, so the acceleration structures are built from skinned positions
+			model.prepareSkinning(loadShader(skinningShader, VK_SHADER_STAGE_COMPUTE_BIT));
+			VkCommandBuffer commandBuffer = m_pVulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+			model.skinVertices(commandBuffer, 0, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR);
+			m_pVulkanDevice->flushCommandBuffer(commandBuffer, m_vkQueue);
+		}
 	}
 
 	void prepare()
@@ -756,6 +650,7 @@ public:
 		loadAssets();
 
 		// Create the acceleration structures used to render the ray traced scene
+		accelerationStructureBuilder.create(m_pVulkanDevice);
 		createBottomLevelAccelerationStructure();
 		createTopLevelAccelerationStructure();
 
@@ -771,6 +666,10 @@ public:
 	void draw()
 	{
 		VulkanExampleBase::prepareFrame();
+		if (animated) {
+			// Joint matrices for the palette used by the current command buffer
+			model.updateAnimation(0, animationTime, m_currentBufferIndex);
+		}
 		m_vkSubmitInfo.commandBufferCount = 1;
 		m_vkSubmitInfo.pCommandBuffers = &drawCmdBuffers[m_currentBufferIndex];
 		VK_CHECK_RESULT(vkQueueSubmit(m_vkQueue, 1, &m_vkSubmitInfo, VK_NULL_HANDLE));
@@ -781,6 +680,14 @@ public:
 	{
 		if (!m_prepared)
 			return;
+		if (animated && !paused) {
+			animationTime += m_frameTimer;
+			if (animationTime > model.animations[0].end) {
+				animationTime -= model.animations[0].end;
+			}
+			// Accumulated frames of different poses would blur
+			uniformData.frame = -1;
+		}
 		updateUniformBuffers();
 		if (camera.updated) {
 			// If the camera's m_vkImageView has been updated we reset the frame accumulation
@@ -1,7 +1,7 @@
 /*
 * Vulkan Example - Taking screenshots
 * 
-* This sample shows how to get the conents of the swapchain (render output) and store them to disk (see saveScreenshot)
+* This sample shows how to get the conents of the swapchain (render output) and store them to disk (see vks::FrameCapture)
 *
 * Copyright (C) 2016-2023 by Sascha Willems - www.saschawillems.de
 *
@@ -29,7 +29,8 @@ public:
 	VkDescriptorSetLayout m_vkDescriptorSetLayout{ VK_NULL_HANDLE };
 	VkDescriptorSet descriptorSet{ VK_NULL_HANDLE };
 
-	bool screenshotSaved{ false };
+	// Number of completed captures at the time the screenshot was requested
+	uint32_t screenshotRequested{ UINT32_MAX };
 
 	VulkanExample() : VulkanExampleBase()
 	{
@@ -175,219 +176,6 @@ public:
 		uniformBuffer.copyTo(&uniformData, sizeof(UniformData));
 	}
 
-	// Take a screenshot from the current swapchain m_vkImage
-	// This is done using a blit from the swapchain m_vkImage to a linear m_vkImage whose m_vkDeviceMemory content is then saved as a ppm m_vkImage
-	// Getting the m_vkImage date directly from a swapchain m_vkImage wouldn't work as they're usually stored in an implementation dependent optimal tiling format
-	// Note: This requires the swapchain images to be created with the VK_IMAGE_USAGE_TRANSFER_SRC_BIT flag (see VulkanSwapChain::create)
-	void saveScreenshot(const char *filename)
-	{
-		screenshotSaved = false;
-		bool supportsBlit = true;
-
-		// Check blit support for source and destination
-		VkFormatProperties formatProps;
-
-		// Check if the m_vkDevice supports blitting from optimal images (the swapchain images are in optimal format)
-		vkGetPhysicalDeviceFormatProperties(m_vkPhysicalDevice, m_swapChain.colorFormat, &formatProps);
-		if (!(formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT)) {
-			std::cerr << "Device does not support blitting from optimal tiled images, using copy instead of blit!" << std::endl;
-			supportsBlit = false;
-		}
-
-		// Check if the m_vkDevice supports blitting to linear images
-		vkGetPhysicalDeviceFormatProperties(m_vkPhysicalDevice, VK_FORMAT_R8G8B8A8_UNORM, &formatProps);
-		if (!(formatProps.linearTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT)) {
-			std::cerr << "Device does not support blitting to linear tiled images, using copy instead of blit!" << std::endl;
-			supportsBlit = false;
-		}
-
-		// Source for the copy is the last rendered swapchain m_vkImage
-		VkImage srcImage = m_swapChain.images[m_currentBufferIndex];
-
-		// Create the linear tiled destination m_vkImage to copy to and to read the m_vkDeviceMemory from
-		VkImageCreateInfo imageCreateCI(vks::initializers::imageCreateInfo());
-		imageCreateCI.imageType = VK_IMAGE_TYPE_2D;
-		// Note that vkCmdBlitImage (if supported) will also do format conversions if the swapchain color format would differ
-		imageCreateCI.format = VK_FORMAT_R8G8B8A8_UNORM;
-		imageCreateCI.extent.width = m_drawAreaWidth;
-		imageCreateCI.extent.height = m_drawAreaHeight;
-		imageCreateCI.extent.depth = 1;
-		imageCreateCI.arrayLayers = 1;
-		imageCreateCI.mipLevels = 1;
-		imageCreateCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		imageCreateCI.samples = VK_SAMPLE_COUNT_1_BIT;
-		imageCreateCI.tiling = VK_IMAGE_TILING_LINEAR;
-		imageCreateCI.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-		// Create the m_vkImage
-		VkImage dstImage;
-		VK_CHECK_RESULT(vkCreateImage(m_vkDevice, &imageCreateCI, nullptr, &dstImage));
-		// Create m_vkDeviceMemory to back up the m_vkImage
-		VkMemoryRequirements memRequirements;
-		VkMemoryAllocateInfo memAllocInfo(vks::initializers::memoryAllocateInfo());
-		VkDeviceMemory dstImageMemory;
-		vkGetImageMemoryRequirements(m_vkDevice, dstImage, &memRequirements);
-		memAllocInfo.allocationSize = memRequirements.size;
-		// Memory must be host visible to copy from
-		memAllocInfo.memoryTypeIndex = m_pVulkanDevice->getMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(m_vkDevice, &memAllocInfo, nullptr, &dstImageMemory));
-		VK_CHECK_RESULT(vkBindImageMemory(m_vkDevice, dstImage, dstImageMemory, 0));
-
-		// Do the actual blit from the swapchain m_vkImage to our host visible destination m_vkImage
-		VkCommandBuffer copyCmd = m_pVulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-		// Transition destination m_vkImage to transfer destination layout
-		vks::tools::insertImageMemoryBarrier(
-			copyCmd,
-			dstImage,
-			0,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 });
-
-		// Transition swapchain m_vkImage from present to transfer source layout
-		vks::tools::insertImageMemoryBarrier(
-			copyCmd,
-			srcImage,
-			VK_ACCESS_MEMORY_READ_BIT,
-			VK_ACCESS_TRANSFER_READ_BIT,
-			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 });
-
-		// If source and destination support blit we'll blit as this also does automatic format conversion (e.g. from BGR to RGB)
-		if (supportsBlit)
-		{
-			// Define the region to blit (we will blit the whole swapchain m_vkImage)
-			VkOffset3D blitSize;
-			blitSize.x = m_drawAreaWidth;
-			blitSize.y = m_drawAreaHeight;
-			blitSize.z = 1;
-			VkImageBlit imageBlitRegion{};
-			imageBlitRegion.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			imageBlitRegion.srcSubresource.layerCount = 1;
-			imageBlitRegion.srcOffsets[1] = blitSize;
-			imageBlitRegion.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			imageBlitRegion.dstSubresource.layerCount = 1;
-			imageBlitRegion.dstOffsets[1] = blitSize;
-
-			// Issue the blit command
-			vkCmdBlitImage(
-				copyCmd,
-				srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				1,
-				&imageBlitRegion,
-				VK_FILTER_NEAREST);
-		}
-		else
-		{
-			// Otherwise use m_vkImage copy (requires us to manually flip components)
-			VkImageCopy imageCopyRegion{};
-			imageCopyRegion.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			imageCopyRegion.srcSubresource.layerCount = 1;
-			imageCopyRegion.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			imageCopyRegion.dstSubresource.layerCount = 1;
-			imageCopyRegion.extent.width = m_drawAreaWidth;
-			imageCopyRegion.extent.height = m_drawAreaHeight;
-			imageCopyRegion.extent.depth = 1;
-
-			// Issue the copy command
-			vkCmdCopyImage(
-				copyCmd,
-				srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				1,
-				&imageCopyRegion);
-		}
-
-		// Transition destination m_vkImage to general layout, which is the required layout for mapping the m_vkImage m_vkDeviceMemory later on
-		vks::tools::insertImageMemoryBarrier(
-			copyCmd,
-			dstImage,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_ACCESS_MEMORY_READ_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_GENERAL,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 });
-
-		// Transition back the swap chain m_vkImage after the blit is done
-		vks::tools::insertImageMemoryBarrier(
-			copyCmd,
-			srcImage,
-			VK_ACCESS_TRANSFER_READ_BIT,
-			VK_ACCESS_MEMORY_READ_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 });
-
-		m_pVulkanDevice->flushCommandBuffer(copyCmd, m_vkQueue);
-
-		// Get layout of the m_vkImage (including row pitch)
-		VkImageSubresource subResource { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0 };
-		VkSubresourceLayout subResourceLayout;
-		vkGetImageSubresourceLayout(m_vkDevice, dstImage, &subResource, &subResourceLayout);
-
-		// Map m_vkImage m_vkDeviceMemory so we can start copying from it
-		const char* data;
-		vkMapMemory(m_vkDevice, dstImageMemory, 0, VK_WHOLE_SIZE, 0, (void**)&data);
-		data += subResourceLayout.offset;
-
-		std::ofstream file(filename, std::ios::out | std::ios::binary);
-
-		// ppm header
-		file << "P6\n" << m_drawAreaWidth << "\n" << m_drawAreaHeight << "\n" << 255 << "\n";
-
-		// If source is BGR (destination is always RGB) and we can't use blit (which does automatic conversion), we'll have to manually swizzle color components
-		bool colorSwizzle = false;
-		// Check if source is BGR
-		// Note: Not complete, only contains most common and basic BGR m_vkSurface formats for demonstration purposes
-		if (!supportsBlit)
-		{
-			std::vector<VkFormat> formatsBGR = { VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_B8G8R8A8_SNORM };
-			colorSwizzle = (std::find(formatsBGR.begin(), formatsBGR.end(), m_swapChain.colorFormat) != formatsBGR.end());
-		}
-
-		// ppm binary pixel data
-		for (uint32_t y = 0; y < m_drawAreaHeight; y++)
-		{
-			unsigned int *row = (unsigned int*)data;
-			for (uint32_t x = 0; x < m_drawAreaWidth; x++)
-			{
-				if (colorSwizzle)
-				{
-					file.write((char*)row+2, 1);
-					file.write((char*)row+1, 1);
-					file.write((char*)row, 1);
-				}
-				else
-				{
-					file.write((char*)row, 3);
-				}
-				row++;
-			}
-			data += subResourceLayout.rowPitch;
-		}
-		file.close();
-
-		std::cout << "Screenshot saved to disk" << std::endl;
-
-		// Clean up resources
-		vkUnmapMemory(m_vkDevice, dstImageMemory);
-		vkFreeMemory(m_vkDevice, dstImageMemory, nullptr);
-		vkDestroyImage(m_vkDevice, dstImage, nullptr);
-
-		screenshotSaved = true;
-	}
-
 	void prepare()
 	{
 		VulkanExampleBase::prepare();
@@ -420,9 +208,12 @@ public:
 	{
 		if (overlay->header("Functions")) {
 			if (overlay->button("Take screenshot")) {
-				saveScreenshot("screenshot.ppm");
+				// The swapchain image is copied to a readback buffer before it's presented and written to disk on a worker thread (see vks::FrameCapture)
+				// Note: This requires the swapchain images to be created with the VK_IMAGE_USAGE_TRANSFER_SRC_BIT flag (see VulkanSwapChain::create)
+				screenshotRequested = m_frameCapture.getCompletedCount();
+				captureFrame("screenshot.ppm");
 			}
-			if (screenshotSaved) {
+			if ((screenshotRequested != UINT32_MAX) && (m_frameCapture.getCompletedCount() > screenshotRequested)) {
 				overlay->text("Screenshot saved as screenshot.ppm");
 			}
 		}
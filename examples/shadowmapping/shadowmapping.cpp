@@ -14,6 +14,8 @@ class VulkanExample : public VulkanExampleBase
 public:
 	bool displayShadowMap = false;
 	bool filterPCF = true;
+	// Render the scenes from the compact, stream split vertex layout (see vkglTF::FileLoadingFlags::QuantizeVertices)
+	bool quantizedVertices = false;
 
 	// Keep depth range as small as possible
 	// for better shadow map precision
@@ -30,6 +32,7 @@ public:
 	float lightFOV = 45.0f;
 
 	std::vector<vkglTF::Model> scenes;
+	std::vector<vkglTF::Model> scenesQuantized;
 	std::vector<std::string> sceneNames;
 	int32_t sceneIndex = 0;
 
@@ -60,6 +63,12 @@ public:
 		VkPipeline sceneShadowPCF{ VK_NULL_HANDLE };
 		VkPipeline debug{ VK_NULL_HANDLE };
 	} pipelines;
+	// Same pipelines for the quantized vertex layout
+	struct {
+		VkPipeline offscreen{ VK_NULL_HANDLE };
+		VkPipeline sceneShadow{ VK_NULL_HANDLE };
+		VkPipeline sceneShadowPCF{ VK_NULL_HANDLE };
+	} pipelinesQuantized;
 	VkPipelineLayout m_vkPipelineLayout{ VK_NULL_HANDLE };
 
 	struct {
@@ -84,6 +93,10 @@ public:
 		VkDescriptorImageInfo descriptor;
 	} offscreenPass{};
 
+	// Timestamps written before and after the shadow map pass of each command buffer
+	VkQueryPool timestampQueryPool{ VK_NULL_HANDLE };
+	float shadowPassTime{ 0.0f };
+
 	// 16 bits of depth is enough for such a small scene
 	const VkFormat offscreenDepthFormat{ VK_FORMAT_D16_UNORM };
 	// Shadow map dimension
@@ -123,6 +136,11 @@ public:
 			vkDestroyPipeline(m_vkDevice, pipelines.offscreen, nullptr);
 			vkDestroyPipeline(m_vkDevice, pipelines.sceneShadow, nullptr);
 			vkDestroyPipeline(m_vkDevice, pipelines.sceneShadowPCF, nullptr);
+			vkDestroyPipeline(m_vkDevice, pipelinesQuantized.offscreen, nullptr);
+			vkDestroyPipeline(m_vkDevice, pipelinesQuantized.sceneShadow, nullptr);
+			vkDestroyPipeline(m_vkDevice, pipelinesQuantized.sceneShadowPCF, nullptr);
+
+			vkDestroyQueryPool(m_vkDevice, timestampQueryPool, nullptr);
 
 			vkDestroyPipelineLayout(m_vkDevice, m_vkPipelineLayout, nullptr);
 
@@ -267,10 +285,15 @@ public:
 		VkViewport viewport;
 		VkRect2D scissor;
 
+		vkglTF::Model& scene = quantizedVertices ? scenesQuantized[sceneIndex] : scenes[sceneIndex];
+
 		for (int32_t i = 0; i < drawCmdBuffers.size(); ++i)
 		{
 			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
 
+			vkCmdResetQueryPool(drawCmdBuffers[i], timestampQueryPool, i * 2, 2);
+			vkCmdWriteTimestamp(drawCmdBuffers[i], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, i * 2);
+
 			/*
 				First render pass: Generate shadow map by rendering the scene from light's POV
 			*/
@@ -301,13 +324,15 @@ public:
 					0.0f,
 					depthBiasSlope);
 
-				vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.offscreen);
+				vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, quantizedVertices ? pipelinesQuantized.offscreen : pipelines.offscreen);
 				vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, 1, &descriptorSets.offscreen, 0, nullptr);
-				scenes[sceneIndex].draw(drawCmdBuffers[i]);
+				scene.draw(drawCmdBuffers[i]);
 
 				vkCmdEndRenderPass(drawCmdBuffers[i]);
 			}
 
+			vkCmdWriteTimestamp(drawCmdBuffers[i], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, i * 2 + 1);
+
 			/*
 				Note: Explicit synchronization is not required between the render pass, as this is done implicit via sub pass dependencies
 			*/
@@ -344,8 +369,12 @@ public:
 				} else {
 					// Render the shadows scene
 					vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, 1, &descriptorSets.scene, 0, nullptr);
-					vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, (filterPCF) ? pipelines.sceneShadowPCF : pipelines.sceneShadow);
-					scenes[sceneIndex].draw(drawCmdBuffers[i]);
+					if (quantizedVertices) {
+						vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, (filterPCF) ? pipelinesQuantized.sceneShadowPCF : pipelinesQuantized.sceneShadow);
+					} else {
+						vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, (filterPCF) ? pipelines.sceneShadowPCF : pipelines.sceneShadow);
+					}
+					scene.draw(drawCmdBuffers[i]);
 				}
 
 				drawUI(drawCmdBuffers[i]);
@@ -363,7 +392,36 @@ public:
 		scenes.resize(2);
 		scenes[0].loadFromFile(getAssetPath() + "models/vulkanscene_shadow.gltf", m_pVulkanDevice, m_vkQueue, glTFLoadingFlags);
 		scenes[1].loadFromFile(getAssetPath() + "models/samplescene.gltf", m_pVulkanDevice, m_vkQueue, glTFLoadingFlags);
+		// The quantized copies only differ in their vertex layout, so vertex memory and shadow pass times can be compared at runtime
+		scenesQuantized.resize(2);
+		scenesQuantized[0].loadFromFile(getAssetPath() + "models/vulkanscene_shadow.gltf", m_pVulkanDevice, m_vkQueue, glTFLoadingFlags | vkglTF::FileLoadingFlags::QuantizeVertices);
+		scenesQuantized[1].loadFromFile(getAssetPath() + "models/samplescene.gltf", m_pVulkanDevice, m_vkQueue, glTFLoadingFlags | vkglTF::FileLoadingFlags::QuantizeVertices);
 		sceneNames = {"Vulkan scene", "Teapots and pillars" };
+		for (size_t i = 0; i < scenes.size(); i++) {
+			std::cout << sceneNames[i] << ": vertex memory " << scenes[i].vertexBufferSize << " bytes, quantized " << scenesQuantized[i].vertexBufferSize << " bytes\n";
+		}
+	}
+
+	void prepareTimestampQueries()
+	{
+		VkQueryPoolCreateInfo queryPoolCI{};
+		queryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolCI.queryCount = static_cast<uint32_t>(drawCmdBuffers.size()) * 2;
+		VK_CHECK_RESULT(vkCreateQueryPool(m_vkDevice, &queryPoolCI, nullptr, &timestampQueryPool));
+		// Reset from the host so the results of command buffers that haven't been submitted yet can be read as unavailable
+		vkResetQueryPool(m_vkDevice, timestampQueryPool, 0, queryPoolCI.queryCount);
+	}
+
+	// Read the shadow pass timestamps of the last submission of a command buffer, results that aren't available yet are skipped
+	void updateShadowPassTime(uint32_t commandBufferIndex)
+	{
+		uint64_t results[4]{};
+		const VkResult result = vkGetQueryPoolResults(m_vkDevice, timestampQueryPool, commandBufferIndex * 2, 2, sizeof(results), results, sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		if ((result == VK_SUCCESS) && results[1] && results[3]) {
+			const float timestampPeriod = m_pVulkanDevice->m_vkPhysicalDeviceProperties.limits.timestampPeriod;
+			shadowPassTime = static_cast<float>(results[2] - results[0]) * timestampPeriod / 1000000.0f;
+		}
 	}
 
 	void setupDescriptors()
@@ -465,7 +523,9 @@ public:
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCI, nullptr, &pipelines.debug));
 
 		// Scene rendering with shadows applied
-		pipelineCI.pVertexInputState  = vkglTF::Vertex::getPipelineVertexInputState({vkglTF::VertexComponent::Position, vkglTF::VertexComponent::UV, vkglTF::VertexComponent::Color, vkglTF::VertexComponent::Normal});
+		// The vertex input state is generated into static storage, so it needs to be generated again for each layout
+		const std::vector<vkglTF::VertexComponent> sceneComponents = { vkglTF::VertexComponent::Position, vkglTF::VertexComponent::UV, vkglTF::VertexComponent::Color, vkglTF::VertexComponent::Normal };
+		pipelineCI.pVertexInputState = vkglTF::Vertex::getPipelineVertexInputState(sceneComponents);
 		rasterizationStateCI.cullMode = VK_CULL_MODE_BACK_BIT;
 		shaderStages[0] = loadShader(getShadersPath() + "shadowmapping/scene.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
 		shaderStages[1] = loadShader(getShadersPath() + "shadowmapping/scene.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
@@ -479,6 +539,12 @@ public:
 		// PCF filtering
 		enablePCF = 1;
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCI, nullptr, &pipelines.sceneShadowPCF));
+		// Same pipelines for the quantized vertex layout, the shaders are shared as the vertex input stage expands all components to floats
+		pipelineCI.pVertexInputState = vkglTF::Vertex::getPipelineVertexInputState(sceneComponents, vkglTF::VertexLayout::Quantized);
+		enablePCF = 0;
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCI, nullptr, &pipelinesQuantized.sceneShadow));
+		enablePCF = 1;
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCI, nullptr, &pipelinesQuantized.sceneShadowPCF));
 
 		// Offscreen pipeline (vertex shader only)
 		shaderStages[0] = loadShader(getShadersPath() + "shadowmapping/offscreen.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
@@ -495,7 +561,12 @@ public:
 		dynamicStateCI = vks::initializers::pipelineDynamicStateCreateInfo(dynamicStateEnables);
 
 		pipelineCI.renderPass = offscreenPass.renderPass;
+		// The shadow map pass only uses positions
+		pipelineCI.pVertexInputState = vkglTF::Vertex::getPipelineVertexInputState({ vkglTF::VertexComponent::Position });
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCI, nullptr, &pipelines.offscreen));
+		// With the quantized layout this only fetches from the tightly packed position stream
+		pipelineCI.pVertexInputState = vkglTF::Vertex::getPipelineVertexInputState({ vkglTF::VertexComponent::Position }, vkglTF::VertexLayout::Quantized);
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_vkDevice, m_vkPipelineCache, 1, &pipelineCI, nullptr, &pipelinesQuantized.offscreen));
 	}
 
 	// Prepare and initialize uniform buffer containing shader uniforms
@@ -551,6 +622,7 @@ public:
 		VulkanExampleBase::prepare();
 		loadAssets();
 		prepareOffscreenFramebuffer();
+		prepareTimestampQueries();
 		prepareUniformBuffers();
 		setupDescriptors();
 		preparePipelines();
@@ -561,6 +633,7 @@ public:
 	void draw()
 	{
 		VulkanExampleBase::prepareFrame();
+		updateShadowPassTime(m_currentBufferIndex);
 		m_vkSubmitInfo.commandBufferCount = 1;
 		m_vkSubmitInfo.pCommandBuffers = &drawCmdBuffers[m_currentBufferIndex];
 		VK_CHECK_RESULT(vkQueueSubmit(m_vkQueue, 1, &m_vkSubmitInfo, VK_NULL_HANDLE));
@@ -591,6 +664,14 @@ public:
 			if (overlay->checkBox("PCF filtering", &filterPCF)) {
 				buildCommandBuffers();
 			}
+			if (overlay->checkBox("Quantized vertices", &quantizedVertices)) {
+				buildCommandBuffers();
+			}
+		}
+		if (overlay->header("Statistics")) {
+			const vkglTF::Model& scene = quantizedVertices ? scenesQuantized[sceneIndex] : scenes[sceneIndex];
+			overlay->text("Vertex memory: %.1f KB", static_cast<float>(scene.vertexBufferSize) / 1024.0f);
+			overlay->text("Shadow pass: %.3f ms", shadowPassTime);
 		}
 	}
 };
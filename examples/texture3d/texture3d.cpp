@@ -313,33 +313,8 @@ public:
 
 		std::cout << "Done in " << tDiff << "ms" << std::endl;
 
-		// Create a host-visible staging buffer that contains the raw m_vkImage data
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-
-		// Buffer object
-		VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo();
-		bufferCreateInfo.size = texMemSize;
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		VK_CHECK_RESULT(vkCreateBuffer(m_vkDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-		// Allocate host visible m_vkDeviceMemory for data upload
-		VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
-		VkMemoryRequirements memReqs = {};
-		vkGetBufferMemoryRequirements(m_vkDevice, stagingBuffer, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = m_pVulkanDevice->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(m_vkDevice, &memAllocInfo, nullptr, &stagingMemory));
-		VK_CHECK_RESULT(vkBindBufferMemory(m_vkDevice, stagingBuffer, stagingMemory, 0));
-
-		// Copy texture data into staging buffer
-		uint8_t *mapped;
-		VK_CHECK_RESULT(vkMapMemory(m_vkDevice, stagingMemory, 0, memReqs.size, 0, (void **)&mapped));
-		memcpy(mapped, data, texMemSize);
-		vkUnmapMemory(m_vkDevice, stagingMemory);
-
-		VkCommandBuffer copyCmd = m_pVulkanDevice->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		// The noise data is uploaded through the device's staging ring
+		VkCommandBuffer copyCmd = m_pVulkanDevice->stagingRing.getCommandBuffer();
 
 		// The sub resource range describes the regions of the m_vkImage we will be transitioned
 		VkImageSubresourceRange subresourceRange = {};
@@ -369,29 +344,16 @@ public:
 		bufferCopyRegion.imageExtent.height = texture.height;
 		bufferCopyRegion.imageExtent.depth = texture.depth;
 
-		vkCmdCopyBufferToImage(
-			copyCmd,
-			stagingBuffer,
-			texture.image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1,
-			&bufferCopyRegion);
+		m_pVulkanDevice->stagingRing.copyToImage(data, texMemSize, texture.image, { bufferCopyRegion }, 1);
 
 		// Change texture m_vkImage layout to shader read after all mip levels have been copied
 		texture.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		vks::tools::setImageLayout(
-			copyCmd,
-			texture.image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			texture.imageLayout,
-			subresourceRange);
+		m_pVulkanDevice->stagingRing.releaseImage(texture.image, subresourceRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, texture.imageLayout);
 
-		m_pVulkanDevice->flushCommandBuffer(copyCmd, m_vkQueue, true);
+		m_pVulkanDevice->stagingRing.submit();
 
-		// Clean up staging resources
+		// The data has been copied into the staging ring, so it can be released right away
 		delete[] data;
-                vkFreeMemory(m_vkDevice, stagingMemory, nullptr);
-                vkDestroyBuffer(m_vkDevice, stagingBuffer, nullptr);
 	}
 
 	// Free all Vulkan resources used a texture object
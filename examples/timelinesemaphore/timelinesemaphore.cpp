@@ -630,25 +630,31 @@ public:
 
 		VulkanExampleBase::prepareFrame();
 
+		// The swap chain semaphores go last, there are none in headless mode
 		VkPipelineStageFlags graphicsWaitStageMasks[] = { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		VkSemaphore graphicsWaitSemaphores[] = { timeLineSemaphore.handle, semaphores.m_vkSemaphorePresentComplete };
-		VkSemaphore graphicsSignalSemaphores[] = { timeLineSemaphore.handle, semaphores.m_vkSemaphoreRenderComplete };
+		std::vector<VkSemaphore> graphicsWaitSemaphores = { timeLineSemaphore.handle };
+		std::vector<VkSemaphore> graphicsSignalSemaphores = { timeLineSemaphore.handle };
+		const std::vector<VkSemaphore> presentWaitSemaphores = getPresentWaitSemaphores();
+		const std::vector<VkSemaphore> presentSignalSemaphores = getPresentSignalSemaphores();
+		graphicsWaitSemaphores.insert(graphicsWaitSemaphores.end(), presentWaitSemaphores.begin(), presentWaitSemaphores.end());
+		graphicsSignalSemaphores.insert(graphicsSignalSemaphores.end(), presentSignalSemaphores.begin(), presentSignalSemaphores.end());
 
 		// Submit graphics commands
 		m_vkSubmitInfo.commandBufferCount = 1;
 		m_vkSubmitInfo.pCommandBuffers = &drawCmdBuffers[m_currentBufferIndex];
-		m_vkSubmitInfo.waitSemaphoreCount = 2;
-		m_vkSubmitInfo.pWaitSemaphores = graphicsWaitSemaphores;
+		m_vkSubmitInfo.waitSemaphoreCount = static_cast<uint32_t>(graphicsWaitSemaphores.size());
+		m_vkSubmitInfo.pWaitSemaphores = graphicsWaitSemaphores.data();
 		m_vkSubmitInfo.pWaitDstStageMask = graphicsWaitStageMasks;
-		m_vkSubmitInfo.signalSemaphoreCount = 2;
-		m_vkSubmitInfo.pSignalSemaphores = graphicsSignalSemaphores;
+		m_vkSubmitInfo.signalSemaphoreCount = static_cast<uint32_t>(graphicsSignalSemaphores.size());
+		m_vkSubmitInfo.pSignalSemaphores = graphicsSignalSemaphores.data();
 
+		// Values for binary semaphores are ignored
 		uint64_t wait_values[2] = { compute_finished, compute_finished };
 		uint64_t signal_values[2] = { all_finished, all_finished };
 
-		timeLineSubmitInfo.waitSemaphoreValueCount = 2;
+		timeLineSubmitInfo.waitSemaphoreValueCount = m_vkSubmitInfo.waitSemaphoreCount;
 		timeLineSubmitInfo.pWaitSemaphoreValues = &wait_values[0];
-		timeLineSubmitInfo.signalSemaphoreValueCount = 2;
+		timeLineSubmitInfo.signalSemaphoreValueCount = m_vkSubmitInfo.signalSemaphoreCount;
 		timeLineSubmitInfo.pSignalSemaphoreValues = &signal_values[0];
 
 		m_vkSubmitInfo.pNext = &timeLineSubmitInfo;
@@ -0,0 +1,43 @@
+// Hierarchical-z occlusion test of bounding spheres against a depth pyramid built by base/depthpyramid.comp (see vks::DepthPyramid)
+// Define HIZ_REVERSED_DEPTH before including for pyramids of reversed depth buffers (vks::DepthPyramid::Reduction::Min)
+
+// Screen space rectangle (in texture coordinates) of a view space sphere in front of the near plane, see "2D Polygonal Bounds of a Sphere" (Mara, McGuire)
+vec4 hizProjectSphere(vec3 center, float radius, mat4 projection)
+{
+	// Distance along the view direction
+	float depth = -center.z;
+	vec2 cx = vec2(center.x, depth);
+	vec2 vx = vec2(sqrt(dot(cx, cx) - radius * radius), radius);
+	vec2 minx = mat2(vx.x, vx.y, -vx.y, vx.x) * cx;
+	vec2 maxx = mat2(vx.x, -vx.y, vx.y, vx.x) * cx;
+	vec2 cy = vec2(center.y, depth);
+	vec2 vy = vec2(sqrt(dot(cy, cy) - radius * radius), radius);
+	vec2 miny = mat2(vy.x, vy.y, -vy.y, vy.x) * cy;
+	vec2 maxy = mat2(vy.x, -vy.y, vy.y, vy.x) * cy;
+	vec2 x = vec2(minx.x / minx.y, maxx.x / maxx.y) * projection[0][0];
+	vec2 y = vec2(miny.x / miny.y, maxy.x / maxy.y) * projection[1][1];
+	return vec4(min(x.x, x.y), min(y.x, y.y), max(x.x, x.y), max(y.x, y.y)) * 0.5 + 0.5;
+}
+
+// Tests the nearest depth of a world space sphere against the farthest depth in the pyramid level where its rectangle covers at most 2 x 2 texels
+bool hizVisible(sampler2D depthPyramid, vec2 pyramidSize, mat4 view, mat4 projection, vec3 center, float radius)
+{
+	vec3 viewCenter = (view * vec4(center, 1.0)).xyz;
+	float znear = projection[3][2] / projection[2][2];
+	// Spheres intersecting the near plane can't be projected and are always visible
+	if (-viewCenter.z - radius <= znear) {
+		return true;
+	}
+	vec4 rect = clamp(hizProjectSphere(viewCenter, radius, projection), 0.0, 1.0);
+	vec2 size = (rect.zw - rect.xy) * pyramidSize;
+	float level = ceil(log2(max(max(size.x, size.y), 1.0)));
+	vec4 depths = vec4(
+		textureLod(depthPyramid, rect.xy, level).r, textureLod(depthPyramid, rect.zy, level).r,
+		textureLod(depthPyramid, rect.xw, level).r, textureLod(depthPyramid, rect.zw, level).r);
+	vec4 nearest = projection * vec4(0.0, 0.0, viewCenter.z + radius, 1.0);
+#ifdef HIZ_REVERSED_DEPTH
+	return nearest.z / nearest.w >= min(min(depths.x, depths.y), min(depths.z, depths.w));
+#else
+	return nearest.z / nearest.w <= max(max(depths.x, depths.y), max(depths.z, depths.w));
+#endif
+}
@@ -0,0 +1,108 @@
+// Particle layout, parameters and collision functions shared by the cloth compute shaders
+
+struct Particle {
+	vec4 pos;
+	vec4 vel;
+	vec4 uv;
+	vec4 normal;
+};
+
+layout (binding = 2) uniform UBO 
+{
+	float deltaT;
+	float particleMass;
+	float springStiffness;
+	float damping;
+	float restDistH;
+	float restDistV;
+	float restDistD;
+	float sphereRadius;
+	vec4 spherePos;
+	vec4 gravity;
+	ivec2 particleCount;
+	uint collider;
+	float selfCollisionDistance;
+	// xyz: World space position of the first distance field sample, w: Distance between samples
+	vec4 sdfOrigin;
+	uint sdfResolution;
+	uint hashTableSize;
+} params;
+
+// Signed distance field of the collider mesh in world space, samples are stored x first, then y, then z
+layout (std430, binding = 3) readonly buffer SignedDistanceField {
+	float sdf[ ];
+};
+
+#define COLLIDER_SPHERE 0
+#define COLLIDER_SDF 1
+#define COLLISION_MARGIN 0.01
+
+// Number of particles a cell of the self collision hash table can hold, further particles are ignored
+#define BUCKET_CAPACITY 8
+
+vec3 springForce(vec3 p0, vec3 p1, float restDist) 
+{
+	vec3 dist = p0 - p1;
+	return normalize(dist) * params.springStiffness * (length(dist) - restDist);
+}
+
+float sdfSample(ivec3 coord)
+{
+	int resolution = int(params.sdfResolution);
+	return sdf[(coord.z * resolution + coord.y) * resolution + coord.x];
+}
+
+// Trilinear interpolation, points outside of the field add their distance to its border
+float sdfDistance(vec3 pos)
+{
+	vec3 coord = (pos - params.sdfOrigin.xyz) / params.sdfOrigin.w;
+	vec3 clamped = clamp(coord, vec3(0.0), vec3(float(params.sdfResolution - 1)));
+	ivec3 cell = min(ivec3(clamped), ivec3(params.sdfResolution - 2));
+	vec3 f = clamped - vec3(cell);
+	float x00 = mix(sdfSample(cell), sdfSample(cell + ivec3(1, 0, 0)), f.x);
+	float x10 = mix(sdfSample(cell + ivec3(0, 1, 0)), sdfSample(cell + ivec3(1, 1, 0)), f.x);
+	float x01 = mix(sdfSample(cell + ivec3(0, 0, 1)), sdfSample(cell + ivec3(1, 0, 1)), f.x);
+	float x11 = mix(sdfSample(cell + ivec3(0, 1, 1)), sdfSample(cell + ivec3(1, 1, 1)), f.x);
+	float d = mix(mix(x00, x10, f.y), mix(x01, x11, f.y), f.z);
+	return d + length(coord - clamped) * params.sdfOrigin.w;
+}
+
+// Push a particle that's inside of the collider to its surface, returns true if it was moved
+bool collide(inout vec3 pos)
+{
+	if (params.collider == COLLIDER_SPHERE) {
+		vec3 sphereDist = pos - params.spherePos.xyz;
+		if (length(sphereDist) < params.sphereRadius + COLLISION_MARGIN) {
+			// If the particle is inside the sphere, push it to the outer radius
+			pos = params.spherePos.xyz + normalize(sphereDist) * (params.sphereRadius + COLLISION_MARGIN);
+			return true;
+		}
+		return false;
+	}
+	float d = sdfDistance(pos);
+	if (d >= COLLISION_MARGIN) {
+		return false;
+	}
+	// The surface normal is the gradient of the distance field
+	float h = params.sdfOrigin.w * 0.5;
+	vec3 gradient = vec3(
+		sdfDistance(pos + vec3(h, 0.0, 0.0)) - sdfDistance(pos - vec3(h, 0.0, 0.0)),
+		sdfDistance(pos + vec3(0.0, h, 0.0)) - sdfDistance(pos - vec3(0.0, h, 0.0)),
+		sdfDistance(pos + vec3(0.0, 0.0, h)) - sdfDistance(pos - vec3(0.0, 0.0, h)));
+	if (dot(gradient, gradient) < 1e-12) {
+		return false;
+	}
+	pos += normalize(gradient) * (COLLISION_MARGIN - d);
+	return true;
+}
+
+// Self collision hash table with cells the size of the collision distance
+ivec3 hashCell(vec3 pos)
+{
+	return ivec3(floor(pos / params.selfCollisionDistance));
+}
+
+uint hashBucket(ivec3 cell)
+{
+	return ((uint(cell.x) * 73856093u) ^ (uint(cell.y) * 19349663u) ^ (uint(cell.z) * 83492791u)) & (params.hashTableSize - 1u);
+}
@@ -14,6 +14,11 @@ layout (binding = 0) uniform UBO
 	vec4 lightPos;
 } ubo;
 
+// Places the collider mesh in the scene
+layout (push_constant) uniform PushConsts {
+	mat4 model;
+} pushConsts;
+
 out gl_PerVertex
 {
 	vec4 gl_Position;
@@ -21,11 +26,11 @@ out gl_PerVertex
 
 void main () 
 {
-	vec4 eyePos = ubo.modelview * vec4(inPos.x, inPos.y, inPos.z, 1.0); 
+	vec4 pos = pushConsts.model * vec4(inPos.x, inPos.y, inPos.z, 1.0);
+	vec4 eyePos = ubo.modelview * pos; 
 	gl_Position = ubo.projection * eyePos;
-	vec4 pos = vec4(inPos, 1.0);
 	vec3 lPos = ubo.lightPos.xyz;
 	outLightVec = lPos - pos.xyz;
 	outViewVec = -pos.xyz;
-	outNormal = inNormal;
+	outNormal = mat3(pushConsts.model) * inNormal;
 }
\ No newline at end of file
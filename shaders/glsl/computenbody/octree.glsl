@@ -0,0 +1,40 @@
+// Implicit octree used by the hierarchical N-body shaders, the same layout as the CPU reference in base/NBody.h
+// Level l has 2^l cells per axis, the cells of a level are stored in x, y, z order after the cells of all coarser levels
+// Every cell stores the center of its particles weighted by absolute mass (xyz, weight) and the sum of their masses
+
+#define CELL_STRIDE 5
+
+// The cells are accumulated with atomics, so they are stored as raw bits
+layout (std430, binding = 2) buffer Cells
+{
+	uint cells[ ];
+};
+
+layout (binding = 1) uniform UBO 
+{
+	float deltaT;
+	int particleCount;
+	float gravity;
+	float power;
+	float soften;
+	float theta;
+	uint levels;
+	float boundsSize;
+	vec4 boundsMin;
+} ubo;
+
+uint levelOffset(uint level)
+{
+	return ((1u << (3u * level)) - 1u) / 7u;
+}
+
+uint cellIndex(uint level, uvec3 cell)
+{
+	uint resolution = 1u << level;
+	return levelOffset(level) + cell.x + cell.y * resolution + cell.z * resolution * resolution;
+}
+
+float cellValue(uint cell, uint component)
+{
+	return uintBitsToFloat(cells[cell * CELL_STRIDE + component]);
+}
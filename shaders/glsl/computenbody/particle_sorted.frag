@@ -0,0 +1,17 @@
+#version 450
+
+// Premultiplied alpha output for drawing the particles back to front with "over" blending
+
+layout (binding = 0) uniform sampler2D samplerColorMap;
+layout (binding = 1) uniform sampler2D samplerGradientRamp;
+
+layout (location = 0) in float inGradientPos;
+
+layout (location = 0) out vec4 outFragColor;
+
+void main () 
+{
+	vec3 color = texture(samplerGradientRamp, vec2(inGradientPos, 0.0)).rgb;
+	vec4 sprite = texture(samplerColorMap, gl_PointCoord);
+	outFragColor = vec4(sprite.rgb * color * sprite.a, sprite.a);
+}
@@ -0,0 +1,47 @@
+#version 450
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+#define ALPHAMODE_MASK 1
+
+struct Material
+{
+	vec4 baseColorFactor;
+	uint baseColorTextureIndex;
+	uint normalTextureIndex;
+	uint alphaMode;
+	float alphaCutoff;
+};
+
+layout (set = 1, binding = 1) readonly buffer Materials { Material materials[]; };
+// All textures of the scene, materials without a texture reference an empty texture
+layout (set = 1, binding = 2) uniform sampler2D textures[];
+
+layout (location = 0) in vec3 inNormal;
+layout (location = 1) in vec3 inColor;
+layout (location = 2) in vec2 inUV;
+layout (location = 3) in vec3 inViewVec;
+layout (location = 4) in vec3 inLightVec;
+layout (location = 5) flat in uint inMaterialIndex;
+
+layout (location = 0) out vec4 outFragColor;
+
+void main() 
+{
+	Material material = materials[inMaterialIndex];
+	// Draws of different materials may end up in the same subgroup with multi draw indirect
+	vec4 color = texture(textures[nonuniformEXT(material.baseColorTextureIndex)], inUV) * material.baseColorFactor * vec4(inColor, 1.0);
+
+	if ((material.alphaMode == ALPHAMODE_MASK) && (color.a < material.alphaCutoff)) {
+		discard;
+	}
+
+	const float ambient = 0.25;
+	vec3 N = normalize(inNormal);
+	vec3 L = normalize(inLightVec);
+	vec3 V = normalize(inViewVec);
+	vec3 R = reflect(-L, N);
+	vec3 diffuse = max(dot(N, L), ambient).rrr;
+	float specular = pow(max(dot(R, V), 0.0), 32.0) * 0.25;
+	outFragColor = vec4(diffuse * color.rgb + specular, color.a);
+}
@@ -0,0 +1,48 @@
+#version 450
+
+layout (location = 0) in vec3 inPos;
+layout (location = 1) in vec3 inNormal;
+layout (location = 2) in vec2 inUV;
+layout (location = 3) in vec3 inColor;
+
+layout (set = 0, binding = 0) uniform UBOScene 
+{
+	mat4 projection;
+	mat4 view;
+	vec4 lightPos;
+	vec4 viewPos;
+} uboScene;
+
+struct DrawData
+{
+	mat4 matrix;
+	vec4 boundingSphere;
+	uint materialIndex;
+	uint firstIndex;
+	uint indexCount;
+	int vertexOffset;
+};
+
+// Every indirect draw has a single instance with its index as the first instance
+layout (set = 1, binding = 0) readonly buffer Draws { DrawData draws[]; };
+
+layout (location = 0) out vec3 outNormal;
+layout (location = 1) out vec3 outColor;
+layout (location = 2) out vec2 outUV;
+layout (location = 3) out vec3 outViewVec;
+layout (location = 4) out vec3 outLightVec;
+layout (location = 5) flat out uint outMaterialIndex;
+
+void main() 
+{
+	DrawData draw = draws[gl_InstanceIndex];
+	outColor = inColor;
+	outUV = inUV;
+	outMaterialIndex = draw.materialIndex;
+
+	vec4 pos = draw.matrix * vec4(inPos, 1.0);
+	gl_Position = uboScene.projection * uboScene.view * pos;
+	outNormal = mat3(draw.matrix) * inNormal;
+	outLightVec = uboScene.lightPos.xyz - pos.xyz;
+	outViewVec = uboScene.viewPos.xyz - pos.xyz;
+}
@@ -8,15 +8,18 @@ layout (binding = 0) uniform UBO
 {
 	mat4 projection;
 	mat4 view;
-	mat4 model;
-	vec4 color;
 	vec4 lightPos;
 } ubo;
 
+layout (push_constant) uniform PushConsts {
+	mat4 model;
+	vec4 color;
+} pushConsts;
+
 layout (location = 0) out vec3 outColor;
 
 void main() 
 {
-	outColor = inColor * ubo.color.rgb;
-	gl_Position = ubo.projection * ubo.view * ubo.model * vec4(inPos.xyz, 1.0);
+	outColor = inColor * pushConsts.color.rgb;
+	gl_Position = ubo.projection * ubo.view * pushConsts.model * vec4(inPos.xyz, 1.0);
 }
\ No newline at end of file
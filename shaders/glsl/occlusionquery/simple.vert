@@ -6,14 +6,19 @@ layout (binding = 0) uniform UBO
 {
 	mat4 projection;
 	mat4 view;
-	mat4 model;
-	vec4 color;
 	vec4 lightPos;
 } ubo;
 
+// Transforms the unit cube to the object's bounding box
+layout (push_constant) uniform PushConsts {
+	mat4 model;
+	vec4 color;
+} pushConsts;
+
 layout (location = 0) out vec3 outColor;
 
 void main() 
 {
-	gl_Position = ubo.projection * ubo.view * ubo.model * vec4(inPos.xyz, 1.0);
+	outColor = pushConsts.color.rgb;
+	gl_Position = ubo.projection * ubo.view * pushConsts.model * vec4(inPos.xyz, 1.0);
 }
\ No newline at end of file
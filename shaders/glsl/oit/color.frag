@@ -1,14 +1,22 @@
 #version 450
 
+#extension GL_GOOGLE_include_directive : require
+
 #define MAX_FRAGMENT_COUNT 128
 
 struct Node
 {
-    vec4 color;
+    uint color;
     float depth;
     uint next;
 };
 
+struct Fragment
+{
+    vec4 color;
+    float depth;
+};
+
 layout (location = 0) out vec4 outFragColor;
 
 layout (set = 0, binding = 0, r32ui) uniform uimage2D headIndexImage;
@@ -18,24 +26,71 @@ layout (set = 0, binding = 1) buffer LinkedListSBO
     Node nodes[];
 };
 
+// Tail of the fragments that didn't fit into the node pool
+layout (set = 0, binding = 3) uniform sampler2D samplerAccumulation;
+layout (set = 0, binding = 4) uniform sampler2D samplerRevealage;
+
+layout (set = 0, binding = 5) buffer GeometrySBO
+{
+    uint count;
+    uint maxNodeCount;
+    uint width;
+    uint coveredPixels;
+    uint maxPixelCount;
+    uint overflowPixels;
+};
+
+#include "weightedblend.glsl"
+
 void main()
 {
-    Node fragments[MAX_FRAGMENT_COUNT];
+    Fragment fragments[MAX_FRAGMENT_COUNT];
     int count = 0;
+    uint pixelCount = 0;
+
+    ivec2 pos = ivec2(gl_FragCoord.xy);
+    vec4 accumulation = texelFetch(samplerAccumulation, pos, 0);
+    float revealage = texelFetch(samplerRevealage, pos, 0).r;
+    bool overflow = revealage < 0.0;
 
-    uint nodeIdx = imageLoad(headIndexImage, ivec2(gl_FragCoord.xy)).r;
+    uint nodeIdx = imageLoad(headIndexImage, pos).r;
 
-    while (nodeIdx != 0xffffffff && count < MAX_FRAGMENT_COUNT)
+    while (nodeIdx != 0xffffffff)
+    {
+        Node node = nodes[nodeIdx];
+        vec4 color = unpackUnorm4x8(node.color);
+        if (count < MAX_FRAGMENT_COUNT)
+        {
+            fragments[count].color = color;
+            fragments[count].depth = node.depth;
+            ++count;
+        }
+        else
+        {
+            // Lists longer than what can be sorted are added to the tail too
+            accumulation += wboitAccumulation(color, node.depth);
+            revealage += wboitRevealage(color);
+            overflow = true;
+        }
+        nodeIdx = node.next;
+        ++pixelCount;
+    }
+
+    // Per pixel fragment statistics used to adapt the node pool
+    if (pixelCount > 0)
+    {
+        atomicAdd(coveredPixels, 1);
+        atomicMax(maxPixelCount, pixelCount);
+    }
+    if (overflow)
     {
-        fragments[count] = nodes[nodeIdx];
-        nodeIdx = fragments[count].next;
-        ++count;
+        atomicAdd(overflowPixels, 1);
     }
     
     // Do the insertion sort
     for (uint i = 1; i < count; ++i)
     {
-        Node insert = fragments[i];
+        Fragment insert = fragments[i];
         uint j = i;
         while (j > 0 && insert.depth > fragments[j - 1].depth)
         {
@@ -45,12 +100,12 @@ void main()
         fragments[j] = insert;
     }
 
-    // Do blending
-    vec4 color = vec4(0.025, 0.025, 0.025, 1.0f);
+    // Do blending, the unsorted tail is treated as the farthest layer
+    vec4 color = wboitResolve(accumulation, revealage, vec4(0.025, 0.025, 0.025, 1.0f));
     for (int i = 0; i < count; ++i)
     {
         color = mix(color, fragments[i].color, fragments[i].color.a);
     }
 
     outFragColor = color;
-}
\ No newline at end of file
+}
@@ -0,0 +1,64 @@
+#version 450
+
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_shader_explicit_arithmetic_types_int64 : require
+
+layout (constant_id = 0) const uint KBUFFER_SIZE = 4;
+
+const uint64_t EMPTY_FRAGMENT = 0xffffffffffffffffUL;
+
+layout (location = 0) out vec4 outFragColor;
+
+layout (set = 0, binding = 2) buffer KBufferSBO
+{
+    uint64_t fragments[];
+};
+
+// Tail of the fragments that didn't fit into the k-buffer
+layout (set = 0, binding = 3) uniform sampler2D samplerAccumulation;
+layout (set = 0, binding = 4) uniform sampler2D samplerRevealage;
+
+layout (set = 0, binding = 5) buffer GeometrySBO
+{
+    uint count;
+    uint maxNodeCount;
+    uint width;
+    uint coveredPixels;
+    uint maxPixelCount;
+    uint overflowPixels;
+};
+
+#include "weightedblend.glsl"
+
+void main()
+{
+    ivec2 pos = ivec2(gl_FragCoord.xy);
+    float revealage = texelFetch(samplerRevealage, pos, 0).r;
+    vec4 color = wboitResolve(texelFetch(samplerAccumulation, pos, 0), revealage, vec4(0.025, 0.025, 0.025, 1.0f));
+
+    // The fragments are already sorted front to back, blend them back to front over the tail
+    uint base = (uint(pos.y) * width + uint(pos.x)) * KBUFFER_SIZE;
+    uint pixelCount = 0;
+    for (int i = int(KBUFFER_SIZE) - 1; i >= 0; --i)
+    {
+        uint64_t fragment = fragments[base + i];
+        if (fragment != EMPTY_FRAGMENT)
+        {
+            vec4 fragmentColor = unpackUnorm4x8(uint(fragment));
+            color = mix(color, fragmentColor, fragmentColor.a);
+            ++pixelCount;
+        }
+    }
+
+    if (pixelCount > 0)
+    {
+        atomicAdd(coveredPixels, 1);
+        atomicMax(maxPixelCount, pixelCount);
+    }
+    if (revealage < 0.0)
+    {
+        atomicAdd(overflowPixels, 1);
+    }
+
+    outFragColor = color;
+}
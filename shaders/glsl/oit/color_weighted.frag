@@ -0,0 +1,16 @@
+#version 450
+
+#extension GL_GOOGLE_include_directive : require
+
+layout (location = 0) out vec4 outFragColor;
+
+layout (set = 0, binding = 3) uniform sampler2D samplerAccumulation;
+layout (set = 0, binding = 4) uniform sampler2D samplerRevealage;
+
+#include "weightedblend.glsl"
+
+void main()
+{
+    ivec2 pos = ivec2(gl_FragCoord.xy);
+    outFragColor = wboitResolve(texelFetch(samplerAccumulation, pos, 0), texelFetch(samplerRevealage, pos, 0).r, vec4(0.025, 0.025, 0.025, 1.0f));
+}
@@ -1,10 +1,13 @@
 #version 450
 
+#extension GL_GOOGLE_include_directive : require
+
 layout (early_fragment_tests) in;
 
+// Color packed with 8 bits per channel, depth in view space
 struct Node
 {
-    vec4 color;
+    uint color;
     float depth;
     uint next;
 };
@@ -13,6 +16,10 @@ layout (set = 0, binding = 1) buffer GeometrySBO
 {
     uint count;
     uint maxNodeCount;
+    uint width;
+    uint coveredPixels;
+    uint maxPixelCount;
+    uint overflowPixels;
 };
 
 layout (set = 0, binding = 2, r32ui) uniform coherent uimage2D headIndexImage;
@@ -27,9 +34,17 @@ layout(push_constant) uniform PushConsts {
     vec4 color;
 } pushConsts;
 
+// Unsorted tail for fragments that don't fit into the node pool
+layout (location = 0) out vec4 outAccumulation;
+layout (location = 1) out float outRevealage;
+
+#include "weightedblend.glsl"
+
 void main()
 {
-    // Increase the node count
+    float viewDepth = 1.0 / gl_FragCoord.w;
+
+    // Increase the node count, this also counts the fragments that don't fit so the node pool can be resized to the actual demand
     uint nodeIdx = atomicAdd(count, 1);
 
     // Check LinkedListSBO is full
@@ -39,8 +54,18 @@ void main()
         uint prevHeadIdx = imageAtomicExchange(headIndexImage, ivec2(gl_FragCoord.xy), nodeIdx);
 
         // Store node data
-        nodes[nodeIdx].color = pushConsts.color;
-        nodes[nodeIdx].depth = gl_FragCoord.z;
+        nodes[nodeIdx].color = packUnorm4x8(pushConsts.color);
+        nodes[nodeIdx].depth = viewDepth;
         nodes[nodeIdx].next = prevHeadIdx;
+
+        // Doesn't change the tail
+        outAccumulation = vec4(0.0);
+        outRevealage = 0.0;
+    }
+    else
+    {
+        // Blend the fragment into the tail instead of dropping it
+        outAccumulation = wboitAccumulation(pushConsts.color, viewDepth);
+        outRevealage = wboitRevealage(pushConsts.color);
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,71 @@
+#version 450
+
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_shader_explicit_arithmetic_types_int64 : require
+#extension GL_EXT_shader_atomic_int64 : require
+
+layout (early_fragment_tests) in;
+
+// Number of fragments stored per pixel
+layout (constant_id = 0) const uint KBUFFER_SIZE = 4;
+
+const uint64_t EMPTY_FRAGMENT = 0xffffffffffffffffUL;
+
+layout (set = 0, binding = 1) buffer GeometrySBO
+{
+    uint count;
+    uint maxNodeCount;
+    uint width;
+    uint coveredPixels;
+    uint maxPixelCount;
+    uint overflowPixels;
+};
+
+// Fragments of each pixel, sorted front to back
+layout (set = 0, binding = 4) buffer KBufferSBO
+{
+    uint64_t fragments[];
+};
+
+layout(push_constant) uniform PushConsts {
+	mat4 model;
+    vec4 color;
+} pushConsts;
+
+// Unsorted tail for fragments that don't fit into the k-buffer
+layout (location = 0) out vec4 outAccumulation;
+layout (location = 1) out float outRevealage;
+
+#include "weightedblend.glsl"
+
+void main()
+{
+    float viewDepth = 1.0 / gl_FragCoord.w;
+
+    atomicAdd(count, 1);
+
+    // Depth in the upper bits so fragments are ordered by depth, positive floats keep their order when compared as integers
+    uint64_t fragment = (uint64_t(floatBitsToUint(viewDepth)) << 32) | uint64_t(packUnorm4x8(pushConsts.color));
+
+    // Every slot keeps the nearer of its fragment and the inserted one and passes the farther one on to the next slot
+    uint base = (uint(gl_FragCoord.y) * width + uint(gl_FragCoord.x)) * KBUFFER_SIZE;
+    for (uint i = 0; i < KBUFFER_SIZE && fragment != EMPTY_FRAGMENT; i++)
+    {
+        uint64_t previous = atomicMin(fragments[base + i], fragment);
+        fragment = max(previous, fragment);
+    }
+
+    if (fragment == EMPTY_FRAGMENT)
+    {
+        outAccumulation = vec4(0.0);
+        outRevealage = 0.0;
+    }
+    else
+    {
+        // The farthest fragment didn't fit, it's blended into the tail behind the stored ones
+        vec4 color = unpackUnorm4x8(uint(fragment));
+        float depth = uintBitsToFloat(uint(fragment >> 32));
+        outAccumulation = wboitAccumulation(color, depth);
+        outRevealage = wboitRevealage(color);
+    }
+}
@@ -0,0 +1,22 @@
+#version 450
+
+#extension GL_GOOGLE_include_directive : require
+
+layout (early_fragment_tests) in;
+
+layout(push_constant) uniform PushConsts {
+	mat4 model;
+    vec4 color;
+} pushConsts;
+
+layout (location = 0) out vec4 outAccumulation;
+layout (location = 1) out float outRevealage;
+
+#include "weightedblend.glsl"
+
+void main()
+{
+    float viewDepth = 1.0 / gl_FragCoord.w;
+    outAccumulation = wboitAccumulation(pushConsts.color, viewDepth);
+    outRevealage = wboitRevealage(pushConsts.color);
+}
@@ -0,0 +1,28 @@
+// Weighted blended order independent transparency, see "Weighted Blended Order-Independent Transparency" (McGuire, Bavoil)
+// Used on its own and as the fallback for fragments that don't fit into the linked lists or k-buffers
+// Both targets are blended additively, the revealage is accumulated as a sum of logarithms (of 1 - alpha) so a single blend state works for both
+
+// Fragments close to the camera dominate the weighted average (equation 7 of the paper), viewDepth is the linear view space depth
+float wboitWeight(float alpha, float viewDepth)
+{
+    return alpha * clamp(10.0 / (1e-5 + pow(viewDepth / 5.0, 2.0) + pow(viewDepth / 200.0, 6.0)), 1e-2, 3e3);
+}
+
+vec4 wboitAccumulation(vec4 color, float viewDepth)
+{
+    return vec4(color.rgb * color.a, color.a) * wboitWeight(color.a, viewDepth);
+}
+
+float wboitRevealage(vec4 color)
+{
+    // Fully opaque fragments would result in log(0)
+    return log(1.0 - min(color.a, 0.999));
+}
+
+// Composites the accumulated fragments over a background
+vec4 wboitResolve(vec4 accumulation, float revealage, vec4 background)
+{
+    float reveal = exp(revealage);
+    vec3 average = accumulation.rgb / max(accumulation.a, 1e-5);
+    return vec4(mix(average, background.rgb, reveal), background.a);
+}
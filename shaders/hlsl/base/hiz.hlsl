@@ -0,0 +1,49 @@
+/* Copyright (c) 2025, Sascha Willems
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+// Hierarchical-z occlusion test of bounding spheres against a depth pyramid built by base/depthpyramid.comp (see vks::DepthPyramid)
+// Define HIZ_REVERSED_DEPTH before including for pyramids of reversed depth buffers (vks::DepthPyramid::Reduction::Min)
+
+// Screen space rectangle (in texture coordinates) of a view space sphere in front of the near plane, see "2D Polygonal Bounds of a Sphere" (Mara, McGuire)
+float4 hizProjectSphere(float3 center, float radius, float4x4 projection)
+{
+	// Distance along the view direction
+	float depth = -center.z;
+	float2 cx = float2(center.x, depth);
+	float2 vx = float2(sqrt(dot(cx, cx) - radius * radius), radius);
+	float2 minx = mul(float2x2(vx.x, -vx.y, vx.y, vx.x), cx);
+	float2 maxx = mul(float2x2(vx.x, vx.y, -vx.y, vx.x), cx);
+	float2 cy = float2(center.y, depth);
+	float2 vy = float2(sqrt(dot(cy, cy) - radius * radius), radius);
+	float2 miny = mul(float2x2(vy.x, -vy.y, vy.y, vy.x), cy);
+	float2 maxy = mul(float2x2(vy.x, vy.y, -vy.y, vy.x), cy);
+	float2 x = float2(minx.x / minx.y, maxx.x / maxx.y) * projection[0][0];
+	float2 y = float2(miny.x / miny.y, maxy.x / maxy.y) * projection[1][1];
+	return float4(min(x.x, x.y), min(y.x, y.y), max(x.x, x.y), max(y.x, y.y)) * 0.5 + 0.5;
+}
+
+// Tests the nearest depth of a world space sphere against the farthest depth in the pyramid level where its rectangle covers at most 2 x 2 texels
+bool hizVisible(Texture2D depthPyramid, SamplerState depthPyramidSampler, float2 pyramidSize, float4x4 view, float4x4 projection, float3 center, float radius)
+{
+	float3 viewCenter = mul(view, float4(center, 1.0)).xyz;
+	float znear = projection[2][3] / projection[2][2];
+	// Spheres intersecting the near plane can't be projected and are always visible
+	if (-viewCenter.z - radius <= znear) {
+		return true;
+	}
+	float4 rect = clamp(hizProjectSphere(viewCenter, radius, projection), 0.0, 1.0);
+	float2 size = (rect.zw - rect.xy) * pyramidSize;
+	float level = ceil(log2(max(max(size.x, size.y), 1.0)));
+	float4 depths = float4(
+		depthPyramid.SampleLevel(depthPyramidSampler, rect.xy, level).r, depthPyramid.SampleLevel(depthPyramidSampler, rect.zy, level).r,
+		depthPyramid.SampleLevel(depthPyramidSampler, rect.xw, level).r, depthPyramid.SampleLevel(depthPyramidSampler, rect.zw, level).r);
+	float4 nearest = mul(projection, float4(0.0, 0.0, viewCenter.z + radius, 1.0));
+#ifdef HIZ_REVERSED_DEPTH
+	return nearest.z / nearest.w >= min(min(depths.x, depths.y), min(depths.z, depths.w));
+#else
+	return nearest.z / nearest.w <= max(max(depths.x, depths.y), max(depths.z, depths.w));
+#endif
+}
\ No newline at end of file
@@ -69,6 +69,10 @@ for root, dirs, files in os.walk(dir_path):
                 additional_exts = '-fspv-extension=SPV_EXT_mesh_shader'
                 profile = 'as_6_6'                  
 
+            # The k-buffer shaders use 64 bit atomics
+            if file.find('_kbuffer') != -1:
+                profile = 'ps_6_6'
+
             if root.endswith("debugprintf"):
                 additional_exts = '-fspv-extension=SPV_KHR_non_semantic_info'
 
@@ -0,0 +1,118 @@
+/* Copyright (c) 2025, Sascha Willems
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+// Particle layout, parameters and collision functions shared by the cloth compute shaders
+
+struct Particle {
+	float4 pos;
+	float4 vel;
+	float4 uv;
+	float4 normal;
+};
+
+struct UBO
+{
+	float deltaT;
+	float particleMass;
+	float springStiffness;
+	float damping;
+	float restDistH;
+	float restDistV;
+	float restDistD;
+	float sphereRadius;
+	float4 spherePos;
+	float4 gravity;
+	int2 particleCount;
+	uint collider;
+	float selfCollisionDistance;
+	// xyz: World space position of the first distance field sample, w: Distance between samples
+	float4 sdfOrigin;
+	uint sdfResolution;
+	uint hashTableSize;
+};
+
+cbuffer ubo : register(b2)
+{
+	UBO params;
+};
+
+// Signed distance field of the collider mesh in world space, samples are stored x first, then y, then z
+[[vk::binding(3)]]
+StructuredBuffer<float> sdf;
+
+#define COLLIDER_SPHERE 0
+#define COLLIDER_SDF 1
+#define COLLISION_MARGIN 0.01
+
+// Number of particles a cell of the self collision hash table can hold, further particles are ignored
+#define BUCKET_CAPACITY 8
+
+float3 springForce(float3 p0, float3 p1, float restDist)
+{
+	float3 dist = p0 - p1;
+	return normalize(dist) * params.springStiffness * (length(dist) - restDist);
+}
+
+float sdfSample(int3 coord)
+{
+	int resolution = int(params.sdfResolution);
+	return sdf[(coord.z * resolution + coord.y) * resolution + coord.x];
+}
+
+// Trilinear interpolation, points outside of the field add their distance to its border
+float sdfDistance(float3 pos)
+{
+	float3 coord = (pos - params.sdfOrigin.xyz) / params.sdfOrigin.w;
+	float3 clamped = clamp(coord, float3(0.0, 0.0, 0.0), float(params.sdfResolution - 1).xxx);
+	int3 cell = min(int3(clamped), int(params.sdfResolution - 2).xxx);
+	float3 f = clamped - float3(cell);
+	float x00 = lerp(sdfSample(cell), sdfSample(cell + int3(1, 0, 0)), f.x);
+	float x10 = lerp(sdfSample(cell + int3(0, 1, 0)), sdfSample(cell + int3(1, 1, 0)), f.x);
+	float x01 = lerp(sdfSample(cell + int3(0, 0, 1)), sdfSample(cell + int3(1, 0, 1)), f.x);
+	float x11 = lerp(sdfSample(cell + int3(0, 1, 1)), sdfSample(cell + int3(1, 1, 1)), f.x);
+	float d = lerp(lerp(x00, x10, f.y), lerp(x01, x11, f.y), f.z);
+	return d + length(coord - clamped) * params.sdfOrigin.w;
+}
+
+// Push a particle that's inside of the collider to its surface, returns true if it was moved
+bool collide(inout float3 pos)
+{
+	if (params.collider == COLLIDER_SPHERE) {
+		float3 sphereDist = pos - params.spherePos.xyz;
+		if (length(sphereDist) < params.sphereRadius + COLLISION_MARGIN) {
+			// If the particle is inside the sphere, push it to the outer radius
+			pos = params.spherePos.xyz + normalize(sphereDist) * (params.sphereRadius + COLLISION_MARGIN);
+			return true;
+		}
+		return false;
+	}
+	float d = sdfDistance(pos);
+	if (d >= COLLISION_MARGIN) {
+		return false;
+	}
+	// The surface normal is the gradient of the distance field
+	float h = params.sdfOrigin.w * 0.5;
+	float3 gradient = float3(
+		sdfDistance(pos + float3(h, 0.0, 0.0)) - sdfDistance(pos - float3(h, 0.0, 0.0)),
+		sdfDistance(pos + float3(0.0, h, 0.0)) - sdfDistance(pos - float3(0.0, h, 0.0)),
+		sdfDistance(pos + float3(0.0, 0.0, h)) - sdfDistance(pos - float3(0.0, 0.0, h)));
+	if (dot(gradient, gradient) < 1e-12) {
+		return false;
+	}
+	pos += normalize(gradient) * (COLLISION_MARGIN - d);
+	return true;
+}
+
+// Self collision hash table with cells the size of the collision distance
+int3 hashCell(float3 pos)
+{
+	return int3(floor(pos / params.selfCollisionDistance));
+}
+
+uint hashBucket(int3 cell)
+{
+	return ((uint(cell.x) * 73856093u) ^ (uint(cell.y) * 19349663u) ^ (uint(cell.z) * 83492791u)) & (params.hashTableSize - 1u);
+}
\ No newline at end of file
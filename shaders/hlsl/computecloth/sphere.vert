@@ -27,15 +27,24 @@ cbuffer ubo : register(b0)
 	UBO ubo;
 };
 
+// Places the collider mesh in the scene
+struct PushConsts
+{
+	float4x4 model;
+};
+
+[[vk::push_constant]]
+PushConsts pushConsts;
+
 VSOutput main (VSInput input)
 {
 	VSOutput output = (VSOutput)0;
-	float4 eyePos = mul(ubo.modelview, float4(input.Pos.x, input.Pos.y, input.Pos.z, 1.0));
+	float4 pos = mul(pushConsts.model, float4(input.Pos.x, input.Pos.y, input.Pos.z, 1.0));
+	float4 eyePos = mul(ubo.modelview, pos);
 	output.Pos = mul(ubo.projection, eyePos);
-	float4 pos = float4(input.Pos, 1.0);
 	float3 lPos = ubo.lightPos.xyz;
 	output.LightVec = lPos - pos.xyz;
 	output.ViewVec = -pos.xyz;
-	output.Normal = input.Normal;
+	output.Normal = mul((float3x3)pushConsts.model, input.Normal);
 	return output;
 }
\ No newline at end of file
@@ -0,0 +1,45 @@
+/* Copyright (c) 2025, Sascha Willems
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+// Implicit octree used by the hierarchical N-body shaders, the same layout as the CPU reference in base/NBody.h
+// Level l has 2^l cells per axis, the cells of a level are stored in x, y, z order after the cells of all coarser levels
+// Every cell stores the center of its particles weighted by absolute mass (xyz, weight) and the sum of their masses
+
+#define CELL_STRIDE 5
+
+// The cells are accumulated with atomics, so they are stored as raw bits
+RWStructuredBuffer<uint> cells : register(u2);
+
+struct UBO
+{
+	float deltaT;
+	int particleCount;
+	float gravity;
+	float power;
+	float soften;
+	float theta;
+	uint levels;
+	float boundsSize;
+	float4 boundsMin;
+};
+
+cbuffer ubo : register(b1) { UBO ubo; }
+
+uint levelOffset(uint level)
+{
+	return ((1u << (3u * level)) - 1u) / 7u;
+}
+
+uint cellIndex(uint level, uint3 cell)
+{
+	uint resolution = 1u << level;
+	return levelOffset(level) + cell.x + cell.y * resolution + cell.z * resolution * resolution;
+}
+
+float cellValue(uint cell, uint component)
+{
+	return asfloat(cells[cell * CELL_STRIDE + component]);
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+/* Copyright (c) 2025, Sascha Willems
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+// Premultiplied alpha output for drawing the particles back to front with "over" blending
+
+Texture2D textureColorMap : register(t0);
+SamplerState samplerColorMap : register(s0);
+Texture2D textureGradientRamp : register(t1);
+SamplerState samplerGradientRamp : register(s1);
+
+struct VSOutput
+{
+	float4 Pos : SV_POSITION;
+[[vk::location(0)]] float GradientPos : POSITION0;
+[[vk::location(1)]] float2 CenterPos : POSITION1;
+[[vk::location(2)]] float PointSize : TEXCOORD0;
+};
+
+float4 main (VSOutput input) : SV_TARGET
+{
+	float3 color = textureGradientRamp.Sample(samplerGradientRamp, float2(input.GradientPos, 0.0)).rgb;
+	// There is no point coordinate in HLSL, it's reconstructed from the point center and size passed by particle.vert
+	float2 PointCoord = (input.Pos.xy - input.CenterPos.xy) / input.PointSize + 0.5;
+	float4 sprite = textureColorMap.Sample(samplerColorMap, PointCoord);
+	return float4(sprite.rgb * color * sprite.a, sprite.a);
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+/* Copyright (c) 2025, Sascha Willems
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+#define ALPHAMODE_MASK 1
+
+struct Material
+{
+	float4 baseColorFactor;
+	uint baseColorTextureIndex;
+	uint normalTextureIndex;
+	uint alphaMode;
+	float alphaCutoff;
+};
+
+StructuredBuffer<Material> materials : register(t1, space1);
+// All textures of the scene, materials without a texture reference an empty texture
+Texture2D textures[] : register(t2, space1);
+SamplerState samplerTextures : register(s2, space1);
+
+struct VSOutput
+{
+[[vk::location(0)]] float3 Normal : NORMAL0;
+[[vk::location(1)]] float3 Color : COLOR0;
+[[vk::location(2)]] float2 UV : TEXCOORD0;
+[[vk::location(3)]] float3 ViewVec : TEXCOORD1;
+[[vk::location(4)]] float3 LightVec : TEXCOORD2;
+[[vk::location(5)]] nointerpolation uint MaterialIndex : TEXCOORD3;
+};
+
+float4 main(VSOutput input) : SV_TARGET
+{
+	Material material = materials[input.MaterialIndex];
+	// Draws of different materials may end up in the same subgroup with multi draw indirect
+	float4 color = textures[NonUniformResourceIndex(material.baseColorTextureIndex)].Sample(samplerTextures, input.UV) * material.baseColorFactor * float4(input.Color, 1.0);
+
+	if ((material.alphaMode == ALPHAMODE_MASK) && (color.a < material.alphaCutoff)) {
+		discard;
+	}
+
+	const float ambient = 0.25;
+	float3 N = normalize(input.Normal);
+	float3 L = normalize(input.LightVec);
+	float3 V = normalize(input.ViewVec);
+	float3 R = reflect(-L, N);
+	float3 diffuse = max(dot(N, L), ambient).rrr;
+	float specular = pow(max(dot(R, V), 0.0), 32.0) * 0.25;
+	return float4(diffuse * color.rgb + specular, color.a);
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+/* Copyright (c) 2025, Sascha Willems
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+struct VSInput
+{
+[[vk::location(0)]] float3 Pos : POSITION0;
+[[vk::location(1)]] float3 Normal : NORMAL0;
+[[vk::location(2)]] float2 UV : TEXCOORD0;
+[[vk::location(3)]] float3 Color : COLOR0;
+};
+
+struct UBO
+{
+	float4x4 projection;
+	float4x4 view;
+	float4 lightPos;
+	float4 viewPos;
+};
+cbuffer ubo : register(b0) { UBO ubo; };
+
+struct DrawData
+{
+	float4x4 matrix;
+	float4 boundingSphere;
+	uint materialIndex;
+	uint firstIndex;
+	uint indexCount;
+	int vertexOffset;
+};
+
+// Every indirect draw has a single instance with its index as the first instance
+StructuredBuffer<DrawData> draws : register(t0, space1);
+
+struct VSOutput
+{
+	float4 Pos : SV_POSITION;
+[[vk::location(0)]] float3 Normal : NORMAL0;
+[[vk::location(1)]] float3 Color : COLOR0;
+[[vk::location(2)]] float2 UV : TEXCOORD0;
+[[vk::location(3)]] float3 ViewVec : TEXCOORD1;
+[[vk::location(4)]] float3 LightVec : TEXCOORD2;
+[[vk::location(5)]] nointerpolation uint MaterialIndex : TEXCOORD3;
+};
+
+// SV_InstanceID includes the first instance of the draw unless compiled with -fvk-support-nonzero-base-instance
+VSOutput main(VSInput input, uint InstanceIndex : SV_InstanceID)
+{
+	DrawData draw = draws[InstanceIndex];
+	VSOutput output = (VSOutput)0;
+	output.Color = input.Color;
+	output.UV = input.UV;
+	output.MaterialIndex = draw.materialIndex;
+
+	float4 pos = mul(draw.matrix, float4(input.Pos, 1.0));
+	output.Pos = mul(ubo.projection, mul(ubo.view, pos));
+	output.Normal = mul((float3x3)draw.matrix, input.Normal);
+	output.LightVec = ubo.lightPos.xyz - pos.xyz;
+	output.ViewVec = ubo.viewPos.xyz - pos.xyz;
+	return output;
+}
\ No newline at end of file
@@ -10,35 +10,38 @@ struct VSInput
 struct UBO
 {
 	float4x4 projection;
-	float4x4 modelview;
+	float4x4 view;
 	float4 lightPos;
-	float visible;
 };
 
 cbuffer ubo : register(b0) { UBO ubo; }
 
+struct PushConsts
+{
+	float4x4 model;
+	float4 color;
+};
+[[vk::push_constant]] PushConsts pushConsts;
+
 struct VSOutput
 {
 	float4 Pos : SV_POSITION;
 [[vk::location(0)]] float3 Normal : NORMAL0;
 [[vk::location(1)]] float3 Color : COLOR0;
-[[vk::location(2)]] float Visible : TEXCOORD3;
-[[vk::location(3)]] float3 ViewVec : TEXCOORD1;
-[[vk::location(4)]] float3 LightVec : TEXCOORD2;
+[[vk::location(2)]] float3 ViewVec : TEXCOORD1;
+[[vk::location(3)]] float3 LightVec : TEXCOORD2;
 };
 
 VSOutput main(VSInput input)
 {
 	VSOutput output = (VSOutput)0;
-	output.Normal = input.Normal;
-	output.Color = input.Color;
-	output.Visible = ubo.visible;
+	output.Color = input.Color * pushConsts.color.rgb;
 
-	output.Pos = mul(ubo.projection, mul(ubo.modelview, float4(input.Pos.xyz, 1.0)));
+	output.Pos = mul(ubo.projection, mul(ubo.view, mul(pushConsts.model, float4(input.Pos.xyz, 1.0))));
 
-    float4 pos = mul(ubo.modelview, float4(input.Pos, 1.0));
-    output.Normal = mul((float3x3)ubo.modelview, input.Normal);
-    output.LightVec = ubo.lightPos.xyz - pos.xyz;
-    output.ViewVec = -pos.xyz;
+	float4 pos = mul(pushConsts.model, float4(input.Pos, 1.0));
+	output.Normal = mul((float3x3)pushConsts.model, input.Normal);
+	output.LightVec = ubo.lightPos.xyz - pos.xyz;
+	output.ViewVec = -pos.xyz;
 	return output;
 }
\ No newline at end of file
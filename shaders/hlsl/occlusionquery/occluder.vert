@@ -10,12 +10,19 @@ struct VSInput
 struct UBO
 {
 	float4x4 projection;
-	float4x4 modelview;
+	float4x4 view;
 	float4 lightPos;
 };
 
 cbuffer ubo : register(b0) { UBO ubo; }
 
+struct PushConsts
+{
+	float4x4 model;
+	float4 color;
+};
+[[vk::push_constant]] PushConsts pushConsts;
+
 struct VSOutput
 {
 	float4 Pos : SV_POSITION;
@@ -25,7 +32,7 @@ struct VSOutput
 VSOutput main(VSInput input)
 {
 	VSOutput output = (VSOutput)0;
-	output.Color = input.Color;
-	output.Pos = mul(ubo.projection, mul(ubo.modelview, float4(input.Pos.xyz, 1.0)));
+	output.Color = input.Color * pushConsts.color.rgb;
+	output.Pos = mul(ubo.projection, mul(ubo.view, mul(pushConsts.model, float4(input.Pos.xyz, 1.0))));
 	return output;
 }
\ No newline at end of file
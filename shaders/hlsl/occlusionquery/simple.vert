@@ -3,12 +3,20 @@
 struct UBO
 {
 	float4x4 projection;
-	float4x4 modelview;
+	float4x4 view;
 	float4 lightPos;
 };
 
 cbuffer ubo : register(b0) { UBO ubo; }
 
+// Transforms the unit cube to the object's bounding box
+struct PushConsts
+{
+	float4x4 model;
+	float4 color;
+};
+[[vk::push_constant]] PushConsts pushConsts;
+
 struct VSOutput
 {
 	float4 Pos : SV_POSITION;
@@ -18,6 +26,7 @@ struct VSOutput
 VSOutput main([[vk::location(0)]] float3 Pos : POSITION0)
 {
 	VSOutput output = (VSOutput)0;
-	output.Pos = mul(ubo.projection, mul(ubo.modelview, float4(Pos.xyz, 1.0)));
+	output.Color = pushConsts.color.rgb;
+	output.Pos = mul(ubo.projection, mul(ubo.view, mul(pushConsts.model, float4(Pos.xyz, 1.0))));
 	return output;
 }
\ No newline at end of file
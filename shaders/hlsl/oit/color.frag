@@ -9,41 +9,89 @@ struct VSOutput
 
 struct Node
 {
-    float4 color;
+    uint color;
     float depth;
     uint next;
 };
 
+struct Fragment
+{
+    float4 color;
+    float depth;
+};
+
 RWTexture2D<uint> headIndexImage : register(u0);
 
-struct Particle
+RWStructuredBuffer<Node> nodes : register(u1);
+
+// Tail of the fragments that didn't fit into the node pool
+Texture2D textureAccumulation : register(t3);
+SamplerState samplerAccumulation : register(s3);
+Texture2D textureRevealage : register(t4);
+SamplerState samplerRevealage : register(s4);
+
+struct GeometrySBO
 {
-	float2 pos;
-	float2 vel;
-	float4 gradientPos;
+    uint count;
+    uint maxNodeCount;
+    uint width;
+    uint coveredPixels;
+    uint maxPixelCount;
+    uint overflowPixels;
 };
+RWStructuredBuffer<GeometrySBO> geometrySBO : register(u5);
 
-// Binding 0 : Position storage buffer
-RWStructuredBuffer<Node> nodes : register(u1);
+#include "weightedblend.hlsl"
 
 float4 main(VSOutput input) : SV_TARGET
 {
-    Node fragments[MAX_FRAGMENT_COUNT];
+    Fragment fragments[MAX_FRAGMENT_COUNT];
     int count = 0;
+    uint pixelCount = 0;
+
+    int3 pos = int3(input.Pos.xy, 0);
+    float4 accumulation = textureAccumulation.Load(pos);
+    float revealage = textureRevealage.Load(pos).r;
+    bool overflow = revealage < 0.0;
 
     uint nodeIdx = headIndexImage[uint2(input.Pos.xy)].r;
 
-    while (nodeIdx != 0xffffffff && count < MAX_FRAGMENT_COUNT)
+    while (nodeIdx != 0xffffffff)
+    {
+        Node node = nodes[nodeIdx];
+        float4 color = decodeUnorm4x8(node.color);
+        if (count < MAX_FRAGMENT_COUNT)
+        {
+            fragments[count].color = color;
+            fragments[count].depth = node.depth;
+            ++count;
+        }
+        else
+        {
+            // Lists longer than what can be sorted are added to the tail too
+            accumulation += wboitAccumulation(color, node.depth);
+            revealage += wboitRevealage(color);
+            overflow = true;
+        }
+        nodeIdx = node.next;
+        ++pixelCount;
+    }
+
+    // Per pixel fragment statistics used to adapt the node pool
+    if (pixelCount > 0)
+    {
+        InterlockedAdd(geometrySBO[0].coveredPixels, 1);
+        InterlockedMax(geometrySBO[0].maxPixelCount, pixelCount);
+    }
+    if (overflow)
     {
-        fragments[count] = nodes[nodeIdx];
-        nodeIdx = fragments[count].next;
-        ++count;
+        InterlockedAdd(geometrySBO[0].overflowPixels, 1);
     }
     
     // Do the insertion sort
     for (uint i = 1; i < count; ++i)
     {
-        Node insert = fragments[i];
+        Fragment insert = fragments[i];
         uint j = i;
         while (j > 0 && insert.depth > fragments[j - 1].depth)
         {
@@ -53,8 +101,8 @@ float4 main(VSOutput input) : SV_TARGET
         fragments[j] = insert;
     }
 
-    // Do blending
-    float4 color = float4(0.025, 0.025, 0.025, 1.0f);
+    // Do blending, the unsorted tail is treated as the farthest layer
+    float4 color = wboitResolve(accumulation, revealage, float4(0.025, 0.025, 0.025, 1.0f));
     for (uint f = 0; f < count; ++f)
     {
         color = lerp(color, fragments[f].color, fragments[f].color.a);
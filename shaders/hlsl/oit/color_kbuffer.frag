@@ -0,0 +1,70 @@
+/* Copyright (c) 2025, Sascha Willems
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+// Uses 64 bit types, compiled with shader model 6.6
+
+[[vk::constant_id(0)]] const uint KBUFFER_SIZE = 4;
+
+static const uint64_t EMPTY_FRAGMENT = ~uint64_t(0);
+
+struct VSOutput
+{
+	float4 Pos : SV_POSITION;
+};
+
+RWStructuredBuffer<uint64_t> fragments : register(u2);
+
+// Tail of the fragments that didn't fit into the k-buffer
+Texture2D textureAccumulation : register(t3);
+SamplerState samplerAccumulation : register(s3);
+Texture2D textureRevealage : register(t4);
+SamplerState samplerRevealage : register(s4);
+
+struct GeometrySBO
+{
+    uint count;
+    uint maxNodeCount;
+    uint width;
+    uint coveredPixels;
+    uint maxPixelCount;
+    uint overflowPixels;
+};
+RWStructuredBuffer<GeometrySBO> geometrySBO : register(u5);
+
+#include "weightedblend.hlsl"
+
+float4 main(VSOutput input) : SV_TARGET
+{
+    int3 pos = int3(input.Pos.xy, 0);
+    float revealage = textureRevealage.Load(pos).r;
+    float4 color = wboitResolve(textureAccumulation.Load(pos), revealage, float4(0.025, 0.025, 0.025, 1.0f));
+
+    // The fragments are already sorted front to back, blend them back to front over the tail
+    uint base = (uint(pos.y) * geometrySBO[0].width + uint(pos.x)) * KBUFFER_SIZE;
+    uint pixelCount = 0;
+    for (int i = int(KBUFFER_SIZE) - 1; i >= 0; --i)
+    {
+        uint64_t fragment = fragments[base + i];
+        if (fragment != EMPTY_FRAGMENT)
+        {
+            float4 fragmentColor = decodeUnorm4x8(uint(fragment));
+            color = lerp(color, fragmentColor, fragmentColor.a);
+            ++pixelCount;
+        }
+    }
+
+    if (pixelCount > 0)
+    {
+        InterlockedAdd(geometrySBO[0].coveredPixels, 1);
+        InterlockedMax(geometrySBO[0].maxPixelCount, pixelCount);
+    }
+    if (revealage < 0.0)
+    {
+        InterlockedAdd(geometrySBO[0].overflowPixels, 1);
+    }
+
+    return color;
+}
\ No newline at end of file
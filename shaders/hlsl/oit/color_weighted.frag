@@ -0,0 +1,23 @@
+/* Copyright (c) 2025, Sascha Willems
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+struct VSOutput
+{
+	float4 Pos : SV_POSITION;
+};
+
+Texture2D textureAccumulation : register(t3);
+SamplerState samplerAccumulation : register(s3);
+Texture2D textureRevealage : register(t4);
+SamplerState samplerRevealage : register(s4);
+
+#include "weightedblend.hlsl"
+
+float4 main(VSOutput input) : SV_TARGET
+{
+    int3 pos = int3(input.Pos.xy, 0);
+    return wboitResolve(textureAccumulation.Load(pos), textureRevealage.Load(pos).r, float4(0.025, 0.025, 0.025, 1.0f));
+}
\ No newline at end of file
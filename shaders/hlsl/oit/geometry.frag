@@ -5,9 +5,10 @@ struct VSOutput
 	float4 Pos : SV_POSITION;
 };
 
+// Color packed with 8 bits per channel, depth in view space
 struct Node
 {
-    float4 color;
+    uint color;
     float depth;
     uint next;
 };
@@ -16,6 +17,10 @@ struct GeometrySBO
 {
     uint count;
     uint maxNodeCount;
+    uint width;
+    uint coveredPixels;
+    uint maxPixelCount;
+    uint overflowPixels;
 };
 // Binding 0 : Position storage buffer
 RWStructuredBuffer<GeometrySBO> geometrySBO : register(u1);
@@ -30,10 +35,22 @@ struct PushConsts {
 };
 [[vk::push_constant]] PushConsts pushConsts;
 
+// Unsorted tail for fragments that don't fit into the node pool
+struct FSOutput
+{
+	float4 Accumulation : SV_TARGET0;
+	float Revealage : SV_TARGET1;
+};
+
+#include "weightedblend.hlsl"
+
 [earlydepthstencil]
-void main(VSOutput input)
+FSOutput main(VSOutput input)
 {
-    // Increase the node count
+    FSOutput output;
+    float viewDepth = 1.0 / input.Pos.w;
+
+    // Increase the node count, this also counts the fragments that don't fit so the node pool can be resized to the actual demand
     uint nodeIdx;
     InterlockedAdd(geometrySBO[0].count, 1, nodeIdx);
 
@@ -45,8 +62,19 @@ void main(VSOutput input)
         InterlockedExchange(headIndexImage[uint2(input.Pos.xy)], nodeIdx, prevHeadIdx);
 
         // Store node data
-        nodes[nodeIdx].color = pushConsts.color;
-        nodes[nodeIdx].depth = input.Pos.z;
+        nodes[nodeIdx].color = encodeUnorm4x8(pushConsts.color);
+        nodes[nodeIdx].depth = viewDepth;
         nodes[nodeIdx].next = prevHeadIdx;
+
+        // Doesn't change the tail
+        output.Accumulation = float4(0.0, 0.0, 0.0, 0.0);
+        output.Revealage = 0.0;
+    }
+    else
+    {
+        // Blend the fragment into the tail instead of dropping it
+        output.Accumulation = wboitAccumulation(pushConsts.color, viewDepth);
+        output.Revealage = wboitRevealage(pushConsts.color);
     }
+    return output;
 }
\ No newline at end of file
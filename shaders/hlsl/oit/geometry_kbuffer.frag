@@ -0,0 +1,82 @@
+/* Copyright (c) 2025, Sascha Willems
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+// Uses 64 bit atomics, compiled with shader model 6.6
+
+// Number of fragments stored per pixel
+[[vk::constant_id(0)]] const uint KBUFFER_SIZE = 4;
+
+static const uint64_t EMPTY_FRAGMENT = ~uint64_t(0);
+
+struct VSOutput
+{
+	float4 Pos : SV_POSITION;
+};
+
+struct GeometrySBO
+{
+    uint count;
+    uint maxNodeCount;
+    uint width;
+    uint coveredPixels;
+    uint maxPixelCount;
+    uint overflowPixels;
+};
+RWStructuredBuffer<GeometrySBO> geometrySBO : register(u1);
+
+// Fragments of each pixel, sorted front to back
+RWStructuredBuffer<uint64_t> fragments : register(u4);
+
+struct PushConsts {
+	float4x4 model;
+	float4 color;
+};
+[[vk::push_constant]] PushConsts pushConsts;
+
+// Unsorted tail for fragments that don't fit into the k-buffer
+struct FSOutput
+{
+	float4 Accumulation : SV_TARGET0;
+	float Revealage : SV_TARGET1;
+};
+
+#include "weightedblend.hlsl"
+
+[earlydepthstencil]
+FSOutput main(VSOutput input)
+{
+    FSOutput output;
+    float viewDepth = 1.0 / input.Pos.w;
+
+    InterlockedAdd(geometrySBO[0].count, 1);
+
+    // Depth in the upper bits so fragments are ordered by depth, positive floats keep their order when compared as integers
+    uint64_t fragment = (uint64_t(asuint(viewDepth)) << 32) | uint64_t(encodeUnorm4x8(pushConsts.color));
+
+    // Every slot keeps the nearer of its fragment and the inserted one and passes the farther one on to the next slot
+    uint base = (uint(input.Pos.y) * geometrySBO[0].width + uint(input.Pos.x)) * KBUFFER_SIZE;
+    for (uint i = 0; i < KBUFFER_SIZE && fragment != EMPTY_FRAGMENT; i++)
+    {
+        uint64_t previous;
+        InterlockedMin(fragments[base + i], fragment, previous);
+        fragment = max(previous, fragment);
+    }
+
+    if (fragment == EMPTY_FRAGMENT)
+    {
+        output.Accumulation = float4(0.0, 0.0, 0.0, 0.0);
+        output.Revealage = 0.0;
+    }
+    else
+    {
+        // The farthest fragment didn't fit, it's blended into the tail behind the stored ones
+        float4 color = decodeUnorm4x8(uint(fragment));
+        float depth = asfloat(uint(fragment >> 32));
+        output.Accumulation = wboitAccumulation(color, depth);
+        output.Revealage = wboitRevealage(color);
+    }
+    return output;
+}
\ No newline at end of file
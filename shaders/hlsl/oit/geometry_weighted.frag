@@ -0,0 +1,34 @@
+/* Copyright (c) 2025, Sascha Willems
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+struct VSOutput
+{
+	float4 Pos : SV_POSITION;
+};
+
+struct PushConsts {
+	float4x4 model;
+	float4 color;
+};
+[[vk::push_constant]] PushConsts pushConsts;
+
+struct FSOutput
+{
+	float4 Accumulation : SV_TARGET0;
+	float Revealage : SV_TARGET1;
+};
+
+#include "weightedblend.hlsl"
+
+[earlydepthstencil]
+FSOutput main(VSOutput input)
+{
+    FSOutput output;
+    float viewDepth = 1.0 / input.Pos.w;
+    output.Accumulation = wboitAccumulation(pushConsts.color, viewDepth);
+    output.Revealage = wboitRevealage(pushConsts.color);
+    return output;
+}
\ No newline at end of file
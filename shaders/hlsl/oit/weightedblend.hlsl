@@ -0,0 +1,46 @@
+/* Copyright (c) 2025, Sascha Willems
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ */
+
+// Weighted blended order independent transparency, see "Weighted Blended Order-Independent Transparency" (McGuire, Bavoil)
+// Used on its own and as the fallback for fragments that don't fit into the linked lists or k-buffers
+// Both targets are blended additively, the revealage is accumulated as a sum of logarithms (of 1 - alpha) so a single blend state works for both
+
+// Fragments close to the camera dominate the weighted average (equation 7 of the paper), viewDepth is the linear view space depth
+float wboitWeight(float alpha, float viewDepth)
+{
+    return alpha * clamp(10.0 / (1e-5 + pow(viewDepth / 5.0, 2.0) + pow(viewDepth / 200.0, 6.0)), 1e-2, 3e3);
+}
+
+float4 wboitAccumulation(float4 color, float viewDepth)
+{
+    return float4(color.rgb * color.a, color.a) * wboitWeight(color.a, viewDepth);
+}
+
+float wboitRevealage(float4 color)
+{
+    // Fully opaque fragments would result in log(0)
+    return log(1.0 - min(color.a, 0.999));
+}
+
+// Composites the accumulated fragments over a background
+float4 wboitResolve(float4 accumulation, float revealage, float4 background)
+{
+    float reveal = exp(revealage);
+    float3 average = accumulation.rgb / max(accumulation.a, 1e-5);
+    return float4(lerp(average, background.rgb, reveal), background.a);
+}
+
+// Same as the GLSL packUnorm4x8 and unpackUnorm4x8 built-ins, used for the colors stored per fragment
+uint encodeUnorm4x8(float4 value)
+{
+    uint4 bytes = uint4(round(saturate(value) * 255.0));
+    return bytes.x | (bytes.y << 8) | (bytes.z << 16) | (bytes.w << 24);
+}
+
+float4 decodeUnorm4x8(uint value)
+{
+    return float4(value & 0xFF, (value >> 8) & 0xFF, (value >> 16) & 0xFF, value >> 24) / 255.0;
+}
\ No newline at end of file
@@ -0,0 +1,278 @@
+/*
+* Mesh analyzer
+*
+* CPU only command line tool that reports vertex cache, overdraw and vertex fetch statistics of all primitives of a glTF file,
+* before and after the mesh optimization done by the glTF loader with vkglTF::FileLoadingFlags::OptimizeMeshes,
+* plus the level of detail chain generated with vkglTF::FileLoadingFlags::GenerateLods and the meshlets built with vkglTF::FileLoadingFlags::BuildMeshlets
+* Meshlets are validated to contain every triangle of the primitive exactly once and to stay within the limits, failures set a non-zero exit code
+*
+* Usage: meshanalyzer file.gltf|file.glb [overdraw threshold]
+*
+* Copyright (C) 2016-2025 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_NO_STB_IMAGE
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#define TINYGLTF_NO_EXTERNAL_IMAGE
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "tiny_gltf.h"
+#include "MeshOptimizer.h"
+
+// Same attributes that identify a vertex in the loader, minus those that are rarely present
+struct AnalyzerVertex {
+	float pos[3];
+	float normal[3];
+	float uv[2];
+};
+
+struct MeshStatistics {
+	vks::meshoptimizer::VertexCacheStatistics cache;
+	vks::meshoptimizer::OverdrawStatistics overdraw;
+	vks::meshoptimizer::VertexFetchStatistics fetch;
+	size_t triangleCount = 0;
+	size_t vertexCount = 0;
+	size_t indexSize = sizeof(uint32_t);
+	float bytesPerTriangle = 0.0f;
+};
+
+// Images aren't needed for the analysis
+bool skipImageData(tinygltf::Image*, const int, std::string*, std::string*, int, int, const unsigned char*, int, void*)
+{
+	return true;
+}
+
+template<typename T>
+void readAttribute(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const char* name, std::vector<AnalyzerVertex>& vertices, size_t offset, uint32_t componentCount)
+{
+	const auto attribute = primitive.attributes.find(name);
+	if (attribute == primitive.attributes.end()) {
+		return;
+	}
+	const tinygltf::Accessor& accessor = model.accessors[attribute->second];
+	const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+	const uint8_t* data = &model.buffers[bufferView.buffer].data[accessor.byteOffset + bufferView.byteOffset];
+	const size_t stride = accessor.ByteStride(bufferView);
+	vertices.resize(accessor.count);
+	for (size_t v = 0; v < accessor.count; v++) {
+		const T* source = reinterpret_cast<const T*>(data + v * stride);
+		float* destination = reinterpret_cast<float*>(reinterpret_cast<uint8_t*>(&vertices[v]) + offset);
+		for (uint32_t c = 0; c < componentCount; c++) {
+			destination[c] = static_cast<float>(source[c]);
+		}
+	}
+}
+
+std::vector<uint32_t> readIndices(const tinygltf::Model& model, const tinygltf::Primitive& primitive)
+{
+	const tinygltf::Accessor& accessor = model.accessors[primitive.indices];
+	const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+	const uint8_t* data = &model.buffers[bufferView.buffer].data[accessor.byteOffset + bufferView.byteOffset];
+	std::vector<uint32_t> indices(accessor.count);
+	for (size_t i = 0; i < accessor.count; i++) {
+		switch (accessor.componentType) {
+		case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT:
+			indices[i] = reinterpret_cast<const uint32_t*>(data)[i];
+			break;
+		case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
+			indices[i] = reinterpret_cast<const uint16_t*>(data)[i];
+			break;
+		default:
+			indices[i] = data[i];
+		}
+	}
+	return indices;
+}
+
+MeshStatistics analyze(const std::vector<uint32_t>& indices, const std::vector<AnalyzerVertex>& vertices, size_t indexSize)
+{
+	MeshStatistics statistics{};
+	statistics.cache = vks::meshoptimizer::analyzeVertexCache(indices, vertices.size());
+	statistics.overdraw = vks::meshoptimizer::analyzeOverdraw(indices, vertices[0].pos, sizeof(AnalyzerVertex), vertices.size());
+	statistics.fetch = vks::meshoptimizer::analyzeVertexFetch(indices, vertices.size(), sizeof(AnalyzerVertex));
+	statistics.triangleCount = indices.size() / 3;
+	statistics.vertexCount = vertices.size();
+	statistics.indexSize = indexSize;
+	statistics.bytesPerTriangle = static_cast<float>(vertices.size() * sizeof(AnalyzerVertex) + indices.size() * indexSize) / static_cast<float>(std::max(statistics.triangleCount, size_t(1)));
+	return statistics;
+}
+
+// Triangle with its smallest index first, keeping the winding
+std::array<uint32_t, 3> normalizedTriangle(uint32_t a, uint32_t b, uint32_t c)
+{
+	if ((b < a) && (b < c)) {
+		return { b, c, a };
+	}
+	if ((c < a) && (c < b)) {
+		return { c, a, b };
+	}
+	return { a, b, c };
+}
+
+// Checks that the meshlets reference every triangle of indices exactly once with the same winding and respect the limits
+bool validateMeshlets(const std::vector<uint32_t>& indices, const std::vector<vks::meshoptimizer::Meshlet>& meshlets, const std::vector<uint32_t>& meshletVertices, const std::vector<uint8_t>& meshletTriangles, uint32_t maxVertices, uint32_t maxTriangles)
+{
+	std::vector<std::array<uint32_t, 3>> expected, found;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		expected.push_back(normalizedTriangle(indices[i], indices[i + 1], indices[i + 2]));
+	}
+	for (const vks::meshoptimizer::Meshlet& meshlet : meshlets) {
+		if ((meshlet.vertexCount > maxVertices) || (meshlet.triangleCount > maxTriangles)) {
+			printf("  meshlet exceeds the limits with %u vertices and %u triangles\n", meshlet.vertexCount, meshlet.triangleCount);
+			return false;
+		}
+		for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+			const uint8_t* local = &meshletTriangles[(meshlet.triangleOffset + t) * 3];
+			if ((local[0] >= meshlet.vertexCount) || (local[1] >= meshlet.vertexCount) || (local[2] >= meshlet.vertexCount)) {
+				printf("  meshlet references a vertex out of its range\n");
+				return false;
+			}
+			const uint32_t* vertices = &meshletVertices[meshlet.vertexOffset];
+			found.push_back(normalizedTriangle(vertices[local[0]], vertices[local[1]], vertices[local[2]]));
+		}
+	}
+	std::sort(expected.begin(), expected.end());
+	std::sort(found.begin(), found.end());
+	if (expected != found) {
+		printf("  meshlets contain %zu triangles instead of the %zu triangles of the primitive\n", found.size(), expected.size());
+		return false;
+	}
+	return true;
+}
+
+void print(const char* label, const MeshStatistics& statistics)
+{
+	printf("  %-9s %8zu tris %8zu verts  ACMR %.3f  ATVR %.3f  overdraw %.3f  overfetch %.3f  %2zu bit indices  %.1f bytes/tri\n",
+		label, statistics.triangleCount, statistics.vertexCount, statistics.cache.acmr, statistics.cache.atvr, statistics.overdraw.overdraw, statistics.fetch.overfetch, statistics.indexSize * 8, statistics.bytesPerTriangle);
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2) {
+		printf("Usage: meshanalyzer file.gltf|file.glb [overdraw threshold]\n");
+		return 1;
+	}
+	const std::string filename = argv[1];
+	const float threshold = argc > 2 ? std::stof(argv[2]) : vks::meshoptimizer::defaultOverdrawThreshold;
+
+	tinygltf::Model model;
+	tinygltf::TinyGLTF gltfContext;
+	gltfContext.SetImageLoader(skipImageData, nullptr);
+	std::string error, warning;
+	const bool binary = (filename.size() > 4) && (filename.substr(filename.size() - 4) == ".glb");
+	const bool loaded = binary ? gltfContext.LoadBinaryFromFile(&model, &error, &warning, filename) : gltfContext.LoadASCIIFromFile(&model, &error, &warning, filename);
+	if (!loaded) {
+		printf("Could not load glTF file \"%s\": %s\n", filename.c_str(), error.c_str());
+		return 1;
+	}
+
+	MeshStatistics totalBefore{}, totalAfter{};
+	totalBefore.indexSize = totalAfter.indexSize = 0;
+	size_t totalMeshlets = 0;
+	bool meshletsValid = true;
+	for (size_t m = 0; m < model.meshes.size(); m++) {
+		for (size_t p = 0; p < model.meshes[m].primitives.size(); p++) {
+			const tinygltf::Primitive& primitive = model.meshes[m].primitives[p];
+			if ((primitive.indices < 0) || (primitive.mode != TINYGLTF_MODE_TRIANGLES)) {
+				continue;
+			}
+			std::vector<AnalyzerVertex> vertices;
+			readAttribute<float>(model, primitive, "POSITION", vertices, offsetof(AnalyzerVertex, pos), 3);
+			readAttribute<float>(model, primitive, "NORMAL", vertices, offsetof(AnalyzerVertex, normal), 3);
+			readAttribute<float>(model, primitive, "TEXCOORD_0", vertices, offsetof(AnalyzerVertex, uv), 2);
+			std::vector<uint32_t> indices = readIndices(model, primitive);
+			if (vertices.empty() || indices.empty()) {
+				continue;
+			}
+
+			// Loaded as is, with 32 bit indices like the loader without optimization
+			const MeshStatistics before = analyze(indices, vertices, sizeof(uint32_t));
+
+			// Same steps as vkglTF::Model::optimizeMeshes
+			std::vector<uint32_t> remap;
+			const size_t uniqueCount = vks::meshoptimizer::generateVertexRemap(remap, indices, vertices.data(), vertices.size(), sizeof(AnalyzerVertex));
+			std::vector<AnalyzerVertex> uniqueVertices(uniqueCount);
+			vks::meshoptimizer::remapIndices(indices, remap);
+			vks::meshoptimizer::remapVertices(uniqueVertices.data(), vertices.data(), vertices.size(), sizeof(AnalyzerVertex), remap);
+			vks::meshoptimizer::optimizeVertexCache(indices, uniqueCount);
+			vks::meshoptimizer::optimizeOverdraw(indices, uniqueVertices[0].pos, sizeof(AnalyzerVertex), uniqueCount, threshold);
+			vks::meshoptimizer::generateVertexFetchRemap(remap, indices, uniqueCount);
+			vks::meshoptimizer::remapIndices(indices, remap);
+			vks::meshoptimizer::remapVertices(vertices.data(), uniqueVertices.data(), uniqueCount, sizeof(AnalyzerVertex), remap);
+			vertices.resize(uniqueCount);
+			const MeshStatistics after = analyze(indices, vertices, uniqueCount <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t));
+
+			printf("Mesh %zu \"%s\" primitive %zu\n", m, model.meshes[m].name.c_str(), p);
+			print("original", before);
+			print("optimized", after);
+
+			// Same settings as the defaults of vkglTF::Model::generateLods
+			const uint32_t lodCount = 4;
+			const float lodReduction = 0.5f;
+			const float lodMaxError = 0.05f;
+			for (uint32_t level = 1; level < lodCount; level++) {
+				std::vector<uint32_t> lodIndices = indices;
+				const size_t targetCount = static_cast<size_t>(static_cast<float>(indices.size()) * std::pow(lodReduction, static_cast<float>(level))) / 3 * 3;
+				const float error = vks::meshoptimizer::simplify(lodIndices, vertices[0].pos, sizeof(AnalyzerVertex), vertices.size(), targetCount, lodMaxError, vertices[0].normal, sizeof(AnalyzerVertex), 5);
+				printf("  lod %u     %8zu tris  error %g\n", level, lodIndices.size() / 3, error);
+			}
+
+			// Same limits as the defaults of vkglTF::Model::buildMeshlets
+			std::vector<vks::meshoptimizer::Meshlet> meshlets;
+			std::vector<uint32_t> meshletVertices;
+			std::vector<uint8_t> meshletTriangles;
+			const size_t meshletCount = vks::meshoptimizer::buildMeshlets(meshlets, meshletVertices, meshletTriangles, indices, vertices[0].pos, sizeof(AnalyzerVertex), vertices.size());
+			if (!validateMeshlets(indices, meshlets, meshletVertices, meshletTriangles, vks::meshoptimizer::defaultMeshletMaxVertices, vks::meshoptimizer::defaultMeshletMaxTriangles)) {
+				meshletsValid = false;
+			}
+			size_t coneCullable = 0;
+			for (const vks::meshoptimizer::Meshlet& meshlet : meshlets) {
+				if (vks::meshoptimizer::computeMeshletBounds(meshlet, meshletVertices, meshletTriangles, vertices[0].pos, sizeof(AnalyzerVertex)).coneCutoff < 1.0f) {
+					coneCullable++;
+				}
+			}
+			printf("  meshlets  %8zu       %6.1f verts/meshlet  %6.1f tris/meshlet  %zu with a usable normal cone\n", meshletCount,
+				static_cast<float>(meshletVertices.size()) / static_cast<float>(std::max(meshletCount, size_t(1))),
+				static_cast<float>(meshletTriangles.size() / 3) / static_cast<float>(std::max(meshletCount, size_t(1))), coneCullable);
+			totalMeshlets += meshletCount;
+
+			for (auto [total, statistics] : { std::make_pair(&totalBefore, &before), std::make_pair(&totalAfter, &after) }) {
+				total->triangleCount += statistics->triangleCount;
+				total->vertexCount += statistics->vertexCount;
+				total->cache.verticesTransformed += statistics->cache.verticesTransformed;
+				total->overdraw.pixelsCovered += statistics->overdraw.pixelsCovered;
+				total->overdraw.pixelsShaded += statistics->overdraw.pixelsShaded;
+				total->fetch.bytesFetched += statistics->fetch.bytesFetched;
+				total->bytesPerTriangle += statistics->bytesPerTriangle * statistics->triangleCount;
+				total->indexSize = std::max(total->indexSize, statistics->indexSize);
+			}
+		}
+	}
+
+	if (totalBefore.triangleCount == 0) {
+		printf("No indexed triangle primitives found\n");
+		return 0;
+	}
+	// Totals are weighted by triangle count
+	for (MeshStatistics* total : { &totalBefore, &totalAfter }) {
+		total->cache.acmr = static_cast<float>(total->cache.verticesTransformed) / static_cast<float>(total->triangleCount);
+		total->cache.atvr = static_cast<float>(total->cache.verticesTransformed) / static_cast<float>(total->vertexCount);
+		total->overdraw.overdraw = static_cast<float>(total->overdraw.pixelsShaded) / static_cast<float>(std::max(total->overdraw.pixelsCovered, 1u));
+		total->fetch.overfetch = static_cast<float>(total->fetch.bytesFetched) / static_cast<float>(total->vertexCount * sizeof(AnalyzerVertex));
+		total->bytesPerTriangle /= static_cast<float>(total->triangleCount);
+	}
+	printf("Total (overdraw threshold %.2f)\n", threshold);
+	print("original", totalBefore);
+	print("optimized", totalAfter);
+	printf("  meshlets  %8zu       %s\n", totalMeshlets, meshletsValid ? "valid" : "INVALID");
+	return meshletsValid ? 0 : 1;
+}